@@ -48,8 +48,25 @@ static void uart_pipe_isr(struct device *unused)
 			continue;
 		}
 
-		rx = uart_fifo_read(uart_pipe_dev, recv_buf + recv_off,
-				    recv_buf_len - recv_off);
+		/*
+		 * Empty the FIFO into the buffer before calling the
+		 * application, so it can process the data a buffer at a
+		 * time instead of a FIFO read at a time.
+		 */
+		rx = 0;
+
+		while (recv_off < recv_buf_len) {
+			int len = uart_fifo_read(uart_pipe_dev,
+						 recv_buf + recv_off,
+						 recv_buf_len - recv_off);
+			if (!len) {
+				break;
+			}
+
+			recv_off += len;
+			rx += len;
+		}
+
 		if (!rx) {
 			continue;
 		}
@@ -58,7 +75,6 @@ static void uart_pipe_isr(struct device *unused)
 		 * Call application callback with received data. Application
 		 * may provide new buffer or alter data offset.
 		 */
-		recv_off += rx;
 		recv_buf = app_cb(recv_buf, &recv_off);
 	}
 }
@@ -28,6 +28,12 @@
 
 #define D10D24S 11
 
+/* A frame of 1518 octets takes 1.2 ms at 10 Mb/s. In half duplex the
+ * backoff after 15 collisions adds at most about 50 ms to that, so the
+ * transmission has stalled if it is not done after 100 ms.
+ */
+#define TX_WAIT_RETRIES (100000 / D10D24S)
+
 static void enc28j60_thread_main(void *arg1, void *unused1, void *unused2);
 
 static int eth_enc28j60_soft_reset(struct device *dev)
@@ -38,22 +44,35 @@ static int eth_enc28j60_soft_reset(struct device *dev)
 	return spi_write(context->spi, tx_buf, 2);
 }
 
+/* The bank of the last access is remembered so that ECON1 needs to be
+ * written only when a register of another bank is accessed. The common
+ * registers are in every bank.
+ */
 static void eth_enc28j60_set_bank(struct device *dev, uint16_t reg_addr)
 {
 	struct eth_enc28j60_runtime *context = dev->driver_data;
+	uint8_t bank = (reg_addr >> 8) & 0x03;
 	uint8_t tx_buf[2];
 
+	if ((reg_addr & 0xFF) >= ENC28J60_REG_EIE || bank == context->bank) {
+		return;
+	}
+
 	k_sem_take(&context->spi_sem, K_FOREVER);
 
-	tx_buf[0] = ENC28J60_SPI_RCR | ENC28J60_REG_ECON1;
-	tx_buf[1] = 0x0;
+	tx_buf[0] = ENC28J60_SPI_BFC | ENC28J60_REG_ECON1;
+	tx_buf[1] = ENC28J60_BIT_ECON1_BSEL;
 
-	spi_transceive(context->spi, tx_buf, 2, tx_buf, 2);
+	spi_write(context->spi, tx_buf, 2);
 
-	tx_buf[0] = ENC28J60_SPI_WCR | ENC28J60_REG_ECON1;
-	tx_buf[1] = (tx_buf[1] & 0xFC) | ((reg_addr >> 8) & 0x0F);
+	if (bank) {
+		tx_buf[0] = ENC28J60_SPI_BFS | ENC28J60_REG_ECON1;
+		tx_buf[1] = bank;
 
-	spi_write(context->spi, tx_buf, 2);
+		spi_write(context->spi, tx_buf, 2);
+	}
+
+	context->bank = bank;
 
 	k_sem_give(&context->spi_sem);
 }
@@ -130,32 +149,51 @@ static void eth_enc28j60_clear_eth_reg(struct device *dev, uint16_t reg_addr,
 	k_sem_give(&context->spi_sem);
 }
 
-static void eth_enc28j60_write_mem(struct device *dev, uint8_t *data_buffer,
-				   uint16_t buf_len)
+/* Write a frame at the write pointer. The fragments are gathered into
+ * as few SPI transfers as the transfer buffer allows, the first one
+ * starting with the per packet control byte.
+ */
+static void eth_enc28j60_write_frame(struct device *dev, struct net_buf *buf)
 {
 	struct eth_enc28j60_runtime *context = dev->driver_data;
-	uint8_t *index_buf;
-	uint16_t num_segments;
-	uint16_t num_remaining;
-
-	index_buf = data_buffer;
-	num_segments = buf_len / MAX_BUFFER_LENGTH;
-	num_remaining = buf_len - MAX_BUFFER_LENGTH * num_segments;
+	struct net_buf *frag;
+	uint16_t pos, copy;
 
 	k_sem_take(&context->spi_sem, K_FOREVER);
 
-	for (int i = 0; i < num_segments;
-	     ++i, index_buf += MAX_BUFFER_LENGTH) {
-		context->mem_buf[0] = ENC28J60_SPI_WBM;
-		memcpy(context->mem_buf + 1, index_buf, MAX_BUFFER_LENGTH);
-		spi_write(context->spi,
-			  context->mem_buf, MAX_BUFFER_LENGTH + 1);
+	context->mem_buf[0] = ENC28J60_SPI_WBM;
+	context->mem_buf[1] = ENC28J60_PPCTL_BYTE;
+	pos = 2;
+
+	for (frag = buf->frags; frag; frag = frag->frags) {
+		uint8_t *data_ptr;
+		uint16_t data_len;
+
+		if (frag == buf->frags) {
+			data_ptr = net_nbuf_ll(buf);
+			data_len = net_nbuf_ll_reserve(buf) + frag->len;
+		} else {
+			data_ptr = frag->data;
+			data_len = frag->len;
+		}
+
+		while (data_len) {
+			copy = min(data_len, sizeof(context->mem_buf) - pos);
+
+			memcpy(context->mem_buf + pos, data_ptr, copy);
+			pos += copy;
+			data_ptr += copy;
+			data_len -= copy;
+
+			if (pos == sizeof(context->mem_buf)) {
+				spi_write(context->spi, context->mem_buf, pos);
+				pos = 1;
+			}
+		}
 	}
 
-	if (num_remaining > 0) {
-		context->mem_buf[0] = ENC28J60_SPI_WBM;
-		memcpy(context->mem_buf + 1, index_buf, num_remaining);
-		spi_write(context->spi, context->mem_buf, num_remaining + 1);
+	if (pos > 1) {
+		spi_write(context->spi, context->mem_buf, pos);
 	}
 
 	k_sem_give(&context->spi_sem);
@@ -195,6 +233,25 @@ static void eth_enc28j60_read_mem(struct device *dev, uint8_t *data_buffer,
 	k_sem_give(&context->spi_sem);
 }
 
+/* Read straight into a fragment that has one byte of headroom for the
+ * SPI opcode, so that the frame is not copied through mem_buf.
+ */
+static void eth_enc28j60_read_frag(struct device *dev, struct net_buf *frag,
+				   uint16_t len)
+{
+	struct eth_enc28j60_runtime *context = dev->driver_data;
+	uint8_t *ptr = frag->data - 1;
+
+	k_sem_take(&context->spi_sem, K_FOREVER);
+
+	ptr[0] = ENC28J60_SPI_RBM;
+	spi_transceive(context->spi, ptr, len + 1, ptr, len + 1);
+
+	k_sem_give(&context->spi_sem);
+
+	net_buf_add(frag, len);
+}
+
 static void eth_enc28j60_write_phy(struct device *dev, uint16_t reg_addr,
 				   int16_t data)
 {
@@ -390,6 +447,11 @@ static int eth_enc28j60_init(struct device *dev)
 	/* Errata B7/2 */
 	k_busy_wait(D10D24S);
 
+	/* The reset selects bank 0 */
+	context->bank = 0;
+	context->next_packet = ENC28J60_RXSTART;
+	context->tx_slot = 0;
+
 	eth_enc28j60_init_buffers(dev);
 	eth_enc28j60_init_mac(dev);
 	eth_enc28j60_init_phy(dev);
@@ -415,60 +477,77 @@ static int eth_enc28j60_init(struct device *dev)
 	return 0;
 }
 
+/* Wait until the previous frame has been sent. Latest errata sheet
+ * DS80349C: after an error in half duplex, ECON1.TXRTS may never be
+ * cleared and the transmit logic stalls (Errata Issue 12). So the wait
+ * ends on an error or a timeout too, and then the transmit logic is
+ * reset and the frame is given up. The reset is done only then,
+ * because it would abort a frame that is being sent.
+ */
+static void eth_enc28j60_wait_tx(struct device *dev)
+{
+	int retries = TX_WAIT_RETRIES;
+	uint8_t econ1, eir;
+
+	while (1) {
+		eth_enc28j60_read_reg(dev, ENC28J60_REG_ECON1, &econ1);
+		eth_enc28j60_read_reg(dev, ENC28J60_REG_EIR, &eir);
+
+		if (!(econ1 & ENC28J60_BIT_ECON1_TXRTS) ||
+		    (eir & ENC28J60_BIT_EIR_TXERIF) || !retries--) {
+			break;
+		}
+
+		/* wait 10.24 useconds */
+		k_busy_wait(D10D24S);
+	}
+
+	if (!(econ1 & ENC28J60_BIT_ECON1_TXRTS) &&
+	    !(eir & ENC28J60_BIT_EIR_TXERIF)) {
+		return;
+	}
+
+	eth_enc28j60_set_eth_reg(dev, ENC28J60_REG_ECON1,
+				 ENC28J60_BIT_ECON1_TXRST);
+	eth_enc28j60_clear_eth_reg(dev, ENC28J60_REG_ECON1,
+				   ENC28J60_BIT_ECON1_TXRST |
+				   ENC28J60_BIT_ECON1_TXRTS);
+	eth_enc28j60_clear_eth_reg(dev, ENC28J60_REG_EIR,
+				   ENC28J60_BIT_EIR_TXERIF);
+}
+
+/* The TX memory has two slots. The frame is written into the free slot
+ * while the chip may still be sending the previous one from the other,
+ * and the function returns as soon as the transmission is started. So
+ * the caller does not get the result of the transmission.
+ */
 static int eth_enc28j60_tx(struct device *dev, struct net_buf *buf,
 			   uint16_t len)
 {
 	struct eth_enc28j60_runtime *context = dev->driver_data;
-	uint16_t tx_bufaddr = ENC28J60_TXSTART;
-	bool first_frag = true;
-	uint8_t per_packet_control;
+	uint16_t tx_bufaddr = ENC28J60_TXSTART +
+		context->tx_slot * ENC28J60_TXSIZE;
 	uint16_t tx_bufaddr_end;
-	struct net_buf *frag;
-	uint8_t tx_end;
 
-	k_sem_take(&context->tx_rx_sem, K_FOREVER);
+	if (len > ENC28J60_TXSIZE - ENC28J60_SV_SIZE) {
+		return -EMSGSIZE;
+	}
 
-	/* Latest errata sheet: DS80349C
-	* always reset transmit logic (Errata Issue 12)
-	* the Microchip TCP/IP stack implementation used to first check
-	* whether TXERIF is set and only then reset the transmit logic
-	* but this has been changed in later versions; possibly they
-	* have a reason for this; they don't mention this in the errata
-	* sheet
-	*/
-	eth_enc28j60_set_eth_reg(dev, ENC28J60_REG_ECON1,
-				 ENC28J60_BIT_ECON1_TXRST);
-	eth_enc28j60_clear_eth_reg(dev, ENC28J60_REG_ECON1,
-				   ENC28J60_BIT_ECON1_TXRST);
+	k_sem_take(&context->tx_rx_sem, K_FOREVER);
 
-	/* Write the buffer content into the transmission buffer */
-	eth_enc28j60_set_bank(dev, ENC28J60_REG_ETXSTL);
+	/* Write the buffer content into the free slot */
+	eth_enc28j60_set_bank(dev, ENC28J60_REG_EWRPTL);
 	eth_enc28j60_write_reg(dev, ENC28J60_REG_EWRPTL, tx_bufaddr & 0xFF);
 	eth_enc28j60_write_reg(dev, ENC28J60_REG_EWRPTH, tx_bufaddr >> 8);
-	eth_enc28j60_write_reg(dev, ENC28J60_REG_ETXSTL, tx_bufaddr & 0xFF);
-	eth_enc28j60_write_reg(dev, ENC28J60_REG_ETXSTH, tx_bufaddr >> 8);
 
-	/* Write the data into the buffer */
-	per_packet_control = ENC28J60_PPCTL_BYTE;
-	eth_enc28j60_write_mem(dev, &per_packet_control, 1);
+	eth_enc28j60_write_frame(dev, buf);
 
-	for (frag = buf->frags; frag; frag = frag->frags) {
-		uint8_t *data_ptr;
-		uint16_t data_len;
-
-		if (first_frag) {
-			data_ptr = net_nbuf_ll(buf);
-			data_len = net_nbuf_ll_reserve(buf) + frag->len;
-			first_frag = false;
-		} else {
-			data_ptr = frag->data;
-			data_len = frag->len;
-		}
-
-		eth_enc28j60_write_mem(dev, data_ptr, data_len);
-	}
+	eth_enc28j60_wait_tx(dev);
 
 	tx_bufaddr_end = tx_bufaddr + len;
+
+	eth_enc28j60_write_reg(dev, ENC28J60_REG_ETXSTL, tx_bufaddr & 0xFF);
+	eth_enc28j60_write_reg(dev, ENC28J60_REG_ETXSTH, tx_bufaddr >> 8);
 	eth_enc28j60_write_reg(dev, ENC28J60_REG_ETXNDL,
 			       tx_bufaddr_end & 0xFF);
 	eth_enc28j60_write_reg(dev, ENC28J60_REG_ETXNDH, tx_bufaddr_end >> 8);
@@ -477,143 +556,145 @@ static int eth_enc28j60_tx(struct device *dev, struct net_buf *buf,
 	eth_enc28j60_set_eth_reg(dev, ENC28J60_REG_ECON1,
 				 ENC28J60_BIT_ECON1_TXRTS);
 
-	do {
-		/* wait 10.24 useconds */
-		k_busy_wait(D10D24S);
-		eth_enc28j60_read_reg(dev, ENC28J60_REG_EIR, &tx_end);
-		tx_end &= ENC28J60_BIT_EIR_TXIF;
-	} while (!tx_end);
-
-	eth_enc28j60_read_reg(dev, ENC28J60_REG_ESTAT, &tx_end);
+	context->tx_slot ^= 1;
 
 	k_sem_give(&context->tx_rx_sem);
 
-	if (tx_end & ENC28J60_BIT_ESTAT_TXABRT) {
-		return -EIO;
-	}
-
 	return 0;
 }
 
-static int eth_enc28j60_rx(struct device *dev)
+static struct net_buf *eth_enc28j60_read_frame(struct device *dev,
+					       uint16_t len)
 {
-	struct eth_enc28j60_runtime *context = dev->driver_data;
-	uint16_t lengthfr;
-	uint8_t counter;
+	struct net_buf *buf, *frag;
+	uint16_t count;
 
-	/* Errata 6. The Receive Packet Pending Interrupt Flag (EIR.PKTIF)
-	 * does not reliably/accurately report the status of pending packet.
-	 * Use EPKTCNT register instead.
-	*/
-
-	k_sem_take(&context->tx_rx_sem, K_FOREVER);
+	buf = net_nbuf_get_reserve_rx(0);
+	if (!buf) {
+		return NULL;
+	}
 
-	do {
-		struct net_buf *last_frag;
-		struct net_buf *pkt_buf = NULL;
-		uint16_t frm_len = 0;
-		struct net_buf *buf;
-		uint16_t next_packet;
-		uint8_t np[2];
-
-		/* Read address for next packet */
-		eth_enc28j60_read_mem(dev, np, 2);
-		next_packet = np[0] | (uint16_t)np[1] << 8;
-
-		/* Errata 14. Even values in ERXRDPT
-		 * may corrupt receive buffer.
-		 */
-		if (next_packet == 0) {
-			next_packet = ENC28J60_RXEND;
-		} else if (!(next_packet & 0x01)) {
-			next_packet--;
+	while (len) {
+		/* One byte of headroom for eth_enc28j60_read_frag() */
+		frag = net_nbuf_get_reserve_data(1);
+		if (!frag) {
+			net_nbuf_unref(buf);
+			return NULL;
 		}
 
-		/* Read reception status vector */
-		eth_enc28j60_read_mem(dev, context->rx_rsv, 4);
+		net_buf_frag_add(buf, frag);
 
-		/* Get the frame length from the rx status vector */
-		frm_len = (context->rx_rsv[1] << 8) | context->rx_rsv[0];
-		lengthfr = frm_len;
+		count = min(len, net_buf_tailroom(frag));
 
-		/* Get the frame from the buffer */
-		buf = net_nbuf_get_reserve_rx(0);
-		if (!buf) {
-			goto done;
-		}
+		eth_enc28j60_read_frag(dev, frag, count);
 
-		last_frag = buf;
+		len -= count;
+	}
 
-		do {
-			size_t frag_len;
-			uint8_t *data_ptr;
-			size_t spi_frame_len;
+	return buf;
+}
 
-			/* Reserve a data frag to receive the frame */
-			pkt_buf = net_nbuf_get_reserve_data(0);
-			if (!pkt_buf) {
-				net_buf_unref(buf);
-				goto done;
-			}
+/* Read one frame from the RX ring and give its space back to the chip
+ * before the frame is passed up, so that the chip can already receive
+ * into it while the stack processes the frame.
+ */
+static void eth_enc28j60_rx_frame(struct device *dev)
+{
+	struct eth_enc28j60_runtime *context = dev->driver_data;
+	uint16_t next_packet, rx_rdptr, frm_len;
+	struct net_buf *buf = NULL;
+	uint8_t hdr[2 + RSV_SIZE];
 
-			net_buf_frag_insert(last_frag, pkt_buf);
-			data_ptr = pkt_buf->data;
+	/* The read pointer is set for every frame, so a frame that is
+	 * not read to the end does not affect the next one.
+	 */
+	eth_enc28j60_set_bank(dev, ENC28J60_REG_ERDPTL);
+	eth_enc28j60_write_reg(dev, ENC28J60_REG_ERDPTL,
+			       context->next_packet & 0xFF);
+	eth_enc28j60_write_reg(dev, ENC28J60_REG_ERDPTH,
+			       context->next_packet >> 8);
 
-			last_frag = pkt_buf;
+	/* Address of the next packet and the reception status vector */
+	eth_enc28j60_read_mem(dev, hdr, sizeof(hdr));
 
-			/* Review the space available for the new frag */
-			frag_len = net_buf_tailroom(pkt_buf);
+	next_packet = hdr[0] | (uint16_t)hdr[1] << 8;
+	frm_len = hdr[2] | (uint16_t)hdr[3] << 8;
 
-			if (frm_len > frag_len) {
-				spi_frame_len = frag_len;
-			} else {
-				spi_frame_len = frm_len;
-			}
+	if (next_packet > ENC28J60_RXEND) {
+		/* Corrupted status, skip to where the chip writes next */
+		uint8_t wrpt[2];
 
-			eth_enc28j60_read_mem(dev, data_ptr, spi_frame_len);
+		eth_enc28j60_read_reg(dev, ENC28J60_REG_ERXWRPTL, &wrpt[0]);
+		eth_enc28j60_read_reg(dev, ENC28J60_REG_ERXWRPTH, &wrpt[1]);
+		next_packet = wrpt[0] | (uint16_t)wrpt[1] << 8;
+	} else if (frm_len > ENC28J60_FCS_SIZE) {
+		/* The FCS has been checked by the chip */
+		buf = eth_enc28j60_read_frame(dev,
+					      frm_len - ENC28J60_FCS_SIZE);
+	}
 
-			net_buf_add(pkt_buf, spi_frame_len);
+	/* Errata 14. Even values in ERXRDPT
+	 * may corrupt receive buffer.
+	 */
+	if (next_packet == ENC28J60_RXSTART) {
+		rx_rdptr = ENC28J60_RXEND;
+	} else if (!(next_packet & 0x01)) {
+		rx_rdptr = next_packet - 1;
+	} else {
+		rx_rdptr = next_packet;
+	}
 
-			/* One fragment has been written via SPI */
-			frm_len -= spi_frame_len;
-		} while (frm_len > 0);
+	/* Free buffer memory and decrement rx counter */
+	eth_enc28j60_write_reg(dev, ENC28J60_REG_ERXRDPTL, rx_rdptr & 0xFF);
+	eth_enc28j60_write_reg(dev, ENC28J60_REG_ERXRDPTH, rx_rdptr >> 8);
+	eth_enc28j60_set_eth_reg(dev, ENC28J60_REG_ECON2,
+				 ENC28J60_BIT_ECON2_PKTDEC);
 
-		/* Pops one padding byte from spi circular buffer
-		 * introduced by the device when the frame length is odd
-		 */
-		if (lengthfr & 0x01) {
-			uint8_t pad;
+	context->next_packet = next_packet;
 
-			eth_enc28j60_read_mem(dev, &pad, 1);
+	if (!buf) {
+		return;
+	}
+
+	/*Feed buffer frame to IP stack */
+	if (net_recv_data(context->iface, buf) < 0) {
+		net_nbuf_unref(buf);
+	}
+}
+
+static void eth_enc28j60_rx(struct device *dev)
+{
+	struct eth_enc28j60_runtime *context = dev->driver_data;
+	uint8_t counter;
+
+	/* Errata 6. The Receive Packet Pending Interrupt Flag (EIR.PKTIF)
+	 * does not reliably/accurately report the status of pending packet.
+	 * Use EPKTCNT register instead.
+	 *
+	 * All the frames counted are read before EPKTCNT is read again,
+	 * so the bank is not switched back and forth for every frame.
+	 */
+	k_sem_take(&context->tx_rx_sem, K_FOREVER);
+
+	eth_enc28j60_set_bank(dev, ENC28J60_REG_EPKTCNT);
+	eth_enc28j60_read_reg(dev, ENC28J60_REG_EPKTCNT, &counter);
+
+	while (counter) {
+		for (; counter; counter--) {
+			eth_enc28j60_rx_frame(dev);
 		}
 
-		/*Feed buffer frame to IP stack */
-		net_recv_data(context->iface, buf);
-done:
-		/* Free buffer memory and decrement rx counter */
-		eth_enc28j60_set_bank(dev, ENC28J60_REG_ERXRDPTL);
-		eth_enc28j60_write_reg(dev, ENC28J60_REG_ERXRDPTL,
-				       next_packet & 0xFF);
-		eth_enc28j60_write_reg(dev, ENC28J60_REG_ERXRDPTH,
-				       next_packet >> 8);
-		eth_enc28j60_set_eth_reg(dev, ENC28J60_REG_ECON2,
-					 ENC28J60_BIT_ECON2_PKTDEC);
-
-		/* Check if there are frames to clean from the buffer */
 		eth_enc28j60_set_bank(dev, ENC28J60_REG_EPKTCNT);
 		eth_enc28j60_read_reg(dev, ENC28J60_REG_EPKTCNT, &counter);
-	} while (counter);
+	}
 
 	k_sem_give(&context->tx_rx_sem);
-
-	return 0;
 }
 
 static void enc28j60_thread_main(void *arg1, void *unused1, void *unused2)
 {
 	struct device *dev = (struct device *) arg1;
 	struct eth_enc28j60_runtime *context;
-	uint8_t int_stat;
 
 	ARG_UNUSED(unused1);
 	ARG_UNUSED(unused2);
@@ -622,15 +703,22 @@ static void enc28j60_thread_main(void *arg1, void *unused1, void *unused2)
 
 	while (1) {
 		k_sem_take(&context->int_sem, K_FOREVER);
-		eth_enc28j60_read_reg(dev, ENC28J60_REG_EIR, &int_stat);
-
-		if (int_stat & ENC28J60_BIT_EIR_PKTIF) {
-			eth_enc28j60_rx(dev);
-			/* Clear rx interruption flag */
-			eth_enc28j60_clear_eth_reg(dev, ENC28J60_REG_EIR,
-						   ENC28J60_BIT_EIR_PKTIF
-						   | ENC28J60_BIT_EIR_RXERIF);
-		}
+
+		/* INT stays deasserted until all the pending frames are
+		 * read, so a frame that arrives meanwhile causes a new
+		 * interrupt when it is enabled again.
+		 */
+		eth_enc28j60_clear_eth_reg(dev, ENC28J60_REG_EIE,
+					   ENC28J60_BIT_EIE_INTIE);
+
+		eth_enc28j60_rx(dev);
+
+		/* Clear rx interruption flag */
+		eth_enc28j60_clear_eth_reg(dev, ENC28J60_REG_EIR,
+					   ENC28J60_BIT_EIR_PKTIF
+					   | ENC28J60_BIT_EIR_RXERIF);
+		eth_enc28j60_set_eth_reg(dev, ENC28J60_REG_EIE,
+					 ENC28J60_BIT_EIE_INTIE);
 	}
 }
 
@@ -159,6 +159,7 @@
 #define ENC28J60_BIT_ECON1_TXRST   (0x80)
 #define ENC28J60_BIT_ECON1_TXRTS   (0x08)
 #define ENC28J60_BIT_ECON1_RXEN    (0x04)
+#define ENC28J60_BIT_ECON1_BSEL    (0x03)
 #define ENC28J60_BIT_ECON2_PKTDEC  (0x40)
 #define ENC28J60_BIT_EIR_PKTIF     (0x40)
 #define ENC28J60_BIT_EIE_TXIE      (0x08)
@@ -203,13 +204,21 @@
 
 /* Start of RX buffer, (must be zero, Rev. B4 Errata point 5) */
 #define ENC28J60_RXSTART 0x0000
-/* End of RX buffer, room for 2 packets */
-#define ENC28J60_RXEND 0x0BFF
+/* End of RX buffer, room for 3 full size packets */
+#define ENC28J60_RXEND 0x13FF
 
-/* Start of TX buffer, room for 1 packet */
-#define ENC28J60_TXSTART 0x0C00
+/* Start of TX buffer, room for 2 packets so that the next one can be
+ * written while the previous one is sent. A slot holds the per packet
+ * control byte, the frame and the transmit status vector.
+ */
+#define ENC28J60_TXSTART 0x1400
+/* Size of one TX slot */
+#define ENC28J60_TXSIZE 0x0600
 /* End of TX buffer */
-#define ENC28J60_TXEND 0x11FF
+#define ENC28J60_TXEND 0x1FFF
+
+/* Frame check sequence at the end of the received frames */
+#define ENC28J60_FCS_SIZE 4
 
 /* Status vectors array size */
 #define TSV_SIZE 7
@@ -247,6 +256,9 @@ struct eth_enc28j60_runtime {
 	struct k_sem tx_rx_sem;
 	struct k_sem int_sem;
 	struct k_sem spi_sem;
+	uint16_t next_packet;
+	uint8_t bank;
+	uint8_t tx_slot;
 };
 
 #endif /*_ENC28J60_*/
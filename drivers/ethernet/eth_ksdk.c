@@ -33,6 +33,7 @@
 #include <device.h>
 #include <misc/util.h>
 #include <kernel.h>
+#include <atomic.h>
 #include <net/nbuf.h>
 #include <net/net_if.h>
 
@@ -40,30 +41,60 @@
 #include "fsl_phy.h"
 #include "fsl_port.h"
 
+/* Every RX descriptor holds a network data fragment, the controller
+ * writes the received frames straight into them. The fragments must
+ * be 16 byte aligned and hold a multiple of 16 bytes.
+ */
+#define ETH_KSDK_RX_FRAG_SIZE						\
+	((CONFIG_NET_NBUF_DATA_SIZE - ENET_BUFF_ALIGNMENT + 1) &	\
+	 ~(ENET_BUFF_ALIGNMENT - 1))
+
+#if ETH_KSDK_RX_FRAG_SIZE < ENET_RX_MIN_BUFFERSIZE
+#error "CONFIG_NET_NBUF_DATA_SIZE is too small for the ENET RX buffers"
+#endif
+
+#if ETH_KSDK_RX_FRAG_SIZE * CONFIG_ETH_KSDK_RX_BUFFERS <= \
+	ENET_FRAME_MAX_FRAMELEN
+#error "CONFIG_ETH_KSDK_RX_BUFFERS cannot hold a full frame"
+#endif
+
+#define ETH_KSDK_THREAD_STACK_SIZE 768
+
+/* Interrupts that are masked while the rings are polled */
+#define ETH_KSDK_POLL_INTERRUPTS \
+	(kENET_RxFrameInterrupt | kENET_TxFrameInterrupt)
+
 struct eth_context {
 	struct net_if *iface;
 	enet_handle_t enet_handle;
-	struct nano_sem tx_buf_sem;
+	struct k_sem poll_sem;
+	struct k_sem tx_sem;
 	uint8_t mac_addr[6];
-	/* TODO: FIXME. This Ethernet frame sized buffer is used for
-	 * interfacing with KSDK. How it works is that hardware uses
-	 * DMA scatter buffers to receive a frame, and then public
-	 * KSDK call gathers them into this buffer (there's no other
-	 * public interface). All this happens only for this driver
-	 * to scatter this buffer again into Zephyr fragment buffers.
-	 * This is not efficient, but proper resolution of this issue
-	 * depends on introduction of zero-copy networking support
-	 * in Zephyr, and adding needed interface to KSDK (or
-	 * bypassing it and writing a more complex driver working
-	 * directly with hardware).
+
+	/* Fragment attached to each RX descriptor */
+	struct net_buf *rx_frag[CONFIG_ETH_KSDK_RX_BUFFERS];
+
+	/* Buffer of the frame that ends at each TX descriptor */
+	struct net_buf *tx_frame[CONFIG_ETH_KSDK_TX_BUFFERS];
+
+	/* Next RX descriptor to be read */
+	uint8_t rx_next;
+
+	/* Next free TX descriptor and the oldest one in use. The number
+	 * of descriptors in use tells a full ring from an empty one, as
+	 * tx_next equals tx_dirty in both.
 	 */
-	uint8_t frame_buf[1500];
+	uint8_t tx_next;
+	uint8_t tx_dirty;
+	atomic_t tx_used;
+
+	char __stack thread_stack[ETH_KSDK_THREAD_STACK_SIZE];
 };
 
 static void eth_0_config_func(void);
 
 static enet_rx_bd_struct_t __aligned(ENET_BUFF_ALIGNMENT)
-rx_buffer_desc[CONFIG_ETH_KSDK_TX_BUFFERS];
+rx_buffer_desc[CONFIG_ETH_KSDK_RX_BUFFERS];
 
 static enet_tx_bd_struct_t __aligned(ENET_BUFF_ALIGNMENT)
 tx_buffer_desc[CONFIG_ETH_KSDK_TX_BUFFERS];
@@ -74,185 +105,327 @@ tx_buffer_desc[CONFIG_ETH_KSDK_TX_BUFFERS];
 #define ETH_KSDK_BUFFER_SIZE \
 	ROUND_UP(ENET_FRAME_MAX_VALNFRAMELEN, ENET_BUFF_ALIGNMENT)
 
-static uint8_t __aligned(ENET_BUFF_ALIGNMENT)
-rx_buffer[CONFIG_ETH_KSDK_RX_BUFFERS][ETH_KSDK_BUFFER_SIZE];
+static inline uint8_t rx_desc_next(uint8_t index)
+{
+	return index == CONFIG_ETH_KSDK_RX_BUFFERS - 1 ? 0 : index + 1;
+}
 
-static uint8_t __aligned(ENET_BUFF_ALIGNMENT)
-tx_buffer[CONFIG_ETH_KSDK_TX_BUFFERS][ETH_KSDK_BUFFER_SIZE];
+static inline uint8_t tx_desc_next(uint8_t index)
+{
+	return index == CONFIG_ETH_KSDK_TX_BUFFERS - 1 ? 0 : index + 1;
+}
+
+/* Number of TX descriptors a frame needs, one per non-empty fragment.
+ * The first fragment also carries the link layer header.
+ */
+static int tx_desc_count(struct net_buf *buf)
+{
+	struct net_buf *frag;
+	int count = 1;
+
+	for (frag = buf->frags->frags; frag; frag = frag->frags) {
+		if (frag->len) {
+			count++;
+		}
+	}
+
+	return count;
+}
 
 static int eth_tx(struct net_if *iface, struct net_buf *buf)
 {
 	struct eth_context *context = iface->dev->driver_data;
-	const struct net_buf *frag;
-	uint8_t *dst;
-	status_t status;
-	unsigned int imask;
-
-	uint16_t total_len = net_nbuf_ll_reserve(buf) + net_buf_frags_len(buf);
+	volatile enet_tx_bd_struct_t *first, *bd;
+	struct net_buf *frag;
+	uint8_t *data;
+	uint16_t len;
+	unsigned int key;
+	uint8_t index;
+	int count, i;
+
+	count = tx_desc_count(buf);
+	if (count > CONFIG_ETH_KSDK_TX_BUFFERS) {
+		/* Fill up the fragments so that the frame fits the ring */
+		net_nbuf_compact(buf);
+
+		count = tx_desc_count(buf);
+		if (count > CONFIG_ETH_KSDK_TX_BUFFERS) {
+			SYS_LOG_ERR("Too many fragments (%d)", count);
+			return -EMSGSIZE;
+		}
+	}
 
-	k_sem_take(&context->tx_buf_sem, K_FOREVER);
+	/* The descriptors are given back by eth_tx_reclaim() once the
+	 * frames that used them have been sent.
+	 */
+	for (i = 0; i < count; i++) {
+		k_sem_take(&context->tx_sem, K_FOREVER);
+	}
 
-	/* As context->frame_buf is shared resource used by both eth_tx
-	 * and eth_rx, we need to protect it with irq_lock.
+	/* The descriptors point directly to the fragments, which stay
+	 * referenced until the frame has been sent. TX buffers need no
+	 * alignment. The first descriptor is made ready last, so the
+	 * controller cannot start on a partially set up frame.
 	 */
-	imask = irq_lock();
+	index = context->tx_next;
+	first = &tx_buffer_desc[index];
+
+	frag = buf->frags;
+	data = net_nbuf_ll(buf);
+	len = net_nbuf_ll_reserve(buf) + frag->len;
+
+	while (1) {
+		uint16_t control;
 
-	/* Gather fragment buffers into flat Ethernet frame buffer
-	 * which can be fed to KSDK Ethernet functions. First
-	 * fragment is special - it contains link layer (Ethernet
-	 * in our case) headers and must be treated specially.
+		bd = &tx_buffer_desc[index];
+
+		do {
+			frag = frag->frags;
+		} while (frag && !frag->len);
+
+		control = (bd->control & ENET_BUFFDESCRIPTOR_TX_WRAP_MASK) |
+			  ENET_BUFFDESCRIPTOR_TX_TRANMITCRC_MASK;
+		if (!frag) {
+			control |= ENET_BUFFDESCRIPTOR_TX_LAST_MASK;
+		}
+
+		if (bd != first) {
+			control |= ENET_BUFFDESCRIPTOR_TX_READY_MASK;
+		}
+
+		bd->buffer = data;
+		bd->length = len;
+		bd->control = control;
+
+		if (!frag) {
+			break;
+		}
+
+		index = tx_desc_next(index);
+		data = frag->data;
+		len = frag->len;
+	}
+
+	context->tx_frame[index] = buf;
+
+	/* The descriptors are counted in use together with making the
+	 * frame ready, so eth_tx_reclaim() never takes the first one
+	 * for a sent frame before it has been made ready.
 	 */
-	dst = context->frame_buf;
-	memcpy(dst, net_nbuf_ll(buf),
-	       net_nbuf_ll_reserve(buf) + buf->frags->len);
-	dst += net_nbuf_ll_reserve(buf) + buf->frags->len;
-
-	/* Continue with the rest of fragments (which contain only data) */
-	frag = buf->frags->frags;
-	while (frag) {
-		memcpy(dst, frag->data, frag->len);
-		dst += frag->len;
-		frag = frag->frags;
+	key = irq_lock();
+	first->control |= ENET_BUFFDESCRIPTOR_TX_READY_MASK;
+	atomic_add(&context->tx_used, count);
+	irq_unlock(key);
+
+	ENET->TDAR = ENET_TDAR_TDAR_MASK;
+
+	context->tx_next = tx_desc_next(index);
+
+	return 0;
+}
+
+/* Release the buffers of the frames that have been sent */
+static void eth_tx_reclaim(struct eth_context *context)
+{
+	while (atomic_get(&context->tx_used) > 0) {
+		uint8_t index = context->tx_dirty;
+
+		if (tx_buffer_desc[index].control &
+		    ENET_BUFFDESCRIPTOR_TX_READY_MASK) {
+			break;
+		}
+
+		if (context->tx_frame[index]) {
+			net_nbuf_unref(context->tx_frame[index]);
+			context->tx_frame[index] = NULL;
+		}
+
+		context->tx_dirty = tx_desc_next(index);
+		atomic_dec(&context->tx_used);
+		k_sem_give(&context->tx_sem);
+	}
+}
+
+static struct net_buf *rx_frag_get(void)
+{
+	struct net_buf *frag;
+
+	frag = net_nbuf_get_reserve_data(0);
+	if (!frag) {
+		return NULL;
 	}
 
-	status = ENET_SendFrame(ENET, &context->enet_handle, context->frame_buf,
-				total_len);
+	/* Move the start of the data to the next aligned address */
+	net_buf_reserve(frag, -(uintptr_t)frag->data &
+			(ENET_BUFF_ALIGNMENT - 1));
 
-	irq_unlock(imask);
+	return frag;
+}
 
-	if (status) {
-		SYS_LOG_ERR("ENET_SendFrame error: %d\n", status);
-		return -1;
+/* Give a descriptor and its fragment back to the controller */
+static void rx_desc_arm(struct eth_context *context, uint8_t index)
+{
+	volatile enet_rx_bd_struct_t *bd = &rx_buffer_desc[index];
+
+	bd->buffer = context->rx_frag[index]->data;
+	bd->length = 0;
+	bd->control = (bd->control & ENET_BUFFDESCRIPTOR_RX_WRAP_MASK) |
+		      ENET_BUFFDESCRIPTOR_RX_EMPTY_MASK;
+}
+
+static void rx_desc_rearm(struct eth_context *context, int count)
+{
+	while (count--) {
+		rx_desc_arm(context, context->rx_next);
+		context->rx_next = rx_desc_next(context->rx_next);
 	}
 
-	net_nbuf_unref(buf);
-	return 0;
+	ENET_ActiveRead(ENET);
 }
 
-static void eth_rx(struct device *iface)
+/* Pass the next received frame to the stack. The fragments holding the
+ * frame are replaced by fresh ones from the pool. If the pool is empty
+ * the frame is dropped and its fragments are used again.
+ *
+ * Returns false if there is no complete frame in the ring.
+ */
+static bool eth_rx_frame(struct eth_context *context)
 {
-	struct eth_context *context = iface->driver_data;
-	struct net_buf *buf, *prev_frag;
-	const uint8_t *src;
-	uint32_t frame_length = 0;
-	status_t status;
-	unsigned int imask;
+	struct net_buf *buf, *spare = NULL;
+	uint8_t index = context->rx_next;
+	uint8_t last;
+	uint16_t control;
+	int frame_len;
+	int count = 0;
+	int i;
 
-	status = ENET_GetRxFrameSize(&context->enet_handle, &frame_length);
-	if (status) {
-		enet_data_error_stats_t error_stats;
+	do {
+		control = rx_buffer_desc[index].control;
+		if (control & ENET_BUFFDESCRIPTOR_RX_EMPTY_MASK) {
+			/* Nothing received or the frame is still
+			 * being written.
+			 */
+			return false;
+		}
 
-		SYS_LOG_ERR("ENET_GetRxFrameSize return: %d", status);
+		last = index;
+		index = rx_desc_next(index);
+		count++;
+	} while (!(control & ENET_BUFFDESCRIPTOR_RX_LAST_MASK) &&
+		 count < CONFIG_ETH_KSDK_RX_BUFFERS);
+
+	/* The length in the last descriptor is the one of the frame */
+	frame_len = rx_buffer_desc[last].length;
+
+	if (!(control & ENET_BUFFDESCRIPTOR_RX_LAST_MASK) ||
+	    (control & ENET_BUFFDESCRIPTOR_RX_ERR_MASK) ||
+	    frame_len <= (count - 1) * (int)ETH_KSDK_RX_FRAG_SIZE ||
+	    frame_len > count * (int)ETH_KSDK_RX_FRAG_SIZE) {
+		SYS_LOG_ERR("Bad frame, control 0x%04x length %d",
+			    control, frame_len);
+		goto drop;
+	}
 
-		ENET_GetRxErrBeforeReadFrame(&context->enet_handle,
-					     &error_stats);
-		/* Flush the current read buffer.  This operation can
-		 * only report failure if there is no frame to flush,
-		 * which cannot happen in this context.
-		 */
-		status = ENET_ReadFrame(ENET, &context->enet_handle, NULL, 0);
-		assert(status == kStatus_Success);
-		return;
+	for (i = 0; i < count; i++) {
+		struct net_buf *frag;
+
+		frag = rx_frag_get();
+		if (!frag) {
+			goto drop;
+		}
+
+		frag->frags = spare;
+		spare = frag;
 	}
 
 	buf = net_nbuf_get_reserve_rx(0);
 	if (!buf) {
-		/* We failed to get a receive buffer.  We don't add
-		 * any further logging here because the allocator
-		 * issued a diagnostic when it failed to allocate.
-		 *
-		 * Flush the current read buffer.  This operation can
-		 * only report failure if there is no frame to flush,
-		 * which cannot happen in this context.
-		 */
-		status = ENET_ReadFrame(ENET, &context->enet_handle, NULL, 0);
-		assert(status == kStatus_Success);
-		return;
+		goto drop;
 	}
 
-	if (sizeof(context->frame_buf) < frame_length) {
-		SYS_LOG_ERR("frame too large (%d)\n", frame_length);
-		net_buf_unref(buf);
-		status = ENET_ReadFrame(ENET, &context->enet_handle, NULL, 0);
-		assert(status == kStatus_Success);
-		return;
+	for (i = 0; i < count; i++) {
+		struct net_buf *frag = context->rx_frag[context->rx_next];
+		int len = min(frame_len, (int)ETH_KSDK_RX_FRAG_SIZE);
+
+		net_buf_add(frag, len);
+		net_buf_frag_add(buf, frag);
+		frame_len -= len;
+
+		context->rx_frag[context->rx_next] = spare;
+		spare = spare->frags;
+		context->rx_frag[context->rx_next]->frags = NULL;
+
+		rx_desc_arm(context, context->rx_next);
+		context->rx_next = rx_desc_next(context->rx_next);
 	}
 
-	/* As context->frame_buf is shared resource used by both eth_tx
-	 * and eth_rx, we need to protect it with irq_lock.
-	 */
-	imask = irq_lock();
+	ENET_ActiveRead(ENET);
 
-	status = ENET_ReadFrame(ENET, &context->enet_handle,
-				context->frame_buf, frame_length);
-	if (status) {
-		irq_unlock(imask);
-		SYS_LOG_ERR("ENET_ReadFrame failed: %d\n", status);
-		net_buf_unref(buf);
-		return;
+	if (net_recv_data(context->iface, buf) < 0) {
+		net_nbuf_unref(buf);
 	}
 
-	src = context->frame_buf;
-	prev_frag = buf;
-	do {
-		struct net_buf *pkt_buf;
-		size_t frag_len;
-
-		pkt_buf = net_nbuf_get_reserve_data(0);
-		if (!pkt_buf) {
-			irq_unlock(imask);
-			SYS_LOG_ERR("Failed to get fragment buf\n");
-			net_buf_unref(buf);
-			assert(status == kStatus_Success);
-			return;
-		}
+	return true;
 
-		net_buf_frag_insert(prev_frag, pkt_buf);
-		prev_frag = pkt_buf;
-		frag_len = net_buf_tailroom(pkt_buf);
-		if (frag_len > frame_length) {
-			frag_len = frame_length;
-		}
+drop:
+	/* We don't add any logging for failed allocations because the
+	 * allocator issued a diagnostic when it failed.
+	 */
+	if (spare) {
+		net_nbuf_unref(spare);
+	}
 
-		memcpy(pkt_buf->data, src, frag_len);
-		net_buf_add(pkt_buf, frag_len);
-		src += frag_len;
-		frame_length -= frag_len;
-	} while (frame_length > 0);
+	rx_desc_rearm(context, count);
 
-	irq_unlock(imask);
+	return true;
+}
+
+static int eth_rx(struct eth_context *context, int budget)
+{
+	int frames = 0;
 
-	net_recv_data(context->iface, buf);
+	while (frames < budget && eth_rx_frame(context)) {
+		frames++;
+	}
+
+	return frames;
 }
 
-static void eth_callback(ENET_Type *base, enet_handle_t *handle,
-			 enet_event_t event, void *param)
+/* Received and sent frames are handled here with the RX and TX frame
+ * interrupts masked. As long as a full budget of frames is found in
+ * the RX ring, the thread yields and polls again, so under load the
+ * controller raises no interrupts at all. The K64F ENET has no
+ * interrupt coalescing of its own.
+ */
+static void eth_ksdk_thread_main(void *arg1, void *unused1, void *unused2)
 {
-	struct device *iface = param;
-	struct eth_context *context = iface->driver_data;
-
-	switch (event) {
-	case kENET_RxEvent:
-		eth_rx(iface);
-		break;
-	case kENET_TxEvent:
-		/* Free the TX buffer. */
-		k_sem_give(&context->tx_buf_sem);
-		break;
-	case kENET_ErrEvent:
-		/* Error event: BABR/BABT/EBERR/LC/RL/UN/PLR.  */
-		break;
-	case kENET_WakeUpEvent:
-		/* Wake up from sleep mode event. */
-		break;
-#ifdef ENET_ENHANCEDBUFFERDESCRIPTOR_MODE
-	case kENET_TimeStampEvent:
-		/* Time stamp event.  */
-		break;
-	case kENET_TimeStampAvailEvent:
-		/* Time stamp available event.  */
-		break;
-#endif
+	struct device *dev = arg1;
+	struct eth_context *context = dev->driver_data;
+	int frames;
+
+	ARG_UNUSED(unused1);
+	ARG_UNUSED(unused2);
+
+	while (1) {
+		k_sem_take(&context->poll_sem, K_FOREVER);
+
+		do {
+			/* Frames that complete after this are seen
+			 * either by the poll below or by the interrupt
+			 * that is raised when the mask is cleared.
+			 */
+			ENET_ClearInterruptStatus(ENET,
+						  ETH_KSDK_POLL_INTERRUPTS);
+
+			eth_tx_reclaim(context);
+
+			frames = eth_rx(context, CONFIG_ETH_KSDK_RX_BUDGET);
+			if (frames == CONFIG_ETH_KSDK_RX_BUDGET) {
+				k_yield();
+			}
+		} while (frames == CONFIG_ETH_KSDK_RX_BUDGET);
+
+		ENET_EnableInterrupts(ENET, ETH_KSDK_POLL_INTERRUPTS);
 	}
 }
 
@@ -288,18 +461,23 @@ static int eth_0_init(struct device *dev)
 	enet_buffer_config_t buffer_config = {
 		.rxBdNumber = CONFIG_ETH_KSDK_RX_BUFFERS,
 		.txBdNumber = CONFIG_ETH_KSDK_TX_BUFFERS,
-		.rxBuffSizeAlign = ETH_KSDK_BUFFER_SIZE,
+		.rxBuffSizeAlign = ETH_KSDK_RX_FRAG_SIZE,
 		.txBuffSizeAlign = ETH_KSDK_BUFFER_SIZE,
 		.rxBdStartAddrAlign = rx_buffer_desc,
 		.txBdStartAddrAlign = tx_buffer_desc,
-		.rxBufferAlign = rx_buffer[0],
-		.txBufferAlign = tx_buffer[0],
+		/* KSDK lays the descriptors over one contiguous buffer
+		 * area, which this driver does not have. The RX
+		 * descriptors get their fragments in eth_0_iface_init()
+		 * and the TX descriptors get theirs in eth_tx(), so these
+		 * addresses are never used.
+		 */
+		.rxBufferAlign = (uint8_t *)rx_buffer_desc,
+		.txBufferAlign = (uint8_t *)tx_buffer_desc,
 	};
 
-	k_sem_init(&context->tx_buf_sem, 0, UINT_MAX);
-	for (int i = 0; i < CONFIG_ETH_KSDK_TX_BUFFERS; i++) {
-		k_sem_give(&context->tx_buf_sem);
-	}
+	k_sem_init(&context->poll_sem, 0, 1);
+	k_sem_init(&context->tx_sem, CONFIG_ETH_KSDK_TX_BUFFERS,
+		   CONFIG_ETH_KSDK_TX_BUFFERS);
 
 	sys_clock = CLOCK_GetFreq(kCLOCK_CoreSysClk);
 
@@ -307,6 +485,17 @@ static int eth_0_init(struct device *dev)
 	enet_config.interrupt |= kENET_RxFrameInterrupt;
 	enet_config.interrupt |= kENET_TxFrameInterrupt;
 
+#if defined(CONFIG_ETH_KSDK_HW_CHKSUM)
+	/* The checksum fields are left zero by the IP stack, which is
+	 * what the accelerator requires. Needs store and forward mode,
+	 * which is the KSDK default.
+	 */
+	enet_config.txAccelerConfig = kENET_TxAccelIpCheckEnabled |
+				      kENET_TxAccelProtoCheckEnabled;
+	enet_config.rxAccelerConfig = kENET_RxAccelIpCheckEnabled |
+				      kENET_RxAccelProtoCheckEnabled;
+#endif
+
 	status = PHY_Init(ENET, phy_addr, sys_clock);
 	if (status) {
 		SYS_LOG_ERR("PHY_Init() failed: %d", status);
@@ -345,9 +534,12 @@ static int eth_0_init(struct device *dev)
 		    context->mac_addr[2], context->mac_addr[3],
 		    context->mac_addr[4], context->mac_addr[5]);
 
-	ENET_SetCallback(&context->enet_handle, eth_callback, dev);
+	k_thread_spawn(context->thread_stack, ETH_KSDK_THREAD_STACK_SIZE,
+		       eth_ksdk_thread_main, (void *) dev, NULL, NULL,
+		       K_PRIO_COOP(CONFIG_ETH_KSDK_RX_THREAD_PRIO), 0,
+		       K_NO_WAIT);
+
 	eth_0_config_func();
-	ENET_ActiveRead(ENET);
 	return 0;
 }
 
@@ -355,31 +547,44 @@ static void eth_0_iface_init(struct net_if *iface)
 {
 	struct device *dev = net_if_get_device(iface);
 	struct eth_context *context = dev->driver_data;
+	int i;
 
 	net_if_set_link_addr(iface, context->mac_addr,
 			     sizeof(context->mac_addr));
 	context->iface = iface;
+
+	/* The network buffers are not available yet when the device
+	 * is initialized, so reception is started only here.
+	 */
+	for (i = 0; i < CONFIG_ETH_KSDK_RX_BUFFERS; i++) {
+		context->rx_frag[i] = rx_frag_get();
+		if (!context->rx_frag[i]) {
+			SYS_LOG_ERR("Cannot get RX fragments");
+			return;
+		}
+
+		rx_desc_arm(context, i);
+	}
+
+	ENET_ActiveRead(ENET);
 }
 
 static struct net_if_api api_funcs_0 = {
 	.init	= eth_0_iface_init,
 	.send	= eth_tx,
+#if defined(CONFIG_ETH_KSDK_HW_CHKSUM)
+	.offload = NET_IF_OFFLOAD_TX_CHKSUM | NET_IF_OFFLOAD_RX_CHKSUM,
+#endif
 };
 
-static void eth_ksdk_rx_isr(void *p)
-{
-	struct device *dev = p;
-	struct eth_context *context = dev->driver_data;
-
-	ENET_ReceiveIRQHandler(ENET, &context->enet_handle);
-}
-
-static void eth_ksdk_tx_isr(void *p)
+static void eth_ksdk_poll_isr(void *p)
 {
 	struct device *dev = p;
 	struct eth_context *context = dev->driver_data;
 
-	ENET_TransmitIRQHandler(ENET, &context->enet_handle);
+	/* The thread polls the rings until they are idle */
+	ENET_DisableInterrupts(ENET, ETH_KSDK_POLL_INTERRUPTS);
+	k_sem_give(&context->poll_sem);
 }
 
 static void eth_ksdk_error_isr(void *p)
@@ -417,11 +622,11 @@ NET_DEVICE_INIT(eth_ksdk_0, CONFIG_ETH_KSDK_0_NAME,
 static void eth_0_config_func(void)
 {
 	IRQ_CONNECT(IRQ_ETH_RX, CONFIG_ETH_KSDK_0_IRQ_PRI,
-		    eth_ksdk_rx_isr, DEVICE_GET(eth_ksdk_0), 0);
+		    eth_ksdk_poll_isr, DEVICE_GET(eth_ksdk_0), 0);
 	irq_enable(IRQ_ETH_RX);
 
 	IRQ_CONNECT(IRQ_ETH_TX, CONFIG_ETH_KSDK_0_IRQ_PRI,
-		    eth_ksdk_tx_isr, DEVICE_GET(eth_ksdk_0), 0);
+		    eth_ksdk_poll_isr, DEVICE_GET(eth_ksdk_0), 0);
 	irq_enable(IRQ_ETH_TX);
 
 	IRQ_CONNECT(IRQ_ETH_ERR_MISC, CONFIG_ETH_KSDK_0_IRQ_PRI,
@@ -37,37 +37,35 @@
 #include <net/net_if.h>
 #include <net/net_core.h>
 #include <console/uart_pipe.h>
+#include <drivers/slip.h>
 
-#define SLIP_END     0300
-#define SLIP_ESC     0333
-#define SLIP_ESC_END 0334
-#define SLIP_ESC_ESC 0335
-
-enum slip_state {
-	STATE_GARBAGE,
-	STATE_OK,
-	STATE_ESC,
-};
+/* Escaped data is sent to the UART in chunks of this size */
+#define SLIP_TX_CHUNK 64
 
 struct slip_context {
 	bool init_done;
-	uint8_t buf[1];		/* SLIP data is read into this buf */
+	uint8_t buf[CONFIG_SLIP_RX_BUF_SIZE];	/* SLIP data is read into
+						 * this buf
+						 */
 	struct net_buf *rx;	/* and then placed into this net_buf */
 	struct net_buf *last;	/* Pointer to last fragment in the list */
-	uint8_t *ptr;		/* Where in net_buf to add data */
-	uint8_t state;
+	struct slip_decoder decoder;
+#if defined(CONFIG_SLIP_CRC)
+	uint16_t fcs;		/* FCS of the data received so far */
+#endif
 
 	uint8_t mac_addr[6];
 	struct net_linkaddr ll_addr;
 
 #if defined(CONFIG_SLIP_STATISTICS)
-#define SLIP_STATS(statement)
-#else
 	uint16_t garbage;
 	uint16_t multi_packets;
 	uint16_t overflows;
 	uint16_t ip_drop;
+	uint16_t fcs_errors;
 #define SLIP_STATS(statement) statement
+#else
+#define SLIP_STATS(statement)
 #endif
 };
 
@@ -134,15 +132,38 @@ static inline void slip_writeb(unsigned char c)
 	uart_pipe_send(&buf[0], 1);
 }
 
+/* Escape and send data, the FCS of the frame is updated on the way */
+static uint16_t slip_write(uint16_t fcs, const uint8_t *data, size_t len)
+{
+	const uint8_t *end = data + len;
+	uint8_t chunk[SLIP_TX_CHUNK];
+
+#if defined(CONFIG_SLIP_CRC)
+	fcs = slip_fcs16(fcs, data, len);
+#endif
+
+	while (data < end) {
+		uint8_t *chunk_end;
+
+		chunk_end = slip_encode(chunk, chunk + sizeof(chunk),
+					&data, end);
+
+		uart_pipe_send(chunk, chunk_end - chunk);
+	}
+
+	return fcs;
+}
+
 static int slip_send(struct net_if *iface, struct net_buf *buf)
 {
 #if defined(CONFIG_SLIP_TAP)
 	uint16_t ll_reserve = net_nbuf_ll_reserve(buf);
 	bool send_header_once = false;
 #endif
-	uint8_t *ptr;
-	uint16_t i;
-	uint8_t c;
+	uint16_t fcs = SLIP_FCS_INIT;
+#if defined(CONFIG_SLIP_CRC)
+	uint8_t fcs_le[SLIP_FCS_LEN];
+#endif
 
 	if (!buf->frags) {
 		/* No data? */
@@ -158,13 +179,10 @@ static int slip_send(struct net_if *iface, struct net_buf *buf)
 #endif
 
 #if defined(CONFIG_SLIP_TAP)
-		ptr = frag->data - ll_reserve;
-
 		/* This writes ethernet header */
 		if (!send_header_once && ll_reserve) {
-			for (i = 0; i < ll_reserve; i++) {
-				slip_writeb(*ptr++);
-			}
+			fcs = slip_write(fcs, frag->data - ll_reserve,
+					 ll_reserve);
 		}
 
 		if (net_if_get_mtu(iface) > net_buf_headroom(frag)) {
@@ -174,30 +192,16 @@ static int slip_send(struct net_if *iface, struct net_buf *buf)
 			 */
 			send_header_once = true;
 			ll_reserve = 0;
-			ptr = frag->data;
 		}
-#else
-		/* There is no ll header in tun device */
-		ptr = frag->data;
 #endif
 
-		for (i = 0; i < frag->len; ++i) {
-			c = *ptr++;
-			if (c == SLIP_END) {
-				slip_writeb(SLIP_ESC);
-				c = SLIP_ESC_END;
-			} else if (c == SLIP_ESC) {
-				slip_writeb(SLIP_ESC);
-				c = SLIP_ESC_ESC;
-			}
-
-			slip_writeb(c);
-		}
+		/* There is no ll header in tun device */
+		fcs = slip_write(fcs, frag->data, frag->len);
 
 #if defined(CONFIG_SLIP_DEBUG)
 		SYS_LOG_DBG("sent data %d bytes",
 			    frag->len + net_nbuf_ll_reserve(buf));
-		if (frag->len + ll_reserve) {
+		if (frag->len + net_nbuf_ll_reserve(buf)) {
 			char msg[8 + 1];
 
 			snprintf(msg, sizeof(msg), "<slip %2d", frag_count++);
@@ -211,161 +215,205 @@ static int slip_send(struct net_if *iface, struct net_buf *buf)
 	}
 
 	net_nbuf_unref(buf);
+
+#if defined(CONFIG_SLIP_CRC)
+	/* The FCS is sent inverted, least significant byte first */
+	fcs ^= 0xffff;
+	fcs_le[0] = fcs;
+	fcs_le[1] = fcs >> 8;
+
+	slip_write(fcs, fcs_le, sizeof(fcs_le));
+#endif
+
 	slip_writeb(SLIP_END);
 
 	return 0;
 }
 
-static struct net_buf *slip_poll_handler(struct slip_context *slip)
+static void slip_rx_drop(struct slip_context *slip)
 {
-	if (slip->last && slip->last->len) {
-		return slip->rx;
+	if (slip->rx) {
+		net_nbuf_unref(slip->rx);
 	}
 
-	return NULL;
+	slip->rx = slip->last = NULL;
 }
 
-static void process_msg(struct slip_context *slip)
+/* Add a data fragment to the frame, the first one also gets the buffer
+ * that holds the fragments.
+ */
+static int slip_rx_alloc(struct slip_context *slip)
 {
-	struct net_buf *buf;
+	struct net_buf *frag;
 
-	buf = slip_poll_handler(slip);
-	if (!buf || !buf->frags) {
-		return;
+	if (!slip->rx) {
+		slip->rx = net_nbuf_get_reserve_rx(0);
+		if (!slip->rx) {
+			return -ENOMEM;
+		}
+
+#if defined(CONFIG_SLIP_CRC)
+		slip->fcs = SLIP_FCS_INIT;
+#endif
 	}
 
-	if (net_recv_data(net_if_get_by_link_addr(&slip->ll_addr), buf) < 0) {
-		net_nbuf_unref(buf);
+	frag = net_nbuf_get_reserve_data(0);
+	if (!frag) {
+		SYS_LOG_ERR("[%p] cannot allocate data fragment", slip);
+		slip_rx_drop(slip);
+		return -ENOMEM;
 	}
 
-	slip->rx = slip->last = NULL;
+	if (slip->last) {
+		net_buf_frag_insert(slip->last, frag);
+	} else {
+		net_buf_frag_add(slip->rx, frag);
+	}
+
+	slip->last = frag;
+
+	return 0;
 }
 
-static inline int slip_input_byte(struct slip_context *slip,
-				  unsigned char c)
+#if defined(CONFIG_SLIP_CRC)
+/* Check the FCS at the end of the frame and remove it */
+static bool slip_rx_check_fcs(struct slip_context *slip)
 {
-	switch (slip->state) {
-	case STATE_GARBAGE:
-		if (c == SLIP_END) {
-			slip->state = STATE_OK;
-		}
+	struct net_buf *frag = slip->rx->frags;
+	size_t len = net_buf_frags_len(frag);
 
-		return 0;
-	case STATE_ESC:
-		if (c == SLIP_ESC_END) {
-			c = SLIP_END;
-		} else if (c == SLIP_ESC_ESC) {
-			c = SLIP_ESC;
-		} else {
-			slip->state = STATE_GARBAGE;
-			SLIP_STATS(slip->garbage++);
-			return 0;
-		}
+	if (slip->fcs != SLIP_FCS_GOOD || len <= SLIP_FCS_LEN) {
+		SLIP_STATS(slip->fcs_errors++);
+		return false;
+	}
 
-		slip->state = STATE_OK;
+	len -= SLIP_FCS_LEN;
 
-		break;
-	case STATE_OK:
-		if (c == SLIP_ESC) {
-			slip->state = STATE_ESC;
-			return 0;
-		} else if (c == SLIP_END) {
-			slip->state = STATE_OK;
-			return 1;
-		}
+	while (frag->len < len) {
+		len -= frag->len;
+		frag = frag->frags;
+	}
+
+	frag->len = len;
 
-		break;
+	if (frag->frags) {
+		net_nbuf_unref(frag->frags);
+		frag->frags = NULL;
 	}
 
-	if (!slip->rx) {
-		slip->rx = net_nbuf_get_reserve_rx(0);
-		if (!slip->rx) {
-			return 0;
-		}
+	slip->last = frag;
 
-		slip->last = net_nbuf_get_reserve_data(0);
-		if (!slip->last) {
-			net_nbuf_unref(slip->rx);
-			slip->rx = NULL;
-			return 0;
-		}
+	return true;
+}
+#else
+#define slip_rx_check_fcs(slip) true
+#endif
+
+static void process_msg(struct slip_context *slip)
+{
+	struct net_buf *buf = slip->rx;
+
+	/* Empty frames just separate the frames */
+	if (!buf) {
+		return;
+	}
 
-		net_buf_frag_add(slip->rx, slip->last);
-		slip->ptr = net_nbuf_ip_data(slip->rx);
+	if (!slip_rx_check_fcs(slip)) {
+		slip_rx_drop(slip);
+		return;
 	}
 
-	if (!net_buf_tailroom(slip->last)) {
-		/* We need to allocate a new fragment */
-		struct net_buf *frag;
+#if defined(CONFIG_SLIP_DEBUG)
+	{
+		struct net_buf *frag = buf->frags;
+		int bytes = net_buf_frags_len(frag);
+		int count = 0;
+
+		while (bytes && frag) {
+			char msg[8 + 1];
+
+			snprintf(msg, sizeof(msg), ">slip %2d", count);
 
-		frag = net_nbuf_get_reserve_data(0);
-		if (!frag) {
-			SYS_LOG_ERR("[%p] cannot allocate data fragment",
-				    slip);
-			net_nbuf_unref(slip->rx);
-			slip->rx = NULL;
-			slip->last = NULL;
+			hexdump(msg, frag->data, frag->len, 0);
 
-			return 0;
+			frag = frag->frags;
+			count++;
 		}
 
-		net_buf_frag_insert(slip->last, frag);
-		slip->last = frag;
-		slip->ptr = slip->last->data;
+		SYS_LOG_DBG("[%p] received data %d bytes", slip, bytes);
 	}
+#endif
 
-	/* The net_buf_add_u8() cannot add data to ll header so we need
-	 * a way to do it.
-	 */
-	if (slip->ptr < slip->last->data) {
-		*slip->ptr = c;
-	} else {
-		slip->ptr = net_buf_add_u8(slip->last, c);
+	if (net_recv_data(net_if_get_by_link_addr(&slip->ll_addr), buf) < 0) {
+		SLIP_STATS(slip->ip_drop++);
+		net_nbuf_unref(buf);
 	}
 
-	slip->ptr++;
-
-	return 0;
+	slip->rx = slip->last = NULL;
 }
 
+/*
+ * Called by the pipe UART driver with everything it could read from the
+ * UART. The data is unescaped straight into the network buffers, and
+ * the buffers are allocated only when there is data to put in them.
+ */
 static uint8_t *recv_cb(uint8_t *buf, size_t *off)
 {
 	struct slip_context *slip =
 		CONTAINER_OF(buf, struct slip_context, buf);
-	int i;
+	const uint8_t *src = buf;
+	const uint8_t *end = buf + *off;
+
+	*off = 0;
 
 	if (!slip->init_done) {
-		*off = 0;
 		return buf;
 	}
 
-	for (i = 0; i < *off; i++) {
-		if (slip_input_byte(slip, buf[i])) {
-#if defined(CONFIG_SLIP_DEBUG)
-			struct net_buf *frag = slip->rx->frags;
-			int bytes = net_buf_frags_len(frag);
-			int count = 0;
+	while (src < end) {
+		enum slip_decode_status status;
+		uint8_t *dst = NULL;
+		uint8_t *dst_end = NULL;
+		uint8_t *start;
+
+		if (slip->last) {
+			dst = net_buf_tail(slip->last);
+			dst_end = dst + net_buf_tailroom(slip->last);
+		}
 
-			while (bytes && frag) {
-				char msg[8 + 1];
+		start = dst;
 
-				snprintf(msg, sizeof(msg), ">slip %2d", count);
+		status = slip_decode(&slip->decoder, &src, end,
+				     &dst, dst_end);
 
-				hexdump(msg, frag->data, frag->len, 0);
+		if (dst != start) {
+#if defined(CONFIG_SLIP_CRC)
+			slip->fcs = slip_fcs16(slip->fcs, start, dst - start);
+#endif
+			net_buf_add(slip->last, dst - start);
+		}
 
-				frag = frag->frags;
-				count++;
+		switch (status) {
+		case SLIP_DECODE_MORE:
+			break;
+		case SLIP_DECODE_FULL:
+			if (slip_rx_alloc(slip) < 0) {
+				/* Out of buffers, skip the rest of the frame */
+				SLIP_STATS(slip->overflows++);
+				slip->decoder.state = SLIP_DECODER_GARBAGE;
 			}
 
-			SYS_LOG_DBG("[%p] received data %d bytes", slip, bytes);
-#endif
+			break;
+		case SLIP_DECODE_END:
 			process_msg(slip);
 			break;
+		case SLIP_DECODE_ERROR:
+			SLIP_STATS(slip->garbage++);
+			slip_rx_drop(slip);
+			break;
 		}
 	}
 
-	*off = 0;
-
 	return buf;
 }
 
@@ -375,8 +423,9 @@ static int slip_init(struct device *dev)
 
 	SYS_LOG_DBG("[%p] dev %p", slip, dev);
 
-	slip->state = STATE_OK;
+	slip_decoder_init(&slip->decoder);
 	slip->rx = NULL;
+	slip->last = NULL;
 
 #if defined(CONFIG_SLIP_TAP) && defined(CONFIG_NET_IPV4)
 	SYS_LOG_DBG("ARP enabled");
@@ -0,0 +1,140 @@
+/** @file
+ *  @brief SLIP framing
+ *
+ *  Escaping and unescaping of SLIP (RFC 1055) frames a buffer at a time,
+ *  and the 16 bit frame check sequence of RFC 1662 for links that need to
+ *  detect corrupted frames.
+ */
+
+/*
+ * Copyright (c) 2016 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __DRIVERS_SLIP_H
+#define __DRIVERS_SLIP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SLIP_END     0300
+#define SLIP_ESC     0333
+#define SLIP_ESC_END 0334
+#define SLIP_ESC_ESC 0335
+
+/** Initial value of the frame check sequence */
+#define SLIP_FCS_INIT 0xffff
+/** Frame check sequence of a frame that ends with its own valid FCS */
+#define SLIP_FCS_GOOD 0xf0b8
+/** Length of the frame check sequence */
+#define SLIP_FCS_LEN  2
+
+/** State of the SLIP decoder */
+enum slip_decoder_state {
+	/** Skipping data until the next END */
+	SLIP_DECODER_GARBAGE,
+	/** Inside a frame */
+	SLIP_DECODER_OK,
+	/** The previous byte was ESC */
+	SLIP_DECODER_ESC,
+};
+
+/** Reason why slip_decode() returned */
+enum slip_decode_status {
+	/** All the input has been consumed */
+	SLIP_DECODE_MORE,
+	/** There is no room left in the output buffer */
+	SLIP_DECODE_FULL,
+	/** The frame ended, it is empty if nothing was decoded */
+	SLIP_DECODE_END,
+	/** Invalid escape, the rest of the frame will be skipped */
+	SLIP_DECODE_ERROR,
+};
+
+/** SLIP decoder, keeps the state between the chunks of input */
+struct slip_decoder {
+	enum slip_decoder_state state;
+};
+
+/**
+ * @brief Initialize a SLIP decoder.
+ *
+ * @param dec Decoder
+ */
+static inline void slip_decoder_init(struct slip_decoder *dec)
+{
+	dec->state = SLIP_DECODER_OK;
+}
+
+/**
+ * @brief Escape data for a SLIP frame.
+ *
+ * @details The data is escaped until the input ends or the output is
+ * full. The END bytes around the frame are not added.
+ *
+ * @param dst Output buffer
+ * @param dst_end End of the output buffer
+ * @param src Input, moved past the data that was escaped
+ * @param src_end End of the input
+ *
+ * @return End of the escaped data in the output buffer.
+ */
+uint8_t *slip_encode(uint8_t *dst, uint8_t *dst_end,
+		     const uint8_t **src, const uint8_t *src_end);
+
+/**
+ * @brief Unescape received SLIP data.
+ *
+ * @details The data is unescaped until the input ends, the output is
+ * full or the frame ends. The output buffer may be empty, the function
+ * then returns SLIP_DECODE_FULL when it has data to write, so the caller
+ * can allocate buffers only when they are needed.
+ *
+ * @param dec Decoder
+ * @param src Input, moved past the data that was consumed
+ * @param src_end End of the input
+ * @param dst Output buffer, moved past the unescaped data
+ * @param dst_end End of the output buffer
+ *
+ * @return Why the decoding stopped.
+ */
+enum slip_decode_status slip_decode(struct slip_decoder *dec,
+				    const uint8_t **src,
+				    const uint8_t *src_end,
+				    uint8_t **dst, uint8_t *dst_end);
+
+/**
+ * @brief Update the 16 bit frame check sequence of RFC 1662.
+ *
+ * @details The FCS starts from SLIP_FCS_INIT and it is sent inverted,
+ * least significant byte first. Over a frame that includes its FCS the
+ * result is SLIP_FCS_GOOD.
+ *
+ * @param fcs Current FCS
+ * @param data Data
+ * @param len Length of the data
+ *
+ * @return Updated FCS.
+ */
+uint16_t slip_fcs16(uint16_t fcs, const uint8_t *data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DRIVERS_SLIP_H */
@@ -181,4 +181,95 @@ int dns6_resolve_quick(struct net_context *ctx, struct in6_addr *address,
 			    dns_server, timeout);
 }
 
+#if defined(CONFIG_DNS_RESOLVER_ASYNC)
+/**
+ * @brief dns_addresses		Addresses of a name, returned by the
+ *				asynchronous resolver.
+ */
+struct dns_addresses {
+	struct in_addr ipv4[CONFIG_DNS_RESOLVER_CACHE_ADDRESSES];
+	struct in6_addr ipv6[CONFIG_DNS_RESOLVER_CACHE_ADDRESSES];
+	uint8_t ipv4_count;
+	uint8_t ipv6_count;
+};
+
+/**
+ * @brief dns_resolve_cb_t	Callback that gets the result of
+ *				dns_async_resolve.
+ * @param [in] status		0 if at least one address was found,
+ *				-ENOENT if the name has no addresses of the
+ *				requested families, -ETIMEDOUT if the server
+ *				did not answer, -EIO if the server reported an
+ *				error or -EINVAL if the answer was malformed.
+ * @param [in] addresses	Addresses found. They are valid only during
+ *				the callback.
+ * @param [in] user_data	User data given to dns_async_resolve.
+ */
+typedef void (*dns_resolve_cb_t)(int status,
+				 const struct dns_addresses *addresses,
+				 void *user_data);
+
+/**
+ * @brief dns_async_init	Asynchronous DNS resolver initialization
+ *				routine
+ * @details			The resolver sends its queries from 'ctx' and
+ *				receives the answers with a callback that is
+ *				set here, so the context must not be used for
+ *				anything else. The cache is emptied.
+ * @param [in] ctx		Previously initialized and bound UDP network
+ *				context.
+ * @param [in] dns_server	IP address and port number of the DNS server.
+ * @return			0 on success
+ * @return			-EINVAL if an invalid parameter was passed as
+ *				an argument to this routine.
+ * @return			Error code of net_context_recv otherwise.
+ */
+int dns_async_init(struct net_context *ctx, struct sockaddr *dns_server);
+
+/**
+ * @brief dns_async_resolve	Retrieves the addresses associated to the
+ *				domain name 'name' without blocking.
+ * @details			The answer comes from the cache if it is
+ *				there and has not expired. Then 'cb' is called
+ *				before this routine returns. Otherwise the
+ *				queries are sent, or the caller is added to
+ *				the lookup of the same name that is already
+ *				going on, and 'cb' is called later from the
+ *				network RX thread or from the system
+ *				workqueue.
+ * @param [in] name		C-string containing the Domain Name to resolve,
+ *				i.e. 'example.com'.
+ * @param [in] family		AF_INET for the A records, AF_INET6 for the
+ *				AAAA records or AF_UNSPEC for both. Both
+ *				queries are sent at the same time.
+ * @param [in] cb		Callback that gets the result.
+ * @param [in] user_data	User data given to the callback.
+ * @return			0 on success
+ * @return			-EINVAL if an invalid parameter was passed as
+ *				an argument to this routine, or if the name
+ *				is longer than CONFIG_DNS_RESOLVER_NAME_LEN.
+ * @return			-ENOMEM if all the cache entries or all the
+ *				CONFIG_DNS_RESOLVER_WAITERS are in use.
+ */
+int dns_async_resolve(const char *name, sa_family_t family,
+		      dns_resolve_cb_t cb, void *user_data);
+
+/**
+ * @brief dns_async_cancel	Cancels the pending lookups of a caller.
+ * @details			The callback is not called for them. The
+ *				queries are not stopped, the answers are still
+ *				cached.
+ * @param [in] cb		Callback given to dns_async_resolve.
+ * @param [in] user_data	User data given to dns_async_resolve.
+ */
+void dns_async_cancel(dns_resolve_cb_t cb, void *user_data);
+
+/**
+ * @brief dns_async_flush	Removes the cached answers.
+ * @details			The names that are being resolved stay in the
+ *				cache.
+ */
+void dns_async_flush(void);
+#endif /* CONFIG_DNS_RESOLVER_ASYNC */
+
 #endif
@@ -381,6 +381,14 @@ static inline void net_buf_simple_restore(struct net_buf_simple *buf,
   */
 #define NET_BUF_FRAGS        BIT(0)
 
+/** Flag indicating that the data pointer of the buffer does not point
+  * to the data storage of the buffer itself but to memory owned by
+  * someone else. Such a buffer has no headroom or tailroom and its data
+  * must not be modified, only pulled. The flag is cleared when the
+  * buffer is allocated again.
+  */
+#define NET_BUF_EXTERNAL_DATA BIT(1)
+
 /** @brief Network buffer representation.
   *
   * This struct is used to represent network buffers. Such buffers are
@@ -571,6 +579,19 @@ void net_buf_reserve(struct net_buf *buf, size_t reserve);
  */
 void net_buf_put(struct k_fifo *fifo, struct net_buf *buf);
 
+/**
+ *  @brief Put several buffers into a FIFO
+ *
+ *  Put the buffers to the end of a FIFO with a single FIFO operation so
+ *  that a thread waiting on the FIFO is woken up only once. Follow-up
+ *  fragments of the buffers are inserted as well.
+ *
+ *  @param fifo Which FIFO to put the buffers to.
+ *  @param bufs Array of buffers.
+ *  @param count Number of buffers in the array.
+ */
+void net_buf_put_list(struct k_fifo *fifo, struct net_buf **bufs, int count);
+
 /**
  *  @brief Decrements the reference count of a buffer.
  *
@@ -828,28 +849,42 @@ static inline void *net_buf_user_data(struct net_buf *buf)
 #define net_buf_pull_be32(buf) net_buf_simple_pull_be32(&(buf)->b)
 
 /**
- *  @def net_buf_tailroom
  *  @brief Check buffer tailroom.
  *
  *  Check how much free space there is at the end of the buffer.
+ *  A buffer with external data has no tailroom.
  *
  *  @param buf A valid pointer on a buffer
  *
  *  @return Number of bytes available at the end of the buffer.
  */
-#define net_buf_tailroom(buf) net_buf_simple_tailroom(&(buf)->b)
+static inline size_t net_buf_tailroom(struct net_buf *buf)
+{
+	if (buf->flags & NET_BUF_EXTERNAL_DATA) {
+		return 0;
+	}
+
+	return net_buf_simple_tailroom(&buf->b);
+}
 
 /**
- *  @def net_buf_headroom
  *  @brief Check buffer headroom.
  *
  *  Check how much free space there is in the beginning of the buffer.
+ *  A buffer with external data has no headroom.
  *
  *  buf A valid pointer on a buffer
  *
  *  @return Number of bytes available in the beginning of the buffer.
  */
-#define net_buf_headroom(buf) net_buf_simple_headroom(&(buf)->b)
+static inline size_t net_buf_headroom(struct net_buf *buf)
+{
+	if (buf->flags & NET_BUF_EXTERNAL_DATA) {
+		return 0;
+	}
+
+	return net_buf_simple_headroom(&buf->b);
+}
 
 /**
  *  @def net_buf_tail
@@ -23,6 +23,7 @@
 
 #include <misc/slist.h>
 #include <stdint.h>
+#include <net/net_ip.h>
 
 /** Current state of DHCPv4 client address negotiation */
 enum net_dhcpv4_state {
@@ -32,6 +33,19 @@ enum net_dhcpv4_state {
 	NET_DHCPV4_REQUEST,
 	NET_DHCPV4_RENEWAL,
 	NET_DHCPV4_ACK,
+	NET_DHCPV4_REBOOTING,
+};
+
+/** Lease of a DHCPv4 address, kept by the application across reboots */
+struct net_dhcpv4_lease {
+	/** Leased address */
+	struct in_addr addr;
+
+	/** Server that granted the lease */
+	struct in_addr server_id;
+
+	/** Lease time in seconds */
+	uint32_t lease_time;
 };
 
 /**
@@ -45,4 +59,44 @@ enum net_dhcpv4_state {
  */
 void net_dhcpv4_start(struct net_if *iface);
 
+/**
+ *  @brief Start DHCPv4 client with a lease from a previous boot
+ *
+ *  @details The client starts in the INIT-REBOOT state of RFC 2131 and
+ *  asks the server to confirm the leased address with a single REQUEST
+ *  instead of discovering a server first. If the server refuses the
+ *  address or does not reply, the client falls back to the full
+ *  negotiation as net_dhcpv4_start() does.
+ *
+ *  @param iface A valid pointer on an interface
+ *  @param lease Lease saved with net_dhcpv4_get_lease()
+ */
+void net_dhcpv4_start_with_lease(struct net_if *iface,
+				 const struct net_dhcpv4_lease *lease);
+
+/**
+ *  @brief Stop DHCPv4 client
+ *
+ *  @details The address is removed from the interface but it is not
+ *  released to the server, so it can be reused with
+ *  net_dhcpv4_start_with_lease().
+ *
+ *  @param iface A valid pointer on an interface
+ */
+void net_dhcpv4_stop(struct net_if *iface);
+
+/**
+ *  @brief Get the current lease of an interface
+ *
+ *  @details Once the address has been added to the interface, the lease
+ *  can be saved in flash or in any other storage that survives a reboot
+ *  and given to net_dhcpv4_start_with_lease() on the next boot.
+ *
+ *  @param iface A valid pointer on an interface
+ *  @param lease The lease is returned here
+ *
+ *  @return 0 if ok, -ENOENT if the interface has no lease.
+ */
+int net_dhcpv4_get_lease(struct net_if *iface, struct net_dhcpv4_lease *lease);
+
 #endif /* __DHCPV4_H */
@@ -80,6 +80,7 @@ struct net_nbuf {
 	uint8_t ip_hdr_len;	/* pre-filled in order to avoid func call */
 	uint8_t ext_len;	/* length of extension headers */
 	uint8_t ext_bitmap;
+	uint8_t priority;	/* enum net_priority, selects the TX queue */
 
 #if defined(CONFIG_NET_IPV6)
 	uint8_t ext_opt_len; /* IPv6 ND option length */
@@ -152,6 +153,17 @@ static inline void net_nbuf_set_family(struct net_buf *buf, uint8_t family)
 	((struct net_nbuf *)net_buf_user_data(buf))->family = family;
 }
 
+static inline uint8_t net_nbuf_priority(struct net_buf *buf)
+{
+	return ((struct net_nbuf *)net_buf_user_data(buf))->priority;
+}
+
+static inline void net_nbuf_set_priority(struct net_buf *buf,
+					 uint8_t priority)
+{
+	((struct net_nbuf *)net_buf_user_data(buf))->priority = priority;
+}
+
 static inline uint8_t net_nbuf_ip_hdr_len(struct net_buf *buf)
 {
 	return ((struct net_nbuf *) net_buf_user_data(buf))->ip_hdr_len;
@@ -665,6 +677,57 @@ static inline bool net_nbuf_append_be32(struct net_buf *buf, uint32_t data)
 	return net_nbuf_append(buf, sizeof(uint32_t), (uint8_t *)&value);
 }
 
+/**
+ * @typedef net_nbuf_ext_release_t
+ * @brief Callback used when the stack no longer needs external data
+ *
+ * @details The callback is called from the context that drops the last
+ * reference to the external data fragment, typically the TX thread of the
+ * network interface, so it must not block.
+ *
+ * @param data Pointer to the data that was given to net_nbuf_append_ext()
+ * @param user_data User data that was given to net_nbuf_append_ext()
+ */
+typedef void (*net_nbuf_ext_release_t)(const uint8_t *data,
+				       void *user_data);
+
+/**
+ * @brief Check if the fragment points to external data
+ *
+ * @param frag Network buffer fragment.
+ *
+ * @return True if the fragment data is owned by the application.
+ */
+static inline bool net_nbuf_is_ext(struct net_buf *frag)
+{
+	return !!(frag->flags & NET_BUF_EXTERNAL_DATA);
+}
+
+#if defined(CONFIG_NET_NBUF_EXT_DATA)
+/**
+ * @brief Append application owned data to fragment list without copying
+ *
+ * @details A fragment pointing to the data is added to the end of the
+ * fragment list. The data must stay valid and unmodified until the
+ * release callback is called. The stack never writes into external
+ * data, net_nbuf_write() and net_nbuf_insert() fail if they would
+ * need to. Data appended after this goes into a new data fragment.
+ *
+ * @param buf Network buffer fragment list.
+ * @param len Length of the data
+ * @param data Data to be added
+ * @param cb Callback called when the data is not needed any more, can be
+ *        NULL.
+ * @param user_data User data passed to the callback.
+ *
+ * @return True if the data was added, False otherwise. In case of false
+ *         the callback is not called.
+ */
+bool net_nbuf_append_ext(struct net_buf *buf, uint16_t len,
+			 const uint8_t *data, net_nbuf_ext_release_t cb,
+			 void *user_data);
+#endif /* CONFIG_NET_NBUF_EXT_DATA */
+
 /**
  * @brief Get data from buffer
  *
@@ -916,6 +979,144 @@ static inline bool net_nbuf_insert_be32(struct net_buf *buf,
 			       (uint8_t *)&value);
 }
 
+/**
+ * @brief Position in a fragment list for sequential access
+ *
+ * @details The cursor remembers the fragment and the offset where the
+ * previous access ended. Parsing or building a packet field by field
+ * with the cursor functions does not walk the fragment list from the
+ * beginning on every call, and whole fragments are copied at a time.
+ *
+ * The cursor is invalid after the fragment list is modified by other
+ * means than the cursor functions.
+ */
+struct net_nbuf_cursor {
+	/** Network buffer (RX/TX) that owns the fragments. Only needed
+	 * when writing, as new fragments are added to it.
+	 */
+	struct net_buf *buf;
+
+	/** Current fragment, NULL when the end of the list is reached */
+	struct net_buf *frag;
+
+	/** Offset in the current fragment */
+	uint16_t pos;
+
+	/** Set when a read went past the end of the data or a write
+	 * failed. All the following accesses fail.
+	 */
+	bool error;
+};
+
+/**
+ * @brief Initialize a cursor
+ *
+ * @details The offset is calculated from the start of the data in frag
+ * and it can point to a later fragment.
+ *
+ * @param cursor Cursor to initialize.
+ * @param buf Network buffer (RX/TX), can be NULL if the cursor is only
+ *        used for reading.
+ * @param frag Fragment where the offset is calculated from.
+ * @param offset Offset of the first byte to access.
+ */
+void net_nbuf_cursor_init(struct net_nbuf_cursor *cursor,
+			  struct net_buf *buf, struct net_buf *frag,
+			  uint16_t offset);
+
+/**
+ * @brief Read data and move the cursor forward
+ *
+ * @param cursor Cursor.
+ * @param len Number of bytes to read.
+ * @param data Data is copied here, if NULL the data is skipped.
+ *
+ * @return True if all the data was read, False if the end of the data
+ *         was reached.
+ */
+bool net_nbuf_cursor_read(struct net_nbuf_cursor *cursor, uint16_t len,
+			  uint8_t *data);
+
+/* Skip len bytes of data. */
+static inline bool net_nbuf_cursor_skip(struct net_nbuf_cursor *cursor,
+					uint16_t len)
+{
+	return net_nbuf_cursor_read(cursor, len, NULL);
+}
+
+/* Read one byte, the common case is handled without a function call. */
+static inline bool net_nbuf_cursor_read_u8(struct net_nbuf_cursor *cursor,
+					   uint8_t *value)
+{
+	if (cursor->frag && cursor->pos < cursor->frag->len &&
+	    !cursor->error) {
+		*value = cursor->frag->data[cursor->pos++];
+		return true;
+	}
+
+	return net_nbuf_cursor_read(cursor, sizeof(uint8_t), value);
+}
+
+/* Read 16 bit big endian value. */
+bool net_nbuf_cursor_read_be16(struct net_nbuf_cursor *cursor,
+			       uint16_t *value);
+
+/* Read 32 bit big endian value. */
+bool net_nbuf_cursor_read_be32(struct net_nbuf_cursor *cursor,
+			       uint32_t *value);
+
+/**
+ * @brief Check if the cursor is at the end of the data
+ *
+ * @param cursor Cursor.
+ *
+ * @return True if there is no more data to read, False otherwise.
+ */
+bool net_nbuf_cursor_is_end(struct net_nbuf_cursor *cursor);
+
+/**
+ * @brief Write data and move the cursor forward
+ *
+ * @details Existing data is overwritten and the fragment list is
+ * extended when needed, see net_nbuf_write(). The cursor must be
+ * initialized with the network buffer.
+ *
+ * @param cursor Cursor.
+ * @param len Number of bytes to write.
+ * @param data Data to write.
+ *
+ * @return True if the data was written, False otherwise.
+ */
+bool net_nbuf_cursor_write(struct net_nbuf_cursor *cursor, uint16_t len,
+			   uint8_t *data);
+
+/* Write uint8_t data. */
+static inline bool net_nbuf_cursor_write_u8(struct net_nbuf_cursor *cursor,
+					    uint8_t data)
+{
+	return net_nbuf_cursor_write(cursor, sizeof(uint8_t), &data);
+}
+
+/* Write uint16_t big endian value. */
+static inline bool net_nbuf_cursor_write_be16(struct net_nbuf_cursor *cursor,
+					      uint16_t data)
+{
+	uint16_t value = htons(data);
+
+	return net_nbuf_cursor_write(cursor, sizeof(uint16_t),
+				     (uint8_t *)&value);
+}
+
+/* Write uint32_t big endian value. */
+static inline bool net_nbuf_cursor_write_be32(struct net_nbuf_cursor *cursor,
+					      uint32_t data)
+{
+	uint32_t value = htonl(data);
+
+	return net_nbuf_cursor_write(cursor, sizeof(uint32_t),
+				     (uint8_t *)&value);
+}
+
 /**
  * @brief Get information about available free buffer count in
  * various network buffer pools. The amount of free buffers is
@@ -931,6 +1132,23 @@ static inline bool net_nbuf_insert_be32(struct net_buf *buf,
 void net_nbuf_get_info(size_t *tx_size, size_t *rx_size, size_t *data_size,
 		       int *tx, int *rx, int *data);
 
+#if defined(CONFIG_NET_NBUF_WATERMARK)
+/**
+ * @brief Get the most buffers that have been in use at the same time
+ * in each pool, since boot or since net_nbuf_reset_watermarks().
+ *
+ * @param tx Peak number of TX buffers in use. Value is returned.
+ * @param rx Peak number of RX buffers in use. Value is returned.
+ * @param data Peak number of DATA buffers in use. Value is returned.
+ */
+void net_nbuf_get_watermarks(int *tx, int *rx, int *data);
+
+/**
+ * @brief Restart tracking the peaks from the buffers in use now.
+ */
+void net_nbuf_reset_watermarks(void);
+#endif /* CONFIG_NET_NBUF_WATERMARK */
+
 #if defined(CONFIG_NET_DEBUG_NET_BUF)
 /**
  * @brief Debug helper to print out the buffer allocations
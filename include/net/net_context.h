@@ -77,7 +77,9 @@ struct net_context;
  * as soon as it has finished working with it.
  * @param status Value is set to 0 if some data is received, <0 if
  * there was an error receiving data, in this case the buf parameter is
- * set to NULL.
+ * set to NULL. If both buf is NULL and status is 0, the peer has closed
+ * the TCP connection. The stack releases the context itself when the
+ * close handshake finishes, so it must not be used after this.
  * @param user_data The user data given in net_recv() call.
  */
 typedef void (*net_context_recv_cb_t)(struct net_context *context,
@@ -122,6 +124,18 @@ typedef void (*net_context_accept_cb_t)(struct net_context *new_context,
 					int status,
 					void *user_data);
 
+/**
+ * @brief Connection callback.
+ *
+ * @details The connect callback is called after a connection is being
+ * established.
+ *
+ * @param context The context to use.
+ * @param user_data The user data given in net_context_connect() call.
+ */
+typedef void (*net_context_connect_cb_t)(struct net_context *context,
+					 void *user_data);
+
 struct net_tcp;
 
 struct net_conn_handle;
@@ -171,6 +185,9 @@ struct net_context {
 	/** Flags for the context */
 	uint8_t flags;
 
+	/** Priority of the packets sent, see enum net_priority */
+	uint8_t priority;
+
 #if defined(CONFIG_NET_TCP)
 	/** TCP connection information */
 	struct net_tcp *tcp;
@@ -179,7 +196,20 @@ struct net_context {
 	 * established.
 	 */
 	net_context_accept_cb_t accept_cb;
+
+	/** Connect callback to be called when the SYN-ACK of the peer has
+	 * been received.
+	 */
+	net_context_connect_cb_t connect_cb;
 #endif /* CONFIG_NET_TCP */
+
+#if defined(CONFIG_NET_NBUF_QUOTA)
+	/** Buffers held by the packets of this context. This is not
+	 * cleared when the context is released as the buffers may still
+	 * be in use.
+	 */
+	struct net_nbuf_quota nbuf_quota;
+#endif /* CONFIG_NET_NBUF_QUOTA */
 };
 
 static inline bool net_context_is_used(struct net_context *context)
@@ -223,6 +253,7 @@ static inline void net_context_set_state(struct net_context *context,
 {
 	NET_ASSERT(context);
 
+	context->flags &= ~(NET_CONTEXT_STATE_MASK << NET_CONTEXT_STATE_SHIFT);
 	context->flags |= ((state & NET_CONTEXT_STATE_MASK) <<
 			   NET_CONTEXT_STATE_SHIFT);
 }
@@ -392,6 +423,61 @@ static inline void net_context_set_iface(struct net_context *context,
 	context->iface = net_if_get_by_iface(iface);
 }
 
+/**
+ * @brief Set the priority of the packets sent by this context.
+ *
+ * @details The priority selects the TX queue of the network interface
+ * and is also written to the traffic class of IPv6 and the type of
+ * service field of IPv4 packets as a class selector code point.
+ * The priority is NET_PRIORITY_BE when the context is allocated.
+ *
+ * @param context Network context.
+ * @param priority Priority of the packets, see enum net_priority.
+ */
+static inline void net_context_set_priority(struct net_context *context,
+					    enum net_priority priority)
+{
+	NET_ASSERT(context);
+
+	context->priority = priority;
+}
+
+/**
+ * @brief Get the priority of the packets sent by this context.
+ *
+ * @param context Network context.
+ *
+ * @return Priority of the packets, see enum net_priority.
+ */
+static inline
+enum net_priority net_context_get_priority(struct net_context *context)
+{
+	NET_ASSERT(context);
+
+	return context->priority;
+}
+
+#if defined(CONFIG_NET_NBUF_QUOTA)
+/**
+ * @brief Set how many network buffers this context may hold.
+ *
+ * @details The context is given CONFIG_NET_NBUF_CONTEXT_QUOTA buffers
+ * when it is allocated. Packets that would take the context over its
+ * quota are dropped when received and net_context_send() returns
+ * -ENOBUFS for them.
+ *
+ * @param context Network context.
+ * @param limit Maximum number of buffers, 0 means no limit.
+ */
+static inline void net_context_set_nbuf_quota(struct net_context *context,
+					      uint16_t limit)
+{
+	NET_ASSERT(context);
+
+	context->nbuf_quota.limit = limit;
+}
+#endif /* CONFIG_NET_NBUF_QUOTA */
+
 /**
  * @brief Get network context.
  *
@@ -453,18 +539,6 @@ int net_context_bind(struct net_context *context,
 int net_context_listen(struct net_context *context,
 		       int backlog);
 
-/**
- * @brief Connection callback.
- *
- * @details The connect callback is called after a connection is being
- * established.
- *
- * @param context The context to use.
- * @param user_data The user data given in net_context_connect() call.
- */
-typedef void (*net_context_connect_cb_t)(struct net_context *context,
-					 void *user_data);
-
 /**
  * @brief            Create a network connection.
  *
@@ -491,6 +565,7 @@ typedef void (*net_context_connect_cb_t)(struct net_context *context,
  * @return           0 on success.
  * @return           -EINVAL if an invalid parameter is passed as an argument.
  * @return           -ENOTSUP if the operation is not supported or implemented.
+ * @return           -ETIMEDOUT if the connection was not established in time.
  */
 int net_context_connect(struct net_context *context,
 			const struct sockaddr *addr,
@@ -81,6 +81,23 @@ enum net_verdict {
 /* Called by lower network stack when a network packet has been received */
 int net_recv_data(struct net_if *iface, struct net_buf *buf);
 
+/**
+ * @brief Pass several received network packets to the IP stack.
+ *
+ * @details The packets are queued with one queue operation, so the RX
+ * thread is woken up only once. The packets are processed in the given
+ * order. Packets that were not queued, either because the RX queue is
+ * full, the packet has no data or the interface is over its buffer quota,
+ * are still owned by the caller.
+ *
+ * @param iface Network interface the packets were received from
+ * @param bufs Array of received packets
+ * @param count Number of packets in the array
+ *
+ * @return Number of packets queued, the first ones of the array.
+ */
+int net_recv_data_list(struct net_if *iface, struct net_buf **bufs, int count);
+
 /**
  * @brief Send data to network.
  *
@@ -80,4 +80,30 @@ enum net_event_ipv4_cmd {
 #define NET_EVENT_IPV4_ROUTER_ADD				\
 	(_NET_EVENT_IPV4_BASE |	NET_EVENT_IPV4_CMD_ROUTER_ADD)
 
+/* Network buffer events */
+#define _NET_NBUF_LAYER		NET_MGMT_LAYER_L3
+#define _NET_NBUF_CORE_CODE	0x100
+#define _NET_EVENT_NBUF_BASE	(NET_MGMT_EVENT_BIT |			\
+				 NET_MGMT_IFACE_BIT |			\
+				 NET_MGMT_LAYER(_NET_NBUF_LAYER) |	\
+				 NET_MGMT_LAYER_CODE(_NET_NBUF_CORE_CODE))
+
+enum net_event_nbuf_cmd {
+	NET_EVENT_NBUF_CMD_QUOTA = 0,
+	NET_EVENT_NBUF_CMD_RESERVE,
+	NET_EVENT_NBUF_CMD_EMPTY,
+};
+
+/* A context or an interface hit its buffer quota */
+#define NET_EVENT_NBUF_QUOTA					\
+	(_NET_EVENT_NBUF_BASE | NET_EVENT_NBUF_CMD_QUOTA)
+
+/* Only the reserved buffers are left in a pool */
+#define NET_EVENT_NBUF_RESERVE					\
+	(_NET_EVENT_NBUF_BASE | NET_EVENT_NBUF_CMD_RESERVE)
+
+/* A buffer pool ran out of buffers, the interface is not known */
+#define NET_EVENT_NBUF_EMPTY					\
+	(_NET_EVENT_NBUF_BASE | NET_EVENT_NBUF_CMD_EMPTY)
+
 #endif /* __NET_EVENT_H__ */
@@ -23,13 +23,16 @@
 #define __NET_IF_H__
 
 #include <device.h>
+#include <atomic.h>
 #include <misc/slist.h>
+#include <misc/util.h>
 
 #include <net/net_core.h>
 #include <net/buf.h>
 #include <net/net_linkaddr.h>
 #include <net/net_ip.h>
 #include <net/net_l2.h>
+#include <net/net_stats.h>
 
 #if defined(CONFIG_NET_DHCPV4)
 #include <net/dhcpv4.h>
@@ -134,6 +137,58 @@ struct net_if_router {
 	struct k_delayed_work lifetime;
 };
 
+/**
+ * @brief Network interface offload capabilities
+ *
+ * Tells which parts of packet processing the network device does in
+ * hardware, so that the IP stack can skip doing them in software.
+ */
+enum net_if_offload {
+	/** IPv4 header checksum is calculated by the device */
+	NET_IF_OFFLOAD_TX_CHKSUM_IPV4	= BIT(0),
+
+	/** UDP checksum is calculated by the device */
+	NET_IF_OFFLOAD_TX_CHKSUM_UDP	= BIT(1),
+
+	/** TCP checksum is calculated by the device */
+	NET_IF_OFFLOAD_TX_CHKSUM_TCP	= BIT(2),
+
+	/** ICMPv4 and ICMPv6 checksums are calculated by the device */
+	NET_IF_OFFLOAD_TX_CHKSUM_ICMP	= BIT(3),
+
+	/** The device verifies IP, UDP and TCP checksums of received
+	 * packets and drops the invalid ones.
+	 */
+	NET_IF_OFFLOAD_RX_CHKSUM	= BIT(4),
+
+	/** The device can split TCP segments larger than the MTU */
+	NET_IF_OFFLOAD_TX_SEGMENTATION	= BIT(5),
+
+	/** The device inserts and strips VLAN tags */
+	NET_IF_OFFLOAD_VLAN		= BIT(6),
+};
+
+#define NET_IF_OFFLOAD_TX_CHKSUM (NET_IF_OFFLOAD_TX_CHKSUM_IPV4 |	\
+				  NET_IF_OFFLOAD_TX_CHKSUM_UDP |	\
+				  NET_IF_OFFLOAD_TX_CHKSUM_TCP |	\
+				  NET_IF_OFFLOAD_TX_CHKSUM_ICMP)
+
+#if defined(CONFIG_NET_NBUF_QUOTA)
+/**
+ * @brief Network buffers charged to a network context or interface
+ */
+struct net_nbuf_quota {
+	/** Number of buffers charged */
+	uint16_t used;
+
+	/** Maximum number of buffers, 0 means no limit */
+	uint16_t limit;
+
+	/** The limit has been hit and an event has been sent */
+	bool exceeded;
+};
+#endif /* CONFIG_NET_NBUF_QUOTA */
+
 /*
  * Special alignment is needed for net_if which is stored in
  * a net_if linker section if there are more than one network
@@ -185,8 +240,25 @@ struct net_if {
 	 */
 	bool offload_ip;
 
-	/** Queue for outgoing packets from apps */
-	struct k_fifo tx_queue;
+	/** Offload capabilities of the device, see enum net_if_offload.
+	 * Copied from the device API when the interface is initialized.
+	 */
+	uint16_t offload;
+
+#define NET_TC_TX_COUNT CONFIG_NET_TC_TX_COUNT
+
+	/** Queues for outgoing packets, one per traffic class. The
+	 * highest traffic class is sent first.
+	 */
+	struct k_fifo tx_queue[NET_TC_TX_COUNT];
+
+	/** Number of packets waiting in each TX queue */
+	atomic_t tx_pending[NET_TC_TX_COUNT];
+
+#if NET_TC_TX_COUNT > 1
+	/** Given for each queued packet, the TX thread waits on this */
+	struct k_sem tx_sem;
+#endif
 
 	/** Stack for the TX thread tied to this interface */
 #ifndef CONFIG_NET_TX_STACK_SIZE
@@ -194,6 +266,37 @@ struct net_if {
 #endif
 	NET_STACK_DEFINE_EMBEDDED(tx_stack, CONFIG_NET_TX_STACK_SIZE);
 
+#if defined(CONFIG_NET_STATISTICS)
+#if defined(CONFIG_NET_RX_QUEUE_PER_IFACE)
+	/** RX queue statistics of this interface */
+	struct net_stats_rx_queue rx_stats;
+#endif
+
+	/** Statistics of the TX queues of this interface */
+	struct net_stats_tx_queue tx_stats[NET_TC_TX_COUNT];
+#endif
+
+#if defined(CONFIG_NET_NBUF_QUOTA)
+	/** Buffers held by received packets not yet passed to a context */
+	struct net_nbuf_quota nbuf_quota;
+#endif
+
+#if defined(CONFIG_NET_RX_QUEUE_PER_IFACE)
+	/** Queue for incoming packets from the device driver */
+	struct k_fifo rx_queue;
+
+	/** Number of received packets waiting in the RX queue */
+	atomic_t rx_pending;
+
+	/** RX thread tied to this interface */
+	k_tid_t rx_tid;
+
+	/** Stack for the RX thread tied to this interface */
+#define NET_IF_RX_STACK_SIZE (CONFIG_NET_RX_STACK_SIZE + \
+			      CONFIG_NET_RX_STACK_RPL)
+	NET_STACK_DEFINE_EMBEDDED(rx_stack, NET_IF_RX_STACK_SIZE);
+#endif /* CONFIG_NET_RX_QUEUE_PER_IFACE */
+
 #if defined(CONFIG_NET_IPV6)
 #define NET_IF_MAX_IPV6_ADDR CONFIG_NET_IF_UNICAST_IPV6_ADDR_COUNT
 #define NET_IF_MAX_IPV6_MADDR CONFIG_NET_IF_MCAST_IPV6_ADDR_COUNT
@@ -276,7 +379,7 @@ struct net_if {
 		 */
 		enum net_dhcpv4_state state;
 
-		/** Number of attempts made for REQUEST and RENEWAL messages */
+		/** Number of messages sent in the current state */
 		uint8_t attempts;
 	} dhcpv4;
 
@@ -350,16 +453,26 @@ static inline struct device *net_if_get_device(struct net_if *iface)
 	return iface->dev;
 }
 
+/**
+ * @brief Map a packet priority to a TX traffic class
+ *
+ * @param priority Packet priority, see enum net_priority
+ *
+ * @return Traffic class from 0 to NET_TC_TX_COUNT - 1, the highest
+ * class is sent first.
+ */
+uint8_t net_tx_priority2tc(uint8_t priority);
+
 /**
  * @brief Queue a packet into net if's TX queue
  *
+ * @details The queue is selected by the priority of the packet. If the
+ * queue is full, the packet is dropped and the sender is notified.
+ *
  * @param iface Pointer to a network interface structure
  * @param buf Pointer on a net buffer to queue
  */
-static inline void net_if_queue_tx(struct net_if *iface, struct net_buf *buf)
-{
-	net_buf_put(&iface->tx_queue, buf);
-}
+void net_if_queue_tx(struct net_if *iface, struct net_buf *buf);
 
 /**
  * @brief Return the IP offload status.
@@ -373,6 +486,48 @@ static inline bool net_if_is_ip_offloaded(struct net_if *iface)
 	return iface->offload_ip;
 }
 
+/**
+ * @brief Check network interface offload capabilities.
+ *
+ * @param iface Network interface
+ * @param caps Bitmask of enum net_if_offload values
+ *
+ * @return True if the device supports all the given capabilities,
+ * false otherwise.
+ */
+static inline bool net_if_has_offload(struct net_if *iface, uint16_t caps)
+{
+	return (iface->offload & caps) == caps;
+}
+
+#if defined(CONFIG_NET_RX_QUEUE_PER_IFACE)
+/**
+ * @brief Set the priority of the RX thread of a network interface
+ *
+ * @details The RX threads are started with CONFIG_NET_RX_THREAD_PRIO
+ * cooperative priority when the network stack is initialized.
+ *
+ * @param iface Pointer to a network interface structure
+ * @param prio Thread priority, see K_PRIO_COOP() and K_PRIO_PREEMPT()
+ */
+void net_if_set_rx_prio(struct net_if *iface, int prio);
+#endif
+
+#if defined(CONFIG_NET_NBUF_QUOTA)
+/**
+ * @brief Set how many network buffers the received packets of an
+ * interface may hold
+ *
+ * @param iface Pointer to a network interface structure
+ * @param limit Maximum number of buffers, 0 means no limit
+ */
+static inline void net_if_set_nbuf_quota(struct net_if *iface,
+					 uint16_t limit)
+{
+	iface->nbuf_quota.limit = limit;
+}
+#endif
+
 /**
  * @brief Get an network interface's link address
  *
@@ -1091,6 +1246,9 @@ void net_if_foreach(net_if_cb_t cb, void *user_data);
 struct net_if_api {
 	void (*init)(struct net_if *iface);
 	int (*send)(struct net_if *iface, struct net_buf *buf);
+
+	/** Offload capabilities, bitmask of enum net_if_offload */
+	uint16_t offload;
 };
 
 #define NET_IF_GET_NAME(dev_name, sfx) (__net_if_##dev_name##_##sfx)
@@ -1110,7 +1268,20 @@ struct net_if_api {
 			    CONFIG_NET_TX_STACK_SIZE,			\
 			    CONFIG_NET_TX_STACK_SIZE,			\
 			    NET_IF_GET(dev_name, sfx)->tx_stack,	\
+			    sfx);					\
+	NET_IF_RX_STACK_INFO(dev_name, sfx)
+
+#if defined(CONFIG_NET_RX_QUEUE_PER_IFACE)
+#define NET_IF_RX_STACK_INFO(dev_name, sfx)				\
+	NET_STACK_INFO_ADDR(RX,						\
+			    dev_name,					\
+			    CONFIG_NET_RX_STACK_SIZE,			\
+			    NET_IF_RX_STACK_SIZE,			\
+			    NET_IF_GET(dev_name, sfx)->rx_stack,	\
 			    sfx)
+#else
+#define NET_IF_RX_STACK_INFO(dev_name, sfx)
+#endif
 
 
 /* Network device initialization macros */
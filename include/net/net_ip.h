@@ -59,6 +59,22 @@ enum net_sock_type {
 	SOCK_STREAM,
 };
 
+/** Packet priority, the same values as in IEEE 802.1Q. Note that
+ * background traffic has lower priority than best effort.
+ */
+enum net_priority {
+	NET_PRIORITY_BK = 1, /**< Background (lowest) */
+	NET_PRIORITY_BE = 0, /**< Best effort (default) */
+	NET_PRIORITY_EE = 2, /**< Excellent effort */
+	NET_PRIORITY_CA = 3, /**< Critical applications */
+	NET_PRIORITY_VI = 4, /**< Video, less than 100 ms latency */
+	NET_PRIORITY_VO = 5, /**< Voice, less than 10 ms latency */
+	NET_PRIORITY_IC = 6, /**< Internetwork control */
+	NET_PRIORITY_NC = 7, /**< Network control (highest) */
+};
+
+#define NET_MAX_PRIORITIES 8
+
 #define ntohs(x) sys_be16_to_cpu(x)
 #define ntohl(x) sys_be32_to_cpu(x)
 #define htons(x) sys_cpu_to_be16(x)
@@ -160,6 +160,122 @@ void net_mgmt_add_event_callback(struct net_mgmt_event_callback *cb);
  */
 void net_mgmt_del_event_callback(struct net_mgmt_event_callback *cb);
 
+/**
+ * @brief A network event stored in an event queue
+ */
+struct net_mgmt_event_entry {
+	/** The network event */
+	uint32_t event;
+
+	/** The iface the event belongs to, NULL if it is not an iface event
+	 */
+	struct net_if *iface;
+};
+
+/**
+ * @brief Network Management event queue structure
+ * Used to read network events from the owner's own thread. Each queue
+ * receives its own copy of the events matching its mask, directly when
+ * they are notified, so a slow reader does not make the others lose
+ * events.
+ */
+struct net_mgmt_event_queue {
+	/** Meant to be used internally, to insert the queue into a list.
+	 * So nobody should mess with it.
+	 */
+	sys_snode_t node;
+
+	/** Counts the queued events */
+	struct k_sem sem;
+
+	/** Storage of the queued events, provided by the owner */
+	struct net_mgmt_event_entry *events;
+
+	/** A mask of network events to queue, with the same meaning as in
+	 * struct net_mgmt_event_callback.
+	 */
+	uint32_t event_mask;
+
+	/** Number of events lost because the queue was full. The oldest
+	 * event is dropped to make room for the new one. The owner can
+	 * read and clear this at will.
+	 */
+	uint32_t overflows;
+
+	/** Number of entries in the storage */
+	uint16_t size;
+
+	/** Index of the oldest queued event */
+	uint16_t head;
+
+	/** Number of queued events */
+	uint16_t count;
+};
+
+/**
+ * @brief Helper to initialize a struct net_mgmt_event_queue properly
+ * @param queue A valid application's queue structure pointer.
+ * @param events Storage for the queued events, nothing is allocated.
+ * @param size Number of entries in events.
+ * @param mgmt_event_mask A mask of relevant events for the queue
+ */
+static inline
+void net_mgmt_init_event_queue(struct net_mgmt_event_queue *queue,
+			       struct net_mgmt_event_entry *events,
+			       uint16_t size, uint32_t mgmt_event_mask)
+{
+	__ASSERT(queue, "Queue pointer should not be NULL");
+	__ASSERT(events && size, "Queue storage should not be empty");
+
+	k_sem_init(&queue->sem, 0, size);
+
+	queue->events = events;
+	queue->event_mask = mgmt_event_mask;
+	queue->overflows = 0;
+	queue->size = size;
+	queue->head = 0;
+	queue->count = 0;
+}
+
+/**
+ * @brief Add a user event queue
+ * @param queue A valid pointer on user's queue to add. Its event mask
+ *        must not be changed while it is added.
+ */
+void net_mgmt_add_event_queue(struct net_mgmt_event_queue *queue);
+
+/**
+ * @brief Delete a user event queue
+ * @param queue A valid pointer on user's queue to delete.
+ */
+void net_mgmt_del_event_queue(struct net_mgmt_event_queue *queue);
+
+/**
+ * @brief Take the oldest event from an event queue
+ * @param queue A valid pointer on user's queue.
+ * @param mgmt_event The event is returned here, if not NULL.
+ * @param iface The iface of the event is returned here, if not NULL.
+ * @param timeout How long to wait for an event, K_NO_WAIT or K_FOREVER
+ *        can be used too.
+ * @return 0 if an event was taken, -EBUSY if there was none and
+ *         timeout was K_NO_WAIT, -EAGAIN if the wait timed out.
+ */
+int net_mgmt_event_queue_get(struct net_mgmt_event_queue *queue,
+			     uint32_t *mgmt_event, struct net_if **iface,
+			     int32_t timeout);
+
+/**
+ * @brief Wait for one network event
+ * Events notified before the call are not returned.
+ * @param mgmt_event_mask A mask of relevant events to wait for.
+ * @param mgmt_event The event is returned here, if not NULL.
+ * @param iface The iface of the event is returned here, if not NULL.
+ * @param timeout How long to wait for the event.
+ * @return 0 if an event was received, -EBUSY or -EAGAIN otherwise.
+ */
+int net_mgmt_event_wait(uint32_t mgmt_event_mask, uint32_t *mgmt_event,
+			struct net_if **iface, int32_t timeout);
+
 #ifdef CONFIG_NET_MGMT_EVENT
 /**
  * @brief Used by the system to notify an event.
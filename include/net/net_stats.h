@@ -133,12 +133,47 @@ struct net_stats_udp {
 	net_stats_t chkerr;
 };
 
+struct net_stats_offload {
+	/** Number of checksums left to the network device on transmit. */
+	net_stats_t tx_chksum;
+
+	/** Number of checksums calculated in software on transmit. */
+	net_stats_t tx_sw_chksum;
+
+	/** Number of received packets with checksums verified by the
+	 * network device.
+	 */
+	net_stats_t rx_chksum;
+};
+
 struct net_stats_ipv6_nd {
 	net_stats_t drop;
 	net_stats_t recv;
 	net_stats_t sent;
 };
 
+struct net_stats_ipv6_nbr {
+	/** Number of neighbor cache lookups. */
+	net_stats_t lookup;
+
+	/** Number of lookups that did not find the neighbor. */
+	net_stats_t miss;
+
+	/** Number of neighbors added to the cache. */
+	net_stats_t add;
+
+	/** Number of neighbors removed from the cache. */
+	net_stats_t remove;
+
+	/** Number of times a neighbor could not be added as the cache
+	 * was full.
+	 */
+	net_stats_t full;
+
+	/** Number of unicast reachability probes sent. */
+	net_stats_t probe;
+};
+
 struct net_stats_rpl_dis {
 	/** Number of received DIS packets. */
 	net_stats_t recv;
@@ -189,6 +224,56 @@ struct net_stats_rpl_dao_ack {
 	net_stats_t drop;
 };
 
+struct net_stats_rx_queue {
+	/** Number of packets put to the RX queue. */
+	net_stats_t queued;
+
+	/** Number of packets dropped because the RX queue was full. */
+	net_stats_t drop;
+
+	/** Highest number of packets waiting in the RX queue. */
+	net_stats_t max_depth;
+};
+
+struct net_stats_tx_queue {
+	/** Number of packets put to the TX queue. */
+	net_stats_t queued;
+
+	/** Number of packets dropped because the TX queue was full. */
+	net_stats_t drop;
+
+	/** Highest number of packets waiting in the TX queue. */
+	net_stats_t max_depth;
+};
+
+struct net_stats_ieee802154_reass {
+	/** Number of received 802.15.4 fragments. */
+	net_stats_t recv;
+
+	/** Number of reassembled datagrams. */
+	net_stats_t reassembled;
+
+	/** Number of datagrams dropped because of reassembly timeout. */
+	net_stats_t timeout;
+
+	/** Number of fragments dropped because the cache was full. */
+	net_stats_t full;
+
+	/** Number of duplicate fragments dropped. */
+	net_stats_t duplicate;
+
+	/** Number of datagrams dropped because of overlapping fragments. */
+	net_stats_t overlap;
+
+	/** Number of fragments dropped because of invalid offset or size. */
+	net_stats_t invalid;
+
+	/** Number of first fragments whose headers could not be
+	 * uncompressed.
+	 */
+	net_stats_t uncompress;
+};
+
 struct net_stats {
 	net_stats_t processing_error;
 
@@ -210,6 +295,19 @@ struct net_stats {
 
 	struct net_stats_icmp icmp;
 
+	struct net_stats_offload offload;
+
+#if !defined(CONFIG_NET_RX_QUEUE_PER_IFACE)
+	/** The RX queue shared by all the interfaces. Per interface
+	 * RX queues are counted in struct net_if.
+	 */
+	struct net_stats_rx_queue rx_queue;
+#endif
+
+#if defined(CONFIG_NET_RX_FLOW_HASH)
+	struct net_stats_rx_queue rx_flow[CONFIG_NET_RX_FLOW_QUEUE_COUNT];
+#endif
+
 #if defined(CONFIG_NET_TCP)
 	struct net_stats_tcp tcp;
 #define NET_STATS_TCP(s) NET_STATS(s)
@@ -226,11 +324,19 @@ struct net_stats {
 
 #if defined(CONFIG_NET_IPV6_ND)
 	struct net_stats_ipv6_nd ipv6_nd;
+	struct net_stats_ipv6_nbr ipv6_nbr;
 #define NET_STATS_IPV6_ND(s) NET_STATS(s)
 #else
 #define NET_STATS_IPV6_ND(s)
 #endif
 
+#if defined(CONFIG_NET_L2_IEEE802154_FRAGMENT)
+	struct net_stats_ieee802154_reass ieee802154_reass;
+#define NET_STATS_IEEE802154_REASS(s) NET_STATS(s)
+#else
+#define NET_STATS_IEEE802154_REASS(s)
+#endif
+
 #if defined(CONFIG_NET_RPL_STATS)
 	struct {
 		uint16_t mem_overflows;
@@ -244,6 +350,16 @@ struct net_stats {
 		uint16_t loop_warnings;
 		uint16_t root_repairs;
 
+		/** Selections of the preferred parent that compared all the
+		 * parents of the DAG.
+		 */
+		net_stats_t parent_scans;
+
+		/** Selections that only compared the updated parent with
+		 * the preferred one.
+		 */
+		net_stats_t parent_updates;
+
 		struct net_stats_rpl_dis dis;
 		struct net_stats_rpl_dio dio;
 		struct net_stats_rpl_dao dao;
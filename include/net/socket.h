@@ -0,0 +1,391 @@
+/** @file
+ * @brief BSD socket like API
+ *
+ * The sockets are built on top of the network contexts. Received data
+ * and accepted connections are queued per socket, so the application
+ * reads them from its own thread instead of a callback that runs in the
+ * RX thread.
+ */
+
+/*
+ * Copyright (c) 2016 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __NET_SOCKET_H
+#define __NET_SOCKET_H
+
+/**
+ * @brief BSD socket like API
+ * @defgroup net_socket BSD socket like API
+ * @{
+ */
+
+#include <sys/types.h>
+#include <sys/time.h>
+#include <net/net_ip.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Socket descriptor and the events to wait for, see zsock_poll() */
+struct zsock_pollfd {
+	/** Socket, negative values are ignored */
+	int fd;
+
+	/** Requested events, ZSOCK_POLLIN and ZSOCK_POLLOUT */
+	short events;
+
+	/** Returned events */
+	short revents;
+};
+
+/** Data or a connection can be read without blocking */
+#define ZSOCK_POLLIN   0x01
+/** Data can be sent */
+#define ZSOCK_POLLOUT  0x04
+/** The socket has a pending error, always returned */
+#define ZSOCK_POLLERR  0x08
+/** The peer has closed the connection, always returned */
+#define ZSOCK_POLLHUP  0x10
+/** The descriptor is not an open socket, always returned */
+#define ZSOCK_POLLNVAL 0x20
+
+/** zsock_recv() flag: return the data but leave it in the queue */
+#define ZSOCK_MSG_PEEK     0x02
+/** zsock_recv() flag: do not wait even if the socket is blocking */
+#define ZSOCK_MSG_DONTWAIT 0x40
+
+/** zsock_fcntl() command to get the file status flags */
+#define ZSOCK_F_GETFL 3
+/** zsock_fcntl() command to set the file status flags */
+#define ZSOCK_F_SETFL 4
+/** File status flag for non-blocking mode */
+#define ZSOCK_O_NONBLOCK 0x4000
+
+/** Option level of the socket itself */
+#define SOL_SOCKET 1
+
+/** Not implemented, setting it fails with ENOPROTOOPT */
+#define SO_REUSEADDR 2
+/** Get and clear the pending error of the socket */
+#define SO_ERROR 4
+/** Priority of the packets sent as an int, see enum net_priority */
+#define SO_PRIORITY 12
+/** Receive timeout as a struct timeval, zero (the default) waits forever */
+#define SO_RCVTIMEO 20
+
+/** Not implemented, setting it fails with ENOPROTOOPT */
+#define TCP_NODELAY 1
+
+/**
+ * @brief Create a socket.
+ *
+ * @param family AF_INET or AF_INET6
+ * @param type SOCK_DGRAM or SOCK_STREAM
+ * @param proto IPPROTO_UDP, IPPROTO_TCP or 0 for the default of the type
+ *
+ * @return Socket descriptor, or -1 with errno set.
+ */
+int zsock_socket(int family, int type, int proto);
+
+/**
+ * @brief Close a socket.
+ *
+ * @details Queued data and connections that were not accepted yet are
+ * dropped. A TCP connection is closed with the usual handshake.
+ *
+ * @param sock Socket descriptor
+ *
+ * @return 0 if ok, -1 with errno set otherwise.
+ */
+int zsock_close(int sock);
+
+/**
+ * @brief Bind a socket to a local address and port.
+ *
+ * @param sock Socket descriptor
+ * @param addr Local address
+ * @param addrlen Length of the address
+ *
+ * @return 0 if ok, -1 with errno set otherwise.
+ */
+int zsock_bind(int sock, const struct sockaddr *addr, socklen_t addrlen);
+
+/**
+ * @brief Connect a socket to a peer.
+ *
+ * @details For a UDP socket this only sets the default destination and
+ * the source the datagrams are accepted from. A blocking TCP socket
+ * waits for the connection up to CONFIG_NET_SOCKETS_CONNECT_TIMEOUT. A
+ * non-blocking one fails with EINPROGRESS and zsock_poll() returns
+ * ZSOCK_POLLOUT for it when the connection has been established.
+ *
+ * @param sock Socket descriptor
+ * @param addr Peer address
+ * @param addrlen Length of the address
+ *
+ * @return 0 if ok, -1 with errno set otherwise.
+ */
+int zsock_connect(int sock, const struct sockaddr *addr, socklen_t addrlen);
+
+/**
+ * @brief Start accepting TCP connections.
+ *
+ * @param sock Socket descriptor
+ * @param backlog Ignored, the connections are limited by the number of
+ * free sockets
+ *
+ * @return 0 if ok, -1 with errno set otherwise.
+ */
+int zsock_listen(int sock, int backlog);
+
+/**
+ * @brief Accept a TCP connection.
+ *
+ * @details The connection already has a socket of its own when it is
+ * established, so data sent by the peer before this call is not lost.
+ *
+ * @param sock Listening socket descriptor
+ * @param addr Peer address is returned here if not NULL
+ * @param addrlen Size of addr, set to the length of the address
+ *
+ * @return Socket descriptor of the connection, or -1 with errno set.
+ */
+int zsock_accept(int sock, struct sockaddr *addr, socklen_t *addrlen);
+
+/**
+ * @brief Send data to the peer of a connected socket.
+ *
+ * @details Sending may wait for network buffers even in non-blocking
+ * mode.
+ *
+ * @param sock Socket descriptor
+ * @param buf Data to send
+ * @param len Length of the data
+ * @param flags Ignored
+ *
+ * @return Number of bytes sent, or -1 with errno set.
+ */
+ssize_t zsock_send(int sock, const void *buf, size_t len, int flags);
+
+/**
+ * @brief Send data to the given address.
+ *
+ * @param sock Socket descriptor
+ * @param buf Data to send
+ * @param len Length of the data
+ * @param flags Ignored
+ * @param dest_addr Destination, ignored for TCP
+ * @param addrlen Length of the destination address
+ *
+ * @return Number of bytes sent, or -1 with errno set.
+ */
+ssize_t zsock_sendto(int sock, const void *buf, size_t len, int flags,
+		     const struct sockaddr *dest_addr, socklen_t addrlen);
+
+/**
+ * @brief Receive data from a socket.
+ *
+ * @param sock Socket descriptor
+ * @param buf Data is copied here
+ * @param max_len Size of buf
+ * @param flags ZSOCK_MSG_PEEK and ZSOCK_MSG_DONTWAIT
+ *
+ * @return Number of bytes received, 0 if the peer has closed the
+ * connection, or -1 with errno set.
+ */
+ssize_t zsock_recv(int sock, void *buf, size_t max_len, int flags);
+
+/**
+ * @brief Receive data and its source address from a socket.
+ *
+ * @details A datagram that does not fit in buf is truncated. Data of a
+ * TCP connection is returned in as many calls as needed.
+ *
+ * @param sock Socket descriptor
+ * @param buf Data is copied here
+ * @param max_len Size of buf
+ * @param flags ZSOCK_MSG_PEEK and ZSOCK_MSG_DONTWAIT
+ * @param src_addr Source address is returned here if not NULL
+ * @param addrlen Size of src_addr, set to the length of the address
+ *
+ * @return Number of bytes received, 0 if the peer has closed the
+ * connection, or -1 with errno set.
+ */
+ssize_t zsock_recvfrom(int sock, void *buf, size_t max_len, int flags,
+		       struct sockaddr *src_addr, socklen_t *addrlen);
+
+/**
+ * @brief Get or set the file status flags of a socket.
+ *
+ * @param sock Socket descriptor
+ * @param cmd ZSOCK_F_GETFL or ZSOCK_F_SETFL
+ * @param flags ZSOCK_O_NONBLOCK or 0 for ZSOCK_F_SETFL
+ *
+ * @return The flags for ZSOCK_F_GETFL, 0 for ZSOCK_F_SETFL, or -1 with
+ * errno set.
+ */
+int zsock_fcntl(int sock, int cmd, int flags);
+
+/**
+ * @brief Set a socket option.
+ *
+ * @param sock Socket descriptor
+ * @param level SOL_SOCKET
+ * @param optname SO_RCVTIMEO or SO_PRIORITY
+ * @param optval Value of the option
+ * @param optlen Length of the value
+ *
+ * @return 0 if ok, -1 with errno set otherwise.
+ */
+int zsock_setsockopt(int sock, int level, int optname,
+		     const void *optval, socklen_t optlen);
+
+/**
+ * @brief Get a socket option.
+ *
+ * @param sock Socket descriptor
+ * @param level SOL_SOCKET
+ * @param optname SO_ERROR, SO_RCVTIMEO or SO_PRIORITY
+ * @param optval Value of the option is returned here
+ * @param optlen Size of optval, set to the length of the value
+ *
+ * @return 0 if ok, -1 with errno set otherwise.
+ */
+int zsock_getsockopt(int sock, int level, int optname,
+		     void *optval, socklen_t *optlen);
+
+/**
+ * @brief Wait for events on several sockets.
+ *
+ * @details The thread sleeps until one of the sockets becomes ready or
+ * the timeout expires, it is woken up only by events of the sockets it
+ * waits for.
+ *
+ * @param fds Sockets and the events to wait for
+ * @param nfds Number of entries in fds
+ * @param timeout Timeout in milliseconds, 0 to return immediately and
+ * -1 to wait forever
+ *
+ * @return Number of sockets with events, 0 on timeout, or -1 with errno
+ * set.
+ */
+int zsock_poll(struct zsock_pollfd *fds, int nfds, int timeout);
+
+#if defined(CONFIG_NET_SOCKETS_POSIX_NAMES)
+#define pollfd zsock_pollfd
+
+#define POLLIN ZSOCK_POLLIN
+#define POLLOUT ZSOCK_POLLOUT
+#define POLLERR ZSOCK_POLLERR
+#define POLLHUP ZSOCK_POLLHUP
+#define POLLNVAL ZSOCK_POLLNVAL
+
+#define MSG_PEEK ZSOCK_MSG_PEEK
+#define MSG_DONTWAIT ZSOCK_MSG_DONTWAIT
+
+#define F_GETFL ZSOCK_F_GETFL
+#define F_SETFL ZSOCK_F_SETFL
+#define O_NONBLOCK ZSOCK_O_NONBLOCK
+
+static inline int socket(int family, int type, int proto)
+{
+	return zsock_socket(family, type, proto);
+}
+
+static inline int close(int sock)
+{
+	return zsock_close(sock);
+}
+
+static inline int bind(int sock, const struct sockaddr *addr,
+		       socklen_t addrlen)
+{
+	return zsock_bind(sock, addr, addrlen);
+}
+
+static inline int connect(int sock, const struct sockaddr *addr,
+			  socklen_t addrlen)
+{
+	return zsock_connect(sock, addr, addrlen);
+}
+
+static inline int listen(int sock, int backlog)
+{
+	return zsock_listen(sock, backlog);
+}
+
+static inline int accept(int sock, struct sockaddr *addr, socklen_t *addrlen)
+{
+	return zsock_accept(sock, addr, addrlen);
+}
+
+static inline ssize_t send(int sock, const void *buf, size_t len, int flags)
+{
+	return zsock_send(sock, buf, len, flags);
+}
+
+static inline ssize_t sendto(int sock, const void *buf, size_t len,
+			     int flags, const struct sockaddr *dest_addr,
+			     socklen_t addrlen)
+{
+	return zsock_sendto(sock, buf, len, flags, dest_addr, addrlen);
+}
+
+static inline ssize_t recv(int sock, void *buf, size_t max_len, int flags)
+{
+	return zsock_recv(sock, buf, max_len, flags);
+}
+
+static inline ssize_t recvfrom(int sock, void *buf, size_t max_len,
+			       int flags, struct sockaddr *src_addr,
+			       socklen_t *addrlen)
+{
+	return zsock_recvfrom(sock, buf, max_len, flags, src_addr, addrlen);
+}
+
+static inline int fcntl(int sock, int cmd, int flags)
+{
+	return zsock_fcntl(sock, cmd, flags);
+}
+
+static inline int setsockopt(int sock, int level, int optname,
+			     const void *optval, socklen_t optlen)
+{
+	return zsock_setsockopt(sock, level, optname, optval, optlen);
+}
+
+static inline int getsockopt(int sock, int level, int optname,
+			     void *optval, socklen_t *optlen)
+{
+	return zsock_getsockopt(sock, level, optname, optval, optlen);
+}
+
+static inline int poll(struct zsock_pollfd *fds, int nfds, int timeout)
+{
+	return zsock_poll(fds, nfds, timeout);
+}
+#endif /* CONFIG_NET_SOCKETS_POSIX_NAMES */
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* __NET_SOCKET_H */
@@ -50,6 +50,8 @@ struct net_trickle {
 	uint32_t I;		/* Current interval size */
 	uint32_t Istart;	/* Start of the interval in ms */
 	uint8_t c;		/* Consistency counter */
+	bool double_to;		/* Timer expires at the end of the interval
+				 */
 
 	uint32_t Imax_abs;	/* Max interval size in ms (not doublings)
 				 */
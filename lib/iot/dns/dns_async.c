@@ -0,0 +1,853 @@
+/*
+ * Copyright (c) 2016 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <iot/dns_client.h>
+#include "dns_pack.h"
+
+#include <zephyr.h>
+#include <drivers/rand32.h>
+#include <misc/byteorder.h>
+#include <net/nbuf.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+
+#define DNS_NAME_LEN		CONFIG_DNS_RESOLVER_NAME_LEN
+#define DNS_CACHE_SIZE		CONFIG_DNS_RESOLVER_CACHE_SIZE
+#define DNS_ADDRESSES		CONFIG_DNS_RESOLVER_CACHE_ADDRESSES
+#define DNS_WAITERS		CONFIG_DNS_RESOLVER_WAITERS
+
+/* QNAME is two octets longer than the name, QTYPE and QCLASS are
+ * two octets each.
+ */
+#define DNS_QNAME_MAX_SIZE	(DNS_NAME_LEN + 2)
+#define DNS_QUERY_MAX_SIZE	(DNS_MSG_HEADER_SIZE + DNS_QNAME_MAX_SIZE + 4)
+
+/* This value is recommended by RFC 1035 */
+#define DNS_RESOLVER_MAX_BUF_SIZE	512
+
+/* Type, class, TTL and RDLENGTH of a resource record */
+#define DNS_RR_FIXED_LEN	10
+
+/* SERIAL, REFRESH, RETRY, EXPIRE and MINIMUM of the SOA RDATA */
+#define DNS_SOA_FIXED_LEN	20
+
+#define DNS_RR_TYPE_SOA		6
+
+#define DNS_IPV4_LEN		4
+#define DNS_IPV6_LEN		16
+
+/* RFC 2181, 8: TTLs can be up to 2^31 - 1 seconds. Answers are cached
+ * at most a day, so the expiry times in milliseconds do not wrap.
+ */
+#define DNS_MAX_TTL		(24 * 60 * 60)
+
+enum dns_rrset_index {
+	DNS_RRSET_A,
+	DNS_RRSET_AAAA,
+	DNS_RRSET_COUNT
+};
+
+struct dns_rrset {
+	/* Uptime in milliseconds when the answer expires */
+	uint32_t expiry;
+
+	/* 0 or -ENOENT when the answer is cached, -EAGAIN when there is
+	 * no answer, the error of the last query otherwise.
+	 */
+	int16_t status;
+
+	/* Transaction id of the pending query */
+	uint16_t id;
+
+	bool pending;
+};
+
+struct dns_entry {
+	struct k_delayed_work retry;
+
+	struct dns_addresses addresses;
+	struct dns_rrset rrset[DNS_RRSET_COUNT];
+
+	/* Retransmission timeout of the pending queries */
+	uint32_t timeout;
+
+	/* Uptime of the last lookup, the oldest entry is replaced */
+	uint32_t used;
+
+	uint8_t retries;
+
+	/* Empty when the entry is not in use */
+	char name[DNS_NAME_LEN + 1];
+};
+
+struct dns_waiter {
+	dns_resolve_cb_t cb;
+	void *user_data;
+	struct dns_entry *entry;
+
+	/* Bitmask of the rrsets the caller waits for */
+	uint8_t rrsets;
+};
+
+struct dns_query {
+	struct dns_entry *entry;
+	uint16_t id;
+	uint8_t rrset;
+};
+
+static struct net_context *dns_ctx;
+static struct sockaddr dns_server;
+
+/* Protects the cache and the waiters. It is never held while a query
+ * is sent or a callback is called.
+ */
+static struct k_sem dns_lock;
+
+static struct dns_entry cache[DNS_CACHE_SIZE];
+static struct dns_waiter waiters[DNS_WAITERS];
+
+/* Answers are parsed in the RX thread only */
+static uint8_t dns_rx_msg[DNS_RESOLVER_MAX_BUF_SIZE];
+
+static const uint16_t rrset_type[DNS_RRSET_COUNT] = {
+	[DNS_RRSET_A] = DNS_RR_TYPE_A,
+	[DNS_RRSET_AAAA] = DNS_RR_TYPE_AAAA,
+};
+
+static inline bool rrset_cached(struct dns_rrset *rrset, uint32_t now)
+{
+	return !rrset->pending &&
+		(rrset->status == 0 || rrset->status == -ENOENT) &&
+		(int32_t)(rrset->expiry - now) > 0;
+}
+
+static uint8_t pending_rrsets(struct dns_entry *entry)
+{
+	uint8_t rrsets = 0;
+	int i;
+
+	for (i = 0; i < DNS_RRSET_COUNT; i++) {
+		if (entry->rrset[i].pending) {
+			rrsets |= BIT(i);
+		}
+	}
+
+	return rrsets;
+}
+
+static bool entry_has_waiters(struct dns_entry *entry)
+{
+	int i;
+
+	for (i = 0; i < DNS_WAITERS; i++) {
+		if (waiters[i].cb && waiters[i].entry == entry) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/* Domain names are not case sensitive, RFC 4343 */
+static bool name_match(const char *name1, const char *name2)
+{
+	while (*name1 && tolower(*name1) == tolower(*name2)) {
+		name1++;
+		name2++;
+	}
+
+	return *name1 == *name2;
+}
+
+static struct dns_entry *cache_lookup(const char *name)
+{
+	int i;
+
+	for (i = 0; i < DNS_CACHE_SIZE; i++) {
+		if (cache[i].name[0] && name_match(cache[i].name, name)) {
+			return &cache[i];
+		}
+	}
+
+	return NULL;
+}
+
+static struct dns_entry *cache_alloc(const char *name)
+{
+	struct dns_entry *entry = NULL;
+	int i;
+
+	for (i = 0; i < DNS_CACHE_SIZE; i++) {
+		if (!cache[i].name[0]) {
+			entry = &cache[i];
+			break;
+		}
+
+		if (pending_rrsets(&cache[i]) || entry_has_waiters(&cache[i])) {
+			continue;
+		}
+
+		if (!entry || (int32_t)(cache[i].used - entry->used) < 0) {
+			entry = &cache[i];
+		}
+	}
+
+	if (!entry) {
+		return NULL;
+	}
+
+	strcpy(entry->name, name);
+
+	memset(&entry->addresses, 0, sizeof(entry->addresses));
+
+	for (i = 0; i < DNS_RRSET_COUNT; i++) {
+		entry->rrset[i].status = -EAGAIN;
+		entry->rrset[i].pending = false;
+	}
+
+	return entry;
+}
+
+/* The lookup succeeds if any of the families has addresses. It fails
+ * with -ENOENT only if all of them are known not to have any.
+ */
+static int get_result(struct dns_entry *entry, uint8_t rrsets,
+		      struct dns_addresses *addresses)
+{
+	int status = -ENOENT;
+	int i;
+
+	memset(addresses, 0, sizeof(*addresses));
+
+	for (i = 0; i < DNS_RRSET_COUNT; i++) {
+		if (!(rrsets & BIT(i))) {
+			continue;
+		}
+
+		if (entry->rrset[i].status == 0) {
+			status = 0;
+		} else if (entry->rrset[i].status != -ENOENT &&
+			   status == -ENOENT) {
+			status = entry->rrset[i].status;
+		}
+	}
+
+	if (rrsets & BIT(DNS_RRSET_A) &&
+	    entry->rrset[DNS_RRSET_A].status == 0) {
+		addresses->ipv4_count = entry->addresses.ipv4_count;
+		memcpy(addresses->ipv4, entry->addresses.ipv4,
+		       sizeof(addresses->ipv4));
+	}
+
+	if (rrsets & BIT(DNS_RRSET_AAAA) &&
+	    entry->rrset[DNS_RRSET_AAAA].status == 0) {
+		addresses->ipv6_count = entry->addresses.ipv6_count;
+		memcpy(addresses->ipv6, entry->addresses.ipv6,
+		       sizeof(addresses->ipv6));
+	}
+
+	return status;
+}
+
+/* Calls the callbacks of the lookups that are complete, one at a time
+ * without holding the lock, so they can start new lookups.
+ */
+static void notify_waiters(void)
+{
+	struct dns_addresses addresses;
+	void *user_data = NULL;
+	dns_resolve_cb_t cb;
+	int status = 0;
+	int i;
+
+	do {
+		cb = NULL;
+
+		k_sem_take(&dns_lock, K_FOREVER);
+
+		for (i = 0; i < DNS_WAITERS; i++) {
+			if (!waiters[i].cb ||
+			    (waiters[i].rrsets &
+			     pending_rrsets(waiters[i].entry))) {
+				continue;
+			}
+
+			cb = waiters[i].cb;
+			user_data = waiters[i].user_data;
+			status = get_result(waiters[i].entry, waiters[i].rrsets,
+					    &addresses);
+
+			waiters[i].cb = NULL;
+			break;
+		}
+
+		k_sem_give(&dns_lock);
+
+		if (cb) {
+			cb(status, &addresses, user_data);
+		}
+	} while (cb);
+}
+
+static int send_query(struct dns_query *query)
+{
+	uint8_t qname[DNS_QNAME_MAX_SIZE];
+	uint8_t msg[DNS_QUERY_MAX_SIZE];
+	uint16_t qname_len;
+	uint16_t len;
+	struct net_buf *tx;
+	int rc;
+
+	/* The name does not change while the query is pending */
+	rc = dns_msg_pack_qname(&qname_len, qname, sizeof(qname),
+				query->entry->name);
+	if (rc != 0) {
+		return -EINVAL;
+	}
+
+	rc = dns_msg_pack_query(msg, &len, sizeof(msg), qname, qname_len,
+				query->id,
+				(enum dns_rr_type)rrset_type[query->rrset]);
+	if (rc != 0) {
+		return -EINVAL;
+	}
+
+	tx = net_nbuf_get_tx(dns_ctx);
+	if (!tx) {
+		return -ENOMEM;
+	}
+
+	if (!net_nbuf_append(tx, len, msg)) {
+		net_nbuf_unref(tx);
+		return -ENOMEM;
+	}
+
+	rc = net_context_sendto(tx, &dns_server,
+				dns_server.family == AF_INET ?
+				sizeof(struct sockaddr_in) :
+				sizeof(struct sockaddr_in6),
+				NULL, K_NO_WAIT, NULL, NULL);
+	if (rc != 0) {
+		net_nbuf_unref(tx);
+		return -EIO;
+	}
+
+	return 0;
+}
+
+/* A query that cannot be sent is retransmitted after the timeout like
+ * a lost one.
+ */
+static void send_queries(struct dns_query *queries, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		send_query(&queries[i]);
+	}
+}
+
+static void dns_retry(struct k_work *work)
+{
+	struct dns_entry *entry = CONTAINER_OF(work, struct dns_entry, retry);
+	struct dns_query queries[DNS_RRSET_COUNT];
+	uint32_t now = k_uptime_get_32();
+	int count = 0;
+	int i;
+
+	k_sem_take(&dns_lock, K_FOREVER);
+
+	for (i = 0; i < DNS_RRSET_COUNT; i++) {
+		struct dns_rrset *rrset = &entry->rrset[i];
+
+		if (!rrset->pending) {
+			continue;
+		}
+
+		if (entry->retries < CONFIG_DNS_RESOLVER_RETRIES) {
+			queries[count].entry = entry;
+			queries[count].id = rrset->id;
+			queries[count].rrset = i;
+			count++;
+			continue;
+		}
+
+		rrset->pending = false;
+		rrset->status = -ETIMEDOUT;
+		rrset->expiry = now;
+	}
+
+	if (count) {
+		entry->retries++;
+		entry->timeout *= 2;
+
+		k_delayed_work_submit(&entry->retry, entry->timeout);
+	}
+
+	k_sem_give(&dns_lock);
+
+	send_queries(queries, count);
+
+	notify_waiters();
+}
+
+/* Returns the offset after the name, or 0 if the message ends before */
+static uint16_t skip_name(uint8_t *msg, uint16_t size, uint16_t offset)
+{
+	while (offset < size) {
+		if (!msg[offset]) {
+			return offset + 1;
+		}
+
+		/* A pointer ends the name */
+		if ((msg[offset] & 0xc0) == 0xc0) {
+			return offset + 2 <= size ? offset + 2 : 0;
+		}
+
+		offset += msg[offset] + 1;
+	}
+
+	return 0;
+}
+
+/* Negative answers are cached for the smaller of the TTL and the
+ * MINIMUM field of the SOA record in the authority section (RFC 2308,
+ * 5).
+ */
+static uint32_t negative_ttl(uint8_t *msg, uint16_t size, uint16_t offset)
+{
+	uint32_t ttl = CONFIG_DNS_RESOLVER_NEGATIVE_TTL;
+	uint16_t count = sys_get_be16(msg + 8);
+	uint16_t rdata;
+	uint16_t end;
+
+	while (count--) {
+		offset = skip_name(msg, size, offset);
+		if (!offset || offset + DNS_RR_FIXED_LEN > size) {
+			break;
+		}
+
+		rdata = offset + DNS_RR_FIXED_LEN;
+		end = rdata + sys_get_be16(msg + offset + 8);
+		if (end > size) {
+			break;
+		}
+
+		if (sys_get_be16(msg + offset) == DNS_RR_TYPE_SOA) {
+			/* MNAME and RNAME come before the fixed fields */
+			rdata = skip_name(msg, end, rdata);
+			rdata = rdata ? skip_name(msg, end, rdata) : 0;
+
+			if (rdata && rdata + DNS_SOA_FIXED_LEN <= end) {
+				ttl = min(ttl, sys_get_be32(msg + offset + 4));
+				ttl = min(ttl, sys_get_be32(msg + rdata + 16));
+			}
+
+			break;
+		}
+
+		offset = end;
+	}
+
+	return ttl;
+}
+
+/* Stores the addresses of the answer in the entry. Returns 0 or -ENOENT
+ * and the time the answer can be cached, or an error.
+ */
+static int parse_answer(struct dns_entry *entry, int index, uint8_t *msg,
+			uint16_t size, uint32_t *ttl)
+{
+	uint16_t type = rrset_type[index];
+	int addr_len = index == DNS_RRSET_A ? DNS_IPV4_LEN : DNS_IPV6_LEN;
+	uint16_t ancount;
+	uint16_t offset;
+	uint16_t rdlen;
+	uint8_t *addr;
+	uint8_t count = 0;
+
+	if (!dns_header_qr(msg) || dns_header_opcode(msg) != DNS_QUERY ||
+	    dns_unpack_header_qdcount(msg) != 1) {
+		return -EINVAL;
+	}
+
+	switch (dns_header_rcode(msg)) {
+	case DNS_HEADER_NOERROR:
+	case DNS_HEADER_NAMEERROR:
+		break;
+	default:
+		return -EIO;
+	}
+
+	offset = skip_name(msg, size, DNS_MSG_HEADER_SIZE);
+	if (!offset || offset + 4 > size ||
+	    sys_get_be16(msg + offset) != type) {
+		return -EINVAL;
+	}
+
+	offset += 4;
+
+	/* The server follows the CNAMEs, so only the records of the
+	 * requested type are looked at.
+	 */
+	*ttl = DNS_MAX_TTL;
+
+	for (ancount = dns_unpack_header_ancount(msg); ancount; ancount--) {
+		offset = skip_name(msg, size, offset);
+		if (!offset || offset + DNS_RR_FIXED_LEN > size) {
+			return -EINVAL;
+		}
+
+		rdlen = sys_get_be16(msg + offset + 8);
+		if (offset + DNS_RR_FIXED_LEN + rdlen > size) {
+			return -EINVAL;
+		}
+
+		if (sys_get_be16(msg + offset) == type &&
+		    sys_get_be16(msg + offset + 2) == DNS_CLASS_IN &&
+		    rdlen == addr_len && count < DNS_ADDRESSES) {
+			if (index == DNS_RRSET_A) {
+				addr = (uint8_t *)&entry->addresses.ipv4[count];
+			} else {
+				addr = (uint8_t *)&entry->addresses.ipv6[count];
+			}
+
+			memcpy(addr, msg + offset + DNS_RR_FIXED_LEN, addr_len);
+			*ttl = min(*ttl, sys_get_be32(msg + offset + 4));
+			count++;
+		}
+
+		offset += DNS_RR_FIXED_LEN + rdlen;
+	}
+
+	if (index == DNS_RRSET_A) {
+		entry->addresses.ipv4_count = count;
+	} else {
+		entry->addresses.ipv6_count = count;
+	}
+
+	if (count) {
+		return 0;
+	}
+
+	*ttl = negative_ttl(msg, size, offset);
+
+	return -ENOENT;
+}
+
+/* The answer must repeat the question of the query, RFC 5452. The
+ * name is compared without case, like name_match() does.
+ */
+static bool question_match(struct dns_entry *entry, int index, uint8_t *msg,
+			   uint16_t size)
+{
+	uint8_t qname[DNS_QNAME_MAX_SIZE];
+	uint16_t offset = DNS_MSG_HEADER_SIZE;
+	uint16_t qname_len;
+	int i;
+
+	if (dns_unpack_header_qdcount(msg) != 1 ||
+	    dns_msg_pack_qname(&qname_len, qname, sizeof(qname),
+			       entry->name) != 0 ||
+	    offset + qname_len + 4 > size) {
+		return false;
+	}
+
+	/* The label lengths are below 64, so tolower() keeps them */
+	for (i = 0; i < qname_len; i++) {
+		if (tolower(msg[offset + i]) != tolower(qname[i])) {
+			return false;
+		}
+	}
+
+	offset += qname_len;
+
+	return sys_get_be16(msg + offset) == rrset_type[index] &&
+		sys_get_be16(msg + offset + 2) == DNS_CLASS_IN;
+}
+
+static void handle_answer(uint8_t *msg, uint16_t size)
+{
+	uint32_t now = k_uptime_get_32();
+	struct dns_rrset *rrset;
+	uint16_t id;
+	uint32_t ttl;
+	int i, j;
+
+	id = dns_unpack_header_id(msg);
+
+	for (i = 0; i < DNS_CACHE_SIZE; i++) {
+		for (j = 0; j < DNS_RRSET_COUNT; j++) {
+			rrset = &cache[i].rrset[j];
+
+			if (rrset->pending && rrset->id == id &&
+			    question_match(&cache[i], j, msg, size)) {
+				goto found;
+			}
+		}
+	}
+
+	return;
+
+found:
+	rrset->status = parse_answer(&cache[i], j, msg, size, &ttl);
+	rrset->pending = false;
+
+	if (rrset->status == 0 || rrset->status == -ENOENT) {
+		rrset->expiry = now + min(ttl, DNS_MAX_TTL) * MSEC_PER_SEC;
+	} else {
+		rrset->expiry = now;
+	}
+
+	if (!pending_rrsets(&cache[i])) {
+		k_delayed_work_cancel(&cache[i].retry);
+	}
+}
+
+/* The context is not connected, so anybody can send to it */
+static bool from_server(struct net_buf *buf)
+{
+	if (net_nbuf_family(buf) != dns_server.family) {
+		return false;
+	}
+
+	if (dns_server.family == AF_INET) {
+		return NET_UDP_BUF(buf)->src_port ==
+			net_sin(&dns_server)->sin_port &&
+			net_ipv4_addr_cmp(&NET_IPV4_BUF(buf)->src,
+					  &net_sin(&dns_server)->sin_addr);
+	}
+
+	return NET_UDP_BUF(buf)->src_port == net_sin6(&dns_server)->sin6_port &&
+		net_ipv6_addr_cmp(&NET_IPV6_BUF(buf)->src,
+				  &net_sin6(&dns_server)->sin6_addr);
+}
+
+static void dns_recv(struct net_context *ctx, struct net_buf *buf,
+		     int status, void *user_data)
+{
+	struct net_nbuf_cursor cursor;
+	uint16_t len;
+
+	ARG_UNUSED(ctx);
+	ARG_UNUSED(user_data);
+
+	if (status != 0 || !buf) {
+		return;
+	}
+
+	if (!from_server(buf)) {
+		net_nbuf_unref(buf);
+		return;
+	}
+
+	/* Name compression points back into the message, so the message
+	 * is copied out of the fragments once and parsed from the copy.
+	 */
+	len = min(net_nbuf_appdatalen(buf), sizeof(dns_rx_msg));
+	net_nbuf_cursor_init(&cursor, NULL, buf->frags,
+			     net_buf_frags_len(buf->frags) -
+			     net_nbuf_appdatalen(buf));
+
+	if (!net_nbuf_cursor_read(&cursor, len, dns_rx_msg)) {
+		len = 0;
+	}
+
+	net_nbuf_unref(buf);
+
+	if (len < DNS_MSG_HEADER_SIZE) {
+		return;
+	}
+
+	k_sem_take(&dns_lock, K_FOREVER);
+	handle_answer(dns_rx_msg, len);
+	k_sem_give(&dns_lock);
+
+	notify_waiters();
+}
+
+int dns_async_init(struct net_context *ctx, struct sockaddr *server)
+{
+	int rc;
+	int i;
+
+	if (!ctx || !server || (server->family != AF_INET &&
+				server->family != AF_INET6)) {
+		return -EINVAL;
+	}
+
+	k_sem_init(&dns_lock, 1, 1);
+
+	for (i = 0; i < DNS_CACHE_SIZE; i++) {
+		k_delayed_work_init(&cache[i].retry, dns_retry);
+		cache[i].name[0] = '\0';
+	}
+
+	memset(waiters, 0, sizeof(waiters));
+	memcpy(&dns_server, server, sizeof(dns_server));
+
+	rc = net_context_recv(ctx, dns_recv, K_NO_WAIT, NULL);
+	if (rc != 0) {
+		return rc;
+	}
+
+	dns_ctx = ctx;
+
+	return 0;
+}
+
+int dns_async_resolve(const char *name, sa_family_t family,
+		      dns_resolve_cb_t cb, void *user_data)
+{
+	struct dns_query queries[DNS_RRSET_COUNT];
+	struct dns_addresses addresses;
+	uint32_t now = k_uptime_get_32();
+	struct dns_waiter *waiter = NULL;
+	struct dns_entry *entry;
+	uint8_t rrsets;
+	int count = 0;
+	int status;
+	int i;
+
+	if (!dns_ctx || !name || !name[0] || strlen(name) > DNS_NAME_LEN ||
+	    !cb) {
+		return -EINVAL;
+	}
+
+	switch (family) {
+	case AF_INET:
+		rrsets = BIT(DNS_RRSET_A);
+		break;
+	case AF_INET6:
+		rrsets = BIT(DNS_RRSET_AAAA);
+		break;
+	case AF_UNSPEC:
+		rrsets = BIT(DNS_RRSET_A) | BIT(DNS_RRSET_AAAA);
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	k_sem_take(&dns_lock, K_FOREVER);
+
+	entry = cache_lookup(name);
+	if (!entry) {
+		entry = cache_alloc(name);
+		if (!entry) {
+			k_sem_give(&dns_lock);
+			return -ENOMEM;
+		}
+	}
+
+	entry->used = now;
+
+	for (i = 0; i < DNS_RRSET_COUNT; i++) {
+		if ((rrsets & BIT(i)) && !rrset_cached(&entry->rrset[i], now)) {
+			break;
+		}
+	}
+
+	if (i == DNS_RRSET_COUNT) {
+		status = get_result(entry, rrsets, &addresses);
+
+		k_sem_give(&dns_lock);
+
+		cb(status, &addresses, user_data);
+
+		return 0;
+	}
+
+	for (i = 0; i < DNS_WAITERS; i++) {
+		if (!waiters[i].cb) {
+			waiter = &waiters[i];
+			break;
+		}
+	}
+
+	if (!waiter) {
+		k_sem_give(&dns_lock);
+		return -ENOMEM;
+	}
+
+	waiter->cb = cb;
+	waiter->user_data = user_data;
+	waiter->entry = entry;
+	waiter->rrsets = rrsets;
+
+	/* Queries that are already pending are shared */
+	for (i = 0; i < DNS_RRSET_COUNT; i++) {
+		struct dns_rrset *rrset = &entry->rrset[i];
+
+		if (!(rrsets & BIT(i)) || rrset->pending ||
+		    rrset_cached(rrset, now)) {
+			continue;
+		}
+
+		rrset->pending = true;
+		rrset->id = sys_rand32_get();
+
+		queries[count].entry = entry;
+		queries[count].id = rrset->id;
+		queries[count].rrset = i;
+		count++;
+	}
+
+	if (count) {
+		entry->retries = 0;
+		entry->timeout = CONFIG_DNS_RESOLVER_TIMEOUT;
+
+		k_delayed_work_submit(&entry->retry, entry->timeout);
+	}
+
+	k_sem_give(&dns_lock);
+
+	send_queries(queries, count);
+
+	return 0;
+}
+
+void dns_async_cancel(dns_resolve_cb_t cb, void *user_data)
+{
+	int i;
+
+	k_sem_take(&dns_lock, K_FOREVER);
+
+	for (i = 0; i < DNS_WAITERS; i++) {
+		if (waiters[i].cb == cb && waiters[i].user_data == user_data) {
+			waiters[i].cb = NULL;
+		}
+	}
+
+	k_sem_give(&dns_lock);
+}
+
+void dns_async_flush(void)
+{
+	int i;
+
+	k_sem_take(&dns_lock, K_FOREVER);
+
+	for (i = 0; i < DNS_CACHE_SIZE; i++) {
+		if (!pending_rrsets(&cache[i]) &&
+		    !entry_has_waiters(&cache[i])) {
+			cache[i].name[0] = '\0';
+		}
+	}
+
+	k_sem_give(&dns_lock);
+}
@@ -25,6 +25,11 @@
 #define MSG_SIZE	CONFIG_MQTT_MSG_MAX_SIZE
 #define MQTT_BUF_CTR	(1 + CONFIG_MQTT_ADDITIONAL_BUFFER_CTR)
 
+/* CONNACK, PINGRESP, UNSUBACK and the PUBxxx acks are at most 4 bytes */
+#define MQTT_RX_MSG_SIZE	4
+/* Fixed header of up to 5 bytes, Packet Identifier and one QoS per topic */
+#define MQTT_SUBACK_MSG_SIZE	(5 + 2 + CONFIG_MQTT_SUBSCRIBE_MAX_TOPICS)
+
 static struct nano_fifo mqtt_msg_fifo;
 
 /* Memory pool internally used to handle messages that may exceed the size of
@@ -370,20 +375,52 @@ exit_unsub:
 	return rc;
 }
 
+/**
+ * @brief mqtt_rx_read		Copies the start of the MQTT message
+ *				contained in the rx buffer, which may span
+ *				several fragments
+ * @param rx			RX buffer
+ * @param data			Buffer where the message is copied
+ * @param size			Size of data
+ * @return			Number of bytes copied
+ * @return			0 if there is no data
+ */
+static uint16_t mqtt_rx_read(struct net_buf *rx, uint8_t *data,
+			     uint16_t size)
+{
+	struct net_nbuf_cursor cursor;
+	uint16_t appdatalen;
+	uint16_t len;
+
+	appdatalen = net_nbuf_appdatalen(rx);
+	len = min(appdatalen, size);
+	if (len == 0) {
+		return 0;
+	}
+
+	net_nbuf_cursor_init(&cursor, NULL, rx->frags,
+			     net_buf_frags_len(rx->frags) - appdatalen);
+	if (!net_nbuf_cursor_read(&cursor, len, data)) {
+		return 0;
+	}
+
+	return len;
+}
+
 int mqtt_rx_connack(struct mqtt_ctx *ctx, struct net_buf *rx, int clean_session)
 {
+	uint8_t data[MQTT_RX_MSG_SIZE];
 	uint16_t len;
 	uint8_t connect_rc;
 	uint8_t session;
-	uint8_t *data;
 	int rc;
 
-	data = net_nbuf_appdata(rx);
-	len = net_nbuf_appdatalen(rx);
+	len = mqtt_rx_read(rx, data, sizeof(data));
+	if (len == 0) {
+		rc = -EINVAL;
+		goto exit_connect;
+	}
 
-	/* CONNACK is only 4 bytes len, so it is assumed
-	 * that net buf traversing is not required here
-	 */
 	rc = mqtt_unpack_connack(data, len, &session, &connect_rc);
 	if (rc != 0) {
 		rc = -EINVAL;
@@ -439,9 +476,9 @@ int mqtt_rx_pub_msgs(struct mqtt_ctx *ctx, struct net_buf *rx,
 {
 	int (*unpack)(uint8_t *, uint16_t, uint16_t *) = NULL;
 	int (*response)(struct mqtt_ctx *, uint16_t) = NULL;
+	uint8_t data[MQTT_RX_MSG_SIZE];
 	uint16_t pkt_id;
 	uint16_t len;
-	uint8_t *data;
 	int rc;
 
 	switch (type) {
@@ -463,8 +500,10 @@ int mqtt_rx_pub_msgs(struct mqtt_ctx *ctx, struct net_buf *rx,
 		return -EINVAL;
 	}
 
-	data = net_nbuf_appdata(rx);
-	len = net_nbuf_appdatalen(rx);
+	len = mqtt_rx_read(rx, data, sizeof(data));
+	if (len == 0) {
+		return -EINVAL;
+	}
 
 	/* 4 bytes message */
 	rc = unpack(data, len, &pkt_id);
@@ -524,14 +563,16 @@ int mqtt_rx_pubrel(struct mqtt_ctx *ctx, struct net_buf *rx)
 
 int mqtt_rx_pingresp(struct mqtt_ctx *ctx, struct net_buf *rx)
 {
-	uint8_t *data;
+	uint8_t data[MQTT_RX_MSG_SIZE];
 	uint16_t len;
 	int rc;
 
 	ARG_UNUSED(ctx);
 
-	data = net_nbuf_appdata(rx);
-	len = net_nbuf_appdatalen(rx);
+	len = mqtt_rx_read(rx, data, sizeof(data));
+	if (len == 0) {
+		return -EINVAL;
+	}
 
 	/* 2 bytes message */
 	rc = mqtt_unpack_pingresp(data, len);
@@ -546,14 +587,16 @@ int mqtt_rx_pingresp(struct mqtt_ctx *ctx, struct net_buf *rx)
 int mqtt_rx_suback(struct mqtt_ctx *ctx, struct net_buf *rx)
 {
 	enum mqtt_qos suback_qos[CONFIG_MQTT_SUBSCRIBE_MAX_TOPICS];
+	uint8_t data[MQTT_SUBACK_MSG_SIZE];
 	uint16_t pkt_id;
 	uint16_t len;
 	uint8_t items;
-	uint8_t *data;
 	int rc;
 
-	data = net_nbuf_appdata(rx);
-	len = net_nbuf_appdatalen(rx);
+	len = mqtt_rx_read(rx, data, sizeof(data));
+	if (len == 0) {
+		return -EINVAL;
+	}
 
 	rc = mqtt_unpack_suback(data, len, &pkt_id, &items,
 				CONFIG_MQTT_SUBSCRIBE_MAX_TOPICS, suback_qos);
@@ -575,13 +618,15 @@ int mqtt_rx_suback(struct mqtt_ctx *ctx, struct net_buf *rx)
 
 int mqtt_rx_unsuback(struct mqtt_ctx *ctx, struct net_buf *rx)
 {
+	uint8_t data[MQTT_RX_MSG_SIZE];
 	uint16_t pkt_id;
 	uint16_t len;
-	uint8_t *data;
 	int rc;
 
-	data = net_nbuf_appdata(rx);
-	len = net_nbuf_appdatalen(rx);
+	len = mqtt_rx_read(rx, data, sizeof(data));
+	if (len == 0) {
+		return -EINVAL;
+	}
 
 	/* 4 bytes message */
 	rc = mqtt_unpack_unsuback(data, len, &pkt_id);
@@ -0,0 +1,30 @@
+/*
+ * Copyright (c) 2016 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __INC_sys_time_h__
+#define __INC_sys_time_h__
+
+#if !defined(_TIMEVAL_DEFINED)
+#define _TIMEVAL_DEFINED
+
+struct timeval {
+	long tv_sec;
+	long tv_usec;
+};
+
+#endif
+
+#endif /* __INC_sys_time_h__ */
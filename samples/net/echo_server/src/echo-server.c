@@ -434,10 +434,17 @@ static void tcp_received(struct net_context *context,
 			 void *user_data)
 {
 	static char dbg[MAX_DBG_PRINT + 1];
-	sa_family_t family = net_nbuf_family(buf);
 	struct net_buf *reply_buf;
+	sa_family_t family;
 	int ret;
 
+	if (!buf) {
+		/* The peer closed the connection */
+		return;
+	}
+
+	family = net_nbuf_family(buf);
+
 	snprintf(dbg, MAX_DBG_PRINT, "TCP IPv%c",
 		 family == AF_INET6 ? '6' : '4');
 
@@ -144,6 +144,36 @@ void net_buf_put(struct k_fifo *fifo, struct net_buf *buf)
 	k_fifo_put_list(fifo, buf, tail);
 }
 
+void net_buf_put_list(struct k_fifo *fifo, struct net_buf **bufs, int count)
+{
+	struct net_buf *tail = NULL;
+	int i;
+
+	NET_BUF_ASSERT(fifo);
+
+	if (!count) {
+		return;
+	}
+
+	for (i = 0; i < count; i++) {
+		NET_BUF_ASSERT(bufs[i]);
+
+		/* The last fragment of the previous buffer points to the
+		 * next buffer, net_buf_get() terminates the fragment list
+		 * when taking the buffer out of the FIFO.
+		 */
+		if (tail) {
+			tail->frags = bufs[i];
+		}
+
+		for (tail = bufs[i]; tail->frags; tail = tail->frags) {
+			tail->flags |= NET_BUF_FRAGS;
+		}
+	}
+
+	k_fifo_put_list(fifo, bufs[0], tail);
+}
+
 #if defined(CONFIG_NET_BUF_DEBUG)
 void net_buf_unref_debug(struct net_buf *buf, const char *func, int line)
 #else
@@ -55,6 +55,15 @@ static inline uint8_t get_6co_cid(struct net_icmpv6_nd_opt_6co *opt)
 }
 
 static struct net_6lo_context ctx_6co[CONFIG_NET_MAX_6LO_CONTEXTS];
+
+/* Contexts that can be used in compression, hashed by interface and
+ * 64 bit prefix. The entries are context index + 1, zero is free and
+ * collisions go to the next entry. The table is at least twice the
+ * size of the context table so the probing stays short.
+ */
+#define CTX_HASH_SIZE 32
+
+static uint8_t ctx_hash[CTX_HASH_SIZE];
 #endif
 
 /* TODO: Unicast-Prefix based IPv6 Multicast(dst) address compression
@@ -106,6 +115,43 @@ static inline bool net_6lo_maddr_48_bit_compressible(struct in6_addr *addr)
 }
 
 #if defined(CONFIG_NET_6LO_CONTEXT)
+static inline uint8_t ctx_hash_key(struct net_if *iface, const uint8_t *prefix)
+{
+	uint32_t key;
+
+	key = UNALIGNED_GET((uint32_t *)prefix) ^
+		UNALIGNED_GET((uint32_t *)(prefix + 4)) ^ (uintptr_t)iface;
+	key ^= key >> 16;
+	key ^= key >> 8;
+
+	return key & (CTX_HASH_SIZE - 1);
+}
+
+/* Contexts change rarely, so the hash is simply built again */
+static void ctx_hash_rebuild(void)
+{
+	uint8_t i, key;
+
+	memset(ctx_hash, 0, sizeof(ctx_hash));
+
+	for (i = 0; i < CONFIG_NET_MAX_6LO_CONTEXTS; i++) {
+		/* If compress flag is unset, the context is only used in
+		 * uncompression.
+		 */
+		if (!ctx_6co[i].is_used || !ctx_6co[i].compress) {
+			continue;
+		}
+
+		key = ctx_hash_key(ctx_6co[i].iface, ctx_6co[i].prefix.s6_addr);
+
+		while (ctx_hash[key]) {
+			key = (key + 1) & (CTX_HASH_SIZE - 1);
+		}
+
+		ctx_hash[key] = i + 1;
+	}
+}
+
 /* RFC 6775, 4.2, 5.4.2, 5.4.3 and 7.2*/
 static inline void set_6lo_context(struct net_if *iface, uint8_t index,
 				   struct net_icmpv6_nd_opt_6co *context)
@@ -142,11 +188,12 @@ void net_6lo_set_context(struct net_if *iface,
 			/* Remove if lifetime is zero */
 			if (!context->lifetime) {
 				ctx_6co[i].is_used = false;
-				return;
+			} else {
+				/* Update the context */
+				set_6lo_context(iface, i, context);
 			}
 
-			/* Update the context */
-			set_6lo_context(iface, i, context);
+			ctx_hash_rebuild();
 			return;
 		}
 	}
@@ -154,6 +201,7 @@ void net_6lo_set_context(struct net_if *iface,
 	/* Cache the context information. */
 	if (unused != -1) {
 		set_6lo_context(iface, unused, context);
+		ctx_hash_rebuild();
 		return;
 	}
 
@@ -179,505 +227,201 @@ get_6lo_context_by_cid(struct net_if *iface, uint8_t cid)
 	return NULL;
 }
 
-/* Get the context by addr */
+/* Get the context for compressing the addr */
 static inline struct net_6lo_context *
 get_6lo_context_by_addr(struct net_if *iface, struct in6_addr *addr)
 {
-	uint8_t i;
+	struct net_6lo_context *ctx;
+	uint8_t key, i;
 
-	for (i = 0; i < CONFIG_NET_MAX_6LO_CONTEXTS; i++) {
-		if (!ctx_6co[i].is_used) {
-			continue;
-		}
+	key = ctx_hash_key(iface, addr->s6_addr);
 
-		if (ctx_6co[i].iface == iface &&
-		    !memcmp(ctx_6co[i].prefix.s6_addr, addr->s6_addr, 8)) {
-			return &ctx_6co[i];
+	for (i = 0; i < CTX_HASH_SIZE && ctx_hash[key]; i++) {
+		ctx = &ctx_6co[ctx_hash[key] - 1];
+
+		if (ctx->iface == iface &&
+		    !memcmp(ctx->prefix.s6_addr, addr->s6_addr, 8)) {
+			return ctx;
 		}
+
+		key = (key + 1) & (CTX_HASH_SIZE - 1);
 	}
 
 	return NULL;
 }
-
 #endif
 
-/* Helper routine to compress Traffic class and Flow label */
-/* +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
- * |Version| Traffic Class |           Flow Label                  |
- * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
- * version: 4 bits, Traffic Class: 8 bits, Flow label: 20 bits
- * The Traffic Class field in the IPv6 header comprises 6 bits of
- * Diffserv extension [RFC2474] and 2 bits of Explicit Congestion
- * Notification (ECN) [RFC3168]
- */
+/* Bytes of an address that are carried in-line, indexed by SAM or DAM */
+struct addr_inline {
+	uint8_t pos;
+	uint8_t len;
+};
 
-/* IPHC (compressed) format of traffic class is ECN, DSCP but original
- * IPv6 traffic class format is DSCP, ECN.
- * DSCP(6), ECN(2).
+/* Unicast addresses, the rest comes from the link local or context
+ * prefix and the link layer address.
  */
-static inline uint8_t compress_tfl(struct net_ipv6_hdr *ipv6,
-				   struct net_buf *frag,
-				   uint8_t offset)
-{
-	uint8_t tcl;
-
-	tcl = ((ipv6->vtc & 0x0F) << 4) | ((ipv6->tcflow & 0xF0) >> 4);
-	tcl = (tcl << 6) | (tcl >> 2);   /* ECN(2), DSCP(6) */
-
-	if (((ipv6->tcflow & 0x0F) == 0) && (ipv6->flow == 0)) {
-		if (((ipv6->vtc & 0x0F) == 0) && ((ipv6->tcflow & 0xF0) == 0)) {
-			NET_DBG("Trafic class and Flow label elided");
-
-			/* Trafic class and Flow label elided */
-			IPHC[0] |= NET_6LO_IPHC_TF_11;
-		} else {
-			NET_DBG("Flow label elided");
-
-			/* Flow label elided */
-			IPHC[0] |= NET_6LO_IPHC_TF_10;
-			IPHC[offset++] = tcl;
-		}
-	} else {
-		if (((ipv6->vtc & 0x0F) == 0) && (ipv6->tcflow & 0x30)) {
-			NET_DBG("ECN + 2-bit Pad + Flow Label, DSCP is elided");
-
-			/* ECN + 2-bit Pad + Flow Label, DSCP is elided.*/
-			IPHC[0] |= NET_6LO_IPHC_TF_01;
-			IPHC[offset++] = (tcl & 0xC0) | (ipv6->tcflow & 0x0F);
-
-			memcpy(&IPHC[offset], &ipv6->flow, 2);
-			offset += 2;
-		} else {
-			NET_DBG("ECN + DSCP + 4-bit Pad + Flow Label");
-
-			/* ECN + DSCP + 4-bit Pad + Flow Label */
-			IPHC[0] |= NET_6LO_IPHC_TF_00;
-
-			/* Elide the version field */
-			IPHC[offset++] = tcl;
-			IPHC[offset++] = ipv6->tcflow & 0x0F;
-
-			memcpy(&IPHC[offset], &ipv6->flow, 2);
-			offset += 2;
-		}
-	}
-
-	return offset;
-}
-
-/* Helper to compress Hop limit */
-static inline uint8_t compress_hoplimit(struct net_ipv6_hdr *ipv6,
-					struct net_buf *frag,
-					uint8_t offset)
-{
-	/* Hop Limit */
-	switch (ipv6->hop_limit) {
-	case 1:
-		IPHC[0] |= NET_6LO_IPHC_HLIM1;
-		break;
-	case 64:
-		IPHC[0] |= NET_6LO_IPHC_HLIM64;
-		break;
-	case 255:
-		IPHC[0] |= NET_6LO_IPHC_HLIM255;
-		break;
-	default:
-		IPHC[offset++] = ipv6->hop_limit;
-		break;
-	}
-
-	return offset;
-}
-
-/* Helper to compress Next header */
-static inline uint8_t compress_nh(struct net_ipv6_hdr *ipv6,
-				  struct net_buf *frag, uint8_t offset)
+static const struct addr_inline addr_inline[4] = {
+	{ 0, 16 },	/* 00: full address */
+	{ 8, 8 },	/* 01: interface identifier */
+	{ 14, 2 },	/* 10: 0000:00ff:fe00:XXXX */
+	{ 16, 0 },	/* 11: from link layer address */
+};
+
+/* Multicast addresses (M = 1, DAC = 0). Modes 01 and 10 also carry
+ * the second byte of the address before these.
+ */
+static const struct addr_inline maddr_inline[4] = {
+	{ 0, 16 },	/* 00: full address */
+	{ 11, 5 },	/* 01: ffXX::00XX:XXXX:XXXX */
+	{ 13, 3 },	/* 10: ffXX::00XX:XXXX */
+	{ 15, 1 },	/* 11: ff02::00XX */
+};
+
+/* Hop limit by HLIM, 00 means it is carried in-line */
+static const uint8_t hlim_values[4] = { 0, 1, 64, 255 };
+
+/* SAM or DAM of a unicast address. Without a context only link local
+ * addresses padded with zeros can be compressed.
+ */
+static inline uint8_t addr_mode(struct in6_addr *addr,
+				struct net_linkaddr *lladdr, bool ctx)
 {
-	/* Next header */
-	if (ipv6->nexthdr == IPPROTO_UDP) {
-		IPHC[0] |= NET_6LO_IPHC_NH_1;
-	} else {
-		IPHC[offset++] = ipv6->nexthdr;
+	if (!ctx && !(net_is_ipv6_ll_addr(addr) &&
+		      net_6lo_ll_prefix_padded_with_zeros(addr))) {
+		return NET_6LO_IPHC_DAM_00;
 	}
 
-	return offset;
-}
-
-/* Helpers to compress Source Address */
-static inline uint8_t compress_sa(struct net_ipv6_hdr *ipv6,
-				  struct net_buf *buf,
-				  struct net_buf *frag,
-				  uint8_t offset)
-{
-	if (net_is_ipv6_addr_unspecified(&ipv6->src)) {
-		NET_DBG("SAM_00, SAC_1 unspecified src address");
-
-		/* Unspecified IPv6 src address */
-		IPHC[1] |= NET_6LO_IPHC_SAC_1;
-		IPHC[1] |= NET_6LO_IPHC_SAM_00;
-
-		return offset;
+	/* Following 64 bits are 0000:00ff:fe00:XXXX */
+	if (net_6lo_addr_16_bit_compressible(addr)) {
+		return NET_6LO_IPHC_DAM_10;
 	}
 
-	/* If address is link-local prefix and padded with zeros */
-	if (net_is_ipv6_ll_addr(&ipv6->src) &&
-	    net_6lo_ll_prefix_padded_with_zeros(&ipv6->src)) {
-
-		NET_DBG("SAC_0 src is ll_addr and padded with zeros");
-
-		/* Following 64 bits are 0000:00ff:fe00:XXXX */
-		if (net_6lo_addr_16_bit_compressible(&ipv6->src)) {
-			NET_DBG("SAM_10 src addr 16 bit compressible");
-
-			IPHC[1] |= NET_6LO_IPHC_SAM_10;
-
-			memcpy(&IPHC[offset], &ipv6->src.s6_addr[14], 2);
-			offset += 2;
-		} else {
-			if (net_ipv6_addr_based_on_ll(&ipv6->src,
-						      net_nbuf_ll_src(buf))) {
-				NET_DBG("SAM_11 src address is fully elided");
-
-				/* Address is fully elided */
-				IPHC[1] |= NET_6LO_IPHC_SAM_11;
-			} else {
-				NET_DBG("SAM_01 src 64 bits are inlined");
-
-				/* Remaining 64 bits are in-line */
-				IPHC[1] |= NET_6LO_IPHC_SAM_01;
-
-				memcpy(&IPHC[offset], &ipv6->src.s6_addr[8], 8);
-				offset += 8;
-			}
-		}
-	} else {
-		NET_DBG("SAM_00 full src address is carried in-line");
-		/* full address is carried in-line */
-		IPHC[1] |= NET_6LO_IPHC_SAM_00;
-
-		memcpy(&IPHC[offset], ipv6->src.s6_addr,
-		       sizeof(struct in6_addr));
-		offset += sizeof(struct in6_addr);
+	if (net_ipv6_addr_based_on_ll(addr, lladdr)) {
+		return NET_6LO_IPHC_DAM_11;
 	}
 
-	return offset;
+	return NET_6LO_IPHC_DAM_01;
 }
 
-#if defined(CONFIG_NET_6LO_CONTEXT)
-static inline uint8_t compress_sa_ctx(struct net_ipv6_hdr *ipv6,
-				      struct net_buf *buf,
-				      struct net_buf *frag,
-				      uint8_t offset,
-				      struct net_6lo_context *src)
+static inline uint8_t maddr_mode(struct in6_addr *addr)
 {
-	if (!src) {
-		return compress_sa(ipv6, buf, frag, offset);
+	if (net_6lo_maddr_8_bit_compressible(addr)) {
+		return NET_6LO_IPHC_DAM_11;
 	}
 
-	IPHC[1] |= NET_6LO_IPHC_SAC_1;
-
-	/* Following 64 bits are 0000:00ff:fe00:XXXX */
-	if (net_6lo_addr_16_bit_compressible(&ipv6->src)) {
-		NET_DBG("SAM_10 src addr 16 bit compressible");
-
-		IPHC[1] |= NET_6LO_IPHC_SAM_10;
-
-		memcpy(&IPHC[offset], &ipv6->src.s6_addr[14], 2);
-		offset += 2;
-	} else if (net_ipv6_addr_based_on_ll(&ipv6->src,
-					     net_nbuf_ll_src(buf))) {
-		NET_DBG("SAM_11 src address is fully elided");
-
-		/* Address is fully elided */
-		IPHC[1] |= NET_6LO_IPHC_SAM_11;
-	} else {
-		NET_DBG("SAM_01 src remaining 64 bits are inlined");
-
-		/* Remaining 64 bits are in-line */
-		IPHC[1] |= NET_6LO_IPHC_SAM_01;
-
-		memcpy(&IPHC[offset], &ipv6->src.s6_addr[8], 8);
-		offset += 8;
+	if (net_6lo_maddr_32_bit_compressible(addr)) {
+		return NET_6LO_IPHC_DAM_10;
 	}
 
-	return offset;
-}
-#endif
-
-/* Helpers to compress Destination Address */
-static inline uint8_t compress_da_mcast(struct net_ipv6_hdr *ipv6,
-					struct net_buf *buf,
-					struct net_buf *frag,
-					uint8_t offset)
-{
-	IPHC[1] |= NET_6LO_IPHC_M_1;
-
-	NET_DBG("M_1 dst is mcast");
-
-	if (net_6lo_maddr_8_bit_compressible(&ipv6->dst)) {
-		NET_DBG("DAM_11 dst maddr 8 bit compressible");
-
-		/* last byte */
-		IPHC[1] |= NET_6LO_IPHC_DAM_11;
-
-		memcpy(&IPHC[offset], &ipv6->dst.s6_addr[15], 1);
-		offset++;
-	} else if (net_6lo_maddr_32_bit_compressible(&ipv6->dst)) {
-		NET_DBG("DAM_10 4 bytes: 2nd byte + last three bytes");
-
-		/* 4 bytes: 2nd byte + last three bytes */
-		IPHC[1] |= NET_6LO_IPHC_DAM_10;
-
-		memcpy(&IPHC[offset], &ipv6->dst.s6_addr[1], 1);
-		offset++;
-
-		memcpy(&IPHC[offset], &ipv6->dst.s6_addr[13], 3);
-		offset += 3;
-	} else if (net_6lo_maddr_48_bit_compressible(&ipv6->dst)) {
-		NET_DBG("DAM_01 6 bytes: 2nd byte + last five bytes");
-
-		/* 6 bytes: 2nd byte + last five bytes */
-		IPHC[1] |= NET_6LO_IPHC_DAM_01;
-
-		memcpy(&IPHC[offset], &ipv6->dst.s6_addr[1], 1);
-		offset++;
-
-		memcpy(&IPHC[offset], &ipv6->dst.s6_addr[11], 5);
-		offset += 5;
-	} else {
-		NET_DBG("DAM_00 dst complete addr inlined");
-
-		/* complete address IPHC[1] |= NET_6LO_IPHC_DAM_00 */
-		memcpy(&IPHC[offset], &ipv6->dst.s6_addr[0], 16);
-		offset += 16;
+	if (net_6lo_maddr_48_bit_compressible(addr)) {
+		return NET_6LO_IPHC_DAM_01;
 	}
 
-	return offset;
-
+	return NET_6LO_IPHC_DAM_00;
 }
 
-static inline uint8_t compress_da(struct net_ipv6_hdr *ipv6,
-				  struct net_buf *buf,
-				  struct net_buf *frag,
-				  uint8_t offset)
+/* +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ * |Version| Traffic Class |           Flow Label                  |
+ * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ * The Traffic Class is DSCP(6), ECN(2) in the IPv6 header but
+ * ECN(2), DSCP(6) in IPHC.
+ */
+static inline uint8_t compress_tf(struct net_ipv6_hdr *ipv6,
+				  uint8_t *iphc, uint8_t offset)
 {
-	/* if destination address is multicast */
-	if (net_is_ipv6_addr_mcast(&ipv6->dst)) {
-		return compress_da_mcast(ipv6, buf, frag, offset);
-	}
-
-	/* If address is link-local prefix and padded with zeros */
-	if (net_is_ipv6_ll_addr(&ipv6->dst) &&
-	    net_6lo_ll_prefix_padded_with_zeros(&ipv6->dst)) {
-
-		NET_DBG("Dst is ll_addr and padded with zeros");
-
-		/* Following 64 bits are 0000:00ff:fe00:XXXX */
-		if (net_6lo_addr_16_bit_compressible(&ipv6->dst)) {
-			NET_DBG("DAM_10 dst addr 16 bit compressible");
+	uint8_t tc, tcl;
 
-			IPHC[1] |= NET_6LO_IPHC_DAM_10;
+	tc = ((ipv6->vtc & 0x0F) << 4) | (ipv6->tcflow >> 4);
+	tcl = (tc << 6) | (tc >> 2);
 
-			memcpy(&IPHC[offset], &ipv6->dst.s6_addr[14], 2);
-			offset += 2;
+	if (!(ipv6->tcflow & 0x0F) && !ipv6->flow) {
+		if (!tc) {
+			/* Traffic class and Flow label elided */
+			iphc[0] |= NET_6LO_IPHC_TF_11;
 		} else {
-			if (net_ipv6_addr_based_on_ll(&ipv6->dst,
-						      net_nbuf_ll_dst(buf))) {
-				NET_DBG("DAM_11 dst addr fully elided");
-
-				/* Address is fully elided */
-				IPHC[1] |= NET_6LO_IPHC_DAM_11;
-			} else {
-				NET_DBG("DAM_01 remaining 64 bits are inlined");
-
-				/* Remaining 64 bits are in-line */
-				IPHC[1] |= NET_6LO_IPHC_DAM_01;
-
-				memcpy(&IPHC[offset], &ipv6->dst.s6_addr[8], 8);
-				offset += 8;
-			}
+			/* Flow label elided */
+			iphc[0] |= NET_6LO_IPHC_TF_10;
+			iphc[offset++] = tcl;
 		}
-	} else {
-		NET_DBG("DAM_00 dst full addr inlined");
-		IPHC[1] |= NET_6LO_IPHC_DAM_00;
-
-		memcpy(&IPHC[offset], &ipv6->dst.s6_addr[0], 16);
-		offset += 16;
-	}
-
-	return offset;
-}
 
-#if defined(CONFIG_NET_6LO_CONTEXT)
-static inline uint8_t compress_da_ctx(struct net_ipv6_hdr *ipv6,
-				      struct net_buf *buf,
-				      struct net_buf *frag,
-				      uint8_t offset,
-				      struct net_6lo_context *dst)
-{
-	if (!dst) {
-		return compress_da(ipv6, buf, frag, offset);
+		return offset;
 	}
 
-	IPHC[1] |= NET_6LO_IPHC_DAC_1;
-
-	/* Following 64 bits are 0000:00ff:fe00:XXXX */
-	if (net_6lo_addr_16_bit_compressible(&ipv6->dst)) {
-		NET_DBG("DAM_10 dst addr 16 bit compressible");
-
-		IPHC[1] |= NET_6LO_IPHC_DAM_10;
-
-		memcpy(&IPHC[offset], &ipv6->dst.s6_addr[14], 2);
-		offset += 2;
+	if (!(tc >> 2)) {
+		/* ECN + 2-bit Pad + Flow Label, DSCP is elided */
+		iphc[0] |= NET_6LO_IPHC_TF_01;
+		iphc[offset++] = (tcl & 0xC0) | (ipv6->tcflow & 0x0F);
 	} else {
-		if (net_ipv6_addr_based_on_ll(&ipv6->dst,
-					      net_nbuf_ll_dst(buf))) {
-
-			NET_DBG("DAM_11 dst addr fully elided");
+		/* ECN + DSCP + 4-bit Pad + Flow Label */
+		iphc[0] |= NET_6LO_IPHC_TF_00;
+		iphc[offset++] = tcl;
+		iphc[offset++] = ipv6->tcflow & 0x0F;
+	}
 
-			/* Address is fully elided */
-			IPHC[1] |= NET_6LO_IPHC_DAM_11;
-		} else {
-			NET_DBG("DAM_01 remaining 64 bits are inlined");
+	memcpy(&iphc[offset], &ipv6->flow, 2);
 
-			/* Remaining 64 bits are in-line */
-			IPHC[1] |= NET_6LO_IPHC_DAM_01;
+	return offset + 2;
+}
 
-			memcpy(&IPHC[offset], &ipv6->dst.s6_addr[8], 8);
-			offset += 8;
-		}
-	}
+static inline uint8_t compress_addr(struct in6_addr *addr, uint8_t *iphc,
+				    uint8_t offset,
+				    const struct addr_inline *mode)
+{
+	memcpy(&iphc[offset], &addr->s6_addr[mode->pos], mode->len);
 
-	return offset;
+	return offset + mode->len;
 }
-#endif
 
-/* Helper to compress Next header UDP */
+/* 4.3.3 UDP LOWPAN_NHC Format
+ *   0   1   2   3   4   5   6   7
+ * +---+---+---+---+---+---+---+---+
+ * | 1 | 1 | 1 | 1 | 0 | C |   P   |
+ * +---+---+---+---+---+---+---+---+
+ *
+ * Port compression
+ * 00:  All 16 bits for src and dst are inlined.
+ * 01:  All 16 bits for src port inlined. First 8 bits of dst port is
+ *      0xf0 and elided.  The remaining 8 bits of dst port inlined.
+ * 10:  First 8 bits of src port 0xf0 and elided. The remaining 8 bits
+ *      of src port inlined. All 16 bits of dst port inlined.
+ * 11:  First 12 bits of both src and dst are 0xf0b and elided. The
+ *      remaining 4 bits for each are inlined.
+ *
+ * The checksum is always carried in-line and the length is elided.
+ */
 static inline uint8_t compress_nh_udp(struct net_udp_hdr *udp,
-				      struct net_buf *frag, uint8_t offset)
+				      uint8_t *iphc, uint8_t offset)
 {
-	uint8_t tmp;
-
-	/* 4.3.3 UDP LOWPAN_NHC Format
-	 *   0   1   2   3   4   5   6   7
-	 * +---+---+---+---+---+---+---+---+
-	 * | 1 | 1 | 1 | 1 | 0 | C |   P   |
-	 * +---+---+---+---+---+---+---+---+
-	 */
-
-	/* Port compression
-	 * 00:  All 16 bits for src and dst are inlined.
-	 * 01:  All 16 bits for src port inlined. First 8 bits of dst port is
-	 *      0xf0 and elided.  The remaining 8 bits of dst port inlined.
-	 * 10:  First 8 bits of src port 0xf0 and elided. The remaining 8 bits
-	 *      of src port inlined. All 16 bits of dst port inlined.
-	 * 11:  First 12 bits of both src and dst are 0xf0b and elided. The
-	 *      remaining 4 bits for each are inlined.
-	 */
-
-	if ((((htons(udp->src_port) >> 4) & 0xFFF) ==
-	    NET_6LO_NHC_UDP_4_BIT_PORT) &&
-	    (((htons(udp->dst_port) >> 4) & 0xFFF) ==
-	    NET_6LO_NHC_UDP_4_BIT_PORT)) {
-
-		NET_DBG("udp ports src and dst 4 bits inlined");
-		/** src: first 16 bits elided, next 4 bits inlined
-		  * dst: first 16 bits elided, next 4 bits inlined
-		  */
-		IPHC[offset] |= NET_6LO_NHC_UDP_PORT_11;
-		offset++;
-
-		tmp = (uint8_t)(htons(udp->src_port));
-		tmp = tmp << 4;
-
-		tmp |= (((uint8_t)(htons(udp->dst_port))) & 0x0F);
-		IPHC[offset++] = tmp;
-	} else if (((htons(udp->dst_port) >> 8) & 0xFF) ==
-		   NET_6LO_NHC_UDP_8_BIT_PORT) {
-
-		NET_DBG("udp ports src full, dst 8 bits inlined");
-		/** dst: first 8 bits elided, next 8 bits inlined
-		  * src: fully carried inline
-		  */
-		IPHC[offset] |= NET_6LO_NHC_UDP_PORT_01;
-		offset++;
-
-		memcpy(&IPHC[offset], &udp->src_port, 2);
+	uint16_t src_port = ntohs(udp->src_port);
+	uint16_t dst_port = ntohs(udp->dst_port);
+	uint8_t *nhc = &iphc[offset++];
+
+	*nhc = NET_6LO_NHC_UDP_BARE;
+
+	if ((src_port >> 4) == NET_6LO_NHC_UDP_4_BIT_PORT &&
+	    (dst_port >> 4) == NET_6LO_NHC_UDP_4_BIT_PORT) {
+		*nhc |= NET_6LO_NHC_UDP_PORT_11;
+		iphc[offset++] = (src_port << 4) | (dst_port & 0x0F);
+	} else if ((dst_port >> 8) == NET_6LO_NHC_UDP_8_BIT_PORT) {
+		*nhc |= NET_6LO_NHC_UDP_PORT_01;
+		memcpy(&iphc[offset], &udp->src_port, 2);
 		offset += 2;
-
-		IPHC[offset++] = (uint8_t)(htons(udp->dst_port));
-	} else if (((htons(udp->src_port) >> 8) & 0xFF) ==
-		    NET_6LO_NHC_UDP_8_BIT_PORT) {
-
-		NET_DBG("udp ports src 8bits, dst full inlined");
-		/** src: first 8 bits elided, next 8 bits inlined
-		  * dst: fully carried inline
-		  */
-		IPHC[offset] |= NET_6LO_NHC_UDP_PORT_10;
-		offset++;
-
-		IPHC[offset++] = (uint8_t)(htons(udp->src_port));
-
-		memcpy(&IPHC[offset], &udp->dst_port, 2);
+		iphc[offset++] = dst_port;
+	} else if ((src_port >> 8) == NET_6LO_NHC_UDP_8_BIT_PORT) {
+		*nhc |= NET_6LO_NHC_UDP_PORT_10;
+		iphc[offset++] = src_port;
+		memcpy(&iphc[offset], &udp->dst_port, 2);
 		offset += 2;
 	} else {
-		NET_DBG("can not compress ports, ports are inlined");
-
-		/* can not compress ports, ports are inlined */
-		offset++;
-		memcpy(&IPHC[offset], &udp->src_port, 4);
+		memcpy(&iphc[offset], &udp->src_port, 4);
 		offset += 4;
 	}
 
-	/* All 16 bits of udp chksum are inlined, length is elided */
-	memcpy(&IPHC[offset], &udp->chksum, 2);
-	offset += 2;
+	memcpy(&iphc[offset], &udp->chksum, 2);
 
-	return offset;
+	return offset + 2;
 }
 
-#if defined(CONFIG_NET_6LO_CONTEXT)
-static inline bool is_src_and_dst_addr_ctx_based(struct net_ipv6_hdr *ipv6,
-						 struct net_buf *buf,
-						 struct net_buf *frag,
-						 struct net_6lo_context **src,
-						 struct net_6lo_context **dst)
-{
-	/* If compress flag is unset means use only in uncompression. */
-
-	*src = get_6lo_context_by_addr(net_nbuf_iface(buf), &ipv6->src);
-	if (*src && !((*src)->compress)) {
-		*src = NULL;
-	}
-
-	*dst = get_6lo_context_by_addr(net_nbuf_iface(buf), &ipv6->dst);
-	if (*dst && !((*dst)->compress)) {
-		*dst = NULL;
-	}
-
-	if (!*src && !*dst) {
-		return false;
-	}
-
-	NET_DBG("Context based compression");
-	IPHC[1] |= NET_6LO_IPHC_CID_1;
-	IPHC[2] = 0;
-
-	if (*src) {
-		NET_DBG("Src addr context cid %d", (*src)->cid);
-		IPHC[2] = (*src)->cid << 4;
-	}
-
-	if (*dst) {
-		NET_DBG("Dst addr context cid %d", (*dst)->cid);
-		IPHC[2] |= (*dst)->cid;
-	}
-
-	return true;
-}
-
-#endif
-
 /* RFC 6282 LOWPAN IPHC Encoding format (3.1)
  *  Base Format
  *   0                                       1
@@ -685,704 +429,552 @@ static inline bool is_src_and_dst_addr_ctx_based(struct net_ipv6_hdr *ipv6,
  * +---+---+---+---+---+---+---+---+---+---+---+---+---+---+---+---+
  * | 0 | 1 | 1 |  TF   |NH | HLIM  |CID|SAC|  SAM  | M |DAC|  DAM  |
  * +---+---+---+---+---+---+---+---+---+---+---+---+---+---+---+---+
+ *
+ * The IPHC header is built on the stack and written over the end of
+ * the headers it replaces, it is never longer than they are.
  */
 static inline bool compress_IPHC_header(struct net_buf *buf,
 					fragment_handler_t fragment)
 {
+	struct net_ipv6_hdr *ipv6 = NET_IPV6_BUF(buf);
+	struct net_buf *frag = buf->frags;
+	uint8_t iphc[NET_IPV6UDPH_LEN];
+	uint8_t compressed = NET_IPV6H_LEN;
+	uint8_t offset = 2;
+	bool sac = false;
+	bool dac = false;
+	uint8_t mode;
 #if defined(CONFIG_NET_6LO_CONTEXT)
-	struct net_6lo_context *src = NULL;
-	struct net_6lo_context *dst = NULL;
+	struct net_6lo_context *ctx;
+	uint8_t cid = 0;
 #endif
-	struct net_ipv6_hdr *ipv6 = NET_IPV6_BUF(buf);
-	uint8_t offset = 0;
-	struct net_udp_hdr *udp;
-	struct net_buf *frag;
-	uint8_t compressed;
 
-	if (buf->frags->len < NET_IPV6H_LEN) {
+	if (frag->len < NET_IPV6H_LEN) {
 		NET_DBG("Invalid length %d, min %d",
-			buf->frags->len, NET_IPV6H_LEN);
+			frag->len, NET_IPV6H_LEN);
 		return false;
 	}
 
-	if (ipv6->nexthdr == IPPROTO_UDP &&
-	    buf->frags->len < NET_IPV6UDPH_LEN) {
-		NET_DBG("Invalid length %d, min %d",
-			buf->frags->len, NET_IPV6UDPH_LEN);
-		return false;
-	}
+	if (ipv6->nexthdr == IPPROTO_UDP) {
+		if (frag->len < NET_IPV6UDPH_LEN) {
+			NET_DBG("Invalid length %d, min %d",
+				frag->len, NET_IPV6UDPH_LEN);
+			return false;
+		}
 
-	frag = net_nbuf_get_reserve_data(net_nbuf_ll_reserve(buf));
-	if (!frag) {
-		return false;
+		compressed += NET_UDPH_LEN;
 	}
 
-	IPHC[offset++] = NET_6LO_DISPATCH_IPHC;
-	IPHC[offset++] = 0;
+	iphc[0] = NET_6LO_DISPATCH_IPHC;
+	iphc[1] = 0;
 
 #if defined(CONFIG_NET_6LO_CONTEXT)
-	if (is_src_and_dst_addr_ctx_based(ipv6, buf, frag, &src, &dst)) {
-		offset++;
+	if (!net_is_ipv6_addr_unspecified(&ipv6->src)) {
+		ctx = get_6lo_context_by_addr(net_nbuf_iface(buf), &ipv6->src);
+		if (ctx) {
+			sac = true;
+			cid = ctx->cid << 4;
+		}
 	}
-#endif
 
-	/* Compress Traffic class and Flow lablel */
-	offset = compress_tfl(ipv6, frag, offset);
-
-	/* Hop limit */
-	offset = compress_hoplimit(ipv6, frag, offset);
+	if (!net_is_ipv6_addr_mcast(&ipv6->dst)) {
+		ctx = get_6lo_context_by_addr(net_nbuf_iface(buf), &ipv6->dst);
+		if (ctx) {
+			dac = true;
+			cid |= ctx->cid;
+		}
+	}
 
-	/* Next Header */
-	offset = compress_nh(ipv6, frag, offset);
+	/* Context 0 is used when the CID extension is left out */
+	if (cid) {
+		NET_DBG("Context based compression, cid 0x%02x", cid);
 
-	/* Source Address Compression */
-#if defined(CONFIG_NET_6LO_CONTEXT)
-	offset = compress_sa_ctx(ipv6, buf, frag, offset, src);
-#else
-	offset = compress_sa(ipv6, buf, frag, offset);
+		iphc[1] |= NET_6LO_IPHC_CID_1;
+		iphc[offset++] = cid;
+	}
 #endif
 
-	/* Destination Address Compression */
-#if defined(CONFIG_NET_6LO_CONTEXT)
-	offset = compress_da_ctx(ipv6, buf, frag, offset, dst);
-#else
-	offset = compress_da(ipv6, buf, frag, offset);
-#endif
+	offset = compress_tf(ipv6, iphc, offset);
 
-	compressed = NET_IPV6H_LEN;
+	if (ipv6->nexthdr == IPPROTO_UDP) {
+		iphc[0] |= NET_6LO_IPHC_NH_1;
+	} else {
+		iphc[offset++] = ipv6->nexthdr;
+	}
 
-	if (ipv6->nexthdr != IPPROTO_UDP) {
-		NET_DBG("next header is not UDP (%u)", ipv6->nexthdr);
-		goto end;
+	for (mode = NET_6LO_IPHC_HLIM255; mode; mode--) {
+		if (hlim_values[mode] == ipv6->hop_limit) {
+			break;
+		}
 	}
 
-	/* UDP header compression */
-	udp = NET_UDP_BUF(buf);
-	IPHC[offset] = NET_6LO_NHC_UDP_BARE;
-	offset = compress_nh_udp(udp, frag, offset);
+	if (mode) {
+		iphc[0] |= mode;
+	} else {
+		iphc[offset++] = ipv6->hop_limit;
+	}
 
-	compressed += NET_UDPH_LEN;
+	if (net_is_ipv6_addr_unspecified(&ipv6->src)) {
+		/* SAC = 1, SAM = 00 */
+		iphc[1] |= NET_6LO_IPHC_SAC_1;
+	} else {
+		mode = addr_mode(&ipv6->src, net_nbuf_ll_src(buf), sac);
 
-end:
-	net_buf_add(frag, offset);
+		iphc[1] |= (sac ? NET_6LO_IPHC_SAC_1 : 0) | (mode << 4);
+		offset = compress_addr(&ipv6->src, iphc, offset,
+				       &addr_inline[mode]);
+	}
 
-	/* copy the rest of the data to compressed fragment */
-	memcpy(&IPHC[offset], buf->frags->data + compressed,
-	       buf->frags->len - compressed);
-	net_buf_add(frag, buf->frags->len - compressed);
+	if (net_is_ipv6_addr_mcast(&ipv6->dst)) {
+		mode = maddr_mode(&ipv6->dst);
 
-	/* Delete uncompressed(original) header fragment */
-	net_buf_frag_del(buf, buf->frags);
+		iphc[1] |= NET_6LO_IPHC_M_1 | mode;
 
-	/* Insert compressed header fragment */
-	net_buf_frag_insert(buf, frag);
+		if (mode == NET_6LO_IPHC_DAM_01 ||
+		    mode == NET_6LO_IPHC_DAM_10) {
+			iphc[offset++] = ipv6->dst.s6_addr[1];
+		}
 
-	/* Compact the fragments, so that gaps will be filled */
-	net_nbuf_compact(buf->frags);
+		offset = compress_addr(&ipv6->dst, iphc, offset,
+				       &maddr_inline[mode]);
+	} else {
+		mode = addr_mode(&ipv6->dst, net_nbuf_ll_dst(buf), dac);
+
+		iphc[1] |= (dac ? NET_6LO_IPHC_DAC_1 : 0) | mode;
+		offset = compress_addr(&ipv6->dst, iphc, offset,
+				       &addr_inline[mode]);
+	}
+
+	if (ipv6->nexthdr == IPPROTO_UDP) {
+		offset = compress_nh_udp((struct net_udp_hdr *)
+					 (frag->data + NET_IPV6H_LEN),
+					 iphc, offset);
+	}
+
+	NET_DBG("Compressed %u bytes of headers to %u", compressed, offset);
+
+	if (net_nbuf_is_ext(frag)) {
+		/* External data is not written to */
+		frag = net_nbuf_get_reserve_data(net_nbuf_ll_reserve(buf));
+		if (!frag) {
+			return false;
+		}
+
+		net_buf_pull(buf->frags, compressed);
+		net_buf_frag_insert(buf, frag);
+		net_buf_add(frag, offset);
+	} else {
+		net_buf_pull(frag, compressed - offset);
+	}
 
+	memcpy(frag->data, iphc, offset);
+
+	/* The fragment handler copies the data into frames anyway,
+	 * so the gaps only need to be filled when there is none.
+	 */
 	if (fragment) {
 		return fragment(buf, compressed - offset);
 	}
 
+	/* Compact the fragments, so that gaps will be filled */
+	net_nbuf_compact(buf->frags);
+
 	return true;
 }
 
-/* Helper to uncompress Traffic class and Flow label */
-static inline uint8_t uncompress_tfl(struct net_buf *buf,
-				     struct net_ipv6_hdr *ipv6,
-				     uint8_t offset)
+static inline uint8_t uncompress_tf(struct net_ipv6_hdr *ipv6,
+				    uint8_t *iphc, uint8_t offset)
 {
-	uint8_t tcl;
+	uint8_t tc;
 
-	/* Uncompress tcl and flow label */
-	switch (CIPHC[0] & NET_6LO_IPHC_TF_11) {
+	switch (iphc[0] & NET_6LO_IPHC_TF_11) {
 	case NET_6LO_IPHC_TF_00:
-		NET_DBG("ECN + DSCP + 4-bit Pad + Flow Label");
-
-		tcl = CIPHC[offset++];
-		tcl = (tcl >> 6) | (tcl << 2);
-
-		ipv6->vtc |= ((tcl & 0xF0) >> 4);
-		ipv6->tcflow = ((tcl & 0x0F) << 4) | (CIPHC[offset++] & 0x0F);
+		/* ECN + DSCP + 4-bit Pad + Flow Label */
+		tc = (iphc[offset] >> 6) | (iphc[offset] << 2);
+		offset++;
 
-		memcpy(&ipv6->flow, &CIPHC[offset], 2);
-		offset += 2;
+		ipv6->vtc |= tc >> 4;
+		ipv6->tcflow = (tc << 4) | (iphc[offset++] & 0x0F);
 		break;
 	case NET_6LO_IPHC_TF_01:
-		NET_DBG("ECN + 2-bit Pad + Flow Label, DSCP is elided");
-
-		tcl = ((CIPHC[offset] & 0xF0) >> 6);
-		ipv6->tcflow = ((tcl & 0x0F) << 4) | (CIPHC[offset++] & 0x0F);
-
-		memcpy(&ipv6->flow, &CIPHC[offset], 2);
-		offset += 2;
+		/* ECN + 2-bit Pad + Flow Label, DSCP is elided */
+		ipv6->tcflow = ((iphc[offset] >> 6) << 4) |
+			(iphc[offset] & 0x0F);
+		offset++;
 		break;
 	case NET_6LO_IPHC_TF_10:
-		NET_DBG("Flow label elided");
+		/* Flow label elided */
+		tc = (iphc[offset] >> 6) | (iphc[offset] << 2);
+		offset++;
 
-		tcl = CIPHC[offset];
-		tcl = (tcl >> 6) | (tcl << 2);
+		ipv6->vtc |= tc >> 4;
+		ipv6->tcflow = tc << 4;
 
-		ipv6->vtc |= ((tcl & 0xF0) >> 4);
-		ipv6->tcflow = (tcl & 0x0F) << 4;
-		ipv6->flow = 0;
-		offset++;
-		break;
+		return offset;
 	case NET_6LO_IPHC_TF_11:
-		NET_DBG("Tcl and Flow label elided");
-
-		ipv6->tcflow = 0;
-		ipv6->flow = 0;
-		break;
+		/* Traffic class and Flow label elided */
+		return offset;
 	}
 
-	return offset;
-}
-
-/* Helper to uncompress Hoplimit */
-static inline uint8_t uncompress_hoplimit(struct net_buf *buf,
-					  struct net_ipv6_hdr *ipv6,
-					  uint8_t offset)
-{
-	switch (CIPHC[0] & NET_6LO_IPHC_HLIM255) {
-	case NET_6LO_IPHC_HLIM:
-		ipv6->hop_limit = 0;
-		break;
-	case NET_6LO_IPHC_HLIM1:
-		ipv6->hop_limit = 1;
-		break;
-	case NET_6LO_IPHC_HLIM64:
-		ipv6->hop_limit = 64;
-		break;
-	case NET_6LO_IPHC_HLIM255:
-		ipv6->hop_limit = 255;
-		break;
-	default:
-		ipv6->hop_limit = CIPHC[offset++];
-		break;
-	}
+	memcpy(&ipv6->flow, &iphc[offset], 2);
 
-	return offset;
+	return offset + 2;
 }
 
-/* Helper to uncompress Source Address */
-static inline uint8_t uncompress_sa(struct net_buf *buf,
-				    struct net_ipv6_hdr *ipv6,
-				    uint8_t offset)
+/* Prefix is NULL for link local addresses */
+static inline uint8_t uncompress_addr(struct in6_addr *addr, uint8_t *iphc,
+				      uint8_t offset, uint8_t mode,
+				      const uint8_t *prefix,
+				      struct net_linkaddr *lladdr)
 {
-	if (CIPHC[1] & NET_6LO_IPHC_SAC_1) {
-		NET_DBG("SAC_1");
-		NET_DBG("SAM_00 unspecified address");
-		return offset;
-	}
-
-	NET_DBG("SAC_0");
-
-	switch (CIPHC[1] & NET_6LO_IPHC_SAM_11) {
-	case NET_6LO_IPHC_SAM_00:
-		NET_DBG("SAM_00 full src addr inlined");
-
-		memcpy(ipv6->src.s6_addr, &CIPHC[offset], 16);
-		offset += 16;
-		break;
-	case NET_6LO_IPHC_SAM_01:
-		NET_DBG("SAM_01 last 64 bits are inlined");
-
-		ipv6->src.s6_addr[0] = 0xFE;
-		ipv6->src.s6_addr[1] = 0x80;
-
-		memcpy(&ipv6->src.s6_addr[8], &CIPHC[offset], 8);
-		offset += 8;
-		break;
-	case NET_6LO_IPHC_SAM_10:
-		NET_DBG("SAM_10 src addr 16 bit compressed");
-
-		ipv6->src.s6_addr[0] = 0xFE;
-		ipv6->src.s6_addr[1] = 0x80;
-		ipv6->src.s6_addr[11] = 0xFF;
-		ipv6->src.s6_addr[12] = 0xFE;
-
-		memcpy(&ipv6->src.s6_addr[14], &CIPHC[offset], 2);
-		offset += 2;
+	switch (mode) {
+	case NET_6LO_IPHC_DAM_10:
+		addr->s6_addr[11] = 0xFF;
+		addr->s6_addr[12] = 0xFE;
 		break;
-	case NET_6LO_IPHC_SAM_11:
-		NET_DBG("SAM_11 generate src addr from ll");
-
-		net_ipv6_addr_create_iid(&ipv6->src, net_nbuf_ll_src(buf));
+	case NET_6LO_IPHC_DAM_11:
+		net_ipv6_addr_create_iid(addr, lladdr);
 		break;
 	}
 
-	return offset;
-}
-
-#if defined(CONFIG_NET_6LO_CONTEXT)
-static inline uint8_t uncompress_sa_ctx(struct net_buf *buf,
-					struct net_ipv6_hdr *ipv6,
-					uint8_t offset,
-					struct net_6lo_context *ctx)
-{
-	if (!ctx) {
-		return uncompress_sa(buf, ipv6, offset);
+	if (mode != NET_6LO_IPHC_DAM_00) {
+		if (prefix) {
+			memcpy(addr->s6_addr, prefix, 8);
+		} else {
+			addr->s6_addr[0] = 0xFE;
+			addr->s6_addr[1] = 0x80;
+		}
 	}
 
-	switch (CIPHC[1] & NET_6LO_IPHC_SAM_11) {
-	case NET_6LO_IPHC_SAM_01:
-		NET_DBG("SAM_01 last 64 bits are inlined");
-
-		/* First 8 bytes are from context */
-		memcpy(&ipv6->src.s6_addr[0], &ctx->prefix.s6_addr[0], 8);
-
-		/*And the rest are carried in-line*/
-		memcpy(&ipv6->src.s6_addr[8], &CIPHC[offset], 8);
-		offset += 8;
-
-		break;
-	case NET_6LO_IPHC_SAM_10:
-		NET_DBG("SAM_10 src addr 16 bit compressed");
-
-		/* First 8 bytes are from context */
-		memcpy(&ipv6->src.s6_addr[0], &ctx->prefix.s6_addr[0], 8);
-
-		ipv6->src.s6_addr[11] = 0xFF;
-		ipv6->src.s6_addr[12] = 0xFE;
-
-		/*And the restare carried in-line */
-		memcpy(&ipv6->src.s6_addr[14], &CIPHC[offset], 2);
-		offset += 2;
-
-		break;
-	case NET_6LO_IPHC_SAM_11:
-		NET_DBG("SAM_11 generate src addr from ll");
-		/* RFC 6282, 3.1.1. If SAC = 1 and SAM = 11
-		 * Derive addr using context information and
-		 * the encapsulating header.
-		 * (e.g., 802.15.4 or IPv6 source address).
-		 */
-		net_ipv6_addr_create_iid(&ipv6->src, net_nbuf_ll_src(buf));
+	memcpy(&addr->s6_addr[addr_inline[mode].pos], &iphc[offset],
+	       addr_inline[mode].len);
 
-		/* net_ipv6_addr_create_iid will copy first 8 bytes
-		 * as link local prefix.
-		 * Overwrite first 8 bytes from context prefix here.
-		 */
-		memcpy(&ipv6->src.s6_addr[0], &ctx->prefix.s6_addr[0], 8);
-		break;
-	}
-
-	return offset;
+	return offset + addr_inline[mode].len;
 }
-#endif
 
-/* Helpers to uncompress Destination Address */
-static inline uint8_t uncompress_da_mcast(struct net_buf *buf,
-					  struct net_ipv6_hdr *ipv6,
-					  uint8_t offset)
+static inline uint8_t uncompress_maddr(struct in6_addr *addr, uint8_t *iphc,
+				       uint8_t offset, uint8_t mode)
 {
-	NET_DBG("Dst is multicast");
-
-	if (CIPHC[1] & NET_6LO_IPHC_DAC_1) {
-		/* TODO: DAM00 Unicast-Prefix-based IPv6 Multicast Addresses */
-		/* Reserved DAM_01, DAM_10, DAM_11 */
-		return 0;
-	}
-
-	/** If M=1 and DAC=0:
-	  * 00: 128 bits, The full address is carried in-line.
-	  * 01:  48 bits, The address takes the form ffXX::00XX:XXXX:XXXX.
-	  * 10:  32 bits, The address takes the form ffXX::00XX:XXXX.
-	  * 11:   8 bits, The address takes the form ff02::00XX.
-	  */
-
-	switch (CIPHC[1] & NET_6LO_IPHC_DAM_11) {
-	case NET_6LO_IPHC_DAM_00:
-		NET_DBG("DAM_00 full dst addr inlined");
-
-		memcpy(&ipv6->dst.s6_addr[0], &CIPHC[offset], 16);
-		offset += 16;
-		break;
+	switch (mode) {
 	case NET_6LO_IPHC_DAM_01:
-		NET_DBG("DAM_01 2nd byte and last five bytes");
-
-		ipv6->dst.s6_addr[0] = 0xFF;
-		ipv6->dst.s6_addr[1] = CIPHC[offset++];
-
-		memcpy(&ipv6->dst.s6_addr[11], &CIPHC[offset], 5);
-		offset += 5;
-		break;
 	case NET_6LO_IPHC_DAM_10:
-		NET_DBG("DAM_10 2nd byte and last three bytes");
-
-		ipv6->dst.s6_addr[0] = 0xFF;
-		ipv6->dst.s6_addr[1] = CIPHC[offset++];
-
-		memcpy(&ipv6->dst.s6_addr[13], &CIPHC[offset], 3);
-		offset += 3;
+		addr->s6_addr[0] = 0xFF;
+		addr->s6_addr[1] = iphc[offset++];
 		break;
 	case NET_6LO_IPHC_DAM_11:
-		NET_DBG("DAM_11 8 bit compressed");
-
-		ipv6->dst.s6_addr[0] = 0xFF;
-		ipv6->dst.s6_addr[1] = 0x02;
-		ipv6->dst.s6_addr[15] = CIPHC[offset++];
+		addr->s6_addr[0] = 0xFF;
+		addr->s6_addr[1] = 0x02;
 		break;
 	}
 
-	return offset;
+	memcpy(&addr->s6_addr[maddr_inline[mode].pos], &iphc[offset],
+	       maddr_inline[mode].len);
+
+	return offset + maddr_inline[mode].len;
 }
 
-/* Helper to uncompress Destination Address */
-static inline uint8_t uncompress_da(struct net_buf *buf,
-				    struct net_ipv6_hdr *ipv6,
-				    uint8_t offset)
+static inline uint8_t uncompress_nh_udp(struct net_udp_hdr *udp,
+					uint8_t *iphc, uint8_t offset)
 {
-	if (CIPHC[1] & NET_6LO_IPHC_M_1) {
-		return uncompress_da_mcast(buf, ipv6, offset);
-	}
-
-	if (!((CIPHC[1] & NET_6LO_IPHC_DAC_0) == 0)) {
-		return 0;
-	}
-
-	NET_DBG("DAC_0");
+	uint8_t nhc = iphc[offset++];
 
-	switch (CIPHC[1] & NET_6LO_IPHC_DAM_11) {
-	case NET_6LO_IPHC_DAM_00:
-		NET_DBG("DAM_00 full dst addr inlined");
-
-		memcpy(&ipv6->dst.s6_addr[0], &CIPHC[offset], 16);
-		offset += 16;
+	switch (nhc & NET_6LO_NHC_UDP_PORT_11) {
+	case NET_6LO_NHC_UDP_PORT_00:
+		memcpy(&udp->src_port, &iphc[offset], 4);
+		offset += 4;
 		break;
-	case NET_6LO_IPHC_DAM_01:
-		NET_DBG("DAM_01 last 64 bits are inlined");
-
-		ipv6->dst.s6_addr[0] = 0xFE;
-		ipv6->dst.s6_addr[1] = 0x80;
+	case NET_6LO_NHC_UDP_PORT_01:
+		memcpy(&udp->src_port, &iphc[offset], 2);
+		offset += 2;
 
-		memcpy(&ipv6->dst.s6_addr[8], &CIPHC[offset], 8);
-		offset += 8;
+		udp->dst_port = htons(((uint16_t)NET_6LO_NHC_UDP_8_BIT_PORT
+				       << 8) | iphc[offset]);
+		offset++;
 		break;
-	case NET_6LO_IPHC_DAM_10:
-		NET_DBG("DAM_10 dst addr 16 bit compressed");
-
-		ipv6->dst.s6_addr[0] = 0xFE;
-		ipv6->dst.s6_addr[1] = 0x80;
-		ipv6->dst.s6_addr[11] = 0xFF;
-		ipv6->dst.s6_addr[12] = 0xFE;
+	case NET_6LO_NHC_UDP_PORT_10:
+		udp->src_port = htons(((uint16_t)NET_6LO_NHC_UDP_8_BIT_PORT
+				       << 8) | iphc[offset]);
+		offset++;
 
-		memcpy(&ipv6->dst.s6_addr[14], &CIPHC[offset], 2);
+		memcpy(&udp->dst_port, &iphc[offset], 2);
 		offset += 2;
 		break;
-	case NET_6LO_IPHC_DAM_11:
-		NET_DBG("DAM_11 generate dst addr from ll");
-
-		net_ipv6_addr_create_iid(&ipv6->dst, net_nbuf_ll_dst(buf));
+	case NET_6LO_NHC_UDP_PORT_11:
+		udp->src_port = htons((NET_6LO_NHC_UDP_4_BIT_PORT << 4) |
+				      (iphc[offset] >> 4));
+		udp->dst_port = htons((NET_6LO_NHC_UDP_4_BIT_PORT << 4) |
+				      (iphc[offset] & 0x0F));
+		offset++;
 		break;
 	}
 
+	if (!(nhc & NET_6LO_NHC_UDP_CHKSUM_1)) {
+		memcpy(&udp->chksum, &iphc[offset], 2);
+		offset += 2;
+	}
+
 	return offset;
 }
 
-#if defined(CONFIG_NET_6LO_CONTEXT)
-static inline uint8_t uncompress_da_ctx(struct net_buf *buf,
-					struct net_ipv6_hdr *ipv6,
-					uint8_t offset,
-					struct net_6lo_context *ctx)
+/* Number of bytes carried in-line after the two IPHC bytes */
+static inline uint8_t iphc_inline_len(const uint8_t *iphc)
 {
-	if (!ctx) {
-		return uncompress_da(buf, ipv6, offset);
-	}
+	static const uint8_t tf_len[4] = { 4, 3, 1, 0 };
+	uint8_t mode;
+	uint8_t len;
 
-	if (CIPHC[1] & NET_6LO_IPHC_M_1) {
-		return uncompress_da_mcast(buf, ipv6, offset);
-	}
+	len = tf_len[(iphc[0] & NET_6LO_IPHC_TF_11) >> 3];
 
-	if (!(CIPHC[1] & NET_6LO_IPHC_DAC_1)) {
-		return 0;
+	if (iphc[1] & NET_6LO_IPHC_CID_1) {
+		len++;
 	}
 
-	NET_DBG("DAC_1");
-
-	switch (CIPHC[1] & NET_6LO_IPHC_DAM_11) {
-	case NET_6LO_IPHC_DAM_01:
-		NET_DBG("DAM_01 last 64 bits are inlined");
-
-		/* First 8 bytes are from context */
-		memcpy(&ipv6->dst.s6_addr[0], &ctx->prefix.s6_addr[0], 8);
-
-		/* And the rest are carried in-line */
-		memcpy(&ipv6->dst.s6_addr[8], &CIPHC[offset], 8);
-		offset += 8;
+	if (!(iphc[0] & NET_6LO_IPHC_NH_1)) {
+		len++;
+	}
 
-		break;
-	case NET_6LO_IPHC_DAM_10:
-		NET_DBG("DAM_10 src addr 16 bit compressed");
+	if (!(iphc[0] & NET_6LO_IPHC_HLIM255)) {
+		len++;
+	}
 
-		/* First 8 bytes are from context */
-		memcpy(&ipv6->dst.s6_addr[0], &ctx->prefix.s6_addr[0], 8);
+	mode = (iphc[1] & NET_6LO_IPHC_SAM_11) >> 4;
+	if (mode || !(iphc[1] & NET_6LO_IPHC_SAC_1)) {
+		len += addr_inline[mode].len;
+	}
 
-		ipv6->dst.s6_addr[11] = 0xFF;
-		ipv6->dst.s6_addr[12] = 0xFE;
+	mode = iphc[1] & NET_6LO_IPHC_DAM_11;
+	if (!(iphc[1] & NET_6LO_IPHC_M_1)) {
+		len += addr_inline[mode].len;
+	} else if (mode == NET_6LO_IPHC_DAM_01 ||
+		   mode == NET_6LO_IPHC_DAM_10) {
+		len += maddr_inline[mode].len + 1;
+	} else {
+		len += maddr_inline[mode].len;
+	}
 
-		/* And the restare carried in-line */
-		memcpy(&ipv6->dst.s6_addr[14], &CIPHC[offset], 2);
-		offset += 2;
+	return len;
+}
 
-		break;
-	case NET_6LO_IPHC_DAM_11:
-		NET_DBG("DAM_11 generate src addr from ll");
+/* Number of bytes of the UDP NHC, including the NHC byte itself */
+static inline uint8_t nhc_udp_len(uint8_t nhc)
+{
+	static const uint8_t ports_len[4] = { 4, 3, 3, 1 };
 
-		/* RFC 6282, 3.1.1. If SAC = 1 and SAM = 11
-		 * Derive addr using context information and
-		 * the encapsulating header.
-		 * (e.g., 802.15.4 or IPv6 source address).
-		 */
-		net_ipv6_addr_create_iid(&ipv6->dst, net_nbuf_ll_dst(buf));
+	return 1 + ports_len[nhc & NET_6LO_NHC_UDP_PORT_11] +
+		((nhc & NET_6LO_NHC_UDP_CHKSUM_1) ? 0 : 2);
+}
 
-		/* net_ipv6_addr_create_iid will copy first 8 bytes
-		 * as link local prefix.
-		 * Overwrite first 8 bytes from context prefix here.
-		 */
-		memcpy(&ipv6->dst.s6_addr[0], &ctx->prefix.s6_addr[0], 8);
-		break;
+static inline void move_ll_addr(struct net_linkaddr *lladdr, uint8_t *ll,
+				uint16_t len, uint8_t diff)
+{
+	if (lladdr->addr >= ll && lladdr->addr < ll + len) {
+		lladdr->addr -= diff;
 	}
-
-	return offset;
 }
-#endif
 
-/* Helper to uncompress NH UDP */
-static inline uint8_t uncompress_nh_udp(struct net_buf *buf,
-					struct net_udp_hdr *udp,
-					uint8_t offset)
+/* Make room for the uncompressed headers in the first fragment. The
+ * payload is moved when there is tailroom, the link layer header when
+ * there is headroom. Radio drivers usually leave neither, so then the
+ * headers get a fragment of their own.
+ */
+static inline bool expand_headers(struct net_buf *buf, uint8_t offset,
+				  uint8_t hdr_len)
 {
-	/* Port uncompression
-	 * 00:  All 16 bits for src and dst are inlined
-	 * 01: src, 16 bits are lined, dst(0xf0) 8 bits are inlined
-	 * 10: dst, 16 bits are lined, src(0xf0) 8 bits are inlined
-	 * 11: src, dst (0xf0b) 4 bits are inlined
-	 */
-
-	/* UDP header uncompression */
-	switch (CIPHC[offset++] & NET_6LO_NHC_UDP_PORT_11) {
-	case NET_6LO_NHC_UDP_PORT_00:
-		NET_DBG("src and dst ports are inlined");
-
-		memcpy(&udp->src_port, &CIPHC[offset], 2);
-		offset += 2;
+	uint16_t reserve = net_nbuf_ll_reserve(buf);
+	struct net_buf *frag = buf->frags;
+	uint8_t diff = hdr_len - offset;
+	uint8_t *ll;
 
-		memcpy(&udp->dst_port, &CIPHC[offset], 2);
-		offset += 2;
-		break;
-	case NET_6LO_NHC_UDP_PORT_01:
-		NET_DBG("src full, dst 8 bits inlined");
+	if (net_buf_tailroom(frag) >= diff) {
+		memmove(frag->data + hdr_len, frag->data + offset,
+			frag->len - offset);
+		net_buf_add(frag, diff);
 
-		memcpy(&udp->src_port, &CIPHC[offset], 2);
-		offset += 2;
+		return true;
+	}
 
-		udp->dst_port = htons(((uint16_t)NET_6LO_NHC_UDP_8_BIT_PORT
-				       << 8) | CIPHC[offset]);
-		offset++;
-		break;
-	case NET_6LO_NHC_UDP_PORT_10:
-		NET_DBG("src 8 bits, dst full inlined");
+	if (net_buf_headroom(frag) >= reserve + diff) {
+		ll = net_nbuf_ll(buf);
 
-		udp->src_port = htons(((uint16_t)NET_6LO_NHC_UDP_8_BIT_PORT
-				       << 8) | CIPHC[offset]);
-		offset++;
+		memmove(ll - diff, ll, reserve);
 
-		memcpy(&udp->dst_port, &CIPHC[offset], 2);
-		offset += 2;
-		break;
-	case NET_6LO_NHC_UDP_PORT_11:
-		NET_DBG("src and dst 4 bits inlined");
+		move_ll_addr(net_nbuf_ll_src(buf), ll, reserve, diff);
+		move_ll_addr(net_nbuf_ll_dst(buf), ll, reserve, diff);
 
-		udp->src_port = htons((NET_6LO_NHC_UDP_4_BIT_PORT << 4) |
-				      (CIPHC[offset] >> 4));
+		net_buf_push(frag, diff);
 
-		udp->dst_port = htons((NET_6LO_NHC_UDP_4_BIT_PORT << 4) |
-				      (CIPHC[offset] & 0x0F));
-		offset++;
-		break;
+		return true;
 	}
 
-	return offset;
-}
+	frag = net_nbuf_get_reserve_data(reserve);
+	if (!frag) {
+		return false;
+	}
 
-#if defined(CONFIG_NET_6LO_CONTEXT)
-/* Helper function to uncompress src and dst contexts */
-static inline bool uncompress_cid(struct net_buf *buf,
-				  struct net_6lo_context **src,
-				  struct net_6lo_context **dst)
-{
-	uint8_t cid;
+	net_buf_add(frag, hdr_len);
 
-	/* Extract source and destination Context Index,
-	 * Either one address is context based or both.
-	 * If CID is zero means that particular address is non
-	 * context based compression.
-	 */
-	cid = (CIPHC[2] >> 4) & 0x0F;
-	if (cid) {
-		*src = get_6lo_context_by_cid(net_nbuf_iface(buf), cid);
-		if (!(*src)) {
-			NET_DBG("Unknown src cid %d", cid);
-			return false;
-		}
+	/* Copying ll part, if any */
+	if (reserve) {
+		memcpy(frag->data - reserve, net_nbuf_ll(buf), reserve);
 	}
 
-	cid = CIPHC[2] & 0x0F;
-	if (cid) {
-		*dst = get_6lo_context_by_cid(net_nbuf_iface(buf), cid);
-		if (!(*dst)) {
-			NET_DBG("Unknown dst cid %d", cid);
-			return false;
-		}
-	}
+	net_buf_pull(buf->frags, offset);
 
-	/* If CID flag set and src or dst context not available means,
-	 * corrupted packet.
-	 */
-	if (!*src && !*dst) {
-		return false;
-	}
+	/* Insert the fragment (this one holds uncompressed headers) */
+	net_buf_frag_insert(buf, frag);
+	net_nbuf_compact(buf->frags);
 
 	return true;
 }
-#endif
 
 static inline bool uncompress_IPHC_header(struct net_buf *buf)
 {
-	struct net_udp_hdr *udp = NULL;
+	uint8_t *iphc = buf->frags->data;
+	const uint8_t *src_prefix = NULL;
+	const uint8_t *dst_prefix = NULL;
+	struct {
+		struct net_ipv6_hdr ipv6;
+		struct net_udp_hdr udp;
+	} __packed hdr;
+	uint8_t hdr_len = NET_IPV6H_LEN;
 	uint8_t offset = 2;
-	uint8_t chksum = 0;
-	struct net_ipv6_hdr *ipv6;
-	struct net_buf *frag;
+	bool chksum = false;
+	uint8_t mode;
 	uint16_t len;
 #if defined(CONFIG_NET_6LO_CONTEXT)
-	struct net_6lo_context *src = NULL;
-	struct net_6lo_context *dst = NULL;
+	struct net_6lo_context *ctx;
+	uint8_t cid = 0;
 #endif
 
-	if (CIPHC[1] & NET_6LO_IPHC_CID_1) {
-#if defined(CONFIG_NET_6LO_CONTEXT)
-		if (!uncompress_cid(buf, &src, &dst)) {
-			return false;
-		}
-
-		offset++;
-#else
-		NET_DBG("Context based uncompression not enabled");
+	if (buf->frags->len < offset) {
 		return false;
-#endif
 	}
 
-	frag = net_nbuf_get_reserve_data(net_nbuf_ll_reserve(buf));
-	if (!frag) {
+	/* The in-line fields are read without further checks */
+	if (buf->frags->len < offset + iphc_inline_len(iphc)) {
+		NET_DBG("Truncated header, %u bytes of %u",
+			buf->frags->len, offset + iphc_inline_len(iphc));
 		return false;
 	}
 
-	ipv6 = (struct net_ipv6_hdr *)(frag->data);
+	if ((iphc[1] & NET_6LO_IPHC_DAC_1) &&
+	    ((iphc[1] & NET_6LO_IPHC_M_1) ||
+	     !(iphc[1] & NET_6LO_IPHC_DAM_11))) {
+		/* TODO: Unicast-Prefix-based IPv6 Multicast Addresses */
+		NET_DBG("Reserved DAM %02x", iphc[1]);
+		return false;
+	}
 
-	/* Version is always 6 */
-	ipv6->vtc = 0x60;
-	net_nbuf_set_ip_hdr_len(buf, NET_IPV6H_LEN);
+#if defined(CONFIG_NET_6LO_CONTEXT)
+	if (iphc[1] & NET_6LO_IPHC_CID_1) {
+		cid = iphc[offset++];
+	}
 
-	/* Uncompress Traffic class and Flow label */
-	offset = uncompress_tfl(buf, ipv6, offset);
+	if ((iphc[1] & NET_6LO_IPHC_SAC_1) &&
+	    (iphc[1] & NET_6LO_IPHC_SAM_11)) {
+		ctx = get_6lo_context_by_cid(net_nbuf_iface(buf), cid >> 4);
+		if (!ctx) {
+			NET_DBG("Unknown src cid %d", cid >> 4);
+			return false;
+		}
 
-	if (!(CIPHC[0] & NET_6LO_IPHC_NH_1)) {
-		ipv6->nexthdr = CIPHC[offset];
-		offset++;
+		src_prefix = ctx->prefix.s6_addr;
 	}
 
-	/* Uncompress Hoplimit */
-	offset = uncompress_hoplimit(buf, ipv6, offset);
-
-	/* First set to zero and copy relevant bits */
-	memset(&ipv6->src.s6_addr[0], 0, 16);
-	memset(&ipv6->dst.s6_addr[0], 0, 16);
+	if (iphc[1] & NET_6LO_IPHC_DAC_1) {
+		ctx = get_6lo_context_by_cid(net_nbuf_iface(buf), cid & 0x0F);
+		if (!ctx) {
+			NET_DBG("Unknown dst cid %d", cid & 0x0F);
+			return false;
+		}
 
-	/* Uncompress Source Address */
-#if defined(CONFIG_NET_6LO_CONTEXT)
-	offset = uncompress_sa_ctx(buf, ipv6, offset, src);
-	if (!offset) {
-		goto fail;
+		dst_prefix = ctx->prefix.s6_addr;
 	}
 #else
-	offset = uncompress_sa(buf, ipv6, offset);
-#endif
-
-	/* Uncompress Destination Address */
-#if defined(CONFIG_NET_6LO_CONTEXT)
-	offset = uncompress_da_ctx(buf, ipv6, offset, dst);
-	if (!offset) {
-		goto fail;
+	if ((iphc[1] & NET_6LO_IPHC_CID_1) || (iphc[1] & NET_6LO_IPHC_DAC_1) ||
+	    ((iphc[1] & NET_6LO_IPHC_SAC_1) &&
+	     (iphc[1] & NET_6LO_IPHC_SAM_11))) {
+		NET_DBG("Context based uncompression not enabled");
+		return false;
 	}
-#else
-	offset = uncompress_da(buf, ipv6, offset);
 #endif
 
-	net_buf_add(frag, NET_IPV6H_LEN);
+	memset(&hdr, 0, sizeof(hdr));
 
-	if (!(CIPHC[0] & NET_6LO_IPHC_NH_1)) {
-		NET_DBG("No following compressed header");
-		goto end;
-	}
+	/* Version is always 6 */
+	hdr.ipv6.vtc = 0x60;
 
-	if ((CIPHC[offset] & 0xF0) != NET_6LO_NHC_UDP_BARE) {
-		/* Unsupported NH */
-		NET_DBG("Unsupported next header");
-		goto fail;
+	offset = uncompress_tf(&hdr.ipv6, iphc, offset);
+
+	if (iphc[0] & NET_6LO_IPHC_NH_1) {
+		hdr.ipv6.nexthdr = IPPROTO_UDP;
+		hdr_len += NET_UDPH_LEN;
+	} else {
+		hdr.ipv6.nexthdr = iphc[offset++];
 	}
 
-	/* Uncompress UDP header */
-	ipv6->nexthdr = IPPROTO_UDP;
+	mode = iphc[0] & NET_6LO_IPHC_HLIM255;
+	hdr.ipv6.hop_limit = mode ? hlim_values[mode] : iphc[offset++];
 
-	udp = (struct net_udp_hdr *)(frag->data + NET_IPV6H_LEN);
-	chksum = CIPHC[offset] & NET_6LO_NHC_UDP_CHKSUM_1;
-	offset = uncompress_nh_udp(buf, udp, offset);
+	/* SAC = 1 and SAM = 00 is the unspecified address */
+	mode = (iphc[1] & NET_6LO_IPHC_SAM_11) >> 4;
+	if (mode || !(iphc[1] & NET_6LO_IPHC_SAC_1)) {
+		offset = uncompress_addr(&hdr.ipv6.src, iphc, offset, mode,
+					 src_prefix, net_nbuf_ll_src(buf));
+	}
 
-	if (!chksum) {
-		memcpy(&udp->chksum, &CIPHC[offset], 2);
-		offset += 2;
+	mode = iphc[1] & NET_6LO_IPHC_DAM_11;
+	if (iphc[1] & NET_6LO_IPHC_M_1) {
+		offset = uncompress_maddr(&hdr.ipv6.dst, iphc, offset, mode);
+	} else {
+		offset = uncompress_addr(&hdr.ipv6.dst, iphc, offset, mode,
+					 dst_prefix, net_nbuf_ll_dst(buf));
 	}
 
-	net_buf_add(frag, NET_UDPH_LEN);
+	if (iphc[0] & NET_6LO_IPHC_NH_1) {
+		if (offset >= buf->frags->len ||
+		    (iphc[offset] & 0xF8) != NET_6LO_NHC_UDP_BARE) {
+			/* Unsupported NH */
+			NET_DBG("Unsupported or missing next header");
+			return false;
+		}
 
-end:
-	/* move the data to beginning, no need for headers now */
-	NET_DBG("Removing %u bytes of compressed hdr", offset);
-	memmove(buf->frags->data, buf->frags->data + offset,
-		buf->frags->len - offset);
-	buf->frags->len -= offset;
+		if (buf->frags->len < offset + nhc_udp_len(iphc[offset])) {
+			NET_DBG("Truncated UDP header, %u bytes of %u",
+				buf->frags->len,
+				offset + nhc_udp_len(iphc[offset]));
+			return false;
+		}
 
-	/* Copying ll part, if any */
-	if (net_nbuf_ll_reserve(buf)) {
-		memcpy(frag->data - net_nbuf_ll_reserve(buf),
-		       net_nbuf_ll(buf), net_nbuf_ll_reserve(buf));
+		chksum = iphc[offset] & NET_6LO_NHC_UDP_CHKSUM_1;
+		offset = uncompress_nh_udp(&hdr.udp, iphc, offset);
 	}
 
-	/* Insert the fragment (this one holds uncompressed headers) */
-	net_buf_frag_insert(buf, frag);
-	net_nbuf_compact(buf->frags);
-
 	/* Set IPv6 header and UDP (if next header is) length */
-	len = net_buf_frags_len(buf) - NET_IPV6H_LEN;
-	ipv6->len[0] = len >> 8;
-	ipv6->len[1] = (uint8_t)len;
+	len = net_buf_frags_len(buf->frags) - offset + hdr_len -
+		NET_IPV6H_LEN;
+	hdr.ipv6.len[0] = len >> 8;
+	hdr.ipv6.len[1] = (uint8_t)len;
 
-	if (ipv6->nexthdr == IPPROTO_UDP) {
-		udp->len = htons(len);
+	if (hdr.ipv6.nexthdr == IPPROTO_UDP) {
+		hdr.udp.len = htons(len);
+	}
+
+	NET_DBG("Uncompressed %u bytes of headers to %u", offset, hdr_len);
+
+	if (!expand_headers(buf, offset, hdr_len)) {
+		return false;
 	}
 
+	memcpy(buf->frags->data, &hdr, hdr_len);
+
+	net_nbuf_set_ip_hdr_len(buf, NET_IPV6H_LEN);
+
 	if (chksum) {
-		udp->chksum = ~net_calc_chksum_udp(buf);
+		NET_UDP_BUF(buf)->chksum = ~net_calc_chksum(buf, IPPROTO_UDP);
 	}
 
 	return true;
-
-fail:
-	net_nbuf_unref(frag);
-	return false;
 }
 
 /* Adds IPv6 dispatch as first byte and adjust fragments  */
@@ -1401,13 +993,13 @@ static inline bool compress_ipv6_header(struct net_buf *buf,
 
 	net_buf_frag_insert(buf, frag);
 
-	/* compact the fragments, so that gaps will be filled */
-	buf->frags = net_nbuf_compact(buf->frags);
-
 	if (fragment) {
 		return fragment(buf, -1);
 	}
 
+	/* compact the fragments, so that gaps will be filled */
+	buf->frags = net_nbuf_compact(buf->frags);
+
 	return true;
 }
 
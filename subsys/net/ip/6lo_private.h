@@ -84,7 +84,7 @@
 #define NET_6LO_NHC_UDP_BARE		0xF0
 
 #define NET_6LO_NHC_UDP_CHKSUM_0	0x00
-#define NET_6LO_NHC_UDP_CHKSUM_1	0x08
+#define NET_6LO_NHC_UDP_CHKSUM_1	0x04
 
 #define NET_6LO_NHC_UDP_PORT_00		0x00
 #define NET_6LO_NHC_UDP_PORT_01		0x01
@@ -94,9 +94,6 @@
 #define NET_6LO_NHC_UDP_8_BIT_PORT	0xF0
 #define NET_6LO_NHC_UDP_4_BIT_PORT	0xF0B
 
-#define IPHC ((frag)->data)
-#define CIPHC ((buf->frags)->data)
-
 #define NET_6LO_FRAG1_HDR_LEN		4
 #define NET_6LO_FRAGN_HDR_LEN		5
 
@@ -34,6 +34,7 @@
 #include "icmpv6.h"
 #include "icmpv4.h"
 #include "connection.h"
+#include "net_profile.h"
 
 /** Is this connection used or not */
 #define NET_CONN_IN_USE BIT(0)
@@ -656,7 +657,8 @@ static inline void send_icmp_error(struct net_buf *buf)
 	}
 }
 
-enum net_verdict net_conn_input(enum net_ip_protocol proto, struct net_buf *buf)
+static enum net_verdict conn_input(enum net_ip_protocol proto,
+				   struct net_buf *buf)
 {
 	int i, best_match = -1;
 	int16_t best_rank = -1;
@@ -791,6 +793,15 @@ drop:
 	return NET_DROP;
 }
 
+enum net_verdict net_conn_input(enum net_ip_protocol proto, struct net_buf *buf)
+{
+	enum net_verdict verdict;
+
+	NET_PROFILE(NET_PROFILE_CONN_RX, verdict = conn_input(proto, buf));
+
+	return verdict;
+}
+
 void net_conn_init(void)
 {
 #if defined(CONFIG_NET_CONN_CACHE)
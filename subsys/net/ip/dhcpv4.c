@@ -86,6 +86,7 @@ struct dhcp_msg {
 #define DHCPV4_OPTIONS_SERVER_ID	54
 #define DHCPV4_OPTIONS_REQ_LIST		55
 #define DHCPV4_OPTIONS_RENEWAL		58
+#define DHCPV4_OPTIONS_RAPID_COMMIT	80
 #define DHCPV4_OPTIONS_END		255
 
 /*
@@ -96,26 +97,45 @@ struct dhcp_msg {
  */
 
 /*
- * In the process of REQUEST and RENEWAL requests, if server fails to respond
- * with ACK, client will try below number of maximum attempts, if it fails to
- * get reply from server, client starts from beginning (broadcasting DISCOVER
- * message).
+ * In the process of REQUEST and RENEWAL requests, if server fails
+ * to respond with ACK, client will try below number of maximum attempts, if
+ * it fails to get reply from server, client starts from beginning
+ * (broadcasting DISCOVER message). The REQUEST of INIT-REBOOT is sent
+ * only once.
  * No limit for DISCOVER message request, it sends forever at the moment.
  */
 #define DHCPV4_MAX_NUMBER_OF_ATTEMPTS	3
 
+/* Retransmission delays in seconds, RFC 2131, chapter 4.1 */
+#define DHCPV4_INITIAL_RETRY_TIMEOUT	4
+#define DHCPV4_MAX_RETRY_TIMEOUT	64
+
 static uint8_t magic_cookie[4] = { 0x63, 0x82, 0x53, 0x63 }; /* RFC 1497 [17] */
 
+static struct net_conn_handle *dhcpv4_conn;
+
 static void dhcpv4_timeout(struct k_work *work);
+static void dhcpv4_t1_timeout(struct k_work *work);
 
 /*
- * Timeout for Initialization and allocation of network address.
- * Timeout value is from random number between 1-10 seconds.
- * RFC 2131, Chapter 4.4.1.
+ * Timeout for the reply to the message that was just sent. The first
+ * retransmission is done after 4 seconds and the delay is doubled for each
+ * one up to 64 seconds. The delay is randomized by -1 to +1 second so that
+ * clients that were powered on at the same time do not stay in sync.
+ * RFC 2131, Chapter 4.1.
  */
-static inline uint32_t get_dhcpv4_timeout(void)
+static inline uint32_t get_dhcpv4_timeout(struct net_if *iface)
 {
-	return 5 * MSEC_PER_SEC; /* TODO Should be between 1-10 */
+	uint32_t timeout = DHCPV4_INITIAL_RETRY_TIMEOUT;
+	uint8_t i;
+
+	for (i = 1; i < iface->dhcpv4.attempts &&
+		     timeout < DHCPV4_MAX_RETRY_TIMEOUT; i++) {
+		timeout <<= 1;
+	}
+
+	return (timeout - 1) * MSEC_PER_SEC +
+		sys_rand32_get() % (2 * MSEC_PER_SEC + 1);
 }
 
 static inline uint32_t get_dhcpv4_renewal_time(struct net_if *iface)
@@ -327,10 +347,13 @@ static struct net_buf *prepare_message(struct net_if *iface, uint8_t type)
 	msg->xid = htonl(iface->dhcpv4.xid);
 	msg->flags = htons(DHCPV4_MSG_BROADCAST);
 
-	if (iface->dhcpv4.state == NET_DHCPV4_INIT) {
-		memset(msg->ciaddr, 0, sizeof(msg->ciaddr));
-	} else {
+	/* Only a client that already has the address may use it as the
+	 * source, RFC 2131, chapter 4.3.2.
+	 */
+	if (iface->dhcpv4.state == NET_DHCPV4_RENEWAL) {
 		memcpy(msg->ciaddr, iface->dhcpv4.requested_ip.s4_addr, 4);
+	} else {
+		memset(msg->ciaddr, 0, sizeof(msg->ciaddr));
 	}
 
 	memcpy(msg->chaddr, iface->link_addr.addr, iface->link_addr.len);
@@ -351,17 +374,62 @@ fail:
 	return NULL;
 }
 
-/* Prepare DHCPv4 Message request and send it to peer */
-static void send_request(struct net_if *iface, bool renewal)
+/* Ask for the Rapid Commit (RFC 4039), the option has no data */
+static inline bool add_rapid_commit(struct net_buf *buf)
+{
+#if defined(CONFIG_NET_DHCPV4_RAPID_COMMIT)
+	uint8_t data[2] = { DHCPV4_OPTIONS_RAPID_COMMIT, 0 };
+
+	return net_nbuf_append(buf, sizeof(data), data);
+#else
+	return true;
+#endif
+}
+
+/* The attempts are counted per state, so entering a new state restarts
+ * the retransmission delays.
+ */
+static inline void set_dhcpv4_state(struct net_if *iface,
+				    enum net_dhcpv4_state state)
+{
+	if (iface->dhcpv4.state != state) {
+		iface->dhcpv4.state = state;
+		iface->dhcpv4.attempts = 0;
+	}
+}
+
+/*
+ * Wait for the reply of the message that was just sent. The timer is
+ * started even if the message could not be sent, so the client retries
+ * instead of getting stuck when it runs out of buffers.
+ */
+static void wait_dhcpv4_reply(struct net_if *iface)
+{
+	if (iface->dhcpv4.attempts < UINT8_MAX) {
+		iface->dhcpv4.attempts++;
+	}
+
+	k_delayed_work_submit(&iface->dhcpv4_timeout,
+			      get_dhcpv4_timeout(iface));
+}
+
+/*
+ * Prepare DHCPv4 Message request and send it to peer. The server
+ * identifier is left out in the INIT-REBOOT state as the client does not
+ * know which server will reply, RFC 2131, chapter 4.3.2.
+ */
+static void send_request(struct net_if *iface, enum net_dhcpv4_state state)
 {
 	struct net_buf *buf;
 
+	set_dhcpv4_state(iface, state);
+
 	buf = prepare_message(iface, DHCPV4_MSG_TYPE_REQUEST);
 	if (!buf) {
 		goto fail;
 	}
 
-	if (!add_server_id(buf) ||
+	if ((state != NET_DHCPV4_REBOOTING && !add_server_id(buf)) ||
 	    !add_req_ipaddr(buf) ||
 	    !add_end(buf)) {
 		goto fail;
@@ -373,25 +441,18 @@ static void send_request(struct net_if *iface, bool renewal)
 		goto fail;
 	}
 
-	if (renewal) {
-		iface->dhcpv4.state = NET_DHCPV4_RENEWAL;
-	} else {
-		iface->dhcpv4.state = NET_DHCPV4_REQUEST;
-	}
-
-	iface->dhcpv4.attempts++;
-
-	k_delayed_work_init(&iface->dhcpv4_timeout, dhcpv4_timeout);
-	k_delayed_work_submit(&iface->dhcpv4_timeout, get_dhcpv4_timeout());
+	wait_dhcpv4_reply(iface);
 
 	return;
 
 fail:
 	NET_DBG("Message preparation failed");
 
-	if (!buf) {
+	if (buf) {
 		net_nbuf_unref(buf);
 	}
+
+	wait_dhcpv4_reply(iface);
 }
 
 /* Prepare DHCPv4 Dicover message and braodcast it */
@@ -401,12 +462,15 @@ static void send_discover(struct net_if *iface)
 
 	iface->dhcpv4.xid++;
 
+	set_dhcpv4_state(iface, NET_DHCPV4_DISCOVER);
+
 	buf = prepare_message(iface, DHCPV4_MSG_TYPE_DISCOVER);
 	if (!buf) {
 		goto fail;
 	}
 
 	if (!add_req_options(buf) ||
+	    !add_rapid_commit(buf) ||
 	    !add_end(buf)) {
 		goto fail;
 	}
@@ -417,19 +481,18 @@ static void send_discover(struct net_if *iface)
 		goto fail;
 	}
 
-	iface->dhcpv4.state = NET_DHCPV4_DISCOVER;
-
-	k_delayed_work_init(&iface->dhcpv4_timeout, dhcpv4_timeout);
-	k_delayed_work_submit(&iface->dhcpv4_timeout, get_dhcpv4_timeout());
+	wait_dhcpv4_reply(iface);
 
 	return;
 
 fail:
 	NET_DBG("Message preparation failed");
 
-	if (!buf) {
+	if (buf) {
 		net_nbuf_unref(buf);
 	}
+
+	wait_dhcpv4_reply(iface);
 }
 
 static void dhcpv4_timeout(struct k_work *work)
@@ -450,16 +513,25 @@ static void dhcpv4_timeout(struct k_work *work)
 		break;
 	case NET_DHCPV4_REQUEST:
 		/*
-		 * Maximum number of renewal attempts failed, so start
+		 * Maximum number of request attempts failed, so start
 		 * from the beginning.
 		 */
 		if (iface->dhcpv4.attempts >= DHCPV4_MAX_NUMBER_OF_ATTEMPTS) {
 			send_discover(iface);
 		} else {
 			/* Repeat requests until max number of attempts */
-			send_request(iface, false);
+			send_request(iface, NET_DHCPV4_REQUEST);
 		}
 		break;
+	case NET_DHCPV4_REBOOTING:
+		/*
+		 * The saved lease is only worth one request. If the server
+		 * does not answer it in time, it is probably on another
+		 * network, so start from the beginning right away instead
+		 * of retrying with the backoff.
+		 */
+		send_discover(iface);
+		break;
 	case NET_DHCPV4_RENEWAL:
 		if (iface->dhcpv4.attempts >= DHCPV4_MAX_NUMBER_OF_ATTEMPTS) {
 			if (!net_if_ipv4_addr_rm(iface,
@@ -474,7 +546,7 @@ static void dhcpv4_timeout(struct k_work *work)
 			send_discover(iface);
 		} else {
 			/* Repeat renewal request for max number of attempts */
-			send_request(iface, true);
+			send_request(iface, NET_DHCPV4_RENEWAL);
 		}
 		break;
 	default:
@@ -493,41 +565,36 @@ static void dhcpv4_t1_timeout(struct k_work *work)
 		return;
 	}
 
-	send_request(iface, true);
+	send_request(iface, NET_DHCPV4_RENEWAL);
 }
 
 /*
  * Parse DHCPv4 options and retrieve relavant information
  * as per RFC 2132.
  */
-static enum net_verdict parse_options(struct net_if *iface, struct net_buf *buf,
-				      uint16_t offset, uint8_t *msg_type)
+static enum net_verdict parse_options(struct net_if *iface,
+				      struct net_nbuf_cursor *cursor,
+				      uint8_t *msg_type,
+				      bool *rapid_commit)
 {
-	struct net_buf *frag;
 	uint8_t cookie[4];
 	uint8_t length;
 	uint8_t type;
-	uint16_t pos;
-	bool end = false;
 
-	frag = net_nbuf_read(buf, offset, &pos, sizeof(magic_cookie),
-			     (uint8_t *)cookie);
-	if (!frag || memcmp(magic_cookie, cookie, sizeof(magic_cookie))) {
+	if (!net_nbuf_cursor_read(cursor, sizeof(magic_cookie), cookie) ||
+	    memcmp(magic_cookie, cookie, sizeof(magic_cookie))) {
 
 		NET_DBG("Incorrect magic cookie");
 		return NET_DROP;
 	}
 
-	while (frag) {
-		frag = net_nbuf_read_u8(frag, pos, &pos, &type);
+	while (net_nbuf_cursor_read_u8(cursor, &type)) {
 
 		if (type == DHCPV4_OPTIONS_END) {
-			end = true;
 			return NET_OK;
 		}
 
-		frag = net_nbuf_read_u8(frag, pos, &pos, &length);
-		if (!frag) {
+		if (!net_nbuf_cursor_read_u8(cursor, &length)) {
 			return NET_DROP;
 		}
 
@@ -537,7 +604,7 @@ static enum net_verdict parse_options(struct net_if *iface, struct net_buf *buf,
 				return NET_DROP;
 			}
 
-			frag = net_nbuf_read(frag, pos, &pos, length,
+			net_nbuf_cursor_read(cursor, length,
 					     iface->ipv4.netmask.s4_addr);
 			break;
 		case DHCPV4_OPTIONS_LEASE_TIME:
@@ -545,7 +612,7 @@ static enum net_verdict parse_options(struct net_if *iface, struct net_buf *buf,
 				return NET_DROP;
 			}
 
-			frag = net_nbuf_read_be32(frag, pos, &pos,
+			net_nbuf_cursor_read_be32(cursor,
 						  &iface->dhcpv4.lease_time);
 			if (!iface->dhcpv4.lease_time) {
 				return NET_DROP;
@@ -557,7 +624,7 @@ static enum net_verdict parse_options(struct net_if *iface, struct net_buf *buf,
 				return NET_DROP;
 			}
 
-			frag = net_nbuf_read_be32(frag, pos, &pos,
+			net_nbuf_cursor_read_be32(cursor,
 						  &iface->dhcpv4.renewal_time);
 			if (!iface->dhcpv4.renewal_time) {
 				return NET_DROP;
@@ -569,7 +636,7 @@ static enum net_verdict parse_options(struct net_if *iface, struct net_buf *buf,
 				return NET_DROP;
 			}
 
-			frag = net_nbuf_read(frag, pos, &pos, length,
+			net_nbuf_cursor_read(cursor, length,
 					     iface->dhcpv4.server_id.s4_addr);
 			break;
 		case DHCPV4_OPTIONS_MSG_TYPE:
@@ -577,86 +644,120 @@ static enum net_verdict parse_options(struct net_if *iface, struct net_buf *buf,
 				return NET_DROP;
 			}
 
-			frag = net_nbuf_read_u8(frag, pos, &pos, msg_type);
+			net_nbuf_cursor_read_u8(cursor, msg_type);
+			break;
+		case DHCPV4_OPTIONS_RAPID_COMMIT:
+			if (length != 0) {
+				return NET_DROP;
+			}
+
+			*rapid_commit = true;
 			break;
 		default:
-			frag = net_nbuf_skip(frag, pos, &pos, length);
+			net_nbuf_cursor_skip(cursor, length);
 			break;
 		}
 
-		if (!frag && pos) {
+		if (cursor->error) {
 			return NET_DROP;
 		}
 	}
 
-	if (!end) {
-		return NET_DROP;
-	}
-
-	return NET_OK;
+	/* The options did not end with the end option */
+	return NET_DROP;
 }
 
-/* TODO: Handles only DHCPv4 OFFER and ACK messages */
-static inline void handle_dhcpv4_reply(struct net_if *iface, uint8_t msg_type)
+/* The server has acknowledged the address, use it until the lease ends */
+static void dhcpv4_bound(struct net_if *iface)
 {
-	/*
-	 * Check for previous state, reason behind this check is, if client
-	 * receives multiple OFFER messages, first one will be handled.
-	 * Rest of the replies are discarded.
-	 */
-	if (iface->dhcpv4.state == NET_DHCPV4_DISCOVER) {
-		if (msg_type != NET_DHCPV4_OFFER) {
-			NET_DBG("Reply not handled %d", msg_type);
+	if (iface->dhcpv4.state != NET_DHCPV4_RENEWAL) {
+		NET_INFO("Received: %s",
+			 net_sprint_ipv4_addr(&iface->dhcpv4.requested_ip));
+
+		if (!net_if_ipv4_addr_add(iface, &iface->dhcpv4.requested_ip,
+					  NET_ADDR_DHCP,
+					  iface->dhcpv4.lease_time)) {
+			NET_DBG("Failed to add IPv4 addr to iface %p", iface);
 			return;
 		}
+	}
 
-		/* Send DHCPv4 Request Message */
-		k_delayed_work_cancel(&iface->dhcpv4_timeout);
-		send_request(iface, false);
+	/* TODO: if the renewal is success, update only vlifetime on iface */
 
-	} else if (iface->dhcpv4.state == NET_DHCPV4_REQUEST ||
-		   iface->dhcpv4.state == NET_DHCPV4_RENEWAL) {
+	set_dhcpv4_state(iface, NET_DHCPV4_ACK);
 
-		if (msg_type != NET_DHCPV4_ACK) {
+	/* Start renewal time */
+	k_delayed_work_submit(&iface->dhcpv4_t1_timer,
+			      get_dhcpv4_renewal_time(iface));
+}
+
+/* Handles DHCPv4 OFFER, ACK and NAK messages */
+static inline void handle_dhcpv4_reply(struct net_if *iface,
+				       uint8_t msg_type,
+				       bool rapid_commit,
+				       const struct in_addr *yiaddr)
+{
+	switch (iface->dhcpv4.state) {
+	case NET_DHCPV4_DISCOVER:
+#if defined(CONFIG_NET_DHCPV4_RAPID_COMMIT)
+		/* The server assigned the address without an OFFER */
+		if (msg_type == DHCPV4_MSG_TYPE_ACK && rapid_commit) {
+			k_delayed_work_cancel(&iface->dhcpv4_timeout);
+			net_ipaddr_copy(&iface->dhcpv4.requested_ip, yiaddr);
+			dhcpv4_bound(iface);
+			return;
+		}
+#endif
+
+		/*
+		 * If client receives multiple OFFER messages, first one
+		 * will be handled. Rest of the replies are discarded as
+		 * the state is not DISCOVER any more.
+		 */
+		if (msg_type != DHCPV4_MSG_TYPE_OFFER) {
 			NET_DBG("Reply not handled %d", msg_type);
 			return;
 		}
 
+		/* Send DHCPv4 Request Message */
 		k_delayed_work_cancel(&iface->dhcpv4_timeout);
+		net_ipaddr_copy(&iface->dhcpv4.requested_ip, yiaddr);
+		send_request(iface, NET_DHCPV4_REQUEST);
+		break;
+	case NET_DHCPV4_REQUEST:
+	case NET_DHCPV4_REBOOTING:
+	case NET_DHCPV4_RENEWAL:
+		if (msg_type == DHCPV4_MSG_TYPE_NAK) {
+			/* The address cannot be used, start from the
+			 * beginning.
+			 */
+			NET_DBG("Address %s refused",
+				net_sprint_ipv4_addr(
+					&iface->dhcpv4.requested_ip));
+
+			k_delayed_work_cancel(&iface->dhcpv4_timeout);
 
-		switch (iface->dhcpv4.state) {
-		case NET_DHCPV4_REQUEST:
-			NET_INFO("Received: %s",
-				 net_sprint_ipv4_addr(
-					 &iface->dhcpv4.requested_ip));
-			if (!net_if_ipv4_addr_add(iface,
-						  &iface->dhcpv4.requested_ip,
-						  NET_ADDR_DHCP,
-						  iface->dhcpv4.lease_time)) {
-				NET_DBG("Failed to add IPv4 addr to iface %p",
-					iface);
-				return;
+			if (iface->dhcpv4.state == NET_DHCPV4_RENEWAL &&
+			    !net_if_ipv4_addr_rm(iface,
+						 &iface->dhcpv4.requested_ip)) {
+				NET_DBG("Failed to remove addr from iface");
 			}
 
-			break;
-		case NET_DHCPV4_RENEWAL:
-			/* TODO: if the renewal is success, update only
-			 * vlifetime on iface
-			 */
-			break;
-		default:
-			break;
+			send_discover(iface);
+			return;
 		}
 
-		iface->dhcpv4.attempts = 0;
-		iface->dhcpv4.state = NET_DHCPV4_ACK;
-
-		/* Start renewal time */
-		k_delayed_work_init(&iface->dhcpv4_t1_timer,
-				    dhcpv4_t1_timeout);
+		if (msg_type != DHCPV4_MSG_TYPE_ACK) {
+			NET_DBG("Reply not handled %d", msg_type);
+			return;
+		}
 
-		k_delayed_work_submit(&iface->dhcpv4_t1_timer,
-				      get_dhcpv4_renewal_time(iface));
+		k_delayed_work_cancel(&iface->dhcpv4_timeout);
+		dhcpv4_bound(iface);
+		break;
+	default:
+		NET_DBG("Reply not handled %d", msg_type);
+		break;
 	}
 }
 
@@ -664,12 +765,14 @@ static enum net_verdict net_dhcpv4_input(struct net_conn *conn,
 					 struct net_buf *buf,
 					 void *user_data)
 {
+	struct net_nbuf_cursor cursor;
 	struct dhcp_msg *msg;
 	struct net_buf *frag;
 	struct net_if *iface;
-	uint8_t	msg_type;
+	struct in_addr yiaddr;
+	bool rapid_commit = false;
+	uint8_t	msg_type = 0;
 	uint8_t min;
-	uint16_t pos;
 
 	if (!conn) {
 		NET_DBG("Invalid connection");
@@ -722,23 +825,24 @@ static enum net_verdict net_dhcpv4_input(struct net_conn *conn,
 		goto drop;
 	}
 
-	memcpy(iface->dhcpv4.requested_ip.s4_addr, msg->yiaddr,
-	       sizeof(msg->yiaddr));
+	memcpy(yiaddr.s4_addr, msg->yiaddr, sizeof(msg->yiaddr));
+
+	net_nbuf_cursor_init(&cursor, buf, frag, min);
 
 	/* sname, file are not used at the moment, skip it */
-	frag = net_nbuf_skip(frag, min, &pos, SIZE_OF_SNAME + SIZE_OF_FILE);
-	if (!frag && pos) {
+	if (!net_nbuf_cursor_skip(&cursor, SIZE_OF_SNAME + SIZE_OF_FILE)) {
 		goto drop;
 	}
 
-	if (parse_options(iface, frag, pos, &msg_type) == NET_DROP) {
+	if (parse_options(iface, &cursor, &msg_type,
+			  &rapid_commit) == NET_DROP) {
 		NET_DBG("Invalid Options");
 		goto drop;
 	}
 
 	net_nbuf_unref(buf);
 
-	handle_dhcpv4_reply(iface, msg_type);
+	handle_dhcpv4_reply(iface, msg_type, rapid_commit, &yiaddr);
 
 	return NET_OK;
 
@@ -746,7 +850,7 @@ drop:
 	return NET_DROP;
 }
 
-void net_dhcpv4_start(struct net_if *iface)
+static int dhcpv4_init(struct net_if *iface)
 {
 	int ret;
 
@@ -761,19 +865,74 @@ void net_dhcpv4_start(struct net_if *iface)
 	 */
 	iface->dhcpv4.xid = sys_rand32_get();
 
+	k_delayed_work_init(&iface->dhcpv4_timeout, dhcpv4_timeout);
+	k_delayed_work_init(&iface->dhcpv4_t1_timer, dhcpv4_t1_timeout);
+
+	if (dhcpv4_conn) {
+		return 0;
+	}
+
 	/*
 	 * Register UDP input callback on
 	 * DHCPV4_SERVER_PORT(67) and DHCPV4_CLIENT_PORT(68) for
-	 * all dhcpv4 related incoming packets.
+	 * all dhcpv4 related incoming packets. The callback is shared
+	 * by all the interfaces.
 	 */
 	ret = net_udp_register(NULL, NULL,
 			       DHCPV4_SERVER_PORT,
 			       DHCPV4_CLIENT_PORT,
-			       net_dhcpv4_input, NULL, NULL);
+			       net_dhcpv4_input, NULL, &dhcpv4_conn);
 	if (ret < 0) {
 		NET_DBG("UDP callback registration failed");
+		return ret;
+	}
+
+	return 0;
+}
+
+void net_dhcpv4_start(struct net_if *iface)
+{
+	if (dhcpv4_init(iface) < 0) {
 		return;
 	}
 
 	send_discover(iface);
 }
+
+void net_dhcpv4_start_with_lease(struct net_if *iface,
+				 const struct net_dhcpv4_lease *lease)
+{
+	if (dhcpv4_init(iface) < 0) {
+		return;
+	}
+
+	net_ipaddr_copy(&iface->dhcpv4.requested_ip, &lease->addr);
+	net_ipaddr_copy(&iface->dhcpv4.server_id, &lease->server_id);
+	iface->dhcpv4.lease_time = lease->lease_time;
+
+	send_request(iface, NET_DHCPV4_REBOOTING);
+}
+
+void net_dhcpv4_stop(struct net_if *iface)
+{
+	if (iface->dhcpv4.state == NET_DHCPV4_ACK ||
+	    iface->dhcpv4.state == NET_DHCPV4_RENEWAL) {
+		net_if_ipv4_addr_rm(iface, &iface->dhcpv4.requested_ip);
+	}
+
+	unset_dhcpv4_on_iface(iface);
+}
+
+int net_dhcpv4_get_lease(struct net_if *iface, struct net_dhcpv4_lease *lease)
+{
+	if (iface->dhcpv4.state != NET_DHCPV4_ACK &&
+	    iface->dhcpv4.state != NET_DHCPV4_RENEWAL) {
+		return -ENOENT;
+	}
+
+	net_ipaddr_copy(&lease->addr, &iface->dhcpv4.requested_ip);
+	net_ipaddr_copy(&lease->server_id, &iface->dhcpv4.server_id);
+	lease->lease_time = iface->dhcpv4.lease_time;
+
+	return 0;
+}
@@ -153,6 +153,10 @@ struct net_icmpv6_nd_opt_6co {
 #define NET_ICMPV6_PARAM_PROB_NEXTHEADER 1 /* Unrecognized next header */
 #define NET_ICMPV6_PARAM_PROB_OPTION     2 /* Unrecognized option */
 
+/* Codes for ICMPv6 Time Exceeded message */
+#define NET_ICMPV6_TIME_EXCEEDED_HOP_LIMIT  0 /* Hop limit exceeded */
+#define NET_ICMPV6_TIME_EXCEEDED_REASSEMBLY 1 /* Reassembly time exceeded */
+
 /* ICMPv6 header has 4 unused bytes that must be zero, RFC 4443 ch 3.1 */
 #define NET_ICMPV6_UNUSED_LEN 4
 
@@ -45,7 +45,8 @@ struct net_buf *net_ipv4_create_raw(struct net_buf *buf,
 	net_buf_frag_insert(buf, header);
 
 	NET_IPV4_BUF(buf)->vhl = 0x45;
-	NET_IPV4_BUF(buf)->tos = 0x00;
+	/* Class selector code point of the priority (RFC 2474) */
+	NET_IPV4_BUF(buf)->tos = net_nbuf_priority(buf) << 5;
 	NET_IPV4_BUF(buf)->proto = 0;
 
 	NET_IPV4_BUF(buf)->ttl = net_if_ipv4_get_ttl(iface);
@@ -29,6 +29,8 @@
 #endif
 
 #include <errno.h>
+#include <stddef.h>
+#include <misc/byteorder.h>
 #include <net/net_core.h>
 #include <net/nbuf.h>
 #include <net/net_stats.h>
@@ -45,6 +47,8 @@
 
 #define MAX_MULTICAST_SOLICIT 3
 #define MAX_UNICAST_SOLICIT   3
+#define DELAY_FIRST_PROBE_TIME K_SECONDS(5)
+#define RETRANS_TIMER MSEC_PER_SEC
 
 extern void net_neighbor_data_remove(struct net_nbr *nbr);
 extern void net_neighbor_table_clear(struct net_nbr_table *table);
@@ -80,19 +84,102 @@ static inline struct net_nbr *get_nbr(int idx)
 	return &net_neighbor_pool[idx].nbr;
 }
 
+static inline uint8_t get_nbr_index(struct net_nbr *nbr)
+{
+	return ((uint8_t *)nbr - (uint8_t *)net_neighbor_pool) /
+		sizeof(net_neighbor_pool[0]);
+}
+
 static inline struct net_nbr *get_nbr_from_data(struct net_ipv6_nbr_data *data)
 {
-	int i;
+	/* The neighbor data is stored right after struct net_nbr */
+	return CONTAINER_OF((uint8_t *)data, struct net_nbr, __nbr);
+}
 
-	for (i = 0; i < CONFIG_NET_IPV6_MAX_NEIGHBORS; i++) {
-		struct net_nbr *nbr = get_nbr(i);
+/* The neighbors are indexed by a hash of their IPv6 address so that
+ * sending a packet does not need to go through the whole cache. The
+ * chains use neighbor pool indexes, NBR_HASH_END terminates a chain.
+ */
+#define NBR_HASH_SIZE CONFIG_NET_IPV6_MAX_NEIGHBORS
+#define NBR_HASH_END 0xff
 
-		if (nbr->data == (uint8_t *)data) {
-			return nbr;
+static uint8_t nbr_hash[NBR_HASH_SIZE] = {
+	[0 ... (NBR_HASH_SIZE - 1)] = NBR_HASH_END
+};
+
+static inline uint8_t nbr_hash_key(struct in6_addr *addr)
+{
+	/* The interface identifier is the part that differs between
+	 * the neighbors.
+	 */
+	uint32_t key = UNALIGNED_GET(&addr->s6_addr32[2]) ^
+		UNALIGNED_GET(&addr->s6_addr32[3]);
+
+	key ^= key >> 16;
+	key ^= key >> 8;
+
+	return (key & 0xff) % NBR_HASH_SIZE;
+}
+
+static void nbr_hash_add(struct net_nbr *nbr)
+{
+	uint8_t key = nbr_hash_key(&net_ipv6_nbr_data(nbr)->addr);
+
+	net_ipv6_nbr_data(nbr)->hash_next = nbr_hash[key];
+	nbr_hash[key] = get_nbr_index(nbr);
+}
+
+static void nbr_hash_del(struct net_nbr *nbr)
+{
+	uint8_t idx = get_nbr_index(nbr);
+	uint8_t *i;
+
+	for (i = &nbr_hash[nbr_hash_key(&net_ipv6_nbr_data(nbr)->addr)];
+	     *i != NBR_HASH_END;
+	     i = &net_ipv6_nbr_data(get_nbr(*i))->hash_next) {
+		if (*i == idx) {
+			*i = net_ipv6_nbr_data(nbr)->hash_next;
+			return;
 		}
 	}
+}
 
-	return NULL;
+/* The reachability timers of all the neighbors are kept in a timer
+ * wheel.
+ */
+#define NBR_TIMER_TICK 250
+#define NBR_TIMER_SLOTS 32
+
+static sys_dlist_t nbr_timer_slots[NBR_TIMER_SLOTS];
+static struct net_timer_wheel nbr_timer;
+
+static void nd_reachable_timeout(struct net_nbr *nbr);
+
+static inline void nbr_timer_clear(struct net_ipv6_nbr_data *data)
+{
+	net_timer_wheel_clear(&nbr_timer, &data->timer);
+}
+
+static inline void nbr_timer_set(struct net_ipv6_nbr_data *data,
+				 uint32_t timeout)
+{
+	net_timer_wheel_set(&nbr_timer, &data->timer,
+			    net_timer_wheel_ticks(&nbr_timer, timeout));
+}
+
+static void nbr_timer_expired(struct net_timer_wheel_timer *timer)
+{
+	struct net_ipv6_nbr_data *data = CONTAINER_OF(timer,
+						      struct net_ipv6_nbr_data,
+						      timer);
+
+	nd_reachable_timeout(get_nbr_from_data(data));
+}
+
+static void nbr_timer_init(void)
+{
+	net_timer_wheel_init(&nbr_timer, nbr_timer_slots, NBR_TIMER_SLOTS,
+			     NBR_TIMER_TICK, nbr_timer_expired);
 }
 
 #if NET_DEBUG_NBR
@@ -130,14 +217,13 @@ static struct net_nbr *nbr_lookup(struct net_nbr_table *table,
 				  struct net_if *iface,
 				  struct in6_addr *addr)
 {
-	int i;
+	uint8_t i;
 
-	for (i = 0; i < CONFIG_NET_IPV6_MAX_NEIGHBORS; i++) {
-		struct net_nbr *nbr = get_nbr(i);
+	NET_STATS_IPV6_ND(++net_stats.ipv6_nbr.lookup);
 
-		if (!nbr->ref) {
-			continue;
-		}
+	for (i = nbr_hash[nbr_hash_key(addr)]; i != NBR_HASH_END;
+	     i = net_ipv6_nbr_data(get_nbr(i))->hash_next) {
+		struct net_nbr *nbr = get_nbr(i);
 
 		if (nbr->iface == iface &&
 		    net_ipv6_addr_cmp(&net_ipv6_nbr_data(nbr)->addr, addr)) {
@@ -145,6 +231,8 @@ static struct net_nbr *nbr_lookup(struct net_nbr_table *table,
 		}
 	}
 
+	NET_STATS_IPV6_ND(++net_stats.ipv6_nbr.miss);
+
 	return NULL;
 }
 
@@ -177,18 +265,45 @@ static inline void nbr_free(struct net_nbr *nbr)
 
 	nbr_clear_ns_pending(net_ipv6_nbr_data(nbr));
 
-	k_delayed_work_cancel(&net_ipv6_nbr_data(nbr)->reachable);
+	nbr_timer_clear(net_ipv6_nbr_data(nbr));
 
 	net_nbr_unref(nbr);
 }
 
+static struct net_nbr *nbr_alloc(struct in6_addr *addr,
+				 enum net_nbr_state state)
+{
+	struct net_nbr *nbr = net_nbr_get(&net_neighbor.table);
+	struct net_ipv6_nbr_data *data;
+
+	if (!nbr) {
+		NET_STATS_IPV6_ND(++net_stats.ipv6_nbr.full);
+		return NULL;
+	}
+
+	data = net_ipv6_nbr_data(nbr);
+
+	net_ipaddr_copy(&data->addr, addr);
+	data->state = state;
+	data->pending = NULL;
+	data->ns_count = 0;
+	data->is_router = false;
+	data->timer.node.next = NULL;
+
+	nbr_hash_add(nbr);
+
+	NET_STATS_IPV6_ND(++net_stats.ipv6_nbr.add);
+
+	return nbr;
+}
+
 struct net_nbr *net_ipv6_nbr_add(struct net_if *iface,
 				 struct in6_addr *addr,
 				 struct net_linkaddr *lladdr,
 				 bool is_router,
 				 enum net_nbr_state state)
 {
-	struct net_nbr *nbr = net_nbr_get(&net_neighbor.table);
+	struct net_nbr *nbr = nbr_alloc(addr, state);
 
 	if (!nbr) {
 		return NULL;
@@ -199,8 +314,6 @@ struct net_nbr *net_ipv6_nbr_add(struct net_if *iface,
 		return NULL;
 	}
 
-	net_ipaddr_copy(&net_ipv6_nbr_data(nbr)->addr, addr);
-	net_ipv6_nbr_data(nbr)->state = state;
 	net_ipv6_nbr_data(nbr)->is_router = is_router;
 
 	NET_DBG("[%d] nbr %p state %d router %d IPv6 %s ll %s",
@@ -225,7 +338,7 @@ static struct net_nbr *nbr_new(struct net_if *iface,
 			       struct in6_addr *addr,
 			       enum net_nbr_state state)
 {
-	struct net_nbr *nbr = net_nbr_get(&net_neighbor.table);
+	struct net_nbr *nbr = nbr_alloc(addr, state);
 
 	if (!nbr) {
 		return NULL;
@@ -234,10 +347,6 @@ static struct net_nbr *nbr_new(struct net_if *iface,
 	nbr->idx = NET_NBR_LLADDR_UNKNOWN;
 	nbr->iface = iface;
 
-	net_ipaddr_copy(&net_ipv6_nbr_data(nbr)->addr, addr);
-	net_ipv6_nbr_data(nbr)->state = state;
-	net_ipv6_nbr_data(nbr)->pending = NULL;
-
 	NET_DBG("nbr %p iface %p state %d IPv6 %s",
 		nbr, iface, state, net_sprint_ipv6_addr(addr));
 
@@ -248,7 +357,31 @@ void net_neighbor_data_remove(struct net_nbr *nbr)
 {
 	NET_DBG("Neighbor %p removed", nbr);
 
-	return;
+	nbr_timer_clear(net_ipv6_nbr_data(nbr));
+
+	nbr_hash_del(nbr);
+
+	/* Release the link layer address so that the entry can be
+	 * linked again when it is reused.
+	 */
+	net_nbr_unlink(nbr, NULL);
+
+	NET_STATS_IPV6_ND(++net_stats.ipv6_nbr.remove);
+}
+
+void net_ipv6_nbr_foreach(net_nbr_cb_t cb, void *user_data)
+{
+	int i;
+
+	for (i = 0; i < CONFIG_NET_IPV6_MAX_NEIGHBORS; i++) {
+		struct net_nbr *nbr = get_nbr(i);
+
+		if (!nbr->ref) {
+			continue;
+		}
+
+		cb(nbr, user_data);
+	}
 }
 
 void net_neighbor_table_clear(struct net_nbr_table *table)
@@ -305,7 +438,10 @@ struct net_buf *net_ipv6_create_raw(struct net_buf *buf,
 
 	net_buf_frag_insert(buf, header);
 
-	NET_IPV6_BUF(buf)->vtc = 0x60;
+	/* The traffic class is the class selector code point of the
+	 * priority (RFC 2474), the low bits are left zero.
+	 */
+	NET_IPV6_BUF(buf)->vtc = 0x60 | (net_nbuf_priority(buf) << 1);
 	NET_IPV6_BUF(buf)->tcflow = 0;
 	NET_IPV6_BUF(buf)->flow = 0;
 
@@ -388,8 +524,7 @@ struct net_buf *net_ipv6_finalize_raw(struct net_buf *buf,
 
 	if (next_header == IPPROTO_ICMPV6) {
 		NET_ICMP_BUF(buf)->chksum = 0;
-		NET_ICMP_BUF(buf)->chksum = ~net_calc_chksum(buf,
-							     IPPROTO_ICMPV6);
+		NET_ICMP_BUF(buf)->chksum = ~net_calc_chksum_icmpv6(buf);
 	}
 
 	return buf;
@@ -506,10 +641,19 @@ struct net_buf *net_ipv6_prepare_for_send(struct net_buf *buf)
 		/* We need to figure out where the destination
 		 * host is located.
 		 */
-		struct net_route_entry *route;
+		struct net_route_entry *route = NULL;
 		struct net_if_router *router;
 
-		route = net_route_lookup(NULL, &NET_IPV6_BUF(buf)->dst);
+		/* The downward RPL routes to hosts are kept apart from
+		 * the route table.
+		 */
+		nexthop = net_rpl_downward_lookup(NULL,
+						  &NET_IPV6_BUF(buf)->dst);
+		if (!nexthop) {
+			route = net_route_lookup(NULL,
+						 &NET_IPV6_BUF(buf)->dst);
+		}
+
 		if (route) {
 			nexthop = net_route_get_nexthop(route);
 			if (!nexthop) {
@@ -524,7 +668,7 @@ struct net_buf *net_ipv6_prepare_for_send(struct net_buf *buf)
 				net_nbuf_unref(buf);
 				return NULL;
 			}
-		} else {
+		} else if (!nexthop) {
 			/* No specific route to this host, use the default
 			 * route instead.
 			 */
@@ -560,6 +704,16 @@ try_send:
 	if (nbr && nbr->idx != NET_NBR_LLADDR_UNKNOWN) {
 		struct net_linkaddr_storage *lladdr;
 
+		/* Using a stale entry starts the reachability check
+		 * (RFC 4861 ch 7.3.3).
+		 */
+		if (net_ipv6_nbr_data(nbr)->state == NET_NBR_STALE) {
+			net_ipv6_nbr_data(nbr)->state = NET_NBR_DELAY;
+
+			nbr_timer_set(net_ipv6_nbr_data(nbr),
+				      DELAY_FIRST_PROBE_TIME);
+		}
+
 		lladdr = net_nbr_get_lladdr(nbr->idx);
 
 		net_nbuf_ll_dst(buf)->addr = lladdr->addr;
@@ -716,8 +870,7 @@ static inline void handle_ns_neighbor(struct net_buf *buf,
 						   cached_lladdr,
 						   &NET_IPV6_BUF(buf)->src);
 
-			cached_lladdr->len = lladdr.len;
-			memcpy(cached_lladdr->addr, lladdr.addr, lladdr.len);
+			net_nbr_update_lladdr(nbr->idx, &lladdr);
 
 			net_ipv6_nbr_data(nbr)->state = NET_NBR_STALE;
 		} else {
@@ -1015,18 +1168,16 @@ drop:
 	return NET_DROP;
 }
 
-static void nd_reachable_timeout(struct k_work *work)
+static inline uint32_t nd_retrans_time(struct net_if *iface)
 {
-	struct net_ipv6_nbr_data *data = CONTAINER_OF(work,
-						      struct net_ipv6_nbr_data,
-						      send_ns);
+	uint32_t time = net_if_ipv6_get_retrans_timer(iface);
 
-	struct net_nbr *nbr = get_nbr_from_data(data);
+	return time ? time : RETRANS_TIMER;
+}
 
-	if (!data || !nbr) {
-		NET_DBG("ND reachable timeout but no nbr data");
-		return;
-	}
+static void nd_reachable_timeout(struct net_nbr *nbr)
+{
+	struct net_ipv6_nbr_data *data = net_ipv6_nbr_data(nbr);
 
 	switch (data->state) {
 
@@ -1041,6 +1192,8 @@ static void nd_reachable_timeout(struct k_work *work)
 
 			net_ipv6_send_ns(nbr->iface, NULL, NULL, NULL,
 					 &data->addr, false);
+
+			nbr_timer_set(data, nd_retrans_time(nbr->iface));
 		}
 		break;
 
@@ -1059,10 +1212,18 @@ static void nd_reachable_timeout(struct k_work *work)
 
 	case NET_NBR_DELAY:
 		data->state = NET_NBR_PROBE;
-		data->ns_count = 0;
+		data->ns_count = 1;
 
 		NET_DBG("nbr %p moving %s state to PROBE (%d)",
 			nbr, net_sprint_ipv6_addr(&data->addr), data->state);
+
+		/* The probes are sent to the cached link layer address */
+		net_ipv6_send_ns(nbr->iface, NULL, NULL, &data->addr,
+				 &data->addr, false);
+
+		NET_STATS_IPV6_ND(++net_stats.ipv6_nbr.probe);
+
+		nbr_timer_set(data, nd_retrans_time(nbr->iface));
 		break;
 
 	case NET_NBR_PROBE:
@@ -1071,22 +1232,34 @@ static void nd_reachable_timeout(struct k_work *work)
 
 			router = net_if_ipv6_router_lookup(nbr->iface,
 							   &data->addr);
-			if (router && !router->is_infinite) {
-				NET_DBG("nbr %p address %s PROBE ended (%d)",
-					nbr, net_sprint_ipv6_addr(&data->addr),
-					data->state);
+			if (router && router->is_infinite) {
+				break;
+			}
 
+			NET_DBG("nbr %p address %s PROBE ended (%d)",
+				nbr, net_sprint_ipv6_addr(&data->addr),
+				data->state);
+
+			/* An unreachable neighbor would otherwise keep its
+			 * cache slot forever.
+			 */
+			if (router) {
 				net_if_router_rm(router);
-				nbr_free(nbr);
 			}
+
+			nbr_free(nbr);
 		} else {
 			data->ns_count++;
 
 			NET_DBG("nbr %p probe count %u", nbr,
 				data->ns_count);
 
-			net_ipv6_send_ns(nbr->iface, NULL, NULL, NULL,
+			net_ipv6_send_ns(nbr->iface, NULL, NULL, &data->addr,
 					 &data->addr, false);
+
+			NET_STATS_IPV6_ND(++net_stats.ipv6_nbr.probe);
+
+			nbr_timer_set(data, nd_retrans_time(nbr->iface));
 		}
 		break;
 	}
@@ -1100,10 +1273,19 @@ void net_ipv6_nbr_set_reachable_timer(struct net_if *iface, struct net_nbr *nbr)
 
 	NET_ASSERT_INFO(time, "Zero reachable timeout!");
 
-	k_delayed_work_init(&net_ipv6_nbr_data(nbr)->reachable,
-			    nd_reachable_timeout);
+	nbr_timer_set(net_ipv6_nbr_data(nbr), time);
+}
+
+static inline void update_lladdr_from_tllao(struct net_nbr *nbr,
+				struct net_linkaddr_storage *cached_lladdr,
+				uint8_t *tllao)
+{
+	struct net_linkaddr lladdr = {
+		.addr = &tllao[NET_ICMPV6_OPT_DATA_OFFSET],
+		.len = cached_lladdr->len,
+	};
 
-	k_delayed_work_submit(&net_ipv6_nbr_data(nbr)->reachable, time);
+	net_nbr_update_lladdr(nbr->idx, &lladdr);
 }
 
 static inline bool handle_na_neighbor(struct net_buf *buf,
@@ -1175,9 +1357,7 @@ static inline bool handle_na_neighbor(struct net_buf *buf,
 				cached_lladdr,
 				&NET_ICMPV6_NS_BUF(buf)->tgt);
 
-			memcpy(cached_lladdr->addr,
-			       &tllao[NET_ICMPV6_OPT_DATA_OFFSET],
-			       cached_lladdr->len);
+			update_lladdr_from_tllao(nbr, cached_lladdr, tllao);
 		}
 
 		if (net_is_solicited(buf)) {
@@ -1215,9 +1395,7 @@ static inline bool handle_na_neighbor(struct net_buf *buf,
 				cached_lladdr,
 				&NET_ICMPV6_NS_BUF(buf)->tgt);
 
-			memcpy(cached_lladdr->addr,
-			       &tllao[NET_ICMPV6_OPT_DATA_OFFSET],
-			       cached_lladdr->len);
+			update_lladdr_from_tllao(nbr, cached_lladdr, tllao);
 		}
 
 		if (net_is_solicited(buf)) {
@@ -1579,35 +1757,30 @@ int net_ipv6_start_rs(struct net_if *iface)
 	return net_ipv6_send_rs(iface);
 }
 
-static inline struct net_buf *handle_ra_neighbor(struct net_buf *buf,
-						 struct net_buf *frag,
-						 uint8_t len,
-						 uint16_t offset, uint16_t *pos,
-						 struct net_nbr **nbr)
+static inline bool handle_ra_neighbor(struct net_buf *buf,
+				      struct net_nbuf_cursor *cursor,
+				      uint8_t len,
+				      struct net_nbr **nbr)
 
 {
+	struct net_linkaddr_storage llstorage;
 	struct net_linkaddr lladdr;
-	uint8_t padding;
 
 	if (!nbr) {
-		return NULL;
+		return false;
 	}
 
-	if (net_nbuf_ll_src(buf)->len < lladdr.len) {
-		lladdr.len = net_nbuf_ll_src(buf)->len;
-	}
+	lladdr.addr = llstorage.addr;
+	lladdr.len = min(net_nbuf_ll_src(buf)->len, sizeof(llstorage.storage));
 
-	frag = net_nbuf_read(frag, offset, pos, lladdr.len, lladdr.addr);
-	if (!frag && offset) {
-		return NULL;
+	if (len * 8 - 2 < lladdr.len) {
+		NET_DBG("Too short SLLAO option (%d)", len);
+		return false;
 	}
 
-	padding = len * 8 - 2 - lladdr.len;
-	if (padding) {
-		frag = net_nbuf_read(frag, *pos, pos, padding, NULL);
-		if (!frag && *pos) {
-			return NULL;
-		}
+	if (!net_nbuf_cursor_read(cursor, lladdr.len, lladdr.addr) ||
+	    !net_nbuf_cursor_skip(cursor, len * 8 - 2 - lladdr.len)) {
+		return false;
 	}
 
 	*nbr = nbr_lookup(&net_neighbor.table, net_nbuf_iface(buf),
@@ -1626,7 +1799,7 @@ static inline struct net_buf *handle_ra_neighbor(struct net_buf *buf,
 			NET_ERR("Could not add router neighbor %s [%s]",
 				net_sprint_ipv6_addr(&NET_IPV6_BUF(buf)->src),
 				net_sprint_ll_addr(lladdr.addr, lladdr.len));
-			return NULL;
+			return false;
 		}
 	}
 
@@ -1642,8 +1815,7 @@ static inline struct net_buf *handle_ra_neighbor(struct net_buf *buf,
 						   cached_lladdr,
 						   &NET_IPV6_BUF(buf)->src);
 
-			cached_lladdr->len = lladdr.len;
-			memcpy(cached_lladdr->addr, lladdr.addr, lladdr.len);
+			net_nbr_update_lladdr((*nbr)->idx, &lladdr);
 
 			net_ipv6_nbr_data(*nbr)->state = NET_NBR_STALE;
 		} else {
@@ -1656,7 +1828,7 @@ static inline struct net_buf *handle_ra_neighbor(struct net_buf *buf,
 
 	net_ipv6_nbr_data(*nbr)->is_router = true;
 
-	return frag;
+	return true;
 }
 
 static inline void handle_prefix_onlink(struct net_buf *buf,
@@ -1794,27 +1966,24 @@ static inline void handle_prefix_autonomous(struct net_buf *buf,
 	}
 }
 
-static inline struct net_buf *handle_ra_prefix(struct net_buf *buf,
-					       struct net_buf *frag,
-					       uint8_t len,
-					       uint16_t offset, uint16_t *pos)
+static inline bool handle_ra_prefix(struct net_buf *buf,
+				    struct net_nbuf_cursor *cursor,
+				    uint8_t len)
 {
 	struct net_icmpv6_nd_opt_prefix_info prefix_info;
 
 	prefix_info.type = NET_ICMPV6_ND_OPT_PREFIX_INFO;
 	prefix_info.len = len * 8 - 2;
 
-	frag = net_nbuf_read(frag, offset, pos, 1, &prefix_info.prefix_len);
-	frag = net_nbuf_read(frag, *pos, pos, 1, &prefix_info.flags);
-	frag = net_nbuf_read_be32(frag, *pos, pos, &prefix_info.valid_lifetime);
-	frag = net_nbuf_read_be32(frag, *pos, pos,
-				  &prefix_info.preferred_lifetime);
+	net_nbuf_cursor_read_u8(cursor, &prefix_info.prefix_len);
+	net_nbuf_cursor_read_u8(cursor, &prefix_info.flags);
+	net_nbuf_cursor_read_be32(cursor, &prefix_info.valid_lifetime);
+	net_nbuf_cursor_read_be32(cursor, &prefix_info.preferred_lifetime);
 	/* Skip reserved bytes */
-	frag = net_nbuf_skip(frag, *pos, pos, 4);
-	frag = net_nbuf_read(frag, *pos, pos, sizeof(struct in6_addr),
-			     prefix_info.prefix.s6_addr);
-	if (!frag && *pos) {
-		return NULL;
+	net_nbuf_cursor_skip(cursor, 4);
+	if (!net_nbuf_cursor_read(cursor, sizeof(struct in6_addr),
+				  prefix_info.prefix.s6_addr)) {
+		return false;
 	}
 
 	if (prefix_info.valid_lifetime >= prefix_info.preferred_lifetime &&
@@ -1831,50 +2000,48 @@ static inline struct net_buf *handle_ra_prefix(struct net_buf *buf,
 		}
 	}
 
-	return frag;
+	return true;
 }
 
 #if defined(CONFIG_NET_6LO_CONTEXT)
 /* 6lowpan Context Option RFC 6775, 4.2 */
-static inline struct net_buf *handle_ra_6co(struct net_buf *buf,
-					    struct net_buf *frag,
-					    uint8_t len,
-					    uint16_t offset, uint16_t *pos)
+static inline bool handle_ra_6co(struct net_buf *buf,
+				 struct net_nbuf_cursor *cursor,
+				 uint8_t len)
 {
 	struct net_icmpv6_nd_opt_6co context;
 
 	context.type = NET_ICMPV6_ND_OPT_6CO;
 	context.len = len * 8 - 2;
 
-	frag = net_nbuf_read_u8(frag, offset, pos, &context.context_len);
-	frag = net_nbuf_read_u8(frag, *pos, pos, &context.flag);
+	net_nbuf_cursor_read_u8(cursor, &context.context_len);
+	net_nbuf_cursor_read_u8(cursor, &context.flag);
 
 	/* Skip reserved bytes */
-	frag = net_nbuf_skip(frag, *pos, pos, 2);
-	frag = net_nbuf_read_be16(frag, *pos, pos, &context.lifetime);
+	net_nbuf_cursor_skip(cursor, 2);
+	net_nbuf_cursor_read_be16(cursor, &context.lifetime);
 
 	/* RFC 6775, 4.2 (Length field). Length can be 2 or 3 depending
 	 * on the length of context prefix field.
 	 */
 	if (len == 3) {
-		frag = net_nbuf_read(frag, *pos, pos, sizeof(struct in6_addr),
+		net_nbuf_cursor_read(cursor, sizeof(struct in6_addr),
 				     context.prefix.s6_addr);
 	} else if (len == 2) {
 		/* If length is 2 means only 64 bits of context prefix
 		 * is available, rest set to zeros.
 		 */
-		frag = net_nbuf_read(frag, *pos, pos, 8,
-				     context.prefix.s6_addr);
+		net_nbuf_cursor_read(cursor, 8, context.prefix.s6_addr);
 		memset(context.prefix.s6_addr + 8, 0, 8);
 	}
 
-	if (!frag && *pos) {
-		return NULL;
+	if (cursor->error) {
+		return false;
 	}
 
 	net_6lo_set_context(net_nbuf_iface(buf), &context);
 
-	return frag;
+	return true;
 }
 #endif
 
@@ -1883,12 +2050,11 @@ static enum net_verdict handle_ra_input(struct net_buf *buf)
 	uint16_t total_len = net_buf_frags_len(buf);
 	struct net_nbr *nbr = NULL;
 	struct net_if_router *router;
-	struct net_buf *frag;
+	struct net_nbuf_cursor cursor;
 	uint16_t router_lifetime;
 	uint32_t reachable_time;
 	uint32_t retrans_timer;
 	uint8_t hop_limit;
-	uint16_t offset;
 	uint8_t length;
 	uint8_t type;
 	uint32_t mtu;
@@ -1909,13 +2075,14 @@ static enum net_verdict handle_ra_input(struct net_buf *buf)
 		goto drop;
 	}
 
-	frag = buf->frags;
-	offset = sizeof(struct net_ipv6_hdr) + net_nbuf_ext_len(buf) +
-		sizeof(struct net_icmp_hdr);
+	net_nbuf_cursor_init(&cursor, buf, buf->frags,
+			     sizeof(struct net_ipv6_hdr) +
+			     net_nbuf_ext_len(buf) +
+			     sizeof(struct net_icmp_hdr));
 
-	frag = net_nbuf_read_u8(frag, offset, &offset, &hop_limit);
-	frag = net_nbuf_skip(frag, offset, &offset, 1); /* flags */
-	if (!frag) {
+	net_nbuf_cursor_read_u8(&cursor, &hop_limit);
+	net_nbuf_cursor_skip(&cursor, 1); /* flags */
+	if (cursor.error) {
 		goto drop;
 	}
 
@@ -1925,10 +2092,10 @@ static enum net_verdict handle_ra_input(struct net_buf *buf)
 			net_if_ipv6_get_hop_limit(net_nbuf_iface(buf)));
 	}
 
-	frag = net_nbuf_read_be16(frag, offset, &offset, &router_lifetime);
-	frag = net_nbuf_read_be32(frag, offset, &offset, &reachable_time);
-	frag = net_nbuf_read_be32(frag, offset, &offset, &retrans_timer);
-	if (!frag) {
+	net_nbuf_cursor_read_be16(&cursor, &router_lifetime);
+	net_nbuf_cursor_read_be32(&cursor, &reachable_time);
+	net_nbuf_cursor_read_be32(&cursor, &retrans_timer);
+	if (cursor.error) {
 		goto drop;
 	}
 
@@ -1946,27 +2113,23 @@ static enum net_verdict handle_ra_input(struct net_buf *buf)
 					      retrans_timer);
 	}
 
-	while (frag) {
-		frag = net_nbuf_read(frag, offset, &offset, 1, &type);
-		frag = net_nbuf_read(frag, offset, &offset, 1, &length);
-		if (!frag) {
+	while (!net_nbuf_cursor_is_end(&cursor)) {
+		net_nbuf_cursor_read_u8(&cursor, &type);
+		if (!net_nbuf_cursor_read_u8(&cursor, &length) || !length) {
 			goto drop;
 		}
 
 		switch (type) {
 		case NET_ICMPV6_ND_OPT_SLLAO:
-			frag = handle_ra_neighbor(buf, frag, length, offset,
-						  &offset, &nbr);
-			if (!frag && offset) {
+			if (!handle_ra_neighbor(buf, &cursor, length, &nbr)) {
 				goto drop;
 			}
 
 			break;
 		case NET_ICMPV6_ND_OPT_MTU:
 			/* MTU has reserved 2 bytes, so skip it. */
-			frag = net_nbuf_skip(frag, offset, &offset, 2);
-			frag = net_nbuf_read_be32(frag, offset, &offset, &mtu);
-			if (!frag && offset) {
+			net_nbuf_cursor_skip(&cursor, 2);
+			if (!net_nbuf_cursor_read_be32(&cursor, &mtu)) {
 				goto drop;
 			}
 
@@ -1979,9 +2142,7 @@ static enum net_verdict handle_ra_input(struct net_buf *buf)
 
 			break;
 		case NET_ICMPV6_ND_OPT_PREFIX_INFO:
-			frag = handle_ra_prefix(buf, frag, length, offset,
-						&offset);
-			if (!frag && offset) {
+			if (!handle_ra_prefix(buf, &cursor, length)) {
 				goto drop;
 			}
 
@@ -1994,9 +2155,7 @@ static enum net_verdict handle_ra_input(struct net_buf *buf)
 				goto drop;
 			}
 
-			frag = handle_ra_6co(buf, frag, length, offset,
-					     &offset);
-			if (!frag && offset) {
+			if (!handle_ra_6co(buf, &cursor, length)) {
 				goto drop;
 			}
 
@@ -2019,9 +2178,7 @@ static enum net_verdict handle_ra_input(struct net_buf *buf)
 		default:
 			NET_DBG("Unknown ND option 0x%x", type);
 		skip:
-			frag = net_nbuf_skip(frag, offset, &offset,
-					     length * 8 - 2);
-			if (!frag && offset) {
+			if (!net_nbuf_cursor_skip(&cursor, length * 8 - 2)) {
 				goto drop;
 			}
 
@@ -2078,6 +2235,464 @@ drop:
 }
 #endif /* CONFIG_NET_IPV6_ND */
 
+#if defined(CONFIG_NET_IPV6_FRAGMENT)
+#define NET_IPV6_FRAGH_LEN 8
+#define NET_IPV6_FRAGH_OFFSET_MASK 0xfff8
+#define NET_IPV6_FRAGH_MORE 0x0001
+
+/* The reassembly contexts are accessed from the RX threads and from the
+ * system work queue. These are all cooperative threads and the context
+ * is kept consistent whenever the code below can sleep.
+ */
+static struct net_ipv6_reassembly
+reassembly[CONFIG_NET_IPV6_FRAGMENT_MAX_COUNT];
+
+static uint32_t fragment_id;
+
+static void reassembly_free(struct net_ipv6_reassembly *reass)
+{
+	int i;
+
+	k_delayed_work_cancel(&reass->timer);
+
+	for (i = 0; i < reass->count; i++) {
+		net_nbuf_unref(reass->frag[i].buf);
+		reass->frag[i].buf = NULL;
+	}
+
+	reass->count = 0;
+	reass->total_len = 0;
+}
+
+static void reassembly_timeout(struct k_work *work)
+{
+	struct net_ipv6_reassembly *reass =
+		CONTAINER_OF(work, struct net_ipv6_reassembly, timer);
+	struct net_buf *first = NULL;
+
+	NET_DBG("Reassembly %p id 0x%x timeout, %d fragments received",
+		reass, reass->id, reass->count);
+
+	if (reass->count && reass->frag[0].offset == 0) {
+		first = net_nbuf_ref(reass->frag[0].buf);
+	}
+
+	reassembly_free(reass);
+
+	/* The sender is told about the timeout only if the first
+	 * fragment was received (RFC 2460 ch 4.5).
+	 */
+	if (first) {
+		net_icmpv6_send_error(first, NET_ICMPV6_TIME_EXCEEDED,
+				      NET_ICMPV6_TIME_EXCEEDED_REASSEMBLY, 0);
+		net_nbuf_unref(first);
+	}
+}
+
+static struct net_ipv6_reassembly *reassembly_get(struct in6_addr *src,
+						  struct in6_addr *dst,
+						  uint32_t id)
+{
+	struct net_ipv6_reassembly *free = NULL;
+	int i;
+
+	for (i = 0; i < CONFIG_NET_IPV6_FRAGMENT_MAX_COUNT; i++) {
+		struct net_ipv6_reassembly *reass = &reassembly[i];
+
+		if (!reass->count) {
+			if (!free) {
+				free = reass;
+			}
+
+			continue;
+		}
+
+		if (reass->id == id && net_ipv6_addr_cmp(&reass->src, src) &&
+		    net_ipv6_addr_cmp(&reass->dst, dst)) {
+			return reass;
+		}
+	}
+
+	if (!free) {
+		return NULL;
+	}
+
+	net_ipaddr_copy(&free->src, src);
+	net_ipaddr_copy(&free->dst, dst);
+	free->id = id;
+
+	k_delayed_work_submit(&free->timer,
+			      K_SECONDS(CONFIG_NET_IPV6_FRAGMENT_TIMEOUT));
+
+	return free;
+}
+
+static bool reassembly_complete(struct net_ipv6_reassembly *reass)
+{
+	uint16_t expected = 0;
+	int i;
+
+	if (!reass->total_len) {
+		return false;
+	}
+
+	for (i = 0; i < reass->count; i++) {
+		if (reass->frag[i].offset != expected) {
+			return false;
+		}
+
+		expected += reass->frag[i].len;
+	}
+
+	return expected == reass->total_len;
+}
+
+/* Remove the given amount of header data from the data fragments */
+static void remove_headers(struct net_buf *buf, uint16_t len)
+{
+	while (buf->frags && len) {
+		struct net_buf *frag = buf->frags;
+
+		if (frag->len > len) {
+			net_buf_pull(frag, len);
+			return;
+		}
+
+		len -= frag->len;
+		net_buf_frag_del(buf, frag);
+	}
+}
+
+/* Build the original packet from the fragments that are sorted by offset.
+ * The data fragments of the fragment buffers are chained after the first
+ * fragment, only the unfragmentable headers of the first fragment are
+ * moved to get rid of the Fragment header.
+ */
+static struct net_buf *reassemble_packet(struct net_ipv6_frag *frags,
+					 int count, uint16_t total_len)
+{
+	struct net_buf *buf = frags[0].buf;
+	uint16_t unfrag_len = frags[0].hdr_len - NET_IPV6_FRAGH_LEN;
+	uint16_t nexthdr_pos = offsetof(struct net_ipv6_hdr, nexthdr);
+	uint8_t *data = buf->frags->data;
+	uint8_t nexthdr = data[unfrag_len];
+	uint16_t pos, len;
+	int i;
+
+	/* Find the header that has the Fragment header as next header */
+	for (pos = sizeof(struct net_ipv6_hdr); pos < unfrag_len;
+	     pos += (data[pos + 1] + 1) * 8) {
+		nexthdr_pos = pos;
+	}
+
+	memmove(data + NET_IPV6_FRAGH_LEN, data, unfrag_len);
+	data = net_buf_pull(buf->frags, NET_IPV6_FRAGH_LEN);
+	data[nexthdr_pos] = nexthdr;
+
+	for (i = 1; i < count; i++) {
+		struct net_buf *payload;
+
+		remove_headers(frags[i].buf, frags[i].hdr_len);
+
+		payload = frags[i].buf->frags;
+		frags[i].buf->frags = NULL;
+		net_nbuf_unref(frags[i].buf);
+
+		if (payload) {
+			net_buf_frag_add(buf, payload);
+		}
+	}
+
+	len = unfrag_len - sizeof(struct net_ipv6_hdr) + total_len;
+	NET_IPV6_BUF(buf)->len[0] = len >> 8;
+	NET_IPV6_BUF(buf)->len[1] = len;
+
+	NET_DBG("Reassembled %d bytes from %d fragments", total_len, count);
+
+	return buf;
+}
+
+enum net_verdict net_ipv6_handle_fragment_hdr(struct net_buf *buf,
+					      struct net_buf *frag,
+					      int total_len,
+					      uint16_t pos)
+{
+	struct net_ipv6_reassembly *reass;
+	struct net_ipv6_frag *entry;
+	uint16_t offset, len, end, hdr_len;
+	uint8_t *hdr;
+	uint32_t id;
+	bool more;
+	int i;
+
+	/* The headers are kept in the first data fragment so that the
+	 * Fragment header can be removed without copying the payload.
+	 */
+	hdr_len = pos + NET_IPV6_FRAGH_LEN;
+	if (frag != buf->frags || pos < sizeof(struct net_ipv6_hdr) ||
+	    hdr_len > frag->len) {
+		NET_DBG("Fragment header not in the first fragment");
+		return NET_DROP;
+	}
+
+	hdr = frag->data + pos;
+	offset = sys_get_be16(hdr + 2);
+	more = offset & NET_IPV6_FRAGH_MORE;
+	offset &= NET_IPV6_FRAGH_OFFSET_MASK;
+	id = sys_get_be32(hdr + 4);
+	len = total_len - hdr_len;
+
+	/* A fragment inside a fragment is not allowed, this also limits
+	 * the recursion when the reassembled packet is processed.
+	 */
+	if (!len || hdr[0] == NET_IPV6_NEXTHDR_FRAG) {
+		return NET_DROP;
+	}
+
+	/* All but the last fragment must be a multiple of 8 bytes long */
+	if (more && (len % 8)) {
+		net_icmpv6_send_error(buf, NET_ICMPV6_PARAM_PROBLEM,
+				      NET_ICMPV6_PARAM_PROB_HEADER,
+				      offsetof(struct net_ipv6_hdr, len));
+		return NET_DROP;
+	}
+
+	if (pos - sizeof(struct net_ipv6_hdr) + offset + len > 0xffff) {
+		net_icmpv6_send_error(buf, NET_ICMPV6_PARAM_PROBLEM,
+				      NET_ICMPV6_PARAM_PROB_HEADER, pos + 2);
+		return NET_DROP;
+	}
+
+	NET_DBG("Fragment id 0x%x offset %d len %d%s", id, offset, len,
+		more ? " more" : "");
+
+	if (!offset && !more) {
+		/* Atomic fragment, no need to wait for anything
+		 * (RFC 6946).
+		 */
+		struct net_ipv6_frag atomic = {
+			.buf = buf,
+			.len = len,
+			.hdr_len = hdr_len,
+		};
+
+		return net_ipv6_process_pkt(reassemble_packet(&atomic, 1,
+							      len));
+	}
+
+	reass = reassembly_get(&NET_IPV6_BUF(buf)->src,
+			       &NET_IPV6_BUF(buf)->dst, id);
+	if (!reass) {
+		NET_DBG("No free reassembly context");
+		return NET_DROP;
+	}
+
+	end = offset + len;
+
+	if (!more) {
+		if (reass->total_len && reass->total_len != end) {
+			goto discard;
+		}
+
+		reass->total_len = end;
+	}
+
+	if (reass->total_len && end > reass->total_len) {
+		goto discard;
+	}
+
+	for (i = 0; i < reass->count; i++) {
+		entry = &reass->frag[i];
+
+		if (entry->offset == offset && entry->len == len) {
+			NET_DBG("Duplicate fragment offset %d", offset);
+			return NET_DROP;
+		}
+
+		/* Overlapping fragments discard the whole packet
+		 * (RFC 5722).
+		 */
+		if (offset < entry->offset + entry->len &&
+		    entry->offset < end) {
+			NET_DBG("Overlapping fragment offset %d", offset);
+			goto discard;
+		}
+
+		if (entry->offset > offset) {
+			break;
+		}
+	}
+
+	if (reass->count &&
+	    reass->total_len &&
+	    reass->frag[reass->count - 1].offset +
+	    reass->frag[reass->count - 1].len > reass->total_len) {
+		goto discard;
+	}
+
+	if (reass->count == CONFIG_NET_IPV6_FRAGMENT_MAX_PKT) {
+		NET_DBG("Too many fragments");
+		goto discard;
+	}
+
+	memmove(&reass->frag[i + 1], &reass->frag[i],
+		(reass->count - i) * sizeof(reass->frag[0]));
+
+	entry = &reass->frag[i];
+	entry->buf = buf;
+	entry->offset = offset;
+	entry->len = len;
+	entry->hdr_len = hdr_len;
+	reass->count++;
+
+	if (!reassembly_complete(reass)) {
+		return NET_OK;
+	}
+
+	k_delayed_work_cancel(&reass->timer);
+
+	buf = reassemble_packet(reass->frag, reass->count, reass->total_len);
+
+	/* All the fragments are now in buf */
+	reass->count = 0;
+	reass->total_len = 0;
+
+	if (net_ipv6_process_pkt(buf) == NET_DROP) {
+		net_nbuf_unref(buf);
+	}
+
+	return NET_OK;
+
+discard:
+	reassembly_free(reass);
+
+	return NET_DROP;
+}
+
+int net_ipv6_send_fragmented_pkt(struct net_if *iface, struct net_buf *buf,
+				 uint16_t mtu)
+{
+	struct net_buf *first = buf->frags;
+	uint16_t nexthdr_pos = offsetof(struct net_ipv6_hdr, nexthdr);
+	uint16_t hdr_len = sizeof(struct net_ipv6_hdr);
+	uint8_t next = NET_IPV6_BUF(buf)->nexthdr;
+	uint16_t data_len, max_len, offset, len, pos;
+	struct net_buf *src;
+	uint32_t id;
+
+	/* The Hop-by-Hop and Routing headers are not fragmented */
+	while ((next == NET_IPV6_NEXTHDR_HBHO ||
+		next == NET_IPV6_NEXTHDR_ROUTING) && hdr_len + 2 <= first->len) {
+		nexthdr_pos = hdr_len;
+		next = first->data[hdr_len];
+		hdr_len += (first->data[hdr_len + 1] + 1) * 8;
+	}
+
+	if (hdr_len > first->len ||
+	    hdr_len + NET_IPV6_FRAGH_LEN + 8 > mtu) {
+		NET_DBG("Cannot fragment, headers are %d bytes", hdr_len);
+		return -EINVAL;
+	}
+
+	data_len = net_buf_frags_len(first) - hdr_len;
+	max_len = (mtu - hdr_len - NET_IPV6_FRAGH_LEN) & ~7;
+	id = ++fragment_id;
+
+	src = net_nbuf_skip(first, 0, &pos, hdr_len);
+
+	NET_DBG("Sending %d bytes in fragments of %d bytes, id 0x%x",
+		data_len, max_len, id);
+
+	for (offset = 0; offset < data_len; offset += len) {
+		struct net_buf *frag_buf, *frag;
+		uint16_t payload_len, copied;
+		uint8_t *hdr;
+		bool more;
+
+		len = min(max_len, data_len - offset);
+		more = offset + len < data_len;
+
+		frag_buf = net_nbuf_get_reserve_tx(0);
+		if (!frag_buf) {
+			return -ENOMEM;
+		}
+
+		frag = net_nbuf_get_reserve_data(net_nbuf_ll_reserve(buf));
+		if (!frag) {
+			net_nbuf_unref(frag_buf);
+			return -ENOMEM;
+		}
+
+		net_buf_frag_add(frag_buf, frag);
+
+		if (net_buf_tailroom(frag) < hdr_len + NET_IPV6_FRAGH_LEN) {
+			net_nbuf_unref(frag_buf);
+			return -EINVAL;
+		}
+
+		net_nbuf_set_iface(frag_buf, iface);
+		net_nbuf_set_family(frag_buf, AF_INET6);
+		net_nbuf_set_priority(frag_buf, net_nbuf_priority(buf));
+		net_nbuf_set_ll_reserve(frag_buf, net_nbuf_ll_reserve(buf));
+		net_nbuf_set_ip_hdr_len(frag_buf, sizeof(struct net_ipv6_hdr));
+		net_nbuf_set_ext_len(frag_buf, hdr_len + NET_IPV6_FRAGH_LEN -
+				     sizeof(struct net_ipv6_hdr));
+
+		net_nbuf_ll_src(frag_buf)->addr = net_nbuf_ll_src(buf)->addr;
+		net_nbuf_ll_src(frag_buf)->len = net_nbuf_ll_src(buf)->len;
+		net_nbuf_ll_dst(frag_buf)->addr = net_nbuf_ll_dst(buf)->addr;
+		net_nbuf_ll_dst(frag_buf)->len = net_nbuf_ll_dst(buf)->len;
+
+		hdr = net_buf_add(frag, hdr_len + NET_IPV6_FRAGH_LEN);
+		memcpy(hdr, first->data, hdr_len);
+
+		hdr[nexthdr_pos] = NET_IPV6_NEXTHDR_FRAG;
+		hdr[hdr_len] = next;
+		hdr[hdr_len + 1] = 0;
+		sys_put_be16(offset | (more ? NET_IPV6_FRAGH_MORE : 0),
+			     hdr + hdr_len + 2);
+		sys_put_be32(id, hdr + hdr_len + 4);
+
+		payload_len = hdr_len + NET_IPV6_FRAGH_LEN + len -
+			sizeof(struct net_ipv6_hdr);
+		NET_IPV6_BUF(frag_buf)->len[0] = payload_len >> 8;
+		NET_IPV6_BUF(frag_buf)->len[1] = payload_len;
+
+		for (copied = 0; copied < len; ) {
+			uint16_t count = min(len - copied, src->len - pos);
+
+			if (!net_nbuf_append(frag_buf, count, src->data + pos)) {
+				net_nbuf_unref(frag_buf);
+				return -ENOMEM;
+			}
+
+			copied += count;
+			pos += count;
+
+			if (pos == src->len) {
+				src = src->frags;
+				pos = 0;
+			}
+		}
+
+		/* The sender is notified when the last fragment is sent */
+		if (!more) {
+			net_nbuf_set_context(frag_buf, net_nbuf_context(buf));
+			net_nbuf_set_token(frag_buf, net_nbuf_token(buf));
+		}
+
+		if (net_if_send_data(iface, frag_buf) == NET_DROP) {
+			net_nbuf_unref(frag_buf);
+			return -EIO;
+		}
+	}
+
+	net_nbuf_unref(buf);
+
+	return 0;
+}
+#endif /* CONFIG_NET_IPV6_FRAGMENT */
+
 #if defined(CONFIG_NET_IPV6_ND)
 static struct net_icmpv6_handler ns_input_handler = {
 	.type = NET_ICMPV6_NS,
@@ -2104,5 +2719,24 @@ void net_ipv6_init(void)
 	net_icmpv6_register_handler(&ns_input_handler);
 	net_icmpv6_register_handler(&na_input_handler);
 	net_icmpv6_register_handler(&ra_input_handler);
+
+	nbr_timer_init();
+#endif
+
+#if defined(CONFIG_NET_IPV6_FRAGMENT)
+	do {
+		int i;
+
+		for (i = 0; i < CONFIG_NET_IPV6_FRAGMENT_MAX_COUNT; i++) {
+			k_delayed_work_init(&reassembly[i].timer,
+					    reassembly_timeout);
+		}
+
+		fragment_id = sys_rand32_get();
+
+		NET_DBG("Allocated %d reassembly contexts (%zu bytes)",
+			CONFIG_NET_IPV6_FRAGMENT_MAX_COUNT,
+			sizeof(reassembly));
+	} while (0);
 #endif
 }
@@ -32,6 +32,7 @@
 
 #include "icmpv6.h"
 #include "nbr.h"
+#include "timer_wheel.h"
 
 #define NET_IPV6_ND_HOP_LIMIT 255
 #define NET_IPV6_ND_INFINITE_LIFETIME 0xFFFFFFFF
@@ -82,8 +83,8 @@ struct net_ipv6_nbr_data {
 	/** IPv6 address. */
 	struct in6_addr addr;
 
-	/** Reachable timer. */
-	struct k_delayed_work reachable;
+	/** Timer of the reachability state machine. */
+	struct net_timer_wheel_timer timer;
 
 	/** Neighbor Solicitation timer for DAD */
 	struct k_delayed_work send_ns;
@@ -99,6 +100,9 @@ struct net_ipv6_nbr_data {
 
 	/** Is the neighbor a router */
 	bool is_router;
+
+	/** Next neighbor in the same address hash bucket. */
+	uint8_t hash_next;
 };
 
 static inline struct net_ipv6_nbr_data *net_ipv6_nbr_data(struct net_nbr *nbr)
@@ -266,6 +270,16 @@ struct net_nbr *net_ipv6_nbr_add(struct net_if *iface,
 void net_ipv6_nbr_set_reachable_timer(struct net_if *iface,
 				      struct net_nbr *nbr);
 
+typedef void (*net_nbr_cb_t)(struct net_nbr *nbr, void *user_data);
+
+/**
+ * @brief Go through all the neighbors in the neighbor cache.
+ *
+ * @param cb User supplied callback function to call.
+ * @param user_data User specified data.
+ */
+void net_ipv6_nbr_foreach(net_nbr_cb_t cb, void *user_data);
+
 #else /* CONFIG_NET_IPV6_ND */
 static inline struct net_buf *net_ipv6_prepare_for_send(struct net_buf *buf)
 {
@@ -300,7 +314,98 @@ static inline void net_ipv6_nbr_set_reachable_timer(struct net_if *iface,
 }
 #endif
 
+#if defined(CONFIG_NET_IPV6_FRAGMENT)
+/**
+ * @brief Received fragment of an IPv6 packet.
+ */
+struct net_ipv6_frag {
+	/** Network buffer of the fragment, headers included */
+	struct net_buf *buf;
+
+	/** Offset of the fragment data in the original packet */
+	uint16_t offset;
+
+	/** Length of the fragment data */
+	uint16_t len;
+
+	/** Length of the headers before the fragment data */
+	uint16_t hdr_len;
+};
+
+/**
+ * @brief Reassembly context of a fragmented IPv6 packet.
+ */
+struct net_ipv6_reassembly {
+	/** Source address of the fragments */
+	struct in6_addr src;
+
+	/** Destination address of the fragments */
+	struct in6_addr dst;
+
+	/** Fragment identification */
+	uint32_t id;
+
+	/** Length of the original packet data, 0 until the last
+	 * fragment is received.
+	 */
+	uint16_t total_len;
+
+	/** Number of received fragments, 0 if the context is free */
+	uint8_t count;
+
+	/** Reassembly timer */
+	struct k_delayed_work timer;
+
+	/** Received fragments ordered by offset */
+	struct net_ipv6_frag frag[CONFIG_NET_IPV6_FRAGMENT_MAX_PKT];
+};
+
+/**
+ * @brief Handle the Fragment header of a received IPv6 packet.
+ *
+ * @details The fragment is stored until all the fragments of the packet
+ * are received. Then the data fragments of the received buffers are
+ * chained together without copying and the reassembled packet is
+ * passed to the IPv6 input processing.
+ *
+ * @param buf Network buffer of the received fragment
+ * @param frag Data fragment that contains the Fragment header
+ * @param total_len Length of the received IPv6 packet
+ * @param pos Offset of the Fragment header in frag
+ *
+ * @return NET_OK if the fragment was consumed, NET_DROP if the caller
+ * needs to drop it.
+ */
+enum net_verdict net_ipv6_handle_fragment_hdr(struct net_buf *buf,
+					      struct net_buf *frag,
+					      int total_len,
+					      uint16_t pos);
+
+/**
+ * @brief Send an IPv6 packet that is larger than the MTU as fragments.
+ *
+ * @param iface Network interface to send the fragments to
+ * @param buf Network buffer, it is released when all the fragments
+ * have been sent.
+ * @param mtu Maximum size of one fragment
+ *
+ * @return 0 if ok, <0 if error. In case of an error the caller needs
+ * to release buf.
+ */
+int net_ipv6_send_fragmented_pkt(struct net_if *iface, struct net_buf *buf,
+				 uint16_t mtu);
+#endif /* CONFIG_NET_IPV6_FRAGMENT */
+
 #if defined(CONFIG_NET_IPV6)
+/**
+ * @brief Process a received IPv6 packet.
+ *
+ * @param buf Network buffer that starts with the IPv6 header
+ *
+ * @return NET_OK if the packet was consumed, NET_DROP otherwise.
+ */
+enum net_verdict net_ipv6_process_pkt(struct net_buf *buf);
+
 void net_ipv6_init(void);
 #else
 #define net_ipv6_init(...)
@@ -24,6 +24,7 @@
 #endif
 
 #include <errno.h>
+#include <misc/slist.h>
 #include <net/net_core.h>
 #include <net/nbuf.h>
 #include <net/net_if.h>
@@ -31,65 +32,182 @@
 #include <net/arp.h>
 #include "net_private.h"
 
+/* How long to wait for an ARP reply before the pending packets are dropped */
+#define ARP_REQUEST_TIMEOUT K_SECONDS(2)
+
+#define ARP_ENTRY_LIFETIME K_SECONDS(CONFIG_NET_ARP_ENTRY_LIFETIME)
+#define ARP_REFRESH_TIME K_SECONDS(CONFIG_NET_ARP_REFRESH_TIME)
+
+enum arp_state {
+	ARP_STATE_FREE = 0,
+	ARP_STATE_INCOMPLETE,
+	ARP_STATE_REACHABLE,
+};
+
 struct arp_entry {
-	uint32_t time;	/* FIXME - implement timeout functionality */
+	/* Hash bucket of the address, or the list of free entries */
+	sys_snode_t node;
+
+	/* When the request was sent or the address was last resolved */
+	uint32_t time;
+
 	struct net_if *iface;
-	struct net_buf *pending;
+
+	/* Packets waiting for the address to be resolved */
+	struct net_buf *pending[CONFIG_NET_ARP_PENDING_COUNT];
+	uint8_t pending_count;
+
+	uint8_t state;
+
+	/* The entry was used for sending since it was last resolved */
+	bool used;
+
+	/* A unicast request was sent to refresh the entry */
+	bool refreshing;
+
+	/* Address of the next hop, i.e. the gateway for non-local hosts */
 	struct in_addr ip;
 	struct net_eth_addr eth;
 };
 
 static struct arp_entry arp_table[CONFIG_NET_ARP_TABLE_SIZE];
+static sys_slist_t arp_hash[CONFIG_NET_ARP_HASH_SIZE];
+static sys_slist_t arp_free;
+
+static struct k_delayed_work arp_timer;
+static uint32_t arp_timer_expiry;
+static bool arp_timer_active;
+
+static inline uint32_t arp_hash_key(struct in_addr *addr)
+{
+	uint32_t key = UNALIGNED_GET(&addr->s4_addr32[0]);
+
+	/* Fold all the octets together, the hosts in a subnet usually
+	 * differ only in the last ones.
+	 */
+	key ^= key >> 16;
+	key ^= key >> 8;
+
+	return (key & 0xff) % CONFIG_NET_ARP_HASH_SIZE;
+}
 
 static inline struct arp_entry *find_entry(struct net_if *iface,
-					   struct in_addr *dst,
-					   struct arp_entry **free_entry,
-					   struct arp_entry **non_pending)
+					   struct in_addr *dst)
 {
-	int i;
+	sys_snode_t *sn;
 
-	NET_DBG("dst %s", net_sprint_ipv4_addr(dst));
+	SYS_SLIST_FOR_EACH_NODE(&arp_hash[arp_hash_key(dst)], sn) {
+		struct arp_entry *entry = CONTAINER_OF(sn, struct arp_entry,
+						       node);
 
-	for (i = 0; i < CONFIG_NET_ARP_TABLE_SIZE; i++) {
+		if (entry->iface == iface &&
+		    net_ipv4_addr_cmp(&entry->ip, dst)) {
+			return entry;
+		}
+	}
 
-		NET_DBG("[%d] iface %p dst %s ll %s pending %p", i, iface,
-			net_sprint_ipv4_addr(&arp_table[i].ip),
-			net_sprint_ll_addr((uint8_t *)&arp_table[i].eth.addr,
-					   sizeof(struct net_eth_addr)),
-			arp_table[i].pending);
+	return NULL;
+}
 
-		if (arp_table[i].iface == iface &&
-		    net_ipv4_addr_cmp(&arp_table[i].ip, dst)) {
-			/* Is there already pending operation for this
-			 * IP address.
-			 */
-			if (arp_table[i].pending) {
-				NET_DBG("ARP already pending to %s ll %s",
-					net_sprint_ipv4_addr(dst),
-					net_sprint_ll_addr((uint8_t *)
-						&arp_table[i].eth.addr,
-						sizeof(struct net_eth_addr)));
-				*free_entry = NULL;
-				*non_pending = NULL;
-				return NULL;
+static void arp_timer_schedule(uint32_t expiry)
+{
+	int32_t delay;
+
+	/* The timer is only moved earlier, the handler finds the next
+	 * expiry time itself.
+	 */
+	if (arp_timer_active && (int32_t)(expiry - arp_timer_expiry) >= 0) {
+		return;
+	}
+
+	arp_timer_expiry = expiry;
+	arp_timer_active = true;
+
+	delay = expiry - k_uptime_get_32();
+
+	k_delayed_work_submit(&arp_timer, delay > 0 ? delay : 0);
+}
+
+static void drop_pending(struct arp_entry *entry)
+{
+	while (entry->pending_count) {
+		struct net_buf *pending = entry->pending[--entry->pending_count];
+
+		NET_DBG("Dropping pending buf %p", pending);
+
+		/* The cache holds one reference and the sender gave
+		 * us the other one.
+		 */
+		net_nbuf_unref(pending);
+		net_nbuf_unref(pending);
+	}
+}
+
+static void release_entry(struct arp_entry *entry)
+{
+	NET_DBG("Releasing entry %s iface %p",
+		net_sprint_ipv4_addr(&entry->ip), entry->iface);
+
+	sys_slist_find_and_remove(&arp_hash[arp_hash_key(&entry->ip)],
+				  &entry->node);
+
+	drop_pending(entry);
+
+	entry->state = ARP_STATE_FREE;
+	entry->iface = NULL;
+}
+
+static void free_entry(struct arp_entry *entry)
+{
+	release_entry(entry);
+
+	sys_slist_append(&arp_free, &entry->node);
+}
+
+static struct arp_entry *alloc_entry(struct net_if *iface,
+				     struct in_addr *dst)
+{
+	struct arp_entry *entry = NULL;
+	sys_snode_t *sn;
+	int i;
+
+	sn = sys_slist_get(&arp_free);
+	if (sn) {
+		entry = CONTAINER_OF(sn, struct arp_entry, node);
+	} else {
+		/* Reuse the oldest resolved entry. Entries waiting for
+		 * a reply are never taken over.
+		 */
+		for (i = 0; i < CONFIG_NET_ARP_TABLE_SIZE; i++) {
+			if (arp_table[i].state != ARP_STATE_REACHABLE) {
+				continue;
 			}
 
-			return &arp_table[i];
+			if (!entry ||
+			    (int32_t)(arp_table[i].time - entry->time) < 0) {
+				entry = &arp_table[i];
+			}
 		}
 
-		/* We return also the first free entry */
-		if (!*free_entry && !arp_table[i].pending &&
-		    !arp_table[i].iface) {
-			*free_entry = &arp_table[i];
+		if (!entry) {
+			return NULL;
 		}
 
-		/* And also first non pending entry */
-		if (!*non_pending && !arp_table[i].pending) {
-			*non_pending = &arp_table[i];
-		}
+		release_entry(entry);
 	}
 
-	return NULL;
+	entry->iface = iface;
+	entry->state = ARP_STATE_INCOMPLETE;
+	entry->time = k_uptime_get_32();
+	entry->used = false;
+	entry->refreshing = false;
+	net_ipaddr_copy(&entry->ip, dst);
+
+	sys_slist_prepend(&arp_hash[arp_hash_key(dst)], &entry->node);
+
+	arp_timer_schedule(entry->time + ARP_REQUEST_TIMEOUT);
+
+	return entry;
 }
 
 static inline struct in_addr *if_get_addr(struct net_if *iface)
@@ -107,7 +225,12 @@ static inline struct in_addr *if_get_addr(struct net_if *iface)
 	return NULL;
 }
 
+/* Create an ARP request for next_addr. The request is broadcast unless
+ * the entry is already resolved, in which case it is sent directly to
+ * the cached link layer address to refresh the entry.
+ */
 static inline struct net_buf *prepare_arp(struct net_if *iface,
+					  struct in_addr *next_addr,
 					  struct arp_entry *entry,
 					  struct net_buf *pending)
 {
@@ -118,45 +241,36 @@ static inline struct net_buf *prepare_arp(struct net_if *iface,
 
 	buf = net_nbuf_get_reserve_tx(0);
 	if (!buf) {
-		goto fail;
+		return NULL;
 	}
 
 	frag = net_nbuf_get_reserve_data(sizeof(struct net_eth_hdr));
 	if (!frag) {
-		goto fail;
+		net_nbuf_unref(buf);
+		return NULL;
 	}
 
 	net_buf_frag_add(buf, frag);
 	net_nbuf_set_iface(buf, iface);
 	net_nbuf_set_family(buf, AF_INET);
+	net_nbuf_set_priority(buf, NET_PRIORITY_IC);
 	net_nbuf_set_ll_reserve(buf, sizeof(struct net_eth_hdr));
 
 	hdr = NET_ARP_BUF(buf);
 	eth = NET_ETH_BUF(buf);
 
-	/* If entry is not set, then we are just about to send
-	 * an ARP request using the data in pending net_buf.
-	 * This can happen if there is already a pending ARP
-	 * request and we want to send it again.
-	 */
-	if (entry) {
-		entry->pending = net_buf_ref(pending);
-		entry->iface = net_nbuf_iface(buf);
+	memcpy(&eth->src.addr, net_if_get_link_addr(iface)->addr,
+	       sizeof(struct net_eth_addr));
 
-		net_ipaddr_copy(&entry->ip, &NET_IPV4_BUF(pending)->dst);
+	eth->type = htons(NET_ETH_PTYPE_ARP);
 
-		memcpy(&eth->src.addr,
-		       net_if_get_link_addr(entry->iface)->addr,
+	if (entry && entry->state == ARP_STATE_REACHABLE) {
+		memcpy(&eth->dst.addr, &entry->eth.addr,
 		       sizeof(struct net_eth_addr));
 	} else {
-		memcpy(&eth->src.addr,
-		       net_if_get_link_addr(iface)->addr,
-		       sizeof(struct net_eth_addr));
+		memset(&eth->dst.addr, 0xff, sizeof(struct net_eth_addr));
 	}
 
-	eth->type = htons(NET_ETH_PTYPE_ARP);
-	memset(&eth->dst.addr, 0xff, sizeof(struct net_eth_addr));
-
 	hdr->hwtype = htons(NET_ARP_HTYPE_ETH);
 	hdr->protocol = htons(NET_ETH_PTYPE_IP);
 	hdr->hwlen = sizeof(struct net_eth_addr);
@@ -165,18 +279,13 @@ static inline struct net_buf *prepare_arp(struct net_if *iface,
 
 	memset(&hdr->dst_hwaddr.addr, 0x00, sizeof(struct net_eth_addr));
 
-	/* Is the destination in local network */
-	if (!net_if_ipv4_addr_mask_cmp(iface, &NET_IPV4_BUF(pending)->dst)) {
-		net_ipaddr_copy(&hdr->dst_ipaddr, &iface->ipv4.gw);
-	} else {
-		net_ipaddr_copy(&hdr->dst_ipaddr, &NET_IPV4_BUF(pending)->dst);
-	}
+	net_ipaddr_copy(&hdr->dst_ipaddr, next_addr);
 
 	memcpy(hdr->src_hwaddr.addr, eth->src.addr,
 	       sizeof(struct net_eth_addr));
 
-	if (entry) {
-		my_addr = if_get_addr(entry->iface);
+	if (entry || !pending) {
+		my_addr = if_get_addr(iface);
 	} else {
 		my_addr = &NET_IPV4_BUF(pending)->src;
 	}
@@ -190,19 +299,84 @@ static inline struct net_buf *prepare_arp(struct net_if *iface,
 	net_buf_add(frag, sizeof(struct net_arp_hdr));
 
 	return buf;
+}
 
-fail:
-	net_nbuf_unref(buf);
-	net_nbuf_unref(pending);
-	return NULL;
+static void arp_refresh(struct arp_entry *entry)
+{
+	struct net_buf *req;
+
+	NET_DBG("Refreshing %s", net_sprint_ipv4_addr(&entry->ip));
+
+	entry->refreshing = true;
+
+	req = prepare_arp(entry->iface, &entry->ip, entry, NULL);
+	if (req) {
+		net_if_queue_tx(entry->iface, req);
+	}
+}
+
+static void arp_timeout(struct k_work *work)
+{
+	uint32_t now = k_uptime_get_32();
+	uint32_t expiry = 0;
+	bool found = false;
+	int i;
+
+	ARG_UNUSED(work);
+
+	arp_timer_active = false;
+
+	for (i = 0; i < CONFIG_NET_ARP_TABLE_SIZE; i++) {
+		struct arp_entry *entry = &arp_table[i];
+		uint32_t next;
+
+		if (entry->state == ARP_STATE_FREE) {
+			continue;
+		}
+
+		if (entry->state == ARP_STATE_INCOMPLETE) {
+			next = entry->time + ARP_REQUEST_TIMEOUT;
+		} else if (entry->used && !entry->refreshing) {
+			next = entry->time + ARP_ENTRY_LIFETIME -
+				ARP_REFRESH_TIME;
+		} else {
+			next = entry->time + ARP_ENTRY_LIFETIME;
+		}
+
+		if ((int32_t)(now - next) >= 0) {
+			/* Entries that are in use are refreshed before
+			 * they expire so that the senders never need to
+			 * wait for the address to be resolved again.
+			 */
+			if (entry->state == ARP_STATE_REACHABLE &&
+			    entry->used && !entry->refreshing) {
+				arp_refresh(entry);
+				next = entry->time + ARP_ENTRY_LIFETIME;
+			} else {
+				free_entry(entry);
+				continue;
+			}
+		}
+
+		if (!found || (int32_t)(next - expiry) < 0) {
+			expiry = next;
+			found = true;
+		}
+	}
+
+	if (found) {
+		arp_timer_schedule(expiry);
+	}
 }
 
 struct net_buf *net_arp_prepare(struct net_buf *buf)
 {
 	struct net_buf *frag;
-	struct arp_entry *entry, *free_entry = NULL, *non_pending = NULL;
+	struct arp_entry *entry;
 	struct net_linkaddr *ll;
 	struct net_eth_hdr *hdr;
+	struct net_if *iface;
+	struct in_addr *next_addr;
 
 	if (!buf || !buf->frags) {
 		return NULL;
@@ -237,40 +411,67 @@ struct net_buf *net_arp_prepare(struct net_buf *buf)
 		buf = net_nbuf_compact(buf);
 	}
 
-	hdr = (struct net_eth_hdr *)net_nbuf_ll(buf);
+	iface = net_nbuf_iface(buf);
+
+	/* Packets to other networks are sent to the gateway so all of
+	 * them share its cache entry.
+	 */
+	if (!net_if_ipv4_addr_mask_cmp(iface, &NET_IPV4_BUF(buf)->dst)) {
+		next_addr = &iface->ipv4.gw;
+	} else {
+		next_addr = &NET_IPV4_BUF(buf)->dst;
+	}
 
 	/* If the destination address is already known, we do not need
 	 * to send any ARP packet.
 	 */
-	entry = find_entry(net_nbuf_iface(buf),
-			   &NET_IPV4_BUF(buf)->dst,
-			   &free_entry, &non_pending);
-	if (!entry) {
-		if (!free_entry) {
-			/* So all the slots are occupied, use the first
-			 * that can be taken.
-			 */
-			if (!non_pending) {
-				/* We cannot send the packet, the ARP
-				 * cache is full or there is already a
-				 * pending query to this IP address,
-				 * so this packet must be discarded.
-				 */
-				struct net_buf *req;
+	entry = find_entry(iface, next_addr);
+	if (!entry || entry->state != ARP_STATE_REACHABLE) {
+		struct net_buf *req;
 
-				req = prepare_arp(net_nbuf_iface(buf),
-						  NULL, buf);
-				NET_DBG("Resending ARP %p", req);
-
-				net_nbuf_unref(buf);
+		if (!entry) {
+			entry = alloc_entry(iface, next_addr);
+		}
 
-				return req;
+		req = prepare_arp(iface, next_addr, entry, buf);
+		if (!req) {
+			/* The caller will drop the packet */
+			if (entry && !entry->pending_count) {
+				free_entry(entry);
 			}
 
-			free_entry = non_pending;
+			return NULL;
+		}
+
+		if (!entry ||
+		    entry->pending_count >= CONFIG_NET_ARP_PENDING_COUNT) {
+			/* We cannot send the packet, the ARP cache is
+			 * full of pending requests or there is no more
+			 * room for packets to this IP address, so this
+			 * packet must be discarded. The request is sent
+			 * again though.
+			 */
+			NET_DBG("Resending ARP %p", req);
+
+			net_nbuf_unref(buf);
+
+			return req;
 		}
 
-		return prepare_arp(net_nbuf_iface(buf), free_entry, buf);
+		NET_DBG("Queueing buf %p to %s (%d pending)", buf,
+			net_sprint_ipv4_addr(next_addr),
+			entry->pending_count + 1);
+
+		entry->pending[entry->pending_count++] = net_buf_ref(buf);
+
+		return req;
+	}
+
+	if (!entry->used) {
+		entry->used = true;
+
+		arp_timer_schedule(entry->time + ARP_ENTRY_LIFETIME -
+				   ARP_REFRESH_TIME);
 	}
 
 	ll = net_if_get_link_addr(entry->iface);
@@ -304,15 +505,16 @@ struct net_buf *net_arp_prepare(struct net_buf *buf)
 	return buf;
 }
 
-static inline void send_pending(struct net_if *iface, struct net_buf **buf)
+static inline void send_pending(struct net_if *iface, struct net_buf *pending)
 {
-	struct net_buf *pending = *buf;
-
 	NET_DBG("dst %s pending %p frag %p",
 		net_sprint_ipv4_addr(&NET_IPV4_BUF(pending)->dst), pending,
 		pending->frags);
 
-	*buf = NULL;
+	/* Set the dst in the pending packet */
+	net_nbuf_ll_dst(pending)->len = sizeof(struct net_eth_addr);
+	net_nbuf_ll_dst(pending)->addr =
+		(uint8_t *)&NET_ETH_BUF(pending)->dst.addr;
 
 	if (net_if_send_data(iface, pending) == NET_DROP) {
 		/* This is to unref the original ref */
@@ -331,41 +533,49 @@ static inline void arp_update(struct net_if *iface,
 			      struct in_addr *src,
 			      struct net_eth_addr *hwaddr)
 {
-	int i;
+	struct net_buf *pending[CONFIG_NET_ARP_PENDING_COUNT];
+	struct arp_entry *entry;
+	int i, count;
 
 	NET_DBG("src %s", net_sprint_ipv4_addr(src));
 
-	for (i = 0; i < CONFIG_NET_ARP_TABLE_SIZE; i++) {
+	/* We only update the ARP cache for the addresses that we
+	 * are already interested in.
+	 */
+	entry = find_entry(iface, src);
+	if (!entry) {
+		return;
+	}
 
-		NET_DBG("[%d] iface %p dst %s ll %s pending %p", i, iface,
-			net_sprint_ipv4_addr(&arp_table[i].ip),
-			net_sprint_ll_addr((uint8_t *)&arp_table[i].eth.addr,
-					   sizeof(struct net_eth_addr)),
-			arp_table[i].pending);
-
-		if (arp_table[i].iface == iface &&
-		    net_ipv4_addr_cmp(&arp_table[i].ip, src)) {
-
-			if (arp_table[i].pending) {
-				/* We only update the ARP cache if we were
-				 * initiating a request.
-				 */
-				memcpy(&arp_table[i].eth, hwaddr,
-				       sizeof(struct net_eth_addr));
-
-				/* Set the dst in the pending packet */
-				net_nbuf_ll_dst(arp_table[i].pending)->len =
-					sizeof(struct net_eth_addr);
-				net_nbuf_ll_dst(arp_table[i].pending)->addr =
-					(uint8_t *)
-					&NET_ETH_BUF(arp_table[i].pending)->dst.addr;
-
-				send_pending(iface, &arp_table[i].pending);
-			}
+	NET_DBG("iface %p dst %s ll %s pending %d", iface,
+		net_sprint_ipv4_addr(&entry->ip),
+		net_sprint_ll_addr((uint8_t *)hwaddr,
+				   sizeof(struct net_eth_addr)),
+		entry->pending_count);
 
-			return;
-		}
+	memcpy(&entry->eth, hwaddr, sizeof(struct net_eth_addr));
+
+	entry->state = ARP_STATE_REACHABLE;
+	entry->time = k_uptime_get_32();
+	entry->refreshing = false;
+
+	/* The pending packets go through net_arp_prepare() again so
+	 * they are taken out of the entry before sending.
+	 */
+	count = entry->pending_count;
+	memcpy(pending, entry->pending, count * sizeof(struct net_buf *));
+	entry->pending_count = 0;
+
+	for (i = 0; i < count; i++) {
+		send_pending(iface, pending[i]);
 	}
+
+	/* Check later whether the entry is still in use, the packets
+	 * that were waiting for the reply do not count.
+	 */
+	entry->used = false;
+
+	arp_timer_schedule(entry->time + ARP_ENTRY_LIFETIME);
 }
 
 static inline struct net_buf *prepare_arp_reply(struct net_if *iface,
@@ -388,6 +598,7 @@ static inline struct net_buf *prepare_arp_reply(struct net_if *iface,
 	net_buf_frag_add(buf, frag);
 	net_nbuf_set_iface(buf, iface);
 	net_nbuf_set_family(buf, AF_INET);
+	net_nbuf_set_priority(buf, NET_PRIORITY_IC);
 	net_nbuf_set_ll_reserve(buf, sizeof(struct net_eth_hdr));
 
 	hdr = NET_ARP_BUF(buf);
@@ -464,6 +675,12 @@ enum net_verdict net_arp_input(struct net_buf *buf)
 		} while (0);
 #endif
 
+		/* The sender is probably going to talk to us, so refresh
+		 * its entry if we have one.
+		 */
+		arp_update(net_nbuf_iface(buf), &arp_hdr->src_ipaddr,
+			   &arp_hdr->src_hwaddr);
+
 		/* Send reply */
 		reply = prepare_arp_reply(net_nbuf_iface(buf), buf);
 		if (reply) {
@@ -484,5 +701,22 @@ enum net_verdict net_arp_input(struct net_buf *buf)
 
 void net_arp_init(void)
 {
+	int i;
+
+	k_delayed_work_cancel(&arp_timer);
+
 	memset(&arp_table, 0, sizeof(arp_table));
+
+	sys_slist_init(&arp_free);
+
+	for (i = 0; i < CONFIG_NET_ARP_HASH_SIZE; i++) {
+		sys_slist_init(&arp_hash[i]);
+	}
+
+	for (i = 0; i < CONFIG_NET_ARP_TABLE_SIZE; i++) {
+		sys_slist_append(&arp_free, &arp_table[i].node);
+	}
+
+	k_delayed_work_init(&arp_timer, arp_timeout);
+	arp_timer_active = false;
 }
@@ -274,6 +274,14 @@ setup_hdr:
 	NET_ASSERT_INFO(frag, "No data!");
 
 	while (frag) {
+		/* External data has no room for the header, the drivers
+		 * take the header from the first fragment anyway.
+		 */
+		if (net_nbuf_is_ext(frag)) {
+			frag = frag->frags;
+			continue;
+		}
+
 		NET_ASSERT(net_buf_headroom(frag) > sizeof(struct net_eth_addr));
 
 		hdr = (struct net_eth_hdr *)(frag->data -
@@ -299,6 +299,12 @@ static enum net_verdict ieee802154_send(struct net_if *iface,
 			return NET_DROP;
 		}
 
+		/* Only the fragmentation copies external data into frames */
+		if (net_nbuf_is_ext(frag)) {
+			NET_ERR("Frag %p has external data", frag);
+			return NET_DROP;
+		}
+
 		if (!ieee802154_create_data_frame(iface, &dst,
 						  frag->data - reserved_space,
 						  reserved_space)) {
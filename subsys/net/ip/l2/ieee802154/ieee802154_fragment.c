@@ -34,27 +34,49 @@
 #include "net_private.h"
 #include "6lo.h"
 #include "6lo_private.h"
+#include "timer_wheel.h"
 
 #define FRAG_REASSEMBLY_TIMEOUT (MSEC_PER_SEC * \
 				 CONFIG_NET_L2_IEEE802154_REASSEMBLY_TIMEOUT)
 #define REASS_CACHE_SIZE CONFIG_NET_L2_IEEE802154_FRAGMENT_REASS_CACHE_SIZE
+#define REASS_FRAGS CONFIG_NET_L2_IEEE802154_FRAGMENT_REASS_FRAGS
+
+/* Link layer address of the sender, 802.15.4 extended address at most */
+#define REASS_SRC_LEN 8
 
 static uint16_t datagram_tag;
 
 /**
- *  Reasseble cache : Depends on cache size it used for reassemble
- *  IPv6 packets simultaneously.
+ *  Reassembly cache: datagrams from different senders are reassembled
+ *  at the same time, each one in its own entry. The received fragments
+ *  are kept as they are, ordered by offset, and linked together when
+ *  the datagram is complete.
  */
 struct frag_cache {
-	struct k_delayed_work timer;	/* Reassemble timer */
-	struct net_buf *buf;		/* Reassemble buffer */
-	uint16_t size;			/* Datagram size */
-	uint16_t tag;			/* Datagram tag */
+	struct net_timer_wheel_timer timer;	/* Reassembly timeout */
+	struct net_buf *frags[REASS_FRAGS];	/* Fragments by offset */
+	uint8_t offset[REASS_FRAGS];		/* Offsets in 8 octet units */
+	uint8_t count;				/* Number of fragments */
+	uint16_t received;			/* Bytes received */
+	uint16_t ll_reserve;			/* ll reserve of first frag */
+	struct net_if *iface;
+	uint8_t src[REASS_SRC_LEN];		/* Sender ll address */
+	uint8_t src_len;
+	uint16_t size;				/* Datagram size */
+	uint16_t tag;				/* Datagram tag */
 	bool used;
 };
 
 static struct frag_cache cache[REASS_CACHE_SIZE];
 
+/* The reassembly timers are kept in a timer wheel */
+#define REASS_TIMER_TICK MSEC_PER_SEC
+#define REASS_TIMER_SLOTS 8
+
+static sys_dlist_t reass_timer_slots[REASS_TIMER_SLOTS];
+static struct net_timer_wheel reass_timer;
+static bool reass_timer_ready;
+
 /**
  *  RFC 4944, section 5.3
  *  If an entire payload (e.g., IPv6) datagram fits within a single 802.15.4
@@ -134,55 +156,41 @@ static inline uint8_t calc_max_payload(struct net_buf *buf,
 	return (max & 0xF8);
 }
 
-static inline uint8_t move_frag_data(struct net_buf *frag,
-				     struct net_buf *next,
-				     uint8_t max, uint8_t moved,
-				     uint8_t offset,
-				     int hdr_diff)
+/* Copy up to len bytes from the source fragments into the frame. Source
+ * fragments are released as soon as all their data is copied, so that
+ * external data is given back to the application as early as possible.
+ */
+static inline struct net_buf *copy_frag_data(struct net_buf *frame,
+					     struct net_buf *src,
+					     uint16_t len)
 {
-	uint8_t remaining = max - moved;
-	uint8_t move;
-
-	if (!offset) {
-		remaining -= hdr_diff;
-	}
-
-	/* Calculate remaining space for data to move */
-	move = next->len > remaining ? remaining : next->len;
+	uint16_t copy;
 
-	memmove(frag->data + frag->len, next->data, move);
+	while (src && len) {
+		copy = min(len, src->len);
 
-	net_buf_add(frag, move);
+		memcpy(net_buf_add(frame, copy), src->data, copy);
+		net_buf_pull(src, copy);
+		len -= copy;
 
-	return move;
-}
-
-static inline uint8_t compact_frag(struct net_buf *frag, uint8_t moved)
-{
-	uint8_t remaining = frag->len - moved;
-
-	/* Move remaining data next to fragmentation header,
-	 * (leave space for header).
-	 */
-	if (remaining) {
-		memmove(frag->data + NET_6LO_FRAGN_HDR_LEN,
-			frag->data + moved, remaining);
+		if (!src->len) {
+			src = net_buf_frag_del(NULL, src);
+		}
 	}
 
-	frag->len = NET_6LO_FRAGN_HDR_LEN + remaining;
-
-	return remaining;
+	return src;
 }
 
 /**
  *  ch  : compressed (IPv6) header(s)
  *  fh  : fragment header (dispatch + size + tag + [offset])
  *  p   : payload (first fragment holds IPv6 hdr as payload)
+ *  x   : external (application owned) payload
  *  e   : empty space
  *
  *  Input to ieee802154_fragment() buf chain looks like below
  *
- *  | ch + p | p | p | p | p | p + e |
+ *  | ch + p | p | p | p | p + e |   or   | ch + p + e | x | p + e |
  *
  *  After complete fragmentation buf chain looks like below
  *
@@ -192,20 +200,19 @@ static inline uint8_t compact_frag(struct net_buf *frag, uint8_t moved)
  *  of 8 octets (we have predefined buffers at compile time, data buffer mtu
  *  is set already).
  *
- *  Create the first fragment, add fragmentation header and insert
- *  fragment at beginning of buf, move data from next fragments to
- *  previous one, from here on insert fragmentation header and adjust
- *  data on subsequent buffers.
+ *  The input chain is detached from the buf and every frame is a new
+ *  fragment with link layer reserve and fragmentation header where the
+ *  payload is copied into once. Input fragments are released when they
+ *  have been copied. If the whole datagram fits into one frame, it is
+ *  gathered there without fragmentation header.
  */
 bool ieee802154_fragment(struct net_buf *buf, int hdr_diff)
 {
-	struct net_buf *frag;
-	struct net_buf *next;
+	struct net_buf *frame;
+	struct net_buf *src;
 	uint16_t processed;
 	uint16_t offset;
 	uint16_t size;
-	uint8_t moved;
-	uint8_t move;
 	uint8_t max;
 
 	if (!buf || !buf->frags) {
@@ -217,65 +224,63 @@ bool ieee802154_fragment(struct net_buf *buf, int hdr_diff)
 		return true;
 	}
 
-	datagram_tag++;
+	frame = net_nbuf_get_reserve_data(net_nbuf_ll_reserve(buf));
+	if (!frame) {
+		return false;
+	}
 
-	/* Datagram_size: total length before compression */
-	size = net_buf_frags_len(buf) + hdr_diff;
+	src = buf->frags;
+	buf->frags = NULL;
 
-	frag = net_nbuf_get_reserve_data(net_nbuf_ll_reserve(buf));
-	if (!frag) {
-		return false;
+	if (net_buf_frags_len(src) <= net_buf_tailroom(frame)) {
+		copy_frag_data(frame, src, net_buf_frags_len(src));
+		net_buf_frag_add(buf, frame);
+
+		return true;
 	}
 
-	/* Reserve space for fragmentation header */
-	net_buf_add(frag, NET_6LO_FRAG1_HDR_LEN);
-	net_buf_frag_insert(buf, frag);
+	datagram_tag++;
+
+	/* Datagram_size: total length before compression */
+	size = net_buf_frags_len(src) + hdr_diff;
 
 	offset = 0;
-	moved = 0;
 	processed = 0;
-	next = frag->frags;
 
 	/* First fragment has compressed header, but SIZE and OFFSET
 	 * values in fragmentation header are based on uncompressed
 	 * IP packet.
 	 */
 	while (1) {
-		/* Set fragmentation header in the beginning */
-		set_up_frag_hdr(frag, size, offset);
+		/* Reserve space and set fragmentation header */
+		net_buf_add(frame, offset ? NET_6LO_FRAGN_HDR_LEN :
+				   NET_6LO_FRAG1_HDR_LEN);
+		set_up_frag_hdr(frame, size, offset);
 
 		/* Calculate max payload in multiples of 8 bytes */
-		max = calc_max_payload(buf, frag, offset);
+		max = calc_max_payload(buf, frame, offset);
+
+		src = copy_frag_data(frame, src,
+				     offset ? max : max - hdr_diff);
 
-		/* Move data from next fragment to current fragment */
-		move = move_frag_data(frag, next, max, moved, offset,
-				      hdr_diff);
+		net_buf_frag_add(buf, frame);
 
-		/* Compact the next fragment, returns how much data moved */
-		moved = compact_frag(next, move);
+		if (!src) {
+			break;
+		}
 
 		/* Calculate how much data is processed */
 		processed += max;
 
 		offset = processed >> 3;
 
-		/** If next fragment is last and data already moved to previous
-		 *  fragment, then delete this fragment, if data is left insert
-		 *  header.
-		 */
-		if (!next->frags) {
-			if (next->len == NET_6LO_FRAGN_HDR_LEN) {
-				net_buf_frag_del(frag, next);
-			} else {
-				set_up_frag_hdr(next, size, offset);
-			}
+		frame = net_nbuf_get_reserve_data(net_nbuf_ll_reserve(buf));
+		if (!frame) {
+			/* Let the caller release the rest with the buf */
+			net_buf_frag_add(buf, src);
 
-			break;
+			return false;
 		}
-
-		/* Repeat the steps */
-		frag = next;
-		next = next->frags;
 	}
 
 	return true;
@@ -291,12 +296,6 @@ static inline uint16_t get_datagram_tag(uint8_t *ptr)
 	return (ptr[0] << 8) | ptr[1];
 }
 
-static inline void remove_frag_header(struct net_buf *frag, uint8_t hdr_len)
-{
-	memmove(frag->data, frag->data + hdr_len, frag->len - hdr_len);
-	frag->len -= hdr_len;
-}
-
 static void update_protocol_header_lengths(struct net_buf *buf, uint16_t size)
 {
 	net_nbuf_set_ip_hdr_len(buf, NET_IPV6H_LEN);
@@ -309,51 +308,59 @@ static void update_protocol_header_lengths(struct net_buf *buf, uint16_t size)
 	}
 }
 
-static inline void clear_reass_cache(uint16_t size, uint16_t tag)
+static void clear_reass_cache(struct frag_cache *cache)
 {
 	uint8_t i;
 
-	for (i = 0; i < REASS_CACHE_SIZE; i++) {
-		if (!(cache[i].size == size && cache[i].tag == tag)) {
-			continue;
-		}
+	for (i = 0; i < cache->count; i++) {
+		net_nbuf_unref(cache->frags[i]);
+	}
 
-		net_nbuf_unref(cache[i].buf);
+	cache->count = 0;
+	cache->used = false;
 
-		cache[i].buf = NULL;
-		cache[i].size = 0;
-		cache[i].tag = 0;
-		cache[i].used = false;
-		k_delayed_work_cancel(&cache[i].timer);
-	}
+	net_timer_wheel_clear(&reass_timer, &cache->timer);
 }
 
 /**
  *  If the reassembly not completed within reassembly timeout discard
  *  the whole packet.
  */
-static void reass_timeout(struct k_work *work)
+static void reass_timeout(struct net_timer_wheel_timer *timer)
 {
-	struct frag_cache *cache = CONTAINER_OF(work, struct frag_cache, timer);
+	struct frag_cache *cache = CONTAINER_OF(timer, struct frag_cache,
+						timer);
+
+	NET_DBG("Reassembly of tag %u timed out", cache->tag);
+	NET_STATS_IEEE802154_REASS(++net_stats.ieee802154_reass.timeout);
 
-	if (cache->buf) {
-		net_nbuf_unref(cache->buf);
+	clear_reass_cache(cache);
+}
+
+static void reass_timer_start(struct frag_cache *cache)
+{
+	if (!reass_timer_ready) {
+		net_timer_wheel_init(&reass_timer, reass_timer_slots,
+				     REASS_TIMER_SLOTS, REASS_TIMER_TICK,
+				     reass_timeout);
+		reass_timer_ready = true;
 	}
 
-	cache->buf = NULL;
-	cache->size = 0;
-	cache->tag = 0;
-	cache->used = false;
+	/* One tick more, so the timeout is at least the configured one */
+	net_timer_wheel_set(&reass_timer, &cache->timer,
+			    net_timer_wheel_ticks(&reass_timer,
+						  FRAG_REASSEMBLY_TIMEOUT) + 1);
 }
 
 /**
- *  Upon receiption of first fragment with respective of size and tag
- *  create a new cache. If number of unused cache are out then
- *  discard the fragments.
+ *  Upon receiption of first fragment with respective of sender, size and
+ *  tag create a new cache. If all the caches are in use the fragment is
+ *  discarded, the datagrams already being reassembled are kept.
  */
 static inline struct frag_cache *set_reass_cache(struct net_buf *buf,
 						 uint16_t size, uint16_t tag)
 {
+	struct net_linkaddr *src = net_nbuf_ll_src(buf);
 	int i;
 
 	for (i = 0; i < REASS_CACHE_SIZE; i++) {
@@ -361,13 +368,17 @@ static inline struct frag_cache *set_reass_cache(struct net_buf *buf,
 			continue;
 		}
 
-		cache[i].buf = buf;
+		cache[i].iface = net_nbuf_iface(buf);
+		cache[i].src_len = src->addr ? min(src->len, REASS_SRC_LEN) : 0;
+		memcpy(cache[i].src, src->addr, cache[i].src_len);
 		cache[i].size = size;
 		cache[i].tag = tag;
+		cache[i].received = 0;
+		cache[i].count = 0;
 		cache[i].used = true;
 
-		k_delayed_work_init(&cache[i].timer, reass_timeout);
-		k_delayed_work_submit(&cache[i].timer, FRAG_REASSEMBLY_TIMEOUT);
+		reass_timer_start(&cache[i]);
+
 		return &cache[i];
 	}
 
@@ -375,68 +386,135 @@ static inline struct frag_cache *set_reass_cache(struct net_buf *buf,
 }
 
 /**
- *  Return cache if it matches with size and tag of stored caches,
- *  otherwise return NULL.
+ *  Return cache if it matches with sender, size and tag of stored
+ *  caches, otherwise return NULL.
  */
-static inline struct frag_cache *get_reass_cache(uint16_t size, uint16_t tag)
+static inline struct frag_cache *get_reass_cache(struct net_buf *buf,
+						 uint16_t size, uint16_t tag)
 {
+	struct net_linkaddr *src = net_nbuf_ll_src(buf);
+	uint8_t src_len = src->addr ? min(src->len, REASS_SRC_LEN) : 0;
 	uint8_t i;
 
 	for (i = 0; i < REASS_CACHE_SIZE; i++) {
-		if (cache[i].used) {
-			if (cache[i].size == size &&
-			    cache[i].tag == tag) {
-				return &cache[i];
-			}
+		if (!cache[i].used || cache[i].tag != tag ||
+		    cache[i].size != size ||
+		    cache[i].iface != net_nbuf_iface(buf) ||
+		    cache[i].src_len != src_len ||
+		    memcmp(cache[i].src, src->addr, src_len)) {
+			continue;
 		}
+
+		return &cache[i];
 	}
 
 	return NULL;
 }
 
-/* Helper function to write fragment data to Rx buffer based on offset. */
-static inline bool copy_frag(struct net_buf *buf,
-			     struct net_buf *frag,
-			     uint16_t offset)
+/**
+ *  Insert the fragments of buf into the cache at their offset. They are
+ *  not copied, the whole data chain of buf is moved to the cache.
+ */
+static enum net_verdict insert_frag(struct frag_cache *cache,
+				    struct net_buf *buf, uint16_t offset)
 {
-	struct net_buf *input = frag;
-	struct net_buf *write;
-	uint16_t pos = offset;
+	uint16_t len = net_buf_frags_len(buf->frags);
+	uint16_t end;
+	uint8_t i;
 
-	write = buf->frags;
+	if (offset + len > cache->size || (offset && (len & 0x07) &&
+					   offset + len != cache->size)) {
+		NET_DBG("Invalid fragment offset %u len %u size %u",
+			offset, len, cache->size);
+		NET_STATS_IEEE802154_REASS(
+			++net_stats.ieee802154_reass.invalid);
+		return NET_DROP;
+	}
 
-	while (input) {
-		write = net_nbuf_write(buf, write, pos, &pos, input->len,
-				       input->data);
-		if (!write && pos == 0xffff) {
-			return false;
+	for (i = 0; i < cache->count; i++) {
+		if ((cache->offset[i] << 3) >= offset) {
+			break;
+		}
+	}
+
+	if (i < cache->count && (cache->offset[i] << 3) == offset &&
+	    net_buf_frags_len(cache->frags[i]) == len) {
+		NET_DBG("Duplicate fragment offset %u", offset);
+		NET_STATS_IEEE802154_REASS(
+			++net_stats.ieee802154_reass.duplicate);
+		return NET_DROP;
+	}
+
+	/* RFC 4944, 5.3: overlapping fragments discard the datagram */
+	if (i > 0) {
+		end = (cache->offset[i - 1] << 3) +
+			net_buf_frags_len(cache->frags[i - 1]);
+		if (end > offset) {
+			goto overlap;
 		}
+	}
 
-		input = input->frags;
+	if (i < cache->count && (cache->offset[i] << 3) < offset + len) {
+		goto overlap;
 	}
 
-	net_nbuf_unref(frag);
+	if (cache->count == REASS_FRAGS) {
+		NET_DBG("Too many fragments for tag %u", cache->tag);
+		NET_STATS_IEEE802154_REASS(
+			++net_stats.ieee802154_reass.invalid);
+		clear_reass_cache(cache);
+		return NET_DROP;
+	}
 
-	return true;
+	memmove(&cache->frags[i + 1], &cache->frags[i],
+		(cache->count - i) * sizeof(cache->frags[0]));
+	memmove(&cache->offset[i + 1], &cache->offset[i],
+		(cache->count - i) * sizeof(cache->offset[0]));
+
+	cache->frags[i] = buf->frags;
+	cache->offset[i] = offset >> 3;
+	cache->count++;
+	cache->received += len;
+
+	buf->frags = NULL;
+
+	return NET_OK;
+
+overlap:
+	NET_DBG("Overlapping fragment offset %u len %u", offset, len);
+	NET_STATS_IEEE802154_REASS(++net_stats.ieee802154_reass.overlap);
+	clear_reass_cache(cache);
+
+	return NET_DROP;
 }
 
 /**
- *  Parse size and tag from the fragment, check if we have any cache
- *  related to it. If not create a new cache.
+ *  Parse sender, size and tag from the fragment, check if we have any
+ *  cache related to it. If not create a new cache.
  *  Remove the fragmentation header and uncompress IPv6 and related headers.
- *  Cache Rx part of fragment along with data buf for the first fragment
- *  in the cache, remaining fragments just cache data fragment, unref
- *  RX buf. So in both the cases caller can assume buffer is consumed.
+ *  The data fragments are moved to the cache and the Rx buf is released,
+ *  except when the datagram is complete. Then the Rx buf gets all the
+ *  fragments linked together.
  */
 static inline enum net_verdict add_frag_to_cache(struct net_buf *buf,
 						 bool first)
 {
 	struct frag_cache *cache;
-	struct net_buf *frag;
+	enum net_verdict verdict;
 	uint16_t size;
 	uint16_t tag;
 	uint16_t offset = 0;
 	uint8_t pos = 0;
+	uint8_t i;
+
+	NET_STATS_IEEE802154_REASS(++net_stats.ieee802154_reass.recv);
+
+	if (buf->frags->len < (first ? NET_6LO_FRAG1_HDR_LEN :
+			       NET_6LO_FRAGN_HDR_LEN)) {
+		NET_STATS_IEEE802154_REASS(
+			++net_stats.ieee802154_reass.invalid);
+		return NET_DROP;
+	}
 
 	/* Parse total size of packet */
 	size = get_datagram_size(buf->frags->data);
@@ -449,89 +527,90 @@ static inline enum net_verdict add_frag_to_cache(struct net_buf *buf,
 	if (!first) {
 		offset = ((uint16_t)buf->frags->data[pos]) << 3;
 		pos++;
+
+		/* Only the first fragment starts from offset zero */
+		if (!offset) {
+			NET_STATS_IEEE802154_REASS(
+				++net_stats.ieee802154_reass.invalid);
+			return NET_DROP;
+		}
 	}
 
-	/* Remove frag header and update data */
-	remove_frag_header(buf->frags, pos);
+	/* Skip the frag header, it stays in front of the data as part of
+	 * the link layer header.
+	 */
+	net_buf_pull(buf->frags, pos);
+	net_nbuf_set_ll_reserve(buf, net_nbuf_ll_reserve(buf) + pos);
 
 	/* Uncompress the IP headers */
 	if (first && !net_6lo_uncompress(buf)) {
 		NET_ERR("Could not uncompress first frag's 6lo hdr");
-		clear_reass_cache(size, tag);
+		NET_STATS_IEEE802154_REASS(
+			++net_stats.ieee802154_reass.uncompress);
+
+		cache = get_reass_cache(buf, size, tag);
+		if (cache) {
+			clear_reass_cache(cache);
+		}
 
 		return NET_DROP;
 	}
 
-	/* If there are no fragments in the cache means this frag
-	 * is the first one. So cache Rx buf otherwise not.
-	 * Write data fragment data to cached Rx based on offset parameter.
-	 * (Detach data fragment from incoming Rx and copy that data).
-	 */
-
-	frag = buf->frags;
-	buf->frags = NULL;
-
-	cache = get_reass_cache(size, tag);
+	cache = get_reass_cache(buf, size, tag);
 	if (!cache) {
 		cache = set_reass_cache(buf, size, tag);
 		if (!cache) {
 			NET_ERR("Could not get a cache entry");
+			NET_STATS_IEEE802154_REASS(
+				++net_stats.ieee802154_reass.full);
 			return NET_DROP;
 		}
 
-		/* If write failed, then attach frag back to incoming buffer
-		 * and return NET_DROP, caller will take care of freeing it.
-		 */
-		if (!copy_frag(cache->buf, frag, offset)) {
-			buf->frags = frag;
-
-			/* Initialize to NULL to prevent duble free. It's only
-			 * needed here because this is the first fragment.
-			 */
-			cache->buf = NULL;
-
-			clear_reass_cache(size, tag);
+		NET_DBG("New reassembly, tag %u size %u", tag, size);
+	}
 
-			NET_ERR("Copying frag failed");
+	if (first) {
+		cache->ll_reserve = net_nbuf_ll_reserve(buf);
+	}
 
-			return NET_DROP;
+	verdict = insert_frag(cache, buf, offset);
+	if (verdict == NET_DROP) {
+		if (cache->used && !cache->count) {
+			clear_reass_cache(cache);
 		}
 
-		NET_DBG("buffer inserted into cache");
-
-		return NET_OK;
+		return NET_DROP;
 	}
 
-	/* Add data buffer to reassembly buffer */
-	if (!copy_frag(cache->buf, frag, offset)) {
-		buf->frags = frag;
-
-		clear_reass_cache(size, tag);
+	/* The fragments do not overlap, so all of them are there when
+	 * their total length is the datagram size.
+	 */
+	if (cache->received != size) {
+		/* Unref Rx part of original buffer */
+		net_nbuf_unref(buf);
 
-		return NET_DROP;
+		return NET_OK;
 	}
 
-	/* Check if all the fragments are received or not */
-	if (net_buf_frags_len(cache->buf->frags) == size) {
-		/* Assign frags back to input buffer. */
-		buf->frags = cache->buf->frags;
-		cache->buf->frags = NULL;
-
-		/* Lengths are elided in compression, so calculate it. */
-		update_protocol_header_lengths(buf, cache->size);
+	for (i = 0; i < cache->count - 1; i++) {
+		net_buf_frag_last(cache->frags[i])->frags = cache->frags[i + 1];
+	}
 
-		/* Once reassemble is done, cache is no longer needed. */
-		clear_reass_cache(size, tag);
+	/* Assign frags back to input buffer. */
+	buf->frags = cache->frags[0];
+	net_nbuf_set_ll_reserve(buf, cache->ll_reserve);
 
-		NET_DBG("All fragments received and reassembled");
+	/* Lengths are elided in compression, so calculate it. */
+	update_protocol_header_lengths(buf, size);
 
-		return NET_CONTINUE;
-	}
+	/* Once reassemble is done, cache is no longer needed. */
+	cache->count = 0;
+	clear_reass_cache(cache);
 
-	/* Unref Rx part of original buffer */
-	net_nbuf_unref(buf);
+	NET_DBG("All fragments received and reassembled");
+	NET_STATS_IEEE802154_REASS(++net_stats.ieee802154_reass.reassembled);
 
-	return NET_OK;
+	return NET_CONTINUE;
 }
 
 enum net_verdict ieee802154_reassemble(struct net_buf *buf)
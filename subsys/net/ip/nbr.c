@@ -31,6 +31,84 @@
 
 NET_NBR_LLADDR_INIT(net_neighbor_lladdr, CONFIG_NET_IPV6_MAX_NEIGHBORS);
 
+/* The link layer addresses are hashed so that they can be found without
+ * going through the whole table. The buckets and the entries are chained
+ * by index, NET_NBR_LLADDR_UNKNOWN ends the chain.
+ */
+#define LLADDR_HASH_SIZE CONFIG_NET_IPV6_MAX_NEIGHBORS
+
+static uint8_t lladdr_hash[LLADDR_HASH_SIZE] = {
+	[0 ... (LLADDR_HASH_SIZE - 1)] = NET_NBR_LLADDR_UNKNOWN
+};
+
+static inline uint8_t lladdr_hash_key(const uint8_t *addr, uint8_t len)
+{
+	uint8_t key = len;
+	int i;
+
+	/* The last bytes differ most between the neighbors */
+	for (i = 0; i < len; i++) {
+		key = (key << 3 | key >> 5) ^ addr[i];
+	}
+
+	return key % LLADDR_HASH_SIZE;
+}
+
+static int lladdr_find(struct net_linkaddr *lladdr)
+{
+	uint8_t i;
+
+	for (i = lladdr_hash[lladdr_hash_key(lladdr->addr, lladdr->len)];
+	     i != NET_NBR_LLADDR_UNKNOWN; i = net_neighbor_lladdr[i].next) {
+		struct net_linkaddr_storage *stored =
+			&net_neighbor_lladdr[i].lladdr;
+
+		if (stored->len == lladdr->len &&
+		    !memcmp(lladdr->addr, stored->addr, lladdr->len)) {
+			return i;
+		}
+	}
+
+	return -ENOENT;
+}
+
+static void lladdr_hash_del(uint8_t idx)
+{
+	struct net_linkaddr_storage *stored = &net_neighbor_lladdr[idx].lladdr;
+	uint8_t *i;
+
+	for (i = &lladdr_hash[lladdr_hash_key(stored->addr, stored->len)];
+	     *i != NET_NBR_LLADDR_UNKNOWN; i = &net_neighbor_lladdr[*i].next) {
+		if (*i == idx) {
+			*i = net_neighbor_lladdr[idx].next;
+			return;
+		}
+	}
+}
+
+/* The neighbors that are linked to the same address are chained from
+ * the address entry, so a lookup only checks those, whatever the size of
+ * the tables. There is at most one of them per table and interface.
+ */
+static void lladdr_nbr_add(uint8_t idx, struct net_nbr *nbr)
+{
+	nbr->link_next = net_neighbor_lladdr[idx].nbr;
+	net_neighbor_lladdr[idx].nbr = nbr;
+}
+
+static void lladdr_nbr_del(uint8_t idx, struct net_nbr *nbr)
+{
+	struct net_nbr **i;
+
+	for (i = &net_neighbor_lladdr[idx].nbr; *i; i = &(*i)->link_next) {
+		if (*i == nbr) {
+			*i = nbr->link_next;
+			nbr->link_next = NULL;
+			return;
+		}
+	}
+}
+
 #if defined(CONFIG_NET_DEBUG_IPV6_NBR_CACHE)
 void net_nbr_unref_debug(struct net_nbr *nbr, const char *caller, int line)
 #define net_nbr_unref(nbr) net_nbr_unref_debug(nbr, __func__, __LINE__)
@@ -77,6 +155,16 @@ static inline struct net_nbr *get_nbr(struct net_nbr *start, int idx)
 			((sizeof(struct net_nbr) + start->size) * idx));
 }
 
+static inline bool nbr_in_table(struct net_nbr_table *table,
+				struct net_nbr *nbr)
+{
+	uint8_t *start = (uint8_t *)table->nbr;
+	uint8_t *end = start + (sizeof(struct net_nbr) + table->nbr->size) *
+		table->nbr_count;
+
+	return (uint8_t *)nbr >= start && (uint8_t *)nbr < end;
+}
+
 struct net_nbr *net_nbr_get(struct net_nbr_table *table)
 {
 	int i;
@@ -97,52 +185,76 @@ struct net_nbr *net_nbr_get(struct net_nbr_table *table)
 int net_nbr_link(struct net_nbr *nbr, struct net_if *iface,
 		 struct net_linkaddr *lladdr)
 {
-	int i, avail = -1;
+	uint8_t key;
+	int i;
 
 	if (nbr->idx != NET_NBR_LLADDR_UNKNOWN) {
 		return -EALREADY;
 	}
 
-	for (i = 0; i < CONFIG_NET_IPV6_MAX_NEIGHBORS; i++) {
-		if (avail < 0 && !net_neighbor_lladdr[i].ref) {
-			avail = i;
-		}
+	i = lladdr_find(lladdr);
+	if (i >= 0) {
+		/* We found same lladdr in nbr cache so just
+		 * increase the ref count.
+		 */
+		net_neighbor_lladdr[i].ref++;
 
-		if (net_neighbor_lladdr[i].ref &&
-		    !memcmp(lladdr->addr,
-			    net_neighbor_lladdr[i].lladdr.addr,
-			    lladdr->len)) {
-			/* We found same lladdr in nbr cache so just
-			 * increase the ref count.
-			 */
-			net_neighbor_lladdr[i].ref++;
+		nbr->idx = i;
+		nbr->iface = iface;
+		lladdr_nbr_add(i, nbr);
 
-			nbr->idx = i;
-			nbr->iface = iface;
+		return 0;
+	}
 
-			return 0;
+	for (i = 0; i < CONFIG_NET_IPV6_MAX_NEIGHBORS; i++) {
+		if (!net_neighbor_lladdr[i].ref) {
+			break;
 		}
 	}
 
-	if (avail < 0) {
+	if (i == CONFIG_NET_IPV6_MAX_NEIGHBORS) {
 		return -ENOENT;
 	}
 
 	/* There was no existing entry in the lladdr cache,
 	 * so allocate one for this lladdr.
 	 */
-	net_neighbor_lladdr[avail].ref++;
-	nbr->idx = avail;
+	net_neighbor_lladdr[i].ref++;
+	nbr->idx = i;
 
-	memcpy(net_neighbor_lladdr[avail].lladdr.addr,
+	memcpy(net_neighbor_lladdr[i].lladdr.addr,
 	       lladdr->addr, lladdr->len);
-	net_neighbor_lladdr[avail].lladdr.len = lladdr->len;
+	net_neighbor_lladdr[i].lladdr.len = lladdr->len;
+
+	key = lladdr_hash_key(lladdr->addr, lladdr->len);
+	net_neighbor_lladdr[i].next = lladdr_hash[key];
+	lladdr_hash[key] = i;
 
 	nbr->iface = iface;
+	lladdr_nbr_add(i, nbr);
 
 	return 0;
 }
 
+void net_nbr_update_lladdr(uint8_t idx, struct net_linkaddr *lladdr)
+{
+	struct net_linkaddr_storage *stored;
+	uint8_t key;
+
+	NET_ASSERT(idx < CONFIG_NET_IPV6_MAX_NEIGHBORS);
+
+	stored = &net_neighbor_lladdr[idx].lladdr;
+
+	lladdr_hash_del(idx);
+
+	memcpy(stored->addr, lladdr->addr, lladdr->len);
+	stored->len = lladdr->len;
+
+	key = lladdr_hash_key(stored->addr, stored->len);
+	net_neighbor_lladdr[idx].next = lladdr_hash[key];
+	lladdr_hash[key] = idx;
+}
+
 int net_nbr_unlink(struct net_nbr *nbr, struct net_linkaddr *lladdr)
 {
 	if (nbr->idx == NET_NBR_LLADDR_UNKNOWN) {
@@ -153,8 +265,11 @@ int net_nbr_unlink(struct net_nbr *nbr, struct net_linkaddr *lladdr)
 	NET_ASSERT(net_neighbor_lladdr[nbr->idx].ref > 0);
 
 	net_neighbor_lladdr[nbr->idx].ref--;
+	lladdr_nbr_del(nbr->idx, nbr);
 
 	if (!net_neighbor_lladdr[nbr->idx].ref) {
+		lladdr_hash_del(nbr->idx);
+
 		memset(net_neighbor_lladdr[nbr->idx].lladdr.addr, 0,
 		       sizeof(net_neighbor_lladdr[nbr->idx].lladdr.storage));
 	}
@@ -169,15 +284,17 @@ struct net_nbr *net_nbr_lookup(struct net_nbr_table *table,
 			       struct net_if *iface,
 			       struct net_linkaddr *lladdr)
 {
-	int i;
+	struct net_nbr *nbr;
+	int idx;
 
-	for (i = 0; i < CONFIG_NET_IPV6_MAX_NEIGHBORS; i++) {
-		struct net_nbr *nbr = get_nbr(table->nbr, i);
+	idx = lladdr_find(lladdr);
+	if (idx < 0) {
+		return NULL;
+	}
 
+	for (nbr = net_neighbor_lladdr[idx].nbr; nbr; nbr = nbr->link_next) {
 		if (nbr->ref && nbr->iface == iface &&
-		    net_neighbor_lladdr[nbr->idx].ref &&
-		    !memcmp(net_neighbor_lladdr[nbr->idx].lladdr.addr,
-			    lladdr->addr, lladdr->len)) {
+		    nbr_in_table(table, nbr)) {
 			return nbr;
 		}
 	}
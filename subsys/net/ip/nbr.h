@@ -42,6 +42,12 @@ struct net_nbr_lladdr {
 
 	/** Reference count. */
 	uint8_t ref;
+
+	/** Next entry in the same hash bucket */
+	uint8_t next;
+
+	/** Neighbors linked to this address, in any table */
+	struct net_nbr *nbr;
 };
 
 #define NET_NBR_LLADDR_INIT(_name, _count)	\
@@ -54,8 +60,10 @@ struct net_nbr_lladdr {
  * data at the end of the node.
  */
 struct net_nbr {
-	/** Reference count. */
-	uint8_t ref;
+	/** Reference count. A nexthop neighbor is referenced by every
+	 * route that goes through it.
+	 */
+	uint16_t ref;
 
 	/** Link to ll address. This is the index into lladdr array.
 	 * The value NET_NBR_LLADDR_UNKNOWN tells that this neighbor
@@ -72,6 +80,9 @@ struct net_nbr {
 	/** Interface this neighbor is found */
 	struct net_if *iface;
 
+	/** Next neighbor linked to the same link layer address */
+	struct net_nbr *link_next;
+
 	/** Pointer to the start of data in the neighbor table. */
 	uint8_t *data;
 
@@ -102,6 +113,9 @@ struct net_nbr_table {
 	/** Link to a neighbor pool */
 	struct net_nbr *nbr;
 
+	/** Number of neighbors in the pool */
+	const uint16_t nbr_count;
+
 	/** Function to be called when the table is cleared. */
 	void (*const clear)(struct net_nbr_table *table);
 };
@@ -118,6 +132,7 @@ struct net_nbr_table {
 		.table = {						\
 			.clear = _clear,				\
 			.nbr = (struct net_nbr *)_pool,			\
+			.nbr_count = ARRAY_SIZE(_pool),			\
 		}							\
 	}
 
@@ -194,6 +209,15 @@ int net_nbr_link(struct net_nbr *nbr, struct net_if *iface,
  */
 int net_nbr_unlink(struct net_nbr *nbr, struct net_linkaddr *lladdr);
 
+/**
+ * @brief Change the link layer address stored in a lladdr table entry.
+ * The address must be changed by this function so that it can be found
+ * again by net_nbr_lookup() and net_nbr_link().
+ * @param idx Link layer address index in ll table.
+ * @param lladdr New link layer address
+ */
+void net_nbr_update_lladdr(uint8_t idx, struct net_linkaddr *lladdr);
+
 /**
  * @brief Return link address for a specific lladdr table index
  * @param idx Link layer address index in ll table.
@@ -39,6 +39,7 @@
 #include <net/nbuf.h>
 
 #include <net/net_core.h>
+#include <net/net_mgmt.h>
 
 #include "net_private.h"
 
@@ -48,6 +49,9 @@
 #define NBUF_DATA_COUNT	CONFIG_NET_NBUF_DATA_COUNT
 #define NBUF_DATA_LEN	CONFIG_NET_NBUF_DATA_SIZE
 #define NBUF_USER_DATA_LEN CONFIG_NET_NBUF_USER_DATA_SIZE
+#if defined(CONFIG_NET_NBUF_EXT_DATA)
+#define NBUF_EXT_COUNT	CONFIG_NET_NBUF_EXT_COUNT
+#endif
 
 #if defined(CONFIG_NET_TCP)
 #define APP_PROTO_LEN NET_TCPH_LEN
@@ -225,9 +229,114 @@ static struct k_fifo free_rx_bufs;
 static struct k_fifo free_tx_bufs;
 static struct k_fifo free_data_bufs;
 
+#if defined(CONFIG_NET_NBUF_QUOTA)
+/* Accounting of one buffer pool. The owner array tells which context
+ * or interface quota each buffer of the pool is charged to. Buffers are
+ * allocated, charged and released from ISRs too, so the counters, the
+ * owners and the quotas are only changed with interrupts locked.
+ */
+struct nbuf_acct {
+	struct net_nbuf_quota **owner;
+	uint16_t free;
+	uint16_t reserved;
+	uint8_t flags;
+};
+
+/* The events are sent once until the pool has recovered */
+#define NBUF_ACCT_RESERVE_SENT	BIT(0)
+#define NBUF_ACCT_EMPTY_SENT	BIT(1)
+
+static struct net_nbuf_quota *rx_owner[NBUF_RX_COUNT];
+static struct net_nbuf_quota *tx_owner[NBUF_TX_COUNT];
+static struct net_nbuf_quota *data_owner[NBUF_DATA_COUNT];
+
+static struct nbuf_acct rx_acct = {
+	.owner = rx_owner,
+	.free = NBUF_RX_COUNT,
+	.reserved = CONFIG_NET_NBUF_RX_RESERVED,
+};
+
+static struct nbuf_acct tx_acct = {
+	.owner = tx_owner,
+	.free = NBUF_TX_COUNT,
+	.reserved = CONFIG_NET_NBUF_TX_RESERVED,
+};
+
+static struct nbuf_acct data_acct = {
+	.owner = data_owner,
+	.free = NBUF_DATA_COUNT,
+	.reserved = CONFIG_NET_NBUF_DATA_RESERVED,
+};
+
+static inline void acct_get(struct nbuf_acct *acct)
+{
+	unsigned int key = irq_lock();
+
+	acct->free--;
+
+	irq_unlock(key);
+}
+
+static inline void acct_empty(struct nbuf_acct *acct)
+{
+	unsigned int key = irq_lock();
+	bool notify = !(acct->flags & NBUF_ACCT_EMPTY_SENT);
+
+	acct->flags |= NBUF_ACCT_EMPTY_SENT;
+
+	irq_unlock(key);
+
+	if (notify) {
+		net_mgmt_event_notify(NET_EVENT_NBUF_EMPTY, NULL);
+	}
+}
+
+/* Needs the pools so it is defined after them */
+static void acct_put(struct net_buf *buf);
+#else
+#define acct_get(...)
+#define acct_empty(...)
+#define acct_put(...)
+#endif /* CONFIG_NET_NBUF_QUOTA */
+
+#if defined(CONFIG_NET_NBUF_WATERMARK)
+/* Buffers of a pool in use now and at most */
+struct nbuf_mark {
+	atomic_t used;
+	atomic_t max;
+};
+
+static struct nbuf_mark rx_mark;
+static struct nbuf_mark tx_mark;
+static struct nbuf_mark data_mark;
+
+static inline void mark_get(struct nbuf_mark *mark)
+{
+	atomic_val_t used = atomic_inc(&mark->used) + 1;
+	atomic_val_t max;
+
+	do {
+		max = atomic_get(&mark->max);
+		if (used <= max) {
+			break;
+		}
+	} while (!atomic_cas(&mark->max, max, used));
+}
+
+static inline void mark_put(struct nbuf_mark *mark)
+{
+	atomic_dec(&mark->used);
+}
+#else
+#define mark_get(...)
+#define mark_put(...)
+#endif /* CONFIG_NET_NBUF_WATERMARK */
+
 static inline void free_rx_bufs_func(struct net_buf *buf)
 {
 	inc_free_rx_bufs_func(buf);
+	acct_put(buf);
+	mark_put(&rx_mark);
 
 	k_fifo_put(buf->free, buf);
 }
@@ -235,6 +344,8 @@ static inline void free_rx_bufs_func(struct net_buf *buf)
 static inline void free_tx_bufs_func(struct net_buf *buf)
 {
 	inc_free_tx_bufs_func(buf);
+	acct_put(buf);
+	mark_put(&tx_mark);
 
 	k_fifo_put(buf->free, buf);
 }
@@ -242,6 +353,8 @@ static inline void free_tx_bufs_func(struct net_buf *buf)
 static inline void free_data_bufs_func(struct net_buf *buf)
 {
 	inc_free_data_bufs_func(buf);
+	acct_put(buf);
+	mark_put(&data_mark);
 
 	k_fifo_put(buf->free, buf);
 }
@@ -261,9 +374,195 @@ static NET_BUF_POOL(data_buffers, NBUF_DATA_COUNT,	\
 		    NBUF_DATA_LEN, &free_data_bufs,	\
 		    free_data_bufs_func, NBUF_USER_DATA_LEN);
 
-static inline bool is_from_data_pool(struct net_buf *buf)
+#if defined(CONFIG_NET_NBUF_QUOTA)
+#define POOL_INDEX(pool, buf)					\
+	(((uint8_t *)(buf) - (uint8_t *)(pool)) / sizeof((pool)[0]))
+
+/* External data fragments are not counted, NULL is returned for them */
+static struct net_nbuf_quota **get_owner(struct net_buf *buf,
+					 struct nbuf_acct **acct)
 {
 	if (buf->free == &free_data_bufs) {
+		*acct = &data_acct;
+		return &data_owner[POOL_INDEX(data_buffers, buf)];
+	}
+
+	if (buf->free == &free_rx_bufs) {
+		*acct = &rx_acct;
+		return &rx_owner[POOL_INDEX(rx_buffers, buf)];
+	}
+
+	if (buf->free == &free_tx_bufs) {
+		*acct = &tx_acct;
+		return &tx_owner[POOL_INDEX(tx_buffers, buf)];
+	}
+
+	return NULL;
+}
+
+static inline void quota_dec(struct net_nbuf_quota *quota)
+{
+	quota->used--;
+
+	/* Some hysteresis so that an owner at its limit does not send
+	 * an event for every other packet.
+	 */
+	if (quota->used <= quota->limit / 2) {
+		quota->exceeded = false;
+	}
+}
+
+static void acct_put(struct net_buf *buf)
+{
+	struct net_nbuf_quota **owner;
+	struct nbuf_acct *acct;
+	unsigned int key;
+
+	owner = get_owner(buf, &acct);
+
+	key = irq_lock();
+
+	if (*owner) {
+		quota_dec(*owner);
+		*owner = NULL;
+	}
+
+	acct->free++;
+
+	if (acct->free > acct->reserved) {
+		acct->flags = 0;
+	}
+
+	irq_unlock(key);
+}
+
+static bool nbuf_charge(struct net_buf *buf, struct net_nbuf_quota *quota,
+			struct net_if *iface, bool check_reserve)
+{
+	struct nbuf_acct *acct, *low = NULL;
+	struct net_nbuf_quota **owner;
+	struct net_buf *frag;
+	uint32_t event = 0;
+	uint16_t count = 0;
+	unsigned int key;
+
+	key = irq_lock();
+
+	for (frag = buf; frag; frag = frag->frags) {
+		owner = get_owner(frag, &acct);
+		if (!owner || *owner == quota) {
+			continue;
+		}
+
+		if (check_reserve && acct->free < acct->reserved) {
+			low = acct;
+		}
+
+		count++;
+	}
+
+	if (!count) {
+		irq_unlock(key);
+		return true;
+	}
+
+	if (quota->limit && quota->used + count > quota->limit) {
+		if (!quota->exceeded) {
+			quota->exceeded = true;
+			event = NET_EVENT_NBUF_QUOTA;
+		}
+
+		goto drop;
+	}
+
+	if (low) {
+		if (!(low->flags & NBUF_ACCT_RESERVE_SENT)) {
+			low->flags |= NBUF_ACCT_RESERVE_SENT;
+			event = NET_EVENT_NBUF_RESERVE;
+		}
+
+		goto drop;
+	}
+
+	for (frag = buf; frag; frag = frag->frags) {
+		owner = get_owner(frag, &acct);
+		if (!owner || *owner == quota) {
+			continue;
+		}
+
+		if (*owner) {
+			quota_dec(*owner);
+		}
+
+		*owner = quota;
+	}
+
+	quota->used += count;
+
+	irq_unlock(key);
+
+	return true;
+
+drop:
+	irq_unlock(key);
+
+	NET_DBG("Quota %p or pool reserve full, %u buffers of buf %p "
+		"dropped", quota, count, buf);
+
+	if (event) {
+		net_mgmt_event_notify(event, iface);
+	}
+
+	return false;
+}
+
+bool net_nbuf_charge_iface(struct net_buf *buf, struct net_if *iface)
+{
+	/* The stack itself needs to receive packets when the pools
+	 * are low so the reserve is not checked here.
+	 */
+	return nbuf_charge(buf, &iface->nbuf_quota, iface, false);
+}
+
+bool net_nbuf_charge_context(struct net_buf *buf,
+			     struct net_context *context)
+{
+	return nbuf_charge(buf, &context->nbuf_quota,
+			   net_context_get_iface(context), true);
+}
+#endif /* CONFIG_NET_NBUF_QUOTA */
+
+#if defined(CONFIG_NET_NBUF_EXT_DATA)
+struct nbuf_ext {
+	const uint8_t *data;
+	net_nbuf_ext_release_t cb;
+	void *user_data;
+};
+
+static struct k_fifo free_ext_bufs;
+
+static inline void free_ext_bufs_func(struct net_buf *buf)
+{
+	struct nbuf_ext *ext = net_buf_user_data(buf);
+
+	if (ext->cb) {
+		ext->cb(ext->data, ext->user_data);
+	}
+
+	k_fifo_put(buf->free, buf);
+}
+
+/* The external data pool does not store any data. The fragments point
+ * to memory owned by the application.
+ */
+static NET_BUF_POOL(ext_buffers, NBUF_EXT_COUNT, 0,	\
+		    &free_ext_bufs, free_ext_bufs_func,	\
+		    sizeof(struct nbuf_ext));
+#endif /* CONFIG_NET_NBUF_EXT_DATA */
+
+static inline bool is_from_data_pool(struct net_buf *buf)
+{
+	if (buf->free == &free_data_bufs || net_nbuf_is_ext(buf)) {
 		return true;
 	}
 
@@ -289,7 +588,7 @@ void net_nbuf_print_frags(struct net_buf *buf)
 {
 	struct net_buf *frag;
 	size_t total = 0;
-	int count = 0, frag_size = 0, ll_overhead = 0;
+	int count = 0, frag_size = NBUF_DATA_LEN, ll_overhead = 0;
 
 	NET_DBG("Buf %p frags %p", buf, buf->frags);
 
@@ -300,8 +599,10 @@ void net_nbuf_print_frags(struct net_buf *buf)
 	while (frag) {
 		total += frag->len;
 
-		frag_size = frag->size;
-		ll_overhead = net_buf_headroom(frag);
+		if (!net_nbuf_is_ext(frag)) {
+			frag_size = frag->size;
+			ll_overhead = net_buf_headroom(frag);
+		}
 
 		NET_DBG("[%d] frag %p len %d size %d reserve %d",
 			count, frag, frag->len, frag_size, ll_overhead);
@@ -336,28 +637,35 @@ static struct net_buf *net_nbuf_get_reserve(enum net_nbuf_type type,
 	case NET_NBUF_RX:
 		buf = net_buf_get(&free_rx_bufs, 0);
 		if (!buf) {
+			acct_empty(&rx_acct);
 			return NULL;
 		}
 
 		NET_ASSERT_INFO(buf->ref, "RX buf %p ref %d", buf, buf->ref);
 
 		dec_free_rx_bufs(buf);
+		acct_get(&rx_acct);
+		mark_get(&rx_mark);
 		net_nbuf_set_type(buf, type);
 		break;
 	case NET_NBUF_TX:
 		buf = net_buf_get(&free_tx_bufs, 0);
 		if (!buf) {
+			acct_empty(&tx_acct);
 			return NULL;
 		}
 
 		NET_ASSERT_INFO(buf->ref, "TX buf %p ref %d", buf, buf->ref);
 
 		dec_free_tx_bufs(buf);
+		acct_get(&tx_acct);
+		mark_get(&tx_mark);
 		net_nbuf_set_type(buf, type);
 		break;
 	case NET_NBUF_DATA:
 		buf = net_buf_get(&free_data_bufs, 0);
 		if (!buf) {
+			acct_empty(&data_acct);
 			return NULL;
 		}
 
@@ -371,6 +679,8 @@ static struct net_buf *net_nbuf_get_reserve(enum net_nbuf_type type,
 		net_buf_pull(buf, reserve_head);
 
 		dec_free_data_bufs(buf);
+		acct_get(&data_acct);
+		mark_get(&data_mark);
 		break;
 	default:
 		NET_ERR("Invalid type %d for net_buf", type);
@@ -408,6 +718,7 @@ static struct net_buf *net_nbuf_get_reserve(enum net_nbuf_type type,
 
 	if (type != NET_NBUF_DATA) {
 		net_nbuf_set_context(buf, NULL);
+		net_nbuf_set_priority(buf, NET_PRIORITY_BE);
 		net_nbuf_ll_dst(buf)->addr = NULL;
 		net_nbuf_ll_src(buf)->addr = NULL;
 
@@ -503,6 +814,7 @@ static struct net_buf *net_nbuf_get(enum net_nbuf_type type,
 		net_nbuf_set_ll_reserve(buf, reserve);
 		net_nbuf_set_family(buf, net_context_get_family(context));
 		net_nbuf_set_iface(buf, iface);
+		net_nbuf_set_priority(buf, context->priority);
 	}
 
 	return buf;
@@ -782,7 +1094,10 @@ struct net_buf *net_nbuf_compact(struct net_buf *buf)
 	NET_DBG("Compacting data to buf %p", first);
 
 	while (buf) {
-		if (buf->frags) {
+		/* External data is never moved, it stays in its own
+		 * fragment.
+		 */
+		if (buf->frags && !net_nbuf_is_ext(buf->frags)) {
 			/* Copy amount of data from next fragment to this
 			 * fragment.
 			 */
@@ -820,7 +1135,7 @@ struct net_buf *net_nbuf_compact(struct net_buf *buf)
 				/* Then check next fragment */
 				continue;
 			}
-		} else {
+		} else if (!buf->frags) {
 			if (!buf->len) {
 				/* Remove the last fragment because there is no
 				 * data in it.
@@ -1003,30 +1318,49 @@ bool net_nbuf_append(struct net_buf *buf, uint16_t len, uint8_t *data)
 	return net_nbuf_append_bytes(buf, data, len);
 }
 
-/* Helper routine to retrieve single byte from fragment and move
- * offset. If required byte is last byte in framgent then return
- * next fragment and set offset = 0.
- */
-static inline struct net_buf *net_nbuf_read_byte(struct net_buf *buf,
-						 uint16_t offset,
-						 uint16_t *pos,
-						 uint8_t *data)
+#if defined(CONFIG_NET_NBUF_EXT_DATA)
+bool net_nbuf_append_ext(struct net_buf *buf, uint16_t len,
+			 const uint8_t *data, net_nbuf_ext_release_t cb,
+			 void *user_data)
 {
-	if (data) {
-		*data = buf->data[offset];
-	}
+	struct nbuf_ext *ext;
+	struct net_buf *frag;
 
-	*pos = offset + 1;
+	if (!buf || !data) {
+		return false;
+	}
 
-	if (*pos >= buf->len) {
-		*pos = 0;
+	if (is_from_data_pool(buf)) {
+		NET_DBG("Buffer %p is a data fragment", buf);
+		return false;
+	}
 
-		return buf->frags;
+	frag = net_buf_get(&free_ext_bufs, 0);
+	if (!frag) {
+		return false;
 	}
 
-	return buf;
+	ext = net_buf_user_data(frag);
+	ext->data = data;
+	ext->cb = cb;
+	ext->user_data = user_data;
+
+	frag->data = (uint8_t *)data;
+	frag->len = len;
+	frag->flags |= NET_BUF_EXTERNAL_DATA;
+
+	NET_DBG("buf %p ext frag %p data %p len %u", buf, frag, data, len);
+
+	net_buf_frag_add(buf, frag);
+
+	return true;
 }
+#endif /* CONFIG_NET_NBUF_EXT_DATA */
 
+/* Helper routine to retrieve single byte from fragment and move
+ * offset. If required byte is last byte in framgent then return
+ * next fragment and set offset = 0.
+ */
 /* Helper function to adjust offset in net_nbuf_read() call
  * if given offset is more than current fragment length.
  */
@@ -1061,27 +1395,34 @@ static inline struct net_buf *adjust_offset(struct net_buf *buf,
 struct net_buf *net_nbuf_read(struct net_buf *buf, uint16_t offset,
 			      uint16_t *pos, uint16_t len, uint8_t *data)
 {
-	uint16_t copy = 0;
-
 	buf = adjust_offset(buf, offset, pos);
 	if (!buf) {
 		goto error;
 	}
 
-	while (len-- > 0 && buf) {
+	while (len > 0 && buf) {
+		uint16_t count = min(len, buf->len - *pos);
+
 		if (data) {
-			buf = net_nbuf_read_byte(buf, *pos, pos, data + copy++);
-		} else {
-			buf = net_nbuf_read_byte(buf, *pos, pos, NULL);
+			memcpy(data, buf->data + *pos, count);
+			data += count;
 		}
 
-		/* Error: Still reamining length to be read, but no data. */
-		if (!buf && len) {
-			NET_ERR("Not enough data to read");
-			goto error;
+		len -= count;
+		*pos += count;
+
+		if (*pos >= buf->len) {
+			*pos = 0;
+			buf = buf->frags;
 		}
 	}
 
+	/* Error: Still reamining length to be read, but no data. */
+	if (len) {
+		NET_ERR("Not enough data to read");
+		goto error;
+	}
+
 	return buf;
 
 error:
@@ -1116,6 +1457,98 @@ struct net_buf *net_nbuf_read_be32(struct net_buf *buf, uint16_t offset,
 	return retbuf;
 }
 
+void net_nbuf_cursor_init(struct net_nbuf_cursor *cursor,
+			  struct net_buf *buf, struct net_buf *frag,
+			  uint16_t offset)
+{
+	while (frag && offset > frag->len) {
+		offset -= frag->len;
+		frag = frag->frags;
+	}
+
+	cursor->buf = buf;
+	cursor->frag = frag;
+	cursor->pos = offset;
+	cursor->error = false;
+}
+
+/* Move to the next fragment if the current one is fully consumed. */
+static inline void cursor_normalize(struct net_nbuf_cursor *cursor)
+{
+	while (cursor->frag && cursor->pos >= cursor->frag->len) {
+		cursor->pos -= cursor->frag->len;
+		cursor->frag = cursor->frag->frags;
+	}
+}
+
+bool net_nbuf_cursor_read(struct net_nbuf_cursor *cursor, uint16_t len,
+			  uint8_t *data)
+{
+	if (cursor->error) {
+		return false;
+	}
+
+	while (len > 0) {
+		uint16_t count;
+
+		cursor_normalize(cursor);
+
+		if (!cursor->frag) {
+			NET_DBG("Not enough data to read, %u bytes missing",
+				len);
+			cursor->error = true;
+			return false;
+		}
+
+		count = min(len, cursor->frag->len - cursor->pos);
+
+		if (data) {
+			memcpy(data, cursor->frag->data + cursor->pos, count);
+			data += count;
+		}
+
+		cursor->pos += count;
+		len -= count;
+	}
+
+	return true;
+}
+
+bool net_nbuf_cursor_read_be16(struct net_nbuf_cursor *cursor,
+			       uint16_t *value)
+{
+	uint8_t v16[2];
+
+	if (!net_nbuf_cursor_read(cursor, sizeof(v16), v16)) {
+		return false;
+	}
+
+	*value = v16[0] << 8 | v16[1];
+
+	return true;
+}
+
+bool net_nbuf_cursor_read_be32(struct net_nbuf_cursor *cursor,
+			       uint32_t *value)
+{
+	uint8_t v32[4];
+
+	if (!net_nbuf_cursor_read(cursor, sizeof(v32), v32)) {
+		return false;
+	}
+
+	*value = v32[0] << 24 | v32[1] << 16 | v32[2] << 8 | v32[3];
+
+	return true;
+}
+
+bool net_nbuf_cursor_is_end(struct net_nbuf_cursor *cursor)
+{
+	cursor_normalize(cursor);
+
+	return !cursor->frag;
+}
+
 static inline struct net_buf *check_and_create_data(struct net_buf *buf,
 						    struct net_buf *data)
 {
@@ -1235,10 +1668,17 @@ struct net_buf *net_nbuf_write(struct net_buf *buf, struct net_buf *frag,
 	}
 
 	do {
-		uint16_t space = frag->size - net_buf_headroom(frag) - offset;
-		uint16_t count = min(len, space);
+		uint16_t space, count;
 		int size_to_add;
 
+		if (net_nbuf_is_ext(frag)) {
+			NET_DBG("Cannot write to external data %p", frag);
+			goto error;
+		}
+
+		space = frag->size - net_buf_headroom(frag) - offset;
+		count = min(len, space);
+
 		memcpy(frag->data + offset, data, count);
 
 		/* If we are overwriting on already available space then need
@@ -1276,6 +1716,30 @@ error:
 	return NULL;
 }
 
+bool net_nbuf_cursor_write(struct net_nbuf_cursor *cursor, uint16_t len,
+			   uint8_t *data)
+{
+	struct net_buf *frag;
+
+	if (cursor->error) {
+		return false;
+	}
+
+	/* The write continues from the current fragment so that the
+	 * fragment list is not walked again.
+	 */
+	frag = net_nbuf_write(cursor->buf, cursor->frag, cursor->pos,
+			      &cursor->pos, len, data);
+	if (!frag) {
+		cursor->error = true;
+		return false;
+	}
+
+	cursor->frag = frag;
+
+	return true;
+}
+
 static inline bool insert_data(struct net_buf *buf, struct net_buf *frag,
 			       struct net_buf *temp, uint16_t offset,
 			       uint16_t len, uint8_t *data)
@@ -1376,6 +1840,11 @@ bool net_nbuf_insert(struct net_buf *buf, struct net_buf *frag,
 		return false;
 	}
 
+	if (net_nbuf_is_ext(frag)) {
+		NET_DBG("Cannot insert into external data %p", frag);
+		return false;
+	}
+
 	/* If there is any data after offset, store in temp fragment and
 	 * add it after insertion is completed.
 	 */
@@ -1414,6 +1883,10 @@ void net_nbuf_get_info(size_t *tx_size, size_t *rx_size, size_t *data_size,
 	*tx = get_frees(NET_NBUF_TX);
 	*rx = get_frees(NET_NBUF_RX);
 	*data = get_frees(NET_NBUF_DATA);
+#elif defined(CONFIG_NET_NBUF_QUOTA)
+	*tx = tx_acct.free;
+	*rx = rx_acct.free;
+	*data = data_acct.free;
 #else
 	*tx = BIT(31);
 	*rx = BIT(31);
@@ -1421,6 +1894,22 @@ void net_nbuf_get_info(size_t *tx_size, size_t *rx_size, size_t *data_size,
 #endif
 }
 
+#if defined(CONFIG_NET_NBUF_WATERMARK)
+void net_nbuf_get_watermarks(int *tx, int *rx, int *data)
+{
+	*tx = atomic_get(&tx_mark.max);
+	*rx = atomic_get(&rx_mark.max);
+	*data = atomic_get(&data_mark.max);
+}
+
+void net_nbuf_reset_watermarks(void)
+{
+	atomic_set(&tx_mark.max, atomic_get(&tx_mark.used));
+	atomic_set(&rx_mark.max, atomic_get(&rx_mark.used));
+	atomic_set(&data_mark.max, atomic_get(&data_mark.used));
+}
+#endif /* CONFIG_NET_NBUF_WATERMARK */
+
 #if NET_DEBUG
 void net_nbuf_print(void)
 {
@@ -1443,4 +1932,8 @@ void net_nbuf_init(void)
 	net_buf_pool_init(rx_buffers);
 	net_buf_pool_init(tx_buffers);
 	net_buf_pool_init(data_buffers);
+
+#if defined(CONFIG_NET_NBUF_EXT_DATA)
+	net_buf_pool_init(ext_buffers);
+#endif
 }
@@ -0,0 +1,412 @@
+/** @file
+ * @brief Packet capture
+ *
+ * Copies packets into a ring at selected points of the stack and
+ * writes them out in pcapng format.
+ */
+
+/*
+ * Copyright (c) 2016 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <kernel.h>
+#include <string.h>
+#include <errno.h>
+#include <stddef.h>
+#include <atomic.h>
+#include <misc/byteorder.h>
+
+#include <net/nbuf.h>
+#include <net/net_ip.h>
+
+#include "net_private.h"
+#include "net_capture.h"
+
+#define PCAPNG_SHB		0x0a0d0d0a
+#define PCAPNG_IDB		0x00000001
+#define PCAPNG_EPB		0x00000006
+#define PCAPNG_BYTE_ORDER	0x1a2b3c4d
+
+#define PCAPNG_OPT_END		0
+#define PCAPNG_OPT_COMMENT	1
+#define PCAPNG_OPT_EPB_FLAGS	2
+#define PCAPNG_OPT_IF_TSRESOL	9
+
+#define PCAPNG_EPB_INBOUND	1
+#define PCAPNG_EPB_OUTBOUND	2
+
+/* Raw IPv4 or IPv6 packet */
+#define LINKTYPE_RAW		101
+
+/* Timestamps are in 10^-3 seconds */
+#define TSRESOL_MS		3
+
+#define PAD4(len) (((len) + 3) & ~3)
+
+struct pcapng_shb {
+	uint32_t type;
+	uint32_t len;
+	uint32_t byte_order;
+	uint16_t major;
+	uint16_t minor;
+	int64_t section_len;
+	uint32_t trailer_len;
+} __packed;
+
+struct pcapng_idb {
+	uint32_t type;
+	uint32_t len;
+	uint16_t linktype;
+	uint16_t reserved;
+	uint32_t snaplen;
+	uint16_t tsresol_code;
+	uint16_t tsresol_len;
+	uint8_t tsresol;
+	uint8_t tsresol_pad[3];
+	uint32_t end_of_opt;
+	uint32_t trailer_len;
+} __packed;
+
+struct pcapng_epb {
+	uint32_t type;
+	uint32_t len;
+	uint32_t iface;
+	uint32_t ts_high;
+	uint32_t ts_low;
+	uint32_t cap_len;
+	uint32_t orig_len;
+} __packed;
+
+struct pcapng_opt {
+	uint16_t code;
+	uint16_t len;
+} __packed;
+
+struct capture_record {
+	/* Sequence number of the packet plus one, zero while the record
+	 * is being written.
+	 */
+	atomic_t seq;
+	uint32_t timestamp;
+	uint16_t orig_len;
+	uint16_t cap_len;
+	uint8_t point;
+	uint8_t iface;
+	uint8_t data[CONFIG_NET_CAPTURE_SNAPLEN];
+};
+
+/* Checked inline by net_capture(), zero when not capturing */
+uint8_t net_capture_points;
+
+static struct net_capture_filter filter;
+static uint16_t snaplen;
+
+/* Every writer claims the next record with one atomic increment, so
+ * packets can be captured from any thread or ISR without locking.
+ * The oldest records are overwritten when the ring is full.
+ */
+static atomic_t head;
+static struct capture_record ring[CONFIG_NET_CAPTURE_COUNT];
+
+/* The filter looks at the first fragment only and does not follow
+ * IPv6 extension headers.
+ */
+static bool match(struct net_buf *buf)
+{
+	struct net_buf *frag = buf->frags;
+	uint16_t hdr_len;
+	uint8_t family;
+	uint8_t proto;
+
+	if (filter.iface && filter.iface != net_nbuf_iface(buf)) {
+		return false;
+	}
+
+	if (!filter.family && !filter.proto && !filter.port) {
+		return true;
+	}
+
+	if (!frag || !frag->len) {
+		return false;
+	}
+
+	switch (frag->data[0] & 0xf0) {
+	case 0x60:
+		hdr_len = sizeof(struct net_ipv6_hdr);
+		if (frag->len < hdr_len) {
+			return false;
+		}
+
+		family = AF_INET6;
+		proto = frag->data[offsetof(struct net_ipv6_hdr, nexthdr)];
+		break;
+	case 0x40:
+		hdr_len = (frag->data[0] & 0x0f) * 4;
+		if (frag->len < sizeof(struct net_ipv4_hdr)) {
+			return false;
+		}
+
+		family = AF_INET;
+		proto = frag->data[offsetof(struct net_ipv4_hdr, proto)];
+		break;
+	default:
+		return false;
+	}
+
+	if ((filter.family && filter.family != family) ||
+	    (filter.proto && filter.proto != proto)) {
+		return false;
+	}
+
+	if (!filter.port) {
+		return true;
+	}
+
+	if ((proto != IPPROTO_UDP && proto != IPPROTO_TCP) ||
+	    frag->len < hdr_len + 2 * sizeof(uint16_t)) {
+		return false;
+	}
+
+	/* Source and destination ports are first in both headers */
+	return sys_get_be16(&frag->data[hdr_len]) == filter.port ||
+		sys_get_be16(&frag->data[hdr_len + 2]) == filter.port;
+}
+
+void net_capture_pkt(enum net_capture_point point, struct net_buf *buf)
+{
+	struct net_if *iface = net_nbuf_iface(buf);
+	struct capture_record *rec;
+	struct net_buf *frag;
+	uint16_t len, copy;
+	uint32_t seq;
+
+	if (!match(buf)) {
+		return;
+	}
+
+	seq = atomic_inc(&head);
+	rec = &ring[seq % CONFIG_NET_CAPTURE_COUNT];
+
+	atomic_clear(&rec->seq);
+
+	rec->timestamp = k_uptime_get_32();
+	rec->point = point;
+	rec->iface = iface ? net_if_get_by_iface(iface) : 0;
+	rec->orig_len = net_buf_frags_len(buf->frags);
+
+	for (frag = buf->frags, len = 0; frag && len < snaplen;
+	     frag = frag->frags) {
+		copy = min(frag->len, snaplen - len);
+		memcpy(rec->data + len, frag->data, copy);
+		len += copy;
+	}
+
+	rec->cap_len = len;
+
+	atomic_set(&rec->seq, seq + 1);
+}
+
+int net_capture_start(const struct net_capture_filter *new_filter,
+		      uint16_t len)
+{
+	int i;
+
+	if (!new_filter->points || (new_filter->points & ~NET_CAPTURE_ALL) ||
+	    len > CONFIG_NET_CAPTURE_SNAPLEN) {
+		return -EINVAL;
+	}
+
+	net_capture_points = 0;
+
+	filter = *new_filter;
+	snaplen = len ? len : CONFIG_NET_CAPTURE_SNAPLEN;
+
+	atomic_clear(&head);
+
+	for (i = 0; i < CONFIG_NET_CAPTURE_COUNT; i++) {
+		atomic_clear(&ring[i].seq);
+	}
+
+	net_capture_points = filter.points;
+
+	return 0;
+}
+
+void net_capture_stop(void)
+{
+	net_capture_points = 0;
+}
+
+bool net_capture_status(struct net_capture_filter *current,
+			uint32_t *captured, uint32_t *lost)
+{
+	uint32_t count = atomic_get(&head);
+
+	if (current) {
+		*current = filter;
+	}
+
+	if (captured) {
+		*captured = count;
+	}
+
+	if (lost) {
+		*lost = count > CONFIG_NET_CAPTURE_COUNT ?
+			count - CONFIG_NET_CAPTURE_COUNT : 0;
+	}
+
+	return net_capture_points != 0;
+}
+
+struct dump_ctx {
+	net_capture_write_cb_t cb;
+	void *user_data;
+};
+
+static void write_idb(struct net_if *iface, void *user_data)
+{
+	struct dump_ctx *ctx = user_data;
+	struct pcapng_idb idb = {
+		.type = PCAPNG_IDB,
+		.len = sizeof(idb),
+		.linktype = LINKTYPE_RAW,
+		.snaplen = snaplen,
+		.tsresol_code = PCAPNG_OPT_IF_TSRESOL,
+		.tsresol_len = 1,
+		.tsresol = TSRESOL_MS,
+		.end_of_opt = PCAPNG_OPT_END,
+		.trailer_len = sizeof(idb),
+	};
+
+	ctx->cb((uint8_t *)&idb, sizeof(idb), ctx->user_data);
+}
+
+static const char *point_comment(uint8_t point)
+{
+	switch (point) {
+	case NET_CAPTURE_DROP:
+		return "dropped";
+	case NET_CAPTURE_TCP_RETRY:
+		return "tcp retransmit";
+	}
+
+	return NULL;
+}
+
+static void write_epb(struct dump_ctx *ctx, struct capture_record *rec)
+{
+	static const uint8_t pad[4];
+	const char *comment = point_comment(rec->point);
+	uint16_t comment_len = comment ? strlen(comment) : 0;
+	struct pcapng_opt opt;
+	uint32_t flags, len;
+	struct pcapng_epb epb = {
+		.type = PCAPNG_EPB,
+		.iface = rec->iface,
+		.ts_low = rec->timestamp,
+		.cap_len = rec->cap_len,
+		.orig_len = rec->orig_len,
+	};
+
+	epb.len = sizeof(epb) + PAD4(rec->cap_len) +
+		sizeof(opt) + sizeof(flags) + sizeof(opt) + sizeof(len);
+	if (comment) {
+		epb.len += sizeof(opt) + PAD4(comment_len);
+	}
+
+	ctx->cb((uint8_t *)&epb, sizeof(epb), ctx->user_data);
+	ctx->cb(rec->data, rec->cap_len, ctx->user_data);
+	ctx->cb(pad, PAD4(rec->cap_len) - rec->cap_len, ctx->user_data);
+
+	opt.code = PCAPNG_OPT_EPB_FLAGS;
+	opt.len = sizeof(flags);
+	flags = (rec->point & (NET_CAPTURE_RX | NET_CAPTURE_DROP)) ?
+		PCAPNG_EPB_INBOUND : PCAPNG_EPB_OUTBOUND;
+
+	ctx->cb((uint8_t *)&opt, sizeof(opt), ctx->user_data);
+	ctx->cb((uint8_t *)&flags, sizeof(flags), ctx->user_data);
+
+	if (comment) {
+		opt.code = PCAPNG_OPT_COMMENT;
+		opt.len = comment_len;
+
+		ctx->cb((uint8_t *)&opt, sizeof(opt), ctx->user_data);
+		ctx->cb((const uint8_t *)comment, comment_len, ctx->user_data);
+		ctx->cb(pad, PAD4(comment_len) - comment_len, ctx->user_data);
+	}
+
+	opt.code = PCAPNG_OPT_END;
+	opt.len = 0;
+	len = epb.len;
+
+	ctx->cb((uint8_t *)&opt, sizeof(opt), ctx->user_data);
+	ctx->cb((uint8_t *)&len, sizeof(len), ctx->user_data);
+}
+
+int net_capture_dump(net_capture_write_cb_t cb, void *user_data)
+{
+	/* Static as it can be large, the dump is not reentrant anyway */
+	static struct capture_record copy;
+	struct dump_ctx ctx = {
+		.cb = cb,
+		.user_data = user_data,
+	};
+	struct pcapng_shb shb = {
+		.type = PCAPNG_SHB,
+		.len = sizeof(shb),
+		.byte_order = PCAPNG_BYTE_ORDER,
+		.major = 1,
+		.minor = 0,
+		.section_len = -1,
+		.trailer_len = sizeof(shb),
+	};
+	struct capture_record *rec;
+	uint32_t seq, end;
+	int count = 0;
+
+	net_capture_stop();
+
+	cb((uint8_t *)&shb, sizeof(shb), user_data);
+
+	net_if_foreach(write_idb, &ctx);
+
+	end = atomic_get(&head);
+	seq = end > CONFIG_NET_CAPTURE_COUNT ?
+		end - CONFIG_NET_CAPTURE_COUNT : 0;
+
+	for (; seq != end; seq++) {
+		rec = &ring[seq % CONFIG_NET_CAPTURE_COUNT];
+
+		/* Skip the records that were still being written */
+		if (atomic_get(&rec->seq) != seq + 1) {
+			continue;
+		}
+
+		memcpy(&copy, rec, sizeof(copy));
+
+		/* A writer that started before the capture was stopped
+		 * may have claimed the record again during the copy.
+		 */
+		if (atomic_get(&rec->seq) != seq + 1 ||
+		    copy.cap_len > CONFIG_NET_CAPTURE_SNAPLEN) {
+			continue;
+		}
+
+		write_epb(&ctx, &copy);
+		count++;
+	}
+
+	return count;
+}
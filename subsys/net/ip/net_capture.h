@@ -0,0 +1,162 @@
+/** @file
+ * @brief Packet capture
+ *
+ * This is not to be included by the application.
+ */
+
+/*
+ * Copyright (c) 2016 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __NET_CAPTURE_H
+#define __NET_CAPTURE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <misc/util.h>
+
+#include <net/buf.h>
+#include <net/net_if.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Points in the stack where packets can be captured */
+enum net_capture_point {
+	/** Packet received, after the L2 has processed it */
+	NET_CAPTURE_RX		= BIT(0),
+
+	/** Packet sent, before it is passed to the L2 */
+	NET_CAPTURE_TX		= BIT(1),
+
+	/** Received packet dropped by the IP layer */
+	NET_CAPTURE_DROP	= BIT(2),
+
+	/** TCP segment retransmitted */
+	NET_CAPTURE_TCP_RETRY	= BIT(3),
+};
+
+#define NET_CAPTURE_ALL (NET_CAPTURE_RX | NET_CAPTURE_TX | \
+			 NET_CAPTURE_DROP | NET_CAPTURE_TCP_RETRY)
+
+/**
+ * @brief Capture filter. A packet is captured if it matches all the
+ * fields that are set, so a zeroed filter (with some points set)
+ * matches every packet.
+ */
+struct net_capture_filter {
+	/** Capture only the packets of this interface */
+	struct net_if *iface;
+
+	/** Source or destination port of TCP and UDP packets */
+	uint16_t port;
+
+	/** AF_INET or AF_INET6 */
+	uint8_t family;
+
+	/** IP protocol, like IPPROTO_UDP */
+	uint8_t proto;
+
+	/** Bitmask of enum net_capture_point */
+	uint8_t points;
+};
+
+/**
+ * @brief Callback that receives the pcapng data from net_capture_dump()
+ *
+ * @param data Next part of the pcapng data
+ * @param len Length of the data
+ * @param user_data User specified data
+ */
+typedef void (*net_capture_write_cb_t)(const uint8_t *data, size_t len,
+				       void *user_data);
+
+#if defined(CONFIG_NET_CAPTURE)
+extern uint8_t net_capture_points;
+
+void net_capture_pkt(enum net_capture_point point, struct net_buf *buf);
+
+/**
+ * @brief Capture a packet if capturing is enabled at this point.
+ *
+ * @details This is cheap when the capture is not running. It can be
+ * called from an ISR.
+ *
+ * @param point Where the packet is in the stack
+ * @param buf Network buffer, the data must start from the IP header
+ */
+static inline void net_capture(enum net_capture_point point,
+			       struct net_buf *buf)
+{
+	if (net_capture_points & point) {
+		net_capture_pkt(point, buf);
+	}
+}
+
+/**
+ * @brief Empty the capture ring and start capturing.
+ *
+ * @param filter Which packets to capture
+ * @param snaplen How many bytes to copy from each packet, 0 for
+ * CONFIG_NET_CAPTURE_SNAPLEN
+ *
+ * @return 0 if ok, <0 if the filter or the length is invalid.
+ */
+int net_capture_start(const struct net_capture_filter *filter,
+		      uint16_t snaplen);
+
+/**
+ * @brief Stop capturing. The captured packets stay in the ring.
+ */
+void net_capture_stop(void);
+
+/**
+ * @brief Get the capture state.
+ *
+ * @param filter Filter in use, can be NULL
+ * @param captured Number of packets captured since the start, can be
+ * NULL
+ * @param lost Number of packets overwritten in the ring, can be NULL
+ *
+ * @return True if the capture is running.
+ */
+bool net_capture_status(struct net_capture_filter *filter,
+			uint32_t *captured, uint32_t *lost);
+
+/**
+ * @brief Write the captured packets in pcapng format.
+ *
+ * @details The capture is stopped first. There is one interface
+ * description block per network interface, so the interface id of a
+ * packet is its net_if_get_by_iface() index. The packets start from
+ * the IP header (LINKTYPE_RAW) and the timestamps are in milliseconds
+ * since boot.
+ *
+ * @param cb Callback that is called for each part of the data
+ * @param user_data User specified data given to the callback
+ *
+ * @return Number of packets written.
+ */
+int net_capture_dump(net_capture_write_cb_t cb, void *user_data);
+#else
+#define net_capture(...)
+#endif /* CONFIG_NET_CAPTURE */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __NET_CAPTURE_H */
@@ -37,6 +37,7 @@
 
 #include "connection.h"
 #include "net_private.h"
+#include "net_profile.h"
 
 #include "ipv6.h"
 #include "ipv4.h"
@@ -195,6 +196,11 @@ int net_context_get(sa_family_t family,
 
 		contexts[i].flags |= NET_CONTEXT_IN_USE;
 		contexts[i].iface = 0;
+		contexts[i].priority = NET_PRIORITY_BE;
+
+#if defined(CONFIG_NET_NBUF_QUOTA)
+		contexts[i].nbuf_quota.limit = CONFIG_NET_NBUF_CONTEXT_QUOTA;
+#endif
 
 		memset(&contexts[i].remote, 0, sizeof(struct sockaddr));
 		memset(&contexts[i].local, 0, sizeof(struct sockaddr_ptr));
@@ -290,6 +296,12 @@ int net_context_put(struct net_context *context)
 	}
 #endif /* CONFIG_NET_TCP */
 
+	if (context->conn_handler) {
+		net_conn_unregister(context->conn_handler);
+		context->conn_handler = NULL;
+	}
+
+	context->recv_cb = NULL;
 	context->flags &= ~NET_CONTEXT_IN_USE;
 
 #if defined(CONFIG_NET_TCP)
@@ -759,6 +771,17 @@ static enum net_verdict tcp_established(struct net_conn *conn,
 
 		context->tcp->send_ack =
 			sys_get_be32(NET_TCP_BUF(buf)->seq) + 1;
+
+		/* The ACK below also sends our FIN, tell the application
+		 * after that so that it cannot release the context under us.
+		 */
+		send_ack(context, &conn->remote_addr);
+
+		if (context->recv_cb) {
+			context->recv_cb(context, NULL, 0, user_data);
+		}
+
+		return ret;
 	} else {
 		struct net_tcp_hdr *hdr = (void *)net_nbuf_tcp_data(buf);
 
@@ -770,6 +793,11 @@ static enum net_verdict tcp_established(struct net_conn *conn,
 			return NET_DROP;
 		}
 
+		/* Drop before acking so that the peer retransmits */
+		if (!net_nbuf_charge_context(buf, context)) {
+			return NET_DROP;
+		}
+
 		context->tcp->send_ack += net_nbuf_appdatalen(buf);
 
 		ret = packet_received(conn, buf, user_data);
@@ -864,12 +892,32 @@ static enum net_verdict tcp_synack_received(struct net_conn *conn,
 		if (net_nbuf_family(buf) == AF_INET6) {
 			laddr = (struct sockaddr *)&l6addr;
 			raddr = (struct sockaddr *)&r6addr;
+
+			r6addr.sin6_family = AF_INET6;
+			r6addr.sin6_port = NET_TCP_BUF(buf)->src_port;
+			net_ipaddr_copy(&r6addr.sin6_addr,
+					&NET_IPV6_BUF(buf)->src);
+
+			l6addr.sin6_family = AF_INET6;
+			l6addr.sin6_port = NET_TCP_BUF(buf)->dst_port;
+			net_ipaddr_copy(&l6addr.sin6_addr,
+					&NET_IPV6_BUF(buf)->dst);
 		} else
 #endif
 #if defined(CONFIG_NET_IPV4)
 		if (net_nbuf_family(buf) == AF_INET) {
 			laddr = (struct sockaddr *)&l4addr;
 			raddr = (struct sockaddr *)&r4addr;
+
+			r4addr.sin_family = AF_INET;
+			r4addr.sin_port = NET_TCP_BUF(buf)->src_port;
+			net_ipaddr_copy(&r4addr.sin_addr,
+					&NET_IPV4_BUF(buf)->src);
+
+			l4addr.sin_family = AF_INET;
+			l4addr.sin_port = NET_TCP_BUF(buf)->dst_port;
+			net_ipaddr_copy(&l4addr.sin_addr,
+					&NET_IPV4_BUF(buf)->dst);
 		} else
 #endif
 		{
@@ -895,11 +943,22 @@ static enum net_verdict tcp_synack_received(struct net_conn *conn,
 			return NET_DROP;
 		}
 
+		context->tcp->send_ack =
+			sys_get_be32(NET_TCP_BUF(buf)->seq) + 1;
+
 		net_tcp_change_state(context->tcp, NET_TCP_ESTABLISHED);
+		net_context_set_state(context, NET_CONTEXT_CONNECTED);
 
 		send_ack(context, raddr);
 
-		return NET_OK;
+		k_sem_give(&context->tcp->connect_wait);
+
+		if (context->connect_cb) {
+			context->connect_cb(context, context->user_data);
+			context->connect_cb = NULL;
+		}
+
+		return NET_DROP;
 	}
 
 	return NET_DROP;
@@ -1074,11 +1133,18 @@ int net_context_connect(struct net_context *context,
 
 	net_context_set_state(context, NET_CONTEXT_CONNECTING);
 
+	context->connect_cb = cb;
+	context->user_data = user_data;
+	k_sem_reset(&context->tcp->connect_wait);
+
 	/* FIXME - set timer to wait for SYN-ACK */
 	send_syn(context, addr);
 
-	if (cb) {
-		cb(context, user_data);
+	/* The callback is called when the SYN-ACK is received */
+	if (timeout != K_NO_WAIT &&
+	    k_sem_take(&context->tcp->connect_wait, timeout)) {
+		context->connect_cb = NULL;
+		return -ETIMEDOUT;
 	}
 #endif
 
@@ -1395,7 +1461,7 @@ int net_context_accept(struct net_context *context,
 			laddr = &local_addr;
 		}
 
-		net_sin6(&local_addr)->sin6_port =
+		net_sin6(&local_addr)->sin6_port = lport =
 			net_sin6((struct sockaddr *)&context->local)->sin6_port;
 	}
 #endif /* CONFIG_NET_IPV6 */
@@ -1502,6 +1568,26 @@ static inline struct net_buf *update_ll_reserve(struct net_buf *buf,
 	frag = NULL;
 
 	while (orig_frag) {
+		/* External data has no link layer reserve, so it is
+		 * moved to the new chain as is.
+		 */
+		if (net_nbuf_is_ext(orig_frag)) {
+			frag = orig_frag;
+			orig_frag = orig_frag->frags;
+			frag->frags = NULL;
+
+			net_buf_frag_add(buf, frag);
+			room_len = 0;
+
+			if (!orig_frag) {
+				break;
+			}
+
+			copy_len = orig_frag->len;
+			pos = 0;
+			continue;
+		}
+
 		if (!room_len) {
 			frag = net_nbuf_get_reserve_data(reserve);
 
@@ -1649,6 +1735,10 @@ static int sendto(struct net_buf *buf,
 		return -EINVAL;
 	}
 
+	if (!net_nbuf_charge_context(buf, context)) {
+		return -ENOBUFS;
+	}
+
 #if defined(CONFIG_NET_UDP)
 	if (net_context_get_ip_proto(context) == IPPROTO_UDP) {
 		ret = create_udp_packet(context, buf, dst_addr, &buf);
@@ -1682,6 +1772,7 @@ int net_context_send(struct net_buf *buf,
 {
 	struct net_context *context = net_nbuf_context(buf);
 	socklen_t addrlen;
+	int ret;
 
 	NET_ASSERT(PART_OF_ARRAY(contexts, context));
 
@@ -1714,8 +1805,11 @@ int net_context_send(struct net_buf *buf,
 		addrlen = 0;
 	}
 
-	return sendto(buf, &context->remote, addrlen, cb, timeout, token,
-		      user_data);
+	NET_PROFILE(NET_PROFILE_CONTEXT_TX,
+		    ret = sendto(buf, &context->remote, addrlen, cb, timeout,
+				 token, user_data));
+
+	return ret;
 }
 
 int net_context_sendto(struct net_buf *buf,
@@ -1726,6 +1820,8 @@ int net_context_sendto(struct net_buf *buf,
 		       void *token,
 		       void *user_data)
 {
+	int ret;
+
 #if defined(CONFIG_NET_TCP)
 	struct net_context *context = net_nbuf_context(buf);
 
@@ -1737,7 +1833,11 @@ int net_context_sendto(struct net_buf *buf,
 	}
 #endif /* CONFIG_NET_TCP */
 
-	return sendto(buf, dst_addr, addrlen, cb, timeout, token, user_data);
+	NET_PROFILE(NET_PROFILE_CONTEXT_TX,
+		    ret = sendto(buf, dst_addr, addrlen, cb, timeout, token,
+				 user_data));
+
+	return ret;
 }
 
 static void set_appdata_values(struct net_buf *buf,
@@ -1792,6 +1892,10 @@ enum net_verdict packet_received(struct net_conn *conn,
 	if (context->recv_cb) {
 		size_t total_len = net_buf_frags_len(buf);
 
+		if (!net_nbuf_charge_context(buf, context)) {
+			return NET_DROP;
+		}
+
 		if (net_nbuf_family(buf) == AF_INET6) {
 			set_appdata_values(buf, NET_IPV6_BUF(buf)->nexthdr,
 					   total_len);
@@ -1804,7 +1908,8 @@ enum net_verdict packet_received(struct net_conn *conn,
 			net_nbuf_appdata(buf), net_nbuf_appdatalen(buf),
 			total_len);
 
-		context->recv_cb(context, buf, 0, user_data);
+		NET_PROFILE(NET_PROFILE_APP_RX,
+			    context->recv_cb(context, buf, 0, user_data));
 
 #if defined(CONFIG_NET_CONTEXT_SYNC_RECV)
 		k_sem_give(&context->recv_data_wait);
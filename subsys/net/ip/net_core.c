@@ -42,6 +42,8 @@
 
 #include "net_private.h"
 #include "net_shell.h"
+#include "net_capture.h"
+#include "net_profile.h"
 
 #include "icmpv6.h"
 #include "ipv6.h"
@@ -63,11 +65,38 @@
 #define CONFIG_NET_RX_STACK_SIZE 1024
 #endif
 
+#if !defined(CONFIG_NET_RX_THREAD_PRIO)
+#define CONFIG_NET_RX_THREAD_PRIO 8
+#endif
+
+#if !defined(CONFIG_NET_RX_QUEUE_MAX_DEPTH)
+#define CONFIG_NET_RX_QUEUE_MAX_DEPTH 0
+#endif
+
+#if !defined(CONFIG_NET_RX_BATCH_SIZE)
+#define CONFIG_NET_RX_BATCH_SIZE 1
+#endif
+
+#if !defined(CONFIG_NET_RX_QUEUE_PER_IFACE)
 NET_STACK_DEFINE(RX, rx_stack, CONFIG_NET_RX_STACK_SIZE,
 		 CONFIG_NET_RX_STACK_SIZE + CONFIG_NET_RX_STACK_RPL);
 
 static struct k_fifo rx_queue;
+static atomic_t rx_queue_pending;
 static k_tid_t rx_tid;
+#endif
+
+#if defined(CONFIG_NET_RX_FLOW_HASH)
+#define RX_FLOW_STACK_SIZE (CONFIG_NET_RX_STACK_SIZE + CONFIG_NET_RX_STACK_RPL)
+
+static unsigned char __noinit __stack
+	rx_flow_stack[CONFIG_NET_RX_FLOW_QUEUE_COUNT][RX_FLOW_STACK_SIZE];
+
+static struct {
+	struct k_fifo queue;
+	atomic_t pending;
+} rx_flow[CONFIG_NET_RX_FLOW_QUEUE_COUNT];
+#endif
 
 #if defined(CONFIG_NET_STATISTICS)
 #define PRINT(fmt, ...) NET_INFO(fmt, ##__VA_ARGS__)
@@ -124,6 +153,32 @@ static inline void stats(void)
 		      GET_STAT(icmp.typeerr),
 		      GET_STAT(icmp.chkerr));
 
+		PRINT("Offload chksum tx\t%d\ttx sw\t%d\trx\t%d",
+		      GET_STAT(offload.tx_chksum),
+		      GET_STAT(offload.tx_sw_chksum),
+		      GET_STAT(offload.rx_chksum));
+
+#if !defined(CONFIG_NET_RX_QUEUE_PER_IFACE)
+		PRINT("RX queue       queued\t%d\tdrop\t%d\tmax depth\t%d",
+		      GET_STAT(rx_queue.queued),
+		      GET_STAT(rx_queue.drop),
+		      GET_STAT(rx_queue.max_depth));
+#endif
+
+#if defined(CONFIG_NET_RX_FLOW_HASH)
+		{
+			int i;
+
+			for (i = 0; i < CONFIG_NET_RX_FLOW_QUEUE_COUNT; i++) {
+				PRINT("RX flow %d    queued\t%d\tdrop\t%d\t"
+				      "max depth\t%d", i,
+				      GET_STAT(rx_flow[i].queued),
+				      GET_STAT(rx_flow[i].drop),
+				      GET_STAT(rx_flow[i].max_depth));
+			}
+		}
+#endif
+
 #if defined(CONFIG_NET_UDP)
 		PRINT("UDP recv       %d\tsent\t%d\tdrop\t%d",
 		      GET_STAT(udp.recv),
@@ -165,6 +220,9 @@ static inline void stats(void)
 		      GET_STAT(rpl.loop_warnings));
 		PRINT("RPL r-repairs  %d",
 		      GET_STAT(rpl.root_repairs));
+		PRINT("RPL parents    scans\t%d\tupdates\t%d",
+		      GET_STAT(rpl.parent_scans),
+		      GET_STAT(rpl.parent_updates));
 #endif
 
 		PRINT("Processing err %d", GET_STAT(processing_error));
@@ -308,7 +366,7 @@ static inline struct net_buf *handle_ext_hdr_options(struct net_buf *buf,
 	return frag;
 }
 
-static inline enum net_verdict process_ipv6_pkt(struct net_buf *buf)
+enum net_verdict net_ipv6_process_pkt(struct net_buf *buf)
 {
 	struct net_ipv6_hdr *hdr = NET_IPV6_BUF(buf);
 	int real_len = net_buf_frags_len(buf);
@@ -412,6 +470,15 @@ static inline enum net_verdict process_ipv6_pkt(struct net_buf *buf)
 			 */
 			goto drop;
 
+#if defined(CONFIG_NET_IPV6_FRAGMENT)
+		case NET_IPV6_NEXTHDR_FRAG:
+			/* The next header and reserved fields are already
+			 * read.
+			 */
+			return net_ipv6_handle_fragment_hdr(buf, frag, real_len,
+							    offset - 2);
+#endif
+
 		case NET_IPV6_NEXTHDR_HBHO:
 			/* Hop by hop option */
 			if (net_nbuf_ext_bitmap(buf) &
@@ -575,44 +642,239 @@ drop:
 }
 #endif /* CONFIG_NET_IPV4 */
 
-static inline enum net_verdict process_data(struct net_buf *buf,
-					    bool is_loopback)
+#if defined(CONFIG_NET_STATISTICS)
+#define IFACE_RX_STATS(iface) (&(iface)->rx_stats)
+#define GLOBAL_RX_STATS() (&net_stats.rx_queue)
+#define FLOW_RX_STATS(idx) (&net_stats.rx_flow[idx])
+#else
+#define IFACE_RX_STATS(iface) NULL
+#define GLOBAL_RX_STATS() NULL
+#define FLOW_RX_STATS(idx) NULL
+#endif
+
+/* Put received packets to RX queue. The pending counter tells how many
+ * packets are waiting in the queue, it is decremented by the RX thread.
+ * Returns the number of packets queued, the rest did not fit.
+ */
+static int rx_queue_put_list(struct k_fifo *queue, atomic_t *pending,
+			     struct net_stats_rx_queue *stats,
+			     struct net_buf **bufs, int count)
 {
-	int ret;
+	atomic_val_t depth = atomic_add(pending, count) + count;
+
+	if (CONFIG_NET_RX_QUEUE_MAX_DEPTH &&
+	    depth > CONFIG_NET_RX_QUEUE_MAX_DEPTH) {
+		int over = min(depth - CONFIG_NET_RX_QUEUE_MAX_DEPTH, count);
+
+		atomic_sub(pending, over);
+
+		NET_DBG("RX queue %p full, dropping %d buf(s)", queue, over);
+		NET_STATS(stats->drop += over);
 
-	/* If there is no data, then drop the packet. Also if
-	 * the buffer is wrong type, then also drop the packet.
-	 * The first buffer needs to have user data part that
-	 * contains user data. The rest of the fragments should
-	 * be data fragments without user data.
+		count -= over;
+		depth -= over;
+
+		if (!count) {
+			return 0;
+		}
+	}
+
+#if defined(CONFIG_NET_STATISTICS)
+	stats->queued += count;
+
+	if (depth > stats->max_depth) {
+		stats->max_depth = depth;
+	}
+#endif
+
+	if (count == 1) {
+		net_buf_put(queue, bufs[0]);
+	} else {
+		net_buf_put_list(queue, bufs, count);
+	}
+
+	return count;
+}
+
+static inline int rx_queue_put(struct k_fifo *queue, atomic_t *pending,
+			       struct net_stats_rx_queue *stats,
+			       struct net_buf *buf)
+{
+	if (!rx_queue_put_list(queue, pending, stats, &buf, 1)) {
+		return -ENOBUFS;
+	}
+
+	return 0;
+}
+
+/* Wait for packets in RX queue and take up to CONFIG_NET_RX_BATCH_SIZE
+ * of them at once.
+ */
+static int rx_queue_get(struct k_fifo *queue, atomic_t *pending,
+			struct net_buf **bufs)
+{
+	int count = 1;
+	int avail;
+
+	bufs[0] = net_buf_get_timeout(queue, 0, K_FOREVER);
+
+	/* The counter is increased just before the packets are put to
+	 * the queue, so stop at the first empty get.
 	 */
+	avail = min(atomic_get(pending), CONFIG_NET_RX_BATCH_SIZE);
+
+	while (count < avail) {
+		bufs[count] = net_buf_get_timeout(queue, 0, K_NO_WAIT);
+		if (!bufs[count]) {
+			break;
+		}
+
+		count++;
+	}
+
+	atomic_sub(pending, count);
+
+	return count;
+}
+
+#if defined(CONFIG_NET_RX_FLOW_HASH)
+/* Calculate a hash from the IP addresses, protocol and ports of the
+ * packet so that all the packets of one connection end up in the same
+ * RX queue.
+ */
+static uint32_t rx_flow_hash(struct net_buf *buf)
+{
+	uint8_t *hdr = net_nbuf_ip_data(buf);
+	uint16_t len = buf->frags->len;
+	uint32_t hash = 0;
+	uint16_t hdr_len = 0;
+	uint8_t *addr;
+	uint8_t proto;
+	int i, addr_len;
+
+	switch (hdr[0] & 0xf0) {
+	case 0x60:
+		if (len < sizeof(struct net_ipv6_hdr)) {
+			return 0;
+		}
+
+		proto = NET_IPV6_BUF(buf)->nexthdr;
+		addr = (uint8_t *)&NET_IPV6_BUF(buf)->src;
+		addr_len = 2 * sizeof(struct in6_addr);
+		hdr_len = sizeof(struct net_ipv6_hdr);
+		break;
+	case 0x40:
+		if (len < sizeof(struct net_ipv4_hdr)) {
+			return 0;
+		}
+
+		proto = NET_IPV4_BUF(buf)->proto;
+		addr = (uint8_t *)&NET_IPV4_BUF(buf)->src;
+		addr_len = 2 * sizeof(struct in_addr);
+
+		/* Only the first fragment has the ports, so leave them
+		 * out for all the fragments: the first one has the MF
+		 * flag set, the others a fragment offset.
+		 */
+		if (!(NET_IPV4_BUF(buf)->offset[0] & 0x20) &&
+		    !(NET_IPV4_BUF(buf)->offset[0] & 0x1f) &&
+		    !NET_IPV4_BUF(buf)->offset[1]) {
+			hdr_len = (NET_IPV4_BUF(buf)->vhl & 0x0f) * 4;
+		}
+		break;
+	default:
+		return 0;
+	}
+
+	for (i = 0; i < addr_len; i += sizeof(uint32_t)) {
+		hash ^= UNALIGNED_GET((uint32_t *)(addr + i));
+	}
+
+	hash ^= proto;
+
+	if ((proto == IPPROTO_UDP || proto == IPPROTO_TCP) && hdr_len &&
+	    len >= hdr_len + 2 * sizeof(uint16_t)) {
+		/* Source and destination port */
+		hash ^= UNALIGNED_GET((uint32_t *)(hdr + hdr_len));
+	}
+
+	/* Fibonacci hashing, mixes the lower bits to the upper half */
+	return (hash * 0x9e3779b1) >> 16;
+}
+
+static enum net_verdict rx_flow_dispatch(struct net_buf *buf)
+{
+	int idx = rx_flow_hash(buf) % CONFIG_NET_RX_FLOW_QUEUE_COUNT;
+
+	NET_DBG("buf %p flow queue %d", buf, idx);
+
+	if (rx_queue_put(&rx_flow[idx].queue, &rx_flow[idx].pending,
+			 FLOW_RX_STATS(idx), buf) < 0) {
+		return NET_DROP;
+	}
+
+	return NET_OK;
+}
+#endif /* CONFIG_NET_RX_FLOW_HASH */
+
+/* If there is no data, then drop the packet. Also if
+ * the buffer is wrong type, then also drop the packet.
+ * The first buffer needs to have user data part that
+ * contains user data. The rest of the fragments should
+ * be data fragments without user data.
+ */
+static inline bool is_corrupted(struct net_buf *buf)
+{
 	if (!buf->frags || !buf->user_data_size) {
 		NET_DBG("Corrupted buffer (frags %p, data size %u)",
 			buf->frags, buf->user_data_size);
 		NET_STATS(++net_stats.processing_error);
 
-		return NET_DROP;
+		return true;
 	}
 
-	if (!is_loopback) {
-		ret = net_if_recv_data(net_nbuf_iface(buf), buf);
-		if (ret != NET_CONTINUE) {
-			if (ret == NET_DROP) {
-				NET_DBG("Buffer %p discarded by L2", buf);
-				NET_STATS(++net_stats.processing_error);
-			}
+	return false;
+}
 
-			return ret;
+static inline enum net_verdict process_l2(struct net_buf *buf)
+{
+	int ret;
+
+	if (net_if_has_offload(net_nbuf_iface(buf),
+			       NET_IF_OFFLOAD_RX_CHKSUM)) {
+		NET_STATS(++net_stats.offload.rx_chksum);
+	}
+
+	NET_PROFILE(NET_PROFILE_L2_RX,
+		    ret = net_if_recv_data(net_nbuf_iface(buf), buf));
+	if (ret != NET_CONTINUE) {
+		if (ret == NET_DROP) {
+			NET_DBG("Buffer %p discarded by L2", buf);
+			NET_STATS(++net_stats.processing_error);
 		}
+
+		return ret;
 	}
 
+	net_capture(NET_CAPTURE_RX, buf);
+
+#if defined(CONFIG_NET_RX_FLOW_HASH)
+	/* The IP packet is processed by one of the flow threads */
+	return rx_flow_dispatch(buf);
+#else
+	return NET_CONTINUE;
+#endif
+}
+
+static inline enum net_verdict process_ip_pkt(struct net_buf *buf)
+{
 	/* IP version and header length. */
 	switch (NET_IPV6_BUF(buf)->vtc & 0xf0) {
 #if defined(CONFIG_NET_IPV6)
 	case 0x60:
 		NET_STATS_IPV6(++net_stats.ipv6.recv);
 		net_nbuf_set_family(buf, PF_INET6);
-		return process_ipv6_pkt(buf);
+		return net_ipv6_process_pkt(buf);
 #endif
 #if defined(CONFIG_NET_IPV4)
 	case 0x40:
@@ -630,9 +892,40 @@ static inline enum net_verdict process_data(struct net_buf *buf,
 	return NET_DROP;
 }
 
-static void processing_data(struct net_buf *buf, bool is_loopback)
+static inline enum net_verdict process_ip(struct net_buf *buf)
+{
+	enum net_verdict verdict;
+
+	NET_PROFILE(NET_PROFILE_IP_RX, verdict = process_ip_pkt(buf));
+
+	if (verdict == NET_DROP) {
+		net_capture(NET_CAPTURE_DROP, buf);
+	}
+
+	return verdict;
+}
+
+static inline enum net_verdict process_data(struct net_buf *buf,
+					    bool is_loopback)
+{
+	if (is_corrupted(buf)) {
+		return NET_DROP;
+	}
+
+	if (!is_loopback) {
+		enum net_verdict ret = process_l2(buf);
+
+		if (ret != NET_CONTINUE) {
+			return ret;
+		}
+	}
+
+	return process_ip(buf);
+}
+
+static void processing_verdict(struct net_buf *buf, enum net_verdict verdict)
 {
-	switch (process_data(buf, is_loopback)) {
+	switch (verdict) {
 	case NET_OK:
 		NET_DBG("Consumed buf %p", buf);
 		break;
@@ -644,26 +937,76 @@ static void processing_data(struct net_buf *buf, bool is_loopback)
 	}
 }
 
-static void net_rx_thread(void)
+static void processing_data(struct net_buf *buf, bool is_loopback)
 {
-	struct net_buf *buf;
+	processing_verdict(buf, process_data(buf, is_loopback));
+}
 
-	NET_DBG("Starting RX thread (stack %zu bytes)", sizeof(rx_stack));
+/* Run L2 for the whole batch first and then the IP layer, so that the
+ * code and data of one layer stay in the cache while the packets pass
+ * through it. If skip_l2 is set, the L2 has already been done.
+ */
+static void processing_batch(struct net_buf **bufs, int count, bool skip_l2)
+{
+	enum net_verdict verdict;
+	int i;
 
-	/* Starting TX side. The ordering is important here and the TX
-	 * can only be started when RX side is ready to receive packets.
-	 */
-	net_if_init();
+	if (count == 1) {
+		processing_data(bufs[0], skip_l2);
+		return;
+	}
+
+	for (i = 0; i < count; i++) {
+		NET_DBG("Received buf %p len %zu", bufs[i],
+			net_buf_frags_len(bufs[i]));
+
+		if (is_corrupted(bufs[i])) {
+			verdict = NET_DROP;
+		} else if (skip_l2) {
+			continue;
+		} else {
+			verdict = process_l2(bufs[i]);
+		}
+
+		if (verdict != NET_CONTINUE) {
+			processing_verdict(bufs[i], verdict);
+			bufs[i] = NULL;
+		}
+	}
+
+	for (i = 0; i < count; i++) {
+		if (!bufs[i]) {
+			continue;
+		}
+
+#if CONFIG_NET_RX_BATCH_SIZE > 1
+		/* Only the headers of the next packet are prefetched, the
+		 * connection is still looked up for each packet.
+		 */
+		if (i + 1 < count && bufs[i + 1]) {
+			__builtin_prefetch(net_nbuf_ip_data(bufs[i + 1]));
+		}
+#endif
+
+		processing_verdict(bufs[i], process_ip(bufs[i]));
+	}
+}
+
+static void rx_thread_loop(struct k_fifo *queue, atomic_t *pending,
+			   unsigned char *stack, size_t stack_size,
+			   bool skip_l2)
+{
+	struct net_buf *bufs[CONFIG_NET_RX_BATCH_SIZE];
+	int count;
 
 	while (1) {
-		buf = net_buf_get_timeout(&rx_queue, 0, K_FOREVER);
+		count = rx_queue_get(queue, pending, bufs);
 
-		net_analyze_stack("RX thread", rx_stack, sizeof(rx_stack));
+		net_analyze_stack("RX thread", stack, stack_size);
 
-		NET_DBG("Received buf %p len %zu", buf,
-			net_buf_frags_len(buf));
+		NET_DBG("Received %d buf(s) from queue %p", count, queue);
 
-		processing_data(buf, false);
+		processing_batch(bufs, count, skip_l2);
 
 		net_print_statistics();
 		net_nbuf_print();
@@ -672,14 +1015,95 @@ static void net_rx_thread(void)
 	}
 }
 
+#if defined(CONFIG_NET_RX_FLOW_HASH)
+static void net_rx_flow_thread(int idx)
+{
+	NET_DBG("Starting RX flow thread %d (stack %zu bytes)", idx,
+		sizeof(rx_flow_stack[idx]));
+
+	/* L2 has already been processed by the RX thread so
+	 * only the IP part is left.
+	 */
+	rx_thread_loop(&rx_flow[idx].queue, &rx_flow[idx].pending,
+		       rx_flow_stack[idx], sizeof(rx_flow_stack[idx]), true);
+}
+
+static void init_rx_flow_queues(void)
+{
+	int i;
+
+	for (i = 0; i < CONFIG_NET_RX_FLOW_QUEUE_COUNT; i++) {
+		k_fifo_init(&rx_flow[i].queue);
+
+		k_thread_spawn(rx_flow_stack[i], sizeof(rx_flow_stack[i]),
+			       (k_thread_entry_t)net_rx_flow_thread,
+			       INT_TO_POINTER(i), NULL, NULL,
+			       K_PRIO_COOP(CONFIG_NET_RX_THREAD_PRIO), 0, 0);
+	}
+}
+#else
+#define init_rx_flow_queues()
+#endif /* CONFIG_NET_RX_FLOW_HASH */
+
+#if defined(CONFIG_NET_RX_QUEUE_PER_IFACE)
+static void net_if_rx_thread(struct net_if *iface)
+{
+	NET_DBG("Starting RX thread (stack %zu bytes) for iface %p",
+		sizeof(iface->rx_stack), iface);
+
+	rx_thread_loop(&iface->rx_queue, &iface->rx_pending, iface->rx_stack,
+		       sizeof(iface->rx_stack), false);
+}
+
+static void init_iface_rx_queue(struct net_if *iface, void *user_data)
+{
+	k_fifo_init(&iface->rx_queue);
+
+	iface->rx_tid = k_thread_spawn(iface->rx_stack,
+				       sizeof(iface->rx_stack),
+				       (k_thread_entry_t)net_if_rx_thread,
+				       iface, NULL, NULL,
+				       K_PRIO_COOP(CONFIG_NET_RX_THREAD_PRIO),
+				       0, 0);
+}
+
 static void init_rx_queue(void)
 {
+	init_rx_flow_queues();
+
+	net_if_foreach(init_iface_rx_queue, NULL);
+
+	/* Starting TX side. The ordering is important here and the TX
+	 * can only be started when RX side is ready to receive packets.
+	 */
+	net_if_init();
+}
+#else
+static void net_rx_thread(void)
+{
+	NET_DBG("Starting RX thread (stack %zu bytes)", sizeof(rx_stack));
+
+	/* Starting TX side. The ordering is important here and the TX
+	 * can only be started when RX side is ready to receive packets.
+	 */
+	net_if_init();
+
+	rx_thread_loop(&rx_queue, &rx_queue_pending, rx_stack,
+		       sizeof(rx_stack), false);
+}
+
+static void init_rx_queue(void)
+{
+	init_rx_flow_queues();
+
 	k_fifo_init(&rx_queue);
 
 	rx_tid = k_thread_spawn(rx_stack, sizeof(rx_stack),
 				(k_thread_entry_t)net_rx_thread,
-				NULL, NULL, NULL, K_PRIO_COOP(8), 0, 0);
+				NULL, NULL, NULL,
+				K_PRIO_COOP(CONFIG_NET_RX_THREAD_PRIO), 0, 0);
 }
+#endif /* CONFIG_NET_RX_QUEUE_PER_IFACE */
 
 #if defined(CONFIG_NET_IP_ADDR_CHECK)
 /* Check if the IPv{4|6} addresses are proper. As this can be expensive,
@@ -761,6 +1185,43 @@ static inline int check_ip_addr(struct net_buf *buf)
 #define check_ip_addr(buf) 0
 #endif
 
+/* Packets that have no priority set by the context get it from the
+ * class selector bits of the IP header, so forwarded packets keep their
+ * class. Control messages of the stack are sent before other traffic.
+ */
+static inline void set_tx_priority(struct net_buf *buf)
+{
+	uint8_t priority = NET_PRIORITY_BE;
+
+	if (net_nbuf_priority(buf) != NET_PRIORITY_BE) {
+		return;
+	}
+
+#if defined(CONFIG_NET_IPV6)
+	if (net_nbuf_family(buf) == AF_INET6) {
+		priority = (NET_IPV6_BUF(buf)->vtc & 0x0f) >> 1;
+
+		if (priority == NET_PRIORITY_BE &&
+		    NET_IPV6_BUF(buf)->nexthdr == IPPROTO_ICMPV6) {
+			priority = NET_PRIORITY_IC;
+		}
+	}
+#endif
+
+#if defined(CONFIG_NET_IPV4)
+	if (net_nbuf_family(buf) == AF_INET) {
+		priority = NET_IPV4_BUF(buf)->tos >> 5;
+
+		if (priority == NET_PRIORITY_BE &&
+		    NET_IPV4_BUF(buf)->proto == IPPROTO_ICMP) {
+			priority = NET_PRIORITY_IC;
+		}
+	}
+#endif
+
+	net_nbuf_set_priority(buf, priority);
+}
+
 /* Called when data needs to be sent to network */
 int net_send_data(struct net_buf *buf)
 {
@@ -796,6 +1257,23 @@ int net_send_data(struct net_buf *buf)
 		return 0;
 	}
 
+	set_tx_priority(buf);
+
+#if defined(CONFIG_NET_IPV6_FRAGMENT)
+	if (net_nbuf_family(buf) == AF_INET6) {
+		/* Links that have smaller MTU than the IPv6 minimum MTU
+		 * fragment the packets themselves (RFC 2460 ch 5).
+		 */
+		uint16_t mtu = max(net_if_get_mtu(net_nbuf_iface(buf)),
+				   NET_IPV6_MTU);
+
+		if (net_buf_frags_len(buf->frags) > mtu) {
+			return net_ipv6_send_fragmented_pkt(net_nbuf_iface(buf),
+							    buf, mtu);
+		}
+	}
+#endif
+
 	if (net_if_send_data(net_nbuf_iface(buf), buf) == NET_DROP) {
 		return -EIO;
 	}
@@ -803,6 +1281,25 @@ int net_send_data(struct net_buf *buf)
 	return 0;
 }
 
+static int recv_data_list(struct net_if *iface, struct net_buf **bufs,
+			  int count)
+{
+#if defined(CONFIG_NET_RX_QUEUE_PER_IFACE)
+	return rx_queue_put_list(&iface->rx_queue, &iface->rx_pending,
+				 IFACE_RX_STATS(iface), bufs, count);
+#else
+	int queued;
+
+	queued = rx_queue_put_list(&rx_queue, &rx_queue_pending,
+				   GLOBAL_RX_STATS(), bufs, count);
+	if (queued) {
+		k_wakeup(rx_tid);
+	}
+
+	return queued;
+#endif
+}
+
 /* Called by driver when an IP packet has been received */
 int net_recv_data(struct net_if *iface, struct net_buf *buf)
 {
@@ -810,18 +1307,45 @@ int net_recv_data(struct net_if *iface, struct net_buf *buf)
 		return -ENODATA;
 	}
 
-	NET_DBG("fifo %p iface %p buf %p len %zu", &rx_queue, iface, buf,
+	NET_DBG("iface %p buf %p len %zu", iface, buf,
 		net_buf_frags_len(buf));
 
 	net_nbuf_set_iface(buf, iface);
 
-	net_buf_put(&rx_queue, buf);
+	if (!net_nbuf_charge_iface(buf, iface)) {
+		return -ENOBUFS;
+	}
 
-	k_wakeup(rx_tid);
+	if (!recv_data_list(iface, &buf, 1)) {
+		return -ENOBUFS;
+	}
 
 	return 0;
 }
 
+/* Called by driver when several IP packets have been received */
+int net_recv_data_list(struct net_if *iface, struct net_buf **bufs, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		if (!bufs[i]->frags ||
+		    !net_nbuf_charge_iface(bufs[i], iface)) {
+			break;
+		}
+
+		net_nbuf_set_iface(bufs[i], iface);
+	}
+
+	NET_DBG("iface %p %d/%d buf(s)", iface, i, count);
+
+	if (!i) {
+		return 0;
+	}
+
+	return recv_data_list(iface, bufs, i);
+}
+
 static inline void l3_init(void)
 {
 	net_icmpv6_init();
@@ -30,6 +30,8 @@
 #include <net/net_mgmt.h>
 
 #include "net_private.h"
+#include "net_capture.h"
+#include "net_profile.h"
 #include "ipv6.h"
 #include "rpl.h"
 
@@ -47,6 +49,31 @@ static struct net_if_router routers[CONFIG_NET_MAX_ROUTERS];
  */
 static sys_slist_t link_callbacks;
 
+/* Recommended priority to traffic class mapping of IEEE 802.1Q
+ * (Table 8-5) for the configured number of traffic classes.
+ */
+static const uint8_t priority2tc[NET_MAX_PRIORITIES] = {
+#if NET_TC_TX_COUNT == 1
+	0, 0, 0, 0, 0, 0, 0, 0
+#elif NET_TC_TX_COUNT == 2
+	0, 0, 0, 0, 1, 1, 1, 1
+#elif NET_TC_TX_COUNT == 3
+	0, 0, 0, 0, 1, 1, 2, 2
+#elif NET_TC_TX_COUNT == 4
+	0, 0, 1, 1, 2, 2, 3, 3
+#elif NET_TC_TX_COUNT == 5
+	0, 0, 1, 1, 2, 2, 3, 4
+#elif NET_TC_TX_COUNT == 6
+	1, 0, 2, 2, 3, 3, 4, 5
+#elif NET_TC_TX_COUNT == 7
+	1, 0, 2, 3, 4, 4, 5, 6
+#elif NET_TC_TX_COUNT == 8
+	1, 0, 2, 3, 4, 5, 6, 7
+#else
+#error "Unsupported number of TX traffic classes"
+#endif
+};
+
 #if NET_DEBUG
 #define debug_check_packet(buf)						    \
 	{								    \
@@ -61,6 +88,45 @@ static sys_slist_t link_callbacks;
 #define debug_check_packet(...)
 #endif
 
+uint8_t net_tx_priority2tc(uint8_t priority)
+{
+	if (priority >= NET_MAX_PRIORITIES) {
+		priority = NET_PRIORITY_BE;
+	}
+
+	return priority2tc[priority];
+}
+
+static struct net_buf *tx_queue_get(struct net_if *iface)
+{
+	struct net_buf *buf;
+	int tc = 0;
+
+#if NET_TC_TX_COUNT > 1
+	k_sem_take(&iface->tx_sem, K_FOREVER);
+
+	/* Strict priority, the semaphore count guarantees that one of
+	 * the queues has a packet.
+	 */
+	for (tc = NET_TC_TX_COUNT - 1; tc > 0; tc--) {
+		buf = net_buf_get_timeout(&iface->tx_queue[tc], 0, K_NO_WAIT);
+		if (buf) {
+			break;
+		}
+	}
+
+	if (!tc) {
+		buf = net_buf_get_timeout(&iface->tx_queue[0], 0, K_NO_WAIT);
+	}
+#else
+	buf = net_buf_get_timeout(&iface->tx_queue[0], 0, K_FOREVER);
+#endif
+
+	atomic_dec(&iface->tx_pending[tc]);
+
+	return buf;
+}
+
 static void net_if_tx_thread(struct net_if *iface)
 {
 	struct net_if_api *api = (struct net_if_api *)iface->dev->driver_api;
@@ -80,7 +146,7 @@ static void net_if_tx_thread(struct net_if *iface)
 		int status;
 
 		/* Get next packet from application - wait if necessary */
-		buf = net_buf_get_timeout(&iface->tx_queue, 0, K_FOREVER);
+		buf = tx_queue_get(iface);
 
 		debug_check_packet(buf);
 
@@ -88,7 +154,7 @@ static void net_if_tx_thread(struct net_if *iface)
 		context = net_nbuf_context(buf);
 		context_token = net_nbuf_token(buf);
 
-		status = api->send(iface, buf);
+		NET_PROFILE(NET_PROFILE_DEV_TX, status = api->send(iface, buf));
 		if (status < 0) {
 			net_nbuf_unref(buf);
 		}
@@ -112,15 +178,75 @@ static void net_if_tx_thread(struct net_if *iface)
 
 static inline void init_tx_queue(struct net_if *iface)
 {
+	int i;
+
 	NET_DBG("On iface %p", iface);
 
-	k_fifo_init(&iface->tx_queue);
+	for (i = 0; i < NET_TC_TX_COUNT; i++) {
+		k_fifo_init(&iface->tx_queue[i]);
+	}
+
+#if NET_TC_TX_COUNT > 1
+	k_sem_init(&iface->tx_sem, 0, UINT_MAX);
+#endif
 
 	k_thread_spawn(iface->tx_stack, sizeof(iface->tx_stack),
 		       (k_thread_entry_t)net_if_tx_thread,
 		       iface, NULL, NULL, K_PRIO_COOP(7), 0, 0);
 }
 
+#if defined(CONFIG_NET_RX_QUEUE_PER_IFACE)
+void net_if_set_rx_prio(struct net_if *iface, int prio)
+{
+	NET_ASSERT(iface->rx_tid);
+
+	NET_DBG("iface %p RX thread priority %d", iface, prio);
+
+	k_thread_priority_set(iface->rx_tid, prio);
+}
+#endif
+
+void net_if_queue_tx(struct net_if *iface, struct net_buf *buf)
+{
+	uint8_t tc = net_tx_priority2tc(net_nbuf_priority(buf));
+	atomic_val_t depth = atomic_inc(&iface->tx_pending[tc]) + 1;
+
+	if (CONFIG_NET_TC_TX_QUEUE_MAX_DEPTH &&
+	    depth > CONFIG_NET_TC_TX_QUEUE_MAX_DEPTH) {
+		struct net_context *context = net_nbuf_context(buf);
+
+		atomic_dec(&iface->tx_pending[tc]);
+
+		NET_DBG("TX queue %d of iface %p full, dropping buf %p",
+			tc, iface, buf);
+		NET_STATS(iface->tx_stats[tc].drop++);
+
+		if (context) {
+			net_context_send_cb(context, net_nbuf_token(buf),
+					    -ENOBUFS);
+		}
+
+		net_if_call_link_cb(iface, net_nbuf_ll_dst(buf), -ENOBUFS);
+
+		net_nbuf_unref(buf);
+		return;
+	}
+
+#if defined(CONFIG_NET_STATISTICS)
+	iface->tx_stats[tc].queued++;
+
+	if (depth > iface->tx_stats[tc].max_depth) {
+		iface->tx_stats[tc].max_depth = depth;
+	}
+#endif
+
+	net_buf_put(&iface->tx_queue[tc], buf);
+
+#if NET_TC_TX_COUNT > 1
+	k_sem_give(&iface->tx_sem);
+#endif
+}
+
 enum net_verdict net_if_send_data(struct net_if *iface, struct net_buf *buf)
 {
 	struct net_context *context = net_nbuf_context(buf);
@@ -128,7 +254,9 @@ enum net_verdict net_if_send_data(struct net_if *iface, struct net_buf *buf)
 	void *token = net_nbuf_token(buf);
 	enum net_verdict verdict;
 
-	verdict = iface->l2->send(iface, buf);
+	net_capture(NET_CAPTURE_TX, buf);
+
+	NET_PROFILE(NET_PROFILE_L2_TX, verdict = iface->l2->send(iface, buf));
 
 	/* The L2 send() function can return
 	 *   NET_OK in which case packet was sent successfully.
@@ -1315,8 +1443,19 @@ void net_if_init(void)
 	NET_DBG("");
 
 	for (iface = __net_if_start; iface != __net_if_end; iface++) {
+		const struct net_if_api *api = iface->dev->driver_api;
+
+		/* Set before the TX thread calls the driver init function
+		 * so that the driver can still turn features off.
+		 */
+		iface->offload = api->offload;
+
 		init_tx_queue(iface);
 
+#if defined(CONFIG_NET_NBUF_QUOTA)
+		iface->nbuf_quota.limit = CONFIG_NET_NBUF_IFACE_QUOTA;
+#endif
+
 #if defined(CONFIG_NET_IPV4)
 		iface->ttl = CONFIG_NET_INITIAL_TTL;
 #endif
@@ -27,22 +27,25 @@
 #include <misc/slist.h>
 #include <net/net_mgmt.h>
 
-struct mgmt_event_entry {
-	uint32_t event;
-	struct net_if *iface;
-};
-
 static struct k_sem network_event;
 NET_STACK_DEFINE(MGMT, mgmt_stack, CONFIG_NET_MGMT_EVENT_STACK_SIZE,
 		 CONFIG_NET_MGMT_EVENT_STACK_SIZE);
-static struct mgmt_event_entry events[CONFIG_NET_MGMT_EVENT_QUEUE_SIZE];
+static struct net_mgmt_event_entry events[CONFIG_NET_MGMT_EVENT_QUEUE_SIZE];
 static uint32_t global_event_mask;
+static uint32_t queue_event_mask;
 static sys_slist_t event_callbacks;
+static sys_slist_t event_queues;
 static uint16_t in_event;
 static uint16_t out_event;
+static uint16_t event_count;
 
+/* The events can be notified from any thread and from interrupts, so the
+ * queues are only touched with the interrupts locked.
+ */
 static inline void mgmt_push_event(uint32_t mgmt_event, struct net_if *iface)
 {
+	unsigned int key = irq_lock();
+
 	events[in_event].event = mgmt_event;
 	events[in_event].iface = iface;
 
@@ -52,41 +55,46 @@ static inline void mgmt_push_event(uint32_t mgmt_event, struct net_if *iface)
 		in_event = 0;
 	}
 
-	if (in_event == out_event) {
-		uint16_t o_idx = out_event + 1;
-
-		if (o_idx == CONFIG_NET_MGMT_EVENT_QUEUE_SIZE) {
-			o_idx = 0;
-		}
-
-		if (events[o_idx].event) {
-			out_event = o_idx;
-		}
+	if (event_count == CONFIG_NET_MGMT_EVENT_QUEUE_SIZE) {
+		/* The oldest event was overwritten */
+		out_event = in_event;
+	} else {
+		event_count++;
 	}
+
+	irq_unlock(key);
 }
 
-static inline struct mgmt_event_entry *mgmt_pop_event(void)
+static inline bool mgmt_pop_event(struct net_mgmt_event_entry *mgmt_event)
 {
-	uint16_t o_idx;
+	unsigned int key = irq_lock();
 
-	if (!events[out_event].event) {
-		return NULL;
+	if (!event_count) {
+		irq_unlock(key);
+		return false;
 	}
 
-	o_idx = out_event;
+	/* The event is copied, so that a new one can take its place while
+	 * the callbacks are run.
+	 */
+	*mgmt_event = events[out_event];
+
 	out_event++;
 
 	if (out_event == CONFIG_NET_MGMT_EVENT_QUEUE_SIZE) {
 		out_event = 0;
 	}
 
-	return &events[o_idx];
+	event_count--;
+
+	irq_unlock(key);
+
+	return true;
 }
 
-static inline void mgmt_clean_event(struct mgmt_event_entry *mgmt_event)
+static inline bool mgmt_event_match(uint32_t mgmt_event, uint32_t event_mask)
 {
-	mgmt_event->event = 0;
-	mgmt_event->iface = NULL;
+	return ((mgmt_event & event_mask) == mgmt_event);
 }
 
 static inline void mgmt_add_event_mask(uint32_t event_mask)
@@ -108,12 +116,26 @@ static inline void mgmt_rebuild_global_event_mask(void)
 	}
 }
 
+static inline void mgmt_rebuild_queue_event_mask(void)
+{
+	sys_snode_t *sn;
+
+	queue_event_mask = 0;
+
+	SYS_SLIST_FOR_EACH_NODE(&event_queues, sn) {
+		struct net_mgmt_event_queue *queue =
+			CONTAINER_OF(sn, struct net_mgmt_event_queue, node);
+
+		queue_event_mask |= queue->event_mask;
+	}
+}
+
 static inline bool mgmt_is_event_handled(uint32_t mgmt_event)
 {
-	return ((mgmt_event & global_event_mask) == mgmt_event);
+	return mgmt_event_match(mgmt_event, global_event_mask);
 }
 
-static inline void mgmt_run_callbacks(struct mgmt_event_entry *mgmt_event)
+static inline void mgmt_run_callbacks(struct net_mgmt_event_entry *mgmt_event)
 {
 	sys_snode_t *sn, *sns;
 
@@ -125,7 +147,7 @@ static inline void mgmt_run_callbacks(struct mgmt_event_entry *mgmt_event)
 
 		NET_DBG("Running callback %p : %p", cb, cb->handler);
 
-		if ((mgmt_event->event & cb->event_mask) == mgmt_event->event) {
+		if (mgmt_event_match(mgmt_event->event, cb->event_mask)) {
 			cb->handler(cb, mgmt_event->event, mgmt_event->iface);
 		}
 
@@ -137,32 +159,70 @@ static inline void mgmt_run_callbacks(struct mgmt_event_entry *mgmt_event)
 	}
 }
 
+/* Every queue gets its own copy of the event. A full queue loses its
+ * oldest event, the other queues are not affected.
+ *
+ * net_mgmt_event_wait() removes its queue, which lives on the stack of
+ * the waiter, as soon as it returns. So interrupts stay locked over the
+ * whole walk, and the scheduler is locked too, so that waking up a
+ * waiter does not switch to it in the middle of the walk.
+ */
+static inline void mgmt_queue_events(uint32_t mgmt_event, struct net_if *iface)
+{
+	bool in_isr = k_is_in_isr();
+	sys_snode_t *sn;
+	unsigned int key;
+
+	if (!in_isr) {
+		k_sched_lock();
+	}
+
+	key = irq_lock();
+
+	SYS_SLIST_FOR_EACH_NODE(&event_queues, sn) {
+		struct net_mgmt_event_queue *queue =
+			CONTAINER_OF(sn, struct net_mgmt_event_queue, node);
+		struct net_mgmt_event_entry *entry;
+
+		if (!mgmt_event_match(mgmt_event, queue->event_mask)) {
+			continue;
+		}
+
+		if (queue->count == queue->size) {
+			queue->head = (queue->head + 1) % queue->size;
+			queue->overflows++;
+		} else {
+			queue->count++;
+			k_sem_give(&queue->sem);
+		}
+
+		entry = &queue->events[(queue->head + queue->count - 1) %
+				       queue->size];
+		entry->event = mgmt_event;
+		entry->iface = iface;
+	}
+
+	irq_unlock(key);
+
+	if (!in_isr) {
+		k_sched_unlock();
+	}
+}
+
 static void mgmt_thread(void)
 {
-	struct mgmt_event_entry *mgmt_event;
+	struct net_mgmt_event_entry mgmt_event;
 
 	while (1) {
 		k_sem_take(&network_event, K_FOREVER);
 
 		NET_DBG("Handling events, forwarding it relevantly");
 
-		mgmt_event = mgmt_pop_event();
-		if (!mgmt_event) {
-			/* System is over-loaded?
-			 * At this point we have most probably notified
-			 * more events than we could handle
-			 */
-			NET_DBG("Some event got probably lost (%u)",
-				k_sem_count_get(&network_event));
-
-			k_sem_init(&network_event, 0, UINT_MAX);
-
+		if (!mgmt_pop_event(&mgmt_event)) {
 			continue;
 		}
 
-		mgmt_run_callbacks(mgmt_event);
-
-		mgmt_clean_event(mgmt_event);
+		mgmt_run_callbacks(&mgmt_event);
 
 		k_yield();
 	}
@@ -186,8 +246,94 @@ void net_mgmt_del_event_callback(struct net_mgmt_event_callback *cb)
 	mgmt_rebuild_global_event_mask();
 }
 
+void net_mgmt_add_event_queue(struct net_mgmt_event_queue *queue)
+{
+	unsigned int key;
+
+	NET_DBG("Adding event queue %p", queue);
+
+	key = irq_lock();
+
+	sys_slist_prepend(&event_queues, &queue->node);
+	queue_event_mask |= queue->event_mask;
+
+	irq_unlock(key);
+}
+
+void net_mgmt_del_event_queue(struct net_mgmt_event_queue *queue)
+{
+	unsigned int key;
+
+	NET_DBG("Deleting event queue %p", queue);
+
+	key = irq_lock();
+
+	sys_slist_find_and_remove(&event_queues, &queue->node);
+	mgmt_rebuild_queue_event_mask();
+
+	irq_unlock(key);
+}
+
+int net_mgmt_event_queue_get(struct net_mgmt_event_queue *queue,
+			     uint32_t *mgmt_event, struct net_if **iface,
+			     int32_t timeout)
+{
+	struct net_mgmt_event_entry *entry;
+	unsigned int key;
+	int ret;
+
+	ret = k_sem_take(&queue->sem, timeout);
+	if (ret) {
+		return ret;
+	}
+
+	key = irq_lock();
+
+	entry = &queue->events[queue->head];
+
+	if (mgmt_event) {
+		*mgmt_event = entry->event;
+	}
+
+	if (iface) {
+		*iface = entry->iface;
+	}
+
+	queue->head = (queue->head + 1) % queue->size;
+	queue->count--;
+
+	irq_unlock(key);
+
+	return 0;
+}
+
+int net_mgmt_event_wait(uint32_t mgmt_event_mask, uint32_t *mgmt_event,
+			struct net_if **iface, int32_t timeout)
+{
+	struct net_mgmt_event_queue queue;
+	struct net_mgmt_event_entry entry;
+	int ret;
+
+	net_mgmt_init_event_queue(&queue, &entry, 1, mgmt_event_mask);
+
+	net_mgmt_add_event_queue(&queue);
+
+	ret = net_mgmt_event_queue_get(&queue, mgmt_event, iface, timeout);
+
+	net_mgmt_del_event_queue(&queue);
+
+	return ret;
+}
+
 void net_mgmt_event_notify(uint32_t mgmt_event, struct net_if *iface)
 {
+	/* Events nobody is interested in are dropped right away */
+	if (mgmt_event_match(mgmt_event, queue_event_mask)) {
+		NET_DBG("Queueing event 0x%08X", mgmt_event);
+
+		mgmt_queue_events(mgmt_event, iface);
+	}
+
 	if (mgmt_is_event_handled(mgmt_event)) {
 		NET_DBG("Notifying event 0x%08X", mgmt_event);
 
@@ -199,16 +345,22 @@ void net_mgmt_event_notify(uint32_t mgmt_event, struct net_if *iface)
 void net_mgmt_event_init(void)
 {
 	sys_slist_init(&event_callbacks);
+	sys_slist_init(&event_queues);
 	global_event_mask = 0;
+	queue_event_mask = 0;
 
 	in_event = 0;
 	out_event = 0;
+	event_count = 0;
 
-	k_sem_init(&network_event, 0, UINT_MAX);
+	/* The semaphore counts the events in the queue, an overwritten
+	 * event is not counted twice.
+	 */
+	k_sem_init(&network_event, 0, CONFIG_NET_MGMT_EVENT_QUEUE_SIZE);
 
 	memset(events, 0,
 	       CONFIG_NET_MGMT_EVENT_QUEUE_SIZE *
-	       sizeof(struct mgmt_event_entry));
+	       sizeof(struct net_mgmt_event_entry));
 
 	k_thread_spawn(mgmt_stack, sizeof(mgmt_stack),
 		       (k_thread_entry_t)mgmt_thread, NULL, NULL, NULL,
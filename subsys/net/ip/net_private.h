@@ -23,6 +23,8 @@
 #include <errno.h>
 #include <stdio.h>
 #include <net/net_context.h>
+#include <net/net_if.h>
+#include <net/net_stats.h>
 #include <net/nbuf.h>
 
 extern void net_nbuf_init(void);
@@ -41,26 +43,116 @@ extern uint16_t net_calc_chksum(struct net_buf *buf, uint8_t proto);
 extern uint16_t net_calc_chksum_ipv4(struct net_buf *buf);
 #endif /* CONFIG_NET_IPV4 */
 
+/* Charge the buffers of a packet to the quota of an interface or a
+ * context. The buffers are moved from their previous owner. If false
+ * is returned, the owners are not changed and the packet should be
+ * dropped.
+ */
+#if defined(CONFIG_NET_NBUF_QUOTA)
+extern bool net_nbuf_charge_iface(struct net_buf *buf, struct net_if *iface);
+extern bool net_nbuf_charge_context(struct net_buf *buf,
+				    struct net_context *context);
+#else
+static inline bool net_nbuf_charge_iface(struct net_buf *buf,
+					 struct net_if *iface)
+{
+	return true;
+}
+
+static inline bool net_nbuf_charge_context(struct net_buf *buf,
+					   struct net_context *context)
+{
+	return true;
+}
+#endif /* CONFIG_NET_NBUF_QUOTA */
+
+/* Check if the checksum of an outgoing packet is calculated by the
+ * network device. The device expects the checksum field to be zero.
+ */
+static inline bool net_nbuf_chksum_offloaded(struct net_buf *buf,
+					     uint16_t offload)
+{
+	struct net_if *iface = net_nbuf_iface(buf);
+
+	if (iface && net_if_has_offload(iface, offload)) {
+		NET_STATS(++net_stats.offload.tx_chksum);
+		return true;
+	}
+
+	NET_STATS(++net_stats.offload.tx_sw_chksum);
+
+	return false;
+}
+
+/* The helpers below are used when sending. The callers store the one's
+ * complement of the returned value, so returning 0xffff for offloaded
+ * checksums leaves a zeroed checksum field for the device to fill in.
+ */
 static inline uint16_t net_calc_chksum_icmpv6(struct net_buf *buf)
 {
+	if (net_nbuf_chksum_offloaded(buf, NET_IF_OFFLOAD_TX_CHKSUM_ICMP)) {
+		return 0xffff;
+	}
+
 	return net_calc_chksum(buf, IPPROTO_ICMPV6);
 }
 
 static inline uint16_t net_calc_chksum_icmpv4(struct net_buf *buf)
 {
+	if (net_nbuf_chksum_offloaded(buf, NET_IF_OFFLOAD_TX_CHKSUM_ICMP)) {
+		return 0xffff;
+	}
+
 	return net_calc_chksum(buf, IPPROTO_ICMP);
 }
 
 static inline uint16_t net_calc_chksum_udp(struct net_buf *buf)
 {
+	if (net_nbuf_chksum_offloaded(buf, NET_IF_OFFLOAD_TX_CHKSUM_UDP)) {
+		return 0xffff;
+	}
+
 	return net_calc_chksum(buf, IPPROTO_UDP);
 }
 
 static inline uint16_t net_calc_chksum_tcp(struct net_buf *buf)
 {
+	if (net_nbuf_chksum_offloaded(buf, NET_IF_OFFLOAD_TX_CHKSUM_TCP)) {
+		return 0xffff;
+	}
+
 	return net_calc_chksum(buf, IPPROTO_TCP);
 }
 
+/* Update a checksum when a 16-bit word it covers is changed from old_val
+ * to new_val, without summing the packet again (RFC 1624 eqn. 3).
+ * All the values must use the same byte order.
+ */
+static inline uint16_t net_calc_chksum_update16(uint16_t chksum,
+						uint16_t old_val,
+						uint16_t new_val)
+{
+	uint32_t sum;
+
+	sum = (uint16_t)~chksum + (uint16_t)~old_val + new_val;
+	sum = (sum & 0xffff) + (sum >> 16);
+	sum = (sum & 0xffff) + (sum >> 16);
+
+	return ~sum;
+}
+
+/* Same as above but for a 16-bit aligned 32-bit field (TCP seq/ack) */
+static inline uint16_t net_calc_chksum_update32(uint16_t chksum,
+						uint32_t old_val,
+						uint32_t new_val)
+{
+	chksum = net_calc_chksum_update16(chksum, old_val >> 16,
+					  new_val >> 16);
+
+	return net_calc_chksum_update16(chksum, old_val & 0xffff,
+					new_val & 0xffff);
+}
+
 #if NET_DEBUG > 0
 static inline char *net_sprint_ll_addr(const uint8_t *ll, uint8_t ll_len)
 {
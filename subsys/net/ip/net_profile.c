@@ -0,0 +1,82 @@
+/** @file
+ * @brief Per layer cycle counters
+ */
+
+/*
+ * Copyright (c) 2016 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <kernel.h>
+#include <string.h>
+
+#include "net_profile.h"
+
+static struct net_profile profile[NET_PROFILE_COUNT];
+
+static const char * const names[NET_PROFILE_COUNT] = {
+	[NET_PROFILE_L2_RX] = "l2_rx",
+	[NET_PROFILE_IP_RX] = "ip_rx",
+	[NET_PROFILE_CONN_RX] = "conn_rx",
+	[NET_PROFILE_APP_RX] = "app_rx",
+	[NET_PROFILE_CONTEXT_TX] = "context_tx",
+	[NET_PROFILE_L2_TX] = "l2_tx",
+	[NET_PROFILE_DEV_TX] = "dev_tx",
+	[NET_PROFILE_RPL_RX] = "rpl_rx",
+};
+
+void net_profile_add(enum net_profile_point point, uint32_t start)
+{
+	uint32_t cycles = k_cycle_get_32() - start;
+	unsigned int key;
+
+	/* The RX, TX and application threads update the same counters */
+	key = irq_lock();
+
+	profile[point].count++;
+	profile[point].cycles += cycles;
+
+	if (cycles > profile[point].max) {
+		profile[point].max = cycles;
+	}
+
+	irq_unlock(key);
+}
+
+void net_profile_get(enum net_profile_point point, struct net_profile *prof)
+{
+	unsigned int key;
+
+	key = irq_lock();
+	*prof = profile[point];
+	irq_unlock(key);
+}
+
+void net_profile_reset(void)
+{
+	unsigned int key;
+
+	key = irq_lock();
+	memset(profile, 0, sizeof(profile));
+	irq_unlock(key);
+}
+
+const char *net_profile_name(enum net_profile_point point)
+{
+	if (point >= NET_PROFILE_COUNT) {
+		return "?";
+	}
+
+	return names[point];
+}
@@ -0,0 +1,120 @@
+/** @file
+ * @brief Per layer cycle counters
+ *
+ * This is not to be included by the application.
+ */
+
+/*
+ * Copyright (c) 2016 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __NET_PROFILE_H
+#define __NET_PROFILE_H
+
+#include <stdint.h>
+#include <kernel.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Measured parts of the stack. Each includes the parts it calls. */
+enum net_profile_point {
+	/** L2 receive, net_if_recv_data() */
+	NET_PROFILE_L2_RX,
+
+	/** IP receive and everything above it */
+	NET_PROFILE_IP_RX,
+
+	/** UDP and TCP connection lookup and handlers */
+	NET_PROFILE_CONN_RX,
+
+	/** Receive callbacks of the applications */
+	NET_PROFILE_APP_RX,
+
+	/** net_context_send() and net_context_sendto() */
+	NET_PROFILE_CONTEXT_TX,
+
+	/** L2 send, which usually just queues the packet */
+	NET_PROFILE_L2_TX,
+
+	/** Device driver send, called from the TX thread */
+	NET_PROFILE_DEV_TX,
+
+	/** RPL control messages, DIS, DIO, DAO and DAO-ACK */
+	NET_PROFILE_RPL_RX,
+
+	NET_PROFILE_COUNT
+};
+
+/** Counters of one measured point */
+struct net_profile {
+	/** Number of times the point was passed */
+	uint32_t count;
+
+	/** Longest single pass in cycles */
+	uint32_t max;
+
+	/** Total cycles */
+	uint64_t cycles;
+};
+
+#if defined(CONFIG_NET_PROFILE)
+void net_profile_add(enum net_profile_point point, uint32_t start);
+
+/**
+ * @brief Measure the cycles spent in a statement.
+ *
+ * @param point Which counters are updated
+ * @param ... The statement, like "ret = l2->recv(iface, buf)"
+ */
+#define NET_PROFILE(point, ...)					\
+	do {							\
+		uint32_t _prof_start = k_cycle_get_32();	\
+								\
+		__VA_ARGS__;					\
+		net_profile_add(point, _prof_start);		\
+	} while (0)
+
+/**
+ * @brief Get the counters of a point.
+ *
+ * @param point Measured point
+ * @param prof Counters are returned here
+ */
+void net_profile_get(enum net_profile_point point, struct net_profile *prof);
+
+/**
+ * @brief Clear all the counters.
+ */
+void net_profile_reset(void);
+
+/**
+ * @brief Get the name of a point, like "l2_rx".
+ *
+ * @param point Measured point
+ *
+ * @return Name of the point.
+ */
+const char *net_profile_name(enum net_profile_point point);
+#else
+#define NET_PROFILE(point, ...) __VA_ARGS__
+#endif /* CONFIG_NET_PROFILE */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __NET_PROFILE_H */
@@ -22,6 +22,8 @@
 
 #include <zephyr.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <misc/shell.h>
 
 #include <net/net_stats.h>
@@ -29,6 +31,7 @@
 
 #include "route.h"
 #include "icmpv6.h"
+#include "ipv6.h"
 #include "icmpv4.h"
 
 #if defined(CONFIG_NET_TCP)
@@ -36,6 +39,12 @@
 #endif
 
 #include "net_shell.h"
+#include "net_capture.h"
+#include "net_profile.h"
+
+#if defined(CONFIG_UART_PIPE)
+#include <drivers/console/uart_pipe.h>
+#endif
 
 /*
  * Set NET_DEBUG in order to activate address printing functions
@@ -94,6 +103,8 @@ static inline const char *dhcpv4state2str(enum net_dhcpv4_state state)
 		return "offer";
 	case NET_DHCPV4_REQUEST:
 		return "request";
+	case NET_DHCPV4_REBOOTING:
+		return "rebooting";
 	case NET_DHCPV4_RENEWAL:
 		return "renewal";
 	case NET_DHCPV4_ACK:
@@ -140,6 +151,27 @@ static void iface_cb(struct net_if *iface, void *user_data)
 	printf("Link addr : %s\n", net_sprint_ll_addr(iface->link_addr.addr,
 						      iface->link_addr.len));
 	printf("MTU       : %d\n", iface->mtu);
+	printf("Offload   : 0x%04x\n", iface->offload);
+
+#if defined(CONFIG_NET_RX_QUEUE_PER_IFACE)
+	printf("RX pending: %d\n", (int)atomic_get(&iface->rx_pending));
+#if defined(CONFIG_NET_STATISTICS)
+	printf("RX queue  : max depth %d queued %d drop %d\n",
+	       iface->rx_stats.max_depth,
+	       iface->rx_stats.queued,
+	       iface->rx_stats.drop);
+#endif
+#endif
+#if defined(CONFIG_NET_STATISTICS)
+	for (i = 0; i < NET_TC_TX_COUNT; i++) {
+		printf("TX queue %d: max depth %d queued %d drop %d "
+		       "pending %d\n", i,
+		       iface->tx_stats[i].max_depth,
+		       iface->tx_stats[i].queued,
+		       iface->tx_stats[i].drop,
+		       (int)atomic_get(&iface->tx_pending[i]));
+	}
+#endif
 
 #if defined(CONFIG_NET_IPV6)
 	count = 0;
@@ -369,6 +401,23 @@ static void iface_per_mcast_route_cb(struct net_if *iface, void *user_data)
 #if defined(CONFIG_NET_STATISTICS)
 #define GET_STAT(s) net_stats.s
 
+#if defined(CONFIG_NET_RPL_STATS) && defined(CONFIG_NET_PROFILE)
+static void print_rpl_cpu(void)
+{
+	struct net_profile prof;
+
+	net_profile_get(NET_PROFILE_RPL_RX, &prof);
+
+	printf("RPL CPU msgs   %u\tms\t%u\tmax us\t%u\n", prof.count,
+	       (uint32_t)(prof.cycles * MSEC_PER_SEC /
+			  sys_clock_hw_cycles_per_sec),
+	       (uint32_t)((uint64_t)prof.max * USEC_PER_SEC /
+			  sys_clock_hw_cycles_per_sec));
+}
+#else
+#define print_rpl_cpu(...)
+#endif
+
 static inline void net_print_statistics(void)
 {
 #if defined(CONFIG_NET_IPV6)
@@ -382,6 +431,14 @@ static inline void net_print_statistics(void)
 	       GET_STAT(ipv6_nd.recv),
 	       GET_STAT(ipv6_nd.sent),
 	       GET_STAT(ipv6_nd.drop));
+	printf("IPv6 nbr lookup %d\tmiss\t%d\tadd\t%d\tremove\t%d\n",
+	       GET_STAT(ipv6_nbr.lookup),
+	       GET_STAT(ipv6_nbr.miss),
+	       GET_STAT(ipv6_nbr.add),
+	       GET_STAT(ipv6_nbr.remove));
+	printf("IPv6 nbr full  %d\tprobe\t%d\n",
+	       GET_STAT(ipv6_nbr.full),
+	       GET_STAT(ipv6_nbr.probe));
 #endif /* CONFIG_NET_IPV6_ND */
 #endif /* CONFIG_NET_IPV6 */
 
@@ -410,6 +467,32 @@ static inline void net_print_statistics(void)
 	       GET_STAT(icmp.typeerr),
 	       GET_STAT(icmp.chkerr));
 
+	printf("Offload chksum tx\t%d\ttx sw\t%d\trx\t%d\n",
+	       GET_STAT(offload.tx_chksum),
+	       GET_STAT(offload.tx_sw_chksum),
+	       GET_STAT(offload.rx_chksum));
+
+#if !defined(CONFIG_NET_RX_QUEUE_PER_IFACE)
+	printf("RX queue       queued\t%d\tdrop\t%d\tmax depth\t%d\n",
+	       GET_STAT(rx_queue.queued),
+	       GET_STAT(rx_queue.drop),
+	       GET_STAT(rx_queue.max_depth));
+#endif
+
+#if defined(CONFIG_NET_RX_FLOW_HASH)
+	{
+		int i;
+
+		for (i = 0; i < CONFIG_NET_RX_FLOW_QUEUE_COUNT; i++) {
+			printf("RX flow %d    queued\t%d\tdrop\t%d\t"
+			       "max depth\t%d\n", i,
+			       GET_STAT(rx_flow[i].queued),
+			       GET_STAT(rx_flow[i].drop),
+			       GET_STAT(rx_flow[i].max_depth));
+		}
+	}
+#endif
+
 #if defined(CONFIG_NET_UDP)
 	printf("UDP recv       %d\tsent\t%d\tdrop\t%d\n",
 	       GET_STAT(udp.recv),
@@ -419,6 +502,20 @@ static inline void net_print_statistics(void)
 	       GET_STAT(udp.chkerr));
 #endif
 
+#if defined(CONFIG_NET_L2_IEEE802154_FRAGMENT)
+	printf("15.4 reass rcv %d\tdone\t%d\ttimeout\t%d\n",
+	       GET_STAT(ieee802154_reass.recv),
+	       GET_STAT(ieee802154_reass.reassembled),
+	       GET_STAT(ieee802154_reass.timeout));
+	printf("15.4 reass drop full\t%d\tdup\t%d\toverlap\t%d\t"
+	       "invalid\t%d\tuncomp\t%d\n",
+	       GET_STAT(ieee802154_reass.full),
+	       GET_STAT(ieee802154_reass.duplicate),
+	       GET_STAT(ieee802154_reass.overlap),
+	       GET_STAT(ieee802154_reass.invalid),
+	       GET_STAT(ieee802154_reass.uncompress));
+#endif
+
 #if defined(CONFIG_NET_RPL_STATS)
 	printf("RPL DIS recv   %d\tsent\t%d\tdrop\t%d\n",
 	       GET_STAT(rpl.dis.recv),
@@ -451,6 +548,10 @@ static inline void net_print_statistics(void)
 	       GET_STAT(rpl.loop_warnings));
 	printf("RPL r-repairs  %d\n",
 	       GET_STAT(rpl.root_repairs));
+	printf("RPL parents    scans\t%d\tupdates\t%d\n",
+	       GET_STAT(rpl.parent_scans),
+	       GET_STAT(rpl.parent_updates));
+	print_rpl_cpu();
 #endif
 
 	printf("Processing err %d\n", GET_STAT(processing_error));
@@ -529,8 +630,217 @@ static void tcp_cb(struct net_tcp *tcp, void *user_data)
 }
 #endif
 
+#if defined(CONFIG_NET_CAPTURE)
+static const struct {
+	const char *name;
+	uint8_t value;
+} capture_points[] = {
+	{ "rx", NET_CAPTURE_RX },
+	{ "tx", NET_CAPTURE_TX },
+	{ "drop", NET_CAPTURE_DROP },
+	{ "retry", NET_CAPTURE_TCP_RETRY },
+}, capture_protos[] = {
+	{ "icmp", IPPROTO_ICMP },
+	{ "icmpv6", IPPROTO_ICMPV6 },
+	{ "tcp", IPPROTO_TCP },
+	{ "udp", IPPROTO_UDP },
+};
+
+static int capture_parse(int argc, char *argv[],
+			 struct net_capture_filter *filter, uint16_t *snaplen)
+{
+	int i, j;
+
+	for (i = 0; i < argc; i++) {
+		for (j = 0; j < ARRAY_SIZE(capture_points); j++) {
+			if (!strcmp(argv[i], capture_points[j].name)) {
+				filter->points |= capture_points[j].value;
+				break;
+			}
+		}
+
+		if (j < ARRAY_SIZE(capture_points)) {
+			continue;
+		}
+
+		if (!strcmp(argv[i], "ipv6")) {
+			filter->family = AF_INET6;
+			continue;
+		}
+
+		if (!strcmp(argv[i], "ipv4")) {
+			filter->family = AF_INET;
+			continue;
+		}
+
+		/* The rest of the options take a value */
+		if (i + 1 >= argc) {
+			return -EINVAL;
+		}
+
+		if (!strcmp(argv[i], "iface")) {
+			filter->iface = net_if_get_by_index(atoi(argv[++i]));
+			if (!filter->iface) {
+				return -ENOENT;
+			}
+		} else if (!strcmp(argv[i], "proto")) {
+			i++;
+
+			for (j = 0; j < ARRAY_SIZE(capture_protos); j++) {
+				if (!strcmp(argv[i], capture_protos[j].name)) {
+					break;
+				}
+			}
+
+			if (j < ARRAY_SIZE(capture_protos)) {
+				filter->proto = capture_protos[j].value;
+			} else {
+				filter->proto = atoi(argv[i]);
+			}
+		} else if (!strcmp(argv[i], "port")) {
+			filter->port = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "snaplen")) {
+			*snaplen = atoi(argv[++i]);
+		} else {
+			return -EINVAL;
+		}
+	}
+
+	if (!filter->points) {
+		filter->points = NET_CAPTURE_ALL;
+	}
+
+	return 0;
+}
+
+static void capture_print_hex(const uint8_t *data, size_t len,
+			      void *user_data)
+{
+	int *column = user_data;
+
+	while (len--) {
+		printf("%02x", *data++);
+
+		if (++(*column) == 32) {
+			printf("\n");
+			*column = 0;
+		}
+	}
+}
+
+#if defined(CONFIG_UART_PIPE)
+static void capture_pipe_send(const uint8_t *data, size_t len,
+			      void *user_data)
+{
+	uart_pipe_send(data, len);
+}
+#endif
+
+static void capture_print_status(void)
+{
+	struct net_capture_filter filter;
+	uint32_t captured, lost;
+	bool running;
+	int i;
+
+	running = net_capture_status(&filter, &captured, &lost);
+
+	printf("Capture %s, %u packets captured, %u overwritten\n",
+	       running ? "running" : "stopped", captured, lost);
+
+	if (!running) {
+		return;
+	}
+
+	printf("Points:");
+
+	for (i = 0; i < ARRAY_SIZE(capture_points); i++) {
+		if (filter.points & capture_points[i].value) {
+			printf(" %s", capture_points[i].name);
+		}
+	}
+
+	printf("\n");
+
+	if (filter.iface) {
+		printf("Interface %d\n", net_if_get_by_iface(filter.iface));
+	}
+
+	if (filter.family) {
+		printf("Family %s\n",
+		       filter.family == AF_INET6 ? "IPv6" : "IPv4");
+	}
+
+	if (filter.proto) {
+		printf("Protocol %u\n", filter.proto);
+	}
+
+	if (filter.port) {
+		printf("Port %u\n", filter.port);
+	}
+}
+#endif /* CONFIG_NET_CAPTURE */
+
 /* Put the actual shell commands after this */
 
+static int shell_cmd_capture(int argc, char *argv[])
+{
+#if defined(CONFIG_NET_CAPTURE)
+	struct net_capture_filter filter = { 0 };
+	uint16_t snaplen = 0;
+	int arg = 1, column = 0, count;
+
+	if (strcmp(argv[0], "capture")) {
+		arg++;
+	}
+
+	if (argc <= arg) {
+		capture_print_status();
+		return 0;
+	}
+
+	if (!strcmp(argv[arg], "start")) {
+		if (capture_parse(argc - arg - 1, &argv[arg + 1], &filter,
+				  &snaplen) < 0 ||
+		    net_capture_start(&filter, snaplen) < 0) {
+			printf("Invalid capture options\n");
+			return 0;
+		}
+
+		printf("Capture started\n");
+	} else if (!strcmp(argv[arg], "stop")) {
+		net_capture_stop();
+		capture_print_status();
+	} else if (!strcmp(argv[arg], "dump")) {
+		if (argc > arg + 1 && !strcmp(argv[arg + 1], "pipe")) {
+#if defined(CONFIG_UART_PIPE)
+			count = net_capture_dump(capture_pipe_send, NULL);
+			printf("%d packets sent to UART pipe\n", count);
+#else
+			printf("UART pipe support not compiled in.\n");
+#endif
+			return 0;
+		}
+
+		/* Convert on the host with "xxd -r -p" */
+		printf("--- pcapng start ---\n");
+
+		count = net_capture_dump(capture_print_hex, &column);
+		if (column) {
+			printf("\n");
+		}
+
+		printf("--- pcapng end, %d packets ---\n", count);
+	} else {
+		printf("Unknown capture command '%s'\n", argv[arg]);
+	}
+#else
+	printf("Network packet capture not compiled in.\n");
+#endif
+
+	return 0;
+}
+
 static int shell_cmd_conn(int argc, char *argv[])
 {
 	int count = 0;
@@ -599,6 +909,86 @@ static int shell_cmd_mem(int argc, char *argv[])
 	}
 	printf("\n");
 
+#if defined(CONFIG_NET_NBUF_WATERMARK)
+	net_nbuf_get_watermarks(&tx, &rx, &data);
+
+	printf("Most in use: TX %d RX %d DATA %d\n", tx, rx, data);
+#endif
+
+	return 0;
+}
+
+#if defined(CONFIG_NET_IPV6_ND)
+static const char *nbr_state2str(enum net_nbr_state state)
+{
+	switch (state) {
+	case NET_NBR_INCOMPLETE:
+		return "incomplete";
+	case NET_NBR_REACHABLE:
+		return "reachable";
+	case NET_NBR_STALE:
+		return "stale";
+	case NET_NBR_DELAY:
+		return "delay";
+	case NET_NBR_PROBE:
+		return "probe";
+	}
+
+	return "<invalid state>";
+}
+
+struct nbr_count {
+	int total;
+	int state[NET_NBR_PROBE + 1];
+};
+
+static void nbr_cb(struct net_nbr *nbr, void *user_data)
+{
+	struct nbr_count *count = user_data;
+	struct net_ipv6_nbr_data *data = net_ipv6_nbr_data(nbr);
+	struct net_linkaddr_storage *lladdr = NULL;
+
+	if (nbr->idx != NET_NBR_LLADDR_UNKNOWN) {
+		lladdr = net_nbr_get_lladdr(nbr->idx);
+	}
+
+	printf("[%2d] %p %p %10s %s %17s %s\n",
+	       count->total, nbr, nbr->iface, nbr_state2str(data->state),
+	       data->is_router ? "R" : " ",
+	       lladdr ? net_sprint_ll_addr(lladdr->addr, lladdr->len) :
+	       "<unknown>",
+	       net_sprint_ipv6_addr(&data->addr));
+
+	count->total++;
+	count->state[data->state]++;
+}
+#endif /* CONFIG_NET_IPV6_ND */
+
+static int shell_cmd_nbr(int argc, char *argv[])
+{
+#if defined(CONFIG_NET_IPV6_ND)
+	struct nbr_count count = { 0 };
+
+	printf("     Neighbor   Interface  State     Router Link address"
+	       "      IPv6 address\n");
+
+	net_ipv6_nbr_foreach(nbr_cb, &count);
+
+	if (count.total == 0) {
+		printf("No neighbors.\n");
+		return 0;
+	}
+
+	printf("%d/%d neighbors, incomplete %d reachable %d stale %d "
+	       "delay %d probe %d\n",
+	       count.total, CONFIG_NET_IPV6_MAX_NEIGHBORS,
+	       count.state[NET_NBR_INCOMPLETE], count.state[NET_NBR_REACHABLE],
+	       count.state[NET_NBR_STALE], count.state[NET_NBR_DELAY],
+	       count.state[NET_NBR_PROBE]);
+#else
+	printf("IPv6 neighbor discovery support not compiled in.\n");
+#endif
+
 	return 0;
 }
 
@@ -739,9 +1129,14 @@ static int shell_cmd_stats(int argc, char *argv[])
 static int shell_cmd_help(int argc, char *argv[])
 {
 	/* Keep the commands in alphabetical order */
+	printf("net capture [start [rx] [tx] [drop] [retry] [ipv4|ipv6] "
+	       "[iface <index>] [proto <name|number>] [port <port>] "
+	       "[snaplen <len>] | stop | dump [pipe]]\n"
+	       "\tCapture packets and dump them in pcapng format\n");
 	printf("net conn\n\tPrint information about network connections\n");
 	printf("net iface\n\tPrint information about network interfaces\n");
 	printf("net mem\n\tPrint network buffer information\n");
+	printf("net nbr\n\tPrint IPv6 neighbor cache\n");
 	printf("net ping <host>\n\tPing a network host\n");
 	printf("net route\n\tShow network routes\n");
 	printf("net stacks\n\tShow network stacks information\n");
@@ -751,10 +1146,12 @@ static int shell_cmd_help(int argc, char *argv[])
 
 static struct shell_cmd net_commands[] = {
 	/* Keep the commands in alphabetical order */
+	{ "capture", shell_cmd_capture },
 	{ "conn", shell_cmd_conn },
 	{ "help", shell_cmd_help },
 	{ "iface", shell_cmd_iface },
 	{ "mem", shell_cmd_mem },
+	{ "nbr", shell_cmd_nbr },
 	{ "ping", shell_cmd_ping },
 	{ "route", shell_cmd_route },
 	{ "stacks", shell_cmd_stacks },
@@ -26,8 +26,10 @@
 
 #include <kernel.h>
 #include <limits.h>
+#include <string.h>
 #include <stdint.h>
 #include <misc/slist.h>
+#include <misc/dlist.h>
 
 #include <net/nbuf.h>
 #include <net/net_core.h>
@@ -48,7 +50,49 @@
 /* We keep track of the routes in a separate list so that we can remove
  * the oldest routes (at tail) if needed.
  */
-static sys_slist_t routes;
+static sys_dlist_t routes = SYS_DLIST_STATIC_INIT(&routes);
+
+/* The routes are also stored in a path compressed binary trie keyed by
+ * the route prefix so that the longest prefix match does not need to go
+ * through the whole routing table. Each trie node either holds at least
+ * one route or has two children, so twice the number of routes is
+ * enough nodes.
+ */
+struct route_trie_node {
+	/** Child nodes, selected by the first bit after the prefix */
+	struct route_trie_node *child[2];
+
+	/** Parent node, NULL for the root node */
+	struct route_trie_node *parent;
+
+	/** Routes (one per interface) that have this prefix */
+	sys_slist_t routes;
+
+	/** Prefix of the node, bits after len are not used */
+	struct in6_addr prefix;
+
+	/** Prefix length in bits */
+	uint8_t len;
+};
+
+#define ROUTE_TRIE_NODES (2 * CONFIG_NET_MAX_ROUTES)
+
+static struct route_trie_node trie_nodes[ROUTE_TRIE_NODES];
+static struct route_trie_node *trie_free;
+static struct route_trie_node *trie_root;
+
+#if defined(CONFIG_NET_ROUTE_CACHE)
+/* Small direct mapped cache of the latest lookup results. The cache is
+ * flushed whenever a route is added or removed.
+ */
+struct route_cache_entry {
+	struct in6_addr dst;
+	struct net_if *iface;
+	struct net_route_entry *route;
+};
+
+static struct route_cache_entry route_cache[CONFIG_NET_ROUTE_CACHE_SIZE];
+#endif
 
 static void net_route_nexthop_remove(struct net_nbr *nbr)
 {
@@ -265,36 +309,262 @@ static int nbr_nexthop_put(struct net_nbr *nbr)
 /* Route was accessed, so place it in front of the routes list */
 static inline void update_route_access(struct net_route_entry *route)
 {
-	sys_slist_find_and_remove(&routes, &route->node);
-	sys_slist_prepend(&routes, &route->node);
+	sys_dlist_remove(&route->node);
+	sys_dlist_prepend(&routes, &route->node);
 }
 
-struct net_route_entry *net_route_lookup(struct net_if *iface,
-					 struct in6_addr *dst)
+static inline int addr_bit(const struct in6_addr *addr, uint8_t bit)
 {
-	struct net_route_entry *route, *found = NULL;
-	uint8_t longest_match = 0;
+	return (addr->s6_addr[bit / 8] >> (7 - (bit % 8))) & 1;
+}
+
+/* Return how many leading bits (at most max) of the addresses are equal */
+static uint8_t common_prefix_len(const struct in6_addr *a,
+				 const struct in6_addr *b,
+				 uint8_t max)
+{
+	uint8_t len = 0;
+	uint8_t diff;
 	int i;
 
-	for (i = 0; i < CONFIG_NET_MAX_ROUTES && longest_match < 128; i++) {
-		struct net_nbr *nbr = get_nbr(i);
+	for (i = 0; i < 16 && len < max; i++) {
+		diff = a->s6_addr[i] ^ b->s6_addr[i];
+		if (diff) {
+			while (!(diff & 0x80)) {
+				diff <<= 1;
+				len++;
+			}
 
-		if (!nbr->ref) {
-			continue;
+			break;
 		}
 
-		if (iface && nbr->iface != iface) {
-			continue;
+		len += 8;
+	}
+
+	return min(len, max);
+}
+
+static struct route_trie_node *trie_node_alloc(const struct in6_addr *prefix,
+					       uint8_t len)
+{
+	struct route_trie_node *node = trie_free;
+
+	if (!node) {
+		return NULL;
+	}
+
+	trie_free = node->child[0];
+
+	memset(node, 0, sizeof(*node));
+	net_ipaddr_copy(&node->prefix, prefix);
+	node->len = len;
+
+	return node;
+}
+
+static inline void trie_node_free(struct route_trie_node *node)
+{
+	node->child[0] = trie_free;
+	trie_free = node;
+}
+
+static inline void trie_replace(struct route_trie_node *old,
+				struct route_trie_node *new)
+{
+	struct route_trie_node *parent = old->parent;
+
+	if (new) {
+		new->parent = parent;
+	}
+
+	if (!parent) {
+		trie_root = new;
+	} else {
+		parent->child[parent->child[1] == old] = new;
+	}
+}
+
+static bool trie_insert(struct net_route_entry *route)
+{
+	struct route_trie_node **link = &trie_root;
+	struct route_trie_node *parent = NULL;
+	struct route_trie_node *node, *leaf, *branch;
+	uint8_t len = route->prefix_len;
+	uint8_t common = 0;
+
+	while (*link) {
+		node = *link;
+
+		common = common_prefix_len(&route->addr, &node->prefix,
+					   min(len, node->len));
+		if (common < node->len) {
+			break;
 		}
 
-		route = net_route_data(nbr);
+		if (node->len == len) {
+			sys_slist_prepend(&node->routes, &route->trie_node);
+			return true;
+		}
+
+		parent = node;
+		link = &node->child[addr_bit(&route->addr, node->len)];
+	}
+
+	leaf = trie_node_alloc(&route->addr, len);
+	if (!leaf) {
+		return false;
+	}
+
+	sys_slist_prepend(&leaf->routes, &route->trie_node);
+	leaf->parent = parent;
+
+	node = *link;
+	if (!node) {
+		*link = leaf;
+		return true;
+	}
+
+	if (common == len) {
+		/* The new prefix covers the existing node */
+		leaf->child[addr_bit(&node->prefix, len)] = node;
+		node->parent = leaf;
+		*link = leaf;
+		return true;
+	}
+
+	/* The prefixes differ after common bits, add a branch node */
+	branch = trie_node_alloc(&route->addr, common);
+	if (!branch) {
+		sys_slist_init(&leaf->routes);
+		trie_node_free(leaf);
+		return false;
+	}
 
-		if (route->prefix_len >= longest_match &&
-		    net_is_ipv6_prefix((uint8_t *)dst,
-				       (uint8_t *)&route->addr,
-				       route->prefix_len)) {
-			found = route;
-			longest_match = route->prefix_len;
+	branch->parent = parent;
+	branch->child[addr_bit(&route->addr, common)] = leaf;
+	branch->child[addr_bit(&node->prefix, common)] = node;
+	leaf->parent = branch;
+	node->parent = branch;
+	*link = branch;
+
+	return true;
+}
+
+static void trie_remove(struct net_route_entry *route)
+{
+	struct route_trie_node *node = trie_root;
+	struct route_trie_node *parent, *child;
+
+	while (node && node->len < route->prefix_len &&
+	       common_prefix_len(&route->addr, &node->prefix,
+				 node->len) == node->len) {
+		node = node->child[addr_bit(&route->addr, node->len)];
+	}
+
+	if (!node || node->len != route->prefix_len) {
+		return;
+	}
+
+	sys_slist_find_and_remove(&node->routes, &route->trie_node);
+
+	/* Remove the nodes that are not needed any more */
+	while (node && sys_slist_is_empty(&node->routes) &&
+	       !(node->child[0] && node->child[1])) {
+		child = node->child[0] ? node->child[0] : node->child[1];
+		parent = node->parent;
+
+		trie_replace(node, child);
+		trie_node_free(node);
+
+		node = parent;
+	}
+}
+
+static struct net_route_entry *trie_lookup(struct net_if *iface,
+					   struct in6_addr *dst)
+{
+	struct route_trie_node *node = trie_root;
+	struct net_route_entry *found = NULL;
+	sys_snode_t *sn;
+
+	while (node && common_prefix_len(dst, &node->prefix,
+					 node->len) == node->len) {
+		SYS_SLIST_FOR_EACH_NODE(&node->routes, sn) {
+			struct net_route_entry *route;
+
+			route = CONTAINER_OF(sn, struct net_route_entry,
+					     trie_node);
+			if (!iface || route->iface == iface) {
+				found = route;
+				break;
+			}
+		}
+
+		if (node->len == 128) {
+			break;
+		}
+
+		node = node->child[addr_bit(dst, node->len)];
+	}
+
+	return found;
+}
+
+#if defined(CONFIG_NET_ROUTE_CACHE)
+static inline struct route_cache_entry *route_cache_slot(struct in6_addr *dst)
+{
+	uint32_t hash = dst->s6_addr32[2] ^ dst->s6_addr32[3];
+
+	hash ^= hash >> 16;
+	hash ^= hash >> 8;
+
+	return &route_cache[hash % CONFIG_NET_ROUTE_CACHE_SIZE];
+}
+
+static inline struct net_route_entry *route_cache_get(struct net_if *iface,
+						      struct in6_addr *dst)
+{
+	struct route_cache_entry *entry = route_cache_slot(dst);
+
+	if (entry->route && entry->iface == iface &&
+	    net_ipv6_addr_cmp(&entry->dst, dst)) {
+		return entry->route;
+	}
+
+	return NULL;
+}
+
+static inline void route_cache_set(struct net_if *iface,
+				   struct in6_addr *dst,
+				   struct net_route_entry *route)
+{
+	struct route_cache_entry *entry = route_cache_slot(dst);
+
+	net_ipaddr_copy(&entry->dst, dst);
+	entry->iface = iface;
+	entry->route = route;
+}
+
+static inline void route_cache_clear(void)
+{
+	memset(route_cache, 0, sizeof(route_cache));
+}
+#else
+#define route_cache_get(...) NULL
+#define route_cache_set(...)
+#define route_cache_clear(...)
+#endif /* CONFIG_NET_ROUTE_CACHE */
+
+struct net_route_entry *net_route_lookup(struct net_if *iface,
+					 struct in6_addr *dst)
+{
+	struct net_route_entry *found;
+
+	found = route_cache_get(iface, dst);
+	if (!found) {
+		found = trie_lookup(iface, dst);
+		if (found) {
+			route_cache_set(iface, dst, found);
 		}
 	}
 
@@ -363,10 +633,15 @@ struct net_route_entry *net_route_add(struct net_if *iface,
 
 	nbr = nbr_new(iface, addr, prefix_len);
 	if (!nbr) {
-		/* Remove the oldest route and try again */
-		sys_snode_t *last = sys_slist_peek_tail(&routes);
+		/* Remove the oldest route and try again. The dlist API
+		 * has no peek_tail() so look at the tail directly.
+		 */
+		sys_dnode_t *last = routes.tail;
 
-		sys_slist_find_and_remove(&routes, last);
+		if (sys_dlist_is_empty(&routes)) {
+			NET_ERR("Neighbor route alloc failed!");
+			return NULL;
+		}
 
 		route = CONTAINER_OF(last,
 				     struct net_route_entry,
@@ -403,6 +678,7 @@ struct net_route_entry *net_route_add(struct net_if *iface,
 	tmp = get_nexthop_route();
 	if (!tmp) {
 		NET_ERR("No nexthop route available!");
+		nbr_free(nbr);
 		return NULL;
 	}
 
@@ -411,7 +687,16 @@ struct net_route_entry *net_route_add(struct net_if *iface,
 	route = net_route_data(nbr);
 	route->iface = iface;
 
-	sys_slist_prepend(&routes, &route->node);
+	if (!trie_insert(route)) {
+		NET_ERR("No route trie node available!");
+		net_nbr_unref(tmp);
+		nbr_free(nbr);
+		return NULL;
+	}
+
+	sys_dlist_prepend(&routes, &route->node);
+
+	route_cache_clear();
 
 	tmp = nbr_nexthop_get(iface, nexthop);
 
@@ -438,13 +723,15 @@ int net_route_del(struct net_route_entry *route)
 		return -EINVAL;
 	}
 
-	sys_slist_find_and_remove(&routes, &route->node);
-
 	nbr = net_route_get_nbr(route);
 	if (!nbr) {
 		return -ENOENT;
 	}
 
+	sys_dlist_remove(&route->node);
+	trie_remove(route);
+	route_cache_clear();
+
 	net_route_info("Deleted", route, &route->addr);
 
 	SYS_SLIST_FOR_EACH_NODE(&route->nexthop, test) {
@@ -707,6 +994,12 @@ net_route_mcast_lookup(struct in6_addr *group)
 
 void net_route_init(void)
 {
+	int i;
+
+	for (i = 0; i < ROUTE_TRIE_NODES; i++) {
+		trie_node_free(&trie_nodes[i]);
+	}
+
 	NET_DBG("Allocated %d routing entries (%d bytes)",
 		CONFIG_NET_MAX_ROUTES, sizeof(net_route_entries_pool));
 
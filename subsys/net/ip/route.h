@@ -25,6 +25,7 @@
 
 #include <kernel.h>
 #include <misc/slist.h>
+#include <misc/dlist.h>
 
 #include <net/net_ip.h>
 
@@ -58,7 +59,12 @@ struct net_route_entry {
 	 * we can remove it if we run out of available routes.
 	 * The oldest one is the last entry in the list.
 	 */
-	sys_snode_t node;
+	sys_dnode_t node;
+
+	/** Routes that have the same prefix are linked together in the
+	 * route lookup trie.
+	 */
+	sys_snode_t trie_node;
 
 	/** List of neighbors that the routes go through. */
 	sys_slist_t nexthop;
@@ -187,7 +187,7 @@ static uint16_t calculate_path_metric(struct net_rpl_parent *parent)
 		return MRHOF_MAX_PATH_COST * NET_RPL_MC_ETX_DIVISOR;
 	}
 
-	nbr = net_rpl_get_nbr(parent);
+	nbr = net_rpl_get_ipv6_nbr(parent);
 	if (!nbr) {
 		return MRHOF_MAX_PATH_COST * NET_RPL_MC_ETX_DIVISOR;
 	}
@@ -276,7 +276,7 @@ static uint16_t net_rpl_mrhof_calc_rank(struct net_rpl_parent *parent,
 	uint16_t rank_increase;
 	struct net_nbr *nbr;
 
-	nbr = net_rpl_get_nbr(parent);
+	nbr = net_rpl_get_ipv6_nbr(parent);
 
 	if (!parent || !nbr) {
 		if (base_rank == 0) {
@@ -118,8 +118,8 @@ net_rpl_of0_best_parent(struct net_if *iface,
 	struct net_rpl_dag *dag;
 	struct net_nbr *nbr1, *nbr2;
 
-	nbr1 = net_rpl_get_nbr(parent1);
-	nbr2 = net_rpl_get_nbr(parent2);
+	nbr1 = net_rpl_get_ipv6_nbr(parent1);
+	nbr2 = net_rpl_get_ipv6_nbr(parent2);
 
 	dag = (struct net_rpl_dag *)parent1->dag;
 
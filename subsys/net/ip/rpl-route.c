@@ -0,0 +1,490 @@
+/** @file
+ * @brief RPL downward routes.
+ *
+ * Storing mode routes to the DAO targets below this node.
+ */
+
+/*
+ * Copyright (c) 2016 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#if defined(CONFIG_NET_DEBUG_RPL)
+#define SYS_LOG_DOMAIN "net/rpl"
+#define NET_DEBUG 1
+#endif
+
+#include <kernel.h>
+#include <string.h>
+#include <errno.h>
+
+#include <net/net_core.h>
+#include <net/net_ip.h>
+
+#include "net_private.h"
+#include "ipv6.h"
+#include "nbr.h"
+#include "rpl.h"
+#include "timer_wheel.h"
+
+/* A DAO target costs one small entry instead of a route table slot.
+ * The targets are usually addresses in the prefix of the DAG, so the
+ * upper 64 bits of the address are kept once in the prefix table and
+ * the entry only stores the interface identifier. The next hops have a
+ * table of their own too, each holding one reference to the neighbor.
+ */
+#define ROUTE_COUNT CONFIG_NET_RPL_MAX_DOWNWARD_ROUTES
+#define ROUTE_END 0xffff
+
+#define PREFIX_COUNT (2 * CONFIG_NET_RPL_MAX_INSTANCES *	\
+		      CONFIG_NET_RPL_MAX_DAG_PER_INSTANCE)
+#define PREFIX_UNUSED 0x7f
+
+#define NEXTHOP_COUNT CONFIG_NET_IPV6_MAX_NEIGHBORS
+
+struct rpl_route {
+	/** Lifetime of the route */
+	struct net_timer_wheel_timer timer;
+
+	/** Interface identifier of the target */
+	uint32_t iid[2];
+
+	/** Next route in the hash chain, or in the free list */
+	uint16_t hash_next;
+
+	/** Index of the prefix, PREFIX_UNUSED if the entry is free */
+	uint8_t prefix : 7;
+
+	/** No-Path DAO received, the route is about to expire */
+	uint8_t no_path : 1;
+
+	/** Index of the next hop */
+	uint8_t nexthop;
+};
+
+struct rpl_route_prefix {
+	/** Upper 64 bits of the targets */
+	uint32_t prefix[2];
+
+	/** Interface of the routes */
+	struct net_if *iface;
+
+	/** DAG the routes were learned in */
+	struct net_rpl_dag *dag;
+
+	/** Number of routes using the prefix, 0 if the entry is free */
+	uint16_t count;
+};
+
+struct rpl_route_nexthop {
+	/** IPv6 neighbor, referenced while the next hop is in use */
+	struct net_nbr *nbr;
+
+	/** Number of routes using the next hop */
+	uint16_t count;
+};
+
+/* The table sizes come from Kconfig, the indexes must still fit their
+ * fields without reaching the end and free markers.
+ */
+BUILD_ASSERT(ROUTE_COUNT < ROUTE_END);
+BUILD_ASSERT(PREFIX_COUNT < PREFIX_UNUSED);
+BUILD_ASSERT(NEXTHOP_COUNT <= 256);
+
+static struct rpl_route routes[ROUTE_COUNT];
+static struct rpl_route_prefix prefixes[PREFIX_COUNT];
+static struct rpl_route_nexthop nexthops[NEXTHOP_COUNT];
+static uint16_t route_free;
+static int route_count;
+
+/* The routes are found by a hash of the interface identifier of the
+ * target, so a DAO refreshes its route in constant time.
+ */
+#define ROUTE_HASH_SIZE (ROUTE_COUNT / 2)
+
+static uint16_t route_hash[ROUTE_HASH_SIZE] = {
+	[0 ... (ROUTE_HASH_SIZE - 1)] = ROUTE_END
+};
+
+static inline uint16_t route_hash_key(const uint32_t *iid)
+{
+	uint32_t key = iid[0] ^ iid[1];
+
+	key ^= key >> 16;
+
+	return (key & 0xffff) % ROUTE_HASH_SIZE;
+}
+
+/* The lifetimes are kept in a timer wheel, in seconds */
+#define ROUTE_TIMER_TICK MSEC_PER_SEC
+#define ROUTE_TIMER_SLOTS 64
+
+static sys_dlist_t route_timer_slots[ROUTE_TIMER_SLOTS];
+static struct net_timer_wheel route_timer;
+
+static inline void route_timer_clear(uint16_t idx)
+{
+	net_timer_wheel_clear(&route_timer, &routes[idx].timer);
+}
+
+static inline void route_timer_set(uint16_t idx, uint32_t lifetime)
+{
+	net_timer_wheel_set(&route_timer, &routes[idx].timer, lifetime);
+}
+
+static inline bool prefix_match(struct rpl_route_prefix *prefix,
+				struct net_if *iface,
+				const struct in6_addr *addr)
+{
+	return prefix->count && (!iface || prefix->iface == iface) &&
+		prefix->prefix[0] == UNALIGNED_GET(&addr->s6_addr32[0]) &&
+		prefix->prefix[1] == UNALIGNED_GET(&addr->s6_addr32[1]);
+}
+
+static int prefix_get(struct net_if *iface, struct net_rpl_dag *dag,
+		      const struct in6_addr *addr)
+{
+	int i, free = -ENOMEM;
+
+	for (i = 0; i < PREFIX_COUNT; i++) {
+		if (prefix_match(&prefixes[i], iface, addr) &&
+		    prefixes[i].dag == dag) {
+			prefixes[i].count++;
+			return i;
+		}
+
+		if (!prefixes[i].count && free < 0) {
+			free = i;
+		}
+	}
+
+	if (free >= 0) {
+		prefixes[free].prefix[0] = UNALIGNED_GET(&addr->s6_addr32[0]);
+		prefixes[free].prefix[1] = UNALIGNED_GET(&addr->s6_addr32[1]);
+		prefixes[free].iface = iface;
+		prefixes[free].dag = dag;
+		prefixes[free].count = 1;
+	}
+
+	return free;
+}
+
+static int nexthop_get(struct net_nbr *nbr)
+{
+	int i, free = -ENOMEM;
+
+	for (i = 0; i < NEXTHOP_COUNT; i++) {
+		if (nexthops[i].nbr == nbr) {
+			nexthops[i].count++;
+			return i;
+		}
+
+		if (!nexthops[i].nbr && free < 0) {
+			free = i;
+		}
+	}
+
+	if (free >= 0) {
+		nexthops[free].nbr = net_nbr_ref(nbr);
+		nexthops[free].count = 1;
+	}
+
+	return free;
+}
+
+static void nexthop_put(uint8_t idx)
+{
+	if (--nexthops[idx].count) {
+		return;
+	}
+
+	net_nbr_unref(nexthops[idx].nbr);
+	nexthops[idx].nbr = NULL;
+}
+
+static inline struct in6_addr *nexthop_addr(uint8_t idx)
+{
+	return &net_ipv6_nbr_data(nexthops[idx].nbr)->addr;
+}
+
+static uint16_t route_find(struct net_if *iface, const struct in6_addr *addr)
+{
+	uint32_t iid[2];
+	uint16_t idx;
+
+	iid[0] = UNALIGNED_GET(&addr->s6_addr32[2]);
+	iid[1] = UNALIGNED_GET(&addr->s6_addr32[3]);
+
+	for (idx = route_hash[route_hash_key(iid)]; idx != ROUTE_END;
+	     idx = routes[idx].hash_next) {
+		struct rpl_route *route = &routes[idx];
+
+		if (route->iid[0] == iid[0] && route->iid[1] == iid[1] &&
+		    prefix_match(&prefixes[route->prefix], iface, addr)) {
+			return idx;
+		}
+	}
+
+	return ROUTE_END;
+}
+
+static void route_del(uint16_t idx)
+{
+	struct rpl_route *route = &routes[idx];
+	uint16_t *i;
+
+	NET_DBG("Route %u expired or removed", idx);
+
+	i = &route_hash[route_hash_key(route->iid)];
+	while (*i != idx) {
+		i = &routes[*i].hash_next;
+	}
+
+	*i = route->hash_next;
+
+	route_timer_clear(idx);
+
+	prefixes[route->prefix].count--;
+	nexthop_put(route->nexthop);
+
+	route->prefix = PREFIX_UNUSED;
+	route->hash_next = route_free;
+	route_free = idx;
+
+	route_count--;
+}
+
+static void route_timer_expired(struct net_timer_wheel_timer *timer)
+{
+	struct rpl_route *route = CONTAINER_OF(timer, struct rpl_route, timer);
+
+	route_del(route - routes);
+}
+
+int net_rpl_downward_add(struct net_rpl_dag *dag, struct net_if *iface,
+			 struct in6_addr *target, struct in6_addr *nexthop,
+			 uint32_t lifetime)
+{
+	struct rpl_route *route;
+	struct net_nbr *nbr;
+	int prefix, hop;
+	uint16_t idx;
+
+	nbr = net_ipv6_nbr_lookup(iface, nexthop);
+	if (!nbr) {
+		return -ENOENT;
+	}
+
+	idx = route_find(iface, target);
+	if (idx != ROUTE_END) {
+		route = &routes[idx];
+
+		if (nexthops[route->nexthop].nbr != nbr) {
+			hop = nexthop_get(nbr);
+			if (hop < 0) {
+				return hop;
+			}
+
+			nexthop_put(route->nexthop);
+			route->nexthop = hop;
+		}
+
+		if (prefixes[route->prefix].dag != dag) {
+			prefix = prefix_get(iface, dag, target);
+			if (prefix < 0) {
+				return prefix;
+			}
+
+			prefixes[route->prefix].count--;
+			route->prefix = prefix;
+		}
+
+		route->no_path = 0;
+
+		route_timer_set(idx, lifetime);
+
+		return 0;
+	}
+
+	if (route_free == ROUTE_END) {
+		return -ENOMEM;
+	}
+
+	prefix = prefix_get(iface, dag, target);
+	if (prefix < 0) {
+		return prefix;
+	}
+
+	hop = nexthop_get(nbr);
+	if (hop < 0) {
+		prefixes[prefix].count--;
+		return hop;
+	}
+
+	idx = route_free;
+	route = &routes[idx];
+	route_free = route->hash_next;
+
+	route->iid[0] = UNALIGNED_GET(&target->s6_addr32[2]);
+	route->iid[1] = UNALIGNED_GET(&target->s6_addr32[3]);
+	route->prefix = prefix;
+	route->nexthop = hop;
+	route->no_path = 0;
+
+	route->hash_next = route_hash[route_hash_key(route->iid)];
+	route_hash[route_hash_key(route->iid)] = idx;
+
+	route_timer_set(idx, lifetime);
+
+	route_count++;
+
+	NET_DBG("Route %u to %s added", idx, net_sprint_ipv6_addr(target));
+
+	return 0;
+}
+
+bool net_rpl_downward_no_path(struct net_if *iface, struct in6_addr *target,
+			      struct in6_addr *nexthop, uint32_t lifetime)
+{
+	uint16_t idx = route_find(iface, target);
+
+	if (idx == ROUTE_END || routes[idx].no_path ||
+	    !net_ipv6_addr_cmp(nexthop_addr(routes[idx].nexthop), nexthop)) {
+		return false;
+	}
+
+	routes[idx].no_path = 1;
+
+	route_timer_set(idx, lifetime);
+
+	return true;
+}
+
+struct in6_addr *net_rpl_downward_lookup(struct net_if *iface,
+					 struct in6_addr *addr)
+{
+	uint16_t idx = route_find(iface, addr);
+
+	if (idx == ROUTE_END) {
+		return NULL;
+	}
+
+	return nexthop_addr(routes[idx].nexthop);
+}
+
+bool net_rpl_downward_del(struct net_if *iface, struct in6_addr *target)
+{
+	uint16_t idx = route_find(iface, target);
+
+	if (idx == ROUTE_END) {
+		return false;
+	}
+
+	route_del(idx);
+
+	return true;
+}
+
+int net_rpl_downward_del_by_dag(struct net_rpl_dag *dag)
+{
+	int count = 0;
+	int i;
+
+	for (i = 0; i < PREFIX_COUNT; i++) {
+		if (prefixes[i].count && prefixes[i].dag == dag) {
+			break;
+		}
+	}
+
+	if (i == PREFIX_COUNT) {
+		return 0;
+	}
+
+	for (i = 0; i < ROUTE_COUNT; i++) {
+		if (routes[i].prefix == PREFIX_UNUSED ||
+		    prefixes[routes[i].prefix].dag != dag) {
+			continue;
+		}
+
+		route_del(i);
+		count++;
+	}
+
+	return count;
+}
+
+int net_rpl_downward_del_by_nexthop(struct net_if *iface,
+				    struct in6_addr *nexthop,
+				    struct net_rpl_dag *dag)
+{
+	struct net_nbr *nbr = net_ipv6_nbr_lookup(iface, nexthop);
+	int count = 0;
+	int hop, i;
+
+	if (!nbr) {
+		return 0;
+	}
+
+	for (hop = 0; hop < NEXTHOP_COUNT; hop++) {
+		if (nexthops[hop].nbr == nbr) {
+			break;
+		}
+	}
+
+	if (hop == NEXTHOP_COUNT) {
+		return 0;
+	}
+
+	for (i = 0; i < ROUTE_COUNT; i++) {
+		if (routes[i].prefix == PREFIX_UNUSED ||
+		    routes[i].nexthop != hop ||
+		    prefixes[routes[i].prefix].dag != dag) {
+			continue;
+		}
+
+		route_del(i);
+		count++;
+	}
+
+	return count;
+}
+
+int net_rpl_downward_count(void)
+{
+	return route_count;
+}
+
+size_t net_rpl_downward_size(void)
+{
+	return sizeof(routes) + sizeof(prefixes) + sizeof(nexthops) +
+		sizeof(route_hash) + sizeof(route_timer_slots);
+}
+
+void net_rpl_downward_init(void)
+{
+	int i;
+
+	for (i = 0; i < ROUTE_COUNT; i++) {
+		routes[i].prefix = PREFIX_UNUSED;
+		routes[i].hash_next = i + 1 < ROUTE_COUNT ? i + 1 : ROUTE_END;
+	}
+
+	route_free = 0;
+
+	net_timer_wheel_init(&route_timer, route_timer_slots, ROUTE_TIMER_SLOTS,
+			     ROUTE_TIMER_TICK, route_timer_expired);
+
+	NET_DBG("Allocated %d downward routes (%d bytes)", ROUTE_COUNT,
+		(int)net_rpl_downward_size());
+}
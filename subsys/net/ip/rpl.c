@@ -67,6 +67,7 @@
 #include "nbr.h"
 #include "route.h"
 #include "rpl.h"
+#include "net_profile.h"
 
 #define NET_RPL_DIO_GROUNDED         0x80
 #define NET_RPL_DIO_MOP_SHIFT        3
@@ -198,9 +199,26 @@ static inline uint32_t net_rpl_lifetime(struct net_rpl_instance *instance,
 	return (uint32_t)instance->lifetime_unit * (uint32_t)lifetime;
 }
 
+/* The parents are indexed by the link layer address index they share with
+ * the IPv6 neighbor cache, so the parent of a neighbor is found without
+ * going through the parent table.
+ */
+static uint8_t parent_index[CONFIG_NET_IPV6_MAX_NEIGHBORS] = {
+	[0 ... (CONFIG_NET_IPV6_MAX_NEIGHBORS - 1)] = NET_NBR_LLADDR_UNKNOWN
+};
+
 static void net_rpl_neighbor_data_remove(struct net_nbr *nbr)
 {
 	NET_DBG("Neighbor %p removed", nbr);
+
+	if (nbr->idx != NET_NBR_LLADDR_UNKNOWN) {
+		parent_index[nbr->idx] = NET_NBR_LLADDR_UNKNOWN;
+
+		net_nbr_unlink(nbr, NULL);
+	}
+
+	/* Some scans of the parent set do not check the reference count */
+	memset(nbr->data, 0, sizeof(struct net_rpl_parent));
 }
 
 static void net_rpl_neighbor_table_clear(struct net_nbr_table *table)
@@ -263,37 +281,48 @@ static inline struct net_rpl_parent *nbr_data(struct net_nbr *nbr)
 	return (struct net_rpl_parent *)nbr->data;
 }
 
+static inline uint8_t nbr_slot(struct net_nbr *nbr)
+{
+	return ((uint8_t *)nbr - (uint8_t *)net_rpl_neighbor_pool) /
+		sizeof(net_rpl_neighbor_pool[0]);
+}
+
 struct net_nbr *net_rpl_get_nbr(struct net_rpl_parent *data)
 {
-	int i;
+	if (!data) {
+		return NULL;
+	}
 
-	for (i = 0; i < CONFIG_NET_IPV6_MAX_NEIGHBORS; i++) {
-		struct net_nbr *nbr = get_nbr(i);
+	/* The parent is the data part of a neighbor in the pool */
+	return CONTAINER_OF((uint8_t *)data, struct net_nbr, __nbr);
+}
 
-		if (nbr->data == (uint8_t *)data) {
-			return nbr;
-		}
+struct net_nbr *net_rpl_get_ipv6_nbr(struct net_rpl_parent *parent)
+{
+	struct net_nbr *nbr = net_rpl_get_nbr(parent);
+
+	if (!nbr) {
+		return NULL;
 	}
 
-	return NULL;
+	return net_ipv6_get_nbr(nbr->iface, nbr->idx);
 }
 
-static struct net_nbr *nbr_lookup(struct net_nbr_table *table,
-				  struct net_if *iface,
-				  struct in6_addr *addr)
+static struct net_nbr *nbr_lookup(struct net_if *iface, uint8_t idx)
 {
-	int i;
+	struct net_nbr *nbr;
 
-	for (i = 0; i < CONFIG_NET_IPV6_MAX_NEIGHBORS; i++) {
-		struct net_nbr *nbr = get_nbr(i);
+	if (idx >= CONFIG_NET_IPV6_MAX_NEIGHBORS ||
+	    parent_index[idx] == NET_NBR_LLADDR_UNKNOWN) {
+		return NULL;
+	}
 
-		if (nbr->ref && nbr->iface == iface &&
-		    net_ipv6_addr_cmp(&nbr_data(nbr)->dag->dag_id, addr)) {
-			return nbr;
-		}
+	nbr = get_nbr(parent_index[idx]);
+	if (!nbr->ref || nbr->idx != idx || nbr->iface != iface) {
+		return NULL;
 	}
 
-	return NULL;
+	return nbr;
 }
 
 static inline void nbr_free(struct net_nbr *nbr)
@@ -321,6 +350,8 @@ static struct net_nbr *nbr_add(struct net_if *iface,
 		return NULL;
 	}
 
+	parent_index[nbr->idx] = nbr_slot(nbr);
+
 	NET_DBG("[%d] nbr %p IPv6 %s ll %s",
 		nbr->idx, nbr, net_sprint_ipv6_addr(addr),
 		net_sprint_ll_addr(lladdr->addr, lladdr->len));
@@ -661,7 +692,10 @@ static void new_dio_interval(struct net_rpl_instance *instance)
 	NET_ASSERT(time);
 
 	instance->dio_next_delay = time;
-	time = time / 2 + (time / 2 * sys_rand32_get()) / UINT32_MAX;
+
+	/* Random time in [I/2, I), the product does not fit in 32 bits */
+	time = time / 2 +
+		(uint32_t)(((uint64_t)(time / 2) * sys_rand32_get()) >> 32);
 
 	/* Adjust the interval so that they are equally long among the nodes.
 	 * This is needed so that Trickle algo can operate efficiently.
@@ -774,7 +808,7 @@ int net_rpl_dis_send(struct in6_addr *dst, struct net_if *iface)
 	return ret;
 }
 
-static enum net_verdict handle_dis(struct net_buf *buf)
+static enum net_verdict dis_input(struct net_buf *buf)
 {
 	struct net_rpl_instance *instance;
 
@@ -1074,6 +1108,7 @@ static void route_mcast_rm_cb(struct net_route_entry_mcast *route,
 static void net_rpl_remove_routes(struct net_rpl_dag *dag)
 {
 	net_route_foreach(route_rm_cb, dag);
+	net_rpl_downward_del_by_dag(dag);
 
 #if NET_RPL_MULTICAST
 	net_route_mcast_foreach(route_mcast_rm_cb, dag);
@@ -1468,9 +1503,7 @@ static struct net_rpl_parent *net_rpl_add_parent(struct net_if *iface,
 		lladdr.addr = lladdr_storage->addr;
 		lladdr.len = lladdr_storage->len;
 
-		rpl_nbr = net_nbr_lookup(&net_rpl_parents.table,
-					 iface,
-					 &lladdr);
+		rpl_nbr = nbr_lookup(iface, nbr->idx);
 		if (!rpl_nbr) {
 			NET_DBG("Add parent %s [%s]",
 				net_sprint_ipv6_addr(addr),
@@ -1711,14 +1744,24 @@ static struct net_rpl_parent *best_parent(struct net_if *iface,
 	struct net_rpl_parent *best = NULL;
 	int i;
 
+	NET_STATS_RPL(net_stats.rpl.parent_scans++);
+
 	for (i = 0; i < CONFIG_NET_IPV6_MAX_NEIGHBORS; i++) {
 		struct net_nbr *nbr = get_nbr(i);
 		struct net_rpl_parent *parent;
 
+		if (!nbr->ref) {
+			continue;
+		}
+
 		parent = nbr_data(nbr);
+		if (parent->dag != dag) {
+			continue;
+		}
+
+		parent->flags &= ~NET_RPL_PARENT_FLAG_UPDATED;
 
-		if (parent->dag != dag ||
-		    parent->rank == NET_RPL_INFINITE_RANK) {
+		if (parent->rank == NET_RPL_INFINITE_RANK) {
 			/* ignore this neighbor */
 		} else if (!best) {
 			best = parent;
@@ -1727,13 +1770,36 @@ static struct net_rpl_parent *best_parent(struct net_if *iface,
 		}
 	}
 
+	dag->parents_updated = 0;
+
 	return best;
 }
 
-static struct net_rpl_parent *net_rpl_select_parent(struct net_if *iface,
-						    struct net_rpl_dag *dag)
+/* Select the preferred parent of the DAG after the information of the
+ * updated parent has changed. The other parents are as they were when the
+ * preferred parent was chosen, so unless the preferred parent itself has
+ * changed, the updated parent only needs to be compared with it.
+ */
+static
+struct net_rpl_parent *net_rpl_select_parent(struct net_if *iface,
+					      struct net_rpl_dag *dag,
+					      struct net_rpl_parent *updated)
 {
-	struct net_rpl_parent *best = best_parent(iface, dag);
+	struct net_rpl_parent *best = dag->preferred_parent;
+
+	if (best && best != updated && best->dag == dag &&
+	    best->rank != NET_RPL_INFINITE_RANK &&
+	    updated && updated->dag == dag && !dag->parents_updated) {
+		NET_STATS_RPL(net_stats.rpl.parent_updates++);
+
+		updated->flags &= ~NET_RPL_PARENT_FLAG_UPDATED;
+
+		if (updated->rank != NET_RPL_INFINITE_RANK) {
+			best = net_rpl_of_best_parent(iface, best, updated);
+		}
+	} else {
+		best = best_parent(iface, dag);
+	}
 
 	if (best) {
 		net_rpl_set_preferred_parent(iface, dag, best);
@@ -1767,7 +1833,7 @@ struct net_rpl_dag *net_rpl_select_dag(struct net_if *iface,
 
 	if (best_dag->rank != NET_RPL_ROOT_RANK(instance)) {
 
-		if (net_rpl_select_parent(iface, parent->dag)) {
+		if (net_rpl_select_parent(iface, parent->dag, parent)) {
 			if (parent->dag != best_dag) {
 				best_dag = net_rpl_of_best_dag(best_dag,
 							       parent->dag);
@@ -2248,7 +2314,7 @@ struct net_rpl_parent *find_parent_any_dag_any_instance(struct net_if *iface,
 		return NULL;
 	}
 
-	rpl_nbr = nbr_lookup(&net_rpl_parents.table, iface, addr);
+	rpl_nbr = nbr_lookup(iface, nbr->idx);
 	if (!rpl_nbr) {
 		return NULL;
 	}
@@ -2299,6 +2365,19 @@ struct net_rpl_parent *find_parent_any_dag(struct net_if *iface,
 	return NULL;
 }
 
+/* The information of a parent has changed outside of DIO processing. Any
+ * parent of the DAG may now be the best one, so the whole parent set is
+ * scanned the next time the preferred parent is selected.
+ */
+static inline void net_rpl_parent_updated(struct net_rpl_parent *parent)
+{
+	parent->flags |= NET_RPL_PARENT_FLAG_UPDATED;
+
+	if (parent->dag) {
+		parent->dag->parents_updated = 1;
+	}
+}
+
 static void net_rpl_move_parent(struct net_if *iface,
 				struct net_rpl_dag *dag_src,
 				struct net_rpl_dag *dag_dst,
@@ -2324,6 +2403,7 @@ static void net_rpl_move_parent(struct net_if *iface,
 		 * which has correct DAG pointer.
 		 */
 		net_route_del_by_nexthop_data(iface, addr, dag_src);
+		net_rpl_downward_del_by_nexthop(iface, addr, dag_src);
 	}
 
 	NET_DBG("Moving parent %s", net_sprint_ipv6_addr(addr));
@@ -2354,7 +2434,7 @@ static void net_rpl_link_neighbor_callback(struct net_if *iface,
 			/* Trigger DAG rank recalculation. */
 			NET_DBG("Neighbor link callback triggering update");
 
-			parent->flags |= NET_RPL_PARENT_FLAG_UPDATED;
+			net_rpl_parent_updated(parent);
 
 			/* FIXME - Last parameter value (number of
 			 * transmissions) needs adjusting if possible.
@@ -2664,12 +2744,12 @@ static void net_rpl_process_dio(struct net_if *iface,
 	parent->dtsn = dio->dtsn;
 }
 
-static enum net_verdict handle_dio(struct net_buf *buf)
+static enum net_verdict dio_input(struct net_buf *buf)
 {
 	struct net_rpl_dio dio = { 0 };
-	struct net_buf *frag;
+	struct net_nbuf_cursor cursor;
 	struct net_nbr *nbr;
-	uint16_t offset, pos;
+	uint16_t offset;
 	uint8_t subopt_type;
 	uint8_t flags, len, tmp;
 
@@ -2711,51 +2791,51 @@ static enum net_verdict handle_dio(struct net_buf *buf)
 	offset += sizeof(struct net_icmp_hdr);
 
 	/* First the DIO option. */
-	frag = net_nbuf_read_u8(buf->frags, offset, &pos, &dio.instance_id);
-	frag = net_nbuf_read_u8(frag, pos, &pos, &dio.version);
-	frag = net_nbuf_read_be16(frag, pos, &pos, &dio.rank);
+	net_nbuf_cursor_init(&cursor, buf, buf->frags, offset);
+
+	net_nbuf_cursor_read_u8(&cursor, &dio.instance_id);
+	net_nbuf_cursor_read_u8(&cursor, &dio.version);
+	net_nbuf_cursor_read_be16(&cursor, &dio.rank);
 
 	NET_DBG("Incoming DIO len %d id %d ver %d rank %d",
 		net_buf_frags_len(buf) - offset,
 		dio.instance_id, dio.version, dio.rank);
 
-	frag = net_nbuf_read_u8(frag, pos, &pos, &flags);
+	net_nbuf_cursor_read_u8(&cursor, &flags);
 
 	dio.grounded = flags & NET_RPL_DIO_GROUNDED;
 	dio.mop = (flags & NET_RPL_DIO_MOP_MASK) >> NET_RPL_DIO_MOP_SHIFT;
 	dio.preference = flags & NET_RPL_DIO_PREFERENCE_MASK;
 
-	frag = net_nbuf_read_u8(frag, pos, &pos, &dio.dtsn);
+	net_nbuf_cursor_read_u8(&cursor, &dio.dtsn);
 
 	/* two reserved bytes */
-	frag = net_nbuf_skip(frag, pos, &pos, 2);
+	net_nbuf_cursor_skip(&cursor, 2);
 
-	frag = net_nbuf_read(frag, pos, &pos, sizeof(dio.dag_id),
+	net_nbuf_cursor_read(&cursor, sizeof(dio.dag_id),
 			     dio.dag_id.s6_addr);
 
 	NET_DBG("Incoming DIO dag_id %s pref %d",
 		net_sprint_ipv6_addr(&dio.dag_id), dio.preference);
 
-	/* Handle any DIO suboptions */
-	while (frag) {
-		frag = net_nbuf_read_u8(frag, pos, &pos, &subopt_type);
-
-		if (pos == 0) {
-			/* We are at the end of the message */
-			frag = NULL;
-			break;
-		}
+	if (cursor.error) {
+		NET_DBG("Invalid DIO packet");
+		NET_STATS_RPL(net_stats.rpl.malformed_msgs++);
+		goto out;
+	}
 
+	/* Handle any DIO suboptions */
+	while (net_nbuf_cursor_read_u8(&cursor, &subopt_type)) {
 		if (subopt_type == NET_RPL_OPTION_PAD1) {
 			len = 1;
 		} else {
 			/* Suboption with a two-byte header + payload */
-			frag = net_nbuf_read_u8(frag, pos, &pos, &tmp);
+			net_nbuf_cursor_read_u8(&cursor, &tmp);
 
 			len = 2 + tmp;
 		}
 
-		if (!frag && pos) {
+		if (cursor.error) {
 			NET_DBG("Invalid DIO packet");
 			NET_STATS_RPL(net_stats.rpl.malformed_msgs++);
 			goto out;
@@ -2771,18 +2851,17 @@ static enum net_verdict handle_dio(struct net_buf *buf)
 				goto out;
 			}
 
-			frag = net_nbuf_read_u8(frag, pos, &pos, &dio.mc.type);
-			frag = net_nbuf_read_u8(frag, pos, &pos, &tmp);
+			net_nbuf_cursor_read_u8(&cursor, &dio.mc.type);
+			net_nbuf_cursor_read_u8(&cursor, &tmp);
 			dio.mc.flags = tmp << 1;
-			frag = net_nbuf_read_u8(frag, pos, &pos, &tmp);
+			net_nbuf_cursor_read_u8(&cursor, &tmp);
 			dio.mc.flags |= tmp >> 7;
 			dio.mc.aggregated = (tmp >> 4) & 0x3;
 			dio.mc.precedence = tmp & 0xf;
-			frag = net_nbuf_read_u8(frag, pos, &pos,
-						&dio.mc.length);
+			net_nbuf_cursor_read_u8(&cursor, &dio.mc.length);
 
 			if (dio.mc.type == NET_RPL_MC_ETX) {
-				frag = net_nbuf_read_be16(frag, pos, &pos,
+				net_nbuf_cursor_read_be16(&cursor,
 							  &dio.mc.obj.etx);
 
 				NET_DBG("DAG MC type %d flags %d aggr %d "
@@ -2793,9 +2872,9 @@ static enum net_verdict handle_dio(struct net_buf *buf)
 					dio.mc.obj.etx);
 
 			} else if (dio.mc.type == NET_RPL_MC_ENERGY) {
-				frag = net_nbuf_read_u8(frag, pos, &pos,
-						     &dio.mc.obj.energy.flags);
-				frag = net_nbuf_read_u8(frag, pos, &pos,
+				net_nbuf_cursor_read_u8(&cursor,
+						&dio.mc.obj.energy.flags);
+				net_nbuf_cursor_read_u8(&cursor,
 						&dio.mc.obj.energy.estimation);
 			} else {
 				NET_DBG("Unhandled DAG MC type %d",
@@ -2812,16 +2891,16 @@ static enum net_verdict handle_dio(struct net_buf *buf)
 				goto out;
 			}
 
-			frag = net_nbuf_read_u8(frag, pos, &pos,
+			net_nbuf_cursor_read_u8(&cursor,
 					&dio.destination_prefix.length);
-			frag = net_nbuf_read_u8(frag, pos, &pos,
+			net_nbuf_cursor_read_u8(&cursor,
 					&dio.destination_prefix.flags);
-			frag = net_nbuf_read_be32(frag, pos, &pos,
+			net_nbuf_cursor_read_be32(&cursor,
 					&dio.destination_prefix.lifetime);
 
 			if (((dio.destination_prefix.length + 7) / 8) + 8 <=
 			    len && dio.destination_prefix.length <= 128) {
-				frag = net_nbuf_read(frag, pos, &pos,
+				net_nbuf_cursor_read(&cursor,
 				       (dio.destination_prefix.length + 7) / 8,
 				       dio.destination_prefix.prefix.s6_addr);
 
@@ -2846,27 +2925,23 @@ static enum net_verdict handle_dio(struct net_buf *buf)
 			}
 
 			/* Path control field not yet implemented (1 byte) */
-			frag = net_nbuf_skip(frag, pos, &pos, 1);
-
-			frag = net_nbuf_read_u8(frag, pos, &pos,
-					     &dio.dag_interval_doublings);
-			frag = net_nbuf_read_u8(frag, pos, &pos,
-					     &dio.dag_interval_min);
-			frag = net_nbuf_read_u8(frag, pos, &pos,
-					     &dio.dag_redundancy);
-			frag = net_nbuf_read_be16(frag, pos, &pos,
-						  &dio.max_rank_inc);
-			frag = net_nbuf_read_be16(frag, pos, &pos,
+			net_nbuf_cursor_skip(&cursor, 1);
+
+			net_nbuf_cursor_read_u8(&cursor,
+						&dio.dag_interval_doublings);
+			net_nbuf_cursor_read_u8(&cursor, &dio.dag_interval_min);
+			net_nbuf_cursor_read_u8(&cursor, &dio.dag_redundancy);
+			net_nbuf_cursor_read_be16(&cursor, &dio.max_rank_inc);
+			net_nbuf_cursor_read_be16(&cursor,
 						  &dio.min_hop_rank_inc);
-			frag = net_nbuf_read_be16(frag, pos, &pos,
-						  &dio.ocp);
+			net_nbuf_cursor_read_be16(&cursor, &dio.ocp);
 
 			/* one reserved byte */
-			frag = net_nbuf_skip(frag, pos, &pos, 1);
+			net_nbuf_cursor_skip(&cursor, 1);
 
-			frag = net_nbuf_read_u8(frag, pos, &pos,
-					     &dio.default_lifetime);
-			frag = net_nbuf_read_be16(frag, pos, &pos,
+			net_nbuf_cursor_read_u8(&cursor,
+						&dio.default_lifetime);
+			net_nbuf_cursor_read_be16(&cursor,
 						  &dio.lifetime_unit);
 
 			NET_DBG("DAG conf dbl %d min %d red %d maxinc %d "
@@ -2886,23 +2961,22 @@ static enum net_verdict handle_dio(struct net_buf *buf)
 				goto out;
 			}
 
-			frag = net_nbuf_read_u8(frag, pos, &pos,
-					     &dio.prefix_info.length);
-			frag = net_nbuf_read_u8(frag, pos, &pos,
-					     &dio.prefix_info.flags);
+			net_nbuf_cursor_read_u8(&cursor,
+						&dio.prefix_info.length);
+			net_nbuf_cursor_read_u8(&cursor,
+						&dio.prefix_info.flags);
 
 			/* skip valid lifetime atm */
-			frag = net_nbuf_skip(frag, pos, &pos, 4);
+			net_nbuf_cursor_skip(&cursor, 4);
 
 			/* preferred lifetime stored in lifetime */
-			frag = net_nbuf_read_be32(frag, pos, &pos,
+			net_nbuf_cursor_read_be32(&cursor,
 						  &dio.prefix_info.lifetime);
 
 			/* 32-bit reserved */
-			frag = net_nbuf_skip(frag, pos, &pos, 4);
+			net_nbuf_cursor_skip(&cursor, 4);
 
-			frag = net_nbuf_read(frag, pos, &pos,
-					     sizeof(struct in6_addr),
+			net_nbuf_cursor_read(&cursor, sizeof(struct in6_addr),
 					     dio.prefix_info.prefix.s6_addr);
 
 			NET_DBG("Prefix %s/%d",
@@ -2913,10 +2987,18 @@ static enum net_verdict handle_dio(struct net_buf *buf)
 		default:
 			NET_DBG("Unsupported suboption type in DIO %d",
 				subopt_type);
+
+			if (len > 2) {
+				net_nbuf_cursor_skip(&cursor, len - 2);
+			}
 		}
-	}
 
-	NET_ASSERT_INFO(!pos && !frag, "DIO reading failure");
+		if (cursor.error) {
+			NET_DBG("Truncated DIO option %u", subopt_type);
+			NET_STATS_RPL(net_stats.rpl.malformed_msgs++);
+			goto out;
+		}
+	}
 
 	net_rpl_process_dio(net_nbuf_iface(buf), &NET_IPV6_BUF(buf)->src,
 			    &dio);
@@ -3155,7 +3237,7 @@ static void forwarding_dao(struct net_rpl_instance *instance,
 	}
 }
 
-static enum net_verdict handle_dao(struct net_buf *buf)
+static enum net_verdict dao_input(struct net_buf *buf)
 {
 	struct in6_addr *dao_sender = &NET_IPV6_BUF(buf)->src;
 	struct net_rpl_route_entry *extra = NULL;
@@ -3163,12 +3245,11 @@ static enum net_verdict handle_dao(struct net_buf *buf)
 	enum net_rpl_route_source learned_from;
 	struct net_rpl_instance *instance;
 	struct net_route_entry *route;
+	struct net_nbuf_cursor cursor;
 	struct net_rpl_dag *dag;
-	struct net_buf *frag;
 	struct in6_addr addr;
 	struct net_nbr *nbr;
 	uint16_t offset;
-	uint16_t pos;
 	uint8_t sequence;
 	uint8_t instance_id;
 	uint8_t lifetime;
@@ -3184,7 +3265,9 @@ static enum net_verdict handle_dao(struct net_buf *buf)
 
 	offset += sizeof(struct net_icmp_hdr);
 
-	frag = net_nbuf_read_u8(buf->frags, offset, &pos, &instance_id);
+	net_nbuf_cursor_init(&cursor, buf, buf->frags, offset);
+
+	net_nbuf_cursor_read_u8(&cursor, &instance_id);
 
 	instance = net_rpl_get_instance(instance_id);
 	if (!instance) {
@@ -3195,16 +3278,15 @@ static enum net_verdict handle_dao(struct net_buf *buf)
 
 	lifetime = instance->default_lifetime;
 
-	frag = net_nbuf_read_u8(frag, pos, &pos, &flags);
-	frag = net_nbuf_skip(frag, pos, &pos, 1); /* reserved */
-	frag = net_nbuf_read_u8(frag, pos, &pos, &sequence);
+	net_nbuf_cursor_read_u8(&cursor, &flags);
+	net_nbuf_cursor_skip(&cursor, 1); /* reserved */
+	net_nbuf_cursor_read_u8(&cursor, &sequence);
 
 	dag = instance->current_dag;
 
 	/* Is the DAG ID present? */
 	if (flags & NET_RPL_DAO_D_FLAG) {
-		frag = net_nbuf_read(frag, pos, &pos, sizeof(addr),
-				     addr.s6_addr);
+		net_nbuf_cursor_read(&cursor, sizeof(addr), addr.s6_addr);
 
 		if (memcmp(&dag->dag_id, &addr, sizeof(dag->dag_id))) {
 			NET_DBG("Ignoring DAO for a DAG %s different from ours",
@@ -3235,7 +3317,7 @@ static enum net_verdict handle_dao(struct net_buf *buf)
 				NET_RPL_DAG_RANK(parent->rank, instance),
 				NET_RPL_DAG_RANK(dag->rank, instance));
 			parent->rank = NET_RPL_INFINITE_RANK;
-			parent->flags |= NET_RPL_PARENT_FLAG_UPDATED;
+			net_rpl_parent_updated(parent);
 			return NET_DROP;
 		}
 
@@ -3244,35 +3326,33 @@ static enum net_verdict handle_dao(struct net_buf *buf)
 			NET_DBG("Loop detected when receiving a unicast DAO "
 				"from our parent");
 			parent->rank = NET_RPL_INFINITE_RANK;
-			parent->flags |= NET_RPL_PARENT_FLAG_UPDATED;
+			net_rpl_parent_updated(parent);
 			return NET_DROP;
 		}
 	}
 
 	target_len = 0;
 
-	/* Handle any DAO suboptions */
-	while (frag) {
-		frag = net_nbuf_read_u8(frag, pos, &pos, &subopt_type);
-
-		if (pos == 0) {
-			/* We are at the end of the message */
-			frag = NULL;
-			break;
-		}
+	if (cursor.error) {
+		NET_DBG("Invalid DAO packet");
+		NET_STATS_RPL(net_stats.rpl.malformed_msgs++);
+		goto out;
+	}
 
+	/* Handle any DAO suboptions */
+	while (net_nbuf_cursor_read_u8(&cursor, &subopt_type)) {
 		if (subopt_type == NET_RPL_OPTION_PAD1) {
 			len = 1;
 		} else {
 			uint8_t tmp;
 
 			/* Suboption with a two-byte header + payload */
-			frag = net_nbuf_read_u8(frag, pos, &pos, &tmp);
+			net_nbuf_cursor_read_u8(&cursor, &tmp);
 
 			len = 2 + tmp;
 		}
 
-		if (!frag && pos) {
+		if (cursor.error) {
 			NET_DBG("Invalid DAO packet");
 			NET_STATS_RPL(net_stats.rpl.malformed_msgs++);
 			goto out;
@@ -3282,18 +3362,31 @@ static enum net_verdict handle_dao(struct net_buf *buf)
 
 		switch (subopt_type) {
 		case NET_RPL_OPTION_TARGET:
-			frag = net_nbuf_skip(frag, pos, &pos, 1); /* reserved */
-			frag = net_nbuf_read_u8(frag, pos, &pos, &target_len);
-			frag = net_nbuf_read(frag, pos, &pos,
-					     (target_len + 7) / 8,
+			net_nbuf_cursor_skip(&cursor, 1); /* reserved */
+			net_nbuf_cursor_read_u8(&cursor, &target_len);
+
+			if (target_len > 128) {
+				NET_DBG("Invalid DAO target length %d",
+					target_len);
+				NET_STATS_RPL(net_stats.rpl.malformed_msgs++);
+				goto out;
+			}
+
+			net_nbuf_cursor_read(&cursor, (target_len + 7) / 8,
 					     addr.s6_addr);
 			break;
 		case NET_RPL_OPTION_TRANSIT:
 			/* The path sequence and control are ignored. */
-			frag = net_nbuf_skip(frag, pos, &pos, 2);
-			frag = net_nbuf_read_u8(frag, pos, &pos, &lifetime);
+			net_nbuf_cursor_skip(&cursor, 2);
+			net_nbuf_cursor_read_u8(&cursor, &lifetime);
 			break;
 		}
+
+		if (cursor.error) {
+			NET_DBG("Truncated DAO option %u", subopt_type);
+			NET_STATS_RPL(net_stats.rpl.malformed_msgs++);
+			goto out;
+		}
 	}
 
 	NET_DBG("DAO lifetime %d addr %s/%d", lifetime,
@@ -3318,6 +3411,7 @@ static enum net_verdict handle_dao(struct net_buf *buf)
 
 	if (lifetime == NET_RPL_ZERO_LIFETIME) {
 		struct in6_addr *nexthop;
+		bool no_path = false;
 
 		NET_DBG("No-Path DAO received");
 
@@ -3326,14 +3420,22 @@ static enum net_verdict handle_dao(struct net_buf *buf)
 		nexthop = net_route_get_nexthop(route);
 
 		/* No-Path DAO received; invoke the route purging routine. */
-		if (route && !extra->no_path_received &&
-		    route->prefix_len == target_len && nexthop &&
-		    net_ipv6_addr_cmp(nexthop, dao_sender)) {
-			NET_DBG("Setting expiration timer for target %s",
-				net_sprint_ipv6_addr(&addr));
-
+		if (target_len == 128 &&
+		    net_rpl_downward_no_path(net_nbuf_iface(buf), &addr,
+					     dao_sender,
+					     NET_RPL_DAO_EXPIRATION_TIMEOUT)) {
+			no_path = true;
+		} else if (route && !extra->no_path_received &&
+			   route->prefix_len == target_len && nexthop &&
+			   net_ipv6_addr_cmp(nexthop, dao_sender)) {
 			extra->no_path_received = true;
 			extra->lifetime = NET_RPL_DAO_EXPIRATION_TIMEOUT;
+			no_path = true;
+		}
+
+		if (no_path) {
+			NET_DBG("Setting expiration timer for target %s",
+				net_sprint_ipv6_addr(&addr));
 
 			/* We forward the incoming no-path DAO to our parent,
 			 * if we have one.
@@ -3384,6 +3486,22 @@ static enum net_verdict handle_dao(struct net_buf *buf)
 					   net_nbuf_ll_src(buf)->len));
 	}
 
+#if defined(CONFIG_NET_RPL_DOWNWARD_ROUTES)
+	/* Host routes go to the route store, the route table is used for
+	 * prefixes and when the store is full.
+	 */
+	if (target_len == 128 &&
+	    !net_rpl_downward_add(dag, net_nbuf_iface(buf), &addr,
+				  dao_sender,
+				  net_rpl_lifetime(instance, lifetime))) {
+		if (route && route->prefix_len == 128) {
+			net_route_del(route);
+		}
+
+		goto fwd_dao;
+	}
+#endif
+
 	route = net_rpl_add_route(dag, net_nbuf_iface(buf),
 				  &addr, target_len, dao_sender);
 	if (!route) {
@@ -3393,13 +3511,12 @@ static enum net_verdict handle_dao(struct net_buf *buf)
 		return NET_DROP;
 	}
 
-	if (extra) {
-		extra->lifetime = net_rpl_lifetime(instance, lifetime);
-		extra->route_source = learned_from;
-		extra->no_path_received = false;
-	}
+	extra = net_nbr_extra_data(net_route_get_nbr(route));
+	extra->lifetime = net_rpl_lifetime(instance, lifetime);
+	extra->route_source = learned_from;
+	extra->no_path_received = false;
 
-#if NET_RPL_MULTICAST
+#if NET_RPL_MULTICAST || defined(CONFIG_NET_RPL_DOWNWARD_ROUTES)
 fwd_dao:
 #endif
 
@@ -3421,13 +3538,55 @@ out:
 	return NET_DROP;
 }
 
-static enum net_verdict handle_dao_ack(struct net_buf *buf)
+static enum net_verdict dao_ack_input(struct net_buf *buf)
 {
 	net_rpl_info(buf, "Destination Advertisement Object Ack");
 
+	return NET_DROP;
+}
+
+static enum net_verdict handle_dis(struct net_buf *buf)
+{
+	enum net_verdict verdict;
+
+	NET_STATS_RPL_DIS(++net_stats.rpl.dis.recv);
+
+	NET_PROFILE(NET_PROFILE_RPL_RX, verdict = dis_input(buf));
+
+	return verdict;
+}
+
+static enum net_verdict handle_dio(struct net_buf *buf)
+{
+	enum net_verdict verdict;
+
+	NET_STATS_RPL(++net_stats.rpl.dio.recv);
+
+	NET_PROFILE(NET_PROFILE_RPL_RX, verdict = dio_input(buf));
+
+	return verdict;
+}
+
+static enum net_verdict handle_dao(struct net_buf *buf)
+{
+	enum net_verdict verdict;
+
+	NET_STATS_RPL(++net_stats.rpl.dao.recv);
+
+	NET_PROFILE(NET_PROFILE_RPL_RX, verdict = dao_input(buf));
+
+	return verdict;
+}
+
+static enum net_verdict handle_dao_ack(struct net_buf *buf)
+{
+	enum net_verdict verdict;
+
 	NET_STATS_RPL(++net_stats.rpl.dao_ack.recv);
 
-	return NET_DROP;
+	NET_PROFILE(NET_PROFILE_RPL_RX, verdict = dao_ack_input(buf));
+
+	return verdict;
 }
 
 static struct net_icmpv6_handler dodag_info_solicitation_handler = {
@@ -3584,6 +3743,9 @@ bool net_rpl_verify_header(struct net_buf *buf,
 			net_route_del(route);
 		}
 
+		net_rpl_downward_del(net_nbuf_iface(buf),
+				     &NET_IPV6_BUF(buf)->dst);
+
 		NET_STATS_RPL(net_stats.rpl.forward_errors++);
 
 		/* Trigger DAO retransmission */
@@ -3708,7 +3870,7 @@ static int net_rpl_update_header_empty(struct net_buf *buf)
 	struct net_buf *frag = buf->frags;
 	struct net_rpl_instance *instance;
 	struct net_rpl_parent *parent;
-	struct net_route_entry *route;
+	bool has_route;
 	uint8_t next_hdr, len, length;
 	uint8_t opt_type = 0, opt_len;
 	uint8_t instance_id, flags;
@@ -3786,7 +3948,9 @@ static int net_rpl_update_header_empty(struct net_buf *buf)
 
 	offset -= 2; /* move back to flags */
 
-	route = net_route_lookup(net_nbuf_iface(buf), &NET_IPV6_BUF(buf)->dst);
+	has_route = net_rpl_downward_lookup(net_nbuf_iface(buf),
+					    &NET_IPV6_BUF(buf)->dst) ||
+		net_route_lookup(net_nbuf_iface(buf), &NET_IPV6_BUF(buf)->dst);
 
 	/*
 	 * Check the direction of the down flag, as per
@@ -3797,7 +3961,7 @@ static int net_rpl_update_header_empty(struct net_buf *buf)
 	if (flags & NET_RPL_HDR_OPT_DOWN) {
 		struct net_nbr *nbr;
 
-		if (!route) {
+		if (!has_route) {
 			net_nbuf_write_u8(buf, frag, offset, &pos,
 					  flags |= NET_RPL_HDR_OPT_FWD_ERR);
 
@@ -3835,7 +3999,7 @@ static int net_rpl_update_header_empty(struct net_buf *buf)
 	 * along a DAO route, the down flag should be set.
 	 */
 
-	if (!route) {
+	if (!has_route) {
 		/* No route was found, so this packet will go
 		 * towards the RPL root. If so, we should not
 		 * set the down flag.
@@ -3923,6 +4087,8 @@ void net_rpl_init(void)
 
 	rpl_dao_sequence = net_rpl_lollipop_init();
 
+	net_rpl_downward_init();
+
 	net_rpl_init_timers();
 
 	create_linklocal_rplnodes_mcast(&addr);
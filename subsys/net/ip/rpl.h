@@ -303,7 +303,12 @@ struct net_rpl_dag {
 	/** Is DAG joined or not. */
 	uint8_t is_joined : 1;
 
-	uint8_t _unused : 2;
+	/** A parent has changed outside of DIO processing, so all the
+	 * parents need to be compared when selecting the preferred one.
+	 */
+	uint8_t parents_updated : 1;
+
+	uint8_t _unused : 1;
 };
 
 /**
@@ -315,6 +320,17 @@ struct net_rpl_dag {
  */
 struct net_nbr *net_rpl_get_nbr(struct net_rpl_parent *data);
 
+/**
+ * @brief Get the IPv6 neighbor of a parent.
+ *
+ * @details The IPv6 neighbor holds the link metric of the parent.
+ *
+ * @param parent Pointer to parent.
+ *
+ * @return IPv6 neighbor pointer if found, NULL otherwise.
+ */
+struct net_nbr *net_rpl_get_ipv6_nbr(struct net_rpl_parent *parent);
+
 /**
  * @brief RPL object function (OF) reset.
  *
@@ -966,11 +982,114 @@ void net_rpl_set_mode(enum net_rpl_mode new_mode);
  */
 enum net_rpl_mode net_rpl_get_mode(void);
 
+#if defined(CONFIG_NET_RPL_DOWNWARD_ROUTES)
+/**
+ * @brief Add or refresh the downward route to a DAO target.
+ *
+ * @details Only host routes are stored, prefix targets use the route
+ * table.
+ *
+ * @param dag DAG the route was learned in.
+ * @param iface Network interface of the route.
+ * @param target IPv6 address of the target.
+ * @param nexthop IPv6 address of the next hop, it must be in the
+ * neighbor cache.
+ * @param lifetime Lifetime of the route in seconds.
+ *
+ * @return 0 if ok, -ENOENT if the next hop is not a neighbor, -ENOMEM
+ * if the store is full.
+ */
+int net_rpl_downward_add(struct net_rpl_dag *dag, struct net_if *iface,
+			 struct in6_addr *target, struct in6_addr *nexthop,
+			 uint32_t lifetime);
+
+/**
+ * @brief Start expiring the route to a target after a No-Path DAO.
+ *
+ * @param iface Network interface of the route.
+ * @param target IPv6 address of the target.
+ * @param nexthop IPv6 address of the neighbor that sent the DAO.
+ * @param lifetime Time in seconds the route is still kept.
+ *
+ * @return True if the route goes through nexthop and no No-Path DAO was
+ * received for it before, false otherwise.
+ */
+bool net_rpl_downward_no_path(struct net_if *iface, struct in6_addr *target,
+			      struct in6_addr *nexthop, uint32_t lifetime);
+
+/**
+ * @brief Get the next hop towards a DAO target.
+ *
+ * @param iface Network interface of the route, NULL for any.
+ * @param addr IPv6 address of the target.
+ *
+ * @return IPv6 address of the next hop, or NULL if there is no route.
+ */
+struct in6_addr *net_rpl_downward_lookup(struct net_if *iface,
+					 struct in6_addr *addr);
+
+/**
+ * @brief Remove the route to a DAO target.
+ *
+ * @param iface Network interface of the route, NULL for any.
+ * @param target IPv6 address of the target.
+ *
+ * @return True if the route was removed, false if there was none.
+ */
+bool net_rpl_downward_del(struct net_if *iface, struct in6_addr *target);
+
+/**
+ * @brief Remove the routes that were learned in a DAG.
+ *
+ * @param dag DAG of the routes.
+ *
+ * @return Number of routes removed.
+ */
+int net_rpl_downward_del_by_dag(struct net_rpl_dag *dag);
+
+/**
+ * @brief Remove the routes of a DAG that go through a next hop.
+ *
+ * @param iface Network interface of the next hop.
+ * @param nexthop IPv6 address of the next hop.
+ * @param dag DAG of the routes.
+ *
+ * @return Number of routes removed.
+ */
+int net_rpl_downward_del_by_nexthop(struct net_if *iface,
+				    struct in6_addr *nexthop,
+				    struct net_rpl_dag *dag);
+
+/**
+ * @brief Get the number of routes in the store.
+ *
+ * @return Number of routes.
+ */
+int net_rpl_downward_count(void);
+
+/**
+ * @brief Get the memory used by the store.
+ *
+ * @return Size of the store in bytes.
+ */
+size_t net_rpl_downward_size(void);
+
+void net_rpl_downward_init(void);
+#else
+#define net_rpl_downward_no_path(...) false
+#define net_rpl_downward_lookup(...) NULL
+#define net_rpl_downward_del(...)
+#define net_rpl_downward_del_by_dag(...)
+#define net_rpl_downward_del_by_nexthop(...)
+#define net_rpl_downward_init(...)
+#endif /* CONFIG_NET_RPL_DOWNWARD_ROUTES */
+
 void net_rpl_init(void);
 #else
 #define net_rpl_init(...)
 #define net_rpl_global_repair(...)
 #define net_rpl_update_header(...) 0
+#define net_rpl_downward_lookup(...) NULL
 #endif /* CONFIG_NET_RPL */
 
 #ifdef __cplusplus
@@ -0,0 +1,1208 @@
+/** @file
+ * @brief BSD socket like API
+ *
+ * Sockets on top of the network contexts.
+ */
+
+/*
+ * Copyright (c) 2016 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#if defined(CONFIG_NET_DEBUG_SOCKETS)
+#define SYS_LOG_DOMAIN "net/sock"
+#define NET_DEBUG 1
+#endif
+
+#include <kernel.h>
+#include <string.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <atomic.h>
+#include <misc/slist.h>
+
+#include <net/nbuf.h>
+#include <net/net_ip.h>
+#include <net/net_context.h>
+#include <net/socket.h>
+
+#include "net_private.h"
+
+#define SOCK_MAX CONFIG_NET_MAX_CONTEXTS
+
+/* The pollers keep the sockets they wait for in a bit mask */
+#if SOCK_MAX > 32
+#error "CONFIG_NET_MAX_CONTEXTS is too large for the socket layer"
+#endif
+
+/* The stack does not use the MSS of the peer, so data is sent in
+ * segments that every host accepts.
+ */
+#define SOCK_TCP_SEG_IPV6 1220
+#define SOCK_TCP_SEG_IPV4 536
+
+#define SOCK_IN_USE    BIT(0)
+#define SOCK_NONBLOCK  BIT(1)
+#define SOCK_BOUND     BIT(2)
+#define SOCK_LISTENING BIT(3)
+/* Established but still in the queue of the listener */
+#define SOCK_PENDING   BIT(4)
+/* The peer has closed the connection */
+#define SOCK_EOF       BIT(5)
+
+struct net_socket {
+	/** Used by the accept queue of the listening socket */
+	void *fifo_reserved;
+
+	/** Network context, NULL after the peer has closed the
+	 * connection as the stack releases the context itself then.
+	 */
+	struct net_context *ctx;
+
+	/** Received buffers, or the sockets of the established
+	 * connections when listening.
+	 */
+	struct k_fifo recv_q;
+
+	/** Number of entries in recv_q */
+	atomic_t queued;
+
+	/** Buffer being read and where its unread data starts */
+	struct net_buf *recv_buf;
+	struct net_buf *recv_frag;
+	uint8_t *recv_pos;
+	uint16_t recv_left;
+
+	/** Timeout of receive and accept in milliseconds */
+	int32_t recv_timeout;
+
+	/** Pending error, positive errno value */
+	int err;
+
+	/** SOCK_DGRAM or SOCK_STREAM */
+	uint8_t type;
+
+	uint8_t flags;
+};
+
+/** A thread waiting in zsock_poll() or in a blocking call */
+struct sock_waiter {
+	sys_snode_t node;
+
+	/** Sockets the thread waits for, bit per descriptor */
+	uint32_t mask;
+
+	struct k_sem sem;
+};
+
+static struct net_socket sockets[SOCK_MAX];
+
+/* The waiters are woken up from the RX thread, so the list and the
+ * socket state are protected by locking the interrupts.
+ */
+static sys_slist_t waiters;
+
+static inline int sock_fd(struct net_socket *s)
+{
+	return s - sockets;
+}
+
+static struct net_socket *sock_get(int fd)
+{
+	if (fd < 0 || fd >= SOCK_MAX ||
+	    (sockets[fd].flags & (SOCK_IN_USE | SOCK_PENDING)) !=
+	    SOCK_IN_USE) {
+		errno = EBADF;
+		return NULL;
+	}
+
+	return &sockets[fd];
+}
+
+static struct net_socket *sock_alloc(struct net_context *ctx, uint8_t type)
+{
+	struct net_socket *s = NULL;
+	unsigned int key;
+	int i;
+
+	key = irq_lock();
+
+	for (i = 0; i < SOCK_MAX; i++) {
+		if (!(sockets[i].flags & SOCK_IN_USE)) {
+			s = &sockets[i];
+			break;
+		}
+	}
+
+	if (s) {
+		s->ctx = ctx;
+		k_fifo_init(&s->recv_q);
+		atomic_clear(&s->queued);
+		s->recv_buf = NULL;
+		s->recv_timeout = K_FOREVER;
+		s->err = 0;
+		s->type = type;
+		s->flags = SOCK_IN_USE;
+	}
+
+	irq_unlock(key);
+
+	return s;
+}
+
+static struct net_socket *sock_find(struct net_context *ctx)
+{
+	int i;
+
+	for (i = 0; i < SOCK_MAX; i++) {
+		if ((sockets[i].flags & SOCK_IN_USE) &&
+		    sockets[i].ctx == ctx) {
+			return &sockets[i];
+		}
+	}
+
+	return NULL;
+}
+
+static void sock_wake(struct net_socket *s)
+{
+	uint32_t bit = BIT(sock_fd(s));
+	struct sock_waiter *waiter;
+	sys_snode_t *node;
+	unsigned int key;
+
+	key = irq_lock();
+
+	SYS_SLIST_FOR_EACH_NODE(&waiters, node) {
+		waiter = CONTAINER_OF(node, struct sock_waiter, node);
+
+		if (waiter->mask & bit) {
+			k_sem_give(&waiter->sem);
+		}
+	}
+
+	irq_unlock(key);
+}
+
+static void sock_release(struct net_socket *s);
+
+static void sock_flush(struct net_socket *s)
+{
+	struct net_socket *child;
+	struct net_buf *buf;
+
+	if (s->recv_buf) {
+		net_nbuf_unref(s->recv_buf);
+		s->recv_buf = NULL;
+	}
+
+	while (atomic_get(&s->queued)) {
+		atomic_dec(&s->queued);
+
+		if (s->flags & SOCK_LISTENING) {
+			child = k_fifo_get(&s->recv_q, K_NO_WAIT);
+			sock_release(child);
+		} else {
+			buf = net_buf_get_timeout(&s->recv_q, 0, K_NO_WAIT);
+			net_nbuf_unref(buf);
+		}
+	}
+}
+
+static void sock_release(struct net_socket *s)
+{
+	struct net_context *ctx;
+	unsigned int key;
+
+	/* Detach first so that the callbacks do not queue any more */
+	key = irq_lock();
+	ctx = s->ctx;
+	s->ctx = NULL;
+	irq_unlock(key);
+
+	sock_flush(s);
+
+	if (ctx) {
+		net_context_put(ctx);
+	}
+
+	sock_wake(s);
+
+	s->flags = 0;
+}
+
+/* Called in the RX thread */
+static void sock_received(struct net_context *ctx, struct net_buf *buf,
+			  int status, void *user_data)
+{
+	struct net_socket *s;
+	unsigned int key;
+
+	ARG_UNUSED(user_data);
+
+	key = irq_lock();
+
+	s = sock_find(ctx);
+	if (!s) {
+		irq_unlock(key);
+
+		if (buf) {
+			net_nbuf_unref(buf);
+		}
+
+		return;
+	}
+
+	if (!buf) {
+		if (status < 0) {
+			s->err = -status;
+		} else {
+			NET_DBG("Socket %d closed by peer", sock_fd(s));
+
+			s->flags |= SOCK_EOF;
+			s->ctx = NULL;
+		}
+	} else if (s->type == SOCK_STREAM && !net_nbuf_appdatalen(buf)) {
+		/* A plain ACK, empty datagrams are kept */
+		irq_unlock(key);
+		net_nbuf_unref(buf);
+		return;
+	} else {
+		net_buf_put(&s->recv_q, buf);
+		atomic_inc(&s->queued);
+	}
+
+	irq_unlock(key);
+
+	sock_wake(s);
+}
+
+/* Called in the RX thread when the SYN-ACK of the peer is received */
+static void sock_connected(struct net_context *ctx, void *user_data)
+{
+	struct net_socket *s;
+
+	ARG_UNUSED(user_data);
+
+	s = sock_find(ctx);
+	if (s) {
+		sock_wake(s);
+	}
+}
+
+static struct net_socket *find_listener(struct net_context *ctx)
+{
+	uint16_t port = net_sin((struct sockaddr *)&ctx->local)->sin_port;
+	struct net_socket *s;
+	int i;
+
+	for (i = 0; i < SOCK_MAX; i++) {
+		s = &sockets[i];
+
+		if (!(s->flags & SOCK_LISTENING) || !s->ctx ||
+		    net_context_get_family(s->ctx) !=
+		    net_context_get_family(ctx)) {
+			continue;
+		}
+
+		if (net_sin((struct sockaddr *)&s->ctx->local)->sin_port ==
+		    port) {
+			return s;
+		}
+	}
+
+	return NULL;
+}
+
+/* Called in the RX thread when a connection has been established. The
+ * listener gives its own user data to only the first connection, so
+ * the listening socket is found by the local port.
+ */
+static void sock_accepted(struct net_context *ctx, struct sockaddr *addr,
+			  socklen_t addrlen, int status, void *user_data)
+{
+	struct net_socket *listener, *s = NULL;
+	unsigned int key;
+
+	ARG_UNUSED(addr);
+	ARG_UNUSED(addrlen);
+	ARG_UNUSED(user_data);
+
+	if (status < 0) {
+		return;
+	}
+
+	listener = find_listener(ctx);
+	if (listener) {
+		s = sock_alloc(ctx, SOCK_STREAM);
+	}
+
+	if (!s) {
+		NET_DBG("No socket for connection %p", ctx);
+		net_context_put(ctx);
+		return;
+	}
+
+	s->flags |= SOCK_BOUND | SOCK_PENDING;
+
+	/* Data that arrives before zsock_accept() is queued already */
+	net_context_recv(ctx, sock_received, K_NO_WAIT, NULL);
+
+	key = irq_lock();
+	k_fifo_put(&listener->recv_q, s);
+	atomic_inc(&listener->queued);
+	irq_unlock(key);
+
+	sock_wake(listener);
+}
+
+static int sock_events(struct net_socket *s)
+{
+	int events = 0;
+
+	if (s->err) {
+		events |= ZSOCK_POLLERR;
+	}
+
+	if (s->flags & SOCK_LISTENING) {
+		if (atomic_get(&s->queued)) {
+			events |= ZSOCK_POLLIN;
+		}
+
+		return events;
+	}
+
+	if (s->flags & SOCK_EOF) {
+		return events | ZSOCK_POLLIN | ZSOCK_POLLHUP;
+	}
+
+	if (s->recv_buf || atomic_get(&s->queued)) {
+		events |= ZSOCK_POLLIN;
+	}
+
+	if (s->type == SOCK_DGRAM ||
+	    (s->ctx &&
+	     net_context_get_state(s->ctx) == NET_CONTEXT_CONNECTED)) {
+		events |= ZSOCK_POLLOUT;
+	}
+
+	return events;
+}
+
+static int32_t time_left(int32_t timeout, uint32_t start)
+{
+	uint32_t elapsed;
+
+	if (timeout == K_FOREVER) {
+		return K_FOREVER;
+	}
+
+	elapsed = k_uptime_get_32() - start;
+
+	return elapsed < (uint32_t)timeout ? timeout - elapsed : K_NO_WAIT;
+}
+
+static void waiter_add(struct sock_waiter *waiter, uint32_t mask)
+{
+	unsigned int key;
+
+	k_sem_init(&waiter->sem, 0, 1);
+	waiter->mask = mask;
+
+	key = irq_lock();
+	sys_slist_append(&waiters, &waiter->node);
+	irq_unlock(key);
+}
+
+static void waiter_remove(struct sock_waiter *waiter)
+{
+	unsigned int key;
+
+	key = irq_lock();
+	sys_slist_find_and_remove(&waiters, &waiter->node);
+	irq_unlock(key);
+}
+
+/* Wait until one of the events, an error or the end of the connection */
+static int sock_wait(struct net_socket *s, int events, int32_t timeout)
+{
+	struct sock_waiter waiter;
+	uint32_t start;
+	int ret = 0;
+
+	events |= ZSOCK_POLLERR | ZSOCK_POLLHUP;
+
+	if (sock_events(s) & events) {
+		return 0;
+	}
+
+	if (timeout == K_NO_WAIT) {
+		return -EAGAIN;
+	}
+
+	start = k_uptime_get_32();
+
+	/* The waiter is added before checking again, so an event in
+	 * between leaves the semaphore given.
+	 */
+	waiter_add(&waiter, BIT(sock_fd(s)));
+
+	while (!(sock_events(s) & events)) {
+		if (!(s->flags & SOCK_IN_USE) ||
+		    k_sem_take(&waiter.sem, time_left(timeout, start))) {
+			ret = -EAGAIN;
+			break;
+		}
+	}
+
+	waiter_remove(&waiter);
+
+	return ret;
+}
+
+static inline int32_t sock_timeout(struct net_socket *s, int flags)
+{
+	if ((s->flags & SOCK_NONBLOCK) || (flags & ZSOCK_MSG_DONTWAIT)) {
+		return K_NO_WAIT;
+	}
+
+	return s->recv_timeout;
+}
+
+static int sock_bind(struct net_socket *s, const struct sockaddr *addr,
+		     socklen_t addrlen)
+{
+	struct sockaddr local;
+	int ret;
+
+	/* The context writes the chosen port back to the address */
+	memset(&local, 0, sizeof(local));
+	memcpy(&local, addr, min(addrlen, sizeof(local)));
+
+	ret = net_context_bind(s->ctx, &local, addrlen);
+	if (ret < 0) {
+		return ret;
+	}
+
+	s->flags |= SOCK_BOUND;
+
+	/* UDP receives only on the bound port */
+	if (s->type == SOCK_DGRAM) {
+		return net_context_recv(s->ctx, sock_received, K_NO_WAIT,
+					NULL);
+	}
+
+	return 0;
+}
+
+/* Unbound sockets get any address and a free port, like BSD does */
+static int sock_autobind(struct net_socket *s)
+{
+	struct sockaddr addr;
+
+	if (s->flags & SOCK_BOUND) {
+		return 0;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.family = net_context_get_family(s->ctx);
+
+#if defined(CONFIG_NET_IPV6)
+	if (addr.family == AF_INET6) {
+		return sock_bind(s, &addr, sizeof(struct sockaddr_in6));
+	}
+#endif
+
+	return sock_bind(s, &addr, sizeof(struct sockaddr_in));
+}
+
+static socklen_t sock_addr_len(sa_family_t family)
+{
+#if defined(CONFIG_NET_IPV6)
+	if (family == AF_INET6) {
+		return sizeof(struct sockaddr_in6);
+	}
+#endif
+
+	return sizeof(struct sockaddr_in);
+}
+
+static void sock_copy_addr(struct sockaddr *to, socklen_t *tolen,
+			   const struct sockaddr *from)
+{
+	socklen_t len = sock_addr_len(from->family);
+
+	memcpy(to, from, min(*tolen, len));
+	*tolen = len;
+}
+
+/* UDP and TCP headers both start with the ports */
+static void sock_buf_src(struct net_buf *buf, struct sockaddr *addr)
+{
+	uint16_t port = NET_UDP_BUF(buf)->src_port;
+
+	memset(addr, 0, sizeof(*addr));
+
+#if defined(CONFIG_NET_IPV6)
+	if (net_nbuf_family(buf) == AF_INET6) {
+		net_sin6(addr)->sin6_family = AF_INET6;
+		net_sin6(addr)->sin6_port = port;
+		net_ipaddr_copy(&net_sin6(addr)->sin6_addr,
+				&NET_IPV6_BUF(buf)->src);
+		return;
+	}
+#endif
+
+#if defined(CONFIG_NET_IPV4)
+	if (net_nbuf_family(buf) == AF_INET) {
+		net_sin(addr)->sin_family = AF_INET;
+		net_sin(addr)->sin_port = port;
+		net_ipaddr_copy(&net_sin(addr)->sin_addr,
+				&NET_IPV4_BUF(buf)->src);
+	}
+#endif
+}
+
+/* Point the read position to the application data of a new buffer */
+static void sock_recv_start(struct net_socket *s, struct net_buf *buf)
+{
+	struct net_buf *frag = buf->frags;
+	uint8_t *pos = net_nbuf_appdata(buf);
+
+	while (frag && (pos < frag->data || pos > frag->data + frag->len)) {
+		frag = frag->frags;
+	}
+
+	s->recv_buf = buf;
+	s->recv_frag = frag;
+	s->recv_pos = pos;
+	s->recv_left = frag ? net_nbuf_appdatalen(buf) : 0;
+}
+
+static size_t sock_copy(struct net_socket *s, uint8_t *data, size_t len,
+			bool peek)
+{
+	struct net_buf *frag = s->recv_frag;
+	uint8_t *pos = s->recv_pos;
+	size_t left = s->recv_left;
+	size_t copied = 0;
+	size_t chunk;
+
+	while (left && copied < len && frag) {
+		if (pos == frag->data + frag->len) {
+			frag = frag->frags;
+			if (frag) {
+				pos = frag->data;
+			}
+
+			continue;
+		}
+
+		chunk = min((size_t)(frag->data + frag->len - pos),
+			    len - copied);
+		chunk = min(chunk, left);
+
+		memcpy(data + copied, pos, chunk);
+
+		copied += chunk;
+		pos += chunk;
+		left -= chunk;
+	}
+
+	if (!peek) {
+		s->recv_frag = frag;
+		s->recv_pos = pos;
+		s->recv_left = left;
+	}
+
+	return copied;
+}
+
+int zsock_socket(int family, int type, int proto)
+{
+	struct net_context *ctx;
+	struct net_socket *s;
+	int ret;
+
+	if (!proto) {
+		proto = type == SOCK_STREAM ? IPPROTO_TCP : IPPROTO_UDP;
+	}
+
+	ret = net_context_get(family, type, proto, &ctx);
+	if (ret < 0) {
+		errno = -ret;
+		return -1;
+	}
+
+	s = sock_alloc(ctx, type);
+	if (!s) {
+		net_context_put(ctx);
+		errno = ENFILE;
+		return -1;
+	}
+
+	/* TCP delivers to the callback of the context, UDP is registered
+	 * when the port is known.
+	 */
+	if (type == SOCK_STREAM) {
+		net_context_recv(ctx, sock_received, K_NO_WAIT, NULL);
+	}
+
+	NET_DBG("Socket %d context %p", sock_fd(s), ctx);
+
+	return sock_fd(s);
+}
+
+int zsock_close(int sock)
+{
+	struct net_socket *s = sock_get(sock);
+
+	if (!s) {
+		return -1;
+	}
+
+	NET_DBG("Socket %d context %p", sock, s->ctx);
+
+	sock_release(s);
+
+	return 0;
+}
+
+int zsock_bind(int sock, const struct sockaddr *addr, socklen_t addrlen)
+{
+	struct net_socket *s = sock_get(sock);
+	int ret;
+
+	if (!s) {
+		return -1;
+	}
+
+	if (!s->ctx) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	ret = sock_bind(s, addr, addrlen);
+	if (ret < 0) {
+		errno = -ret;
+		return -1;
+	}
+
+	return 0;
+}
+
+int zsock_connect(int sock, const struct sockaddr *addr, socklen_t addrlen)
+{
+	struct net_socket *s = sock_get(sock);
+	int32_t timeout = K_NO_WAIT;
+	int ret;
+
+	if (!s) {
+		return -1;
+	}
+
+	if (!s->ctx || (s->flags & SOCK_LISTENING)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	ret = sock_autobind(s);
+	if (ret < 0) {
+		goto fail;
+	}
+
+	if (s->type == SOCK_DGRAM) {
+		ret = net_context_connect(s->ctx, addr, addrlen, NULL,
+					  K_NO_WAIT, NULL);
+		if (ret < 0) {
+			goto fail;
+		}
+
+		/* Receive only from the peer from now on */
+		ret = net_context_recv(s->ctx, sock_received, K_NO_WAIT,
+				       NULL);
+		if (ret < 0) {
+			goto fail;
+		}
+
+		return 0;
+	}
+
+#if defined(CONFIG_NET_TCP)
+	if (!(s->flags & SOCK_NONBLOCK)) {
+		timeout = CONFIG_NET_SOCKETS_CONNECT_TIMEOUT;
+	}
+#endif
+
+	ret = net_context_connect(s->ctx, addr, addrlen, sock_connected,
+				  timeout, NULL);
+	if (ret < 0) {
+		goto fail;
+	}
+
+	if (net_context_get_state(s->ctx) != NET_CONTEXT_CONNECTED) {
+		ret = -EINPROGRESS;
+		goto fail;
+	}
+
+	return 0;
+
+fail:
+	errno = -ret;
+	return -1;
+}
+
+int zsock_listen(int sock, int backlog)
+{
+	struct net_socket *s = sock_get(sock);
+	int ret;
+
+	if (!s) {
+		return -1;
+	}
+
+	if (!s->ctx || s->type != SOCK_STREAM) {
+		errno = EOPNOTSUPP;
+		return -1;
+	}
+
+	ret = sock_autobind(s);
+	if (ret < 0) {
+		goto fail;
+	}
+
+	ret = net_context_listen(s->ctx, backlog);
+	if (ret < 0) {
+		goto fail;
+	}
+
+	s->flags |= SOCK_LISTENING;
+
+	ret = net_context_accept(s->ctx, sock_accepted, K_NO_WAIT, NULL);
+	if (ret < 0) {
+		s->flags &= ~SOCK_LISTENING;
+		goto fail;
+	}
+
+	return 0;
+
+fail:
+	errno = -ret;
+	return -1;
+}
+
+int zsock_accept(int sock, struct sockaddr *addr, socklen_t *addrlen)
+{
+	struct net_socket *s = sock_get(sock);
+	struct net_socket *child;
+	unsigned int key;
+	int ret;
+
+	if (!s) {
+		return -1;
+	}
+
+	if (!(s->flags & SOCK_LISTENING)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	ret = sock_wait(s, ZSOCK_POLLIN, sock_timeout(s, 0));
+	if (ret < 0) {
+		errno = -ret;
+		return -1;
+	}
+
+	key = irq_lock();
+	atomic_dec(&s->queued);
+	child = k_fifo_get(&s->recv_q, K_NO_WAIT);
+	child->flags &= ~SOCK_PENDING;
+	irq_unlock(key);
+
+	if (addr && addrlen) {
+		if (child->ctx) {
+			sock_copy_addr(addr, addrlen, &child->ctx->remote);
+		} else {
+			*addrlen = 0;
+		}
+	}
+
+	NET_DBG("Socket %d accepted %d", sock, sock_fd(child));
+
+	return sock_fd(child);
+}
+
+ssize_t zsock_sendto(int sock, const void *data, size_t len, int flags,
+		     const struct sockaddr *dest_addr, socklen_t addrlen)
+{
+	struct net_socket *s = sock_get(sock);
+	struct net_buf *buf;
+	size_t max_len = UINT16_MAX;
+	int ret;
+
+	ARG_UNUSED(flags);
+
+	if (!s) {
+		return -1;
+	}
+
+	if (!s->ctx) {
+		errno = EPIPE;
+		return -1;
+	}
+
+	if (s->type == SOCK_DGRAM) {
+		ret = sock_autobind(s);
+		if (ret < 0) {
+			errno = -ret;
+			return -1;
+		}
+	} else {
+		max_len = net_context_get_family(s->ctx) == AF_INET6 ?
+			SOCK_TCP_SEG_IPV6 : SOCK_TCP_SEG_IPV4;
+
+		/* A stream may be sent partially */
+		len = min(len, max_len);
+	}
+
+	if (len > max_len) {
+		errno = EMSGSIZE;
+		return -1;
+	}
+
+	buf = net_nbuf_get_tx(s->ctx);
+	if (!buf) {
+		errno = ENOMEM;
+		return -1;
+	}
+
+	if (!net_nbuf_append(buf, len, (uint8_t *)data)) {
+		net_nbuf_unref(buf);
+		errno = ENOMEM;
+		return -1;
+	}
+
+	/* TCP sends the queued segment only when a timeout is given, the
+	 * call itself does not wait.
+	 */
+	if (dest_addr) {
+		ret = net_context_sendto(buf, dest_addr, addrlen, NULL,
+					 K_FOREVER, NULL, NULL);
+	} else {
+		ret = net_context_send(buf, NULL, K_FOREVER, NULL, NULL);
+	}
+
+	if (ret < 0) {
+		net_nbuf_unref(buf);
+		errno = -ret;
+		return -1;
+	}
+
+	return len;
+}
+
+ssize_t zsock_send(int sock, const void *data, size_t len, int flags)
+{
+	return zsock_sendto(sock, data, len, flags, NULL, 0);
+}
+
+ssize_t zsock_recvfrom(int sock, void *data, size_t max_len, int flags,
+		       struct sockaddr *src_addr, socklen_t *addrlen)
+{
+	struct net_socket *s = sock_get(sock);
+	bool peek = flags & ZSOCK_MSG_PEEK;
+	struct net_buf *buf;
+	struct sockaddr src;
+	unsigned int key;
+	size_t copied;
+	int ret;
+
+	if (!s) {
+		return -1;
+	}
+
+	if (s->flags & SOCK_LISTENING) {
+		errno = ENOTCONN;
+		return -1;
+	}
+
+	ret = sock_wait(s, ZSOCK_POLLIN, sock_timeout(s, flags));
+	if (ret < 0) {
+		errno = -ret;
+		return -1;
+	}
+
+	if (s->err) {
+		errno = s->err;
+		s->err = 0;
+		return -1;
+	}
+
+	if (!s->recv_buf) {
+		if (!atomic_get(&s->queued)) {
+			/* Only the end of the connection is left */
+			return 0;
+		}
+
+		key = irq_lock();
+		atomic_dec(&s->queued);
+		buf = net_buf_get_timeout(&s->recv_q, 0, K_NO_WAIT);
+		irq_unlock(key);
+
+		sock_recv_start(s, buf);
+	}
+
+	buf = s->recv_buf;
+
+	if (src_addr && addrlen) {
+		sock_buf_src(buf, &src);
+		sock_copy_addr(src_addr, addrlen, &src);
+	}
+
+	copied = sock_copy(s, data, max_len, peek);
+
+	/* The rest of a datagram that did not fit is dropped */
+	if (!peek && (s->type == SOCK_DGRAM || !s->recv_left)) {
+		s->recv_buf = NULL;
+		net_nbuf_unref(buf);
+	}
+
+	return copied;
+}
+
+ssize_t zsock_recv(int sock, void *data, size_t max_len, int flags)
+{
+	return zsock_recvfrom(sock, data, max_len, flags, NULL, NULL);
+}
+
+int zsock_fcntl(int sock, int cmd, int flags)
+{
+	struct net_socket *s = sock_get(sock);
+
+	if (!s) {
+		return -1;
+	}
+
+	switch (cmd) {
+	case ZSOCK_F_GETFL:
+		return (s->flags & SOCK_NONBLOCK) ? ZSOCK_O_NONBLOCK : 0;
+	case ZSOCK_F_SETFL:
+		if (flags & ZSOCK_O_NONBLOCK) {
+			s->flags |= SOCK_NONBLOCK;
+		} else {
+			s->flags &= ~SOCK_NONBLOCK;
+		}
+
+		return 0;
+	}
+
+	errno = EINVAL;
+	return -1;
+}
+
+int zsock_setsockopt(int sock, int level, int optname,
+		     const void *optval, socklen_t optlen)
+{
+	struct net_socket *s = sock_get(sock);
+
+	if (!s) {
+		return -1;
+	}
+
+	if (level != SOL_SOCKET) {
+		errno = ENOPROTOOPT;
+		return -1;
+	}
+
+	switch (optname) {
+	case SO_RCVTIMEO: {
+		const struct timeval *tv = optval;
+
+		if (optlen != sizeof(struct timeval) ||
+		    tv->tv_sec < 0 || tv->tv_usec < 0 ||
+		    tv->tv_usec >= USEC_PER_SEC) {
+			errno = EINVAL;
+			return -1;
+		}
+
+		if (tv->tv_sec >= INT32_MAX / MSEC_PER_SEC) {
+			errno = EDOM;
+			return -1;
+		}
+
+		/* Round up so that a short timeout does not become
+		 * K_NO_WAIT
+		 */
+		s->recv_timeout = tv->tv_sec * MSEC_PER_SEC +
+			(tv->tv_usec + USEC_PER_MSEC - 1) / USEC_PER_MSEC;
+		if (!s->recv_timeout) {
+			s->recv_timeout = K_FOREVER;
+		}
+
+		return 0;
+	}
+	case SO_PRIORITY:
+		if (optlen != sizeof(int) ||
+		    *(const int *)optval < NET_PRIORITY_BE ||
+		    *(const int *)optval > NET_PRIORITY_NC) {
+			errno = EINVAL;
+			return -1;
+		}
+
+		if (!s->ctx) {
+			errno = EINVAL;
+			return -1;
+		}
+
+		net_context_set_priority(s->ctx, *(const int *)optval);
+
+		return 0;
+	}
+
+	errno = ENOPROTOOPT;
+	return -1;
+}
+
+int zsock_getsockopt(int sock, int level, int optname,
+		     void *optval, socklen_t *optlen)
+{
+	struct net_socket *s = sock_get(sock);
+
+	if (!s) {
+		return -1;
+	}
+
+	if (level != SOL_SOCKET) {
+		errno = ENOPROTOOPT;
+		return -1;
+	}
+
+	switch (optname) {
+	case SO_ERROR:
+		if (*optlen < sizeof(int)) {
+			break;
+		}
+
+		*(int *)optval = s->err;
+		*optlen = sizeof(int);
+		s->err = 0;
+
+		return 0;
+	case SO_PRIORITY:
+		if (*optlen < sizeof(int) || !s->ctx) {
+			break;
+		}
+
+		*(int *)optval = net_context_get_priority(s->ctx);
+		*optlen = sizeof(int);
+
+		return 0;
+	case SO_RCVTIMEO: {
+		struct timeval *tv = optval;
+
+		if (*optlen < sizeof(struct timeval)) {
+			break;
+		}
+
+		if (s->recv_timeout == K_FOREVER) {
+			tv->tv_sec = 0;
+			tv->tv_usec = 0;
+		} else {
+			tv->tv_sec = s->recv_timeout / MSEC_PER_SEC;
+			tv->tv_usec = (s->recv_timeout % MSEC_PER_SEC) *
+				USEC_PER_MSEC;
+		}
+
+		*optlen = sizeof(struct timeval);
+
+		return 0;
+	}
+	default:
+		errno = ENOPROTOOPT;
+		return -1;
+	}
+
+	errno = EINVAL;
+	return -1;
+}
+
+static int poll_scan(struct zsock_pollfd *fds, int nfds)
+{
+	struct net_socket *s;
+	int ready = 0;
+	int i;
+
+	for (i = 0; i < nfds; i++) {
+		fds[i].revents = 0;
+
+		if (fds[i].fd < 0) {
+			continue;
+		}
+
+		if (fds[i].fd >= SOCK_MAX ||
+		    (sockets[fds[i].fd].flags & (SOCK_IN_USE | SOCK_PENDING))
+		    != SOCK_IN_USE) {
+			fds[i].revents = ZSOCK_POLLNVAL;
+		} else {
+			s = &sockets[fds[i].fd];
+
+			fds[i].revents = sock_events(s) &
+				(fds[i].events | ZSOCK_POLLERR |
+				 ZSOCK_POLLHUP);
+		}
+
+		if (fds[i].revents) {
+			ready++;
+		}
+	}
+
+	return ready;
+}
+
+int zsock_poll(struct zsock_pollfd *fds, int nfds, int timeout)
+{
+	struct sock_waiter waiter;
+	uint32_t mask = 0;
+	int32_t k_timeout;
+	uint32_t start;
+	int ready;
+	int i;
+
+	ready = poll_scan(fds, nfds);
+	if (ready || !timeout) {
+		return ready;
+	}
+
+	for (i = 0; i < nfds; i++) {
+		if (fds[i].fd >= 0) {
+			mask |= BIT(fds[i].fd);
+		}
+	}
+
+	k_timeout = timeout < 0 ? K_FOREVER : timeout;
+	start = k_uptime_get_32();
+
+	waiter_add(&waiter, mask);
+
+	/* Only the events of these sockets wake the thread up */
+	while (!(ready = poll_scan(fds, nfds))) {
+		if (k_sem_take(&waiter.sem, time_left(k_timeout, start))) {
+			break;
+		}
+	}
+
+	waiter_remove(&waiter);
+
+	return ready;
+}
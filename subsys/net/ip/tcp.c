@@ -40,6 +40,7 @@
 
 #include "connection.h"
 #include "net_private.h"
+#include "net_capture.h"
 
 #include "ipv6.h"
 #include "ipv4.h"
@@ -126,6 +127,9 @@ static void tcp_retry_expired(struct k_timer *timer)
 
 		buf = CONTAINER_OF(sys_slist_peek_head(&tcp->sent_list),
 				   struct net_buf, sent_list);
+
+		net_capture(NET_CAPTURE_TCP_RETRY, buf);
+
 		net_tcp_send_buf(buf);
 	}
 }
@@ -157,6 +161,7 @@ struct net_tcp *net_tcp_alloc(struct net_context *context)
 	tcp_context[i].recv_max_ack = tcp_context[i].send_seq + 1u;
 
 	k_timer_init(&tcp_context[i].retry_timer, tcp_retry_expired, NULL);
+	k_sem_init(&tcp_context[i].connect_wait, 0, 1);
 
 	return &tcp_context[i];
 }
@@ -609,6 +614,9 @@ int net_tcp_send_buf(struct net_buf *buf)
 {
 	struct net_context *ctx = net_nbuf_context(buf);
 	struct net_tcp_hdr *tcphdr = NET_TCP_BUF(buf);
+	uint32_t old_ack = sys_get_be32(tcphdr->ack);
+	uint16_t old_flags = (tcphdr->offset << 8) | tcphdr->flags;
+	uint16_t chksum;
 
 	sys_put_be32(ctx->tcp->send_ack, tcphdr->ack);
 
@@ -621,6 +629,23 @@ int net_tcp_send_buf(struct net_buf *buf)
 		tcphdr->flags |= NET_TCP_ACK;
 	}
 
+	/* The segment was already finalized when it was queued, so when
+	 * it is (re)sent with a newer ACK the checksum is patched instead
+	 * of being calculated again over the whole fragment chain.
+	 */
+	if ((old_ack != ctx->tcp->send_ack ||
+	     (old_flags & 0xff) != tcphdr->flags) &&
+	    !net_if_has_offload(net_nbuf_iface(buf),
+				NET_IF_OFFLOAD_TX_CHKSUM_TCP)) {
+		chksum = ntohs(tcphdr->chksum);
+		chksum = net_calc_chksum_update32(chksum, old_ack,
+						  ctx->tcp->send_ack);
+		chksum = net_calc_chksum_update16(chksum, old_flags,
+						  (tcphdr->offset << 8) |
+						  tcphdr->flags);
+		tcphdr->chksum = htons(chksum);
+	}
+
 	ctx->tcp->sent_ack = ctx->tcp->send_ack;
 
 	net_nbuf_set_buf_sent(buf, true);
@@ -120,6 +120,9 @@ struct net_tcp {
 	/** Retransmit timer */
 	struct k_timer retry_timer;
 
+	/** Given when the connection has been established by connect */
+	struct k_sem connect_wait;
+
 	/** Current retransmit period */
 	uint32_t retry_timeout_ms;
 
@@ -0,0 +1,125 @@
+/** @file
+ * @brief Timer wheel for the timers of table entries
+ */
+
+/*
+ * Copyright (c) 2016 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <kernel.h>
+#include <misc/util.h>
+
+#include "timer_wheel.h"
+
+static inline uint32_t timer_wheel_now(struct net_timer_wheel *wheel)
+{
+	/* The timeouts can be months, so the 32 bit uptime in
+	 * milliseconds would wrap around too soon.
+	 */
+	return (uint32_t)(k_uptime_get() / wheel->tick);
+}
+
+static void timer_wheel_expired(struct k_work *work)
+{
+	struct net_timer_wheel *wheel = CONTAINER_OF(work,
+						     struct net_timer_wheel,
+						     work);
+	uint32_t now = timer_wheel_now(wheel);
+	uint32_t ticks = now - wheel->last;
+
+	/* Go through the slots that have passed since the last run */
+	if (ticks > wheel->slot_count) {
+		ticks = wheel->slot_count;
+	}
+
+	while (ticks--) {
+		sys_dlist_t *slot = &wheel->slots[(now - ticks) %
+						  wheel->slot_count];
+		sys_dnode_t *node, *next;
+
+		SYS_DLIST_FOR_EACH_NODE_SAFE(slot, node, next) {
+			struct net_timer_wheel_timer *timer;
+
+			timer = CONTAINER_OF(node,
+					     struct net_timer_wheel_timer,
+					     node);
+
+			if ((int32_t)(timer->expiry - now) > 0) {
+				continue;
+			}
+
+			net_timer_wheel_clear(wheel, timer);
+
+			wheel->cb(timer);
+		}
+	}
+
+	wheel->last = now;
+
+	if (wheel->count) {
+		k_delayed_work_submit(&wheel->work, wheel->tick);
+	}
+}
+
+void net_timer_wheel_init(struct net_timer_wheel *wheel, sys_dlist_t *slots,
+			  uint16_t slot_count, uint32_t tick,
+			  net_timer_wheel_cb_t cb)
+{
+	int i;
+
+	for (i = 0; i < slot_count; i++) {
+		sys_dlist_init(&slots[i]);
+	}
+
+	wheel->slots = slots;
+	wheel->slot_count = slot_count;
+	wheel->tick = tick;
+	wheel->count = 0;
+	wheel->cb = cb;
+
+	k_delayed_work_init(&wheel->work, timer_wheel_expired);
+}
+
+void net_timer_wheel_set(struct net_timer_wheel *wheel,
+			 struct net_timer_wheel_timer *timer, uint32_t ticks)
+{
+	uint32_t now = timer_wheel_now(wheel);
+
+	net_timer_wheel_clear(wheel, timer);
+
+	/* At least one tick so that the slot is still ahead of us */
+	timer->expiry = now + (ticks ? ticks : 1);
+
+	sys_dlist_append(&wheel->slots[timer->expiry % wheel->slot_count],
+			 &timer->node);
+
+	if (!wheel->count++) {
+		wheel->last = now;
+		k_delayed_work_submit(&wheel->work, wheel->tick);
+	}
+}
+
+void net_timer_wheel_clear(struct net_timer_wheel *wheel,
+			   struct net_timer_wheel_timer *timer)
+{
+	if (!net_timer_wheel_is_set(timer)) {
+		return;
+	}
+
+	sys_dlist_remove(&timer->node);
+	timer->node.next = NULL;
+
+	wheel->count--;
+}
@@ -0,0 +1,128 @@
+/** @file
+ *  @brief Timer wheel for the timers of table entries.
+ */
+
+/*
+ * Copyright (c) 2016 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __NET_TIMER_WHEEL_H
+#define __NET_TIMER_WHEEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <kernel.h>
+#include <misc/dlist.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The timers of a table, like the reachability timers of the neighbors,
+ * are kept in the slots of a wheel that is run by one delayed work.
+ * Setting and clearing a timer takes constant time, and the work is
+ * only scheduled while there are active timers. The timers that are
+ * more than one round away stay in their slots.
+ */
+struct net_timer_wheel_timer {
+	/** Link in the slot, NULL if the timer is not active */
+	sys_dnode_t node;
+
+	/** Tick at which the timer expires */
+	uint32_t expiry;
+};
+
+/* Called from the work for each timer that has expired. The timer is
+ * not active any more, so it can be set again.
+ */
+typedef void (*net_timer_wheel_cb_t)(struct net_timer_wheel_timer *timer);
+
+struct net_timer_wheel {
+	struct k_delayed_work work;
+
+	/** Slots, the expiry tick modulo the slot count selects one */
+	sys_dlist_t *slots;
+	uint16_t slot_count;
+
+	/** Length of a tick in milliseconds */
+	uint32_t tick;
+
+	/** Tick of the last run */
+	uint32_t last;
+
+	/** Number of active timers */
+	int count;
+
+	net_timer_wheel_cb_t cb;
+};
+
+/**
+ * @brief Initialize a timer wheel.
+ *
+ * @param wheel Timer wheel.
+ * @param slots Array of slot_count lists.
+ * @param slot_count Number of slots.
+ * @param tick Length of a tick in milliseconds.
+ * @param cb Function called for each expired timer.
+ */
+void net_timer_wheel_init(struct net_timer_wheel *wheel, sys_dlist_t *slots,
+			  uint16_t slot_count, uint32_t tick,
+			  net_timer_wheel_cb_t cb);
+
+/**
+ * @brief Set a timer, or move it if it is already active.
+ *
+ * @param wheel Timer wheel.
+ * @param timer Timer.
+ * @param ticks Timeout in ticks of the wheel. The timer expires when
+ * the tick it is set for has started, so at most one tick earlier.
+ */
+void net_timer_wheel_set(struct net_timer_wheel *wheel,
+			 struct net_timer_wheel_timer *timer, uint32_t ticks);
+
+/**
+ * @brief Clear a timer. Nothing is done if it is not active.
+ *
+ * @param wheel Timer wheel.
+ * @param timer Timer.
+ */
+void net_timer_wheel_clear(struct net_timer_wheel *wheel,
+			   struct net_timer_wheel_timer *timer);
+
+/**
+ * @brief Convert milliseconds to ticks of a wheel, rounded up.
+ *
+ * @param wheel Timer wheel.
+ * @param ms Time in milliseconds.
+ *
+ * @return Number of ticks.
+ */
+static inline uint32_t net_timer_wheel_ticks(struct net_timer_wheel *wheel,
+					     uint32_t ms)
+{
+	return ms / wheel->tick + (ms % wheel->tick ? 1 : 0);
+}
+
+static inline bool net_timer_wheel_is_set(struct net_timer_wheel_timer *timer)
+{
+	return timer->node.next != NULL;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __NET_TIMER_WHEEL_H */
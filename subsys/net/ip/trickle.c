@@ -59,19 +59,14 @@ static uint32_t get_t(uint32_t I)
 	return I + (sys_rand32_get() % I);
 }
 
-static void double_interval_timeout(struct k_work *work)
-{
-	struct net_trickle *trickle = CONTAINER_OF(work,
-						   struct net_trickle,
-						   timer);
-	uint32_t rand_time;
+static void setup_new_interval(struct net_trickle *trickle);
 
+static void double_interval_timeout(struct net_trickle *trickle)
+{
 #if NET_DEBUG > 0
 	uint32_t last_end = get_end(trickle);
 #endif
 
-	trickle->c = 0;
-
 	NET_DBG("now %u (was at %u)", k_uptime_get_32(), last_end);
 
 	/* Check if we need to double the interval */
@@ -86,14 +81,8 @@ static void double_interval_timeout(struct k_work *work)
 		NET_DBG("I %u", trickle->I);
 	}
 
-	/* Random t in [I/2, I) */
-	rand_time = get_t(trickle->I);
-
-	NET_DBG("doubling time %u", rand_time);
-
-	trickle->Istart = k_uptime_get_32() + rand_time;
-
-	k_delayed_work_submit(&trickle->timer, rand_time);
+	/* The new interval starts where the previous one ended */
+	setup_new_interval(trickle);
 
 	NET_DBG("last end %u new end %u for %u I %u",
 		last_end, get_end(trickle), trickle->Istart, trickle->I);
@@ -112,10 +101,14 @@ static inline void reschedule(struct net_trickle *trickle)
 		NET_DBG("Clock wrap");
 	}
 
-	k_delayed_work_init(&trickle->timer, double_interval_timeout);
+	trickle->double_to = true;
+
 	k_delayed_work_submit(&trickle->timer, diff);
 }
 
+/* The same work item serves both the time t and the end of the interval,
+ * double_to tells which one has expired.
+ */
 static void trickle_timeout(struct k_work *work)
 {
 	struct net_trickle *trickle = CONTAINER_OF(work,
@@ -124,6 +117,20 @@ static void trickle_timeout(struct k_work *work)
 
 	NET_DBG("Trickle timeout at %d", k_uptime_get_32());
 
+	if (!net_trickle_is_running(trickle)) {
+		return;
+	}
+
+	if (trickle->double_to) {
+		double_interval_timeout(trickle);
+		return;
+	}
+
+	/* The callback may restart or stop the timer, so the end of the
+	 * interval is scheduled before calling it.
+	 */
+	reschedule(trickle);
+
 	if (trickle->cb) {
 		NET_DBG("TX ok %d c(%u) < k(%u)",
 			is_tx_allowed(trickle), trickle->c, trickle->k);
@@ -131,10 +138,6 @@ static void trickle_timeout(struct k_work *work)
 		trickle->cb(trickle, is_tx_allowed(trickle),
 			    trickle->user_data);
 	}
-
-	if (net_trickle_is_running(trickle)) {
-		reschedule(trickle);
-	}
 }
 
 static void setup_new_interval(struct net_trickle *trickle)
@@ -142,6 +145,7 @@ static void setup_new_interval(struct net_trickle *trickle)
 	uint32_t t;
 
 	trickle->c = 0;
+	trickle->double_to = false;
 
 	t = get_t(trickle->I);
 
@@ -30,10 +30,14 @@
 #include <string.h>
 #include <errno.h>
 
+#include <misc/byteorder.h>
+
 #include <net/net_ip.h>
 #include <net/nbuf.h>
 #include <net/net_core.h>
 
+#include "net_private.h"
+
 char *net_byte_to_hex(uint8_t *ptr, uint8_t byte, char base, bool pad)
 {
 	int i, val;
@@ -363,31 +367,150 @@ int net_addr_pton(sa_family_t family, const char *src,
 	return 0;
 }
 
+/* Fold a 64-bit one's complement accumulator down to 16 bits. */
+static inline uint16_t chksum_fold(uint64_t acc)
+{
+	uint32_t sum;
+
+	acc = (acc & 0xffffffff) + (acc >> 32);
+	acc = (acc & 0xffffffff) + (acc >> 32);
+
+	sum = (uint32_t)acc;
+	sum = (sum & 0xffff) + (sum >> 16);
+	sum = (sum & 0xffff) + (sum >> 16);
+
+	return sum;
+}
+
+#if defined(CONFIG_CPU_CORTEX_M3_M4)
+/* Sum 16 byte blocks of 32-bit aligned words. The carry flag is kept alive
+ * across the whole loop so the end-around carry costs a single instruction
+ * per word instead of the compare and increment needed in C.
+ */
+static inline uint64_t chksum_blocks(uint64_t acc, const uint32_t **ptr,
+				     uint16_t blocks)
+{
+	const uint32_t *p = *ptr;
+	uint32_t sum = 0;
+	uint32_t a, b, c, d;
+
+	__asm__ volatile(
+		"adds %[sum], %[sum], #0\n\t"
+		"1:\n\t"
+		"ldr %[a], [%[p], #0]\n\t"
+		"ldr %[b], [%[p], #4]\n\t"
+		"ldr %[c], [%[p], #8]\n\t"
+		"ldr %[d], [%[p], #12]\n\t"
+		"adcs %[sum], %[sum], %[a]\n\t"
+		"adcs %[sum], %[sum], %[b]\n\t"
+		"adcs %[sum], %[sum], %[c]\n\t"
+		"adcs %[sum], %[sum], %[d]\n\t"
+		"add %[p], %[p], #16\n\t"
+		"sub %[n], %[n], #1\n\t"
+		"teq %[n], #0\n\t"
+		"bne 1b\n\t"
+		"adcs %[sum], %[sum], #0\n\t"
+		"adc %[sum], %[sum], #0\n\t"
+		: [sum] "+r" (sum), [p] "+r" (p), [n] "+r" (blocks),
+		  [a] "=&r" (a), [b] "=&r" (b), [c] "=&r" (c), [d] "=&r" (d)
+		:
+		: "cc", "memory");
+
+	*ptr = p;
+
+	return acc + sum;
+}
+#else
+static inline uint64_t chksum_blocks(uint64_t acc, const uint32_t **ptr,
+				     uint16_t blocks)
+{
+	const uint32_t *p = *ptr;
+
+	/* The 64-bit accumulator cannot overflow for any uint16_t length,
+	 * so the carries are only folded back once at the very end.
+	 */
+	while (blocks--) {
+		acc += p[0];
+		acc += p[1];
+		acc += p[2];
+		acc += p[3];
+		p += 4;
+	}
+
+	*ptr = p;
+
+	return acc;
+}
+#endif /* CONFIG_CPU_CORTEX_M3_M4 */
+
 static uint16_t calc_chksum(uint16_t sum, const uint8_t *ptr, uint16_t len)
 {
-	uint16_t tmp;
-	const uint8_t *end;
+	const uint32_t *p32;
+	uint64_t acc = 0;
+	uint16_t res;
+	bool odd;
 
-	end = ptr + len - 1;
+	if (!len) {
+		return sum;
+	}
 
-	while (ptr < end) {
-		tmp = (ptr[0] << 8) + ptr[1];
-		sum += tmp;
-		if (sum < tmp) {
-			sum++;
-		}
+	/* When starting from an odd address, skip the first byte and sum
+	 * the rest as if the data was aligned. The result is then byte
+	 * swapped back (RFC 1071 ch. 2(B)) and the first byte added as
+	 * the high order byte of its word.
+	 */
+	odd = (uintptr_t)ptr & 1;
+	if (odd) {
+		res = *ptr++ << 8;
+		len--;
+	} else {
+		res = 0;
+	}
+
+	/* The data is summed in native byte order using aligned loads and
+	 * converted to network byte order only once at the end.
+	 */
+	if (((uintptr_t)ptr & 2) && len >= 2) {
+		acc += UNALIGNED_GET((const uint16_t *)ptr);
 		ptr += 2;
+		len -= 2;
 	}
 
-	if (ptr == end) {
-		tmp = ptr[0] << 8;
-		sum += tmp;
-		if (sum < tmp) {
-			sum++;
-		}
+	p32 = (const uint32_t *)ptr;
+
+	if (len >= 16) {
+		acc = chksum_blocks(acc, &p32, len / 16);
+		len %= 16;
 	}
 
-	return sum;
+	while (len >= 4) {
+		acc += *p32++;
+		len -= 4;
+	}
+
+	ptr = (const uint8_t *)p32;
+
+	if (len >= 2) {
+		acc += UNALIGNED_GET((const uint16_t *)ptr);
+		ptr += 2;
+		len -= 2;
+	}
+
+	if (len) {
+		acc += sys_le16_to_cpu(*ptr);
+	}
+
+	if (odd) {
+		acc = ntohs(chksum_fold(acc));
+		acc = (uint16_t)((acc << 8) | (acc >> 8));
+	} else {
+		acc = ntohs(chksum_fold(acc));
+	}
+
+	acc += res;
+	acc += sum;
+
+	return chksum_fold(acc);
 }
 
 static inline uint16_t calc_chksum_buf(uint16_t sum, struct net_buf *buf,
@@ -480,6 +603,10 @@ uint16_t net_calc_chksum_ipv4(struct net_buf *buf)
 {
 	uint16_t sum;
 
+	if (net_nbuf_chksum_offloaded(buf, NET_IF_OFFLOAD_TX_CHKSUM_IPV4)) {
+		return 0xffff;
+	}
+
 	sum = calc_chksum(0, (uint8_t *)NET_IPV4_BUF(buf), NET_IPV4H_LEN);
 
 	sum = (sum == 0) ? 0xffff : htons(sum);
@@ -638,6 +638,25 @@ static struct net_6lo_data test_data_13 = {
 	.iphc = true
 };
 
+/* Next header and hop limit are both carried in-line */
+static struct net_6lo_data test_data_23 = {
+	.ipv6.vtc = 0x60,
+	.ipv6.tcflow = 0x00,
+	.ipv6.flow = 0x00,
+	.ipv6.len = { 0x00, 0x00 },
+	.ipv6.nexthdr = IPPROTO_ICMPV6,
+	.ipv6.hop_limit = 0x20,
+	.ipv6.src = src_sam10,
+	.ipv6.dst = dst_dam01,
+	.nh.icmp.type = NET_ICMPV6_ECHO_REQUEST,
+	.nh.icmp.code = 0,
+	.nh.icmp.chksum = 0,
+	.nh_udp = false,
+	.nh_icmp = true,
+	.small = true,
+	.iphc = true
+};
+
 #if defined(CONFIG_NET_6LO_CONTEXT)
 static struct net_6lo_data test_data_14 = {
 	.ipv6.vtc = 0x60,
@@ -875,6 +894,7 @@ static const struct {
 	{ "test_6lo_ipv6_dispatch_big_no_udp", &test_data_11},
 	{ "test_6lo_ipv6_dispatch_big_iphc", &test_data_12},
 	{ "test_6lo_sam11_dam11", &test_data_13},
+	{ "test_6lo_sam10_dam01_inline_nh_hlim", &test_data_23},
 #if defined(CONFIG_NET_6LO_CONTEXT)
 	{ "test_6lo_sac1_sam01_dac1_dam01", &test_data_14},
 	{ "test_6lo_sac1_sam10_dac1_dam10", &test_data_15},
@@ -888,6 +908,71 @@ static const struct {
 #endif
 };
 
+#define BENCH_ROUNDS 100
+
+/* Compression and uncompression cycles per packet. The numbers depend
+ * on the board so they are only printed.
+ */
+static int bench_6lo(const char *name, struct net_6lo_data *data)
+{
+	uint32_t compress = 0;
+	uint32_t uncompress = 0;
+	struct net_buf *buf;
+	uint32_t start;
+	int i;
+
+	for (i = 0; i < BENCH_ROUNDS; i++) {
+		buf = create_buf(data);
+		if (!buf) {
+			TC_PRINT("%s: failed to create buffer\n", __func__);
+			return TC_FAIL;
+		}
+
+		start = k_cycle_get_32();
+
+		if (!net_6lo_compress(buf, data->iphc, NULL)) {
+			TC_PRINT("compression failed\n");
+			net_nbuf_unref(buf);
+			return TC_FAIL;
+		}
+
+		compress += k_cycle_get_32() - start;
+		start = k_cycle_get_32();
+
+		if (!net_6lo_uncompress(buf)) {
+			TC_PRINT("uncompression failed\n");
+			net_nbuf_unref(buf);
+			return TC_FAIL;
+		}
+
+		uncompress += k_cycle_get_32() - start;
+
+		if (!compare_data(buf, data)) {
+			net_nbuf_unref(buf);
+			return TC_FAIL;
+		}
+
+		net_nbuf_unref(buf);
+	}
+
+	TC_PRINT("%s: compress %u, uncompress %u cycles per packet\n",
+		 name, compress / BENCH_ROUNDS, uncompress / BENCH_ROUNDS);
+
+	return TC_PASS;
+}
+
+static const struct {
+	const char *name;
+	struct net_6lo_data *data;
+} benchmarks[] = {
+	{ "bench_6lo_udp_sam10_dam10", &test_data_3},
+	{ "bench_6lo_udp_sam11_dam11", &test_data_13},
+	{ "bench_6lo_udp_sam00_m1_dam00_big", &test_data_4},
+#if defined(CONFIG_NET_6LO_CONTEXT)
+	{ "bench_6lo_udp_sac1_sam11_dac1_dam11", &test_data_16},
+#endif
+};
+
 static void main_thread(void)
 {
 	int count, pass;
@@ -908,9 +993,22 @@ static void main_thread(void)
 		}
 	}
 
+	for (count = 0; count < ARRAY_SIZE(benchmarks); count++) {
+		TC_START(benchmarks[count].name);
+
+		if (bench_6lo(benchmarks[count].name,
+			      benchmarks[count].data)) {
+			TC_END(FAIL, "failed\n");
+		} else {
+			TC_END(PASS, "passed\n");
+			pass++;
+		}
+	}
+
 	net_nbuf_print();
 
-	TC_END_REPORT(((pass != ARRAY_SIZE(tests)) ? TC_FAIL : TC_PASS));
+	TC_END_REPORT(((pass != ARRAY_SIZE(tests) + ARRAY_SIZE(benchmarks)) ?
+		       TC_FAIL : TC_PASS));
 }
 
 #define STACKSIZE 2000
@@ -100,6 +100,14 @@ static struct net_eth_addr hwaddr = { { 0x42, 0x11, 0x69, 0xde, 0xfa, 0xec } };
 
 static int send_status = -EINVAL;
 
+/* Used by the ARP cache tests to check what was sent */
+static struct net_eth_addr host_hwaddr = { { 0x42, 0x11, 0x69, 0xde, 0xfa,
+					     0x00 } };
+static bool cache_test;
+static int ip_sent;
+static int refresh_sent;
+static struct net_eth_addr refresh_dst;
+
 static int tester_send(struct net_if *iface, struct net_buf *buf)
 {
 	struct net_eth_hdr *hdr;
@@ -118,6 +126,25 @@ static int tester_send(struct net_if *iface, struct net_buf *buf)
 
 	hdr = (struct net_eth_hdr *)net_nbuf_ll(buf);
 
+	if (cache_test) {
+		if (ntohs(hdr->type) == NET_ETH_PTYPE_IP &&
+		    !memcmp(&hdr->dst, &host_hwaddr,
+			    sizeof(struct net_eth_addr))) {
+			ip_sent++;
+		} else if (ntohs(hdr->type) == NET_ETH_PTYPE_ARP &&
+			   ntohs(NET_ARP_BUF(buf)->opcode) == NET_ARP_REQUEST &&
+			   !net_eth_is_addr_broadcast(&hdr->dst)) {
+			/* Only the refresh requests are unicast */
+			memcpy(&refresh_dst, &hdr->dst,
+			       sizeof(struct net_eth_addr));
+			refresh_sent++;
+		}
+
+		net_nbuf_unref(buf);
+
+		return 0;
+	}
+
 	if (ntohs(hdr->type) == NET_ETH_PTYPE_ARP) {
 		struct net_arp_hdr *arp_hdr = NET_ARP_BUF(buf);
 
@@ -700,9 +727,372 @@ static bool run_tests(void)
 	return true;
 }
 
+static struct in_addr my_addr = { { { 192, 168, 0, 1 } } };
+
+static struct net_buf *create_ipv4_buf(struct net_if *iface,
+				       struct in_addr *dst)
+{
+	struct net_ipv4_hdr *ipv4;
+	struct net_buf *buf, *frag;
+	int len = strlen(app_data);
+
+	buf = net_nbuf_get_reserve_tx(0);
+	if (!buf) {
+		return NULL;
+	}
+
+	frag = net_nbuf_get_reserve_data(sizeof(struct net_eth_hdr));
+	if (!frag) {
+		net_nbuf_unref(buf);
+		return NULL;
+	}
+
+	net_buf_frag_add(buf, frag);
+
+	net_nbuf_set_ll_reserve(buf, net_buf_headroom(frag));
+	net_nbuf_set_iface(buf, iface);
+	net_nbuf_set_family(buf, AF_INET);
+
+	ipv4 = (struct net_ipv4_hdr *)net_buf_add(frag,
+						  sizeof(struct net_ipv4_hdr));
+	net_ipaddr_copy(&ipv4->src, &my_addr);
+	net_ipaddr_copy(&ipv4->dst, dst);
+
+	memcpy(net_buf_add(frag, len), app_data, len);
+
+	return buf;
+}
+
+static bool input_arp_reply(struct net_if *iface, struct in_addr *src,
+			    struct net_eth_addr *addr)
+{
+	struct net_arp_hdr *hdr;
+	struct net_buf *buf, *frag;
+
+	buf = net_nbuf_get_reserve_rx(0);
+	if (!buf) {
+		printk("Out of mem RX reply\n");
+		return false;
+	}
+
+	frag = net_nbuf_get_reserve_data(sizeof(struct net_eth_hdr));
+	if (!frag) {
+		printk("Out of mem DATA reply\n");
+		net_nbuf_unref(buf);
+		return false;
+	}
+
+	net_buf_frag_add(buf, frag);
+
+	net_nbuf_set_ll_reserve(buf, sizeof(struct net_eth_hdr));
+	net_nbuf_set_iface(buf, iface);
+
+	hdr = NET_ARP_BUF(buf);
+
+	hdr->hwtype = htons(NET_ARP_HTYPE_ETH);
+	hdr->protocol = htons(NET_ETH_PTYPE_IP);
+	hdr->hwlen = sizeof(struct net_eth_addr);
+	hdr->protolen = sizeof(struct in_addr);
+	hdr->opcode = htons(NET_ARP_REPLY);
+
+	memcpy(&hdr->src_hwaddr, addr, sizeof(struct net_eth_addr));
+	memcpy(&hdr->dst_hwaddr, net_if_get_link_addr(iface)->addr,
+	       sizeof(struct net_eth_addr));
+	net_ipaddr_copy(&hdr->src_ipaddr, src);
+	net_ipaddr_copy(&hdr->dst_ipaddr, &my_addr);
+
+	net_buf_add(frag, sizeof(struct net_arp_hdr));
+
+	net_arp_input(buf);
+
+	net_nbuf_unref(buf);
+
+	return true;
+}
+
+/* Send a packet to the host and let it answer the ARP request */
+static bool resolve(struct net_if *iface, struct in_addr *dst)
+{
+	struct net_buf *buf, *req;
+	int sent = ip_sent;
+
+	buf = create_ipv4_buf(iface, dst);
+	if (!buf) {
+		printk("Out of mem TX\n");
+		return false;
+	}
+
+	req = net_arp_prepare(buf);
+	if (!req || req == buf) {
+		printk("ARP request was not created for %s\n",
+		       net_sprint_ipv4_addr(dst));
+		return false;
+	}
+
+	net_nbuf_unref(req);
+
+	if (!input_arp_reply(iface, dst, &host_hwaddr)) {
+		return false;
+	}
+
+	k_sleep(50);
+
+	if (ip_sent != sent + 1) {
+		printk("Pending packet to %s was not sent\n",
+		       net_sprint_ipv4_addr(dst));
+		return false;
+	}
+
+	return true;
+}
+
+static bool test_pending_queue(struct net_if *iface)
+{
+	struct net_buf *bufs[CONFIG_NET_ARP_PENDING_COUNT + 1];
+	struct in_addr dst = { { { 192, 168, 0, 3 } } };
+	struct net_buf *req;
+	int i;
+
+	net_arp_init();
+
+	host_hwaddr.addr[5] = 3;
+	ip_sent = 0;
+
+	for (i = 0; i < ARRAY_SIZE(bufs); i++) {
+		bufs[i] = create_ipv4_buf(iface, &dst);
+		if (!bufs[i]) {
+			printk("Out of mem TX\n");
+			return false;
+		}
+
+		/* Keep the buffers so that we can check them later */
+		net_buf_ref(bufs[i]);
+
+		req = net_arp_prepare(bufs[i]);
+		if (!req || req == bufs[i]) {
+			printk("ARP request not created for packet %d\n", i);
+			return false;
+		}
+
+		net_nbuf_unref(req);
+	}
+
+	for (i = 0; i < CONFIG_NET_ARP_PENDING_COUNT; i++) {
+		if (bufs[i]->ref != 3) {
+			printk("Packet %d is not pending (ref %d)\n", i,
+			       bufs[i]->ref);
+			return false;
+		}
+	}
+
+	if (bufs[i]->ref != 1) {
+		printk("Packet %d should have been dropped (ref %d)\n", i,
+		       bufs[i]->ref);
+		return false;
+	}
+
+	net_nbuf_unref(bufs[i]);
+
+	if (!input_arp_reply(iface, &dst, &host_hwaddr)) {
+		return false;
+	}
+
+	k_sleep(100);
+
+	if (ip_sent != CONFIG_NET_ARP_PENDING_COUNT) {
+		printk("%d pending packets sent, should be %d\n", ip_sent,
+		       CONFIG_NET_ARP_PENDING_COUNT);
+		return false;
+	}
+
+	for (i = 0; i < CONFIG_NET_ARP_PENDING_COUNT; i++) {
+		if (bufs[i]->ref != 1) {
+			printk("Sent packet %d still referenced (ref %d)\n",
+			       i, bufs[i]->ref);
+			return false;
+		}
+
+		net_nbuf_unref(bufs[i]);
+	}
+
+	return true;
+}
+
+static bool test_many_hosts(struct net_if *iface)
+{
+	struct in_addr dst = { { { 192, 168, 0, 0 } } };
+	struct net_buf *buf, *ret;
+	int i;
+
+	net_arp_init();
+
+	/* One host more than there are entries in the table */
+	for (i = 0; i <= CONFIG_NET_ARP_TABLE_SIZE; i++) {
+		dst.s4_addr[3] = 10 + i;
+		host_hwaddr.addr[5] = 10 + i;
+
+		if (!resolve(iface, &dst)) {
+			return false;
+		}
+	}
+
+	/* The first host was dropped as it had the oldest entry */
+	for (i = 1; i <= CONFIG_NET_ARP_TABLE_SIZE; i++) {
+		dst.s4_addr[3] = 10 + i;
+		host_hwaddr.addr[5] = 10 + i;
+
+		buf = create_ipv4_buf(iface, &dst);
+		if (!buf) {
+			printk("Out of mem TX\n");
+			return false;
+		}
+
+		ret = net_arp_prepare(buf);
+		if (ret != buf) {
+			printk("Host %s not found in ARP cache\n",
+			       net_sprint_ipv4_addr(&dst));
+			return false;
+		}
+
+		if (memcmp(&NET_ETH_BUF(buf)->dst, &host_hwaddr,
+			   sizeof(struct net_eth_addr))) {
+			printk("Wrong ll address for %s\n",
+			       net_sprint_ipv4_addr(&dst));
+			return false;
+		}
+
+		net_nbuf_unref(buf);
+	}
+
+	dst.s4_addr[3] = 10;
+	host_hwaddr.addr[5] = 10;
+
+	return resolve(iface, &dst);
+}
+
+static bool test_pending_timeout(struct net_if *iface)
+{
+	struct in_addr dst = { { { 192, 168, 0, 99 } } };
+	struct net_buf *buf, *req;
+
+	net_arp_init();
+
+	buf = create_ipv4_buf(iface, &dst);
+	if (!buf) {
+		printk("Out of mem TX\n");
+		return false;
+	}
+
+	net_buf_ref(buf);
+
+	req = net_arp_prepare(buf);
+	if (!req || req == buf) {
+		printk("ARP request not created\n");
+		return false;
+	}
+
+	net_nbuf_unref(req);
+
+	/* Nobody answers, the packet is dropped after two seconds */
+	k_sleep(2500);
+
+	if (buf->ref != 1) {
+		printk("Pending packet was not dropped (ref %d)\n", buf->ref);
+		return false;
+	}
+
+	net_nbuf_unref(buf);
+
+	return true;
+}
+
+static bool test_refresh(struct net_if *iface)
+{
+	struct in_addr used = { { { 192, 168, 0, 20 } } };
+	struct in_addr unused = { { { 192, 168, 0, 21 } } };
+	struct net_buf *buf;
+
+	net_arp_init();
+
+	host_hwaddr.addr[5] = 21;
+
+	if (!resolve(iface, &unused)) {
+		return false;
+	}
+
+	host_hwaddr.addr[5] = 20;
+
+	if (!resolve(iface, &used)) {
+		return false;
+	}
+
+	/* Only the host that we keep sending to is refreshed */
+	buf = create_ipv4_buf(iface, &used);
+	if (!buf) {
+		printk("Out of mem TX\n");
+		return false;
+	}
+
+	if (net_arp_prepare(buf) != buf) {
+		printk("Host not found in ARP cache\n");
+		return false;
+	}
+
+	net_nbuf_unref(buf);
+
+	refresh_sent = 0;
+
+	k_sleep(K_SECONDS(CONFIG_NET_ARP_ENTRY_LIFETIME -
+			  CONFIG_NET_ARP_REFRESH_TIME) + 500);
+
+	if (refresh_sent != 1) {
+		printk("%d refresh requests sent, should be 1\n",
+		       refresh_sent);
+		return false;
+	}
+
+	if (memcmp(&refresh_dst, &host_hwaddr, sizeof(struct net_eth_addr))) {
+		printk("Refresh request sent to wrong host\n");
+		return false;
+	}
+
+	return true;
+}
+
+static bool run_cache_tests(void)
+{
+	struct net_if *iface = net_if_get_default();
+
+	cache_test = true;
+
+	if (!test_pending_queue(iface)) {
+		printk("ARP pending queue test failed\n");
+		return false;
+	}
+
+	if (!test_many_hosts(iface)) {
+		printk("ARP many hosts test failed\n");
+		return false;
+	}
+
+	if (!test_pending_timeout(iface)) {
+		printk("ARP pending timeout test failed\n");
+		return false;
+	}
+
+	if (!test_refresh(iface)) {
+		printk("ARP refresh test failed\n");
+		return false;
+	}
+
+	printk("Network ARP cache checks passed\n");
+
+	return true;
+}
+
 void main_thread(void)
 {
-	if (run_tests()) {
+	if (run_tests() && run_cache_tests()) {
 		TC_END_REPORT(TC_PASS);
 	} else {
 		TC_END_REPORT(TC_FAIL);
@@ -158,6 +158,49 @@ static void net_buf_test_2(void)
 		     "Incorrect fragment destroy callback count");
 }
 
+static void net_buf_test_put_list(void)
+{
+	struct net_buf *bufs[3];
+	struct net_buf *buf;
+	struct k_fifo fifo;
+	int i;
+
+	/* Buffers with two, one and two fragments */
+	for (i = 0; i < ARRAY_SIZE(bufs); i++) {
+		bufs[i] = net_buf_get_timeout(&bufs_fifo, 0, K_NO_WAIT);
+		assert_not_null(bufs[i], "Failed to get buffer");
+
+		if (i == 1) {
+			continue;
+		}
+
+		bufs[i]->frags = net_buf_get_timeout(&bufs_fifo, 0, K_NO_WAIT);
+		assert_not_null(bufs[i]->frags, "Failed to get fragment");
+	}
+
+	k_fifo_init(&fifo);
+	net_buf_put_list(&fifo, bufs, ARRAY_SIZE(bufs));
+
+	destroy_called = 0;
+
+	for (i = 0; i < ARRAY_SIZE(bufs); i++) {
+		buf = net_buf_get_timeout(&fifo, 0, K_NO_WAIT);
+		assert_equal_ptr(buf, bufs[i], "Buffers in wrong order");
+
+		if (i == 1) {
+			assert_is_null(buf->frags, "Unexpected fragment");
+		} else {
+			assert_not_null(buf->frags, "Fragment missing");
+			assert_is_null(buf->frags->frags,
+				       "Fragment list not terminated");
+		}
+
+		net_buf_unref(buf);
+	}
+
+	assert_equal(destroy_called, 5, "Incorrect destroy callback count");
+}
+
 static void test_3_thread(void *arg1, void *arg2, void *arg3)
 {
 	struct k_fifo *fifo = (struct k_fifo *)arg1;
@@ -424,6 +467,7 @@ void test_main(void)
 	ztest_test_suite(net_buf_test,
 			 ztest_unit_test(net_buf_test_1),
 			 ztest_unit_test(net_buf_test_2),
+			 ztest_unit_test(net_buf_test_put_list),
 			 ztest_unit_test(net_buf_test_3),
 			 ztest_unit_test(net_buf_test_4),
 			 ztest_unit_test(net_buf_test_big_buf),
@@ -0,0 +1,433 @@
+/* main.c - Application main entry point */
+
+/*
+ * Copyright (c) 2016 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <zephyr.h>
+#include <sections.h>
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <device.h>
+#include <init.h>
+#include <misc/printk.h>
+#include <net/buf.h>
+#include <net/net_core.h>
+#include <net/nbuf.h>
+#include <net/net_ip.h>
+#include <net/ethernet.h>
+
+#include <tc_util.h>
+
+#include "net_private.h"
+#include "net_capture.h"
+
+#define TIMEOUT 200
+
+#define TEST_PORT 4242
+#define OTHER_PORT 4243
+
+#define PCAPNG_SHB 0x0a0d0d0a
+#define PCAPNG_IDB 0x00000001
+#define PCAPNG_EPB 0x00000006
+
+static struct in6_addr my_addr = { { { 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0,
+				       0, 0, 0, 0, 0, 0, 0, 0x1 } } };
+static struct in6_addr peer_addr = { { { 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0,
+					 0, 0, 0, 0, 0, 0, 0, 0x2 } } };
+
+static struct net_if *iface;
+static struct k_sem sent_lock;
+
+static uint8_t dump_buf[1024];
+static size_t dump_len;
+
+struct net_capture_test_context {
+	uint8_t mac_addr[sizeof(struct net_eth_addr)];
+};
+
+static int net_capture_test_dev_init(struct device *dev)
+{
+	return 0;
+}
+
+static void net_capture_test_iface_init(struct net_if *iface)
+{
+	struct net_capture_test_context *context =
+		net_if_get_device(iface)->driver_data;
+
+	/* 10-00-00-00-00 to 10-00-00-00-FF Documentation RFC7042 */
+	context->mac_addr[0] = 0x10;
+	context->mac_addr[5] = sys_rand32_get();
+
+	net_if_set_link_addr(iface, context->mac_addr, 6);
+}
+
+static int tester_send(struct net_if *iface, struct net_buf *buf)
+{
+	net_nbuf_unref(buf);
+
+	k_sem_give(&sent_lock);
+
+	return 0;
+}
+
+static struct net_capture_test_context net_capture_test_data;
+
+static struct net_if_api net_capture_test_if_api = {
+	.init = net_capture_test_iface_init,
+	.send = tester_send,
+};
+
+#define _ETH_L2_LAYER DUMMY_L2
+#define _ETH_L2_CTX_TYPE NET_L2_GET_CTX_TYPE(DUMMY_L2)
+
+NET_DEVICE_INIT(net_capture_test, "net_capture_test",
+		net_capture_test_dev_init, &net_capture_test_data, NULL,
+		CONFIG_KERNEL_INIT_PRIORITY_DEFAULT,
+		&net_capture_test_if_api, _ETH_L2_LAYER, _ETH_L2_CTX_TYPE, 127);
+
+static struct net_buf *create_udp(struct in6_addr *src, struct in6_addr *dst,
+				  uint16_t port, uint16_t payload_len,
+				  bool rx)
+{
+	uint16_t len = sizeof(struct net_udp_hdr) + payload_len;
+	struct net_buf *buf, *frag;
+
+	buf = rx ? net_nbuf_get_reserve_rx(0) : net_nbuf_get_reserve_tx(0);
+	if (!buf) {
+		return NULL;
+	}
+
+	frag = net_nbuf_get_reserve_data(net_if_get_ll_reserve(iface, NULL));
+	if (!frag) {
+		net_nbuf_unref(buf);
+		return NULL;
+	}
+
+	net_buf_frag_add(buf, frag);
+
+	net_nbuf_set_iface(buf, iface);
+	net_nbuf_set_family(buf, AF_INET6);
+	net_nbuf_set_ip_hdr_len(buf, sizeof(struct net_ipv6_hdr));
+
+	NET_IPV6_BUF(buf)->vtc = 0x60;
+	NET_IPV6_BUF(buf)->tcflow = 0;
+	NET_IPV6_BUF(buf)->flow = 0;
+	NET_IPV6_BUF(buf)->len[0] = len >> 8;
+	NET_IPV6_BUF(buf)->len[1] = len & 0xff;
+	NET_IPV6_BUF(buf)->nexthdr = IPPROTO_UDP;
+	NET_IPV6_BUF(buf)->hop_limit = 64;
+
+	net_ipaddr_copy(&NET_IPV6_BUF(buf)->src, src);
+	net_ipaddr_copy(&NET_IPV6_BUF(buf)->dst, dst);
+
+	net_buf_add(frag, sizeof(struct net_ipv6_hdr));
+
+	NET_UDP_BUF(buf)->src_port = htons(OTHER_PORT + 1);
+	NET_UDP_BUF(buf)->dst_port = htons(port);
+	NET_UDP_BUF(buf)->len = htons(len);
+	NET_UDP_BUF(buf)->chksum = 0;
+
+	net_buf_add(frag, sizeof(struct net_udp_hdr));
+
+	/* The payload goes to a fragment of its own */
+	frag = net_nbuf_get_reserve_data(0);
+	if (!frag) {
+		net_nbuf_unref(buf);
+		return NULL;
+	}
+
+	net_buf_frag_add(buf, frag);
+	memset(net_buf_add(frag, payload_len), 0xaa, payload_len);
+
+	return buf;
+}
+
+static bool send_udp(uint16_t port, uint16_t payload_len)
+{
+	struct net_buf *buf;
+
+	buf = create_udp(&my_addr, &peer_addr, port, payload_len, false);
+	if (!buf) {
+		TC_ERROR("Out of buffers\n");
+		return false;
+	}
+
+	if (net_send_data(buf) < 0) {
+		TC_ERROR("Cannot send packet\n");
+		net_nbuf_unref(buf);
+		return false;
+	}
+
+	if (k_sem_take(&sent_lock, TIMEOUT)) {
+		TC_ERROR("Packet not sent\n");
+		return false;
+	}
+
+	return true;
+}
+
+static bool check_captured(uint32_t expected, uint32_t expected_lost)
+{
+	uint32_t captured, lost;
+
+	net_capture_status(NULL, &captured, &lost);
+
+	if (captured != expected || lost != expected_lost) {
+		TC_ERROR("Captured %u lost %u, expected %u and %u\n",
+			 captured, lost, expected, expected_lost);
+		return false;
+	}
+
+	return true;
+}
+
+static void dump_cb(const uint8_t *data, size_t len, void *user_data)
+{
+	if (dump_len + len <= sizeof(dump_buf)) {
+		memcpy(dump_buf + dump_len, data, len);
+	}
+
+	dump_len += len;
+}
+
+static uint32_t get32(size_t offset)
+{
+	uint32_t value;
+
+	memcpy(&value, dump_buf + offset, sizeof(value));
+
+	return value;
+}
+
+static bool test_init(void)
+{
+	iface = net_if_get_default();
+
+	k_sem_init(&sent_lock, 0, UINT_MAX);
+
+	if (!net_if_ipv6_addr_add(iface, &my_addr, NET_ADDR_MANUAL, 0)) {
+		TC_ERROR("Cannot add IPv6 address\n");
+		return false;
+	}
+
+	return true;
+}
+
+static bool test_start(void)
+{
+	struct net_capture_filter filter = { 0 };
+
+	if (!net_capture_start(&filter, 0)) {
+		TC_ERROR("Capture started without capture points\n");
+		return false;
+	}
+
+	filter.points = NET_CAPTURE_TX;
+
+	if (!net_capture_start(&filter, CONFIG_NET_CAPTURE_SNAPLEN + 1)) {
+		TC_ERROR("Capture started with too large snaplen\n");
+		return false;
+	}
+
+	if (net_capture_status(NULL, NULL, NULL)) {
+		TC_ERROR("Capture running\n");
+		return false;
+	}
+
+	return true;
+}
+
+static bool test_tx_filter(void)
+{
+	struct net_capture_filter filter = {
+		.points = NET_CAPTURE_TX,
+		.proto = IPPROTO_UDP,
+		.port = TEST_PORT,
+	};
+
+	if (net_capture_start(&filter, 0) < 0) {
+		TC_ERROR("Cannot start capture\n");
+		return false;
+	}
+
+	if (!send_udp(TEST_PORT, 10) || !send_udp(OTHER_PORT, 10)) {
+		return false;
+	}
+
+	return check_captured(1, 0);
+}
+
+static bool test_rx_drop(void)
+{
+	struct net_capture_filter filter = {
+		.points = NET_CAPTURE_RX | NET_CAPTURE_DROP,
+		.family = AF_INET6,
+		.port = TEST_PORT,
+	};
+	struct net_buf *buf;
+
+	if (net_capture_start(&filter, 0) < 0) {
+		TC_ERROR("Cannot start capture\n");
+		return false;
+	}
+
+	/* Nobody listens to the port, so the packet is dropped */
+	buf = create_udp(&peer_addr, &my_addr, TEST_PORT, 10, true);
+	if (!buf) {
+		TC_ERROR("Out of buffers\n");
+		return false;
+	}
+
+	if (net_recv_data(iface, buf) < 0) {
+		TC_ERROR("Cannot receive packet\n");
+		net_nbuf_unref(buf);
+		return false;
+	}
+
+	/* Let the RX thread run, and the ICMPv6 error be sent */
+	k_sem_take(&sent_lock, TIMEOUT);
+
+	return check_captured(2, 0);
+}
+
+static bool test_overwrite(void)
+{
+	struct net_capture_filter filter = {
+		.points = NET_CAPTURE_ALL,
+	};
+	int i;
+
+	if (net_capture_start(&filter, 0) < 0) {
+		TC_ERROR("Cannot start capture\n");
+		return false;
+	}
+
+	for (i = 0; i < CONFIG_NET_CAPTURE_COUNT + 2; i++) {
+		if (!send_udp(TEST_PORT, CONFIG_NET_CAPTURE_SNAPLEN + i)) {
+			return false;
+		}
+	}
+
+	return check_captured(CONFIG_NET_CAPTURE_COUNT + 2, 2);
+}
+
+static bool test_dump(void)
+{
+	size_t offset, len;
+	int count;
+
+	count = net_capture_dump(dump_cb, NULL);
+
+	if (net_capture_status(NULL, NULL, NULL)) {
+		TC_ERROR("Capture still running\n");
+		return false;
+	}
+
+	if (count != CONFIG_NET_CAPTURE_COUNT) {
+		TC_ERROR("Dumped %d packets, expected %d\n", count,
+			 CONFIG_NET_CAPTURE_COUNT);
+		return false;
+	}
+
+	if (dump_len > sizeof(dump_buf)) {
+		TC_ERROR("Dump is too large (%zu bytes)\n", dump_len);
+		return false;
+	}
+
+	if (get32(0) != PCAPNG_SHB || get32(8) != 0x1a2b3c4d) {
+		TC_ERROR("No section header\n");
+		return false;
+	}
+
+	/* Every block has its length at both ends */
+	for (offset = 0, count = 0; offset < dump_len; offset += len) {
+		len = get32(offset + 4);
+
+		if (len < 12 || len % 4 || offset + len > dump_len ||
+		    get32(offset + len - 4) != len) {
+			TC_ERROR("Invalid block at %zu\n", offset);
+			return false;
+		}
+
+		switch (get32(offset)) {
+		case PCAPNG_IDB:
+			if (get32(offset + 12) != CONFIG_NET_CAPTURE_SNAPLEN) {
+				TC_ERROR("Invalid snaplen\n");
+				return false;
+			}
+
+			break;
+		case PCAPNG_EPB:
+			/* The oldest two packets were overwritten */
+			if (get32(offset + 20) != CONFIG_NET_CAPTURE_SNAPLEN ||
+			    get32(offset + 24) != sizeof(struct net_ipv6_hdr) +
+			    sizeof(struct net_udp_hdr) +
+			    CONFIG_NET_CAPTURE_SNAPLEN + 2 + count) {
+				TC_ERROR("Invalid length in packet %d\n",
+					 count);
+				return false;
+			}
+
+			if (dump_buf[offset + 28] != 0x60) {
+				TC_ERROR("Packet %d is not IPv6\n", count);
+				return false;
+			}
+
+			count++;
+			break;
+		}
+	}
+
+	if (count != CONFIG_NET_CAPTURE_COUNT) {
+		TC_ERROR("Found %d packets\n", count);
+		return false;
+	}
+
+	return true;
+}
+
+static const struct {
+	const char *name;
+	bool (*func)(void);
+} tests[] = {
+	{ "test init", test_init },
+	{ "start capture", test_start },
+	{ "capture sent packets", test_tx_filter },
+	{ "capture received and dropped packets", test_rx_drop },
+	{ "overwrite old packets", test_overwrite },
+	{ "dump pcapng", test_dump },
+};
+
+void main(void)
+{
+	int count, pass;
+
+	for (count = 0, pass = 0; count < ARRAY_SIZE(tests); count++) {
+		TC_START(tests[count].name);
+		if (!tests[count].func()) {
+			TC_END(FAIL, "failed\n");
+		} else {
+			TC_END(PASS, "passed\n");
+			pass++;
+		}
+	}
+
+	TC_END_REPORT(((pass != ARRAY_SIZE(tests)) ? TC_FAIL : TC_PASS));
+}
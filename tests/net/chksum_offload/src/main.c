@@ -0,0 +1,281 @@
+/* main.c - Application main entry point */
+
+/*
+ * Copyright (c) 2016 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <zephyr.h>
+#include <sections.h>
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <device.h>
+#include <init.h>
+#include <misc/printk.h>
+#include <net/buf.h>
+#include <net/net_core.h>
+#include <net/nbuf.h>
+#include <net/net_ip.h>
+#include <net/net_stats.h>
+#include <net/ethernet.h>
+
+#include <tc_util.h>
+
+#include "ipv6.h"
+#include "ipv4.h"
+#include "udp.h"
+#include "net_private.h"
+
+#define TEST_PORT 4242
+
+static struct in6_addr my_addr6 = { { { 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0,
+					0, 0, 0, 0, 0, 0, 0, 0x1 } } };
+static struct in6_addr peer_addr6 = { { { 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0,
+					  0, 0, 0, 0, 0, 0, 0, 0x2 } } };
+static struct in_addr my_addr4 = { { { 192, 0, 2, 1 } } };
+static struct in_addr peer_addr4 = { { { 192, 0, 2, 2 } } };
+
+static struct net_if *offload_iface;
+static struct net_if *sw_iface;
+
+static struct net_stats_offload orig_stats;
+
+struct net_offload_context {
+	uint8_t mac_addr[sizeof(struct net_eth_addr)];
+};
+
+static int net_offload_dev_init(struct device *dev)
+{
+	return 0;
+}
+
+static void net_offload_iface_init(struct net_if *iface)
+{
+	struct net_offload_context *context =
+		net_if_get_device(iface)->driver_data;
+
+	/* 10-00-00-00-00 to 10-00-00-00-FF Documentation RFC7042 */
+	context->mac_addr[0] = 0x10;
+	context->mac_addr[5] = sys_rand32_get();
+
+	net_if_set_link_addr(iface, context->mac_addr, 6);
+}
+
+static int tester_send(struct net_if *iface, struct net_buf *buf)
+{
+	net_nbuf_unref(buf);
+
+	return 0;
+}
+
+static struct net_offload_context net_offload_data;
+static struct net_offload_context net_sw_data;
+
+/* Pretends that the device does all the checksums in hardware */
+static struct net_if_api net_offload_if_api = {
+	.init = net_offload_iface_init,
+	.send = tester_send,
+	.offload = NET_IF_OFFLOAD_TX_CHKSUM | NET_IF_OFFLOAD_RX_CHKSUM,
+};
+
+static struct net_if_api net_sw_if_api = {
+	.init = net_offload_iface_init,
+	.send = tester_send,
+};
+
+#define _ETH_L2_LAYER DUMMY_L2
+#define _ETH_L2_CTX_TYPE NET_L2_GET_CTX_TYPE(DUMMY_L2)
+
+NET_DEVICE_INIT_INSTANCE(net_offload_test, "net_offload_test", offload,
+			 net_offload_dev_init, &net_offload_data, NULL,
+			 CONFIG_KERNEL_INIT_PRIORITY_DEFAULT,
+			 &net_offload_if_api, _ETH_L2_LAYER, _ETH_L2_CTX_TYPE,
+			 127);
+
+NET_DEVICE_INIT_INSTANCE(net_sw_test, "net_sw_test", sw,
+			 net_offload_dev_init, &net_sw_data, NULL,
+			 CONFIG_KERNEL_INIT_PRIORITY_DEFAULT,
+			 &net_sw_if_api, _ETH_L2_LAYER, _ETH_L2_CTX_TYPE,
+			 127);
+
+static bool test_init(void)
+{
+	struct net_if *iface = net_if_get_default();
+
+	if (net_if_has_offload(iface, NET_IF_OFFLOAD_TX_CHKSUM)) {
+		offload_iface = iface;
+		sw_iface = iface + 1;
+	} else {
+		sw_iface = iface;
+		offload_iface = iface + 1;
+	}
+
+	if (!net_if_has_offload(offload_iface, NET_IF_OFFLOAD_TX_CHKSUM |
+				NET_IF_OFFLOAD_RX_CHKSUM)) {
+		TC_ERROR("Offload capabilities not set (0x%x)\n",
+			 offload_iface->offload);
+		return false;
+	}
+
+	if (sw_iface->offload) {
+		TC_ERROR("Software iface claims offload (0x%x)\n",
+			 sw_iface->offload);
+		return false;
+	}
+
+	orig_stats = net_stats.offload;
+
+	return true;
+}
+
+static struct net_buf *create_udp(struct net_if *iface, sa_family_t family)
+{
+	struct net_buf *buf, *frag;
+
+	buf = net_nbuf_get_reserve_tx(0);
+	if (!buf) {
+		return NULL;
+	}
+
+	net_nbuf_set_iface(buf, iface);
+
+	if (family == AF_INET6) {
+		net_ipv6_create_raw(buf, 0, &my_addr6, &peer_addr6, iface,
+				    IPPROTO_UDP);
+	} else {
+		net_ipv4_create_raw(buf, 0, &my_addr4, &peer_addr4, iface,
+				    IPPROTO_UDP);
+	}
+
+	net_udp_append_raw(buf, TEST_PORT, TEST_PORT);
+
+	frag = net_nbuf_get_reserve_data(0);
+	memcpy(net_buf_add(frag, 16), "0123456789abcdef", 16);
+	net_buf_frag_add(buf, frag);
+
+	NET_UDP_BUF(buf)->len = htons(net_buf_frags_len(buf->frags) -
+				      net_nbuf_ip_hdr_len(buf));
+
+	if (family == AF_INET6) {
+		return net_ipv6_finalize_raw(buf, IPPROTO_UDP);
+	}
+
+	return net_ipv4_finalize_raw(buf, IPPROTO_UDP);
+}
+
+static bool check_udp(sa_family_t family)
+{
+	struct net_buf *buf;
+	uint16_t chksum;
+
+	buf = create_udp(offload_iface, family);
+	if (!buf) {
+		TC_ERROR("Cannot create offloaded packet\n");
+		return false;
+	}
+
+	if (NET_UDP_BUF(buf)->chksum) {
+		TC_ERROR("UDP chksum 0x%04x calculated for offload iface\n",
+			 ntohs(NET_UDP_BUF(buf)->chksum));
+		return false;
+	}
+
+	if (family == AF_INET && NET_IPV4_BUF(buf)->chksum) {
+		TC_ERROR("IPv4 chksum 0x%04x calculated for offload iface\n",
+			 ntohs(NET_IPV4_BUF(buf)->chksum));
+		return false;
+	}
+
+	net_nbuf_unref(buf);
+
+	buf = create_udp(sw_iface, family);
+	if (!buf) {
+		TC_ERROR("Cannot create packet\n");
+		return false;
+	}
+
+	chksum = NET_UDP_BUF(buf)->chksum;
+	NET_UDP_BUF(buf)->chksum = 0;
+
+	if (!chksum || chksum != (uint16_t)~net_calc_chksum(buf,
+							     IPPROTO_UDP)) {
+		TC_ERROR("Invalid UDP chksum 0x%04x for software iface\n",
+			 ntohs(chksum));
+		return false;
+	}
+
+	if (family == AF_INET && !NET_IPV4_BUF(buf)->chksum) {
+		TC_ERROR("IPv4 chksum missing for software iface\n");
+		return false;
+	}
+
+	net_nbuf_unref(buf);
+
+	return true;
+}
+
+static bool test_udp_ipv6(void)
+{
+	return check_udp(AF_INET6);
+}
+
+static bool test_udp_ipv4(void)
+{
+	return check_udp(AF_INET);
+}
+
+static bool test_stats(void)
+{
+	net_stats_t tx = net_stats.offload.tx_chksum - orig_stats.tx_chksum;
+	net_stats_t tx_sw = net_stats.offload.tx_sw_chksum -
+		orig_stats.tx_sw_chksum;
+
+	/* Two UDP checksums and one IPv4 header checksum per iface */
+	if (tx != 3 || tx_sw != 3) {
+		TC_ERROR("Invalid offload stats tx %u tx sw %u\n", tx, tx_sw);
+		return false;
+	}
+
+	return true;
+}
+
+static const struct {
+	const char *name;
+	bool (*func)(void);
+} tests[] = {
+	{ "test init", test_init },
+	{ "UDP over IPv6 checksum offload", test_udp_ipv6 },
+	{ "UDP over IPv4 checksum offload", test_udp_ipv4 },
+	{ "offload statistics", test_stats },
+};
+
+void main(void)
+{
+	int count, pass;
+
+	for (count = 0, pass = 0; count < ARRAY_SIZE(tests); count++) {
+		TC_START(tests[count].name);
+		if (!tests[count].func()) {
+			TC_END(FAIL, "failed\n");
+		} else {
+			TC_END(PASS, "passed\n");
+			pass++;
+		}
+	}
+
+	TC_END_REPORT(((pass != ARRAY_SIZE(tests)) ? TC_FAIL : TC_PASS));
+}
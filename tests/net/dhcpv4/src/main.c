@@ -148,30 +148,65 @@ static const struct net_eth_addr dst_addr = {
 	{ 0x10, 0x00, 0x00, 0x00, 0x00, 0x02 } };
 static const struct in_addr server_addr = { { { 192, 0, 2, 1 } } };
 static const struct in_addr client_addr = { { { 255, 255, 255, 255 } } };
-static const struct in_addr broascast_addr = { { { 255, 255, 255, 255 } } };
-static const struct in_addr zero_addr = { { { 0, 0, 0, 0 } } };
+
+/* Address and server given by the sample ACK */
+static const struct in_addr leased_addr = { { { 10, 237, 72, 158 } } };
+static const struct in_addr server_id = { { { 10, 184, 9, 1 } } };
+#define LEASE_TIME	43200
 
 #define SERVER_PORT	67
 #define CLIENT_PORT	68
 #define MSG_TYPE	53
+#define REQ_IPADDR	50
+#define SERVER_ID	54
+#define RAPID_COMMIT	80
+#define END		255
 #define DISCOVER	1
+#define OFFER		2
 #define REQUEST		3
+#define ACK		5
+#define NAK		6
+
+/* Offset of the message type in the sample messages */
+#define MSG_TYPE_OFFSET	242
 
 struct dhcp_msg {
 	uint32_t xid;
 	uint8_t type;
+	bool server_id;
+	bool rapid_commit;
+	struct in_addr ciaddr;
+	struct in_addr requested_ip;
 };
 
-static void test_result(bool pass)
-{
-	if (pass) {
-		TC_END(PASS, "passed\n");
-		TC_END_REPORT(TC_PASS);
-	} else {
-		TC_END(FAIL, "failed\n");
-		TC_END_REPORT(TC_PASS);
-	}
-}
+/* Stand-in DHCP server, it replies from the send function of the
+ * dummy interface.
+ */
+static struct {
+	/* Number of messages received */
+	int discovers;
+	int requests;
+
+	/* Uptime when the first two DISCOVER messages were received */
+	uint32_t discover_time[2];
+
+	/* Last REQUEST received */
+	struct dhcp_msg request;
+
+	/* Number of DISCOVER messages to ignore */
+	int drop_discovers;
+
+	/* Number of REQUEST messages to ignore */
+	int drop_requests;
+
+	/* Refuse the next REQUEST */
+	bool nak_request;
+
+	/* Reply to DISCOVER with an ACK if the client asks for it */
+	bool rapid_commit;
+} server;
+
+static struct k_sem addr_added;
 
 struct net_dhcpv4_context {
 	uint8_t mac_addr[sizeof(struct net_eth_addr)];
@@ -232,7 +267,7 @@ static struct net_buf *nbuf_get_data(struct net_if *iface)
 	return buf;
 }
 
-static void set_ipv4_header(struct net_buf *buf)
+static void set_ipv4_header(struct net_buf *buf, uint16_t len)
 {
 	struct net_ipv4_hdr *ipv4;
 	uint16_t length;
@@ -242,7 +277,7 @@ static void set_ipv4_header(struct net_buf *buf)
 	ipv4->vhl = 0x45; /* IP version and header length */
 	ipv4->tos = 0x00;
 
-	length = sizeof(offer) + sizeof(struct net_ipv4_hdr) +
+	length = len + sizeof(struct net_ipv4_hdr) +
 		 sizeof(struct net_udp_hdr);
 
 	ipv4->len[1] = length;
@@ -257,7 +292,7 @@ static void set_ipv4_header(struct net_buf *buf)
 	net_ipaddr_copy(&ipv4->dst, &client_addr);
 }
 
-static void set_udp_header(struct net_buf *buf)
+static void set_udp_header(struct net_buf *buf, uint16_t len)
 {
 	struct net_udp_hdr *udp;
 	uint16_t length;
@@ -266,86 +301,34 @@ static void set_udp_header(struct net_buf *buf)
 	udp->src_port = htons(SERVER_PORT);
 	udp->dst_port = htons(CLIENT_PORT);
 
-	length = sizeof(offer) + sizeof(struct net_udp_hdr);
+	length = len + sizeof(struct net_udp_hdr);
 	udp->len = htons(length);
 	udp->chksum = 0;
 }
 
-struct net_buf *prepare_dhcp_offer(struct net_if *iface, uint32_t xid)
+/*
+ * Build a reply from the sample OFFER or ACK. A NAK is the ACK with
+ * another message type and the Rapid Commit option is added before the
+ * end option.
+ */
+static struct net_buf *prepare_dhcp_reply(struct net_if *iface, uint32_t xid,
+					  uint8_t type, bool rapid_commit)
 {
+	static unsigned char reply[sizeof(ack) + 2];
 	struct net_buf *buf, *frag;
-	int bytes, remaining = sizeof(offer), pos = 0;
+	int bytes, remaining, pos = 0;
 	uint16_t offset;
 
-	buf = net_nbuf_get_reserve_rx(0);
-	if (!buf) {
-		return NULL;
-	}
-
-	frag = nbuf_get_data(iface);
-	if (!frag) {
-		net_nbuf_unref(buf);
-		return NULL;
-	}
-
-	net_nbuf_set_iface(buf, iface);
-	net_nbuf_set_ll_reserve(buf, net_buf_headroom(frag));
-	net_nbuf_set_family(buf, AF_INET);
-	net_nbuf_set_ip_hdr_len(buf, sizeof(struct net_ipv4_hdr));
-
-	net_buf_frag_add(buf, frag);
-
-	/* Place the IPv4 header */
-	set_ipv4_header(buf);
-
-	/* Place the UDP header */
-	set_udp_header(buf);
-
-	net_buf_add(frag, NET_IPV4UDPH_LEN);
-	offset = NET_IPV4UDPH_LEN;
-
-	while (remaining > 0) {
-		int copy;
-
-		bytes = net_buf_tailroom(frag);
-		copy = remaining > bytes ? bytes : remaining;
-
-		memcpy(frag->data + offset, &offer[pos], copy);
-
-		net_buf_add(frag, copy);
-
-		pos += bytes;
-		remaining -= bytes;
-
-		if (remaining > 0) {
-			frag = nbuf_get_data(iface);
-			if (!frag) {
-				goto fail;
-			}
+	memcpy(reply, type == OFFER ? offer : ack, sizeof(ack));
+	reply[MSG_TYPE_OFFSET] = type;
+	remaining = sizeof(ack);
 
-			offset = 0;
-			net_buf_frag_add(buf, frag);
-		}
+	if (rapid_commit) {
+		reply[remaining - 1] = RAPID_COMMIT;
+		reply[remaining++] = 0;
+		reply[remaining++] = END;
 	}
 
-	/* Now fixup the expect XID */
-	frag = net_nbuf_write_be32(buf, buf->frags,
-				   (sizeof(struct net_ipv4_hdr) +
-				    sizeof(struct net_udp_hdr)) + 4,
-				   &offset, xid);
-	return buf;
-
-fail:
-	net_nbuf_unref(buf);
-	return NULL;
-}
-
-struct net_buf *prepare_dhcp_ack(struct net_if *iface, uint32_t xid)
-{
-	struct net_buf *buf, *frag;
-	int bytes, remaining = sizeof(ack), pos = 0;
-	uint16_t offset;
-
 	buf = net_nbuf_get_reserve_rx(0);
 	if (!buf) {
 		return NULL;
@@ -365,10 +348,10 @@ struct net_buf *prepare_dhcp_ack(struct net_if *iface, uint32_t xid)
 	net_buf_frag_add(buf, frag);
 
 	/* Place the IPv4 header */
-	set_ipv4_header(buf);
+	set_ipv4_header(buf, remaining);
 
 	/* Place the UDP header */
-	set_udp_header(buf);
+	set_udp_header(buf, remaining);
 
 	net_buf_add(frag, NET_IPV4UDPH_LEN);
 	offset = NET_IPV4UDPH_LEN;
@@ -379,12 +362,12 @@ struct net_buf *prepare_dhcp_ack(struct net_if *iface, uint32_t xid)
 		bytes = net_buf_tailroom(frag);
 		copy = remaining > bytes ? bytes : remaining;
 
-		memcpy(frag->data + offset, &ack[pos], copy);
+		memcpy(frag->data + offset, &reply[pos], copy);
 
 		net_buf_add(frag, copy);
 
-		pos += bytes;
-		remaining -= bytes;
+		pos += copy;
+		remaining -= copy;
 
 		if (remaining > 0) {
 			frag = nbuf_get_data(iface);
@@ -428,9 +411,20 @@ static int parse_dhcp_message(struct net_buf *buf, struct dhcp_msg *msg)
 		return 0;
 	}
 
+	/* size of secs, flags */
+	frag = net_nbuf_skip(frag, offset, &offset, 4);
+	if (!frag) {
+		return 0;
+	}
+
+	frag = net_nbuf_read(frag, offset, &offset, 4, msg->ciaddr.s4_addr);
+	if (!frag) {
+		return 0;
+	}
+
 	frag = net_nbuf_skip(frag, offset, &offset,
-			   /* size of op, htype ... cookie */
-			   (36 + 64 + 128 + 4));
+			   /* size of yiaddr ... cookie */
+			   (28 + 64 + 128 + 4));
 	if (!frag) {
 		return 0;
 	}
@@ -439,35 +433,38 @@ static int parse_dhcp_message(struct net_buf *buf, struct dhcp_msg *msg)
 		uint8_t length;
 
 		frag = net_nbuf_read_u8(frag, offset, &offset, &type);
+		if (!frag || type == END) {
+			break;
+		}
+
+		frag = net_nbuf_read_u8(frag, offset, &offset, &length);
 		if (!frag) {
 			return 0;
 		}
 
-		if (type == MSG_TYPE) {
-			frag = net_nbuf_skip(frag, offset, &offset, 1);
-			if (!frag) {
-				return 0;
-			}
-
+		switch (type) {
+		case MSG_TYPE:
 			frag = net_nbuf_read_u8(frag, offset, &offset,
 						&msg->type);
-			if (!frag) {
-				return 0;
-			}
-
-			return 1;
-		}
-
-		frag = net_nbuf_read_u8(frag, offset, &offset, &length);
-		if (frag) {
+			break;
+		case REQ_IPADDR:
+			frag = net_nbuf_read(frag, offset, &offset, 4,
+					     msg->requested_ip.s4_addr);
+			break;
+		case SERVER_ID:
+			msg->server_id = true;
 			frag = net_nbuf_skip(frag, offset, &offset, length);
-			if (!frag) {
-				return 0;
-			}
+			break;
+		case RAPID_COMMIT:
+			msg->rapid_commit = true;
+			break;
+		default:
+			frag = net_nbuf_skip(frag, offset, &offset, length);
+			break;
 		}
 	}
 
-	return 0;
+	return msg->type != 0;
 }
 
 static int tester_send(struct net_if *iface, struct net_buf *buf)
@@ -487,23 +484,52 @@ static int tester_send(struct net_if *iface, struct net_buf *buf)
 	net_nbuf_unref(buf);
 
 	if (msg.type == DISCOVER) {
-		/* Reply with DHCPv4 offer message */
-		rbuf = prepare_dhcp_offer(iface, msg.xid);
-		if (!rbuf) {
-			return -EINVAL;
+		if (server.discovers < ARRAY_SIZE(server.discover_time)) {
+			server.discover_time[server.discovers] =
+				k_uptime_get_32();
+		}
+
+		server.discovers++;
+
+		if (server.drop_discovers > 0) {
+			server.drop_discovers--;
+			return NET_OK;
+		}
+
+		if (server.rapid_commit && msg.rapid_commit) {
+			/* Reply with DHCPv4 ACK message right away */
+			rbuf = prepare_dhcp_reply(iface, msg.xid, ACK, true);
+		} else {
+			/* Reply with DHCPv4 offer message */
+			rbuf = prepare_dhcp_reply(iface, msg.xid, OFFER,
+						  false);
 		}
 	} else if (msg.type == REQUEST) {
-		/* Reply with DHCPv4 ACK message */
-		rbuf = prepare_dhcp_ack(iface, msg.xid);
-		if (!rbuf) {
-			return -EINVAL;
+		server.requests++;
+		server.request = msg;
+
+		if (server.drop_requests > 0) {
+			server.drop_requests--;
+			return NET_OK;
 		}
 
+		if (server.nak_request) {
+			/* Refuse the address */
+			server.nak_request = false;
+			rbuf = prepare_dhcp_reply(iface, msg.xid, NAK, false);
+		} else {
+			/* Reply with DHCPv4 ACK message */
+			rbuf = prepare_dhcp_reply(iface, msg.xid, ACK, false);
+		}
 	} else {
 		/* Invalid message type received */
 		return -EINVAL;
 	}
 
+	if (!rbuf) {
+		return -EINVAL;
+	}
+
 	if (net_recv_data(iface, rbuf)) {
 		net_nbuf_unref(rbuf);
 
@@ -531,12 +557,230 @@ static struct net_mgmt_event_callback rx_cb;
 static void receiver_cb(struct net_mgmt_event_callback *cb,
 			uint32_t nm_event, struct net_if *iface)
 {
-	test_result(true);
+	k_sem_give(&addr_added);
+}
+
+static void reset_server(void)
+{
+	memset(&server, 0, sizeof(server));
+	k_sem_reset(&addr_added);
+}
+
+/* Wait for the address and check the lease the client got */
+static bool wait_lease(struct net_if *iface)
+{
+	struct net_dhcpv4_lease lease;
+
+	if (k_sem_take(&addr_added, K_SECONDS(10))) {
+		TC_ERROR("No address was added\n");
+		return false;
+	}
+
+	if (net_dhcpv4_get_lease(iface, &lease) < 0) {
+		TC_ERROR("No lease\n");
+		return false;
+	}
+
+	if (!net_ipv4_addr_cmp(&lease.addr, &leased_addr) ||
+	    !net_ipv4_addr_cmp(&lease.server_id, &server_id) ||
+	    lease.lease_time != LEASE_TIME) {
+		TC_ERROR("Invalid lease\n");
+		return false;
+	}
+
+	if (!net_if_ipv4_addr_lookup(&leased_addr, NULL)) {
+		TC_ERROR("Address not found\n");
+		return false;
+	}
+
+	return true;
+}
+
+static bool test_discover(struct net_if *iface)
+{
+	reset_server();
+
+	net_dhcpv4_start(iface);
+
+	if (!wait_lease(iface)) {
+		return false;
+	}
+
+	if (server.discovers != 1 || server.requests != 1) {
+		TC_ERROR("%d DISCOVER and %d REQUEST, expected 1 and 1\n",
+			 server.discovers, server.requests);
+		return false;
+	}
+
+	return true;
+}
+
+static bool test_reboot(struct net_if *iface)
+{
+	struct net_dhcpv4_lease lease;
+
+	if (net_dhcpv4_get_lease(iface, &lease) < 0) {
+		TC_ERROR("No lease\n");
+		return false;
+	}
+
+	net_dhcpv4_stop(iface);
+
+	if (net_if_ipv4_addr_lookup(&leased_addr, NULL)) {
+		TC_ERROR("Address not removed\n");
+		return false;
+	}
+
+	reset_server();
+
+	net_dhcpv4_start_with_lease(iface, &lease);
+
+	if (!wait_lease(iface)) {
+		return false;
+	}
+
+	if (server.discovers != 0 || server.requests != 1) {
+		TC_ERROR("%d DISCOVER and %d REQUEST, expected 0 and 1\n",
+			 server.discovers, server.requests);
+		return false;
+	}
+
+	/* RFC 2131, chapter 4.3.2 */
+	if (server.request.server_id ||
+	    !net_ipv4_addr_cmp(&server.request.ciaddr,
+			       net_ipv4_unspecified_address()) ||
+	    !net_ipv4_addr_cmp(&server.request.requested_ip, &leased_addr)) {
+		TC_ERROR("Invalid INIT-REBOOT request\n");
+		return false;
+	}
+
+	return true;
+}
+
+static bool test_reboot_nak(struct net_if *iface)
+{
+	struct net_dhcpv4_lease lease;
+
+	net_dhcpv4_get_lease(iface, &lease);
+	net_dhcpv4_stop(iface);
+
+	reset_server();
+	server.nak_request = true;
+
+	net_dhcpv4_start_with_lease(iface, &lease);
+
+	if (!wait_lease(iface)) {
+		return false;
+	}
+
+	if (server.discovers != 1 || server.requests != 2) {
+		TC_ERROR("%d DISCOVER and %d REQUEST, expected 1 and 2\n",
+			 server.discovers, server.requests);
+		return false;
+	}
+
+	return true;
+}
+
+/* An unanswered INIT-REBOOT request is not retried, the client goes
+ * to DISCOVER after the first timeout.
+ */
+static bool test_reboot_timeout(struct net_if *iface)
+{
+	struct net_dhcpv4_lease lease;
+
+	net_dhcpv4_get_lease(iface, &lease);
+	net_dhcpv4_stop(iface);
+
+	reset_server();
+	server.drop_requests = 1;
+
+	net_dhcpv4_start_with_lease(iface, &lease);
+
+	if (!wait_lease(iface)) {
+		return false;
+	}
+
+	if (server.discovers != 1 || server.requests != 2) {
+		TC_ERROR("%d DISCOVER and %d REQUEST, expected 1 and 2\n",
+			 server.discovers, server.requests);
+		return false;
+	}
+
+	return true;
 }
 
+#if defined(CONFIG_NET_DHCPV4_RAPID_COMMIT)
+static bool test_rapid_commit(struct net_if *iface)
+{
+	net_dhcpv4_stop(iface);
+
+	reset_server();
+	server.rapid_commit = true;
+
+	net_dhcpv4_start(iface);
+
+	if (!wait_lease(iface)) {
+		return false;
+	}
+
+	if (server.discovers != 1 || server.requests != 0) {
+		TC_ERROR("%d DISCOVER and %d REQUEST, expected 1 and 0\n",
+			 server.discovers, server.requests);
+		return false;
+	}
+
+	return true;
+}
+#endif
+
+static bool test_backoff(struct net_if *iface)
+{
+	uint32_t delay;
+
+	net_dhcpv4_stop(iface);
+
+	reset_server();
+	server.drop_discovers = 1;
+
+	net_dhcpv4_start(iface);
+
+	if (!wait_lease(iface)) {
+		return false;
+	}
+
+	/* The first retransmission is done after 4 +- 1 seconds */
+	delay = server.discover_time[1] - server.discover_time[0];
+	if (server.discovers != 2 || delay < 3000 || delay > 5000) {
+		TC_ERROR("%d DISCOVER, retransmitted after %u ms\n",
+			 server.discovers, delay);
+		return false;
+	}
+
+	return true;
+}
+
+static const struct {
+	const char *name;
+	bool (*func)(struct net_if *iface);
+} tests[] = {
+	{ "DISCOVER, OFFER, REQUEST, ACK", test_discover },
+	{ "INIT-REBOOT with a saved lease", test_reboot },
+	{ "INIT-REBOOT refused by the server", test_reboot_nak },
+	{ "INIT-REBOOT not answered", test_reboot_timeout },
+#if defined(CONFIG_NET_DHCPV4_RAPID_COMMIT)
+	{ "Rapid commit", test_rapid_commit },
+#endif
+	{ "Retransmission of DISCOVER", test_backoff },
+};
+
 void main_thread(void)
 {
 	struct net_if *iface;
+	int status = TC_PASS;
+	int i;
+
+	k_sem_init(&addr_added, 0, UINT_MAX);
 
 	net_mgmt_init_event_callback(&rx_cb, receiver_cb,
 				     NET_EVENT_IPV4_ADDR_ADD);
@@ -549,9 +793,18 @@ void main_thread(void)
 		return;
 	}
 
-	net_dhcpv4_start(iface);
+	for (i = 0; i < ARRAY_SIZE(tests); i++) {
+		TC_START(tests[i].name);
+
+		if (tests[i].func(iface)) {
+			TC_END(PASS, "passed\n");
+		} else {
+			TC_END(FAIL, "failed\n");
+			status = TC_FAIL;
+		}
+	}
 
-	k_yield();
+	TC_END_REPORT(status);
 }
 
 #define STACKSIZE 3000
@@ -0,0 +1,754 @@
+/* main.c - Application main entry point */
+
+/*
+ * Copyright (c) 2016 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <zephyr.h>
+#include <sections.h>
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <device.h>
+#include <init.h>
+#include <misc/printk.h>
+#include <misc/byteorder.h>
+#include <net/buf.h>
+#include <net/net_core.h>
+#include <net/nbuf.h>
+#include <net/net_ip.h>
+#include <net/net_context.h>
+#include <net/ethernet.h>
+#include <iot/dns_client.h>
+
+#include <tc_util.h>
+
+#include "net_private.h"
+
+#define MY_PORT 4242
+#define DNS_PORT 53
+#define MAX_REPLIES 4
+#define TIMEOUT 500
+#define NO_QUERY_WAIT 50
+
+#define DNS_TYPE_A 1
+#define DNS_TYPE_AAAA 28
+#define DNS_TYPE_SOA 6
+
+static struct in6_addr my_addr = { { { 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0,
+				       0, 0, 0, 0, 0, 0, 0, 0x1 } } };
+static struct in6_addr server_addr = { { { 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0,
+					   0, 0, 0, 0, 0, 0, 0, 0x53 } } };
+
+static const struct in_addr ipv4_addr[] = {
+	{ { { 192, 0, 2, 1 } } },
+	{ { { 192, 0, 2, 2 } } },
+	{ { { 192, 0, 2, 3 } } },
+};
+
+static const struct in6_addr ipv6_addr[] = {
+	{ { { 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0,
+	      0, 0, 0, 0, 0, 0, 0x01, 0x00 } } },
+};
+
+/* Names known by the test DNS server. The SOA minimum of the negative
+ * answers is one second.
+ */
+static const struct {
+	const char *name;
+	uint32_t ttl;
+	uint8_t ipv4_count;
+	uint8_t ipv6_count;
+	bool nxdomain;
+	bool silent;
+} zone[] = {
+	{ "www.example.com", 60, 3, 1 },
+	{ "v4.example.com", 1, 1, 0 },
+	{ "nx.example.com", 60, 0, 0, true },
+	{ "silent.example.com", 60, 0, 0, false, true },
+	{ "spoof.example.com", 60, 1, 0 },
+};
+
+static struct net_if *iface;
+static struct net_context *ctx;
+
+/* The answers are held until the test delivers them */
+static struct net_buf *replies[MAX_REPLIES];
+static int reply_count;
+
+static int queries_a;
+static int queries_aaaa;
+static struct k_sem query_sem;
+
+/* The last query and the port it came from */
+static uint8_t last_query[128];
+static uint16_t last_query_len;
+static uint16_t last_query_port;
+
+struct result {
+	int status;
+	struct dns_addresses addresses;
+	bool done;
+};
+
+static struct k_sem result_sem;
+
+struct net_dns_async_context {
+	uint8_t mac_addr[sizeof(struct net_eth_addr)];
+};
+
+static int net_dns_async_dev_init(struct device *dev)
+{
+	return 0;
+}
+
+static void net_dns_async_iface_init(struct net_if *iface)
+{
+	struct net_dns_async_context *context =
+		net_if_get_device(iface)->driver_data;
+
+	/* 10-00-00-00-00 to 10-00-00-00-FF Documentation RFC7042 */
+	context->mac_addr[0] = 0x10;
+	context->mac_addr[5] = sys_rand32_get();
+
+	net_if_set_link_addr(iface, context->mac_addr, 6);
+}
+
+static struct net_buf *create_udp(uint16_t src_port, uint16_t port,
+				  uint8_t *data, uint16_t len)
+{
+	struct net_buf *buf, *frag;
+
+	buf = net_nbuf_get_reserve_rx(0);
+	if (!buf) {
+		return NULL;
+	}
+
+	frag = net_nbuf_get_reserve_data(net_if_get_ll_reserve(iface, NULL));
+	if (!frag) {
+		net_nbuf_unref(buf);
+		return NULL;
+	}
+
+	net_buf_frag_add(buf, frag);
+
+	net_nbuf_set_iface(buf, iface);
+	net_nbuf_set_family(buf, AF_INET6);
+	net_nbuf_set_ip_hdr_len(buf, sizeof(struct net_ipv6_hdr));
+
+	len += sizeof(struct net_udp_hdr);
+
+	NET_IPV6_BUF(buf)->vtc = 0x60;
+	NET_IPV6_BUF(buf)->tcflow = 0;
+	NET_IPV6_BUF(buf)->flow = 0;
+	NET_IPV6_BUF(buf)->len[0] = len >> 8;
+	NET_IPV6_BUF(buf)->len[1] = len & 0xff;
+	NET_IPV6_BUF(buf)->nexthdr = IPPROTO_UDP;
+	NET_IPV6_BUF(buf)->hop_limit = 64;
+
+	net_ipaddr_copy(&NET_IPV6_BUF(buf)->src, &server_addr);
+	net_ipaddr_copy(&NET_IPV6_BUF(buf)->dst, &my_addr);
+
+	net_buf_add(frag, sizeof(struct net_ipv6_hdr));
+
+	NET_UDP_BUF(buf)->src_port = src_port;
+	NET_UDP_BUF(buf)->dst_port = port;
+	NET_UDP_BUF(buf)->len = htons(len);
+	NET_UDP_BUF(buf)->chksum = 0;
+
+	net_buf_add(frag, sizeof(struct net_udp_hdr));
+
+	if (!net_nbuf_append(buf, len - sizeof(struct net_udp_hdr), data)) {
+		net_nbuf_unref(buf);
+		return NULL;
+	}
+
+	return buf;
+}
+
+static uint16_t add_rr(uint8_t *msg, uint16_t len, uint16_t type,
+		       uint32_t ttl, const void *rdata, uint16_t rdlen)
+{
+	/* Pointer to the name in the question */
+	msg[len++] = 0xc0;
+	msg[len++] = 0x0c;
+
+	sys_put_be16(type, msg + len);
+	sys_put_be16(1, msg + len + 2);
+	sys_put_be32(ttl, msg + len + 4);
+	sys_put_be16(rdlen, msg + len + 8);
+	len += 10;
+
+	memcpy(msg + len, rdata, rdlen);
+
+	return len + rdlen;
+}
+
+/* Answer like a DNS server: the question is copied, followed by the
+ * addresses, or a SOA record when there are none.
+ */
+static struct net_buf *create_reply(uint8_t *query, uint16_t query_len,
+				    uint16_t port)
+{
+	uint8_t soa[22] = { 0 };
+	uint8_t msg[256];
+	char name[64];
+	uint16_t qtype;
+	uint16_t len;
+	uint16_t pos = 12;
+	int i, n = 0;
+	int an = 0;
+
+	while (pos < query_len && query[pos] && n + query[pos] + 1 <
+	       sizeof(name)) {
+		if (n) {
+			name[n++] = '.';
+		}
+
+		memcpy(name + n, query + pos + 1, query[pos]);
+		n += query[pos];
+		pos += query[pos] + 1;
+	}
+
+	name[n] = '\0';
+	qtype = sys_get_be16(query + pos + 1);
+	len = pos + 5;
+
+	if (qtype == DNS_TYPE_A) {
+		queries_a++;
+	} else {
+		queries_aaaa++;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(zone); i++) {
+		if (!strcmp(zone[i].name, name)) {
+			break;
+		}
+	}
+
+	if (i == ARRAY_SIZE(zone) || zone[i].silent) {
+		return NULL;
+	}
+
+	memcpy(msg, query, len);
+
+	/* QR, RD and RA */
+	msg[2] = 0x81;
+	msg[3] = 0x80 | (zone[i].nxdomain ? 3 : 0);
+
+	for (n = 0; qtype == DNS_TYPE_A && n < zone[i].ipv4_count; n++) {
+		len = add_rr(msg, len, qtype, zone[i].ttl, &ipv4_addr[n],
+			     sizeof(struct in_addr));
+		an++;
+	}
+
+	for (n = 0; qtype == DNS_TYPE_AAAA && n < zone[i].ipv6_count; n++) {
+		len = add_rr(msg, len, qtype, zone[i].ttl, &ipv6_addr[n],
+			     sizeof(struct in6_addr));
+		an++;
+	}
+
+	sys_put_be16(an, msg + 6);
+	sys_put_be16(an ? 0 : 1, msg + 8);
+	sys_put_be16(0, msg + 10);
+
+	if (!an) {
+		/* Root MNAME and RNAME, then MINIMUM is the last field */
+		sys_put_be32(1, soa + 18);
+		len = add_rr(msg, len, DNS_TYPE_SOA, 60, soa, sizeof(soa));
+	}
+
+	return create_udp(htons(DNS_PORT), port, msg, len);
+}
+
+/* A negative answer to the query, which needs no zone entry */
+static struct net_buf *create_nxdomain(uint8_t *query, uint16_t query_len,
+				       uint16_t src_port, uint16_t port)
+{
+	uint8_t soa[22] = { 0 };
+	uint8_t msg[256];
+	uint16_t len;
+
+	if (query_len + 12 + sizeof(soa) > sizeof(msg)) {
+		return NULL;
+	}
+
+	memcpy(msg, query, query_len);
+
+	msg[2] = 0x81;
+	msg[3] = 0x83;
+	sys_put_be16(0, msg + 6);
+	sys_put_be16(1, msg + 8);
+	sys_put_be16(0, msg + 10);
+
+	sys_put_be32(60, soa + 18);
+	len = add_rr(msg, query_len, DNS_TYPE_SOA, 60, soa, sizeof(soa));
+
+	return create_udp(src_port, port, msg, len);
+}
+
+static int tester_send(struct net_if *iface, struct net_buf *buf)
+{
+	uint16_t offset = sizeof(struct net_ipv6_hdr) +
+		sizeof(struct net_udp_hdr);
+	struct net_buf *reply;
+	uint8_t query[128];
+	uint16_t len, pos;
+
+	len = net_buf_frags_len(buf->frags) - offset;
+	if (len <= sizeof(query)) {
+		net_nbuf_read(buf->frags, offset, &pos, len, query);
+
+		memcpy(last_query, query, len);
+		last_query_len = len;
+		last_query_port = NET_UDP_BUF(buf)->src_port;
+
+		reply = create_reply(query, len, NET_UDP_BUF(buf)->src_port);
+		if (reply && reply_count < MAX_REPLIES) {
+			replies[reply_count++] = reply;
+		} else if (reply) {
+			net_nbuf_unref(reply);
+		}
+	}
+
+	net_nbuf_unref(buf);
+
+	k_sem_give(&query_sem);
+
+	return 0;
+}
+
+static struct net_dns_async_context net_dns_async_data;
+
+static struct net_if_api net_dns_async_if_api = {
+	.init = net_dns_async_iface_init,
+	.send = tester_send,
+};
+
+#define _ETH_L2_LAYER DUMMY_L2
+#define _ETH_L2_CTX_TYPE NET_L2_GET_CTX_TYPE(DUMMY_L2)
+
+NET_DEVICE_INIT(net_dns_async_test, "net_dns_async_test",
+		net_dns_async_dev_init, &net_dns_async_data, NULL,
+		CONFIG_KERNEL_INIT_PRIORITY_DEFAULT,
+		&net_dns_async_if_api, _ETH_L2_LAYER, _ETH_L2_CTX_TYPE, 127);
+
+static void deliver(void)
+{
+	int i;
+
+	for (i = 0; i < reply_count; i++) {
+		if (net_recv_data(iface, replies[i]) < 0) {
+			net_nbuf_unref(replies[i]);
+		}
+	}
+
+	reply_count = 0;
+}
+
+static void resolve_cb(int status, const struct dns_addresses *addresses,
+		       void *user_data)
+{
+	struct result *result = user_data;
+
+	result->status = status;
+	result->addresses = *addresses;
+	result->done = true;
+
+	k_sem_give(&result_sem);
+}
+
+static bool resolve(const char *name, sa_family_t family,
+		    struct result *result)
+{
+	int rc;
+
+	memset(result, 0, sizeof(*result));
+
+	rc = dns_async_resolve(name, family, resolve_cb, result);
+	if (rc) {
+		TC_ERROR("Cannot resolve %s (%d)\n", name, rc);
+		return false;
+	}
+
+	return true;
+}
+
+/* The queries are sent from the TX thread, so they are counted after
+ * they have been seen by the server.
+ */
+static bool wait_queries(int count, bool more)
+{
+	while (count--) {
+		if (k_sem_take(&query_sem, TIMEOUT)) {
+			TC_ERROR("Timeout, %d query(s) not sent\n", count + 1);
+			return false;
+		}
+	}
+
+	if (!more && !k_sem_take(&query_sem, NO_QUERY_WAIT)) {
+		TC_ERROR("Unexpected query\n");
+		return false;
+	}
+
+	return true;
+}
+
+static bool wait_results(int count)
+{
+	while (count--) {
+		if (k_sem_take(&result_sem, TIMEOUT)) {
+			TC_ERROR("Timeout, %d result(s) missing\n", count + 1);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool check_result(struct result *result, int status,
+			 int ipv4_count, int ipv6_count)
+{
+	if (!result->done) {
+		TC_ERROR("No result\n");
+		return false;
+	}
+
+	if (result->status != status ||
+	    result->addresses.ipv4_count != ipv4_count ||
+	    result->addresses.ipv6_count != ipv6_count) {
+		TC_ERROR("Result %d with %d+%d addresses, "
+			 "expected %d with %d+%d\n", result->status,
+			 result->addresses.ipv4_count,
+			 result->addresses.ipv6_count,
+			 status, ipv4_count, ipv6_count);
+		return false;
+	}
+
+	if (ipv4_count && memcmp(result->addresses.ipv4, ipv4_addr,
+				 ipv4_count * sizeof(struct in_addr))) {
+		TC_ERROR("Wrong IPv4 addresses\n");
+		return false;
+	}
+
+	if (ipv6_count && memcmp(result->addresses.ipv6, ipv6_addr,
+				 ipv6_count * sizeof(struct in6_addr))) {
+		TC_ERROR("Wrong IPv6 addresses\n");
+		return false;
+	}
+
+	return true;
+}
+
+static bool test_init(void)
+{
+	struct sockaddr_in6 local = {
+		.sin6_family = AF_INET6,
+		.sin6_port = htons(MY_PORT),
+		.sin6_addr = { { { 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0,
+				   0, 0, 0, 0, 0, 0, 0, 0x1 } } },
+	};
+	struct sockaddr_in6 server = {
+		.sin6_family = AF_INET6,
+		.sin6_port = htons(DNS_PORT),
+		.sin6_addr = { { { 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0,
+				   0, 0, 0, 0, 0, 0, 0, 0x53 } } },
+	};
+
+	iface = net_if_get_default();
+
+	k_sem_init(&query_sem, 0, UINT_MAX);
+	k_sem_init(&result_sem, 0, UINT_MAX);
+
+	if (!net_if_ipv6_addr_add(iface, &my_addr, NET_ADDR_MANUAL, 0)) {
+		TC_ERROR("Cannot add IPv6 address\n");
+		return false;
+	}
+
+	if (net_context_get(AF_INET6, SOCK_DGRAM, IPPROTO_UDP, &ctx)) {
+		TC_ERROR("Cannot get context\n");
+		return false;
+	}
+
+	if (net_context_bind(ctx, (struct sockaddr *)&local, sizeof(local))) {
+		TC_ERROR("Cannot bind\n");
+		return false;
+	}
+
+	if (dns_async_init(ctx, (struct sockaddr *)&server)) {
+		TC_ERROR("Cannot init resolver\n");
+		return false;
+	}
+
+	return true;
+}
+
+/* A and AAAA are queried at the same time, and the second lookup of
+ * the name waits for the same queries.
+ */
+static bool test_parallel(void)
+{
+	struct result result[2];
+
+	queries_a = queries_aaaa = 0;
+
+	if (!resolve("www.example.com", AF_UNSPEC, &result[0]) ||
+	    !wait_queries(2, false)) {
+		return false;
+	}
+
+	if (!resolve("WWW.example.com", AF_INET6, &result[1]) ||
+	    !wait_queries(0, false)) {
+		return false;
+	}
+
+	if (result[0].done || result[1].done) {
+		TC_ERROR("Result before the answer\n");
+		return false;
+	}
+
+	deliver();
+
+	if (!wait_results(2)) {
+		return false;
+	}
+
+	if (queries_a != 1 || queries_aaaa != 1) {
+		TC_ERROR("%d A and %d AAAA queries, expected 1 and 1\n",
+			 queries_a, queries_aaaa);
+		return false;
+	}
+
+	/* The server returns 3 IPv4 addresses, the cache keeps 2 */
+	return check_result(&result[0], 0, 2, 1) &&
+		check_result(&result[1], 0, 0, 1);
+}
+
+static bool test_cache(void)
+{
+	struct result result;
+
+	/* The callback is called before dns_async_resolve() returns */
+	if (!resolve("www.example.com", AF_INET, &result) ||
+	    !check_result(&result, 0, 2, 0)) {
+		return false;
+	}
+
+	k_sem_take(&result_sem, K_NO_WAIT);
+
+	return wait_queries(0, false);
+}
+
+static bool test_negative(void)
+{
+	struct result result;
+
+	if (!resolve("nx.example.com", AF_UNSPEC, &result) ||
+	    !wait_queries(2, false)) {
+		return false;
+	}
+
+	deliver();
+
+	if (!wait_results(1) || !check_result(&result, -ENOENT, 0, 0)) {
+		return false;
+	}
+
+	if (!resolve("nx.example.com", AF_INET, &result) ||
+	    !check_result(&result, -ENOENT, 0, 0) ||
+	    !wait_queries(0, false)) {
+		return false;
+	}
+
+	k_sem_take(&result_sem, K_NO_WAIT);
+
+	/* The negative answer expires after the SOA minimum */
+	k_sleep(MSEC_PER_SEC + 100);
+
+	if (!resolve("nx.example.com", AF_INET, &result) ||
+	    !wait_queries(1, false)) {
+		return false;
+	}
+
+	deliver();
+
+	return wait_results(1) && check_result(&result, -ENOENT, 0, 0);
+}
+
+static bool test_ttl(void)
+{
+	struct result result;
+
+	if (!resolve("v4.example.com", AF_UNSPEC, &result) ||
+	    !wait_queries(2, false)) {
+		return false;
+	}
+
+	deliver();
+
+	if (!wait_results(1) || !check_result(&result, 0, 1, 0)) {
+		return false;
+	}
+
+	/* There are no AAAA records */
+	if (!resolve("v4.example.com", AF_INET6, &result) ||
+	    !check_result(&result, -ENOENT, 0, 0)) {
+		return false;
+	}
+
+	k_sem_take(&result_sem, K_NO_WAIT);
+
+	k_sleep(MSEC_PER_SEC + 100);
+
+	if (!resolve("v4.example.com", AF_INET, &result) ||
+	    !wait_queries(1, false)) {
+		return false;
+	}
+
+	deliver();
+
+	return wait_results(1) && check_result(&result, 0, 1, 0);
+}
+
+/* Answers from another port, or to another question, are dropped */
+static bool test_spoofed(void)
+{
+	uint8_t query[sizeof(last_query)];
+	struct net_buf *forged[3];
+	struct result result;
+	uint16_t len;
+	int i;
+
+	if (!resolve("spoof.example.com", AF_INET, &result) ||
+	    !wait_queries(1, false)) {
+		return false;
+	}
+
+	memcpy(query, last_query, last_query_len);
+	len = last_query_len;
+
+	forged[0] = create_nxdomain(query, len, htons(DNS_PORT + 1),
+				    last_query_port);
+
+	/* "xpoof.example.com" */
+	query[13] = 'x';
+	forged[1] = create_nxdomain(query, len, htons(DNS_PORT),
+				    last_query_port);
+	query[13] = 's';
+
+	/* AAAA instead of A */
+	sys_put_be16(DNS_TYPE_AAAA, query + len - 4);
+	forged[2] = create_nxdomain(query, len, htons(DNS_PORT),
+				    last_query_port);
+
+	for (i = 0; i < ARRAY_SIZE(forged); i++) {
+		if (!forged[i]) {
+			TC_ERROR("Cannot create forged answer %d\n", i);
+			return false;
+		}
+
+		if (net_recv_data(iface, forged[i]) < 0) {
+			net_nbuf_unref(forged[i]);
+		}
+	}
+
+	if (!k_sem_take(&result_sem, NO_QUERY_WAIT) || result.done) {
+		TC_ERROR("Forged answer accepted\n");
+		return false;
+	}
+
+	deliver();
+
+	return wait_results(1) && check_result(&result, 0, 1, 0);
+}
+
+static bool test_timeout(void)
+{
+	struct result result;
+
+	queries_a = 0;
+
+	if (!resolve("silent.example.com", AF_INET, &result) ||
+	    !wait_queries(1, true)) {
+		return false;
+	}
+
+	/* The query is sent again once before the lookup fails */
+	if (!wait_results(1) || !check_result(&result, -ETIMEDOUT, 0, 0)) {
+		return false;
+	}
+
+	if (queries_a != 2) {
+		TC_ERROR("%d queries, expected 2\n", queries_a);
+		return false;
+	}
+
+	return wait_queries(1, false);
+}
+
+static bool test_cancel(void)
+{
+	struct result result;
+
+	/* Failed lookups are not cached */
+	if (!resolve("silent.example.com", AF_INET, &result) ||
+	    !wait_queries(1, true)) {
+		return false;
+	}
+
+	dns_async_cancel(resolve_cb, &result);
+
+	if (!k_sem_take(&result_sem, TIMEOUT) || result.done) {
+		TC_ERROR("Cancelled lookup got a result\n");
+		return false;
+	}
+
+	k_sem_reset(&query_sem);
+
+	return true;
+}
+
+static const struct {
+	const char *name;
+	bool (*func)(void);
+} tests[] = {
+	{ "test init", test_init },
+	{ "parallel and shared queries", test_parallel },
+	{ "cached answer", test_cache },
+	{ "negative caching", test_negative },
+	{ "TTL expiry", test_ttl },
+	{ "spoofed answers", test_spoofed },
+	{ "query timeout", test_timeout },
+	{ "cancel lookup", test_cancel },
+};
+
+void main(void)
+{
+	int count, pass;
+
+	for (count = 0, pass = 0; count < ARRAY_SIZE(tests); count++) {
+		TC_START(tests[count].name);
+		if (!tests[count].func()) {
+			TC_END(FAIL, "failed\n");
+		} else {
+			TC_END(PASS, "passed\n");
+			pass++;
+		}
+	}
+
+	TC_END_REPORT(((pass != ARRAY_SIZE(tests)) ? TC_FAIL : TC_PASS));
+}
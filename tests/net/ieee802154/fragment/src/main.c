@@ -146,8 +146,11 @@ struct net_fragment_data {
 	struct net_udp_hdr udp;
 	int len;
 	bool iphc;
+	bool ext;
 } __packed;
 
+static bool ext_released;
+
 
 int net_fragment_dev_init(struct device *dev)
 {
@@ -224,6 +227,11 @@ static bool compare_data(struct net_buf *buf, struct net_fragment_data *data)
 	return true;
 }
 
+static void ext_release(const uint8_t *data, void *user_data)
+{
+	ext_released = true;
+}
+
 static struct net_buf *create_buf(struct net_fragment_data *data)
 {
 	struct net_buf *buf, *frag;
@@ -264,6 +272,19 @@ static struct net_buf *create_buf(struct net_fragment_data *data)
 	data->ipv6.len[1] = (uint8_t) len;
 	data->udp.len = htons(len);
 
+	if (data->ext) {
+		net_buf_frag_add(buf, frag);
+
+		if (!net_nbuf_append_ext(buf, remaining,
+					 (const uint8_t *)user_data,
+					 ext_release, NULL)) {
+			net_nbuf_unref(buf);
+			return NULL;
+		}
+
+		return buf;
+	}
+
 	while (remaining > 0) {
 		uint8_t copy;
 		bytes = net_buf_tailroom(frag);
@@ -424,12 +445,50 @@ static struct net_fragment_data test_data_8 = {
 	.iphc = false
 };
 
+static struct net_fragment_data test_data_9 = {
+	.ipv6.vtc = 0x60,
+	.ipv6.tcflow = 0x0,
+	.ipv6.flow = 0x0,
+	.ipv6.len = { 0x00, 0x00 },
+	.ipv6.nexthdr = IPPROTO_UDP,
+	.ipv6.hop_limit = 0xff,
+	.ipv6.src = src_sam10,
+	.ipv6.dst = dst_m1_dam10,
+	.udp.src_port = htons(udp_src_port_8bit),
+	.udp.dst_port = htons(udp_dst_port_8bit),
+	.udp.len = 0x00,
+	.udp.chksum = 0x00,
+	.len = 900,
+	.iphc = true,
+	.ext = true
+};
+
+static struct net_fragment_data test_data_10 = {
+	.ipv6.vtc = 0x61,
+	.ipv6.tcflow = 0x20,
+	.ipv6.flow = 0x00,
+	.ipv6.len = { 0x00, 0x00 },
+	.ipv6.nexthdr = IPPROTO_UDP,
+	.ipv6.hop_limit = 0xff,
+	.ipv6.src = src_sac1_sam00,
+	.ipv6.dst = dst_m1_dam00,
+	.udp.src_port = htons(udp_src_port_16bit),
+	.udp.dst_port = htons(udp_dst_port_16bit),
+	.udp.len = 0x00,
+	.udp.chksum = 0x00,
+	.len = 40,
+	.iphc = false,
+	.ext = true
+};
+
 static int test_fragment(struct net_fragment_data *data)
 {
 	struct net_buf *rxbuf = NULL;
 	int result = TC_FAIL;
 	struct net_buf *buf, *frag, *dfrag;
 
+	ext_released = false;
+
 	buf = create_buf(data);
 	if (!buf) {
 		TC_PRINT("%s: failed to create buffer\n", __func__);
@@ -447,6 +506,12 @@ static int test_fragment(struct net_fragment_data *data)
 		goto end;
 	}
 
+	/* External data is copied into the frames and released already */
+	if (data->ext && !ext_released) {
+		TC_PRINT("external data not released\n");
+		goto end;
+	}
+
 #if DEBUG > 0
 	printk("length after compression and fragmentation %zd\n",
 	       net_buf_frags_len(buf->frags));
@@ -503,6 +568,236 @@ end:
 	return result;
 }
 
+static struct net_buf *fragment_data(struct net_fragment_data *data)
+{
+	struct net_buf *buf;
+
+	buf = create_buf(data);
+	if (!buf) {
+		TC_PRINT("%s: failed to create buffer\n", __func__);
+		return NULL;
+	}
+
+	if (!net_6lo_compress(buf, data->iphc, ieee802154_fragment)) {
+		TC_PRINT("compression failed\n");
+		net_nbuf_unref(buf);
+		return NULL;
+	}
+
+	return buf;
+}
+
+static struct net_buf *get_frame(struct net_buf *buf, int n)
+{
+	struct net_buf *frag = buf->frags;
+
+	while (frag && n--) {
+		frag = frag->frags;
+	}
+
+	return frag;
+}
+
+static int count_frames(struct net_buf *buf)
+{
+	struct net_buf *frag;
+	int count = 0;
+
+	for (frag = buf->frags; frag; frag = frag->frags) {
+		count++;
+	}
+
+	return count;
+}
+
+/* Give a copy of the frame to the reassembly, like the radio does. The
+ * Rx buf is released here unless it holds the reassembled datagram.
+ */
+static enum net_verdict receive_frame(struct net_buf *frame,
+				      struct net_buf **rxbuf)
+{
+	enum net_verdict verdict;
+	struct net_buf *dfrag;
+
+	*rxbuf = net_nbuf_get_reserve_rx(0);
+	if (!*rxbuf) {
+		TC_PRINT("out of rx buffers\n");
+		return NET_DROP;
+	}
+
+	net_nbuf_set_ll_reserve(*rxbuf, 0);
+
+	dfrag = net_nbuf_get_reserve_data(0);
+	if (!dfrag) {
+		TC_PRINT("out of data buffers\n");
+		net_nbuf_unref(*rxbuf);
+		return NET_DROP;
+	}
+
+	memcpy(dfrag->data, frame->data, frame->len);
+	dfrag->len = frame->len;
+
+	net_buf_frag_add(*rxbuf, dfrag);
+
+	verdict = ieee802154_reassemble(*rxbuf);
+	if (verdict == NET_DROP) {
+		net_nbuf_unref(*rxbuf);
+	}
+
+	return verdict;
+}
+
+#define CONCURRENT 3
+
+/* Fragments of three datagrams are interleaved, the last datagram in
+ * reverse order, and one fragment is received twice.
+ */
+static int test_concurrent(void)
+{
+	struct net_fragment_data *data[CONCURRENT] = {
+		&test_data_2, &test_data_3, &test_data_4
+	};
+	uint32_t duplicate = net_stats.ieee802154_reass.duplicate;
+	struct net_buf *buf[CONCURRENT] = { NULL };
+	int frames[CONCURRENT];
+	int result = TC_FAIL;
+	int done = 0;
+	int i, n, round;
+
+	for (i = 0; i < CONCURRENT; i++) {
+		buf[i] = fragment_data(data[i]);
+		if (!buf[i]) {
+			goto end;
+		}
+
+		frames[i] = count_frames(buf[i]);
+	}
+
+	for (round = 0; done < CONCURRENT; round++) {
+		for (i = 0; i < CONCURRENT; i++) {
+			struct net_buf *rxbuf;
+
+			if (round >= frames[i]) {
+				continue;
+			}
+
+			if (i == CONCURRENT - 1) {
+				n = frames[i] - round - 1;
+			} else {
+				n = round;
+			}
+
+			switch (receive_frame(get_frame(buf[i], n), &rxbuf)) {
+			case NET_OK:
+				if (round == frames[i] - 1) {
+					TC_PRINT("datagram %d not complete\n",
+						 i);
+					goto end;
+				}
+
+				break;
+			case NET_CONTINUE:
+				if (round != frames[i] - 1) {
+					TC_PRINT("datagram %d complete early\n",
+						 i);
+					net_nbuf_unref(rxbuf);
+					goto end;
+				}
+
+				if (!compare_data(rxbuf, data[i])) {
+					net_nbuf_unref(rxbuf);
+					goto end;
+				}
+
+				net_nbuf_unref(rxbuf);
+				done++;
+				break;
+			case NET_DROP:
+				TC_PRINT("datagram %d frame %d dropped\n",
+					 i, n);
+				goto end;
+			}
+		}
+
+		if (round == 0) {
+			struct net_buf *rxbuf;
+
+			if (receive_frame(get_frame(buf[0], 0), &rxbuf) !=
+			    NET_DROP) {
+				TC_PRINT("duplicate fragment accepted\n");
+				goto end;
+			}
+		}
+	}
+
+	if (net_stats.ieee802154_reass.duplicate != duplicate + 1) {
+		TC_PRINT("duplicate not counted\n");
+		goto end;
+	}
+
+	result = TC_PASS;
+
+end:
+	for (i = 0; i < CONCURRENT; i++) {
+		net_nbuf_unref(buf[i]);
+	}
+
+	return result;
+}
+
+/* The cache has room for three datagrams, the fourth one is dropped.
+ * The incomplete datagrams are dropped after the reassembly timeout.
+ */
+static int test_cache_full(void)
+{
+	struct net_fragment_data *data[CONCURRENT + 1] = {
+		&test_data_2, &test_data_3, &test_data_4, &test_data_5
+	};
+	uint32_t timeout = net_stats.ieee802154_reass.timeout;
+	uint32_t full = net_stats.ieee802154_reass.full;
+	enum net_verdict verdict;
+	struct net_buf *rxbuf;
+	struct net_buf *buf;
+	int i;
+
+	for (i = 0; i < CONCURRENT + 1; i++) {
+		buf = fragment_data(data[i]);
+		if (!buf) {
+			return TC_FAIL;
+		}
+
+		verdict = receive_frame(buf->frags, &rxbuf);
+		net_nbuf_unref(buf);
+
+		if (verdict != (i < CONCURRENT ? NET_OK : NET_DROP)) {
+			TC_PRINT("datagram %d: unexpected verdict %d\n",
+				 i, verdict);
+			return TC_FAIL;
+		}
+	}
+
+	if (net_stats.ieee802154_reass.full != full + 1) {
+		TC_PRINT("full cache drop not counted\n");
+		return TC_FAIL;
+	}
+
+	/* Timers run in one second ticks, so this can take up to two
+	 * ticks more than the timeout.
+	 */
+	k_sleep((CONFIG_NET_L2_IEEE802154_REASSEMBLY_TIMEOUT + 2) *
+		MSEC_PER_SEC + MSEC_PER_SEC / 2);
+
+	if (net_stats.ieee802154_reass.timeout != timeout + CONCURRENT) {
+		TC_PRINT("%u reassembly timeouts, expected %u\n",
+			 net_stats.ieee802154_reass.timeout - timeout,
+			 CONCURRENT);
+		return TC_FAIL;
+	}
+
+	/* The cache entries are free again */
+	return test_fragment(&test_data_5);
+}
+
 /* tests names are based on traffic class, flow label, source address mode
  * (sam), destination address mode (dam), based on udp source and destination
  * ports compressible type.
@@ -519,6 +814,16 @@ static const struct {
 	{ "test_fragment_sam10_m1_dam10", &test_data_6},
 	{ "test_fragment_ipv6_dispatch_small", &test_data_7},
 	{ "test_fragment_ipv6_dispatch_big", &test_data_8},
+	{ "test_fragment_ext_data_big", &test_data_9},
+	{ "test_fragment_ext_data_small", &test_data_10},
+};
+
+static const struct {
+	const char *name;
+	int (*func)(void);
+} reass_tests[] = {
+	{ "test_reassembly_concurrent", test_concurrent },
+	{ "test_reassembly_cache_full_timeout", test_cache_full },
 };
 
 static void main_thread(void)
@@ -536,7 +841,19 @@ static void main_thread(void)
 		}
 	}
 
-	TC_END_REPORT(((pass != ARRAY_SIZE(tests)) ? TC_FAIL : TC_PASS));
+	for (count = 0; count < ARRAY_SIZE(reass_tests); count++) {
+		TC_START(reass_tests[count].name);
+
+		if (reass_tests[count].func()) {
+			TC_END(FAIL, "failed\n");
+		} else {
+			TC_END(PASS, "passed\n");
+			pass++;
+		}
+	}
+
+	TC_END_REPORT(((pass != ARRAY_SIZE(tests) + ARRAY_SIZE(reass_tests)) ?
+		       TC_FAIL : TC_PASS));
 }
 
 #define STACKSIZE 8000
@@ -22,6 +22,7 @@
 #include <string.h>
 #include <errno.h>
 #include <sections.h>
+#include <misc/byteorder.h>
 
 #include <tc_util.h>
 
@@ -32,6 +33,7 @@
 
 #include "icmpv6.h"
 #include "ipv6.h"
+#include "udp.h"
 
 #define NET_DEBUG 1
 #include "net_private.h"
@@ -132,6 +134,12 @@ static const unsigned char ipv6_hbho[] = {
 static bool test_failed;
 static struct k_sem wait_data;
 
+#if defined(CONFIG_NET_IPV6_FRAGMENT)
+static bool frag_sending;
+static int frag_sent_count;
+static bool frag_timeout_seen;
+#endif
+
 #define WAIT_TIME 250
 #define WAIT_TIME_LONG MSEC_PER_SEC
 #define SENDING 93244
@@ -212,6 +220,32 @@ static int tester_send(struct net_if *iface, struct net_buf *buf)
 		return -ENODATA;
 	}
 
+#if defined(CONFIG_NET_IPV6_FRAGMENT)
+	if (NET_IPV6_BUF(buf)->nexthdr == IPPROTO_ICMPV6 &&
+	    icmp->type == NET_ICMPV6_TIME_EXCEEDED &&
+	    icmp->code == NET_ICMPV6_TIME_EXCEEDED_REASSEMBLY) {
+		frag_timeout_seen = true;
+	}
+
+	if (frag_sending) {
+		struct in6_addr addr;
+
+		if (NET_IPV6_BUF(buf)->nexthdr != NET_IPV6_NEXTHDR_FRAG ||
+		    net_buf_frags_len(buf->frags) > NET_IPV6_MTU) {
+			TC_ERROR("Invalid fragment %d\n", frag_sent_count);
+			test_failed = true;
+		}
+
+		frag_sent_count++;
+
+		/* Swap the addresses so that the fragments are for us */
+		net_ipaddr_copy(&addr, &NET_IPV6_BUF(buf)->src);
+		net_ipaddr_copy(&NET_IPV6_BUF(buf)->src,
+				&NET_IPV6_BUF(buf)->dst);
+		net_ipaddr_copy(&NET_IPV6_BUF(buf)->dst, &addr);
+	}
+#endif
+
 	/* Reply with RA messge */
 	if (icmp->type == NET_ICMPV6_RS) {
 		net_nbuf_unref(buf);
@@ -619,6 +653,418 @@ static bool net_test_change_ll_addr(void)
 	return true;
 }
 
+#define NBR_COUNT 4
+
+static bool net_test_nbr_cache(void)
+{
+	uint8_t mac[] = { 0x02, 0x00, 0x5e, 0x00, 0x53, 0x00 };
+	struct net_linkaddr lladdr = { .addr = mac, .len = sizeof(mac) };
+	struct net_nbr *nbrs[NBR_COUNT];
+	struct in6_addr addr;
+	struct net_buf *buf, *frag;
+	struct net_if *iface;
+	int i;
+
+	iface = net_if_get_default();
+
+	net_ipv6_addr_create(&addr, 0x2001, 0x0db8, 0, 0, 0, 0, 0, 0x0100);
+
+	for (i = 0; i < NBR_COUNT; i++) {
+		addr.s6_addr[15] = 0x10 + i;
+		mac[5] = 0x10 + i;
+
+		nbrs[i] = net_ipv6_nbr_add(iface, &addr, &lladdr, false,
+					   NET_NBR_STALE);
+		if (!nbrs[i]) {
+			TC_ERROR("Cannot add neighbor %d\n", i);
+			return false;
+		}
+	}
+
+	for (i = 0; i < NBR_COUNT; i++) {
+		addr.s6_addr[15] = 0x10 + i;
+
+		if (net_ipv6_nbr_lookup(iface, &addr) != nbrs[i]) {
+			TC_ERROR("Neighbor %d not found\n", i);
+			return false;
+		}
+	}
+
+	/* Sending to a stale neighbor must start the reachability check */
+	buf = net_nbuf_get_reserve_tx(0);
+	frag = net_nbuf_get_reserve_data(net_if_get_ll_reserve(iface, NULL));
+	net_buf_frag_add(buf, frag);
+
+	net_nbuf_set_iface(buf, iface);
+	net_nbuf_set_family(buf, AF_INET6);
+
+	addr.s6_addr[15] = 0x10;
+	net_ipaddr_copy(&NET_IPV6_BUF(buf)->src, &my_addr);
+	net_ipaddr_copy(&NET_IPV6_BUF(buf)->dst, &addr);
+	net_buf_add(frag, sizeof(struct net_ipv6_hdr));
+
+	if (net_ipv6_prepare_for_send(buf) != buf) {
+		TC_ERROR("Packet to a known neighbor was not sent\n");
+		return false;
+	}
+
+	net_nbuf_unref(buf);
+
+	if (net_ipv6_nbr_data(nbrs[0])->state != NET_NBR_DELAY) {
+		TC_ERROR("Neighbor state %d, expected DELAY\n",
+			 net_ipv6_nbr_data(nbrs[0])->state);
+		return false;
+	}
+
+	/* Removing one neighbor must not hide the others */
+	net_nbr_unref(nbrs[1]);
+
+	for (i = 0; i < NBR_COUNT; i++) {
+		struct net_nbr *nbr;
+
+		addr.s6_addr[15] = 0x10 + i;
+
+		nbr = net_ipv6_nbr_lookup(iface, &addr);
+		if ((i == 1 && nbr) || (i != 1 && nbr != nbrs[i])) {
+			TC_ERROR("Wrong lookup result for neighbor %d\n", i);
+			return false;
+		}
+	}
+
+	for (i = 0; i < NBR_COUNT; i++) {
+		if (i != 1) {
+			net_nbr_unref(nbrs[i]);
+		}
+	}
+
+	return true;
+}
+
+#if defined(CONFIG_NET_IPV6_FRAGMENT)
+#define FRAG_LEN 300
+#define FRAG_SEND_LEN 2000
+#define FRAG_WAIT_TIME 100
+
+/* UDP header and data of the fragmented packets */
+static uint8_t frag_payload[FRAG_SEND_LEN];
+static struct k_sem frag_recv;
+static int frag_recv_len;
+static int frag_recv_bufs;
+static bool frag_data_ok;
+static uint32_t frag_id = 0x1000;
+
+static void frag_set_udp_len(uint16_t len)
+{
+	sys_put_be16(len, frag_payload + 4);
+}
+
+static enum net_verdict frag_recv_cb(struct net_conn *conn,
+				     struct net_buf *buf,
+				     void *user_data)
+{
+	struct net_buf *frag;
+	uint16_t pos;
+	uint8_t byte;
+	int i;
+
+	frag_recv_len = net_buf_frags_len(buf->frags) -
+		sizeof(struct net_ipv6_hdr);
+	frag_data_ok = !net_nbuf_ext_len(buf);
+
+	for (frag_recv_bufs = 0, frag = buf->frags; frag;
+	     frag = frag->frags) {
+		frag_recv_bufs++;
+	}
+
+	frag = net_nbuf_skip(buf->frags, 0, &pos,
+			     sizeof(struct net_ipv6_hdr));
+
+	for (i = 0; i < frag_recv_len && frag; i++) {
+		frag = net_nbuf_read_u8(frag, pos, &pos, &byte);
+		if (byte != frag_payload[i]) {
+			frag_data_ok = false;
+		}
+	}
+
+	if (i != frag_recv_len) {
+		frag_data_ok = false;
+	}
+
+	net_nbuf_unref(buf);
+
+	k_sem_give(&frag_recv);
+
+	return NET_OK;
+}
+
+static bool frag_send(uint32_t id, uint16_t offset, uint16_t len, bool more)
+{
+	uint8_t hdr[sizeof(struct net_ipv6_hdr) + 8];
+	struct net_if *iface = net_if_get_default();
+	struct net_buf *buf;
+
+	buf = net_nbuf_get_reserve_rx(0);
+	if (!buf) {
+		TC_ERROR("Out of RX buffers\n");
+		return false;
+	}
+
+	net_nbuf_set_ll_reserve(buf, 0);
+	net_nbuf_set_iface(buf, iface);
+	net_nbuf_set_family(buf, AF_INET6);
+	net_nbuf_ll_clear(buf);
+
+	memset(hdr, 0, sizeof(hdr));
+	hdr[0] = 0x60;
+	sys_put_be16(len + 8, hdr + 4);
+	hdr[6] = NET_IPV6_NEXTHDR_FRAG;
+	hdr[7] = 64;
+	memcpy(hdr + 8, &peer_addr, sizeof(peer_addr));
+	memcpy(hdr + 24, &my_addr, sizeof(my_addr));
+
+	hdr[40] = IPPROTO_UDP;
+	sys_put_be16(offset | (more ? 1 : 0), hdr + 42);
+	sys_put_be32(id, hdr + 44);
+
+	if (!net_nbuf_append(buf, sizeof(hdr), hdr) ||
+	    !net_nbuf_append(buf, len, frag_payload + offset)) {
+		TC_ERROR("Out of data buffers\n");
+		net_nbuf_unref(buf);
+		return false;
+	}
+
+	if (net_recv_data(iface, buf) < 0) {
+		TC_ERROR("Fragment receive failed\n");
+		net_nbuf_unref(buf);
+		return false;
+	}
+
+	return true;
+}
+
+static bool frag_wait(int len)
+{
+	if (k_sem_take(&frag_recv, FRAG_WAIT_TIME)) {
+		TC_ERROR("Reassembled packet not received\n");
+		return false;
+	}
+
+	if (frag_recv_len != len || !frag_data_ok) {
+		TC_ERROR("Reassembled packet is invalid (len %d)\n",
+			 frag_recv_len);
+		return false;
+	}
+
+	return true;
+}
+
+static bool frag_wait_none(void)
+{
+	if (!k_sem_take(&frag_recv, FRAG_WAIT_TIME)) {
+		TC_ERROR("Unexpected packet received\n");
+		return false;
+	}
+
+	return true;
+}
+
+static bool net_test_frag_init(void)
+{
+	int i, ret;
+
+	for (i = 0; i < sizeof(frag_payload); i++) {
+		frag_payload[i] = i;
+	}
+
+	sys_put_be16(PEER_PORT, frag_payload);
+	sys_put_be16(MY_PORT, frag_payload + 2);
+	sys_put_be16(0, frag_payload + 6);
+
+	k_sem_init(&frag_recv, 0, UINT_MAX);
+
+	ret = net_udp_register(NULL, NULL, 0, MY_PORT, frag_recv_cb, NULL,
+			       NULL);
+	if (ret) {
+		TC_ERROR("UDP register failed (%d)\n", ret);
+		return false;
+	}
+
+	TC_PRINT("Reassembly contexts use %zu bytes (%d x %zu)\n",
+		 CONFIG_NET_IPV6_FRAGMENT_MAX_COUNT *
+		 sizeof(struct net_ipv6_reassembly),
+		 CONFIG_NET_IPV6_FRAGMENT_MAX_COUNT,
+		 sizeof(struct net_ipv6_reassembly));
+
+	return true;
+}
+
+static bool net_test_frag_in_order(void)
+{
+	uint32_t id = frag_id++;
+
+	frag_set_udp_len(FRAG_LEN);
+
+	if (!frag_send(id, 0, 104, true) ||
+	    !frag_send(id, 104, 104, true) ||
+	    !frag_send(id, 208, FRAG_LEN - 208, false)) {
+		return false;
+	}
+
+	if (!frag_wait(FRAG_LEN)) {
+		return false;
+	}
+
+	/* The data buffers of the fragments are chained, not copied */
+	TC_PRINT("%d bytes from 3 fragments in %d data buffers "
+		 "(%d bytes each)\n", FRAG_LEN, frag_recv_bufs,
+		 CONFIG_NET_NBUF_DATA_SIZE);
+
+	return true;
+}
+
+static bool net_test_frag_out_of_order(void)
+{
+	uint32_t id = frag_id++;
+
+	frag_set_udp_len(FRAG_LEN);
+
+	if (!frag_send(id, 208, FRAG_LEN - 208, false) ||
+	    !frag_send(id, 0, 104, true) ||
+	    !frag_send(id, 104, 104, true)) {
+		return false;
+	}
+
+	return frag_wait(FRAG_LEN);
+}
+
+static bool net_test_frag_duplicate(void)
+{
+	uint32_t id = frag_id++;
+
+	frag_set_udp_len(FRAG_LEN);
+
+	if (!frag_send(id, 104, 104, true) ||
+	    !frag_send(id, 0, 104, true) ||
+	    !frag_send(id, 104, 104, true) ||
+	    !frag_send(id, 208, FRAG_LEN - 208, false)) {
+		return false;
+	}
+
+	if (!frag_wait(FRAG_LEN)) {
+		return false;
+	}
+
+	/* The duplicate must not cause a second packet */
+	return frag_wait_none();
+}
+
+static bool net_test_frag_overlap(void)
+{
+	uint32_t id = frag_id++;
+
+	frag_set_udp_len(FRAG_LEN);
+
+	/* The overlapping fragment discards the whole packet */
+	if (!frag_send(id, 0, 104, true) ||
+	    !frag_send(id, 96, 112, true)) {
+		return false;
+	}
+
+	if (!frag_wait_none()) {
+		return false;
+	}
+
+	/* The reassembly context must be free for the next packet */
+	id = frag_id++;
+
+	if (!frag_send(id, 0, 104, true) ||
+	    !frag_send(id, 104, FRAG_LEN - 104, false)) {
+		return false;
+	}
+
+	return frag_wait(FRAG_LEN);
+}
+
+static bool net_test_frag_timeout(void)
+{
+	uint32_t id = frag_id++;
+
+	frag_timeout_seen = false;
+	frag_set_udp_len(FRAG_LEN);
+
+	if (!frag_send(id, 0, 104, true)) {
+		return false;
+	}
+
+	k_sleep(K_SECONDS(CONFIG_NET_IPV6_FRAGMENT_TIMEOUT) + WAIT_TIME);
+
+	if (!frag_timeout_seen) {
+		TC_ERROR("Time Exceeded message not sent\n");
+		return false;
+	}
+
+	return frag_wait_none();
+}
+
+static bool net_test_frag_send(void)
+{
+	struct net_if *iface = net_if_get_default();
+	uint8_t hdr[sizeof(struct net_ipv6_hdr)];
+	struct net_buf *buf;
+	bool ret;
+
+	buf = net_nbuf_get_reserve_tx(0);
+	if (!buf) {
+		TC_ERROR("Out of TX buffers\n");
+		return false;
+	}
+
+	net_nbuf_set_ll_reserve(buf, net_if_get_ll_reserve(iface, NULL));
+	net_nbuf_set_iface(buf, iface);
+	net_nbuf_set_family(buf, AF_INET6);
+	net_nbuf_set_ip_hdr_len(buf, sizeof(struct net_ipv6_hdr));
+	net_nbuf_set_ext_len(buf, 0);
+
+	frag_set_udp_len(FRAG_SEND_LEN);
+
+	memset(hdr, 0, sizeof(hdr));
+	hdr[0] = 0x60;
+	sys_put_be16(FRAG_SEND_LEN, hdr + 4);
+	hdr[6] = IPPROTO_UDP;
+	hdr[7] = 64;
+	memcpy(hdr + 8, &my_addr, sizeof(my_addr));
+	memcpy(hdr + 24, &peer_addr, sizeof(peer_addr));
+
+	if (!net_nbuf_append(buf, sizeof(hdr), hdr) ||
+	    !net_nbuf_append(buf, FRAG_SEND_LEN, frag_payload)) {
+		TC_ERROR("Out of data buffers\n");
+		net_nbuf_unref(buf);
+		return false;
+	}
+
+	frag_sending = true;
+	frag_sent_count = 0;
+
+	if (net_send_data(buf) < 0) {
+		TC_ERROR("Send failed\n");
+		net_nbuf_unref(buf);
+		frag_sending = false;
+		return false;
+	}
+
+	ret = frag_wait(FRAG_SEND_LEN);
+
+	frag_sending = false;
+
+	if (ret && frag_sent_count != 2) {
+		TC_ERROR("Sent %d fragments, expected 2\n", frag_sent_count);
+		return false;
+	}
+
+	return ret;
+}
+#endif /* CONFIG_NET_IPV6_FRAGMENT */
+
 static const struct {
 	const char *name;
 	bool (*func)(void);
@@ -633,8 +1079,18 @@ static const struct {
 	{ "IPv6 handle RA message", net_test_ra_message },
 	{ "IPv6 parse Hop-By-Hop Option", net_test_hbho_message },
 	{ "IPv6 change ll address", net_test_change_ll_addr },
+	{ "IPv6 neighbor cache", net_test_nbr_cache },
 	{ "IPv6 prefix timeout", net_test_prefix_timeout },
 	/*{ "IPv6 prefix timeout overflow", net_test_prefix_timeout_overflow },*/
+#if defined(CONFIG_NET_IPV6_FRAGMENT)
+	{ "IPv6 fragment init", net_test_frag_init },
+	{ "IPv6 reassembly in order", net_test_frag_in_order },
+	{ "IPv6 reassembly out of order", net_test_frag_out_of_order },
+	{ "IPv6 reassembly duplicate fragment", net_test_frag_duplicate },
+	{ "IPv6 reassembly overlapping fragment", net_test_frag_overlap },
+	{ "IPv6 reassembly timeout", net_test_frag_timeout },
+	{ "IPv6 send fragmented packet", net_test_frag_send },
+#endif
 };
 
 void main(void)
@@ -26,6 +26,8 @@
 #define TEST_MGMT_REQUEST		0x0ABC1234
 #define TEST_MGMT_EVENT			0x8ABC1234
 #define TEST_MGMT_EVENT_UNHANDLED	0x8ABC4321
+#define TEST_MGMT_EVENT_BURST		0x8ABC5000
+#define TEST_MGMT_EVENT_BURST_MASK	0x8ABC500F
 
 /* Notifier infra */
 static uint32_t event2throw;
@@ -212,6 +214,113 @@ out:
 	return ret;
 }
 
+static inline int check_queued_events(struct net_mgmt_event_queue *queue,
+				      uint32_t first, uint32_t count,
+				      uint32_t overflows)
+{
+	uint32_t event;
+
+	if (queue->overflows != overflows) {
+		TC_PRINT("\t%u events lost, expected %u\n",
+			 queue->overflows, overflows);
+		return TC_FAIL;
+	}
+
+	for (; count; count--, first++) {
+		if (net_mgmt_event_queue_get(queue, &event, NULL, K_NO_WAIT)) {
+			TC_PRINT("\tEvent 0x%08X missing\n",
+				 TEST_MGMT_EVENT_BURST | first);
+			return TC_FAIL;
+		}
+
+		if (event != (TEST_MGMT_EVENT_BURST | first)) {
+			TC_PRINT("\tReceived 0x%08X instead of 0x%08X\n",
+				 event, TEST_MGMT_EVENT_BURST | first);
+			return TC_FAIL;
+		}
+	}
+
+	if (net_mgmt_event_queue_get(queue, NULL, NULL, K_NO_WAIT) !=
+	    -EBUSY) {
+		TC_PRINT("\tToo many events queued\n");
+		return TC_FAIL;
+	}
+
+	return TC_PASS;
+}
+
+static int test_event_queues(void)
+{
+	struct net_mgmt_event_entry small_events[4];
+	struct net_mgmt_event_entry large_events[8];
+	struct net_mgmt_event_queue small, large;
+	int ret = TC_FAIL;
+	uint32_t i;
+
+	TC_PRINT("- Bursting events to two event queues\n");
+
+	net_mgmt_init_event_queue(&small, small_events,
+				  ARRAY_SIZE(small_events),
+				  TEST_MGMT_EVENT_BURST_MASK);
+	net_mgmt_init_event_queue(&large, large_events,
+				  ARRAY_SIZE(large_events),
+				  TEST_MGMT_EVENT_BURST_MASK);
+
+	net_mgmt_add_event_queue(&small);
+	net_mgmt_add_event_queue(&large);
+
+	for (i = 0; i < 6; i++) {
+		net_mgmt_event_notify(TEST_MGMT_EVENT_BURST | i, NULL);
+		net_mgmt_event_notify(TEST_MGMT_EVENT_UNHANDLED, NULL);
+	}
+
+	/* The small queue keeps the newest events */
+	if (check_queued_events(&small, 2, 4, 2) != TC_PASS) {
+		goto out;
+	}
+
+	if (check_queued_events(&large, 0, 6, 0) != TC_PASS) {
+		goto out;
+	}
+
+	ret = TC_PASS;
+
+out:
+	net_mgmt_del_event_queue(&small);
+	net_mgmt_del_event_queue(&large);
+
+	return ret;
+}
+
+static int test_event_wait(void)
+{
+	struct net_if *iface;
+	uint32_t event;
+	int ret;
+
+	TC_PRINT("- Waiting for an event\n");
+
+	event2throw = TEST_MGMT_EVENT;
+	throw_times = 1;
+
+	k_sem_give(&thrower_lock);
+
+	ret = net_mgmt_event_wait(TEST_MGMT_EVENT, &event, &iface,
+				  K_MSEC(100));
+	if (ret || event != TEST_MGMT_EVENT || iface) {
+		TC_PRINT("\tWait returned %d, event 0x%08X\n", ret, event);
+		return TC_FAIL;
+	}
+
+	ret = net_mgmt_event_wait(TEST_MGMT_EVENT, NULL, NULL, K_MSEC(10));
+	if (ret != -EAGAIN) {
+		TC_PRINT("\tWait without an event returned %d\n", ret);
+		return TC_FAIL;
+	}
+
+	return TC_PASS;
+}
+
 static bool _iface_ip6_add(void)
 {
 	if (net_if_ipv6_addr_add(net_if_get_default(),
@@ -259,6 +368,14 @@ void main(void)
 		goto end;
 	}
 
+	if (test_event_queues() != TC_PASS) {
+		goto end;
+	}
+
+	if (test_event_wait() != TC_PASS) {
+		goto end;
+	}
+
 	if (test_core_event(NET_EVENT_IPV6_ADDR_ADD,
 			    _iface_ip6_add) != TC_PASS) {
 		goto end;
@@ -1171,6 +1171,198 @@ static int test_nbuf_read_write_insert(void)
 	return 0;
 }
 
+static int ext_released;
+
+static void ext_release(const uint8_t *data, void *user_data)
+{
+	if (data == (const uint8_t *)sample_data &&
+	    user_data == &ext_released) {
+		ext_released++;
+	}
+}
+
+static int test_nbuf_ext_data(void)
+{
+	int len = strlen(sample_data);
+	uint8_t read_data[10];
+	struct net_buf *buf;
+	struct net_buf *frag;
+	uint16_t pos;
+
+	ext_released = 0;
+
+	buf = net_nbuf_get_reserve_tx(0);
+	net_nbuf_set_ll_reserve(buf, LL_RESERVE);
+
+	if (!net_nbuf_append(buf, 10, (uint8_t *)test_rw_short)) {
+		printk("Append before external data failed\n");
+		return -EINVAL;
+	}
+
+	if (!net_nbuf_append_ext(buf, len, (const uint8_t *)sample_data,
+				 ext_release, &ext_released)) {
+		printk("Append external data failed\n");
+		return -EINVAL;
+	}
+
+	frag = net_buf_frag_last(buf);
+	if (!net_nbuf_is_ext(frag) || frag->data != (uint8_t *)sample_data ||
+	    frag->len != len) {
+		printk("External data fragment is not correct\n");
+		return -EINVAL;
+	}
+
+	if (net_buf_headroom(frag) || net_buf_tailroom(frag)) {
+		printk("External data should have no headroom or tailroom\n");
+		return -EINVAL;
+	}
+
+	/* Data appended after external data goes to a new fragment */
+	if (!net_nbuf_append(buf, 10, (uint8_t *)test_rw_short + 10)) {
+		printk("Append after external data failed\n");
+		return -EINVAL;
+	}
+
+	if (net_buf_frag_last(buf) == frag ||
+	    net_buf_frags_len(buf->frags) != len + 20) {
+		printk("Append after external data is not correct\n");
+		return -EINVAL;
+	}
+
+	/* The external data is not moved when compacting */
+	net_nbuf_compact(buf->frags);
+
+	if (buf->frags->frags != frag || frag->len != len) {
+		printk("Compact moved external data\n");
+		return -EINVAL;
+	}
+
+	if (!net_nbuf_read(buf->frags, 5, &pos, 10, read_data) ||
+	    memcmp(read_data, test_rw_short + 5, 5) ||
+	    memcmp(read_data + 5, sample_data, 5)) {
+		printk("Read over external data failed\n");
+		return -EINVAL;
+	}
+
+	if (net_nbuf_write(buf, frag, 2, &pos, 2, (uint8_t *)"xx")) {
+		printk("Write into external data should fail\n");
+		return -EINVAL;
+	}
+
+	if (ext_released) {
+		printk("External data released too early\n");
+		return -EINVAL;
+	}
+
+	net_nbuf_unref(buf);
+
+	if (ext_released != 1) {
+		printk("External data not released\n");
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int test_nbuf_cursor(void)
+{
+	struct net_nbuf_cursor cursor;
+	uint8_t data[sizeof(example_data)];
+	struct net_buf *buf;
+	uint32_t v32;
+	uint16_t v16;
+	uint8_t v8;
+	int i;
+
+	buf = net_nbuf_get_reserve_tx(0);
+	net_nbuf_set_ll_reserve(buf, LL_RESERVE);
+
+	/* Write enough so that the values are split between fragments */
+	net_nbuf_cursor_init(&cursor, buf, NULL, 0);
+
+	for (i = 0; i < 50; i++) {
+		if (!net_nbuf_cursor_write_u8(&cursor, i) ||
+		    !net_nbuf_cursor_write_be16(&cursor, 0x0100 + i) ||
+		    !net_nbuf_cursor_write_be32(&cursor, 0x01020300 + i)) {
+			printk("Cursor write %d failed\n", i);
+			return -EINVAL;
+		}
+	}
+
+	if (!net_nbuf_cursor_write(&cursor, sizeof(example_data),
+				   (uint8_t *)example_data)) {
+		printk("Cursor write data failed\n");
+		return -EINVAL;
+	}
+
+	if (net_buf_frags_len(buf->frags) != 50 * 7 + sizeof(example_data)) {
+		printk("Wrong length %zu after cursor write\n",
+		       net_buf_frags_len(buf->frags));
+		return -EINVAL;
+	}
+
+	net_nbuf_cursor_init(&cursor, NULL, buf->frags, 0);
+
+	for (i = 0; i < 50; i++) {
+		if (!net_nbuf_cursor_read_u8(&cursor, &v8) || v8 != i ||
+		    !net_nbuf_cursor_read_be16(&cursor, &v16) ||
+		    v16 != 0x0100 + i ||
+		    !net_nbuf_cursor_read_be32(&cursor, &v32) ||
+		    v32 != 0x01020300 + i) {
+			printk("Cursor read %d failed\n", i);
+			return -EINVAL;
+		}
+	}
+
+	if (!net_nbuf_cursor_read(&cursor, sizeof(data), data) ||
+	    memcmp(data, example_data, sizeof(data))) {
+		printk("Cursor read data failed\n");
+		return -EINVAL;
+	}
+
+	if (!net_nbuf_cursor_is_end(&cursor)) {
+		printk("Cursor not at the end\n");
+		return -EINVAL;
+	}
+
+	if (net_nbuf_cursor_read_u8(&cursor, &v8) || !cursor.error) {
+		printk("Cursor read past the end\n");
+		return -EINVAL;
+	}
+
+	/* An offset in a later fragment, the result must match the old
+	 * read function.
+	 */
+	net_nbuf_cursor_init(&cursor, NULL, buf->frags, 7 * 20 + 3);
+
+	if (!net_nbuf_cursor_read_be32(&cursor, &v32) ||
+	    v32 != 0x01020300 + 20) {
+		printk("Cursor read from offset failed\n");
+		return -EINVAL;
+	}
+
+	if (!net_nbuf_read_be32(buf->frags, 7 * 20 + 3, &v16, &v32) &&
+	    v16 == 0xffff) {
+		printk("Read from offset failed\n");
+		return -EINVAL;
+	}
+
+	if (v32 != 0x01020300 + 20) {
+		printk("Read and cursor read differ\n");
+		return -EINVAL;
+	}
+
+	if (!net_nbuf_cursor_skip(&cursor, 7 * 28) ||
+	    !net_nbuf_cursor_read_u8(&cursor, &v8) || v8 != 49) {
+		printk("Cursor skip failed\n");
+		return -EINVAL;
+	}
+
+	net_nbuf_unref(buf);
+
+	return 0;
+}
+
 
 void main(void)
 {
@@ -1198,6 +1390,14 @@ void main(void)
 		goto fail;
 	}
 
+	if (test_nbuf_ext_data() < 0) {
+		goto fail;
+	}
+
+	if (test_nbuf_cursor() < 0) {
+		goto fail;
+	}
+
 	printk("nbuf tests passed\n");
 
 	TC_END_REPORT(TC_PASS);
@@ -0,0 +1,226 @@
+/* main.c - Application main entry point */
+
+/*
+ * Copyright (c) 2016 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Measures how long it takes to parse a 1280 byte packet that is held in
+ * 64 byte fragments field by field, when the fields are read by offset
+ * from the start of the packet, by passing the fragment and position
+ * from one read to the next, and by using a cursor.
+ */
+
+#include <zephyr.h>
+#include <sections.h>
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <sys_clock.h>
+#include <misc/printk.h>
+#include <net/buf.h>
+#include <net/nbuf.h>
+
+#include <tc_util.h>
+
+#define PKT_LEN 1280
+#define ROUNDS 20
+
+/* Each field is a byte, a 16 bit value and a 32 bit value */
+#define FIELD_LEN 7
+#define FIELD_COUNT (PKT_LEN / FIELD_LEN)
+
+static struct net_buf *buf;
+static uint32_t expected_sum;
+
+static bool test_init(void)
+{
+	struct net_nbuf_cursor cursor;
+	struct net_buf *frag;
+	int i;
+
+	buf = net_nbuf_get_reserve_rx(0);
+	if (!buf) {
+		TC_ERROR("Out of RX buffers\n");
+		return false;
+	}
+
+	net_nbuf_set_ll_reserve(buf, 0);
+
+	net_nbuf_cursor_init(&cursor, buf, NULL, 0);
+
+	for (i = 0; i < FIELD_COUNT; i++) {
+		if (!net_nbuf_cursor_write_u8(&cursor, i) ||
+		    !net_nbuf_cursor_write_be16(&cursor, i << 4) ||
+		    !net_nbuf_cursor_write_be32(&cursor, i << 16)) {
+			TC_ERROR("Cannot create the packet\n");
+			return false;
+		}
+
+		expected_sum += (uint8_t)i + (uint16_t)(i << 4) + (i << 16);
+	}
+
+	/* Pad to the full length */
+	for (i = FIELD_COUNT * FIELD_LEN; i < PKT_LEN; i++) {
+		net_nbuf_cursor_write_u8(&cursor, 0);
+	}
+
+	for (frag = buf->frags, i = 0; frag; frag = frag->frags) {
+		i++;
+	}
+
+	TC_PRINT("Packet of %zu bytes in %d fragments\n",
+		 net_buf_frags_len(buf->frags), i);
+
+	return true;
+}
+
+static uint32_t parse_by_offset(void)
+{
+	uint32_t sum = 0;
+	uint16_t pos;
+	int i;
+
+	for (i = 0; i < FIELD_COUNT; i++) {
+		uint16_t offset = i * FIELD_LEN;
+		uint32_t v32;
+		uint16_t v16;
+		uint8_t v8;
+
+		net_nbuf_read_u8(buf->frags, offset, &pos, &v8);
+		net_nbuf_read_be16(buf->frags, offset + 1, &pos, &v16);
+		net_nbuf_read_be32(buf->frags, offset + 3, &pos, &v32);
+
+		sum += v8 + v16 + v32;
+	}
+
+	return sum;
+}
+
+static uint32_t parse_by_frag(void)
+{
+	struct net_buf *frag = buf->frags;
+	uint32_t sum = 0;
+	uint16_t pos = 0;
+	int i;
+
+	for (i = 0; i < FIELD_COUNT; i++) {
+		uint32_t v32;
+		uint16_t v16;
+		uint8_t v8;
+
+		frag = net_nbuf_read_u8(frag, pos, &pos, &v8);
+		frag = net_nbuf_read_be16(frag, pos, &pos, &v16);
+		frag = net_nbuf_read_be32(frag, pos, &pos, &v32);
+
+		sum += v8 + v16 + v32;
+	}
+
+	return sum;
+}
+
+static uint32_t parse_by_cursor(void)
+{
+	struct net_nbuf_cursor cursor;
+	uint32_t sum = 0;
+	int i;
+
+	net_nbuf_cursor_init(&cursor, NULL, buf->frags, 0);
+
+	for (i = 0; i < FIELD_COUNT; i++) {
+		uint32_t v32;
+		uint16_t v16;
+		uint8_t v8;
+
+		net_nbuf_cursor_read_u8(&cursor, &v8);
+		net_nbuf_cursor_read_be16(&cursor, &v16);
+		net_nbuf_cursor_read_be32(&cursor, &v32);
+
+		sum += v8 + v16 + v32;
+	}
+
+	return sum;
+}
+
+static bool run_parser(const char *name, uint32_t (*parse)(void))
+{
+	uint32_t cycles, start;
+	uint32_t sum = 0;
+	int i;
+
+	start = k_cycle_get_32();
+
+	for (i = 0; i < ROUNDS; i++) {
+		sum = parse();
+	}
+
+	cycles = k_cycle_get_32() - start;
+
+	if (sum != expected_sum) {
+		TC_ERROR("%s: wrong result 0x%x, expected 0x%x\n",
+			 name, sum, expected_sum);
+		return false;
+	}
+
+	TC_PRINT("%-10s %u cycles per packet (%u us)\n", name,
+		 cycles / ROUNDS,
+		 (uint32_t)((uint64_t)cycles * USEC_PER_SEC / ROUNDS /
+			    sys_clock_hw_cycles_per_sec));
+
+	return true;
+}
+
+static bool test_parse_by_offset(void)
+{
+	return run_parser("offset", parse_by_offset);
+}
+
+static bool test_parse_by_frag(void)
+{
+	return run_parser("fragment", parse_by_frag);
+}
+
+static bool test_parse_by_cursor(void)
+{
+	return run_parser("cursor", parse_by_cursor);
+}
+
+static const struct {
+	const char *name;
+	bool (*func)(void);
+} tests[] = {
+	{ "test init", test_init },
+	{ "parse by offset", test_parse_by_offset },
+	{ "parse by fragment and position", test_parse_by_frag },
+	{ "parse by cursor", test_parse_by_cursor },
+};
+
+void main(void)
+{
+	int count, pass;
+
+	for (count = 0, pass = 0; count < ARRAY_SIZE(tests); count++) {
+		TC_START(tests[count].name);
+		if (!tests[count].func()) {
+			TC_END(FAIL, "failed\n");
+		} else {
+			TC_END(PASS, "passed\n");
+			pass++;
+		}
+	}
+
+	TC_END_REPORT(((pass != ARRAY_SIZE(tests)) ? TC_FAIL : TC_PASS));
+}
@@ -0,0 +1,497 @@
+/* main.c - Application main entry point */
+
+/*
+ * Copyright (c) 2016 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <zephyr.h>
+#include <sections.h>
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <device.h>
+#include <init.h>
+#include <misc/printk.h>
+#include <net/buf.h>
+#include <net/net_core.h>
+#include <net/nbuf.h>
+#include <net/net_ip.h>
+#include <net/net_context.h>
+#include <net/net_mgmt.h>
+#include <net/ethernet.h>
+
+#include <tc_util.h>
+#include <irq_offload.h>
+
+#include "net_private.h"
+
+#define EVENT_TIMEOUT 100
+
+/* Each test packet takes one RX and one data buffer */
+#define PKT_BUFS 2
+
+static struct net_if *iface;
+static struct net_context *ctx;
+
+static struct net_mgmt_event_callback event_cb;
+static struct k_sem event_lock;
+static uint32_t last_event;
+static struct net_if *last_iface;
+
+struct net_nbuf_quota_context {
+	uint8_t mac_addr[sizeof(struct net_eth_addr)];
+};
+
+static int net_nbuf_quota_dev_init(struct device *dev)
+{
+	return 0;
+}
+
+static void net_nbuf_quota_iface_init(struct net_if *iface)
+{
+	struct net_nbuf_quota_context *context =
+		net_if_get_device(iface)->driver_data;
+
+	/* 10-00-00-00-00 to 10-00-00-00-FF Documentation RFC7042 */
+	context->mac_addr[0] = 0x10;
+	context->mac_addr[5] = sys_rand32_get();
+
+	net_if_set_link_addr(iface, context->mac_addr, 6);
+}
+
+static int tester_send(struct net_if *iface, struct net_buf *buf)
+{
+	net_nbuf_unref(buf);
+
+	return 0;
+}
+
+static struct net_nbuf_quota_context net_nbuf_quota_data;
+
+static struct net_if_api net_nbuf_quota_if_api = {
+	.init = net_nbuf_quota_iface_init,
+	.send = tester_send,
+};
+
+#define _ETH_L2_LAYER DUMMY_L2
+#define _ETH_L2_CTX_TYPE NET_L2_GET_CTX_TYPE(DUMMY_L2)
+
+NET_DEVICE_INIT(net_nbuf_quota_test, "net_nbuf_quota_test",
+		net_nbuf_quota_dev_init, &net_nbuf_quota_data, NULL,
+		CONFIG_KERNEL_INIT_PRIORITY_DEFAULT,
+		&net_nbuf_quota_if_api, _ETH_L2_LAYER, _ETH_L2_CTX_TYPE, 127);
+
+static void event_handler(struct net_mgmt_event_callback *cb,
+			  uint32_t mgmt_event, struct net_if *iface)
+{
+	last_event = mgmt_event;
+	last_iface = iface;
+
+	k_sem_give(&event_lock);
+}
+
+static bool wait_event(uint32_t event, struct net_if *event_iface)
+{
+	if (k_sem_take(&event_lock, EVENT_TIMEOUT)) {
+		TC_ERROR("Event 0x%08x not received\n", event);
+		return false;
+	}
+
+	if (last_event != event || last_iface != event_iface) {
+		TC_ERROR("Got event 0x%08x iface %p, expected 0x%08x "
+			 "iface %p\n", last_event, last_iface, event,
+			 event_iface);
+		return false;
+	}
+
+	return true;
+}
+
+static int get_free_data(void)
+{
+	int tx, rx, data;
+
+	net_nbuf_get_info(NULL, NULL, NULL, &tx, &rx, &data);
+
+	return data;
+}
+
+static struct net_buf *create_pkt(void)
+{
+	struct net_buf *buf, *frag;
+
+	buf = net_nbuf_get_reserve_rx(0);
+	if (!buf) {
+		return NULL;
+	}
+
+	frag = net_nbuf_get_reserve_data(0);
+	if (!frag) {
+		net_nbuf_unref(buf);
+		return NULL;
+	}
+
+	net_buf_frag_add(buf, frag);
+	net_buf_add_u8(frag, 0x60);
+
+	return buf;
+}
+
+static bool test_init(void)
+{
+	int ret;
+
+	iface = net_if_get_default();
+
+	k_sem_init(&event_lock, 0, UINT_MAX);
+
+	net_mgmt_init_event_callback(&event_cb, event_handler,
+				     NET_EVENT_NBUF_QUOTA |
+				     NET_EVENT_NBUF_RESERVE |
+				     NET_EVENT_NBUF_EMPTY);
+	net_mgmt_add_event_callback(&event_cb);
+
+	ret = net_context_get(AF_INET6, SOCK_DGRAM, IPPROTO_UDP, &ctx);
+	if (ret) {
+		TC_ERROR("Cannot get context (%d)\n", ret);
+		return false;
+	}
+
+	net_context_set_iface(ctx, iface);
+
+	if (iface->nbuf_quota.limit != CONFIG_NET_NBUF_IFACE_QUOTA ||
+	    ctx->nbuf_quota.limit != CONFIG_NET_NBUF_CONTEXT_QUOTA) {
+		TC_ERROR("Quota limits not set\n");
+		return false;
+	}
+
+	return true;
+}
+
+static bool test_iface_quota(void)
+{
+	struct net_buf *bufs[4];
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(bufs); i++) {
+		bufs[i] = create_pkt();
+		if (!bufs[i]) {
+			TC_ERROR("Out of buffers at packet %d\n", i);
+			return false;
+		}
+	}
+
+	for (i = 0; i < CONFIG_NET_NBUF_IFACE_QUOTA / PKT_BUFS; i++) {
+		if (!net_nbuf_charge_iface(bufs[i], iface)) {
+			TC_ERROR("Cannot charge packet %d\n", i);
+			return false;
+		}
+	}
+
+	if (net_nbuf_charge_iface(bufs[i], iface)) {
+		TC_ERROR("Packet %d charged over the quota\n", i);
+		return false;
+	}
+
+	if (!wait_event(NET_EVENT_NBUF_QUOTA, iface)) {
+		return false;
+	}
+
+	/* Only one event until the quota has recovered */
+	if (net_nbuf_charge_iface(bufs[i], iface) ||
+	    !k_sem_take(&event_lock, EVENT_TIMEOUT)) {
+		TC_ERROR("Quota event sent twice\n");
+		return false;
+	}
+
+	/* Releasing a packet makes space for the next one */
+	net_nbuf_unref(bufs[0]);
+
+	if (!net_nbuf_charge_iface(bufs[i], iface)) {
+		TC_ERROR("Cannot charge packet %d after release\n", i);
+		return false;
+	}
+
+	if (iface->nbuf_quota.used != CONFIG_NET_NBUF_IFACE_QUOTA) {
+		TC_ERROR("Interface holds %u buffers, expected %u\n",
+			 iface->nbuf_quota.used, CONFIG_NET_NBUF_IFACE_QUOTA);
+		return false;
+	}
+
+	/* A driver gets the packet back when the quota is full */
+	bufs[0] = create_pkt();
+	if (!bufs[0]) {
+		TC_ERROR("Out of buffers\n");
+		return false;
+	}
+
+	if (net_recv_data(iface, bufs[0]) != -ENOBUFS) {
+		TC_ERROR("Packet received over the quota\n");
+		return false;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(bufs); i++) {
+		net_nbuf_unref(bufs[i]);
+	}
+
+	if (iface->nbuf_quota.used || iface->nbuf_quota.exceeded) {
+		TC_ERROR("Interface still holds %u buffers\n",
+			 iface->nbuf_quota.used);
+		return false;
+	}
+
+	return true;
+}
+
+static bool test_context_quota(void)
+{
+	struct net_buf *bufs[3];
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(bufs); i++) {
+		bufs[i] = create_pkt();
+		if (!bufs[i] || !net_nbuf_charge_iface(bufs[i], iface)) {
+			TC_ERROR("Cannot create packet %d\n", i);
+			return false;
+		}
+	}
+
+	/* Passing a packet to the context moves it from the interface */
+	if (!net_nbuf_charge_context(bufs[0], ctx) ||
+	    ctx->nbuf_quota.used != PKT_BUFS ||
+	    iface->nbuf_quota.used != 2 * PKT_BUFS) {
+		TC_ERROR("Packet not moved to the context\n");
+		return false;
+	}
+
+	/* Charging again does not change anything */
+	if (!net_nbuf_charge_context(bufs[0], ctx) ||
+	    ctx->nbuf_quota.used != PKT_BUFS) {
+		TC_ERROR("Packet charged twice\n");
+		return false;
+	}
+
+	if (!net_nbuf_charge_context(bufs[1], ctx)) {
+		TC_ERROR("Cannot charge packet 1\n");
+		return false;
+	}
+
+	if (net_nbuf_charge_context(bufs[2], ctx)) {
+		TC_ERROR("Packet 2 charged over the quota\n");
+		return false;
+	}
+
+	if (!wait_event(NET_EVENT_NBUF_QUOTA, iface)) {
+		return false;
+	}
+
+	/* The dropped packet still belongs to the interface */
+	if (iface->nbuf_quota.used != PKT_BUFS) {
+		TC_ERROR("Dropped packet lost its owner\n");
+		return false;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(bufs); i++) {
+		net_nbuf_unref(bufs[i]);
+	}
+
+	if (ctx->nbuf_quota.used || iface->nbuf_quota.used) {
+		TC_ERROR("Buffers still charged, context %u iface %u\n",
+			 ctx->nbuf_quota.used, iface->nbuf_quota.used);
+		return false;
+	}
+
+	return true;
+}
+
+/* Drivers like SLIP charge the interface from their ISR */
+static struct net_buf *isr_bufs[4];
+static int isr_charged;
+
+static void isr_charge(void *arg)
+{
+	int i;
+
+	ARG_UNUSED(arg);
+
+	for (i = 0; i < ARRAY_SIZE(isr_bufs); i++) {
+		if (net_nbuf_charge_iface(isr_bufs[i], iface)) {
+			isr_charged++;
+		}
+	}
+
+	/* The release path is taken from the ISR as well */
+	net_nbuf_unref(isr_bufs[0]);
+	isr_bufs[0] = NULL;
+}
+
+static bool test_isr_quota(void)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(isr_bufs); i++) {
+		isr_bufs[i] = create_pkt();
+		if (!isr_bufs[i]) {
+			TC_ERROR("Out of buffers at packet %d\n", i);
+			return false;
+		}
+	}
+
+	isr_charged = 0;
+	irq_offload(isr_charge, NULL);
+
+	if (isr_charged != CONFIG_NET_NBUF_IFACE_QUOTA / PKT_BUFS) {
+		TC_ERROR("%d packets charged from ISR, expected %d\n",
+			 isr_charged, CONFIG_NET_NBUF_IFACE_QUOTA / PKT_BUFS);
+		return false;
+	}
+
+	if (!wait_event(NET_EVENT_NBUF_QUOTA, iface)) {
+		return false;
+	}
+
+	if (iface->nbuf_quota.used !=
+	    CONFIG_NET_NBUF_IFACE_QUOTA - PKT_BUFS) {
+		TC_ERROR("Interface holds %u buffers, expected %u\n",
+			 iface->nbuf_quota.used,
+			 CONFIG_NET_NBUF_IFACE_QUOTA - PKT_BUFS);
+		return false;
+	}
+
+	for (i = 1; i < ARRAY_SIZE(isr_bufs); i++) {
+		net_nbuf_unref(isr_bufs[i]);
+	}
+
+	if (iface->nbuf_quota.used || iface->nbuf_quota.exceeded) {
+		TC_ERROR("Interface still holds %u buffers\n",
+			 iface->nbuf_quota.used);
+		return false;
+	}
+
+	return true;
+}
+
+static bool test_reserve(void)
+{
+	struct net_buf *frags = NULL, *frag, *buf;
+	bool ret = false;
+
+	/* Leave only the reserved data buffers */
+	while (get_free_data() > CONFIG_NET_NBUF_DATA_RESERVED) {
+		frag = net_nbuf_get_reserve_data(0);
+		if (!frag) {
+			TC_ERROR("Out of data buffers\n");
+			goto out;
+		}
+
+		frag->frags = frags;
+		frags = frag;
+	}
+
+	buf = create_pkt();
+	if (!buf) {
+		TC_ERROR("Cannot use the reserved buffers\n");
+		goto out;
+	}
+
+	/* The stack can still receive packets... */
+	if (!net_nbuf_charge_iface(buf, iface)) {
+		TC_ERROR("Reserved buffers not given to the interface\n");
+		goto unref;
+	}
+
+	/* ...but they cannot be passed to applications */
+	if (net_nbuf_charge_context(buf, ctx)) {
+		TC_ERROR("Reserved buffers given to the context\n");
+		goto unref;
+	}
+
+	if (!wait_event(NET_EVENT_NBUF_RESERVE, iface)) {
+		goto unref;
+	}
+
+	ret = true;
+
+unref:
+	net_nbuf_unref(buf);
+out:
+	while (frags) {
+		frag = frags;
+		frags = frag->frags;
+		frag->frags = NULL;
+		net_nbuf_unref(frag);
+	}
+
+	return ret;
+}
+
+static bool test_pool_empty(void)
+{
+	struct net_buf *bufs[CONFIG_NET_NBUF_TX_COUNT + 1];
+	bool ret = false;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(bufs); i++) {
+		bufs[i] = net_nbuf_get_reserve_tx(0);
+		if (!bufs[i]) {
+			break;
+		}
+	}
+
+	if (i == ARRAY_SIZE(bufs)) {
+		TC_ERROR("TX pool has too many buffers\n");
+		goto out;
+	}
+
+	ret = wait_event(NET_EVENT_NBUF_EMPTY, NULL);
+
+out:
+	while (i--) {
+		net_nbuf_unref(bufs[i]);
+	}
+
+	return ret;
+}
+
+static const struct {
+	const char *name;
+	bool (*func)(void);
+} tests[] = {
+	{ "test init", test_init },
+	{ "interface quota", test_iface_quota },
+	{ "context quota", test_context_quota },
+	{ "quota charged from ISR", test_isr_quota },
+	{ "reserved buffers", test_reserve },
+	{ "pool empty event", test_pool_empty },
+};
+
+void main(void)
+{
+	int count, pass;
+
+	for (count = 0, pass = 0; count < ARRAY_SIZE(tests); count++) {
+		TC_START(tests[count].name);
+		if (!tests[count].func()) {
+			TC_END(FAIL, "failed\n");
+		} else {
+			TC_END(PASS, "passed\n");
+			pass++;
+		}
+	}
+
+	TC_END_REPORT(((pass != ARRAY_SIZE(tests)) ? TC_FAIL : TC_PASS));
+}
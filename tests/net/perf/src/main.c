@@ -0,0 +1,570 @@
+/* main.c - Network stack performance measurement */
+
+/*
+ * Copyright (c) 2016 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <zephyr.h>
+#include <sections.h>
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <atomic.h>
+#include <device.h>
+#include <init.h>
+#include <sys_clock.h>
+#include <misc/printk.h>
+#include <net/buf.h>
+#include <net/net_core.h>
+#include <net/nbuf.h>
+#include <net/net_ip.h>
+#include <net/net_context.h>
+#include <net/ethernet.h>
+
+#include <tc_util.h>
+
+#include "net_private.h"
+#include "net_profile.h"
+
+#define TIMEOUT 1000
+
+#define UDP_PORT 4242
+#define TCP_PORT 4243
+
+#define UDP_PACKETS 2000
+#define UDP_SIZE 512
+
+#define PPS_PACKETS 4000
+#define PPS_SIZE 16
+
+#define TCP_BYTES (256 * 1024)
+#define TCP_SIZE 512
+
+/* Unacknowledged data the TCP sender keeps in flight. The stack has no
+ * send window of its own, so without this the retransmission queue
+ * would take all the data buffers.
+ */
+#define TCP_WINDOW (4 * TCP_SIZE)
+
+static struct in6_addr addr_a = { { { 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0,
+				      0, 0, 0, 0, 0, 0, 0, 0x1 } } };
+static struct in6_addr addr_b = { { { 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0,
+				      0, 0, 0, 0, 0, 0, 0, 0x2 } } };
+
+static uint8_t payload[UDP_SIZE > TCP_SIZE ? UDP_SIZE : TCP_SIZE];
+
+/* Two dummy interfaces joined by a wire. Whatever one of them sends
+ * is copied into RX buffers and received by the other one, like a
+ * driver that copies from its DMA ring would do.
+ */
+struct net_perf_wire {
+	uint8_t mac_addr[sizeof(struct net_eth_addr)];
+	struct net_if *iface;
+	struct net_perf_wire *peer;
+};
+
+static struct net_perf_wire wire_a;
+static struct net_perf_wire wire_b = {
+	.peer = &wire_a,
+};
+static struct net_perf_wire wire_a = {
+	.peer = &wire_b,
+};
+
+static struct net_context *udp_client, *udp_server;
+static struct net_context *tcp_client, *tcp_listen, *tcp_server;
+
+static atomic_t rx_packets;
+static atomic_t rx_bytes;
+static uint32_t rx_last;
+static struct k_sem rx_progress;
+
+static int net_perf_dev_init(struct device *dev)
+{
+	return 0;
+}
+
+static void net_perf_iface_init(struct net_if *iface)
+{
+	struct net_perf_wire *wire = net_if_get_device(iface)->driver_data;
+
+	/* 10-00-00-00-00 to 10-00-00-00-FF Documentation RFC7042 */
+	wire->mac_addr[0] = 0x10;
+	wire->mac_addr[5] = wire == &wire_a ? 0x01 : 0x02;
+	wire->iface = iface;
+
+	net_if_set_link_addr(iface, wire->mac_addr, 6);
+}
+
+/* On error the TX thread releases the buffer */
+static int wire_send(struct net_if *iface, struct net_buf *buf)
+{
+	struct net_perf_wire *wire = net_if_get_device(iface)->driver_data;
+	struct net_buf *rx, *frag, *copy;
+
+	rx = net_nbuf_get_reserve_rx(0);
+	if (!rx) {
+		return -ENOMEM;
+	}
+
+	for (frag = buf->frags; frag; frag = frag->frags) {
+		copy = net_nbuf_get_reserve_data(0);
+		if (!copy) {
+			net_nbuf_unref(rx);
+			return -ENOMEM;
+		}
+
+		memcpy(net_buf_add(copy, frag->len), frag->data, frag->len);
+		net_buf_frag_add(rx, copy);
+	}
+
+	if (net_recv_data(wire->peer->iface, rx) < 0) {
+		net_nbuf_unref(rx);
+		return -EIO;
+	}
+
+	net_nbuf_unref(buf);
+
+	return 0;
+}
+
+static struct net_if_api net_perf_if_api = {
+	.init = net_perf_iface_init,
+	.send = wire_send,
+};
+
+#define _ETH_L2_LAYER DUMMY_L2
+#define _ETH_L2_CTX_TYPE NET_L2_GET_CTX_TYPE(DUMMY_L2)
+
+NET_DEVICE_INIT_INSTANCE(net_perf_a, "net_perf_a", a,
+		net_perf_dev_init, &wire_a, NULL,
+		CONFIG_KERNEL_INIT_PRIORITY_DEFAULT,
+		&net_perf_if_api, _ETH_L2_LAYER, _ETH_L2_CTX_TYPE, 127);
+
+NET_DEVICE_INIT_INSTANCE(net_perf_b, "net_perf_b", b,
+		net_perf_dev_init, &wire_b, NULL,
+		CONFIG_KERNEL_INIT_PRIORITY_DEFAULT,
+		&net_perf_if_api, _ETH_L2_LAYER, _ETH_L2_CTX_TYPE, 127);
+
+/* Every result is printed as one line of JSON after a fixed prefix so
+ * that it can be picked from the console output by a script.
+ */
+#define REPORT(fmt, ...) printk("NET_PERF {" fmt "}\n", __VA_ARGS__)
+
+static void measure_start(void)
+{
+	atomic_clear(&rx_packets);
+	atomic_clear(&rx_bytes);
+	k_sem_reset(&rx_progress);
+
+	net_profile_reset();
+	net_nbuf_reset_watermarks();
+}
+
+static void report_layers(const char *test)
+{
+	struct net_profile prof;
+	int i;
+
+	for (i = 0; i < NET_PROFILE_COUNT; i++) {
+		net_profile_get(i, &prof);
+
+		if (!prof.count) {
+			continue;
+		}
+
+		REPORT("\"test\":\"%s\",\"layer\":\"%s\",\"calls\":%u,"
+		       "\"cycles_avg\":%u,\"cycles_max\":%u", test,
+		       net_profile_name(i), prof.count,
+		       (uint32_t)(prof.cycles / prof.count), prof.max);
+	}
+}
+
+static void report_pools(const char *test)
+{
+	int tx, rx, data;
+
+	net_nbuf_get_watermarks(&tx, &rx, &data);
+
+	REPORT("\"test\":\"%s\",\"pool\":\"tx\",\"max_used\":%d,\"size\":%d",
+	       test, tx, CONFIG_NET_NBUF_TX_COUNT);
+	REPORT("\"test\":\"%s\",\"pool\":\"rx\",\"max_used\":%d,\"size\":%d",
+	       test, rx, CONFIG_NET_NBUF_RX_COUNT);
+	REPORT("\"test\":\"%s\",\"pool\":\"data\",\"max_used\":%d,"
+	       "\"size\":%d", test, data, CONFIG_NET_NBUF_DATA_COUNT);
+}
+
+static void report_result(const char *test, uint32_t sent, uint32_t start)
+{
+	uint32_t packets = atomic_get(&rx_packets);
+	uint32_t bytes = atomic_get(&rx_bytes);
+	uint32_t ms = rx_last - start;
+
+	if (!ms) {
+		ms = 1;
+	}
+
+	REPORT("\"test\":\"%s\",\"sent\":%u,\"received\":%u,\"bytes\":%u,"
+	       "\"ms\":%u,\"kbps\":%u,\"pps\":%u", test, sent, packets,
+	       bytes, ms, (uint32_t)((uint64_t)bytes * 8 / ms),
+	       (uint32_t)((uint64_t)packets * MSEC_PER_SEC / ms));
+
+	report_layers(test);
+	report_pools(test);
+}
+
+static void recv_cb(struct net_context *context, struct net_buf *buf,
+		    int status, void *user_data)
+{
+	if (!buf) {
+		return;
+	}
+
+	atomic_inc(&rx_packets);
+	atomic_add(&rx_bytes, net_nbuf_appdatalen(buf));
+	rx_last = k_uptime_get_32();
+
+	net_nbuf_unref(buf);
+
+	k_sem_give(&rx_progress);
+}
+
+/* Wait until the receiver has got the expected amount or nothing has
+ * arrived for a while.
+ */
+static void wait_received(atomic_t *counter, uint32_t expected)
+{
+	while (atomic_get(counter) < expected) {
+		if (k_sem_take(&rx_progress, TIMEOUT)) {
+			return;
+		}
+	}
+}
+
+static bool test_init(void)
+{
+	struct sockaddr_in6 addr = {
+		.sin6_family = AF_INET6,
+	};
+	int ret;
+
+	k_sem_init(&rx_progress, 0, UINT_MAX);
+
+	memset(payload, 0xaa, sizeof(payload));
+
+	if (!wire_a.iface || !wire_b.iface) {
+		TC_ERROR("Interfaces not initialized\n");
+		return false;
+	}
+
+	if (!net_if_ipv6_addr_add(wire_a.iface, &addr_a, NET_ADDR_MANUAL, 0) ||
+	    !net_if_ipv6_addr_add(wire_b.iface, &addr_b, NET_ADDR_MANUAL, 0)) {
+		TC_ERROR("Cannot add IPv6 addresses\n");
+		return false;
+	}
+
+	ret = net_context_get(AF_INET6, SOCK_DGRAM, IPPROTO_UDP, &udp_client);
+	if (ret) {
+		TC_ERROR("Cannot get UDP client context (%d)\n", ret);
+		return false;
+	}
+
+	net_ipaddr_copy(&addr.sin6_addr, &addr_a);
+
+	ret = net_context_bind(udp_client, (struct sockaddr *)&addr,
+			       sizeof(addr));
+	if (ret) {
+		TC_ERROR("Cannot bind UDP client (%d)\n", ret);
+		return false;
+	}
+
+	ret = net_context_get(AF_INET6, SOCK_DGRAM, IPPROTO_UDP, &udp_server);
+	if (ret) {
+		TC_ERROR("Cannot get UDP server context (%d)\n", ret);
+		return false;
+	}
+
+	net_ipaddr_copy(&addr.sin6_addr, &addr_b);
+	addr.sin6_port = htons(UDP_PORT);
+
+	ret = net_context_bind(udp_server, (struct sockaddr *)&addr,
+			       sizeof(addr));
+	if (ret) {
+		TC_ERROR("Cannot bind UDP server (%d)\n", ret);
+		return false;
+	}
+
+	ret = net_context_recv(udp_server, recv_cb, K_NO_WAIT, NULL);
+	if (ret) {
+		TC_ERROR("Cannot receive in UDP server (%d)\n", ret);
+		return false;
+	}
+
+	REPORT("\"test\":\"info\",\"cycles_per_sec\":%u,"
+	       "\"data_size\":%u", (uint32_t)sys_clock_hw_cycles_per_sec,
+	       CONFIG_NET_NBUF_DATA_SIZE);
+
+	return true;
+}
+
+static bool udp_send(uint16_t len)
+{
+	struct sockaddr_in6 dst = {
+		.sin6_family = AF_INET6,
+		.sin6_port = htons(UDP_PORT),
+	};
+	struct net_buf *buf;
+	int ret;
+
+	net_ipaddr_copy(&dst.sin6_addr, &addr_b);
+
+	buf = net_nbuf_get_tx(udp_client);
+	if (!buf) {
+		return false;
+	}
+
+	if (!net_nbuf_append(buf, len, payload)) {
+		net_nbuf_unref(buf);
+		return false;
+	}
+
+	ret = net_context_sendto(buf, (struct sockaddr *)&dst, sizeof(dst),
+				 NULL, K_NO_WAIT, NULL, NULL);
+	if (ret < 0) {
+		net_nbuf_unref(buf);
+		return false;
+	}
+
+	return true;
+}
+
+static bool run_udp(const char *test, int count, uint16_t len)
+{
+	uint32_t start;
+	int i, sent;
+
+	measure_start();
+
+	start = k_uptime_get_32();
+
+	for (i = 0, sent = 0; i < count; i++) {
+		if (udp_send(len)) {
+			sent++;
+		}
+	}
+
+	wait_received(&rx_packets, sent);
+
+	report_result(test, sent, start);
+
+	/* Losses are part of the result, but nothing at all getting
+	 * through means that the harness itself is broken.
+	 */
+	if (!atomic_get(&rx_packets)) {
+		TC_ERROR("No packets received\n");
+		return false;
+	}
+
+	return true;
+}
+
+static bool test_udp_throughput(void)
+{
+	return run_udp("udp_throughput", UDP_PACKETS, UDP_SIZE);
+}
+
+static bool test_udp_pps(void)
+{
+	return run_udp("udp_pps", PPS_PACKETS, PPS_SIZE);
+}
+
+static void accept_cb(struct net_context *context, struct sockaddr *addr,
+		      socklen_t addrlen, int status, void *user_data)
+{
+	if (status) {
+		return;
+	}
+
+	tcp_server = context;
+
+	net_context_recv(context, recv_cb, K_NO_WAIT, NULL);
+
+	k_sem_give(&rx_progress);
+}
+
+static bool test_tcp_connect(void)
+{
+	struct sockaddr_in6 addr = {
+		.sin6_family = AF_INET6,
+	};
+	int ret, i;
+
+	ret = net_context_get(AF_INET6, SOCK_STREAM, IPPROTO_TCP, &tcp_listen);
+	if (ret) {
+		TC_ERROR("Cannot get TCP server context (%d)\n", ret);
+		return false;
+	}
+
+	net_ipaddr_copy(&addr.sin6_addr, &addr_b);
+	addr.sin6_port = htons(TCP_PORT);
+
+	ret = net_context_bind(tcp_listen, (struct sockaddr *)&addr,
+			       sizeof(addr));
+	if (ret) {
+		TC_ERROR("Cannot bind TCP server (%d)\n", ret);
+		return false;
+	}
+
+	ret = net_context_listen(tcp_listen, 0);
+	if (!ret) {
+		ret = net_context_accept(tcp_listen, accept_cb, K_NO_WAIT,
+					 NULL);
+	}
+
+	if (ret) {
+		TC_ERROR("Cannot accept TCP connections (%d)\n", ret);
+		return false;
+	}
+
+	ret = net_context_get(AF_INET6, SOCK_STREAM, IPPROTO_TCP, &tcp_client);
+	if (ret) {
+		TC_ERROR("Cannot get TCP client context (%d)\n", ret);
+		return false;
+	}
+
+	net_ipaddr_copy(&addr.sin6_addr, &addr_a);
+	addr.sin6_port = 0;
+
+	ret = net_context_bind(tcp_client, (struct sockaddr *)&addr,
+			       sizeof(addr));
+	if (ret) {
+		TC_ERROR("Cannot bind TCP client (%d)\n", ret);
+		return false;
+	}
+
+	k_sem_reset(&rx_progress);
+
+	net_ipaddr_copy(&addr.sin6_addr, &addr_b);
+	addr.sin6_port = htons(TCP_PORT);
+
+	ret = net_context_connect(tcp_client, (struct sockaddr *)&addr,
+				  sizeof(addr), NULL, K_NO_WAIT, NULL);
+	if (ret) {
+		TC_ERROR("Cannot connect (%d)\n", ret);
+		return false;
+	}
+
+	if (k_sem_take(&rx_progress, TIMEOUT)) {
+		TC_ERROR("Connection not accepted\n");
+		return false;
+	}
+
+	for (i = 0; i < TIMEOUT / 10; i++) {
+		if (net_context_get_state(tcp_client) ==
+		    NET_CONTEXT_CONNECTED) {
+			return true;
+		}
+
+		k_sleep(10);
+	}
+
+	TC_ERROR("Connection not established\n");
+
+	return false;
+}
+
+static bool test_tcp_throughput(void)
+{
+	struct net_buf *buf;
+	uint32_t start, sent;
+	int ret;
+
+	measure_start();
+
+	start = k_uptime_get_32();
+
+	for (sent = 0; sent < TCP_BYTES; sent += TCP_SIZE) {
+		while (sent - atomic_get(&rx_bytes) > TCP_WINDOW) {
+			if (k_sem_take(&rx_progress, TIMEOUT)) {
+				TC_ERROR("TCP stalled at %u bytes\n",
+					 (uint32_t)atomic_get(&rx_bytes));
+				return false;
+			}
+		}
+
+		buf = net_nbuf_get_tx(tcp_client);
+		if (!buf) {
+			return false;
+		}
+
+		if (!net_nbuf_append(buf, TCP_SIZE, payload)) {
+			net_nbuf_unref(buf);
+			return false;
+		}
+
+		ret = net_context_send(buf, NULL, K_FOREVER, NULL, NULL);
+		if (ret < 0) {
+			TC_ERROR("Cannot send (%d)\n", ret);
+			net_nbuf_unref(buf);
+			return false;
+		}
+	}
+
+	wait_received(&rx_bytes, TCP_BYTES);
+
+	report_result("tcp_throughput", TCP_BYTES / TCP_SIZE, start);
+
+	if (atomic_get(&rx_bytes) != TCP_BYTES) {
+		TC_ERROR("Received %u bytes, expected %u\n",
+			 (uint32_t)atomic_get(&rx_bytes), TCP_BYTES);
+		return false;
+	}
+
+	net_context_put(tcp_client);
+	net_context_put(tcp_server);
+	net_context_put(tcp_listen);
+
+	return true;
+}
+
+static const struct {
+	const char *name;
+	bool (*func)(void);
+} tests[] = {
+	{ "test init", test_init },
+	{ "UDP throughput", test_udp_throughput },
+	{ "UDP packets per second", test_udp_pps },
+	{ "TCP connect", test_tcp_connect },
+	{ "TCP throughput", test_tcp_throughput },
+};
+
+void main(void)
+{
+	int count, pass;
+
+	for (count = 0, pass = 0; count < ARRAY_SIZE(tests); count++) {
+		TC_START(tests[count].name);
+		if (!tests[count].func()) {
+			TC_END(FAIL, "failed\n");
+		} else {
+			TC_END(PASS, "passed\n");
+			pass++;
+		}
+	}
+
+	TC_END_REPORT(((pass != ARRAY_SIZE(tests)) ? TC_FAIL : TC_PASS));
+}
@@ -297,6 +297,7 @@ static bool test_init(void)
 		memcpy(&dest_addresses[i], &generic_addr,
 		       sizeof(struct in6_addr));
 
+		dest_addresses[i].s6_addr[11] = (i + 1) >> 8;
 		dest_addresses[i].s6_addr[14] = i + 1;
 		dest_addresses[i].s6_addr[15] = sys_rand32_get();
 	}
@@ -663,6 +664,138 @@ static bool route_del_many(void)
 	return true;
 }
 
+static bool route_longest_match(void)
+{
+	struct net_route_entry *host, *prefix, *found;
+	struct in6_addr addr;
+	bool ret = false;
+
+	/* The host route is added first, otherwise net_route_add() would
+	 * find the prefix route for it.
+	 */
+	host = net_route_add(my_iface, &dest_addresses[0], 128, &peer_addr);
+	prefix = net_route_add(my_iface, &generic_addr, 64, &peer_addr);
+	if (!host || !prefix || host == prefix) {
+		TC_ERROR("Route add failed\n");
+		goto out;
+	}
+
+	found = net_route_lookup(my_iface, &dest_addresses[0]);
+	if (found != host) {
+		TC_ERROR("Host route not found (%p)\n", found);
+		goto out;
+	}
+
+	net_ipaddr_copy(&addr, &generic_addr);
+	addr.s6_addr[15] = 0x42;
+
+	found = net_route_lookup(NULL, &addr);
+	if (found != prefix) {
+		TC_ERROR("Prefix route not found (%p)\n", found);
+		goto out;
+	}
+
+	addr.s6_addr[7] = 0x80;
+
+	found = net_route_lookup(my_iface, &addr);
+	if (found) {
+		TC_ERROR("Route found outside of prefix (%p)\n", found);
+		goto out;
+	}
+
+	net_route_del(host);
+	host = NULL;
+
+	found = net_route_lookup(my_iface, &dest_addresses[0]);
+	if (found != prefix) {
+		TC_ERROR("Prefix route not found after del (%p)\n", found);
+		goto out;
+	}
+
+	ret = true;
+
+out:
+	if (host) {
+		net_route_del(host);
+	}
+
+	if (prefix) {
+		net_route_del(prefix);
+	}
+
+	return ret;
+}
+
+#define BENCH_LOOKUPS 4096
+
+static bool route_bench(int count)
+{
+	struct net_route_entry *found;
+	uint32_t start, cycles;
+	int i, ret;
+
+	if (count > max_routes) {
+		TC_PRINT("%d routes: skipped, only %d routes configured\n",
+			 count, max_routes);
+		return true;
+	}
+
+	for (i = 0; i < count; i++) {
+		test_routes[i] = net_route_add(my_iface,
+					       &dest_addresses[i], 128,
+					       &peer_addr);
+		if (!test_routes[i]) {
+			TC_ERROR("[%d] Route add failed\n", i);
+			return false;
+		}
+	}
+
+	start = k_cycle_get_32();
+
+	for (i = 0; i < BENCH_LOOKUPS; i++) {
+		found = net_route_lookup(my_iface,
+					 &dest_addresses[(i * 7) % count]);
+		if (!found) {
+			break;
+		}
+	}
+
+	cycles = k_cycle_get_32() - start;
+
+	if (i < BENCH_LOOKUPS) {
+		TC_ERROR("[%d] Route lookup failed\n", (i * 7) % count);
+		return false;
+	}
+
+	TC_PRINT("%d routes: %u cycles per lookup\n", count,
+		 cycles / BENCH_LOOKUPS);
+
+	for (i = 0; i < count; i++) {
+		ret = net_route_del(test_routes[i]);
+		if (ret) {
+			TC_ERROR("[%d] Route del failed (%d)\n", i, ret);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool route_bench_16(void)
+{
+	return route_bench(16);
+}
+
+static bool route_bench_256(void)
+{
+	return route_bench(256);
+}
+
+static bool route_bench_1024(void)
+{
+	return route_bench(1024);
+}
+
 static const struct {
 	const char *name;
 	bool (*func)(void);
@@ -684,6 +817,10 @@ static const struct {
 	{ "Populate neighbor cache again", populate_nbr_cache },
 	{ "Add many routes", route_add_many },
 	{ "Del many routes", route_del_many },
+	{ "Lookup longest match", route_longest_match },
+	{ "Lookup 16 routes", route_bench_16 },
+	{ "Lookup 256 routes", route_bench_256 },
+	{ "Lookup 1024 routes", route_bench_1024 },
 };
 
 void main(void)
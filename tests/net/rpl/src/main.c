@@ -674,6 +674,173 @@ static bool test_dio_receive_dest(void)
 	return true;
 }
 
+#define DAO_FLOOD_ROUTES CONFIG_NET_RPL_MAX_DOWNWARD_ROUTES
+#define DAO_FLOOD_NEXTHOPS 4
+
+static struct in6_addr dao_nexthop[DAO_FLOOD_NEXTHOPS];
+
+static inline void dao_target(struct in6_addr *target, int i)
+{
+	net_ipv6_addr_create(target, 0x2001, 0x0db8, 0, 0, 0, 0,
+			     (i + 1) >> 16, (i + 1) & 0xffff);
+}
+
+static bool dao_flood(void)
+{
+	struct net_if *iface = net_if_get_default();
+	struct net_rpl_dag *dag = net_rpl_get_any_dag();
+	uint32_t start, add, refresh, lookup, remove;
+	struct in6_addr target, *nexthop;
+	int i, ret;
+
+	for (i = 0; i < DAO_FLOOD_NEXTHOPS; i++) {
+		uint8_t mac[] = { 0x02, 0x00, 0x5e, 0x00, 0x53, 0x10 + i };
+		struct net_linkaddr lladdr = {
+			.addr = mac,
+			.len = sizeof(mac),
+		};
+
+		net_ipv6_addr_create(&dao_nexthop[i], 0xfe80, 0, 0, 0,
+				     0, 0, 0, 0x0100 + i);
+
+		if (!net_ipv6_nbr_add(iface, &dao_nexthop[i], &lladdr,
+				      false, NET_NBR_REACHABLE)) {
+			TC_ERROR("Cannot add next hop %d\n", i);
+			return false;
+		}
+	}
+
+	/* Every target sends its first DAO */
+	start = k_cycle_get_32();
+
+	for (i = 0; i < DAO_FLOOD_ROUTES; i++) {
+		dao_target(&target, i);
+
+		ret = net_rpl_downward_add(dag, iface, &target,
+					   &dao_nexthop[i % DAO_FLOOD_NEXTHOPS],
+					   600);
+		if (ret < 0) {
+			TC_ERROR("Cannot add route %d (%d)\n", i, ret);
+			return false;
+		}
+	}
+
+	add = k_cycle_get_32() - start;
+
+	dao_target(&target, DAO_FLOOD_ROUTES);
+
+	if (net_rpl_downward_add(dag, iface, &target, &dao_nexthop[0],
+				 600) != -ENOMEM) {
+		TC_ERROR("Route added to a full store\n");
+		return false;
+	}
+
+	/* The DAOs are repeated through other next hops */
+	start = k_cycle_get_32();
+
+	for (i = 0; i < DAO_FLOOD_ROUTES; i++) {
+		dao_target(&target, i);
+
+		ret = net_rpl_downward_add(dag, iface, &target,
+				&dao_nexthop[(i + 1) % DAO_FLOOD_NEXTHOPS],
+				600);
+		if (ret < 0) {
+			TC_ERROR("Cannot refresh route %d (%d)\n", i, ret);
+			return false;
+		}
+	}
+
+	refresh = k_cycle_get_32() - start;
+
+	if (net_rpl_downward_count() != DAO_FLOOD_ROUTES) {
+		TC_ERROR("Refresh added routes, %d routes\n",
+			 net_rpl_downward_count());
+		return false;
+	}
+
+	start = k_cycle_get_32();
+
+	for (i = 0; i < DAO_FLOOD_ROUTES; i++) {
+		dao_target(&target, i);
+
+		nexthop = net_rpl_downward_lookup(iface, &target);
+		if (!nexthop ||
+		    !net_ipv6_addr_cmp(nexthop,
+				&dao_nexthop[(i + 1) % DAO_FLOOD_NEXTHOPS])) {
+			TC_ERROR("Wrong next hop for route %d\n", i);
+			return false;
+		}
+	}
+
+	lookup = k_cycle_get_32() - start;
+
+	TC_PRINT("%d routes in %d bytes, %d bytes per route\n",
+		 DAO_FLOOD_ROUTES, (int)net_rpl_downward_size(),
+		 (int)net_rpl_downward_size() / DAO_FLOOD_ROUTES);
+	TC_PRINT("Cycles per DAO: add %u refresh %u lookup %u\n",
+		 add / DAO_FLOOD_ROUTES, refresh / DAO_FLOOD_ROUTES,
+		 lookup / DAO_FLOOD_ROUTES);
+
+	/* Half of the targets go away, their routes expire in a second */
+	for (i = 0; i < DAO_FLOOD_ROUTES; i += 2) {
+		dao_target(&target, i);
+
+		if (!net_rpl_downward_no_path(iface, &target,
+				&dao_nexthop[(i + 1) % DAO_FLOOD_NEXTHOPS],
+				1)) {
+			TC_ERROR("No-Path DAO ignored for route %d\n", i);
+			return false;
+		}
+	}
+
+	k_sleep(3 * MSEC_PER_SEC);
+
+	if (net_rpl_downward_count() != DAO_FLOOD_ROUTES / 2) {
+		TC_ERROR("Routes did not expire, %d routes\n",
+			 net_rpl_downward_count());
+		return false;
+	}
+
+	dao_target(&target, 0);
+
+	if (net_rpl_downward_lookup(iface, &target)) {
+		TC_ERROR("Expired route found\n");
+		return false;
+	}
+
+	start = k_cycle_get_32();
+
+	ret = net_rpl_downward_del_by_dag(dag);
+
+	remove = k_cycle_get_32() - start;
+
+	if (ret != DAO_FLOOD_ROUTES / 2 || net_rpl_downward_count()) {
+		TC_ERROR("Routes of the DAG not removed, %d removed\n", ret);
+		return false;
+	}
+
+	TC_PRINT("Cycles to remove the routes of a DAG: %u\n", remove);
+
+	return true;
+}
+
+static bool test_dao_flood(void)
+{
+	int prio = k_thread_priority_get(k_current_get());
+	bool ret;
+
+	/* The routes are handled by the cooperative threads of the stack,
+	 * so the expiry work must not run in the middle of an update.
+	 */
+	k_thread_priority_set(k_current_get(), K_PRIO_COOP(7));
+
+	ret = dao_flood();
+
+	k_thread_priority_set(k_current_get(), prio);
+
+	return ret;
+}
+
 static const struct {
 	const char *name;
 	bool (*func)(void);
@@ -687,6 +854,7 @@ static const struct {
 	{ "Populate neighbor cache", populate_nbr_cache },
 	{ "Link cb test", test_link_cb },
 	{ "DIO receive dest set", test_dio_receive_dest },
+	{ "DAO flood", test_dao_flood },
 #if 0
 	{ "DAO sending ok", test_dao_sending_ok },
 	{ "DIO receive dest not set", test_dio_receive },
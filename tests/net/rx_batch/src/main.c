@@ -0,0 +1,293 @@
+/* main.c - Application main entry point */
+
+/*
+ * Copyright (c) 2016 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Measures how many packets per second the RX path can handle when the
+ * driver passes the packets to the IP stack one by one or in batches.
+ */
+
+#include <zephyr.h>
+#include <sections.h>
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <device.h>
+#include <init.h>
+#include <sys_clock.h>
+#include <misc/printk.h>
+#include <net/buf.h>
+#include <net/net_core.h>
+#include <net/nbuf.h>
+#include <net/net_ip.h>
+#include <net/ethernet.h>
+
+#include <tc_util.h>
+
+#include "udp.h"
+#include "net_private.h"
+
+#define TEST_PORT 4242
+#define PEER_PORT 5000
+#define PKTS_TOTAL 1024
+#define MAX_BATCH 32
+#define TIMEOUT 200
+
+static struct in6_addr my_addr = { { { 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0,
+				       0, 0, 0, 0, 0, 0, 0, 0x1 } } };
+static struct in6_addr peer_addr = { { { 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0,
+					 0, 0, 0, 0, 0, 0, 0, 0x2 } } };
+
+static struct net_if *iface;
+static struct k_sem recv_lock;
+static uint8_t next_seq;
+static bool fail;
+
+struct net_rx_batch_context {
+	uint8_t mac_addr[sizeof(struct net_eth_addr)];
+};
+
+static int net_rx_batch_dev_init(struct device *dev)
+{
+	return 0;
+}
+
+static void net_rx_batch_iface_init(struct net_if *iface)
+{
+	struct net_rx_batch_context *context =
+		net_if_get_device(iface)->driver_data;
+
+	/* 10-00-00-00-00 to 10-00-00-00-FF Documentation RFC7042 */
+	context->mac_addr[0] = 0x10;
+	context->mac_addr[5] = sys_rand32_get();
+
+	net_if_set_link_addr(iface, context->mac_addr, 6);
+}
+
+static int tester_send(struct net_if *iface, struct net_buf *buf)
+{
+	net_nbuf_unref(buf);
+
+	return 0;
+}
+
+static struct net_rx_batch_context net_rx_batch_data;
+
+static struct net_if_api net_rx_batch_if_api = {
+	.init = net_rx_batch_iface_init,
+	.send = tester_send,
+};
+
+#define _ETH_L2_LAYER DUMMY_L2
+#define _ETH_L2_CTX_TYPE NET_L2_GET_CTX_TYPE(DUMMY_L2)
+
+NET_DEVICE_INIT(net_rx_batch_test, "net_rx_batch_test",
+		net_rx_batch_dev_init, &net_rx_batch_data, NULL,
+		CONFIG_KERNEL_INIT_PRIORITY_DEFAULT,
+		&net_rx_batch_if_api, _ETH_L2_LAYER, _ETH_L2_CTX_TYPE, 127);
+
+static enum net_verdict recv_cb(struct net_conn *conn,
+				struct net_buf *buf,
+				void *user_data)
+{
+	uint8_t seq = *((uint8_t *)NET_UDP_BUF(buf) +
+			sizeof(struct net_udp_hdr));
+
+	/* Batching must not change the order of the packets */
+	if (seq != next_seq) {
+		fail = true;
+	}
+
+	next_seq = seq + 1;
+
+	net_nbuf_unref(buf);
+
+	k_sem_give(&recv_lock);
+
+	return NET_OK;
+}
+
+static struct net_buf *create_pkt(uint8_t seq)
+{
+	struct net_buf *buf, *frag;
+
+	buf = net_nbuf_get_reserve_rx(0);
+	if (!buf) {
+		return NULL;
+	}
+
+	frag = net_nbuf_get_reserve_data(0);
+	if (!frag) {
+		net_nbuf_unref(buf);
+		return NULL;
+	}
+
+	net_buf_frag_add(buf, frag);
+
+	net_nbuf_set_iface(buf, iface);
+	net_nbuf_set_ll_reserve(buf, net_buf_headroom(frag));
+
+	NET_IPV6_BUF(buf)->vtc = 0x60;
+	NET_IPV6_BUF(buf)->tcflow = 0;
+	NET_IPV6_BUF(buf)->flow = 0;
+	NET_IPV6_BUF(buf)->len[0] = 0;
+	NET_IPV6_BUF(buf)->len[1] = NET_UDPH_LEN + sizeof(seq);
+	NET_IPV6_BUF(buf)->nexthdr = IPPROTO_UDP;
+	NET_IPV6_BUF(buf)->hop_limit = 255;
+
+	net_ipaddr_copy(&NET_IPV6_BUF(buf)->src, &peer_addr);
+	net_ipaddr_copy(&NET_IPV6_BUF(buf)->dst, &my_addr);
+
+	net_nbuf_set_ip_hdr_len(buf, sizeof(struct net_ipv6_hdr));
+	net_nbuf_set_ext_len(buf, 0);
+
+	NET_UDP_BUF(buf)->src_port = htons(PEER_PORT);
+	NET_UDP_BUF(buf)->dst_port = htons(TEST_PORT);
+	NET_UDP_BUF(buf)->len = htons(NET_UDPH_LEN + sizeof(seq));
+	NET_UDP_BUF(buf)->chksum = 0;
+
+	net_buf_add(frag, sizeof(struct net_ipv6_hdr) + NET_UDPH_LEN);
+	net_buf_add_u8(frag, seq);
+
+	return buf;
+}
+
+static bool test_init(void)
+{
+	int ret;
+
+	iface = net_if_get_default();
+
+	k_sem_init(&recv_lock, 0, UINT_MAX);
+
+	if (!net_if_ipv6_addr_add(iface, &my_addr, NET_ADDR_MANUAL, 0)) {
+		TC_ERROR("Cannot add IPv6 address\n");
+		return false;
+	}
+
+	ret = net_udp_register(NULL, NULL, 0, TEST_PORT, recv_cb, NULL, NULL);
+	if (ret) {
+		TC_ERROR("UDP register failed (%d)\n", ret);
+		return false;
+	}
+
+	return true;
+}
+
+static bool run_batch(int batch)
+{
+	struct net_buf *bufs[MAX_BATCH];
+	uint32_t cycles = 0;
+	uint32_t start;
+	uint64_t pps;
+	int sent, count, i;
+
+	fail = false;
+
+	for (sent = 0; sent < PKTS_TOTAL; sent += count) {
+		count = min(batch, PKTS_TOTAL - sent);
+
+		/* Packet creation is not part of the measurement */
+		for (i = 0; i < count; i++) {
+			bufs[i] = create_pkt(sent + i);
+			if (!bufs[i]) {
+				TC_ERROR("Out of buffers at packet %d\n",
+					 sent + i);
+				return false;
+			}
+		}
+
+		start = k_cycle_get_32();
+
+		if (batch == 1) {
+			if (net_recv_data(iface, bufs[0]) < 0) {
+				TC_ERROR("Cannot receive packet %d\n", sent);
+				net_nbuf_unref(bufs[0]);
+				return false;
+			}
+		} else if (net_recv_data_list(iface, bufs, count) != count) {
+			TC_ERROR("Cannot receive packets %d-%d\n", sent,
+				 sent + count - 1);
+			return false;
+		}
+
+		for (i = 0; i < count; i++) {
+			if (k_sem_take(&recv_lock, TIMEOUT)) {
+				TC_ERROR("Timeout, packet %d not received\n",
+					 sent + i);
+				return false;
+			}
+		}
+
+		cycles += k_cycle_get_32() - start;
+	}
+
+	if (fail) {
+		TC_ERROR("Packets received out of order\n");
+		return false;
+	}
+
+	pps = (uint64_t)PKTS_TOTAL * sys_clock_hw_cycles_per_sec / cycles;
+
+	TC_PRINT("batch %2d: %d packets in %u cycles, %u packets/sec\n",
+		 batch, PKTS_TOTAL, cycles, (uint32_t)pps);
+
+	return true;
+}
+
+static bool test_batch_1(void)
+{
+	return run_batch(1);
+}
+
+static bool test_batch_8(void)
+{
+	return run_batch(8);
+}
+
+static bool test_batch_32(void)
+{
+	return run_batch(32);
+}
+
+static const struct {
+	const char *name;
+	bool (*func)(void);
+} tests[] = {
+	{ "test init", test_init },
+	{ "RX batch size 1", test_batch_1 },
+	{ "RX batch size 8", test_batch_8 },
+	{ "RX batch size 32", test_batch_32 },
+};
+
+void main(void)
+{
+	int count, pass;
+
+	for (count = 0, pass = 0; count < ARRAY_SIZE(tests); count++) {
+		TC_START(tests[count].name);
+		if (!tests[count].func()) {
+			TC_END(FAIL, "failed\n");
+		} else {
+			TC_END(PASS, "passed\n");
+			pass++;
+		}
+	}
+
+	TC_END_REPORT(((pass != ARRAY_SIZE(tests)) ? TC_FAIL : TC_PASS));
+}
@@ -0,0 +1,398 @@
+/* main.c - Application main entry point */
+
+/*
+ * Copyright (c) 2016 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <zephyr.h>
+#include <sections.h>
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <device.h>
+#include <init.h>
+#include <misc/printk.h>
+#include <net/buf.h>
+#include <net/net_core.h>
+#include <net/nbuf.h>
+#include <net/net_ip.h>
+#include <net/net_stats.h>
+#include <net/ethernet.h>
+
+#include <tc_util.h>
+
+#include "udp.h"
+#include "net_private.h"
+
+#define TEST_PORT 4242
+#define FLOW_PORT 5000
+#define FLOWS 2
+#define PKTS_PER_FLOW 3
+#define TIMEOUT 200
+
+static struct in6_addr my_addr = { { { 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0,
+				       0, 0, 0, 0, 0, 0, 0, 0x1 } } };
+static struct in6_addr peer_addr = { { { 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0,
+					 0, 0, 0, 0, 0, 0, 0, 0x2 } } };
+
+static struct net_if *iface_a;
+static struct net_if *iface_b;
+
+static struct k_sem recv_lock;
+static bool fail;
+static int received;
+static uint8_t next_seq[FLOWS];
+static k_tid_t flow_thread[FLOWS];
+
+struct net_rx_queue_context {
+	uint8_t mac_addr[sizeof(struct net_eth_addr)];
+};
+
+static int net_rx_queue_dev_init(struct device *dev)
+{
+	return 0;
+}
+
+static void net_rx_queue_iface_init(struct net_if *iface)
+{
+	struct net_rx_queue_context *context =
+		net_if_get_device(iface)->driver_data;
+
+	/* 10-00-00-00-00 to 10-00-00-00-FF Documentation RFC7042 */
+	context->mac_addr[0] = 0x10;
+	context->mac_addr[5] = sys_rand32_get();
+
+	net_if_set_link_addr(iface, context->mac_addr, 6);
+}
+
+static int tester_send(struct net_if *iface, struct net_buf *buf)
+{
+	net_nbuf_unref(buf);
+
+	return 0;
+}
+
+static struct net_rx_queue_context net_rx_queue_data_a;
+static struct net_rx_queue_context net_rx_queue_data_b;
+
+static struct net_if_api net_rx_queue_if_api = {
+	.init = net_rx_queue_iface_init,
+	.send = tester_send,
+};
+
+#define _ETH_L2_LAYER DUMMY_L2
+#define _ETH_L2_CTX_TYPE NET_L2_GET_CTX_TYPE(DUMMY_L2)
+
+NET_DEVICE_INIT_INSTANCE(net_rx_queue_test_a, "net_rx_queue_test_a", a,
+			 net_rx_queue_dev_init, &net_rx_queue_data_a, NULL,
+			 CONFIG_KERNEL_INIT_PRIORITY_DEFAULT,
+			 &net_rx_queue_if_api, _ETH_L2_LAYER,
+			 _ETH_L2_CTX_TYPE, 127);
+
+NET_DEVICE_INIT_INSTANCE(net_rx_queue_test_b, "net_rx_queue_test_b", b,
+			 net_rx_queue_dev_init, &net_rx_queue_data_b, NULL,
+			 CONFIG_KERNEL_INIT_PRIORITY_DEFAULT,
+			 &net_rx_queue_if_api, _ETH_L2_LAYER,
+			 _ETH_L2_CTX_TYPE, 127);
+
+static enum net_verdict recv_cb(struct net_conn *conn,
+				struct net_buf *buf,
+				void *user_data)
+{
+	uint8_t *payload = (uint8_t *)NET_UDP_BUF(buf) +
+		sizeof(struct net_udp_hdr);
+	int flow = ntohs(NET_UDP_BUF(buf)->src_port) - FLOW_PORT;
+
+	if (flow < 0 || flow >= FLOWS) {
+		TC_ERROR("Unexpected flow %d\n", flow);
+		fail = true;
+		goto out;
+	}
+
+	if (*payload < next_seq[flow]) {
+		TC_ERROR("Flow %d reordered, seq %d expected %d\n",
+			 flow, *payload, next_seq[flow]);
+		fail = true;
+	}
+
+	next_seq[flow] = *payload + 1;
+
+	/* All the packets of one flow are handled by the same thread */
+	if (!flow_thread[flow]) {
+		flow_thread[flow] = k_current_get();
+	} else if (flow_thread[flow] != k_current_get()) {
+		TC_ERROR("Flow %d handled by thread %p, expected %p\n",
+			 flow, k_current_get(), flow_thread[flow]);
+		fail = true;
+	}
+
+	if (k_current_get() == iface_a->rx_tid ||
+	    k_current_get() == iface_b->rx_tid) {
+		TC_ERROR("Flow %d not dispatched to flow thread\n", flow);
+		fail = true;
+	}
+
+out:
+	received++;
+
+	net_nbuf_unref(buf);
+
+	k_sem_give(&recv_lock);
+
+	return NET_OK;
+}
+
+static struct net_buf *create_pkt(struct net_if *iface, int flow,
+				  uint8_t seq)
+{
+	struct net_buf *buf, *frag;
+
+	buf = net_nbuf_get_reserve_rx(0);
+	if (!buf) {
+		return NULL;
+	}
+
+	frag = net_nbuf_get_reserve_data(0);
+	if (!frag) {
+		net_nbuf_unref(buf);
+		return NULL;
+	}
+
+	net_buf_frag_add(buf, frag);
+
+	net_nbuf_set_iface(buf, iface);
+	net_nbuf_set_ll_reserve(buf, net_buf_headroom(frag));
+
+	NET_IPV6_BUF(buf)->vtc = 0x60;
+	NET_IPV6_BUF(buf)->tcflow = 0;
+	NET_IPV6_BUF(buf)->flow = 0;
+	NET_IPV6_BUF(buf)->len[0] = 0;
+	NET_IPV6_BUF(buf)->len[1] = NET_UDPH_LEN + sizeof(seq);
+	NET_IPV6_BUF(buf)->nexthdr = IPPROTO_UDP;
+	NET_IPV6_BUF(buf)->hop_limit = 255;
+
+	net_ipaddr_copy(&NET_IPV6_BUF(buf)->src, &peer_addr);
+	net_ipaddr_copy(&NET_IPV6_BUF(buf)->dst, &my_addr);
+
+	net_nbuf_set_ip_hdr_len(buf, sizeof(struct net_ipv6_hdr));
+	net_nbuf_set_ext_len(buf, 0);
+
+	NET_UDP_BUF(buf)->src_port = htons(FLOW_PORT + flow);
+	NET_UDP_BUF(buf)->dst_port = htons(TEST_PORT);
+	NET_UDP_BUF(buf)->len = htons(NET_UDPH_LEN + sizeof(seq));
+	NET_UDP_BUF(buf)->chksum = 0;
+
+	net_buf_add(frag, sizeof(struct net_ipv6_hdr) + NET_UDPH_LEN);
+	net_buf_add_u8(frag, seq);
+
+	return buf;
+}
+
+static int recv_pkt(struct net_if *iface, int flow, uint8_t seq)
+{
+	struct net_buf *buf;
+	int ret;
+
+	buf = create_pkt(iface, flow, seq);
+	if (!buf) {
+		return -ENOMEM;
+	}
+
+	ret = net_recv_data(iface, buf);
+	if (ret < 0) {
+		net_nbuf_unref(buf);
+	}
+
+	return ret;
+}
+
+static bool test_init(void)
+{
+	struct net_if_addr *ifaddr;
+	int ret;
+
+	iface_a = net_if_get_default();
+	iface_b = iface_a + 1;
+
+	k_sem_init(&recv_lock, 0, UINT_MAX);
+
+	ifaddr = net_if_ipv6_addr_add(iface_a, &my_addr, NET_ADDR_MANUAL, 0);
+	if (!ifaddr) {
+		TC_ERROR("Cannot add IPv6 address\n");
+		return false;
+	}
+
+	ret = net_udp_register(NULL, NULL, 0, TEST_PORT, recv_cb, NULL, NULL);
+	if (ret) {
+		TC_ERROR("UDP register failed (%d)\n", ret);
+		return false;
+	}
+
+	if (!iface_a->rx_tid || !iface_b->rx_tid ||
+	    iface_a->rx_tid == iface_b->rx_tid) {
+		TC_ERROR("Interfaces do not have own RX threads\n");
+		return false;
+	}
+
+	return true;
+}
+
+static bool test_flow_order(void)
+{
+	int i, flow;
+
+	for (i = 0; i < PKTS_PER_FLOW; i++) {
+		for (flow = 0; flow < FLOWS; flow++) {
+			if (recv_pkt(iface_a, flow, i) < 0) {
+				TC_ERROR("Cannot receive flow %d seq %d\n",
+					 flow, i);
+				return false;
+			}
+		}
+	}
+
+	for (i = 0; i < FLOWS * PKTS_PER_FLOW; i++) {
+		if (k_sem_take(&recv_lock, TIMEOUT)) {
+			TC_ERROR("Timeout, only %d packets received\n",
+				 received);
+			return false;
+		}
+	}
+
+	for (flow = 0; flow < FLOWS; flow++) {
+		if (next_seq[flow] != PKTS_PER_FLOW) {
+			TC_ERROR("Flow %d ended at seq %d\n", flow,
+				 next_seq[flow]);
+			return false;
+		}
+	}
+
+	return !fail;
+}
+
+static bool test_queue_limit(void)
+{
+	int accepted = 0, dropped = 0;
+	int i, ret;
+
+	/* Let the queue of iface A fill up by running its RX thread
+	 * below the priority of this thread.
+	 */
+	net_if_set_rx_prio(iface_a, K_PRIO_PREEMPT(10));
+
+	if (k_thread_priority_get(iface_a->rx_tid) != K_PRIO_PREEMPT(10)) {
+		TC_ERROR("RX thread priority not changed\n");
+		return false;
+	}
+
+	for (i = 0; i < CONFIG_NET_RX_QUEUE_MAX_DEPTH + 2; i++) {
+		ret = recv_pkt(iface_a, 0, next_seq[0] + i);
+		if (ret == -ENOBUFS) {
+			dropped++;
+		} else if (ret < 0) {
+			TC_ERROR("Cannot receive packet (%d)\n", ret);
+			return false;
+		} else {
+			accepted++;
+		}
+	}
+
+	if (accepted != CONFIG_NET_RX_QUEUE_MAX_DEPTH || dropped != 2 ||
+	    atomic_get(&iface_a->rx_pending) != accepted) {
+		TC_ERROR("Accepted %d dropped %d pending %d\n", accepted,
+			 dropped, (int)atomic_get(&iface_a->rx_pending));
+		return false;
+	}
+
+	/* Iface B has its own queue and thread so it is not blocked */
+	if (recv_pkt(iface_b, 1, next_seq[1]) < 0 ||
+	    k_sem_take(&recv_lock, K_NO_WAIT)) {
+		TC_ERROR("Packet from iface B not received\n");
+		return false;
+	}
+
+	for (i = 0; i < accepted; i++) {
+		if (k_sem_take(&recv_lock, TIMEOUT)) {
+			TC_ERROR("Timeout, queued packet %d not received\n",
+				 i);
+			return false;
+		}
+	}
+
+	net_if_set_rx_prio(iface_a, K_PRIO_COOP(CONFIG_NET_RX_THREAD_PRIO));
+
+	if (atomic_get(&iface_a->rx_pending)) {
+		TC_ERROR("RX queue of iface A not empty\n");
+		return false;
+	}
+
+	if (iface_a->rx_stats.drop != 2 ||
+	    iface_a->rx_stats.max_depth != CONFIG_NET_RX_QUEUE_MAX_DEPTH) {
+		TC_ERROR("Invalid iface A stats drop %u max depth %u\n",
+			 iface_a->rx_stats.drop, iface_a->rx_stats.max_depth);
+		return false;
+	}
+
+	return !fail;
+}
+
+static bool test_stats(void)
+{
+	net_stats_t flow_queued = 0;
+	int i;
+
+	for (i = 0; i < CONFIG_NET_RX_FLOW_QUEUE_COUNT; i++) {
+		flow_queued += net_stats.rx_flow[i].queued;
+	}
+
+	if (iface_a->rx_stats.queued + iface_b->rx_stats.queued !=
+	    received || flow_queued != received) {
+		TC_ERROR("Queued iface %u/%u flow %u, received %d\n",
+			 iface_a->rx_stats.queued, iface_b->rx_stats.queued,
+			 flow_queued, received);
+		return false;
+	}
+
+	return true;
+}
+
+static const struct {
+	const char *name;
+	bool (*func)(void);
+} tests[] = {
+	{ "test init", test_init },
+	{ "per flow ordering", test_flow_order },
+	{ "RX queue limit", test_queue_limit },
+	{ "RX queue statistics", test_stats },
+};
+
+void main(void)
+{
+	int count, pass;
+
+	for (count = 0, pass = 0; count < ARRAY_SIZE(tests); count++) {
+		TC_START(tests[count].name);
+		if (!tests[count].func()) {
+			TC_END(FAIL, "failed\n");
+		} else {
+			TC_END(PASS, "passed\n");
+			pass++;
+		}
+	}
+
+	TC_END_REPORT(((pass != ARRAY_SIZE(tests)) ? TC_FAIL : TC_PASS));
+}
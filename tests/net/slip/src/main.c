@@ -0,0 +1,332 @@
+/* main.c - Application main entry point */
+
+/*
+ * Copyright (c) 2016 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Checks the SLIP framing with every byte value and with the input and
+ * output split at every position, and measures how many cycles it takes
+ * per byte to escape and unescape a frame.
+ */
+
+#include <zephyr.h>
+#include <sections.h>
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys_clock.h>
+#include <misc/printk.h>
+#include <misc/util.h>
+#include <drivers/rand32.h>
+#include <drivers/slip.h>
+
+#include <tc_util.h>
+
+#define FRAME_LEN 600
+#define ROUNDS 20
+
+static uint8_t frame[FRAME_LEN];
+
+/* The worst case is that every byte is escaped, plus the END bytes */
+static uint8_t encoded[2 * FRAME_LEN + 2];
+static size_t encoded_len;
+
+static uint8_t decoded[FRAME_LEN + 1];
+
+static bool test_fcs(void)
+{
+	static const uint8_t check[] = "123456789";
+	uint8_t data[sizeof(check) - 1 + SLIP_FCS_LEN];
+	uint16_t fcs;
+
+	fcs = slip_fcs16(SLIP_FCS_INIT, check, sizeof(check) - 1) ^ 0xffff;
+	if (fcs != 0x906e) {
+		TC_ERROR("FCS 0x%04x, expected 0x906e\n", fcs);
+		return false;
+	}
+
+	memcpy(data, check, sizeof(check) - 1);
+	data[sizeof(check) - 1] = fcs;
+	data[sizeof(check)] = fcs >> 8;
+
+	fcs = slip_fcs16(SLIP_FCS_INIT, data, sizeof(data));
+	if (fcs != SLIP_FCS_GOOD) {
+		TC_ERROR("FCS over the frame 0x%04x\n", fcs);
+		return false;
+	}
+
+	return true;
+}
+
+static bool test_encode(void)
+{
+	const uint8_t *src = frame;
+	uint8_t *dst = encoded;
+	int i, escaped = 0;
+
+	/* Every byte value, and runs of END and ESC */
+	for (i = 0; i < FRAME_LEN; i++) {
+		if (i < 256) {
+			frame[i] = i;
+		} else if (i < 300) {
+			frame[i] = SLIP_END;
+		} else if (i < 344) {
+			frame[i] = SLIP_ESC;
+		} else {
+			frame[i] = sys_rand32_get();
+		}
+
+		if (frame[i] == SLIP_END || frame[i] == SLIP_ESC) {
+			escaped++;
+		}
+	}
+
+	*dst++ = SLIP_END;
+	dst = slip_encode(dst, encoded + sizeof(encoded) - 1, &src,
+			  frame + FRAME_LEN);
+	*dst++ = SLIP_END;
+
+	encoded_len = dst - encoded;
+
+	if (src != frame + FRAME_LEN ||
+	    encoded_len != FRAME_LEN + escaped + 2) {
+		TC_ERROR("Encoded %d of %d bytes into %d bytes\n",
+			 (int)(src - frame), FRAME_LEN, (int)encoded_len);
+		return false;
+	}
+
+	for (i = 0; i < encoded_len; i++) {
+		if (encoded[i] == SLIP_END && i && i != encoded_len - 1) {
+			TC_ERROR("END inside the frame at %d\n", i);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/* Encode with the output split into pieces of every size, an escaped
+ * byte must never be split between two pieces.
+ */
+static bool test_encode_split(void)
+{
+	uint8_t out[sizeof(encoded)];
+	int size;
+
+	for (size = 1; size < 16; size++) {
+		const uint8_t *src = frame;
+		uint8_t *dst = out;
+
+		while (src < frame + FRAME_LEN) {
+			uint8_t *end = dst + size;
+			uint8_t *next;
+
+			next = slip_encode(dst, end, &src, frame + FRAME_LEN);
+			if (next == dst && size > 1) {
+				TC_ERROR("No progress with %d bytes\n", size);
+				return false;
+			}
+
+			if (next == dst) {
+				/* An escape does not fit in one byte, let
+				 * the next piece take it.
+				 */
+				next = slip_encode(dst, dst + 2, &src,
+						   frame + FRAME_LEN);
+			}
+
+			dst = next;
+		}
+
+		if (dst - out != encoded_len - 2 ||
+		    memcmp(out, encoded + 1, encoded_len - 2)) {
+			TC_ERROR("Output split by %d differs\n", size);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/* Decode with the input split into pieces of every size and the output
+ * given a fragment at a time, like the driver does.
+ */
+static bool test_decode_split(void)
+{
+	int size, frag_size;
+
+	for (size = 1; size < 20; size++) {
+		for (frag_size = 1; frag_size < 130; frag_size += 64) {
+			struct slip_decoder dec;
+			const uint8_t *src = encoded;
+			uint8_t *dst = decoded;
+			uint8_t *dst_end = decoded;
+			int frames = 0;
+
+			slip_decoder_init(&dec);
+
+			while (src < encoded + encoded_len) {
+				const uint8_t *end = src + size;
+				enum slip_decode_status status;
+
+				if (end > encoded + encoded_len) {
+					end = encoded + encoded_len;
+				}
+
+				status = slip_decode(&dec, &src, end,
+						     &dst, dst_end);
+				switch (status) {
+				case SLIP_DECODE_MORE:
+					break;
+				case SLIP_DECODE_FULL:
+					if (dst_end == decoded +
+					    sizeof(decoded)) {
+						TC_ERROR("Overflow\n");
+						return false;
+					}
+
+					dst_end = min(dst_end + frag_size,
+						      decoded +
+						      sizeof(decoded));
+					break;
+				case SLIP_DECODE_END:
+					if (dst != decoded) {
+						frames++;
+					}
+
+					break;
+				case SLIP_DECODE_ERROR:
+					TC_ERROR("Invalid escape\n");
+					return false;
+				}
+			}
+
+			if (frames != 1 || dst - decoded != FRAME_LEN ||
+			    memcmp(decoded, frame, FRAME_LEN)) {
+				TC_ERROR("Input split by %d differs\n", size);
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+static bool test_decode_error(void)
+{
+	static const uint8_t data[] = {
+		SLIP_END, 1, SLIP_ESC, 2, 3, SLIP_ESC_END, SLIP_END,
+		4, SLIP_ESC, SLIP_ESC_END, SLIP_END,
+	};
+	const uint8_t *src = data;
+	const uint8_t *end = data + sizeof(data);
+	struct slip_decoder dec;
+	uint8_t out[8];
+	uint8_t *dst = out;
+
+	slip_decoder_init(&dec);
+
+	/* The leading END is an empty frame */
+	if (slip_decode(&dec, &src, end, &dst, out + sizeof(out)) !=
+	    SLIP_DECODE_END || dst != out) {
+		TC_ERROR("Empty frame not found\n");
+		return false;
+	}
+
+	if (slip_decode(&dec, &src, end, &dst, out + sizeof(out)) !=
+	    SLIP_DECODE_ERROR) {
+		TC_ERROR("Invalid escape not found\n");
+		return false;
+	}
+
+	/* The rest of the bad frame is skipped */
+	dst = out;
+	if (slip_decode(&dec, &src, end, &dst, out + sizeof(out)) !=
+	    SLIP_DECODE_END || dst - out != 2 ||
+	    out[0] != 4 || out[1] != SLIP_END || src != end) {
+		TC_ERROR("Frame after the error not decoded\n");
+		return false;
+	}
+
+	return true;
+}
+
+static bool test_performance(void)
+{
+	uint32_t start, encode_cycles, decode_cycles;
+	int i;
+
+	start = k_cycle_get_32();
+
+	for (i = 0; i < ROUNDS; i++) {
+		const uint8_t *src = frame;
+
+		slip_encode(encoded, encoded + sizeof(encoded), &src,
+			    frame + FRAME_LEN);
+	}
+
+	encode_cycles = k_cycle_get_32() - start;
+
+	start = k_cycle_get_32();
+
+	for (i = 0; i < ROUNDS; i++) {
+		const uint8_t *src = encoded + 1;
+		uint8_t *dst = decoded;
+		struct slip_decoder dec;
+
+		slip_decoder_init(&dec);
+		slip_decode(&dec, &src, encoded + encoded_len, &dst,
+			    decoded + sizeof(decoded));
+	}
+
+	decode_cycles = k_cycle_get_32() - start;
+
+	TC_PRINT("encode %u cycles per 100 bytes\n",
+		 encode_cycles * 100 / (ROUNDS * FRAME_LEN));
+	TC_PRINT("decode %u cycles per 100 bytes\n",
+		 decode_cycles * 100 / (ROUNDS * FRAME_LEN));
+
+	return true;
+}
+
+static const struct {
+	const char *name;
+	bool (*func)(void);
+} tests[] = {
+	{ "FCS-16", test_fcs },
+	{ "encode", test_encode },
+	{ "encode with split output", test_encode_split },
+	{ "decode with split input and output", test_decode_split },
+	{ "decode invalid escape", test_decode_error },
+	{ "performance", test_performance },
+};
+
+void main(void)
+{
+	int count, pass;
+
+	for (count = 0, pass = 0; count < ARRAY_SIZE(tests); count++) {
+		TC_START(tests[count].name);
+		if (!tests[count].func()) {
+			TC_END(FAIL, "failed\n");
+		} else {
+			TC_END(PASS, "passed\n");
+			pass++;
+		}
+	}
+
+	TC_END_REPORT(((pass != ARRAY_SIZE(tests)) ? TC_FAIL : TC_PASS));
+}
@@ -0,0 +1,225 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2016 Intel Corporation
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Measure how many SLIP frames per second the target passes.
+
+ICMPv6 echo requests from 2001:db8::2 to 2001:db8::1 are written to the
+pseudo terminal of the QEMU serial port with a number of them in flight,
+and the echo replies are read back. The result is printed as one line of
+JSON after the "SLIP_PERF " prefix, like the target does.
+"""
+
+import argparse
+import json
+import os
+import select
+import struct
+import sys
+import termios
+import time
+import tty
+
+END = 0o300
+ESC = 0o333
+ESC_END = 0o334
+ESC_ESC = 0o335
+
+SRC = bytes.fromhex("20010db8000000000000000000000002")
+DST = bytes.fromhex("20010db8000000000000000000000001")
+
+ICMPV6 = 58
+ECHO_REQUEST = 128
+ECHO_REPLY = 129
+ECHO_ID = 0x5a5a
+
+
+def fcs16_table():
+    table = []
+    for i in range(256):
+        fcs = i
+        for _ in range(8):
+            fcs = (fcs >> 1) ^ 0x8408 if fcs & 1 else fcs >> 1
+        table.append(fcs)
+    return table
+
+
+FCS16 = fcs16_table()
+
+
+def fcs16(data, fcs=0xffff):
+    for b in data:
+        fcs = (fcs >> 8) ^ FCS16[(fcs ^ b) & 0xff]
+    return fcs
+
+
+def checksum(data):
+    if len(data) & 1:
+        data += b"\0"
+    total = sum(struct.unpack("!%dH" % (len(data) // 2), data))
+    while total >> 16:
+        total = (total & 0xffff) + (total >> 16)
+    return ~total & 0xffff
+
+
+def echo_request(seq, size):
+    payload = bytes((seq + i) & 0xff for i in range(size))
+    icmp = struct.pack("!BBHHH", ECHO_REQUEST, 0, 0, ECHO_ID, seq) + payload
+    pseudo = SRC + DST + struct.pack("!I3xB", len(icmp), ICMPV6)
+    icmp = icmp[:2] + struct.pack("!H", checksum(pseudo + icmp)) + icmp[4:]
+    return struct.pack("!IHBB", 6 << 28, len(icmp), ICMPV6, 64) + \
+        SRC + DST + icmp
+
+
+def encode(frame, crc):
+    if crc:
+        frame += struct.pack("<H", fcs16(frame) ^ 0xffff)
+    frame = frame.replace(bytes([ESC]), bytes([ESC, ESC_ESC]))
+    frame = frame.replace(bytes([END]), bytes([ESC, ESC_END]))
+    return bytes([END]) + frame + bytes([END])
+
+
+class Decoder:
+    def __init__(self, crc):
+        self.crc = crc
+        self.frame = bytearray()
+        self.esc = False
+        self.errors = 0
+
+    def feed(self, data):
+        frames = []
+        for b in data:
+            if self.esc:
+                self.esc = False
+                if b == ESC_END:
+                    self.frame.append(END)
+                elif b == ESC_ESC:
+                    self.frame.append(ESC)
+                else:
+                    self.errors += 1
+            elif b == ESC:
+                self.esc = True
+            elif b == END:
+                if self.frame:
+                    frames.append(self.check(bytes(self.frame)))
+                self.frame = bytearray()
+            else:
+                self.frame.append(b)
+        return [f for f in frames if f is not None]
+
+    def check(self, frame):
+        if not self.crc:
+            return frame
+        if len(frame) < 2 or fcs16(frame) != 0xf0b8:
+            self.errors += 1
+            return None
+        return frame[:-2]
+
+
+def echo_seq(frame):
+    """Sequence number of an echo reply to us, or None."""
+    if len(frame) < 48 or frame[0] >> 4 != 6 or frame[6] != ICMPV6:
+        return None
+    if frame[8:24] != DST or frame[24:40] != SRC:
+        return None
+    icmp_type, _, _, echo_id, seq = struct.unpack("!BBHHH", frame[40:48])
+    if icmp_type != ECHO_REPLY or echo_id != ECHO_ID:
+        return None
+    return seq
+
+
+def run(args):
+    fd = os.open(args.pty, os.O_RDWR | os.O_NOCTTY)
+    old = termios.tcgetattr(fd)
+    tty.setraw(fd)
+    termios.tcflush(fd, termios.TCIOFLUSH)
+
+    decoder = Decoder(args.crc)
+    pending = {}
+    sent = received = lost = 0
+    rtt_total = 0.0
+    seq = 0
+
+    start = time.monotonic()
+    try:
+        while received + lost < args.count:
+            now = time.monotonic()
+
+            while len(pending) < args.window and sent < args.count:
+                os.write(fd, encode(echo_request(seq, args.size), args.crc))
+                pending[seq] = now
+                seq = (seq + 1) & 0xffff
+                sent += 1
+
+            for s, t in list(pending.items()):
+                if now - t > args.timeout:
+                    del pending[s]
+                    lost += 1
+
+            ready, _, _ = select.select([fd], [], [], 0.1)
+            if not ready:
+                continue
+
+            for frame in decoder.feed(os.read(fd, 4096)):
+                s = echo_seq(frame)
+                if s in pending:
+                    rtt_total += time.monotonic() - pending.pop(s)
+                    received += 1
+    finally:
+        termios.tcsetattr(fd, termios.TCSADRAIN, old)
+        os.close(fd)
+
+    elapsed = time.monotonic() - start
+    frame_len = len(encode(echo_request(0, args.size), args.crc))
+
+    return {
+        "test": "echo",
+        "crc": args.crc,
+        "size": args.size,
+        "window": args.window,
+        "sent": sent,
+        "received": received,
+        "lost": lost,
+        "errors": decoder.errors,
+        "ms": int(elapsed * 1000),
+        "frames_per_sec": int(2 * received / elapsed),
+        "kbps": int(2 * received * frame_len * 8 / elapsed / 1000),
+        "rtt_avg_ms": round(rtt_total * 1000 / max(received, 1), 3),
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("pty", help="pseudo terminal of the SLIP UART")
+    parser.add_argument("-n", "--count", type=int, default=2000,
+                        help="echo requests to send (default 2000)")
+    parser.add_argument("-s", "--size", type=int, default=64,
+                        help="echo payload bytes (default 64)")
+    parser.add_argument("-w", "--window", type=int, default=4,
+                        help="requests in flight (default 4)")
+    parser.add_argument("-t", "--timeout", type=float, default=2.0,
+                        help="seconds before a request is lost")
+    parser.add_argument("--crc", action="store_true",
+                        help="add and check the FCS-16 of each frame")
+    args = parser.parse_args()
+
+    result = run(args)
+    print("SLIP_PERF " + json.dumps(result, separators=(",", ":")))
+
+    return 0 if result["received"] else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
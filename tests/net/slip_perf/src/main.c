@@ -0,0 +1,50 @@
+/* main.c - SLIP link performance measurement */
+
+/*
+ * Copyright (c) 2016 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* The target only brings the SLIP interface up with a known address.
+ * The stack answers the echo requests that slip_perf.py sends over the
+ * pseudo terminal, and the script does the measuring.
+ */
+
+#include <zephyr.h>
+#include <sections.h>
+
+#include <misc/printk.h>
+#include <net/net_core.h>
+#include <net/net_if.h>
+#include <net/net_ip.h>
+
+/* 2001:db8::1 */
+static struct in6_addr my_addr = { { { 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0,
+				       0, 0, 0, 0, 0, 0, 0, 0x1 } } };
+
+void main(void)
+{
+	struct net_if *iface = net_if_get_default();
+
+	if (!net_if_ipv6_addr_add(iface, &my_addr, NET_ADDR_MANUAL, 0)) {
+		printk("SLIP_PERF {\"test\":\"error\"}\n");
+		return;
+	}
+
+#if defined(CONFIG_SLIP_CRC)
+	printk("SLIP_PERF {\"test\":\"ready\",\"crc\":true}\n");
+#else
+	printk("SLIP_PERF {\"test\":\"ready\",\"crc\":false}\n");
+#endif
+}
@@ -0,0 +1,596 @@
+/* main.c - BSD socket like API */
+
+/*
+ * Copyright (c) 2016 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <zephyr.h>
+#include <sections.h>
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <device.h>
+#include <init.h>
+#include <misc/printk.h>
+#include <net/buf.h>
+#include <net/net_core.h>
+#include <net/nbuf.h>
+#include <net/net_ip.h>
+#include <net/ethernet.h>
+#include <net/socket.h>
+
+#include <tc_util.h>
+
+#define UDP_PORT 4242
+#define UDP_PORT2 4243
+#define TCP_PORT 4244
+
+/* Long enough for the RX and TX threads to pass a packet */
+#define WAIT_TIME 200
+
+static struct in6_addr my_addr = { { { 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0,
+				       0, 0, 0, 0, 0, 0, 0, 0x1 } } };
+
+static uint8_t mac_addr[sizeof(struct net_eth_addr)];
+static struct net_if *iface;
+
+static int udp_server = -1, udp_server2 = -1, udp_client = -1;
+static int tcp_listen = -1, tcp_server = -1, tcp_client = -1;
+
+static const char msg[] = "Sockets are queued";
+
+static int net_socket_dev_init(struct device *dev)
+{
+	return 0;
+}
+
+static void net_socket_iface_init(struct net_if *net_iface)
+{
+	/* 10-00-00-00-00 to 10-00-00-00-FF Documentation RFC7042 */
+	mac_addr[0] = 0x10;
+	mac_addr[5] = 0x01;
+	iface = net_iface;
+
+	net_if_set_link_addr(net_iface, mac_addr, 6);
+}
+
+/* Everything that is sent is received again by the same interface, so
+ * that the sockets talk to each other over our own address. On error
+ * the TX thread releases the buffer.
+ */
+static int loop_send(struct net_if *net_iface, struct net_buf *buf)
+{
+	struct net_buf *rx, *frag, *copy;
+
+	rx = net_nbuf_get_reserve_rx(0);
+	if (!rx) {
+		return -ENOMEM;
+	}
+
+	for (frag = buf->frags; frag; frag = frag->frags) {
+		copy = net_nbuf_get_reserve_data(0);
+		if (!copy) {
+			net_nbuf_unref(rx);
+			return -ENOMEM;
+		}
+
+		memcpy(net_buf_add(copy, frag->len), frag->data, frag->len);
+		net_buf_frag_add(rx, copy);
+	}
+
+	if (net_recv_data(net_iface, rx) < 0) {
+		net_nbuf_unref(rx);
+		return -EIO;
+	}
+
+	net_nbuf_unref(buf);
+
+	return 0;
+}
+
+static struct net_if_api net_socket_if_api = {
+	.init = net_socket_iface_init,
+	.send = loop_send,
+};
+
+#define _ETH_L2_LAYER DUMMY_L2
+#define _ETH_L2_CTX_TYPE NET_L2_GET_CTX_TYPE(DUMMY_L2)
+
+NET_DEVICE_INIT(net_socket_test, "net_socket_test",
+		net_socket_dev_init, NULL, NULL,
+		CONFIG_KERNEL_INIT_PRIORITY_DEFAULT,
+		&net_socket_if_api, _ETH_L2_LAYER, _ETH_L2_CTX_TYPE, 127);
+
+static void set_addr(struct sockaddr_in6 *addr, uint16_t port)
+{
+	memset(addr, 0, sizeof(*addr));
+	addr->sin6_family = AF_INET6;
+	addr->sin6_port = htons(port);
+	net_ipaddr_copy(&addr->sin6_addr, &my_addr);
+}
+
+static int udp_socket(uint16_t port)
+{
+	struct sockaddr_in6 addr;
+	int sock;
+
+	sock = zsock_socket(AF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+	if (sock < 0) {
+		TC_ERROR("Cannot create UDP socket (%d)\n", errno);
+		return -1;
+	}
+
+	set_addr(&addr, port);
+
+	if (zsock_bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		TC_ERROR("Cannot bind UDP socket (%d)\n", errno);
+		return -1;
+	}
+
+	return sock;
+}
+
+static bool test_init(void)
+{
+	if (!iface) {
+		TC_ERROR("Interface not initialized\n");
+		return false;
+	}
+
+	if (!net_if_ipv6_addr_add(iface, &my_addr, NET_ADDR_MANUAL, 0)) {
+		TC_ERROR("Cannot add IPv6 address\n");
+		return false;
+	}
+
+	udp_server = udp_socket(UDP_PORT);
+	udp_server2 = udp_socket(UDP_PORT2);
+
+	udp_client = zsock_socket(AF_INET6, SOCK_DGRAM, 0);
+	if (udp_client < 0) {
+		TC_ERROR("Cannot create UDP client (%d)\n", errno);
+		return false;
+	}
+
+	return udp_server >= 0 && udp_server2 >= 0;
+}
+
+static bool test_nonblock(void)
+{
+	struct zsock_pollfd pfd = {
+		.fd = udp_server,
+		.events = ZSOCK_POLLIN,
+	};
+	uint32_t start;
+	char buf[8];
+
+	if (zsock_fcntl(udp_server, ZSOCK_F_SETFL, ZSOCK_O_NONBLOCK) < 0 ||
+	    zsock_fcntl(udp_server, ZSOCK_F_GETFL, 0) != ZSOCK_O_NONBLOCK) {
+		TC_ERROR("Cannot set non-blocking mode\n");
+		return false;
+	}
+
+	if (zsock_recv(udp_server, buf, sizeof(buf), 0) != -1 ||
+	    errno != EAGAIN) {
+		TC_ERROR("Empty non-blocking socket did not fail\n");
+		return false;
+	}
+
+	if (zsock_fcntl(udp_server, ZSOCK_F_SETFL, 0) < 0) {
+		TC_ERROR("Cannot clear non-blocking mode\n");
+		return false;
+	}
+
+	if (zsock_recv(udp_server, buf, sizeof(buf),
+		       ZSOCK_MSG_DONTWAIT) != -1 || errno != EAGAIN) {
+		TC_ERROR("MSG_DONTWAIT did not fail\n");
+		return false;
+	}
+
+	if (zsock_poll(&pfd, 1, 0) != 0 || pfd.revents) {
+		TC_ERROR("Empty socket polled ready\n");
+		return false;
+	}
+
+	start = k_uptime_get_32();
+
+	if (zsock_poll(&pfd, 1, WAIT_TIME) != 0) {
+		TC_ERROR("Poll did not time out\n");
+		return false;
+	}
+
+	if (k_uptime_get_32() - start < WAIT_TIME / 2) {
+		TC_ERROR("Poll returned too early\n");
+		return false;
+	}
+
+	return true;
+}
+
+static bool test_recv_timeout(void)
+{
+	struct timeval tv = { 0, WAIT_TIME / 2 * USEC_PER_MSEC };
+	socklen_t len = sizeof(tv);
+	char buf[8];
+
+	if (zsock_setsockopt(udp_server, SOL_SOCKET, SO_RCVTIMEO, &tv,
+			     sizeof(tv)) < 0) {
+		TC_ERROR("Cannot set receive timeout (%d)\n", errno);
+		return false;
+	}
+
+	memset(&tv, 0, sizeof(tv));
+
+	if (zsock_getsockopt(udp_server, SOL_SOCKET, SO_RCVTIMEO, &tv,
+			     &len) < 0 || len != sizeof(tv) || tv.tv_sec ||
+	    tv.tv_usec != WAIT_TIME / 2 * USEC_PER_MSEC) {
+		TC_ERROR("Wrong receive timeout %ld.%06ld\n",
+			 tv.tv_sec, tv.tv_usec);
+		return false;
+	}
+
+	if (zsock_recv(udp_server, buf, sizeof(buf), 0) != -1 ||
+	    errno != EAGAIN) {
+		TC_ERROR("Receive did not time out\n");
+		return false;
+	}
+
+	if (zsock_setsockopt(udp_server, SOL_SOCKET, SO_RCVTIMEO, &tv,
+			     sizeof(int32_t)) != -1 || errno != EINVAL) {
+		TC_ERROR("Short timeout value accepted\n");
+		return false;
+	}
+
+	memset(&tv, 0, sizeof(tv));
+
+	return zsock_setsockopt(udp_server, SOL_SOCKET, SO_RCVTIMEO,
+				&tv, sizeof(tv)) == 0;
+}
+
+static bool test_sockopt(void)
+{
+	socklen_t len = sizeof(int);
+	int val = NET_PRIORITY_VO;
+
+	if (zsock_setsockopt(udp_server, SOL_SOCKET, SO_PRIORITY, &val,
+			     sizeof(val)) < 0) {
+		TC_ERROR("Cannot set priority (%d)\n", errno);
+		return false;
+	}
+
+	val = 0;
+
+	if (zsock_getsockopt(udp_server, SOL_SOCKET, SO_PRIORITY, &val,
+			     &len) < 0 || val != NET_PRIORITY_VO) {
+		TC_ERROR("Wrong priority %d\n", val);
+		return false;
+	}
+
+	val = NET_PRIORITY_NC + 1;
+
+	if (zsock_setsockopt(udp_server, SOL_SOCKET, SO_PRIORITY, &val,
+			     sizeof(val)) != -1 || errno != EINVAL) {
+		TC_ERROR("Invalid priority accepted\n");
+		return false;
+	}
+
+	val = 1;
+
+	if (zsock_setsockopt(udp_server, SOL_SOCKET, SO_REUSEADDR, &val,
+			     sizeof(val)) != -1 || errno != ENOPROTOOPT) {
+		TC_ERROR("SO_REUSEADDR accepted\n");
+		return false;
+	}
+
+	if (zsock_setsockopt(udp_server, IPPROTO_TCP, TCP_NODELAY, &val,
+			     sizeof(val)) != -1 || errno != ENOPROTOOPT) {
+		TC_ERROR("TCP_NODELAY accepted\n");
+		return false;
+	}
+
+	val = NET_PRIORITY_BE;
+
+	return zsock_setsockopt(udp_server, SOL_SOCKET, SO_PRIORITY,
+				&val, sizeof(val)) == 0;
+}
+
+static bool test_udp_sendto(void)
+{
+	struct sockaddr_in6 addr, from;
+	socklen_t fromlen = sizeof(from);
+	char buf[sizeof(msg)];
+	ssize_t ret;
+
+	set_addr(&addr, UDP_PORT);
+
+	ret = zsock_sendto(udp_client, msg, sizeof(msg), 0,
+			   (struct sockaddr *)&addr, sizeof(addr));
+	if (ret != sizeof(msg)) {
+		TC_ERROR("Cannot send (%d)\n", errno);
+		return false;
+	}
+
+	ret = zsock_recvfrom(udp_server, buf, sizeof(buf), 0,
+			     (struct sockaddr *)&from, &fromlen);
+	if (ret != sizeof(msg) || memcmp(buf, msg, sizeof(msg))) {
+		TC_ERROR("Received %d bytes, expected %zu\n", ret,
+			 sizeof(msg));
+		return false;
+	}
+
+	if (fromlen != sizeof(from) || from.sin6_family != AF_INET6 ||
+	    !net_ipv6_addr_cmp(&from.sin6_addr, &my_addr) ||
+	    !from.sin6_port) {
+		TC_ERROR("Wrong source address\n");
+		return false;
+	}
+
+	/* Reply to the port the client was bound to automatically */
+	if (zsock_sendto(udp_server, msg, sizeof(msg), 0,
+			 (struct sockaddr *)&from, fromlen) != sizeof(msg)) {
+		TC_ERROR("Cannot send reply (%d)\n", errno);
+		return false;
+	}
+
+	ret = zsock_recv(udp_client, buf, sizeof(buf), 0);
+	if (ret != sizeof(msg)) {
+		TC_ERROR("Reply not received (%d)\n", errno);
+		return false;
+	}
+
+	return true;
+}
+
+static bool test_udp_peek_truncate(void)
+{
+	struct sockaddr_in6 addr;
+	char buf[sizeof(msg)];
+
+	set_addr(&addr, UDP_PORT);
+
+	if (zsock_connect(udp_client, (struct sockaddr *)&addr,
+			  sizeof(addr)) < 0) {
+		TC_ERROR("Cannot connect UDP socket (%d)\n", errno);
+		return false;
+	}
+
+	if (zsock_send(udp_client, msg, sizeof(msg), 0) != sizeof(msg)) {
+		TC_ERROR("Cannot send (%d)\n", errno);
+		return false;
+	}
+
+	if (zsock_recv(udp_server, buf, 4, ZSOCK_MSG_PEEK) != 4 ||
+	    memcmp(buf, msg, 4)) {
+		TC_ERROR("Peek failed\n");
+		return false;
+	}
+
+	/* The datagram is still there and the rest of it is dropped */
+	if (zsock_recv(udp_server, buf, 8, 0) != 8 || memcmp(buf, msg, 8)) {
+		TC_ERROR("Receive after peek failed\n");
+		return false;
+	}
+
+	if (zsock_recv(udp_server, buf, sizeof(buf),
+		       ZSOCK_MSG_DONTWAIT) != -1 || errno != EAGAIN) {
+		TC_ERROR("Truncated datagram was not dropped\n");
+		return false;
+	}
+
+	return true;
+}
+
+static bool test_poll(void)
+{
+	struct zsock_pollfd pfd[] = {
+		{ .fd = udp_server, .events = ZSOCK_POLLIN },
+		{ .fd = udp_server2, .events = ZSOCK_POLLIN },
+		{ .fd = -1, .events = ZSOCK_POLLIN },
+		{ .fd = udp_client, .events = ZSOCK_POLLOUT },
+	};
+	struct sockaddr_in6 addr;
+	char buf[sizeof(msg)];
+	int ret;
+
+	set_addr(&addr, UDP_PORT2);
+
+	if (zsock_sendto(udp_client, msg, sizeof(msg), 0,
+			 (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		TC_ERROR("Cannot send (%d)\n", errno);
+		return false;
+	}
+
+	/* Leave the UDP client out so that the wait is really needed */
+	ret = zsock_poll(pfd, 3, WAIT_TIME);
+	if (ret != 1 || pfd[0].revents || pfd[1].revents != ZSOCK_POLLIN ||
+	    pfd[2].revents) {
+		TC_ERROR("Poll returned %d, events %x %x %x\n", ret,
+			 pfd[0].revents, pfd[1].revents, pfd[2].revents);
+		return false;
+	}
+
+	ret = zsock_poll(pfd, ARRAY_SIZE(pfd), 0);
+	if (ret != 2 || pfd[3].revents != ZSOCK_POLLOUT) {
+		TC_ERROR("UDP socket not writable\n");
+		return false;
+	}
+
+	if (zsock_recv(udp_server2, buf, sizeof(buf), 0) != sizeof(msg)) {
+		TC_ERROR("Cannot receive (%d)\n", errno);
+		return false;
+	}
+
+	return true;
+}
+
+static bool test_bad_fd(void)
+{
+	struct zsock_pollfd pfd = {
+		.fd = CONFIG_NET_MAX_CONTEXTS - 1,
+		.events = ZSOCK_POLLIN,
+	};
+	char buf[8];
+
+	if (zsock_recv(CONFIG_NET_MAX_CONTEXTS, buf, sizeof(buf), 0) != -1 ||
+	    errno != EBADF) {
+		TC_ERROR("Bad descriptor accepted\n");
+		return false;
+	}
+
+	if (zsock_poll(&pfd, 1, 0) != 1 || pfd.revents != ZSOCK_POLLNVAL) {
+		TC_ERROR("Unused descriptor not reported\n");
+		return false;
+	}
+
+	return true;
+}
+
+static bool test_tcp_connect(void)
+{
+	struct sockaddr_in6 addr, peer;
+	socklen_t peerlen = sizeof(peer);
+
+	tcp_listen = zsock_socket(AF_INET6, SOCK_STREAM, IPPROTO_TCP);
+	tcp_client = zsock_socket(AF_INET6, SOCK_STREAM, 0);
+	if (tcp_listen < 0 || tcp_client < 0) {
+		TC_ERROR("Cannot create TCP sockets (%d)\n", errno);
+		return false;
+	}
+
+	set_addr(&addr, TCP_PORT);
+
+	if (zsock_bind(tcp_listen, (struct sockaddr *)&addr,
+		       sizeof(addr)) < 0 ||
+	    zsock_listen(tcp_listen, 1) < 0) {
+		TC_ERROR("Cannot listen (%d)\n", errno);
+		return false;
+	}
+
+	if (zsock_connect(tcp_client, (struct sockaddr *)&addr,
+			  sizeof(addr)) < 0) {
+		TC_ERROR("Cannot connect (%d)\n", errno);
+		return false;
+	}
+
+	tcp_server = zsock_accept(tcp_listen, (struct sockaddr *)&peer,
+				  &peerlen);
+	if (tcp_server < 0) {
+		TC_ERROR("Cannot accept (%d)\n", errno);
+		return false;
+	}
+
+	if (peerlen != sizeof(peer) ||
+	    !net_ipv6_addr_cmp(&peer.sin6_addr, &my_addr)) {
+		TC_ERROR("Wrong peer address\n");
+		return false;
+	}
+
+	return true;
+}
+
+static bool test_tcp_stream(void)
+{
+	struct zsock_pollfd pfd = {
+		.fd = tcp_server,
+		.events = ZSOCK_POLLIN,
+	};
+	char buf[sizeof(msg)];
+	size_t received = 0;
+	ssize_t ret;
+
+	if (zsock_send(tcp_client, msg, sizeof(msg), 0) != sizeof(msg)) {
+		TC_ERROR("Cannot send (%d)\n", errno);
+		return false;
+	}
+
+	/* A stream can be read in pieces */
+	while (received < sizeof(msg)) {
+		ret = zsock_recv(tcp_server, buf + received, 5, 0);
+		if (ret <= 0) {
+			TC_ERROR("Receive failed (%d)\n", errno);
+			return false;
+		}
+
+		received += ret;
+	}
+
+	if (memcmp(buf, msg, sizeof(msg))) {
+		TC_ERROR("Wrong data received\n");
+		return false;
+	}
+
+	if (zsock_close(tcp_client) < 0) {
+		TC_ERROR("Cannot close (%d)\n", errno);
+		return false;
+	}
+
+	if (zsock_poll(&pfd, 1, WAIT_TIME) != 1 ||
+	    !(pfd.revents & ZSOCK_POLLHUP)) {
+		TC_ERROR("End of connection not polled\n");
+		return false;
+	}
+
+	if (zsock_recv(tcp_server, buf, sizeof(buf), 0) != 0) {
+		TC_ERROR("End of connection not received\n");
+		return false;
+	}
+
+	return true;
+}
+
+static bool test_close(void)
+{
+	return zsock_close(tcp_server) == 0 &&
+		zsock_close(tcp_listen) == 0 &&
+		zsock_close(udp_client) == 0 &&
+		zsock_close(udp_server2) == 0 &&
+		zsock_close(udp_server) == 0 &&
+		zsock_close(udp_server) == -1 && errno == EBADF;
+}
+
+static const struct {
+	const char *name;
+	bool (*func)(void);
+} tests[] = {
+	{ "test init", test_init },
+	{ "non-blocking receive and poll timeout", test_nonblock },
+	{ "receive timeout", test_recv_timeout },
+	{ "socket options", test_sockopt },
+	{ "UDP sendto and recvfrom", test_udp_sendto },
+	{ "UDP peek and truncate", test_udp_peek_truncate },
+	{ "poll several sockets", test_poll },
+	{ "bad descriptors", test_bad_fd },
+	{ "TCP connect and accept", test_tcp_connect },
+	{ "TCP stream and close", test_tcp_stream },
+	{ "close", test_close },
+};
+
+void main(void)
+{
+	int count, pass;
+
+	for (count = 0, pass = 0; count < ARRAY_SIZE(tests); count++) {
+		TC_START(tests[count].name);
+		if (!tests[count].func()) {
+			TC_END(FAIL, "failed\n");
+		} else {
+			TC_END(PASS, "passed\n");
+			pass++;
+		}
+	}
+
+	TC_END_REPORT(((pass != ARRAY_SIZE(tests)) ? TC_FAIL : TC_PASS));
+}
@@ -178,10 +178,27 @@ static bool test_trickle_2_status(void)
 	return true;
 }
 
+/* Both timers give the same semaphore and call their callbacks at every
+ * interval, so wait until the given one has been called.
+ */
+static void wait_cb(bool *called, int32_t timeout)
+{
+	int64_t end = k_uptime_get() + timeout;
+
+	*called = false;
+
+	while (!*called) {
+		int32_t left = end - k_uptime_get();
+
+		if (left <= 0 || k_sem_take(&wait, left)) {
+			break;
+		}
+	}
+}
+
 static bool test_trickle_1_wait(void)
 {
-	cb_1_called = false;
-	k_sem_take(&wait, WAIT_TIME);
+	wait_cb(&cb_1_called, WAIT_TIME);
 
 	if (!cb_1_called) {
 		TC_ERROR("Trickle 1 no timeout\n");
@@ -199,8 +216,7 @@ static bool test_trickle_1_wait(void)
 #if CHECK_LONG_TIMEOUT > 0
 static bool test_trickle_1_wait_long(void)
 {
-	cb_1_called = false;
-	k_sem_take(&wait, WAIT_TIME_LONG);
+	wait_cb(&cb_1_called, WAIT_TIME_LONG);
 
 	if (!cb_1_called) {
 		TC_ERROR("Trickle 1 no timeout\n");
@@ -218,8 +234,7 @@ static bool test_trickle_1_wait_long(void)
 
 static bool test_trickle_2_wait(void)
 {
-	cb_2_called = false;
-	k_sem_take(&wait, WAIT_TIME);
+	wait_cb(&cb_2_called, WAIT_TIME);
 
 	if (!cb_2_called) {
 		TC_ERROR("Trickle 2 no timeout\n");
@@ -285,6 +300,7 @@ static const struct {
 	{ "trickle 1 check status", test_trickle_1_status },
 	{ "trickle 2 check status", test_trickle_2_status },
 	{ "trickle 1 wait timeout", test_trickle_1_wait },
+	{ "trickle 1 wait next interval", test_trickle_1_wait },
 	{ "trickle 2 wait timeout", test_trickle_2_wait },
 	{ "trickle 1 update", test_trickle_1_update },
 	{ "trickle 1 check status", test_trickle_1_status },
@@ -0,0 +1,386 @@
+/* main.c - Application main entry point */
+
+/*
+ * Copyright (c) 2016 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <zephyr.h>
+#include <sections.h>
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <device.h>
+#include <init.h>
+#include <misc/printk.h>
+#include <net/buf.h>
+#include <net/net_core.h>
+#include <net/nbuf.h>
+#include <net/net_ip.h>
+#include <net/ethernet.h>
+
+#include <tc_util.h>
+
+#include "net_private.h"
+
+#define MAX_SENT 8
+#define TIMEOUT 200
+
+static struct in6_addr my_addr = { { { 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0,
+				       0, 0, 0, 0, 0, 0, 0, 0x1 } } };
+static struct in6_addr peer_addr = { { { 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0,
+					 0, 0, 0, 0, 0, 0, 0, 0x2 } } };
+
+static struct net_if *iface;
+
+/* The TX thread waits on tx_block in the driver while block is set,
+ * so the test can fill the queues before anything more is sent.
+ */
+static struct k_sem tx_block;
+static struct k_sem sent_lock;
+static bool block;
+
+static uint8_t sent[MAX_SENT];
+static int sent_count;
+
+struct net_tx_tc_context {
+	uint8_t mac_addr[sizeof(struct net_eth_addr)];
+};
+
+static int net_tx_tc_dev_init(struct device *dev)
+{
+	return 0;
+}
+
+static void net_tx_tc_iface_init(struct net_if *iface)
+{
+	struct net_tx_tc_context *context =
+		net_if_get_device(iface)->driver_data;
+
+	/* 10-00-00-00-00 to 10-00-00-00-FF Documentation RFC7042 */
+	context->mac_addr[0] = 0x10;
+	context->mac_addr[5] = sys_rand32_get();
+
+	net_if_set_link_addr(iface, context->mac_addr, 6);
+}
+
+static int tester_send(struct net_if *iface, struct net_buf *buf)
+{
+	if (block) {
+		k_sem_take(&tx_block, K_FOREVER);
+	}
+
+	if (sent_count < MAX_SENT) {
+		sent[sent_count++] = net_nbuf_priority(buf);
+	}
+
+	net_nbuf_unref(buf);
+
+	k_sem_give(&sent_lock);
+
+	return 0;
+}
+
+static struct net_tx_tc_context net_tx_tc_data;
+
+static struct net_if_api net_tx_tc_if_api = {
+	.init = net_tx_tc_iface_init,
+	.send = tester_send,
+};
+
+#define _ETH_L2_LAYER DUMMY_L2
+#define _ETH_L2_CTX_TYPE NET_L2_GET_CTX_TYPE(DUMMY_L2)
+
+NET_DEVICE_INIT(net_tx_tc_test, "net_tx_tc_test",
+		net_tx_tc_dev_init, &net_tx_tc_data, NULL,
+		CONFIG_KERNEL_INIT_PRIORITY_DEFAULT,
+		&net_tx_tc_if_api, _ETH_L2_LAYER, _ETH_L2_CTX_TYPE, 127);
+
+static struct net_buf *create_pkt(uint8_t priority)
+{
+	struct net_buf *buf, *frag;
+
+	buf = net_nbuf_get_reserve_tx(0);
+	if (!buf) {
+		return NULL;
+	}
+
+	frag = net_nbuf_get_reserve_data(0);
+	if (!frag) {
+		net_nbuf_unref(buf);
+		return NULL;
+	}
+
+	net_buf_frag_add(buf, frag);
+	net_buf_add_u8(frag, priority);
+
+	net_nbuf_set_iface(buf, iface);
+	net_nbuf_set_priority(buf, priority);
+
+	return buf;
+}
+
+static bool queue_pkts(const uint8_t *priorities, int count)
+{
+	struct net_buf *buf;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		buf = create_pkt(priorities[i]);
+		if (!buf) {
+			TC_ERROR("Out of buffers at packet %d\n", i);
+			return false;
+		}
+
+		net_if_queue_tx(iface, buf);
+	}
+
+	return true;
+}
+
+static bool wait_sent(int count)
+{
+	while (count--) {
+		if (k_sem_take(&sent_lock, TIMEOUT)) {
+			TC_ERROR("Timeout, %d packet(s) not sent\n", count + 1);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool test_init(void)
+{
+	iface = net_if_get_default();
+
+	k_sem_init(&tx_block, 0, UINT_MAX);
+	k_sem_init(&sent_lock, 0, UINT_MAX);
+
+	if (!net_if_ipv6_addr_add(iface, &my_addr, NET_ADDR_MANUAL, 0)) {
+		TC_ERROR("Cannot add IPv6 address\n");
+		return false;
+	}
+
+	return true;
+}
+
+static bool test_priority2tc(void)
+{
+	static const struct {
+		uint8_t priority;
+		uint8_t tc;
+	} map[] = {
+		{ NET_PRIORITY_BK, 0 },
+		{ NET_PRIORITY_BE, 0 },
+		{ NET_PRIORITY_EE, 1 },
+		{ NET_PRIORITY_CA, 1 },
+		{ NET_PRIORITY_VI, 2 },
+		{ NET_PRIORITY_VO, 2 },
+		{ NET_PRIORITY_IC, 3 },
+		{ NET_PRIORITY_NC, 3 },
+		{ NET_MAX_PRIORITIES, 0 },
+	};
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(map); i++) {
+		if (net_tx_priority2tc(map[i].priority) != map[i].tc) {
+			TC_ERROR("Priority %d mapped to %d, expected %d\n",
+				 map[i].priority,
+				 net_tx_priority2tc(map[i].priority),
+				 map[i].tc);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool test_strict_priority(void)
+{
+	static const uint8_t first = NET_PRIORITY_BE;
+	static const uint8_t queued[] = {
+		NET_PRIORITY_BK, NET_PRIORITY_BE, NET_PRIORITY_VI,
+		NET_PRIORITY_NC, NET_PRIORITY_EE,
+	};
+	static const uint8_t expected[] = {
+		NET_PRIORITY_BE, NET_PRIORITY_NC, NET_PRIORITY_VI,
+		NET_PRIORITY_EE, NET_PRIORITY_BK, NET_PRIORITY_BE,
+	};
+	int i;
+
+	sent_count = 0;
+	block = true;
+
+	/* The TX thread takes this one and waits in the driver */
+	if (!queue_pkts(&first, 1) || !queue_pkts(queued, sizeof(queued))) {
+		return false;
+	}
+
+	block = false;
+	k_sem_give(&tx_block);
+
+	if (!wait_sent(sizeof(expected))) {
+		return false;
+	}
+
+	for (i = 0; i < sizeof(expected); i++) {
+		if (sent[i] != expected[i]) {
+			TC_ERROR("Packet %d has priority %d, expected %d\n",
+				 i, sent[i], expected[i]);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool test_queue_depth(void)
+{
+	static const uint8_t queued[] = {
+		NET_PRIORITY_BE, NET_PRIORITY_BE, NET_PRIORITY_BE,
+		NET_PRIORITY_BE,
+	};
+	uint32_t drop = iface->tx_stats[0].drop;
+
+	sent_count = 0;
+	block = true;
+
+	/* The first one is in the driver, two wait in the queue and
+	 * the last one is dropped.
+	 */
+	if (!queue_pkts(queued, sizeof(queued))) {
+		return false;
+	}
+
+	block = false;
+	k_sem_give(&tx_block);
+
+	if (!wait_sent(sizeof(queued) - 1)) {
+		return false;
+	}
+
+	if (!k_sem_take(&sent_lock, TIMEOUT)) {
+		TC_ERROR("Packet over the queue depth was sent\n");
+		return false;
+	}
+
+	if (iface->tx_stats[0].drop != drop + 1) {
+		TC_ERROR("Drop counter %u, expected %u\n",
+			 iface->tx_stats[0].drop, drop + 1);
+		return false;
+	}
+
+	if (atomic_get(&iface->tx_pending[0])) {
+		TC_ERROR("TX queue not empty\n");
+		return false;
+	}
+
+	return true;
+}
+
+static bool send_ipv6(uint8_t tc, uint8_t nexthdr, uint8_t expected)
+{
+	struct net_buf *buf, *frag;
+
+	buf = net_nbuf_get_reserve_tx(0);
+	if (!buf) {
+		TC_ERROR("Out of TX buffers\n");
+		return false;
+	}
+
+	frag = net_nbuf_get_reserve_data(net_if_get_ll_reserve(iface, NULL));
+	if (!frag) {
+		TC_ERROR("Out of data buffers\n");
+		net_nbuf_unref(buf);
+		return false;
+	}
+
+	net_buf_frag_add(buf, frag);
+
+	net_nbuf_set_iface(buf, iface);
+	net_nbuf_set_family(buf, AF_INET6);
+	net_nbuf_set_ip_hdr_len(buf, sizeof(struct net_ipv6_hdr));
+
+	NET_IPV6_BUF(buf)->vtc = 0x60 | (tc >> 4);
+	NET_IPV6_BUF(buf)->tcflow = (tc & 0x0f) << 4;
+	NET_IPV6_BUF(buf)->flow = 0;
+	NET_IPV6_BUF(buf)->len[0] = 0;
+	NET_IPV6_BUF(buf)->len[1] = 0;
+	NET_IPV6_BUF(buf)->nexthdr = nexthdr;
+	NET_IPV6_BUF(buf)->hop_limit = 64;
+
+	net_ipaddr_copy(&NET_IPV6_BUF(buf)->src, &my_addr);
+	net_ipaddr_copy(&NET_IPV6_BUF(buf)->dst, &peer_addr);
+
+	net_buf_add(frag, sizeof(struct net_ipv6_hdr));
+
+	sent_count = 0;
+
+	if (net_send_data(buf) < 0) {
+		TC_ERROR("Cannot send packet\n");
+		net_nbuf_unref(buf);
+		return false;
+	}
+
+	if (!wait_sent(1)) {
+		return false;
+	}
+
+	if (sent[0] != expected) {
+		TC_ERROR("Traffic class 0x%02x sent with priority %d, "
+			 "expected %d\n", tc, sent[0], expected);
+		return false;
+	}
+
+	return true;
+}
+
+static bool test_traffic_class(void)
+{
+	/* Class selector 5 and the priority of control messages */
+	return send_ipv6(5 << 5, IPPROTO_UDP, NET_PRIORITY_VO) &&
+		send_ipv6(0, IPPROTO_UDP, NET_PRIORITY_BE) &&
+		send_ipv6(0, IPPROTO_ICMPV6, NET_PRIORITY_IC);
+}
+
+static const struct {
+	const char *name;
+	bool (*func)(void);
+} tests[] = {
+	{ "test init", test_init },
+	{ "priority to traffic class", test_priority2tc },
+	{ "strict priority", test_strict_priority },
+	{ "queue depth", test_queue_depth },
+	{ "priority from traffic class", test_traffic_class },
+};
+
+void main(void)
+{
+	int count, pass;
+
+	for (count = 0, pass = 0; count < ARRAY_SIZE(tests); count++) {
+		TC_START(tests[count].name);
+		if (!tests[count].func()) {
+			TC_END(FAIL, "failed\n");
+		} else {
+			TC_END(PASS, "passed\n");
+			pass++;
+		}
+	}
+
+	TC_END_REPORT(((pass != ARRAY_SIZE(tests)) ? TC_FAIL : TC_PASS));
+}
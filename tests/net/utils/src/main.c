@@ -24,6 +24,7 @@
 #include <device.h>
 #include <init.h>
 #include <misc/printk.h>
+#include <misc/byteorder.h>
 #include <net/net_core.h>
 #include <net/nbuf.h>
 #include <net/net_ip.h>
@@ -157,6 +158,155 @@ static const unsigned char pkt5[98] = {
 0x36, 0x37                                      /* 67 */
 };
 
+/* The checksum as it was calculated before, one byte at a time */
+static uint16_t chksum_bytewise(uint32_t sum, const uint8_t *data, int len)
+{
+	int i;
+
+	for (i = 0; i < len; i += 2) {
+		sum += data[i] << 8;
+		if (i + 1 < len) {
+			sum += data[i + 1];
+		}
+	}
+
+	while (sum >> 16) {
+		sum = (sum & 0xffff) + (sum >> 16);
+	}
+
+	return sum;
+}
+
+static struct net_buf *ipv6_buf(int offset, int len)
+{
+	struct net_buf *buf, *frag;
+
+	buf = net_nbuf_get_reserve_rx(0);
+	frag = net_nbuf_get_reserve_data(offset);
+	net_buf_frag_add(buf, frag);
+
+	memcpy(net_buf_add(frag, NET_IPV6H_LEN + len), pkt1,
+	       NET_IPV6H_LEN + len);
+	frag->data[4] = 0;
+	frag->data[5] = len;
+
+	net_nbuf_set_ip_hdr_len(buf, NET_IPV6H_LEN);
+	net_nbuf_set_family(buf, AF_INET6);
+	net_nbuf_set_ext_len(buf, 0);
+
+	return buf;
+}
+
+/* Sum the data from all alignments and with odd and even lengths */
+static bool test_chksum_odd(void)
+{
+	struct net_buf *buf;
+	uint16_t chksum, expected;
+	const uint8_t *hdr;
+	int offset, len;
+
+	for (offset = 0; offset < 4; offset++) {
+		for (len = 1; len <= sizeof(pkt1) - NET_IPV6H_LEN; len++) {
+			buf = ipv6_buf(offset, len);
+			hdr = buf->frags->data;
+
+			expected = chksum_bytewise(len + IPPROTO_ICMPV6,
+						   hdr + 8,
+						   2 * sizeof(struct in6_addr));
+			expected = chksum_bytewise(expected,
+						   hdr + NET_IPV6H_LEN, len);
+			if (!expected) {
+				expected = 0xffff;
+			}
+
+			chksum = ntohs(net_calc_chksum(buf, IPPROTO_ICMPV6));
+
+			net_nbuf_unref(buf);
+
+			if (chksum != expected) {
+				printk("Invalid chksum 0x%x at offset %d "
+				       "len %d, should be 0x%x\n",
+				       chksum, offset, len, expected);
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+/* Change the ICMPv6 identifier and sequence number together */
+static bool test_chksum_update32(void)
+{
+	struct net_buf *buf = ipv6_buf(1, sizeof(pkt1) - NET_IPV6H_LEN);
+	uint8_t *icmp = buf->frags->data + NET_IPV6H_LEN;
+	uint16_t chksum, expected;
+
+	icmp[2] = 0;
+	icmp[3] = 0;
+	chksum = ntohs(~net_calc_chksum(buf, IPPROTO_ICMPV6));
+
+	chksum = net_calc_chksum_update32(chksum, sys_get_be32(&icmp[4]),
+					  0xdeadbeef);
+	sys_put_be32(0xdeadbeef, &icmp[4]);
+
+	expected = ntohs(~net_calc_chksum(buf, IPPROTO_ICMPV6));
+
+	net_nbuf_unref(buf);
+
+	if (chksum != expected) {
+		printk("Invalid updated chksum 0x%x, should be 0x%x\n",
+		       chksum, expected);
+		return false;
+	}
+
+	return true;
+}
+
+/* Patch the ACK and the flags of a finalized segment like
+ * net_tcp_send_buf() does.
+ */
+static bool test_tcp_ack_patch(void)
+{
+	struct net_buf *buf = ipv6_buf(1, sizeof(pkt1) - NET_IPV6H_LEN);
+	struct net_tcp_hdr *tcphdr;
+	uint16_t chksum, expected, old_flags;
+	uint32_t old_ack;
+
+	buf->frags->data[6] = IPPROTO_TCP;
+	tcphdr = (struct net_tcp_hdr *)(buf->frags->data + NET_IPV6H_LEN);
+	tcphdr->offset = 5 << 4;
+	tcphdr->flags = 0x08;
+	tcphdr->chksum = 0;
+	tcphdr->chksum = ~net_calc_chksum(buf, IPPROTO_TCP);
+
+	old_ack = sys_get_be32(tcphdr->ack);
+	old_flags = (tcphdr->offset << 8) | tcphdr->flags;
+
+	sys_put_be32(old_ack + 0x10001, tcphdr->ack);
+	tcphdr->flags |= 0x10;
+
+	chksum = ntohs(tcphdr->chksum);
+	chksum = net_calc_chksum_update32(chksum, old_ack,
+					  sys_get_be32(tcphdr->ack));
+	chksum = net_calc_chksum_update16(chksum, old_flags,
+					  (tcphdr->offset << 8) |
+					  tcphdr->flags);
+
+	tcphdr->chksum = 0;
+	expected = ntohs(~net_calc_chksum(buf, IPPROTO_TCP));
+
+	net_nbuf_unref(buf);
+
+	if (chksum != expected) {
+		printk("Invalid patched TCP chksum 0x%x, should be 0x%x\n",
+		       chksum, expected);
+		return false;
+	}
+
+	return true;
+}
+
 static bool run_tests(void)
 {
 	struct net_buf *frag, *buf;
@@ -191,6 +341,25 @@ static bool run_tests(void)
 		       chksum, orig_chksum);
 		return false;
 	}
+	/* Change the ICMPv6 identifier and check that the incrementally
+	 * updated checksum matches a full recalculation.
+	 */
+	frag->data[hdr_len + 2] = orig_chksum >> 8;
+	frag->data[hdr_len + 3] = orig_chksum;
+	chksum = net_calc_chksum_update16(orig_chksum,
+					  (frag->data[hdr_len + 4] << 8) +
+					  frag->data[hdr_len + 5], 0x1234);
+	frag->data[hdr_len + 2] = 0;
+	frag->data[hdr_len + 3] = 0;
+	frag->data[hdr_len + 4] = 0x12;
+	frag->data[hdr_len + 5] = 0x34;
+
+	orig_chksum = ntohs(~net_calc_chksum(buf, IPPROTO_ICMPV6));
+	if (chksum != orig_chksum) {
+		printk("Invalid updated chksum 0x%x in pkt1, should be 0x%x\n",
+		       chksum, orig_chksum);
+		return false;
+	}
 	net_nbuf_unref(buf);
 
 	/* Then a case where there will be two fragments */
@@ -372,6 +541,11 @@ static bool run_tests(void)
 	}
 	net_nbuf_unref(buf);
 
+	if (!test_chksum_odd() || !test_chksum_update32() ||
+	    !test_tcp_ack_patch()) {
+		return false;
+	}
+
 	printk("Network utils checks passed\n");
 	return true;
 }